@@ -0,0 +1,611 @@
+// Litecask - High performance, persistent embedded Key-Value storage engine.
+//
+// The MIT License (MIT)
+//
+// Copyright(c) 2023, Damien Feneyrou <dfeneyrou@gmail.com>
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <thread>
+
+#include "litecask.h"
+
+using namespace litecask;
+
+// Workloads
+// =========
+
+// Key access distributions
+enum class Distribution { Uniform, Zipf, Latest };
+
+// Operation mix of a workload, in percentage. YCSB 'E' short range scans are mapped on indexed queries, as the keys are not ordered
+struct Workload {
+    const char* name;
+    int         readPercentage;    // Get of an existing key
+    int         updatePercentage;  // Put of an existing key
+    int         insertPercentage;  // Put of a new key
+    int         rmwPercentage;     // Read-modify-write of an existing key (get then put)
+    int         queryPercentage;   // Query of the keys sharing a group index (about 'KeysPerGroup' keys)
+    bool        isFullScan;        // Parallel full-keyspace scans, each thread scanning its own range
+    bool        isLatest;          // Forces the 'latest' key distribution (YCSB 'D')
+};
+
+static const Workload Workloads[] = {
+    {"a", 50, 50, 0, 0, 0, false, false},    {"b", 95, 5, 0, 0, 0, false, false},    {"c", 100, 0, 0, 0, 0, false, false},
+    {"d", 95, 0, 5, 0, 0, false, true},      {"e", 0, 0, 5, 0, 95, false, false},    {"f", 50, 0, 0, 50, 0, false, false},
+    {"scan", 0, 0, 0, 0, 0, true, false},    {"query", 0, 0, 0, 0, 100, false, false},
+};
+
+// Key layout: 8 bytes record identifier, 4 bytes group identifier (indexed for queries), then a padding up to the key size.
+// The key size is derived from the record identifier so that any key can be rebuilt from its identifier only.
+static constexpr uint32_t KeyHeaderBytes = 12;
+static constexpr uint32_t KeysPerGroup   = 50;
+
+struct BenchParams {
+    lcVector<const Workload*> workloads;
+    uint64_t                  recordQty        = 1'000'000;
+    uint32_t                  threadQty        = 4;
+    double                    durationSec      = 10.;
+    uint32_t                  keyMinBytes      = 16;
+    uint32_t                  keyMaxBytes      = 32;
+    uint32_t                  valueMinBytes    = 100;
+    uint32_t                  valueMaxBytes    = 1000;
+    Distribution              distribution     = Distribution::Zipf;
+    double                    zipfCoef         = 0.99;
+    uint64_t                  cacheBytes       = 256 * 1024 * 1024;
+    uint32_t                  mergePeriodMs    = 1000;
+    uint32_t                  dataFileMaxBytes = 100'000'000;
+    uint32_t                  writeLaneQty     = 1;
+    bool                      doReuse          = false;
+    bool                      fingerprintMode  = false;
+    lcString                  jsonPath         = "litecask_bench.json";
+};
+
+struct WorkloadResult {
+    lcString     name;
+    double       durationSec      = 0.;
+    uint64_t     opQty            = 0;
+    uint64_t     notFoundQty      = 0;
+    uint64_t     failedQty        = 0;
+    uint64_t     scannedEntryQty  = 0;
+    uint64_t     cacheHitQty      = 0;
+    uint64_t     diskReadQty      = 0;
+    uint64_t     mergeQty         = 0;
+    uint64_t     mergeGainedBytes = 0;
+    LatencyStats latencies[(int)LatencyKind::Qty];
+};
+
+// Helpers
+// =======
+
+static uint64_t
+getTimeNs()
+{
+    return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static uint64_t
+hashId(uint64_t x)
+{
+    // Splitmix64 finalizer
+    x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+    return x ^ (x >> 31);
+}
+
+// Per-thread pseudo random generator (xorshift64*)
+class Random
+{
+   public:
+    explicit Random(uint64_t seed) : _state(hashId(seed) | 1) {}
+    uint64_t next()
+    {
+        _state ^= _state >> 12;
+        _state ^= _state << 25;
+        _state ^= _state >> 27;
+        return _state * 0x2545F4914F6CDD1DULL;
+    }
+    double   nextUnit() { return (double)(next() >> 11) * (1. / 9007199254740992.); }
+    uint32_t nextRange(uint32_t minValue, uint32_t maxValue) { return minValue + (uint32_t)(next() % (maxValue - minValue + 1)); }
+
+   private:
+    uint64_t _state;
+};
+
+// Zipf generator of ranks in [0; n[ with the rejection-free method of Gray et al. ("Quickly generating billion-record synthetic
+// databases"), as used by YCSB. The rank 0 is the most frequent one.
+class ZipfGenerator
+{
+   public:
+    void init(uint64_t n, double theta)
+    {
+        _n     = n;
+        _theta = theta;
+        _zetan = zeta(n, theta);
+        _alpha = 1. / (1. - theta);
+        _eta   = (1. - std::pow(2. / (double)n, 1. - theta)) / (1. - zeta(2, theta) / _zetan);
+    }
+
+    uint64_t next(double u) const
+    {
+        double uz = u * _zetan;
+        if (uz < 1.) { return 0; }
+        if (uz < 1. + std::pow(0.5, _theta)) { return 1; }
+        return std::min(_n - 1, (uint64_t)((double)_n * std::pow(_eta * u - _eta + 1., _alpha)));
+    }
+
+   private:
+    static double zeta(uint64_t n, double theta)
+    {
+        double sum = 0.;
+        for (uint64_t i = 1; i <= n; ++i) { sum += 1. / std::pow((double)i, theta); }
+        return sum;
+    }
+
+    uint64_t _n     = 1;
+    double   _theta = 0.99;
+    double   _zetan = 1.;
+    double   _alpha = 1.;
+    double   _eta   = 0.;
+};
+
+// Shared state of the benchmark
+struct BenchContext {
+    const BenchParams*    params = nullptr;
+    Datastore*            store  = nullptr;
+    ZipfGenerator         zipf;
+    uint64_t              groupQty = 1;
+    lcVector<uint8_t>     valueSource;  // Random content from which values are copied
+    std::atomic<uint64_t> insertedQty{0};
+};
+
+static void
+buildKey(const BenchContext& ctx, uint64_t id, lcVector<uint8_t>& key)
+{
+    const BenchParams& p       = *ctx.params;
+    uint32_t           keySize = p.keyMinBytes + (uint32_t)(hashId(id) % (p.keyMaxBytes - p.keyMinBytes + 1));
+    uint32_t           groupId = (uint32_t)(id % ctx.groupQty);
+    key.resize(keySize);
+    memcpy(key.data(), &id, 8);
+    memcpy(key.data() + 8, &groupId, 4);
+    for (uint32_t i = KeyHeaderBytes; i < keySize; ++i) { key[i] = (uint8_t)('a' + (i % 26)); }
+}
+
+// Selects an existing record identifier according to the access distribution
+static uint64_t
+selectId(BenchContext& ctx, Random& rng, bool isLatest)
+{
+    uint64_t existingQty = ctx.insertedQty.load(std::memory_order_relaxed);
+    if (isLatest || ctx.params->distribution == Distribution::Latest) {
+        uint64_t rank = ctx.zipf.next(rng.nextUnit());
+        return (rank < existingQty) ? existingQty - 1 - rank : 0;
+    }
+    if (ctx.params->distribution == Distribution::Zipf) {
+        // Scrambled so that the popular keys are spread over the key space, and not all the first inserted ones
+        return hashId(ctx.zipf.next(rng.nextUnit())) % existingQty;
+    }
+    return rng.next() % existingQty;
+}
+
+static Status
+writeRecord(BenchContext& ctx, Random& rng, uint64_t id, lcVector<uint8_t>& key, const lcVector<KeyIndex>& keyIndexes)
+{
+    const BenchParams& p         = *ctx.params;
+    uint32_t           valueSize = rng.nextRange(p.valueMinBytes, p.valueMaxBytes);
+    uint32_t           offset    = (uint32_t)(rng.next() % (ctx.valueSource.size() - valueSize + 1));
+    buildKey(ctx, id, key);
+    return ctx.store->put(key, ctx.valueSource.data() + offset, valueSize, keyIndexes);
+}
+
+// Workers
+// =======
+
+struct WorkerCounters {
+    uint64_t opQty           = 0;
+    uint64_t notFoundQty     = 0;
+    uint64_t failedQty       = 0;
+    uint64_t scannedEntryQty = 0;
+};
+
+static void
+loadWorker(BenchContext* ctx, uint32_t workerIdx, WorkerCounters* counters)
+{
+    const BenchParams& p = *ctx->params;
+    Random             rng(1000 + workerIdx);
+    lcVector<uint8_t>  key;
+    lcVector<KeyIndex> keyIndexes{{8, 4}};
+    for (uint64_t id = workerIdx; id < p.recordQty; id += p.threadQty) {
+        if (writeRecord(*ctx, rng, id, key, keyIndexes) != Status::Ok) { ++counters->failedQty; }
+        ++counters->opQty;
+    }
+}
+
+static void
+runWorker(BenchContext* ctx, const Workload* w, uint32_t workerIdx, uint64_t endTimeNs, WorkerCounters* counters)
+{
+    const BenchParams&          p = *ctx->params;
+    Random                      rng(getTimeNs() + workerIdx);
+    lcVector<uint8_t>           key;
+    lcVector<uint8_t>           value;
+    lcVector<uint8_t>           groupKeyPart(4);
+    lcVector<lcVector<uint8_t>> matchingKeys;
+    lcVector<KeyIndex>          keyIndexes{{8, 4}};
+
+    if (w->isFullScan) {
+        while (getTimeNs() < endTimeNs) {
+            Status status = ctx->store->scan(
+                [counters](const ScanEntry& /*entry*/) {
+                    ++counters->scannedEntryQty;
+                    return true;
+                },
+                false, workerIdx, p.threadQty);
+            if (status != Status::Ok) { ++counters->failedQty; }
+            ++counters->opQty;
+        }
+        return;
+    }
+
+    while (true) {
+        // Check the time by batches, to keep the clock read out of the measured throughput
+        if ((counters->opQty & 0x3F) == 0 && getTimeNs() >= endTimeNs) { break; }
+        ++counters->opQty;
+
+        int    dice   = (int)(rng.next() % 100);
+        Status status = Status::Ok;
+        if ((dice -= w->readPercentage) < 0) {
+            buildKey(*ctx, selectId(*ctx, rng, w->isLatest), key);
+            status = ctx->store->get(key, value);
+        } else if ((dice -= w->updatePercentage) < 0) {
+            status = writeRecord(*ctx, rng, selectId(*ctx, rng, w->isLatest), key, keyIndexes);
+        } else if ((dice -= w->insertPercentage) < 0) {
+            status = writeRecord(*ctx, rng, ctx->insertedQty.fetch_add(1), key, keyIndexes);
+        } else if ((dice -= w->rmwPercentage) < 0) {
+            uint64_t id = selectId(*ctx, rng, w->isLatest);
+            buildKey(*ctx, id, key);
+            status = ctx->store->get(key, value);
+            if (status == Status::Ok) { status = writeRecord(*ctx, rng, id, key, keyIndexes); }
+        } else {
+            uint32_t groupId = (uint32_t)(selectId(*ctx, rng, w->isLatest) % ctx->groupQty);
+            memcpy(groupKeyPart.data(), &groupId, 4);
+            status = ctx->store->query(groupKeyPart, matchingKeys);
+            counters->scannedEntryQty += matchingKeys.size();
+        }
+
+        if (status == Status::EntryNotFound) {
+            ++counters->notFoundQty;
+        } else if (status != Status::Ok) {
+            ++counters->failedQty;
+        }
+    }
+}
+
+// Runs the workers of a phase and collects its results
+static WorkloadResult
+runPhase(BenchContext& ctx, const char* name, const std::function<void(uint32_t, WorkerCounters*)>& worker)
+{
+    const BenchParams&        p = *ctx.params;
+    const DatastoreCounters&  c = ctx.store->getCounters();
+    WorkloadResult            r;
+    lcVector<WorkerCounters>  counters(p.threadQty);
+    lcVector<std::thread>     threads;
+    r.name = name;
+
+    uint64_t startCacheHitQty      = c.getCacheHitQty.load();
+    uint64_t startDiskReadQty      = c.getCallDiskReadQty.load();
+    uint64_t startMergeQty         = c.mergeCycleWithMergeQty.load();
+    uint64_t startMergeGainedBytes = c.mergeGainedBytes.load();
+    ctx.store->resetLatencyStats();
+
+    uint64_t startTimeNs = getTimeNs();
+    for (uint32_t i = 0; i < p.threadQty; ++i) { threads.emplace_back(worker, i, &counters[i]); }
+    for (auto& t : threads) { t.join(); }
+    r.durationSec = 1e-9 * (double)(getTimeNs() - startTimeNs);
+
+    for (const WorkerCounters& wc : counters) {
+        r.opQty += wc.opQty;
+        r.notFoundQty += wc.notFoundQty;
+        r.failedQty += wc.failedQty;
+        r.scannedEntryQty += wc.scannedEntryQty;
+    }
+    r.cacheHitQty      = c.getCacheHitQty.load() - startCacheHitQty;
+    r.diskReadQty      = c.getCallDiskReadQty.load() - startDiskReadQty;
+    r.mergeQty         = c.mergeCycleWithMergeQty.load() - startMergeQty;
+    r.mergeGainedBytes = c.mergeGainedBytes.load() - startMergeGainedBytes;
+    for (int kindIdx = 0; kindIdx < (int)LatencyKind::Qty; ++kindIdx) {
+        r.latencies[kindIdx] = ctx.store->getLatencyStats((LatencyKind)kindIdx);
+    }
+
+    printf("%-6s %10.0f op/s %10" PRIu64 " ops in %6.1f s  (not found %" PRIu64 ", failed %" PRIu64 ", disk reads %" PRIu64
+           ", merges %" PRIu64 ")\n",
+           name, (double)r.opQty / std::max(r.durationSec, 1e-9), r.opQty, r.durationSec, r.notFoundQty, r.failedQty, r.diskReadQty,
+           r.mergeQty);
+    return r;
+}
+
+// JSON output
+// ===========
+
+static void
+writeJson(FILE* fh, const BenchParams& p, const lcVector<WorkloadResult>& results)
+{
+    static const char* DistributionNames[] = {"uniform", "zipf", "latest"};
+
+    fprintf(fh, "{\n  \"config\": {\n");
+    fprintf(fh, "    \"records\": %" PRIu64 ",\n    \"threads\": %u,\n    \"durationSec\": %.1f,\n", p.recordQty, p.threadQty,
+            p.durationSec);
+    fprintf(fh, "    \"keyBytes\": [%u, %u],\n    \"valueBytes\": [%u, %u],\n", p.keyMinBytes, p.keyMaxBytes, p.valueMinBytes,
+            p.valueMaxBytes);
+    fprintf(fh, "    \"distribution\": \"%s\",\n    \"zipfCoef\": %.3f,\n", DistributionNames[(int)p.distribution], p.zipfCoef);
+    fprintf(fh, "    \"cacheBytes\": %" PRIu64 ",\n    \"mergePeriodMs\": %u,\n    \"dataFileMaxBytes\": %u,\n", p.cacheBytes,
+            p.mergePeriodMs, p.dataFileMaxBytes);
+    fprintf(fh, "    \"writeLanes\": %u,\n    \"fingerprintMode\": %s\n", p.writeLaneQty, p.fingerprintMode ? "true" : "false");
+    fprintf(fh, "  },\n  \"results\": [\n");
+
+    for (size_t resultIdx = 0; resultIdx < results.size(); ++resultIdx) {
+        const WorkloadResult& r = results[resultIdx];
+        fprintf(fh, "    {\n      \"workload\": \"%s\",\n      \"durationSec\": %.3f,\n", r.name.c_str(), r.durationSec);
+        fprintf(fh, "      \"operations\": %" PRIu64 ",\n      \"opsPerSec\": %.1f,\n", r.opQty,
+                (double)r.opQty / std::max(r.durationSec, 1e-9));
+        fprintf(fh, "      \"notFound\": %" PRIu64 ",\n      \"failed\": %" PRIu64 ",\n      \"scannedEntries\": %" PRIu64 ",\n",
+                r.notFoundQty, r.failedQty, r.scannedEntryQty);
+        fprintf(fh, "      \"cacheHits\": %" PRIu64 ",\n      \"diskReads\": %" PRIu64 ",\n", r.cacheHitQty, r.diskReadQty);
+        fprintf(fh, "      \"merges\": %" PRIu64 ",\n      \"mergeGainedBytes\": %" PRIu64 ",\n", r.mergeQty, r.mergeGainedBytes);
+        fprintf(fh, "      \"latenciesUs\": {");
+
+        bool isFirst = true;
+        for (int kindIdx = 0; kindIdx < (int)LatencyKind::Qty; ++kindIdx) {
+            const LatencyStats& l = r.latencies[kindIdx];
+            if (l.count == 0) { continue; }
+            // JSON friendly name ("KeyDir shard lock wait" -> "keydir_shard_lock_wait")
+            lcString kindName = Datastore::toString((LatencyKind)kindIdx);
+            for (char& ch : kindName) { ch = (ch == ' ' || ch == '-') ? '_' : (char)tolower(ch); }
+            fprintf(fh,
+                    "%s\n        \"%s\": {\"count\": %" PRIu64
+                    ", \"min\": %.3f, \"mean\": %.3f, \"p50\": %.3f, \"p90\": %.3f, \"p99\": %.3f, \"p999\": %.3f, \"max\": %.3f}",
+                    isFirst ? "" : ",", kindName.c_str(), l.count, 1e-3 * (double)l.minNs, 1e-3 * (double)l.meanNs, 1e-3 * (double)l.p50Ns,
+                    1e-3 * (double)l.p90Ns, 1e-3 * (double)l.p99Ns, 1e-3 * (double)l.p999Ns, 1e-3 * (double)l.maxNs);
+            isFirst = false;
+        }
+        fprintf(fh, "%s}\n    }%s\n", isFirst ? "" : "\n      ", (resultIdx + 1 < results.size()) ? "," : "");
+    }
+    fprintf(fh, "  ]\n}\n");
+}
+
+// Main
+// ====
+
+static bool
+parseRange(const lcString& s, uint32_t& minValue, uint32_t& maxValue)
+{
+    char*    end = nullptr;
+    uint32_t a   = (uint32_t)strtoll(s.c_str(), &end, 0);
+    uint32_t b   = a;
+    if (end && *end == '-') { b = (uint32_t)strtoll(end + 1, &end, 0); }
+    if (end == nullptr || *end != 0 || a == 0 || b < a) { return false; }
+    minValue = a;
+    maxValue = b;
+    return true;
+}
+
+int
+main(int argc, char** argv)
+{
+    BenchParams           p;
+    LogLevel              logLevel        = LogLevel::Warn;
+    bool                  doDisplaySyntax = false;
+    std::filesystem::path dbDirectoryPath;
+    lcString              workloadList = "a,b,c,d,e,f";
+
+    // Parse the command line
+    // ======================
+    int paramIdx = 0;
+    int i        = 1;
+    while (i < argc && !doDisplaySyntax) {
+        lcString arg   = argv[i++];
+        lcString value = (arg.size() >= 3 && arg[0] == '-' && arg[2] == '=') ? arg.substr(3) : lcString();
+        if (arg == "-v") {
+            logLevel = LogLevel::Info;
+        } else if (arg == "-r") {
+            p.doReuse = true;
+        } else if (arg == "-p") {
+            p.fingerprintMode = true;
+        } else if (arg.size() >= 3 && arg.substr(0, 3) == "-w=") {
+            workloadList = value;
+        } else if (arg.size() >= 3 && arg.substr(0, 3) == "-n=") {
+            p.recordQty = (uint64_t)strtoll(value.c_str(), nullptr, 0);
+            if (p.recordQty == 0) { doDisplaySyntax = true; }
+        } else if (arg.size() >= 3 && arg.substr(0, 3) == "-t=") {
+            p.threadQty = (uint32_t)strtoll(value.c_str(), nullptr, 0);
+            if (p.threadQty == 0) { doDisplaySyntax = true; }
+        } else if (arg.size() >= 3 && arg.substr(0, 3) == "-s=") {
+            p.durationSec = strtod(value.c_str(), nullptr);
+            if (p.durationSec <= 0.) { doDisplaySyntax = true; }
+        } else if (arg.size() >= 3 && arg.substr(0, 3) == "-k=") {
+            if (!parseRange(value, p.keyMinBytes, p.keyMaxBytes) || p.keyMinBytes < KeyHeaderBytes || p.keyMaxBytes >= 65535) {
+                printf("Error: the key size range shall be within [%u; 65535[ bytes\n", KeyHeaderBytes);
+                doDisplaySyntax = true;
+            }
+        } else if (arg.size() >= 3 && arg.substr(0, 3) == "-b=") {
+            if (!parseRange(value, p.valueMinBytes, p.valueMaxBytes)) { doDisplaySyntax = true; }
+        } else if (arg.size() >= 3 && arg.substr(0, 3) == "-d=") {
+            if (value == "uniform") {
+                p.distribution = Distribution::Uniform;
+            } else if (value == "zipf") {
+                p.distribution = Distribution::Zipf;
+            } else if (value == "latest") {
+                p.distribution = Distribution::Latest;
+            } else {
+                printf("Error: unknown distribution '%s'\n", value.c_str());
+                doDisplaySyntax = true;
+            }
+        } else if (arg.size() >= 3 && arg.substr(0, 3) == "-z=") {
+            p.zipfCoef = strtod(value.c_str(), nullptr);
+            if (p.zipfCoef <= 0. || p.zipfCoef == 1.) {
+                printf("Error: the Zipf coefficient shall be strictly positive and different from 1\n");
+                doDisplaySyntax = true;
+            }
+        } else if (arg.size() >= 3 && arg.substr(0, 3) == "-c=") {
+            p.cacheBytes = (uint64_t)strtoll(value.c_str(), nullptr, 0);
+            if (p.cacheBytes == 0) { doDisplaySyntax = true; }
+        } else if (arg.size() >= 3 && arg.substr(0, 3) == "-m=") {
+            p.mergePeriodMs = (uint32_t)strtoll(value.c_str(), nullptr, 0);
+            if (p.mergePeriodMs == 0) { doDisplaySyntax = true; }
+        } else if (arg.size() >= 3 && arg.substr(0, 3) == "-f=") {
+            p.dataFileMaxBytes = (uint32_t)strtoll(value.c_str(), nullptr, 0);
+            if (p.dataFileMaxBytes == 0) { doDisplaySyntax = true; }
+        } else if (arg.size() >= 3 && arg.substr(0, 3) == "-l=") {
+            p.writeLaneQty = (uint32_t)strtoll(value.c_str(), nullptr, 0);
+            if (p.writeLaneQty == 0) { doDisplaySyntax = true; }
+        } else if (arg.size() >= 3 && arg.substr(0, 3) == "-j=") {
+            p.jsonPath = value;
+        } else if (!arg.empty() && arg.data()[0] == '-') {
+            printf("Error: unknown option '%s'\n", arg.c_str());
+            doDisplaySyntax = true;
+        } else if (paramIdx == 0) {
+            dbDirectoryPath = arg;
+            ++paramIdx;
+        } else {
+            printf("Error: too much parameters.\n");
+            doDisplaySyntax = true;
+        }
+    }
+
+    // Resolve the workload list
+    size_t startPos = 0;
+    while (!doDisplaySyntax && startPos <= workloadList.size()) {
+        size_t   endPos = std::min(workloadList.find(',', startPos), workloadList.size());
+        lcString name   = workloadList.substr(startPos, endPos - startPos);
+        bool     isFound = false;
+        for (const Workload& w : Workloads) {
+            if (name == w.name) {
+                p.workloads.push_back(&w);
+                isFound = true;
+            }
+        }
+        if (!isFound) {
+            printf("Error: unknown workload '%s'\n", name.c_str());
+            doDisplaySyntax = true;
+        }
+        startPos = endPos + 1;
+    }
+
+    if (paramIdx != 1) { doDisplaySyntax = true; }
+    if (doDisplaySyntax) {
+        BenchParams d;
+        printf("Litecask YCSB-like benchmark\n\n");
+        printf("Syntax: %s <db path> [ options ]\n\n", argv[0]);
+        printf("  The litecask files of the database directory are erased, unless the option -r is used.\n\n");
+        printf("  Options:\n");
+        printf("   -w=<list>      comma separated workloads among a,b,c,d,e,f,scan,query. Default is 'a,b,c,d,e,f'\n");
+        printf("                    a: 50%% read, 50%% update         b: 95%% read, 5%% update     c: 100%% read\n");
+        printf("                    d: 95%% read latest, 5%% insert   e: 95%% query, 5%% insert    f: 50%% read, 50%% read-modify-write\n");
+        printf("                    scan: parallel full scans       query: 100%% query of about %u keys\n", KeysPerGroup);
+        printf("   -n=<qty>       record quantity loaded before the workloads. Default is %" PRIu64 "\n", d.recordQty);
+        printf("   -t=<qty>       thread quantity. Default is %u\n", d.threadQty);
+        printf("   -s=<seconds>   duration of each workload. Default is %.0f\n", d.durationSec);
+        printf("   -k=<min>[-max] key size range in bytes (minimum %u). Default is %u-%u\n", KeyHeaderBytes, d.keyMinBytes, d.keyMaxBytes);
+        printf("   -b=<min>[-max] value size range in bytes. Default is %u-%u\n", d.valueMinBytes, d.valueMaxBytes);
+        printf("   -d=<distrib>   key access distribution among uniform, zipf, latest. Default is zipf\n");
+        printf("   -z=<coef>      Zipf coefficient. Default is %.2f\n", d.zipfCoef);
+        printf("   -c=<bytes>     value cache size, to be set lower than the dataset for larger-than-RAM runs. Default is %" PRIu64 "\n",
+               d.cacheBytes);
+        printf("   -m=<ms>        background merge cycle period. Default is %u\n", d.mergePeriodMs);
+        printf("   -f=<bytes>     data file maximum size. Default is %u\n", d.dataFileMaxBytes);
+        printf("   -l=<qty>       write lane quantity. Default is %u\n", d.writeLaneQty);
+        printf("   -p             fingerprint KeyDir mode (keys kept on disk only), for datasets with more keys than the RAM\n");
+        printf("   -r             reuses the content of a previous run with the same -n and -k options, instead of loading it\n");
+        printf("   -j=<path>      JSON output file. Default is '%s'\n", d.jsonPath.c_str());
+        printf("   -v             verbose (in datastore log file)\n");
+        exit(1);
+    }
+
+    // Open and configure the datastore
+    // ================================
+    if (!p.doReuse) { Datastore::erasePermanentlyAllContent_UseWithCaution(dbDirectoryPath); }
+
+    Datastore store((size_t)p.cacheBytes);
+    store.setLogLevel(logLevel);
+    // The configuration is set before the opening, as the KeyDir mode is taken into account there
+    Config config                 = store.getConfig();
+    config.latencyInstrumentation = true;
+    config.mergeCyclePeriodMs     = p.mergePeriodMs;
+    config.dataFileMaxBytes       = p.dataFileMaxBytes;
+    config.writeLaneQty           = p.writeLaneQty;
+    config.keyDirFingerprintMode  = p.fingerprintMode;
+    // The dead bytes merge thresholds keep their default proportion to the data file size, so that smaller files still merge
+    config.mergeTriggerDataFileDeadByteThreshold = std::min(config.mergeTriggerDataFileDeadByteThreshold, p.dataFileMaxBytes / 2);
+    config.mergeSelectDataFileDeadByteThreshold =
+        std::min(config.mergeSelectDataFileDeadByteThreshold, config.mergeTriggerDataFileDeadByteThreshold / 5);
+    Status status = store.setConfig(config);
+    if (status != Status::Ok) {
+        printf("Unable to set the configuration: %s\n", Datastore::toString(status));
+        exit(1);
+    }
+
+    status = store.open(dbDirectoryPath);
+    if (status != Status::Ok) {
+        printf("Unable to open the datastore %s: %s\n", dbDirectoryPath.string().c_str(), Datastore::toString(status));
+        exit(1);
+    }
+
+    BenchContext ctx;
+    ctx.params   = &p;
+    ctx.store    = &store;
+    ctx.groupQty = std::max((uint64_t)1, p.recordQty / KeysPerGroup);
+    ctx.zipf.init(p.recordQty, p.zipfCoef);
+    ctx.valueSource.resize(2 * p.valueMaxBytes);
+    Random rng(0);
+    for (uint8_t& b : ctx.valueSource) { b = (uint8_t)rng.next(); }
+
+    // Run the phases
+    // ==============
+    lcVector<WorkloadResult> results;
+
+    if (!p.doReuse) {
+        results.push_back(runPhase(ctx, "load", [&ctx](uint32_t workerIdx, WorkerCounters* counters) {
+            loadWorker(&ctx, workerIdx, counters);
+        }));
+    }
+    ctx.insertedQty.store(p.recordQty);
+
+    for (const Workload* w : p.workloads) {
+        uint64_t endTimeNs = getTimeNs() + (uint64_t)(1e9 * p.durationSec);
+        results.push_back(runPhase(ctx, w->name, [&ctx, w, endTimeNs](uint32_t workerIdx, WorkerCounters* counters) {
+            runWorker(&ctx, w, workerIdx, endTimeNs, counters);
+        }));
+    }
+
+    store.close();
+
+    // Write the JSON report
+    FILE* fh = fopen(p.jsonPath.c_str(), "w");
+    if (fh == nullptr) {
+        printf("Error: unable to open the JSON output file '%s'\n", p.jsonPath.c_str());
+        exit(1);
+    }
+    writeJson(fh, p, results);
+    fclose(fh);
+    printf("Results written in '%s'\n", p.jsonPath.c_str());
+
+    return 0;
+}
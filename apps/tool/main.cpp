@@ -32,6 +32,8 @@ main(int argc, char** argv)
     using namespace litecask;
     LogLevel              logLevel        = LogLevel::Warn;
     bool                  doDisplaySyntax = false;
+    bool                  doMeasureGet    = false;
+    uint32_t              workerQty       = std::max(1U, std::thread::hardware_concurrency());
     lcString              command;
     std::filesystem::path dbDirectoryPath;
     litecask::Config      config;
@@ -47,6 +49,8 @@ main(int argc, char** argv)
             logLevel = LogLevel::Info;
         } else if (arg == "-vv") {
             logLevel = LogLevel::Debug;
+        } else if (arg == "-l") {
+            doMeasureGet = true;
         } else if (arg.size() >= 3 && arg.substr(0, 3) == "-s=") {
             uint32_t dataFileMaxBytes = (uint32_t)strtoll(arg.substr(3).c_str(), nullptr, 0);
             if (dataFileMaxBytes > 0) {
@@ -56,6 +60,12 @@ main(int argc, char** argv)
                 printf("Error: wrong value for dataFileMaxBytes (%s)\n", arg.substr(3).c_str());
                 doDisplaySyntax = true;
             }
+        } else if (arg.size() >= 3 && arg.substr(0, 3) == "-j=") {
+            workerQty = (uint32_t)strtoll(arg.substr(3).c_str(), nullptr, 0);
+            if (workerQty == 0) {
+                printf("Error: wrong value for the thread quantity (%s)\n", arg.substr(3).c_str());
+                doDisplaySyntax = true;
+            }
         } else if (!arg.empty() && arg.data()[0] == '-') {
             printf("Error: unknown option '%s'\n", arg.c_str());
             doDisplaySyntax = true;
@@ -72,32 +82,89 @@ main(int argc, char** argv)
     }
     if (paramIdx != 2) { doDisplaySyntax = true; }
     if (doDisplaySyntax) {
-        printf("Litecask utility to dump statistics or fully merge a datastore\n\n");
-        printf("Syntax: %s (stat | file | merge) <db path> [ options ]\n\n", argv[0]);
+        printf("Litecask utility to dump statistics, verify, fully merge or compact a datastore\n\n");
+        printf("Syntax: %s (stat | file | merge | verify | compact) <db path> [ options ]\n\n", argv[0]);
         printf("  Options:\n");
         printf("   -v    verbose (in datastore log file)\n");
         printf("   -vv   more verbose logs\n");
-        printf("   -s=<dataFileMaxBytes>   Used by the merge command. Default is %u\n", config.dataFileMaxBytes);
+        printf("   -s=<dataFileMaxBytes>   Used by the merge and compact commands. Default is %u\n", config.dataFileMaxBytes);
+        printf("   -j=<threads>            Used by the verify and compact commands. Default is %u\n", workerQty);
+        printf("   -l    Used by the stat command. Reads all entries and provides the latency statistics\n");
         printf("\n");
         printf("  Commands:\n");
         printf("   'stats' provides a summary of the database figures (size, items, ...)\n");
         printf("   'file'  dumps the high level statistics of each data file\n");
         printf("   'merge' performs an offline full merge of the datastore.\n");
+        printf("   'verify'  checks all the entries, blob files and hint files, without opening the datastore\n");
+        printf("   'compact' verifies then rewrites only the live entries, ordered by key hash, with their hint files\n");
 
         exit(1);
     }
 
-    if (command != "stat" && command != "file" && command != "merge") {
-        printf("Error: the first parameter is the command name, to select among (stat | file | merge)\n");
+    if (command != "stat" && command != "file" && command != "merge" && command != "verify" && command != "compact") {
+        printf("Error: the first parameter is the command name, to select among (stat | file | merge | verify | compact)\n");
         exit(1);
     }
 
-    // Prepare the configuration for full merge
+    // Prepare the configuration for full merge, and the latency measures if requested
+    config.latencyInstrumentation                      = doMeasureGet;
     config.mergeTriggerDataFileFragmentationPercentage = 1;
     config.mergeTriggerDataFileDeadByteThreshold       = 0;
     config.mergeSelectDataFileFragmentationPercentage  = 1;
     config.mergeSelectDataFileDeadByteThreshold        = 0;
 
+    // Offline commands, on the closed datastore
+    // =========================================
+
+    if (command == "verify" || command == "compact") {
+        Datastore store;
+        store.setLogLevel(logLevel);
+        status = store.setConfig(config);
+        if (status != Status::Ok) {
+            printf("Unable to set the configuration: %s\n", Datastore::toString(status));
+            exit(1);
+        }
+
+        OfflineReport report;
+        lcString      previousStep;
+        auto          displayProgress = [&previousStep](const char* step, uint64_t processedBytes, uint64_t totalBytes) {
+            if (!previousStep.empty() && previousStep != step) { printf("\n"); }
+            previousStep = step;
+            printf("\r%-10s: %3" PRId64 " %% of %.1f MB", step, 100 * processedBytes / std::max((uint64_t)1, totalBytes),
+                   1e-6 * (double)totalBytes);
+            fflush(stdout);
+        };
+        status = (command == "verify") ? store.verifyOffline(dbDirectoryPath, workerQty, report, displayProgress)
+                                       : store.compactOffline(dbDirectoryPath, workerQty, report, displayProgress);
+        printf("\n");
+        if (status != Status::Ok && status != Status::EntryCorrupted) {
+            printf("Unable to %s the datastore %s: %s\n", command.c_str(), dbDirectoryPath.string().c_str(), Datastore::toString(status));
+            exit(1);
+        }
+
+        printf("Data files         : %" PRId64 " in %.1f MB\n", report.dataFileQty, 1e-6 * (double)report.dataBytes);
+        printf("Entries            : %" PRId64 " (%" PRId64 " tombs, %" PRId64 " blobs)\n", report.entryQty, report.tombEntryQty,
+               report.blobEntryQty);
+        printf("Unreadable files   : %" PRId64 "\n", report.unreadableFileQty);
+        printf("Corrupted entries  : %" PRId64 "\n", report.corruptedEntryQty);
+        printf("Truncated files    : %" PRId64 "\n", report.truncatedFileQty);
+        printf("Missing blobs      : %" PRId64 "\n", report.missingBlobQty);
+        printf("Corrupted blobs    : %" PRId64 "\n", report.corruptedBlobQty);
+        printf("Missing hint files : %" PRId64 "\n", report.missingHintFileQty);
+        printf("Bad hint files     : %" PRId64 "\n", report.badHintFileQty);
+        if (report.isCorrupted()) {
+            printf("Error: the datastore is corrupted%s\n", (command == "compact") ? ", it has not been compacted" : "");
+            exit(1);
+        }
+        if (command == "compact") {
+            printf("Live entries       : %" PRId64 " in %.1f MB\n", report.liveEntryQty, 1e-6 * (double)report.outputBytes);
+            printf("Dropped entries    : %" PRId64 "\n", report.droppedEntryQty);
+            printf("Compacted files    : %" PRId64 "\n", report.outputDataFileQty);
+            printf("Removed blob files : %" PRId64 "\n", report.removedBlobQty);
+        }
+        return 0;
+    }
+
     // Open the database
     Datastore store;
     store.setLogLevel(logLevel);
@@ -126,6 +193,26 @@ main(int argc, char** argv)
                1e-6 * (double)(s.tombBytes + s.deadBytes));
         printf("Compactness        : %" PRId64 " %%\n",
                100 * (s.entryBytes - s.tombBytes - s.deadBytes) / std::max((uint64_t)1, s.entryBytes));
+
+        if (doMeasureGet) {
+            // Collect the keys, then read each value. As the cache is empty after the opening, the values are read from the disk
+            lcVector<lcVector<uint8_t>> keys;
+            store.scan([&keys](const ScanEntry& entry) {
+                keys.push_back(entry.key);
+                return true;
+            });
+            lcVector<uint8_t> value;
+            for (const lcVector<uint8_t>& key : keys) { store.get(key, value); }
+
+            printf("\nLatencies (us)           count      mean       p50       p90       p99      p999       max\n");
+            for (int kindIdx = 0; kindIdx < (int)LatencyKind::Qty; ++kindIdx) {
+                LatencyStats l = store.getLatencyStats((LatencyKind)kindIdx);
+                if (l.count == 0) { continue; }
+                printf("%-22s %7" PRId64 " %9.1f %9.1f %9.1f %9.1f %9.1f %9.1f\n", Datastore::toString((LatencyKind)kindIdx), l.count,
+                       1e-3 * (double)l.meanNs, 1e-3 * (double)l.p50Ns, 1e-3 * (double)l.p90Ns, 1e-3 * (double)l.p99Ns,
+                       1e-3 * (double)l.p999Ns, 1e-3 * (double)l.maxNs);
+            }
+        }
     }
 
     if (command == "file") {
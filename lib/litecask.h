@@ -71,21 +71,26 @@ int main(int argc, char** argv)
 // Windows
 #define NOMINMAX
 #include <intrin.h>
+#include <io.h>  // _get_osfhandle
 #include <windows.h>
 #pragma intrinsic(_umul128)  // For Wyhash
 
 #else
 
 // Linux
-#include <fcntl.h>     // OS open
-#include <sys/mman.h>  // mmap
-#include <unistd.h>    // process ID
+#include <fcntl.h>              // OS open
+#include <linux/mempolicy.h>  // NUMA memory policies
+#include <sys/mman.h>         // mmap
+#include <sys/syscall.h>      // getcpu, mbind
+#include <sys/uio.h>          // preadv
+#include <unistd.h>           // process ID
 
 #endif
 
 // Standard
 #include <inttypes.h>
 
+#include <algorithm>
 #include <array>
 #include <atomic>
 #include <cassert>
@@ -96,6 +101,7 @@ int main(int argc, char** argv)
 #include <cstring>
 #include <filesystem>
 #include <functional>  // for std::function
+#include <memory>      // for std::unique_ptr
 #include <mutex>
 #include <thread>
 
@@ -115,6 +121,30 @@ int main(int argc, char** argv)
 #include <shared_mutex>
 #endif
 
+// Thread capacity of the custom shared mutex, before its readers fall back on the exclusive lock. Each thread slot costs a cache line
+#ifndef LITECASK_RWLOCK_MAX_THREADS
+#define LITECASK_RWLOCK_MAX_THREADS 256
+#endif
+
+// Select the io_uring asynchronous disk read backend (Linux only, kernel 5.1+). Follow the definition of AsyncReader for more information.
+// Without it, or if the kernel refuses it, asynchronous reads fall back on synchronous reads.
+//#define LITECASK_WITH_IO_URING
+#if defined(LITECASK_WITH_IO_URING) && !defined(_MSC_VER)
+#define LITECASK_IO_URING_ENABLED 1
+#include <linux/io_uring.h>
+#include <sys/syscall.h>
+#else
+#define LITECASK_IO_URING_ENABLED 0
+#endif
+
+// SSE2 is used to intersect the sorted index lists of multi-part queries (always available on x86-64). Other targets use scalar code.
+#if defined(__SSE2__) || defined(_M_X64)
+#define LITECASK_SSE2_ENABLED 1
+#include <emmintrin.h>
+#else
+#define LITECASK_SSE2_ENABLED 0
+#endif
+
 // Macros for likely and unlikely branching
 #if defined(__GNUC__) || defined(__INTEL_COMPILER) || defined(__clang__)
 #define LITECASK_LIKELY(x)   __builtin_expect(!!(x), 1)
@@ -171,31 +201,61 @@ enum class Status {
     BadParameterValue           = 12,
     InconsistentParameterValues = 13,
     OutOfMemory                 = 14,
+    BufferTooSmall              = 15,
 };
 
 struct DatastoreCounters {
     // API calls
-    std::atomic<uint64_t> openCallQty           = 0;
-    std::atomic<uint64_t> openCallFailedQty     = 0;
-    std::atomic<uint64_t> closeCallQty          = 0;
-    std::atomic<uint64_t> closeCallFailedQty    = 0;
-    std::atomic<uint64_t> putCallQty            = 0;
-    std::atomic<uint64_t> putCallFailedQty      = 0;
-    std::atomic<uint64_t> removeCallQty         = 0;
-    std::atomic<uint64_t> removeCallNotFoundQty = 0;
-    std::atomic<uint64_t> removeCallFailedQty   = 0;
-    std::atomic<uint64_t> getCallQty            = 0;
-    std::atomic<uint64_t> getCallNotFoundQty    = 0;
-    std::atomic<uint64_t> getCallCorruptedQty   = 0;
-    std::atomic<uint64_t> getCallFailedQty      = 0;
-    std::atomic<uint64_t> getWriteBufferHitQty  = 0;
-    std::atomic<uint64_t> getCacheHitQty        = 0;
-    std::atomic<uint64_t> queryCallQty          = 0;
-    std::atomic<uint64_t> queryCallFailedQty    = 0;
+    std::atomic<uint64_t> openCallQty             = 0;
+    std::atomic<uint64_t> openCallFailedQty       = 0;
+    std::atomic<uint64_t> closeCallQty            = 0;
+    std::atomic<uint64_t> closeCallFailedQty      = 0;
+    std::atomic<uint64_t> putCallQty              = 0;
+    std::atomic<uint64_t> putCallFailedQty        = 0;
+    std::atomic<uint64_t> removeCallQty           = 0;
+    std::atomic<uint64_t> removeCallNotFoundQty   = 0;
+    std::atomic<uint64_t> removeCallFailedQty     = 0;
+    std::atomic<uint64_t> getCallQty              = 0;
+    std::atomic<uint64_t> getCallNotFoundQty      = 0;
+    std::atomic<uint64_t> getCallCorruptedQty     = 0;
+    std::atomic<uint64_t> getCallFailedQty        = 0;
+    std::atomic<uint64_t> getWriteBufferHitQty    = 0;
+    std::atomic<uint64_t> getCacheHitQty          = 0;
+    std::atomic<uint64_t> getCallDiskReadQty      = 0;
+    std::atomic<uint64_t> queryCallQty            = 0;
+    std::atomic<uint64_t> queryCallFailedQty      = 0;
+    std::atomic<uint64_t> writeBatchCallQty       = 0;
+    std::atomic<uint64_t> writeBatchCallFailedQty = 0;
+    std::atomic<uint64_t> getBatchCallQty         = 0;
+    std::atomic<uint64_t> getBatchCallFailedQty   = 0;
+    std::atomic<uint64_t> getBatchDiskReadQty     = 0;
+    std::atomic<uint64_t> getAsyncDiskReadQty     = 0;
+    std::atomic<uint64_t> scanCallQty             = 0;
+    std::atomic<uint64_t> scanCallFailedQty       = 0;
+    std::atomic<uint64_t> scanEntryQty            = 0;
+    std::atomic<uint64_t> keyDiskReadQty          = 0;
+    std::atomic<uint64_t> checkpointCallQty       = 0;
+    std::atomic<uint64_t> checkpointCallFailedQty = 0;
+    std::atomic<uint64_t> changeLogReadCallQty    = 0;
+    std::atomic<uint64_t> changeLogReadFailedQty  = 0;
+    std::atomic<uint64_t> changeLogRecordQty      = 0;
+    std::atomic<uint64_t> applyReplicatedCallQty  = 0;
+    std::atomic<uint64_t> applyReplicatedFailedQty = 0;
+    std::atomic<uint64_t> prefetchCallQty          = 0;
+    std::atomic<uint64_t> prefetchCallFailedQty    = 0;
     // Data files
     std::atomic<uint64_t> dataFileCreationQty     = 0;
     std::atomic<uint64_t> dataFileMaxQty          = 0;
     std::atomic<uint64_t> activeDataFileSwitchQty = 0;
+    std::atomic<uint64_t> groupCommitFlushQty     = 0;
+    std::atomic<uint64_t> osSyncQty               = 0;
+    std::atomic<uint64_t> directorySyncQty        = 0;
+    std::atomic<uint64_t> checkpointLinkedFileQty = 0;
+    std::atomic<uint64_t> checkpointCopiedFileQty = 0;
+    // Blob files
+    std::atomic<uint64_t> blobWriteQty   = 0;
+    std::atomic<uint64_t> blobReadQty    = 0;
+    std::atomic<uint64_t> blobRemovedQty = 0;
     // Index
     std::atomic<uint64_t> indexArrayCleaningQty    = 0;
     std::atomic<uint64_t> indexArrayCleanedEntries = 0;
@@ -205,6 +265,17 @@ struct DatastoreCounters {
     std::atomic<uint64_t> mergeGainedDataFileQty = 0;
     std::atomic<uint64_t> mergeGainedBytes       = 0;
     std::atomic<uint64_t> hintFileCreatedQty     = 0;
+    std::atomic<uint64_t> mergeOffloadedBytes    = 0;
+    std::atomic<uint64_t> mergeThrottledQty      = 0;
+    // TTL
+    std::atomic<uint64_t> ttlExpiredEntryQty = 0;
+    // Value cache warm-up
+    std::atomic<uint64_t> cacheWarmUpSavedKeyQty    = 0;
+    std::atomic<uint64_t> cacheWarmUpLoadedValueQty = 0;
+    // Prefetch
+    std::atomic<uint64_t> prefetchDroppedKeyQty  = 0;
+    std::atomic<uint64_t> prefetchDiskReadQty    = 0;
+    std::atomic<uint64_t> prefetchLoadedValueQty = 0;
 };
 
 struct ValueCacheCounters {
@@ -215,6 +286,43 @@ struct ValueCacheCounters {
     std::atomic<uint64_t> hitQty                 = 0;
     std::atomic<uint64_t> missQty                = 0;
     std::atomic<uint64_t> evictedQty             = 0;
+    std::atomic<uint64_t> admissionRejectedQty   = 0;
+};
+
+// Kinds of measured latencies (see 'Config::latencyInstrumentation' and 'Datastore::getLatencyStats')
+enum class LatencyKind {
+    // API calls
+    Put = 0,
+    Remove,
+    WriteBatch,
+    Get,
+    GetBatch,
+    Query,
+    Scan,
+    // Lock waiting times on the write and read paths
+    ActiveFileLockWait,
+    DataFilesLockWait,
+    WriteBufferLockWait,
+    KeyDirShardLockWait,
+    IndexMapLockWait,
+    // Internal operations
+    GetDiskRead,       // Disk read of a 'get' missing the write buffer and the cache
+    WriteBufferFlush,  // Write of a write buffer in its data file
+    OsSync,            // OS level synchronization of a data file
+    MergePause,        // Exclusive lock on the data files by the merge, while patching the KeyDir and replacing a data file
+    Qty
+};
+
+// Latency statistics of a kind of operation, in nanoseconds. The percentiles have a relative precision of 1/8
+struct LatencyStats {
+    uint64_t count  = 0;
+    uint64_t minNs  = 0;
+    uint64_t maxNs  = 0;
+    uint64_t meanNs = 0;
+    uint64_t p50Ns  = 0;
+    uint64_t p90Ns  = 0;
+    uint64_t p99Ns  = 0;
+    uint64_t p999Ns = 0;
 };
 
 struct DataFileStats {
@@ -227,6 +335,61 @@ struct DataFileStats {
     uint64_t deadEntries = 0;
 };
 
+// This structure describes the result of an offline verification or compaction (see 'Datastore::verifyOffline')
+struct OfflineReport {
+    uint64_t dataFileQty        = 0;
+    uint64_t dataBytes          = 0;
+    uint64_t entryQty           = 0;
+    uint64_t tombEntryQty       = 0;
+    uint64_t blobEntryQty       = 0;
+    uint64_t unreadableFileQty  = 0;
+    uint64_t corruptedEntryQty  = 0;  // Bad checksum or inconsistent sizes
+    uint64_t truncatedFileQty   = 0;  // Last entry not fully written (interrupted write). Such entry is ignored at load time
+    uint64_t missingBlobQty     = 0;
+    uint64_t corruptedBlobQty   = 0;  // Bad size or bad checksum
+    uint64_t missingHintFileQty = 0;
+    uint64_t badHintFileQty     = 0;  // Not matching its data file
+    // Compaction only
+    uint64_t liveEntryQty      = 0;
+    uint64_t droppedEntryQty   = 0;  // Overwritten, removed or expired entries
+    uint64_t outputDataFileQty = 0;
+    uint64_t outputBytes       = 0;
+    uint64_t removedBlobQty    = 0;
+
+    bool isCorrupted() const { return (unreadableFileQty + corruptedEntryQty + missingBlobQty + corruptedBlobQty) != 0; }
+};
+
+// Progress of an offline operation: name of the current step, and the processed and total byte quantities of this step
+using OfflineProgress = std::function<void(const char* step, uint64_t processedBytes, uint64_t totalBytes)>;
+
+// Defines when the written data are synchronized at the OS level, i.e. when the OS disk cache is written on the disk.
+//   'None'          : no OS synchronization. Data are still safe if the application crashes, but not if the machine crashes
+//   'PerWrite'      : each write is synced before the call returns. The concurrent writes are grouped on the same synchronization
+//   'Periodic'      : a background thread synchronizes the data every 'syncPeriodMs' milliseconds, if some were written
+//   'ByteThreshold' : a background thread synchronizes the data each time 'syncBytes' bytes have been written
+// Except with 'None', the 'forceDiskSync' write parameter and the 'sync' API also perform an OS synchronization.
+enum class SyncPolicy { None = 0, PerWrite = 1, Periodic = 2, ByteThreshold = 3 };
+
+// Defines the usage of the value cache for a single 'put' or 'get' call.
+//   'Default' : the written value, or the value read from the disk, is stored in the value cache
+//   'NoCache' : the value is not stored in the value cache (scan, one-shot write...). A value already in the cache is still used
+enum class CacheHint { Default = 0, NoCache = 1 };
+
+// Defines the NUMA placement of the KeyDir, the index map and the value cache memory (see 'Config::memoryNumaPolicy').
+//   'Default'    : the policy of the process, usually the node of the thread which first touches the memory
+//   'Local'      : the node of the thread which first touches the memory, whatever the policy of the process
+//   'Interleave' : the pages are spread over all the nodes, which balances the memory bandwidth and capacity across the sockets
+enum class NumaPolicy { Default = 0, Local = 1, Interleave = 2 };
+
+// Codec of the value compression (see 'Config::valueCompression'). The built-in one is a small LZ77 codec.
+//   'compress'   returns the compressed byte size, or 0 if the result does not fit in 'dstCapacity' bytes
+//   'decompress' returns true if exactly 'dstSize' bytes have been decompressed
+// The stored values are not tagged with the codec, so a datastore written with a custom codec shall always be opened with it.
+struct ValueCodec {
+    std::function<size_t(const uint8_t* src, size_t srcSize, uint8_t* dst, size_t dstCapacity)> compress;
+    std::function<bool(const uint8_t* src, size_t srcSize, uint8_t* dst, size_t dstSize)>       decompress;
+};
+
 struct Config {
     // General store parameters
     // ========================
@@ -259,13 +422,83 @@ struct Config {
     //   'upkeepValueCacheBatchSize' defines the quantity of cached value entries to update in a row in the LRU.
     //   A higher quantity of entries will make the background task finish earlier, at the price of higher spikes of
     //   latency on entry write or update. A too low value could paradoxically induce a forced task to clean and
-    //   evict cached values at inserting time.
+    //   evict cached values at inserting time. It also bounds the quantity of TTL expiries processed in a row.
     uint32_t upkeepValueCacheBatchSize = 10000;
     //   'valueCacheTargetMemoryLoadPercentage' configures the target load for the cache, so that the remaining free space
     //   ensures a performant insertion in the cache. The eviction required to meet this target load is deferred in a
     //   background task. Too low a value wastes cache memory. Too high a value prevent the insertion a new entry because
     //   of lack of free space.
     uint32_t valueCacheTargetMemoryLoadPercentage = 90;
+    //   'valueCacheAdmissionFilter' enables a scan-resistant admission in the cache (TinyLFU). Once the cache is full, a new value
+    //   is stored only if its key has been accessed more often recently than the key of the next evicted value. This protects the
+    //   frequently accessed values from scans and bulk writes, at the price of a frequency sketch of 1/32 of the cache size.
+    bool valueCacheAdmissionFilter = false;
+    //   'valueCacheWarmUp' enables the persistence of the cache content across a restart. At closing, the keys of the values in the
+    //   hot and warm parts of the cache are saved in a small sidecar file. At opening, their values are read back in background and
+    //   in file order, so that the cache is quickly populated while the traffic is already served.
+    bool valueCacheWarmUp = false;
+    //   'valueCacheSlabValueSize' recycles the cached values of exactly this size through a free list of fixed-size chunks (slab),
+    //   which is cheaper than the general-purpose allocator when most values share the same size. Zero disables it. It is taken
+    //   into account at the opening of the datastore.
+    uint32_t valueCacheSlabValueSize = 0;
+    //   'writeLaneQty' defines the quantity of active data files written in parallel, each with its own write buffer (1 to 16).
+    //   A key is always written in the lane selected by its hash, so several lanes let the writes of different keys scale with the
+    //   writer threads, at the price of more open files. It is taken into account at the opening of the datastore.
+    uint32_t writeLaneQty = 1;
+    //   'keyDirFingerprintMode' stores in the KeyDir a 64-bit fingerprint of each key instead of the key itself, so that the memory
+    //   per entry does not depend on the key size. Together with the key hash and size, the fingerprint identifies the key with a
+    //   negligible collision probability, and 'get' checks anyway the key read from the data file. The queries, the scan and the
+    //   cache warm-up read the keys from the data files, so they are slower. It is taken into account at the opening of the datastore.
+    bool keyDirFingerprintMode = false;
+    //   'memoryHugePages' backs the KeyDir, the index map and the value cache with huge pages, which reduces the TLB misses of their
+    //   random accesses on big datasets. On Linux, transparent huge pages are requested (they shall be enabled in 'madvise' or 'always'
+    //   mode). On Windows, only the hash tables use large pages, and only if the process holds the 'SeLockMemoryPrivilege'.
+    bool memoryHugePages = false;
+    //   'memoryNumaPolicy' defines the NUMA placement of the same memory on multi-socket machines (Linux only, see NumaPolicy definition).
+    //   Both are taken into account at the opening of the datastore, for the memory touched afterwards.
+    NumaPolicy memoryNumaPolicy = NumaPolicy::Default;
+    //   'latencyInstrumentation' enables the latency histograms of the API calls, of the lock waiting times and of some internal
+    //   operations (see 'getLatencyStats'). Each measure costs two clock reads and an update of a per-thread histogram, which are
+    //   merged only at reading time. It is taken into account immediately.
+    bool latencyInstrumentation = false;
+
+    // Value compression
+    // =================
+
+    //   'valueCompression' enables the compression of the written values, which reduces both the disk accesses and the memory used
+    //   by the value cache, at the price of some CPU at writing and reading. A value is stored compressed only if it is at least
+    //   'valueCompressionMinBytes' long and if the compression saves some space. It applies to the newly written values only.
+    bool valueCompression = false;
+    //   'valueCompressionMinBytes' defines the minimum byte size of a value to compress (at least 8).
+    uint32_t valueCompressionMinBytes = 64;
+
+    // Large values
+    // ============
+
+    //   'blobMinBytes' defines the byte size from which a value is stored in its own blob file instead of the data files (at least 4096,
+    //   zero disables it). The blob files are written and read with direct I/O, and the data file entry and the value cache hold only a
+    //   small reference to them, so that the big values neither delay the small writes, nor evict the small values from the OS and value
+    //   caches, nor are copied by the merge. The blob file of an obsolete value is removed by the merge of the data file referencing it.
+    //   It applies to the newly written values only.
+    uint32_t blobMinBytes = 0;
+
+    // Change log
+    // ==========
+
+    //   'changeLogRetainedDataFileQty' defines the quantity of the most recent data files written by the writers which are never
+    //   merged, so that a change log reader lagging by fewer data files does not miss records (see 'Datastore::readChangeLog').
+    uint32_t changeLogRetainedDataFileQty = 0;
+
+    // Durability
+    // ==========
+
+    //   'syncPolicy' defines when the written data are synchronized on the disk at OS level (see SyncPolicy definition).
+    //   A stronger policy protects against data loss in case of machine crash, at the price of a lower write throughput.
+    SyncPolicy syncPolicy = SyncPolicy::None;
+    //   'syncPeriodMs' defines the period of the OS level synchronization, in milliseconds, for the 'Periodic' policy.
+    uint32_t syncPeriodMs = 1000;
+    //   'syncBytes' defines the quantity of written bytes which triggers an OS level synchronization, for the 'ByteThreshold' policy.
+    uint32_t syncBytes = 10'000'000;
 
     // Merge Triggers
     // ==============
@@ -294,6 +527,15 @@ struct Config {
     //   'mergeSelectDataFileSmallSizeTheshold' describes the minimum size below which a file is included in the merge.
     //   The purpose is to reduce the quantity of small data files to keep open file quantity low.
     uint32_t mergeSelectDataFileSmallSizeTheshold = 10'000'000;
+
+    // Merge execution
+    // ===============
+
+    //   'mergeWorkerQty' defines the quantity of threads compacting the selected data files in parallel (1 to 16).
+    uint32_t mergeWorkerQty = 2;
+    //   'mergeMaxBytesPerSec' limits the disk bandwidth of the merge, in bytes per second, while the foreground reads access the disk.
+    //   The merge runs at full speed when no read hits the disk. Zero means no limit.
+    uint32_t mergeMaxBytesPerSec = 0;
 };
 
 enum class LogLevel { Debug = 0, Info = 1, Warn = 2, Error = 3, Fatal = 4, None = 5 };
@@ -314,6 +556,41 @@ struct QueryResult {
     uint16_t size;
 };
 
+// This structure is the continuation state of a paginated query (see 'Datastore::forEachMatch').
+// The matches are provided by increasing key hash, so a cursor stays valid across modifications of the datastore.
+struct QueryCursor {
+    uint64_t nextHash = 0;  // Next key hash to process. Zero starts the query
+    bool     isEnd() const { return nextHash > UINT32_MAX; }
+};
+
+// This structure describes an entry provided by the full-keyspace scan (see 'Datastore::scan')
+struct ScanEntry {
+    lcVector<uint8_t>  key;
+    lcVector<KeyIndex> keyIndexes;
+    uint32_t           expTimeSec = 0;  // Unix timestamp of the expiration in second, or 0 if the entry has no TTL
+    lcVector<uint8_t>  value;           // Empty if the values are not requested
+};
+
+// Reading position in the change log (see 'Datastore::readChangeLog'). A default cursor starts at the oldest available record
+struct ChangeLogCursor {
+    uint64_t           nextDataFileNumber = 0;  // The data files below this number are read, except the partially read ones
+    lcVector<uint64_t> partialSequences;        // Sequence numbers of the next records to read in the partially read data files
+};
+
+// This structure describes a committed put or removal provided by the change log (see 'Datastore::readChangeLog').
+// The key and the value are in their stored form, and shall be provided as is to 'Datastore::applyReplicated'
+struct ChangeRecord {
+    uint64_t           sequence   = 0;  // Stable position of the record: (data file number << 32) | offset in the data file
+    uint64_t           keyHash    = 0;
+    uint32_t           expTimeSec = 0;  // Unix timestamp of the expiration in second, or 0 if the entry has no TTL
+    uint32_t           checksum   = 0;
+    uint8_t            flags      = 0;  // Internal storage flags (compressed value...)
+    bool               isRemoval  = false;
+    lcVector<uint8_t>  key;
+    lcVector<KeyIndex> keyIndexes;
+    lcVector<uint8_t>  value;  // Possibly compressed with the value codec
+};
+
 // ==========================================================================================
 // Arena allocator
 // ==========================================================================================
@@ -375,6 +652,13 @@ class ArenaAllocator
     const size_t       _minAllocChunkBytes = 0;
 };
 
+// Read-only memory mapping of a full file (internal usage)
+struct MappedFile {
+    const uint8_t* data      = nullptr;
+    size_t         size      = 0;
+    void*          mapHandle = nullptr;  // Windows only
+};
+
 namespace  // Local functions namespace
 {
 
@@ -384,7 +668,7 @@ namespace  // Local functions namespace
 
 // OS common
 
-enum class OsOpenMode { READ, APPEND };
+enum class OsOpenMode { READ, APPEND, WRITE };
 
 struct DirEntry {
     lcString name;
@@ -427,6 +711,19 @@ osRemoveFile(const fs::path& path)
     return fs::remove(path, ec);
 }
 
+// Hard links the file, or copies it if the link is not possible (different file systems, or no support). Returns false on failure
+inline bool
+osLinkOrCopyFile(const fs::path& from, const fs::path& to, bool& wasCopied)
+{
+    std::error_code ec;
+    wasCopied = false;
+    fs::create_hard_link(from, to, ec);
+    if (!ec) { return true; }
+    wasCopied = true;
+    ec.clear();
+    return fs::copy_file(from, to, ec) && !ec;
+}
+
 #if defined(_MSC_VER)
 // Windows
 using lcOsFileHandle                   = HANDLE;
@@ -517,6 +814,9 @@ osOsOpen(const fs::path& path, OsOpenMode mode)
     } else if (mode == OsOpenMode::APPEND) {
         return CreateFileW((LPCWSTR)utf8ToUtf16(path.string()).c_str(), FILE_APPEND_DATA | GENERIC_READ, FILE_SHARE_READ, NULL,
                            CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_RANDOM_ACCESS, NULL);
+    } else if (mode == OsOpenMode::WRITE) {
+        return CreateFileW((LPCWSTR)utf8ToUtf16(path.string()).c_str(), GENERIC_WRITE, FILE_SHARE_READ, NULL, CREATE_ALWAYS,
+                           FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, NULL);
     }
     return InvalidFileHandle;
 }
@@ -532,6 +832,14 @@ osOsRead(lcOsFileHandle handle, void* buffer, size_t bufferSize, uint32_t fileOf
     return status;
 }
 
+// Reads two consecutive chunks of the file in two different buffers
+inline bool
+osOsRead2(lcOsFileHandle handle, void* buffer1, size_t buffer1Size, void* buffer2, size_t buffer2Size, uint32_t fileOffset)
+{
+    return osOsRead(handle, buffer1, buffer1Size, fileOffset) &&
+           (buffer2Size == 0 || osOsRead(handle, buffer2, buffer2Size, fileOffset + (uint32_t)buffer1Size));
+}
+
 inline bool
 osOsWrite(lcOsFileHandle handle, const void* buffer, size_t bufferSize)
 {
@@ -544,6 +852,33 @@ osOsWrite(lcOsFileHandle handle, const void* buffer, size_t bufferSize)
     return status;
 }
 
+inline bool
+osOsSync(lcOsFileHandle handle)
+{
+    return FlushFileBuffers(handle);
+}
+
+// Flushes the stream buffer and writes the OS cache of the file on the disk
+inline bool
+osFileSync(FILE* fh)
+{
+    return (fflush(fh) == 0 && FlushFileBuffers((HANDLE)_get_osfhandle(_fileno(fh))));
+}
+
+// NTFS journals its metadata, so the directory entries of the created and renamed files do not require an explicit flush
+inline bool
+osSyncDirectory(const fs::path& /*path*/)
+{
+    return true;
+}
+
+// Copies a file range at the current position of the destination file inside the kernel. Returns the quantity of copied bytes
+inline size_t
+osCopyFileRange(lcOsFileHandle /*srcHandle*/, uint32_t /*srcFileOffset*/, lcOsFileHandle /*dstHandle*/, size_t /*size*/)
+{
+    return 0;  // Not supported
+}
+
 inline void
 osOsClose(lcOsFileHandle handle)
 {
@@ -556,6 +891,82 @@ osIsValidHandle(lcOsFileHandle handle)
     return (handle != InvalidFileHandle);
 }
 
+inline bool
+osMapFile(const fs::path& path, MappedFile& mappedFile)
+{
+    int64_t fileSize = osGetFileSize(path);
+    if (fileSize <= 0) { return false; }
+    HANDLE fh = CreateFileW((LPCWSTR)utf8ToUtf16(path.string()).c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING,
+                            FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+    if (fh == INVALID_HANDLE_VALUE) { return false; }
+    HANDLE mh = CreateFileMappingW(fh, NULL, PAGE_READONLY, 0, 0, NULL);
+    CloseHandle(fh);  // The mapping keeps a reference on the file
+    if (mh == NULL) { return false; }
+    void* ptr = MapViewOfFile(mh, FILE_MAP_READ, 0, 0, 0);
+    if (ptr == NULL) {
+        CloseHandle(mh);
+        return false;
+    }
+    mappedFile = {(const uint8_t*)ptr, (size_t)fileSize, mh};
+    return true;
+}
+
+inline void
+osUnmapFile(MappedFile& mappedFile)
+{
+    if (mappedFile.data) {
+        UnmapViewOfFile(mappedFile.data);
+        CloseHandle(mappedFile.mapHandle);
+    }
+    mappedFile = {};
+}
+
+// For the blob files, accessed without the OS cache. The buffers, sizes and offsets shall be aligned on the sector size
+inline lcOsFileHandle
+osBlobOpen(const fs::path& path, OsOpenMode mode)
+{
+    if (mode == OsOpenMode::READ) {
+        return CreateFileW((LPCWSTR)utf8ToUtf16(path.string()).c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_DELETE, NULL,
+                           OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_NO_BUFFERING, NULL);
+    }
+    return CreateFileW((LPCWSTR)utf8ToUtf16(path.string()).c_str(), GENERIC_WRITE, FILE_SHARE_READ, NULL, CREATE_ALWAYS,
+                       FILE_ATTRIBUTE_NORMAL | FILE_FLAG_NO_BUFFERING, NULL);
+}
+
+inline bool
+osBlobWrite(lcOsFileHandle handle, const void* buffer, size_t bufferSize, uint64_t fileOffset)
+{
+    DWORD      writtenBytes = 0;
+    OVERLAPPED overlap      = {0};
+    overlap.Offset          = (DWORD)fileOffset;
+    overlap.OffsetHigh      = (DWORD)(fileOffset >> 32);
+    bool status             = WriteFile(handle, buffer, (DWORD)bufferSize, &writtenBytes, &overlap);
+    if (!status && GetLastError() == ERROR_IO_PENDING) { status = GetOverlappedResult(handle, &overlap, &writtenBytes, TRUE); }
+    return status && writtenBytes == bufferSize;
+}
+
+// Returns the quantity of read bytes, which is lower than the requested one at the end of the file, or -1 in case of error
+inline int64_t
+osBlobRead(lcOsFileHandle handle, void* buffer, size_t bufferSize, uint64_t fileOffset)
+{
+    DWORD      readBytes = 0;
+    OVERLAPPED overlap   = {0};
+    overlap.Offset       = (DWORD)fileOffset;
+    overlap.OffsetHigh   = (DWORD)(fileOffset >> 32);
+    bool status          = ReadFile(handle, buffer, (DWORD)bufferSize, &readBytes, &overlap);
+    if (!status && GetLastError() == ERROR_IO_PENDING) { status = GetOverlappedResult(handle, &overlap, &readBytes, TRUE); }
+    if (!status && GetLastError() != ERROR_HANDLE_EOF) { return -1; }
+    return (int64_t)readBytes;
+}
+
+inline bool
+osBlobTruncate(lcOsFileHandle handle, uint64_t fileSize)
+{
+    FILE_END_OF_FILE_INFO info;
+    info.EndOfFile.QuadPart = (LONGLONG)fileSize;
+    return SetFileInformationByHandle(handle, FileEndOfFileInfo, &info, sizeof(info));
+}
+
 #else
 // Linux
 using lcOsFileHandle                       = int;
@@ -576,6 +987,8 @@ osOsOpen(const lcString& path, OsOpenMode mode)
         return ::open(path.c_str(), O_RDONLY);
     } else if (mode == OsOpenMode::APPEND) {
         return ::open(path.c_str(), O_RDWR | O_APPEND | O_TRUNC | O_CREAT, S_IRUSR | S_IWUSR);
+    } else if (mode == OsOpenMode::WRITE) {
+        return ::open(path.c_str(), O_WRONLY | O_TRUNC | O_CREAT, S_IRUSR | S_IWUSR);
     }
     return InvalidFileHandle;
 }
@@ -586,12 +999,59 @@ osOsRead(lcOsFileHandle handle, void* buffer, size_t bufferSize, uint32_t fileOf
     return (pread(handle, buffer, bufferSize, fileOffset) == (ssize_t)bufferSize);
 }
 
+// Reads two consecutive chunks of the file in two different buffers, with a single system call
+inline bool
+osOsRead2(lcOsFileHandle handle, void* buffer1, size_t buffer1Size, void* buffer2, size_t buffer2Size, uint32_t fileOffset)
+{
+    struct iovec iov[2] = {{buffer1, buffer1Size}, {buffer2, buffer2Size}};
+    return (preadv(handle, iov, 2, fileOffset) == (ssize_t)(buffer1Size + buffer2Size));
+}
+
 inline bool
 osOsWrite(lcOsFileHandle handle, const void* buffer, size_t bufferSize)
 {
     return (write(handle, buffer, bufferSize) == (ssize_t)bufferSize);
 }
 
+// Writes the OS cache of the file on the disk. Metadata are not synced, except the file size
+inline bool
+osOsSync(lcOsFileHandle handle)
+{
+    return (fdatasync(handle) == 0);
+}
+
+// Flushes the stream buffer and writes the OS cache of the file on the disk
+inline bool
+osFileSync(FILE* fh)
+{
+    return (fflush(fh) == 0 && fdatasync(fileno(fh)) == 0);
+}
+
+// Writes the directory entries on the disk, so that the created and renamed files survive a power loss
+inline bool
+osSyncDirectory(const fs::path& path)
+{
+    int fd = ::open(path.string().c_str(), O_RDONLY | O_DIRECTORY);
+    if (fd < 0) { return false; }
+    bool isOk = (fsync(fd) == 0);
+    ::close(fd);
+    return isOk;
+}
+
+// Copies a file range at the current position of the destination file inside the kernel. Returns the quantity of copied bytes
+inline size_t
+osCopyFileRange(lcOsFileHandle srcHandle, uint32_t srcFileOffset, lcOsFileHandle dstHandle, size_t size)
+{
+    loff_t srcOffset   = srcFileOffset;
+    size_t copiedBytes = 0;
+    while (copiedBytes < size) {
+        ssize_t bytes = copy_file_range(srcHandle, &srcOffset, dstHandle, nullptr, size - copiedBytes, 0);
+        if (bytes <= 0) { break; }  // Unsupported or failed: the caller completes the copy
+        copiedBytes += (size_t)bytes;
+    }
+    return copiedBytes;
+}
+
 inline void
 osOsClose(lcOsFileHandle handle)
 {
@@ -604,6 +1064,69 @@ osIsValidHandle(lcOsFileHandle handle)
     return (handle > InvalidFileHandle);
 }
 
+inline bool
+osMapFile(const fs::path& path, MappedFile& mappedFile)
+{
+    int64_t fileSize = osGetFileSize(path);
+    if (fileSize <= 0) { return false; }
+    int fd = open(path.string().c_str(), O_RDONLY);
+    if (fd < 0) { return false; }
+    void* ptr = mmap(nullptr, (size_t)fileSize, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);  // The mapping keeps a reference on the file
+    if (ptr == MAP_FAILED) { return false; }
+    madvise(ptr, (size_t)fileSize, MADV_SEQUENTIAL);
+    mappedFile = {(const uint8_t*)ptr, (size_t)fileSize, nullptr};
+    return true;
+}
+
+inline void
+osUnmapFile(MappedFile& mappedFile)
+{
+    if (mappedFile.data) { munmap((void*)mappedFile.data, mappedFile.size); }
+    mappedFile = {};
+}
+
+// For the blob files, accessed without the OS cache. The buffers, sizes and offsets shall be aligned on the logical block size.
+// File systems without direct I/O support (tmpfs...) refuse it at opening or at the first access: buffered accesses are used instead
+inline lcOsFileHandle
+osBlobOpen(const lcString& path, OsOpenMode mode)
+{
+    int flags = (mode == OsOpenMode::READ) ? O_RDONLY : (O_WRONLY | O_TRUNC | O_CREAT);
+    int fd    = ::open(path.c_str(), flags | O_DIRECT, S_IRUSR | S_IWUSR);
+    if (fd < 0 && errno == EINVAL) { fd = ::open(path.c_str(), flags, S_IRUSR | S_IWUSR); }
+    return fd;
+}
+
+inline bool
+osBlobDisableDirectIo(lcOsFileHandle handle)
+{
+    int flags = fcntl(handle, F_GETFL);
+    return (flags >= 0 && (flags & O_DIRECT) && fcntl(handle, F_SETFL, flags & ~O_DIRECT) == 0);
+}
+
+inline bool
+osBlobWrite(lcOsFileHandle handle, const void* buffer, size_t bufferSize, uint64_t fileOffset)
+{
+    ssize_t bytes = pwrite(handle, buffer, bufferSize, (off_t)fileOffset);
+    if (bytes < 0 && errno == EINVAL && osBlobDisableDirectIo(handle)) { bytes = pwrite(handle, buffer, bufferSize, (off_t)fileOffset); }
+    return (bytes == (ssize_t)bufferSize);
+}
+
+// Returns the quantity of read bytes, which is lower than the requested one at the end of the file, or -1 in case of error
+inline int64_t
+osBlobRead(lcOsFileHandle handle, void* buffer, size_t bufferSize, uint64_t fileOffset)
+{
+    ssize_t bytes = pread(handle, buffer, bufferSize, (off_t)fileOffset);
+    if (bytes < 0 && errno == EINVAL && osBlobDisableDirectIo(handle)) { bytes = pread(handle, buffer, bufferSize, (off_t)fileOffset); }
+    return (int64_t)bytes;
+}
+
+inline bool
+osBlobTruncate(lcOsFileHandle handle, uint64_t fileSize)
+{
+    return (ftruncate(handle, (off_t)fileSize) == 0);
+}
+
 #endif
 
 // ==========================================================================================
@@ -726,34 +1249,109 @@ constexpr const char HintFileSuffix[]     = ".litecask_hint";
 constexpr const char TmpFileSuffix[]      = ".tmp";
 constexpr const char LogFileSuffix[]      = ".log";
 constexpr const char ToRemoveFileSuffix[] = ".litecask_to_remove";
+constexpr const char BlobFileSuffix[]     = ".litecask_blob";
+constexpr const char CacheWarmUpFilename[] = "litecask.cache_warmup";
 constexpr uint32_t   DiskWorkBufferSize   = 10'000'000;
 constexpr uint32_t   MinDataFileMaxBytes  = 1024;
 constexpr uint64_t   CpuCacheLine         = 2 * 64;  // Destructive interferences is 2 cache lines
 constexpr uint32_t   DeletedEntry         = 0xFFFFFFFF;
 constexpr ValueLoc   NotStored            = 0xFFFFFFFF;  // Sentinel for "not stored"
+constexpr uint8_t    EntryFlagCompressed  = 0x01;        // The stored value is its raw 32-bit size followed by the compressed bytes
+constexpr uint8_t    EntryFlagBlob        = 0x02;        // The stored value is a BlobRef, the value itself is in its own blob file
 constexpr size_t     MaxValueSize         = 0xFFFF0000;
 
 // KeyDir table associativity. 1 is classical (1-associative), 8 is max for the cache line (8-associative so 8*8=64 bytes)
 // Power of two is expected to keep the cache line alignment, so valid values are 1, 2, 4 and 8
 constexpr uint32_t KeyDirAssocQty = 8;
 
+// The KeyDir is split in independently locked shards, selected by the high bits of the key hash (the low bits select the table cell)
+constexpr uint32_t KeyDirShardBits = 4;
+constexpr uint32_t KeyDirShardQty  = (1U << KeyDirShardBits);
+
+// Buckets of each level of the TTL expiry wheel of each KeyDir shard: one per second of the current round for the first level, one
+// per later round for the second level. Only the TTLs beyond the second level (about 12 days) stay in their bucket for several rounds
+constexpr uint32_t ExpiryWheelBucketQty = 1024;
+
 // Arbitrary constant value. On a range of first 256 bytes of a key, 64 indexes should be enough for everyone
 constexpr uint32_t MaxKeyIndexQty = 64;
 
+// Key indexes of the entries which have none (removals). It is a valid address, so that no null pointer reaches 'memcpy'
+inline constexpr KeyIndex NoKeyIndex = {0, 0};
+
+// Multi-get disk reads: entries of the same data file closer than the gap limit are read together, up to the size limit.
+// Parallel reads, on threads kept by the datastore, are used only when the disk reads are numerous enough to amortize the wake-ups.
+constexpr uint32_t GetBatchMaxReadGapBytes = 4096;
+constexpr uint32_t GetBatchMaxReadBytes    = 1024 * 1024;
+constexpr uint32_t GetBatchMaxReadThreads  = 4;
+constexpr uint32_t GetBatchReadsPerThread  = 8;
+
+// Maximum quantity of keys waiting for the background prefetch. The keys of the next requests are dropped
+constexpr uint32_t PrefetchMaxPendingKeyQty = 100'000;
+
+// Maximum quantity of threads parsing the hint and data files when opening a datastore
+constexpr uint32_t MaxLoadWorkerQty = 8;
+
+// Merge: the live entries are copied by chunks, which is also the granularity of the throttling.
+// Without foreground disk read during the idle delay, the throttling is not applied
+constexpr uint32_t MaxMergeWorkerQty    = 16;
+constexpr uint32_t MergeCopyChunkBytes  = 1024 * 1024;
+constexpr uint32_t MergeHintBufferBytes = 256 * 1024;
+constexpr uint32_t MergeThrottleIdleMs  = 100;
+
+// Period of the progress notifications of the offline verification and compaction
+constexpr uint32_t OfflineProgressPeriodMs = 200;
+
+// Depth of the asynchronous read queue (io_uring backend). Above this quantity of in-flight reads, the submissions wait
+constexpr uint32_t AsyncReadQueueDepth = 256;
+
+// Blob files: the direct I/O accesses are performed by chunks through an aligned per-thread buffer
+constexpr size_t BlobIoAlignment  = 4096;
+constexpr size_t BlobIoChunkBytes = 1024 * 1024;
+
 // Default write buffer byte size
 // In practice, its value does not matter much as long as it can amortize the calls to kernel in a reasonable factor
 constexpr uint32_t DefaultWriteBufferBytes = 100'000;
+constexpr uint32_t MaxWriteLaneQty         = 16;
+
+// The hint records of the active data file are appended in memory and written by chunks of this size in the temporary hint file
+constexpr uint32_t ActiveHintBufferBytes = 64 * 1024;
 
 // Big allocation of virtual memory. Physical memory will be 'committed' by the OS depending on the real need.
 // Such automatically extended memory chunk provides a common base address and enables 32-bit pointer compression on 64-bit arch.
 // A 32-bit compressed pointer is simply the delta between the memory pointer and the common base pointer, shifted by 3 bits as
 // a 8 bytes alignement is enforced. As such, the total addressable memory range is 35 bits = 32 GB.
+// The KeyDir budget is split evenly between its shards, each with its own key storage: a shard is full (OutOfMemory on insertion)
+// at 1/KeyDirShardQty of this budget. The key hashes spread the keys evenly, so the shards fill at the same pace
 constexpr uint64_t KeyStorageAllocBytes = (uint64_t)16384 * 1024 * 1024;  // Yes, huge allocation but mostly virtual memory
 
+// Frequency sketch of the value cache admission filter: one 4-bit counter per row for each 64 bytes of cache
+constexpr uint64_t AdmissionSketchBytesPerCounter = 64;
+constexpr uint32_t AdmissionSketchMinCounterQty   = 1024;
+constexpr uint32_t AdmissionSketchMaxCounterQty   = 4 * 1024 * 1024;
+
 constexpr uint32_t ValueFlagQueueTypeMask = 0x3;   // 2 bits for queue types
 constexpr uint32_t ValueFlagActive        = 0x4;   // Bit set when the cache value is accessed. Used by deferred bumping LRU mechanism
 constexpr uint32_t ValueMutexQty          = 1024;  // "Bucketized" cache lock
 
+// On-file hint header: 16 bytes
+// Totals of the hint file, used to size the KeyDir and the index map once at load time.
+// Hint files from previous versions have no header: their first entry has a null file offset, which cannot match the magic value
+constexpr uint32_t HintFileMagic = 0x484B434C;  // "LCKH"
+struct HintFileHeader {
+    uint32_t magic;
+    uint32_t entryQty;
+    uint32_t keyIndexQty;  // Total quantity of key indexes over all entries
+    uint32_t reserved;
+};
+
+// On-file cache warm-up header: 8 bytes
+// The header is followed by the saved keys, each as a 16-bit size and the key bytes, from the most recently used
+constexpr uint32_t CacheWarmUpMagic = 0x574B434C;  // "LCKW"
+struct CacheWarmUpFileHeader {
+    uint32_t magic;
+    uint32_t keyQty;
+};
+
 // On-file hint entry: 16 bytes + index size + key size
 // Structure of an entry in a hint file
 struct HintFileEntry {
@@ -762,7 +1360,7 @@ struct HintFileEntry {
     uint32_t valueSize;
     uint16_t keySize;
     uint8_t  keyIndexSize;  // In bytes
-    uint8_t  reserved;
+    uint8_t  flags;         // Copy of the data file entry flags
     // uint8_t data[0]   The key then the indexes are stored here
 };
 
@@ -774,10 +1372,18 @@ struct DataFileEntry {
     uint32_t valueSize;
     uint16_t keySize;
     uint8_t  keyIndexSize;  // In bytes
-    uint8_t  reserved;
+    uint8_t  flags;         // EntryFlagXXX. Zero in the files of previous versions
     // uint8_t data[0]   The key, the indexes, then the value are stored here
 };
 
+// On-file blob reference: 16 bytes
+// Stored as the value of a data file entry with the EntryFlagBlob flag. The blob file contains only the value
+struct BlobRef {
+    uint64_t blobId;     // The blob filename is this identifier in hexadecimal
+    uint32_t valueSize;  // Byte size of the blob file
+    uint32_t checksum;   // LITECASK_HASH_FUNC low 32 bits of the value
+};
+
 // In-memory KeyDir entry: it is composed of 2 parts
 // 1) First part is inside the hashtable and points on the key location and its metadata (8 bytes)
 struct MapEntry {
@@ -785,16 +1391,17 @@ struct MapEntry {
     KeyLoc   loc;
 };
 
-// 2) Second part is the metadata pointed by the first part, of 22 bytes + key size
+// 2) Second part is the metadata pointed by the first part, of 23 bytes + key size
 struct KeyChunk {
     uint32_t expTimeSec;
-    uint32_t valueSize;  // max key+value size is 4GB
+    uint32_t valueSize;  // max key+value size is 4GB. Stored size, so compressed if the value is compressed
     ValueLoc cacheLocation;
     uint32_t fileOffset;  // max data file size is 4 GB
     uint16_t fileId;
     uint16_t keySize;
     uint8_t  keyIndexSize;
     uint8_t  changeCounter;  // incremented at each update, to prevents ABA problems
+    uint8_t  flags;          // Data file entry flags
     // uint8_t  data[0]   The key then the indexes are stored here
 };
 
@@ -830,18 +1437,95 @@ struct KeyDirPatch {
 struct MergeFileInfo {
     uint16_t              fileId;
     lcVector<KeyDirPatch> patches;
+    lcVector<uint64_t>    obsoleteBlobIds;  // Blob files referenced only by the dropped entries
+    bool                  isFailed = false;  // The data file could not be read: it is kept untouched
+};
+
+struct DataFile;
+
+// Compacted data file under writing by a merge worker
+struct MergeOutput {
+    DataFile*      dataFile        = nullptr;
+    uint16_t       dataFileId      = 0xFFFF;
+    lcOsFileHandle dataHandle      = InvalidFileHandle;
+    FILE*          hintFh          = nullptr;
+    uint32_t       writeFileOffset = 0;
+    uint32_t       hintEntryQty    = 0;
+    uint32_t       hintKeyIndexQty = 0;
+};
+
+// Offline maintenance: a verified entry inside a mapped data file
+struct OfflineEntry {
+    const uint8_t* entry;  // Start of the DataFileEntry header in the mapping (not aligned)
+    uint64_t       keyHash;
+    uint32_t       fileIdx;  // Order of the data file: the newest entries win
+    uint32_t       entryBytes;
+    uint32_t       expTimeSec;
+    uint16_t       keySize;
+    uint8_t        flags;
+    bool           isRemoval;
+};
+
+struct OfflineFile {
+    MappedFile             mapping;
+    lcVector<OfflineEntry> entries;  // Collected only for the compaction
+    OfflineReport          report;
+};
+
+// Limits the disk bandwidth of the merge workers while the foreground reads access the disk
+class MergeThrottle
+{
+   public:
+    // To call before the merge workers start
+    void reset(uint32_t maxBytesPerSec)
+    {
+        std::lock_guard<std::mutex> lk(_mx);
+        _maxBytesPerSec = maxBytesPerSec;
+        _nextTimeNs     = 0;
+    }
+
+    // Waits until the bytes can be transferred. Returns true if the caller was delayed
+    bool consume(uint32_t bytes, uint64_t foregroundDiskReadQty)
+    {
+        if (_maxBytesPerSec == 0) { return false; }
+        int64_t nowNs = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+        int64_t waitNs = 0;
+        {
+            std::lock_guard<std::mutex> lk(_mx);
+            if (foregroundDiskReadQty != _lastForegroundDiskReadQty) {
+                _lastForegroundDiskReadQty = foregroundDiskReadQty;
+                _lastForegroundReadTimeNs  = nowNs;
+            }
+            if (nowNs - _lastForegroundReadTimeNs > (int64_t)MergeThrottleIdleMs * 1'000'000) {
+                _nextTimeNs = nowNs;  // Idle disk: full speed
+                return false;
+            }
+            _nextTimeNs = std::max(_nextTimeNs, nowNs) + (int64_t)bytes * 1'000'000'000 / (int64_t)_maxBytesPerSec;
+            waitNs      = _nextTimeNs - nowNs;
+        }
+        std::this_thread::sleep_for(std::chrono::nanoseconds(waitNs));
+        return true;
+    }
+
+   private:
+    std::mutex _mx;
+    uint32_t   _maxBytesPerSec            = 0;
+    int64_t    _nextTimeNs                = 0;
+    int64_t    _lastForegroundReadTimeNs  = INT64_MIN / 2;
+    uint64_t   _lastForegroundDiskReadQty = 0;
 };
 
 // In-memory DataFile: information and statistics for a data file
 struct DataFile {
     lcString              filename;
-    lcOsFileHandle        handle      = InvalidFileHandle;
-    std::atomic<uint32_t> bytes       = 0;
-    std::atomic<uint32_t> entries     = 0;
-    std::atomic<uint32_t> tombBytes   = 0;
-    std::atomic<uint32_t> tombEntries = 0;
-    std::atomic<uint32_t> deadBytes   = 0;
-    std::atomic<uint32_t> deadEntries = 0;
+    lcOsFileHandle        handle       = InvalidFileHandle;
+    std::atomic<uint32_t> bytes        = 0;
+    std::atomic<uint32_t> entries      = 0;
+    std::atomic<uint32_t> tombBytes    = 0;
+    std::atomic<uint32_t> tombEntries  = 0;
+    std::atomic<uint32_t> deadBytes    = 0;
+    std::atomic<uint32_t> deadEntries  = 0;
+    std::atomic<uint32_t> pinQty       = 0;  // Uses of the handle outside the data file lock (asynchronous reads, syncs...)
 
     void dump(int index, bool isActive = false) const
     {
@@ -865,3787 +1549,8501 @@ struct DataFile {
 };
 
 // ==========================================================================================
-// Wyhash https://github.com/wangyi-fudan/wyhash/tree/master (18a25157b modified)
-// This is free and unencumbered software released into the public domain under The Unlicense
-// (http://unlicense.org/)
+// Persistent threads for the parallel disk reads
 // ==========================================================================================
 
-static inline void
-_wymum(uint64_t* A, uint64_t* B)
-{
-#if defined(_MSC_VER)
-    *A = _umul128(*A, *B, B);
-#else
-    __uint128_t r = *A;
-    r *= *B;
-    *A = (uint64_t)r;
-    *B = (uint64_t)(r >> 64);
-#endif
-}
-
-static inline uint64_t
-_wymix(uint64_t A, uint64_t B)
-{
-    _wymum(&A, &B);
-    return A ^ B;
-}
-static inline uint64_t
-_wyr8(const uint8_t* p)
-{
-    uint64_t v;  // NOLINT(cppcoreguidelines-init-variables)
-    memcpy(&v, p, 8);
-    return v;
-}
-static inline uint64_t
-_wyr4(const uint8_t* p)
-{
-    uint32_t v;  // NOLINT(cppcoreguidelines-init-variables)
-    memcpy(&v, p, 4);
-    return v;
-}
-static inline uint64_t
-_wyr3(const uint8_t* p, size_t k)
+// Threads helping the caller of a parallel job, so that no thread is launched per call.
+// One job is run at a time: a concurrent caller runs its job alone, without helpers.
+// The job shall share its work between the calls itself, and a late helper may find nothing left to do
+class ReadThreadPool
 {
-    return (((uint64_t)p[0]) << 16) | (((uint64_t)p[k >> 1]) << 8) | p[k - 1];
-}
+   public:
+    ~ReadThreadPool() { stop(); }
 
-static inline uint64_t
-wyhash(const void* key, size_t len)
-{
-    constexpr uint64_t secret0 = 0x2d358dccaa6c78a5ull;
-    constexpr uint64_t secret1 = 0x8bb84b93962eacc9ull;
-    constexpr uint64_t secret2 = 0x4b33a62ed433d4a3ull;
-    constexpr uint64_t secret3 = 0x4d5a2da51de1aa47ull;
-    const uint8_t*     p       = (const uint8_t*)key;
-    uint64_t           seed    = 0xca813bf4c7abf0a9ull;  // seed ^= _wymix(seed ^ secret0, secret1);  with fixed seed = 0
-    uint64_t           a = 0, b = 0;
+    void start(uint32_t threadQty)
+    {
+        std::lock_guard<std::mutex> lk(_mx);
+        if (!_threads.empty()) { return; }
+        _isExit = false;
+        for (uint32_t i = 0; i < threadQty; ++i) { _threads.emplace_back(&ReadThreadPool::threadEntry, this); }
+    }
 
-    if (LITECASK_LIKELY(len <= 16)) {
-        if (LITECASK_LIKELY(len >= 4)) {
-            a = (_wyr4(p) << 32) | _wyr4(p + ((len >> 3) << 2));
-            b = (_wyr4(p + len - 4) << 32) | _wyr4(p + len - 4 - ((len >> 3) << 2));
-        } else if (LITECASK_LIKELY(len > 0)) {
-            a = _wyr3(p, len);
-            b = 0;
-        } else {
-            a = b = 0;
+    void stop()
+    {
+        lcVector<std::thread> threads;
+        {
+            std::lock_guard<std::mutex> lk(_mx);
+            _isExit = true;
+            threads.swap(_threads);
+            _workCv.notify_all();
         }
-    } else {
-        size_t i = len;
-        if (LITECASK_UNLIKELY(i >= 48)) {
-            uint64_t see1 = seed, see2 = seed;
-            do {
-                seed = _wymix(_wyr8(p) ^ secret1, _wyr8(p + 8) ^ seed);
-                see1 = _wymix(_wyr8(p + 16) ^ secret2, _wyr8(p + 24) ^ see1);
-                see2 = _wymix(_wyr8(p + 32) ^ secret3, _wyr8(p + 40) ^ see2);
-                p += 48;
-                i -= 48;
-            } while (LITECASK_LIKELY(i >= 48));
-            seed ^= see1 ^ see2;
+        for (std::thread& t : threads) { t.join(); }
+    }
+
+    // Calls 'job' from the calling thread and from up to 'helperQty' pool threads, and returns when all these calls are finished
+    void run(const std::function<void()>& job, uint32_t helperQty)
+    {
+        std::unique_lock<std::mutex> runLk(_runMutex, std::try_to_lock);
+        if (!runLk.owns_lock() || helperQty == 0) {
+            job();
+            return;
         }
-        while (LITECASK_UNLIKELY(i > 16)) {
-            seed = _wymix(_wyr8(p) ^ secret1, _wyr8(p + 8) ^ seed);
-            i -= 16;
-            p += 16;
+        {
+            std::lock_guard<std::mutex> lk(_mx);
+            _job        = &job;
+            _offeredQty = std::min(helperQty, (uint32_t)_threads.size());
+            _workCv.notify_all();
         }
-        a = _wyr8(p + i - 16);
-        b = _wyr8(p + i - 8);
+        job();
+        std::unique_lock<std::mutex> lk(_mx);
+        _offeredQty = 0;  // The helpers which did not start yet are not needed anymore
+        _doneCv.wait(lk, [this] { return _activeQty == 0; });
+        _job = nullptr;
     }
-    a ^= secret1;
-    b ^= seed;
-    _wymum(&a, &b);
-    return _wymix(a ^ secret0 ^ len, b ^ secret1);
-}
 
-#define LITECASK_HASH_FUNC(key, keySize) wyhash(key, keySize)
+   private:
+    void threadEntry()
+    {
+        std::unique_lock<std::mutex> lk(_mx);
+        while (true) {
+            _workCv.wait(lk, [this] { return _isExit || _offeredQty > 0; });
+            if (_isExit) { break; }
+            --_offeredQty;
+            ++_activeQty;
+            const std::function<void()>* job = _job;
+            lk.unlock();
+            (*job)();
+            lk.lock();
+            if (--_activeQty == 0) { _doneCv.notify_one(); }
+        }
+    }
+
+    std::mutex                   _runMutex;  // Serializes the jobs
+    std::mutex                   _mx;
+    std::condition_variable      _workCv;
+    std::condition_variable      _doneCv;
+    const std::function<void()>* _job        = nullptr;
+    uint32_t                     _offeredQty = 0;
+    uint32_t                     _activeQty  = 0;
+    bool                         _isExit     = false;
+    lcVector<std::thread>        _threads;
+};
+
+#if LITECASK_IO_URING_ENABLED
 
 // ==========================================================================================
-// Readers-writer lock
+// Asynchronous disk reads with io_uring
 // ==========================================================================================
 
-#ifdef LITECASK_STANDARD_SHARED_MUTEX
-
-// The standard shared mutex is a risk-less implementation but its performance does not scale well with increasing thread quantity (on Linux
-// at least) probably due to its generic implementation not focussed enough on false sharing across cores and avoiding going to kernel.
-// Measurements show that 100% reading scales poorly and that ~5% write collapses the overall performance.
-// This RWLock is an encapsulation of the standard library and its presence just serves validation and comparison purposes.
-class RWLock
+// The io_uring rings are driven directly with the system calls, so that no external dependency (liburing) is required.
+// Reads are submitted by any thread and their completion handlers are called from a dedicated reaper thread.
+// The quantity of in-flight reads is bounded by the completion queue size, so that no completion can be lost.
+// If the kernel rejects a submission, the reader is not used anymore and the reads fall back to synchronous ones.
+class AsyncReader
 {
    public:
-    RWLock() {}
-    ~RWLock() {}
-
-    void lockRead() { _mx.lock_shared(); }
-    void unlockRead() { _mx.unlock_shared(); }
-    void lockWrite() { _mx.lock(); }
-    void unlockWrite() { _mx.unlock(); }
-
-   private:
-    std::shared_mutex _mx;
-};
-#else
-
-// This custom implementation of shared mutex avoids costly false sharing by having a dedicated cache line per thread to mark its lock
-// request ( more memory is used compared to the standard shared mutex). The cost of the per-reader check is moved on the exclusive lock
-// side, which is fully in agreement with our system where writing operations are serialized and more expensive. Also, lock requests spin
-// before going to the kernel, improving the reactivity in most cases.
-class RWLock
-{
-    // Soft limit on the thread quantity before switching to exclusive lock as a fallback
-    static constexpr uint64_t MaxThreads = 32;
+    struct Request {
+        lcOsFileHandle                     handle     = InvalidFileHandle;
+        uint32_t                           fileOffset = 0;
+        struct iovec                       iov[2];
+        uint32_t                           iovQty         = 1;
+        bool                               isSubmitFailed = false;  // Set before the failed completion of a non-submitted read
+        std::function<void(bool isReadOk)> onCompletion;
+    };
 
-   public:
-    RWLock() : excLockReq(false), stateArraySptr(std::make_shared<StateArray>()), stateArray(*stateArraySptr)
-    {
-        static std::atomic<uint32_t> uniqueIdGenerator = 1;  // Global for all RWLock objects
-        uniqueLockId                                   = uniqueIdGenerator++;
-        (void)reserved;  // For nitty compilers
-    }
+    ~AsyncReader() { stop(); }
 
-    ~RWLock()
-    {
-        for (auto& lock : stateArray) { lock.state = Invalid; }
-    }
+    bool isStarted() const { return _isStarted.load(); }
 
-    void lockWrite()
+    // Returns false if io_uring is not usable (old kernel, disabled by the system...)
+    bool start(uint32_t queueDepth)
     {
-        // Mostly Spin until the writer flag is acquired
-        uint64_t counter  = 0;
-        bool     oldValue = false;
-        while (!excLockReq.compare_exchange_weak(oldValue, true, std::memory_order_seq_cst)) {
-            oldValue = false;
-            if (((++counter) & 0x0FFFFF) == 0) { std::this_thread::yield(); }  // Back to OS scheduler if too long spinning
+        if (_isStarted.load()) { return true; }
+
+        struct io_uring_params params;
+        memset(&params, 0, sizeof(params));
+        int ringFd = (int)syscall(__NR_io_uring_setup, queueDepth, &params);
+        if (ringFd < 0) { return false; }
+        if ((params.features & IORING_FEAT_EXT_ARG) == 0) {
+            ::close(ringFd);  // Kernel older than 5.11: the reaper thread could not wait with a timeout, so could not always be stopped
+            return false;
         }
 
-        // Wait for readers to stop using the shared lock
-        for (auto& i : stateArray) {
-            while (i.state.load(std::memory_order_seq_cst) >= Busy) {}
+        _sqRingBytes      = params.sq_off.array + params.sq_entries * sizeof(uint32_t);
+        _cqRingBytes      = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+        _sqesBytes        = params.sq_entries * sizeof(struct io_uring_sqe);
+        bool isSingleMmap = (params.features & IORING_FEAT_SINGLE_MMAP);
+        if (isSingleMmap) { _sqRingBytes = _cqRingBytes = std::max(_sqRingBytes, _cqRingBytes); }
+
+        _sqRing = mmap(nullptr, _sqRingBytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ringFd, IORING_OFF_SQ_RING);
+        _cqRing = isSingleMmap ? _sqRing
+                               : mmap(nullptr, _cqRingBytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ringFd, IORING_OFF_CQ_RING);
+        _sqes   = mmap(nullptr, _sqesBytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ringFd, IORING_OFF_SQES);
+        _ringFd = ringFd;
+        if (_sqRing == MAP_FAILED || _cqRing == MAP_FAILED || _sqes == MAP_FAILED) {
+            releaseRings();
+            return false;
         }
-    }
 
-    void unlockWrite()
-    {
-        excLockReq.store(false, std::memory_order_release);  // Simply release the writer flag
+        uint8_t* sqRing = (uint8_t*)_sqRing;
+        uint8_t* cqRing = (uint8_t*)_cqRing;
+        _sqHead         = (uint32_t*)(sqRing + params.sq_off.head);
+        _sqTail         = (uint32_t*)(sqRing + params.sq_off.tail);
+        _sqMask         = *(uint32_t*)(sqRing + params.sq_off.ring_mask);
+        _sqArray        = (uint32_t*)(sqRing + params.sq_off.array);
+        _sqEntries      = params.sq_entries;
+        _cqHead         = (uint32_t*)(cqRing + params.cq_off.head);
+        _cqTail         = (uint32_t*)(cqRing + params.cq_off.tail);
+        _cqMask         = *(uint32_t*)(cqRing + params.cq_off.ring_mask);
+        _cqes           = (struct io_uring_cqe*)(cqRing + params.cq_off.cqes);
+        _maxInFlightQty = params.cq_entries;
+        _inFlightQty.store(0);
+        _isBroken = false;
+        _isReaperExit.store(false);
+
+        _isStarted.store(true);
+        _reaperThread = std::thread(&AsyncReader::reaperThreadEntry, this);
+        return true;
     }
 
-    void lockRead()
+    // Waits for the completion of all in-flight reads before stopping
+    void stop()
     {
-        // Get the index of this thread in this lock
-        int threadIndex = accessIndex();
-
-        // Check if the thread has no index yet and there are some potential free index
-        if (threadIndex < 0 && stateArraySptr.use_count() <= (int)stateArray.size()) {
-            for (int idx = 0; idx < (int)stateArray.size(); ++idx) {
-                int oldValue = Uninit;
-                if (stateArray[idx].state == Uninit && stateArray[idx].state.compare_exchange_strong(oldValue, Free)) {
-                    accessIndex(idx);
-                    threadIndex = idx;
-                    break;
-                }
+        {
+            std::lock_guard<std::mutex> lk(_submitMutex);
+            if (!_isStarted.load()) { return; }
+            _isStarted.store(false);
+            waitForInFlightQtyBelow(1);
+
+            // The reaper thread checks the exit flag at least at each wait timeout. A no-op (null user data) wakes it up sooner
+            _isReaperExit.store(true);
+            struct io_uring_sqe* sqe = _isBroken ? nullptr : getNextSqe();
+            if (sqe) {
+                sqe->opcode    = IORING_OP_NOP;
+                sqe->user_data = 0;
+                commitSqes();
             }
         }
+        _reaperThread.join();
+        releaseRings();
+    }
 
-        if (threadIndex >= 0) {
-            // Notify the reader's access
-            stateArray[threadIndex].state.store(Busy, std::memory_order_seq_cst);
-
-            // If a writer has the exclusive lock, then rollback and wait that it finishes
-            while (excLockReq.load(std::memory_order_seq_cst)) {
-                // Rollback the reader's access
-                stateArray[threadIndex].state.store(Free, std::memory_order_seq_cst);
-                // Wait that the writer releases the lock
-                uint64_t counter = 0;
-                while (excLockReq.load(std::memory_order_seq_cst)) {
-                    if (((++counter) & 0x0FFFFF) == 0) { std::this_thread::yield(); }  // Back to OS scheduler if too long spinning
-                }
-                // Notify again the reader's access. If no writer has the lock, it will prevent them to take it.
-                stateArray[threadIndex].state.store(Busy, std::memory_order_seq_cst);
+    // The completion handler of each request is always called, possibly from this call with 'isSubmitFailed' set if the read could not
+    // be submitted (reader stopped or rejected by the kernel). In this case, false is returned and the caller shall fall back to
+    // synchronous reads. The request structures shall stay valid until their completion handler is called
+    bool submit(Request* const* requests, uint32_t requestQty)
+    {
+        std::lock_guard<std::mutex> lk(_submitMutex);
+
+        uint32_t requestIdx = 0;
+        while (requestIdx < requestQty && _isStarted.load() && !_isBroken) {
+            uint32_t sqeQty = 0;
+            while (requestIdx < requestQty && _inFlightQty.load() < _maxInFlightQty) {
+                struct io_uring_sqe* sqe = getNextSqe();
+                if (!sqe) { break; }  // Submission queue is full
+                Request* r     = requests[requestIdx++];
+                sqe->opcode    = IORING_OP_READV;
+                sqe->fd        = r->handle;
+                sqe->addr      = (uint64_t)(uintptr_t)r->iov;
+                sqe->len       = r->iovQty;
+                sqe->off       = r->fileOffset;
+                sqe->user_data = (uint64_t)(uintptr_t)r;
+                ++_inFlightQty;
+                ++sqeQty;
             }
-        } else {
-            // Case more threads than array size: fallback to exclusive lock but without waiting for other readers
-            uint64_t counter  = 0;
-            bool     oldValue = false;
-            while (!excLockReq.compare_exchange_weak(oldValue, true, std::memory_order_seq_cst)) {
-                oldValue = false;
-                if (((++counter) & 0x0FFFFF) == 0) { std::this_thread::yield(); }  // Back to OS scheduler if too long spinning
+            if (sqeQty == 0) {
+                waitForInFlightQtyBelow(_maxInFlightQty);  // Completion queue is full, the reaper thread makes some room
+                continue;
             }
+            commitSqes();
         }
-    }
 
-    void unlockRead()
-    {
-        int threadIndex = accessIndex();
-        if (threadIndex >= 0) {
-            stateArray[threadIndex].state.store(Free, std::memory_order_release);
-        } else {
-            excLockReq.store(false, std::memory_order_release);  // Case more thread than array size: fallback to exclusive lock
-        }
+        if (requestIdx == requestQty && !_isBroken) { return true; }
+        for (; requestIdx < requestQty; ++requestIdx) { completeAsFailed(requests[requestIdx]); }
+        return false;
     }
 
+#ifndef LITECASK_BUILD_FOR_TEST  // Allows looking inside the reader internal, for testing purposes
    private:
-    // Constants
-    static constexpr int Invalid = -1;
-    static constexpr int Uninit  = 0;
-    static constexpr int Free    = 1;
-    static constexpr int Busy    = 2;
+#endif
+    // Blocks until the reaper thread has completed enough reads
+    void waitForInFlightQtyBelow(uint32_t limit)
+    {
+        std::unique_lock<std::mutex> lk(_completionMutex);
+        ++_completionWaiterQty;
+        _completionCv.wait(lk, [this, limit] { return _inFlightQty.load() < limit; });
+        --_completionWaiterQty;
+    }
 
-    // Definitions
-    struct State {
-        alignas(CpuCacheLine) std::atomic<int> state{Uninit};
-    };
-    using StateArray     = std::array<State, MaxThreads>;
-    using StateArraySptr = std::shared_ptr<StateArray>;
+    // Calls the completion handler of a non-submitted request
+    static void completeAsFailed(Request* r)
+    {
+        r->isSubmitFailed                      = true;
+        std::function<void(bool)> onCompletion = std::move(r->onCompletion);
+        onCompletion(false);
+    }
 
-    // Thread local structure bridging between the current thread and all lock instances
-    struct LockContext {
-        LockContext(int index, const StateArraySptr& ptr) : threadIndex(index), stateArraySptr(ptr) {}
-        LockContext(LockContext&& src) noexcept : threadIndex(src.threadIndex), stateArraySptr(std::move(src.stateArraySptr)) {}
-        LockContext& operator=(LockContext&& src) noexcept
-        {
-            if (this == &src) return *this;
-            threadIndex    = src.threadIndex;
-            stateArraySptr = std::move(src.stateArraySptr);
-            return *this;
-        }
-        ~LockContext()
-        {
-            if (stateArraySptr.use_count() > 0) { (*stateArraySptr)[threadIndex].state--; }
+    void notifyCompletionWaiters()
+    {
+        if (_completionWaiterQty.load() != 0) {
+            std::lock_guard<std::mutex> lk(_completionMutex);
+            _completionCv.notify_all();
         }
+    }
 
-        int            threadIndex;
-        StateArraySptr stateArraySptr;
-    };
-
-    int accessIndex(int registrationIndex = -1)
+    // Returns nullptr if the submission queue is full, i.e. its entries are not consumed yet by the kernel.
+    // The submission lock shall be taken
+    struct io_uring_sqe* getNextSqe()
     {
-        // These per-thread lookups are shared by all RWlock instances
-        thread_local static std::vector<LockContext> perLockContext;
-        thread_local static std::vector<uint32_t>    perLockId;  // Cache-friendly to find the associated context
+        uint32_t tail = *_sqTail + _pendingSqeQty;
+        if (tail - __atomic_load_n(_sqHead, __ATOMIC_ACQUIRE) >= _sqEntries) { return nullptr; }
+        uint32_t             idx = tail & _sqMask;
+        struct io_uring_sqe* sqe = &((struct io_uring_sqe*)_sqes)[idx];
+        memset(sqe, 0, sizeof(struct io_uring_sqe));
+        _sqArray[idx] = idx;
+        ++_pendingSqeQty;
+        return sqe;
+    }
+
+    // Submits the pending entries to the kernel. On an unexpected error, the entries not consumed by the kernel are withdrawn and
+    // completed as failed, the reader becomes unusable and false is returned. The submission lock shall be taken
+    bool commitSqes()
+    {
+        __atomic_store_n(_sqTail, *_sqTail + _pendingSqeQty, __ATOMIC_RELEASE);
+        _pendingSqeQty = 0;
+        while (true) {
+            uint32_t head = __atomic_load_n(_sqHead, __ATOMIC_ACQUIRE);
+            if (head == *_sqTail) { return true; }
+            int ret = (int)syscall(__NR_io_uring_enter, _ringFd, *_sqTail - head, 0, 0, nullptr, 0);
+            if (ret > 0) { continue; }
+            if (ret == 0 || errno == EINTR || errno == EAGAIN || errno == EBUSY) {
+                std::this_thread::yield();  // Transient lack of kernel resources
+                continue;
+            }
 
-        // Getter case: return the value from the lookup
-        if (LITECASK_LIKELY(registrationIndex < 0)) {
-            for (size_t i = 0; i < perLockId.size(); ++i) {
-                if (perLockId[i] == uniqueLockId) { return perLockContext[i].threadIndex; }
+            // Without SQ polling, the kernel consumes the entries only inside the call, so the tail can be moved back safely
+            for (uint32_t pos = head; pos != *_sqTail; ++pos) {
+                uint64_t userData = ((struct io_uring_sqe*)_sqes)[_sqArray[pos & _sqMask]].user_data;
+                if (userData == 0) { continue; }  // Exit no-op
+                completeAsFailed((Request*)(uintptr_t)userData);
+                --_inFlightQty;
             }
-            return -1;
+            __atomic_store_n(_sqTail, head, __ATOMIC_RELEASE);
+            _isBroken = true;
+            notifyCompletionWaiters();
+            return false;
         }
+    }
 
-        // Setter case: create a new context in this thread local lookup
-        perLockContext.emplace_back(registrationIndex, stateArraySptr);
-        perLockId.push_back(uniqueLockId);
-
-        // Take the opportunity to clean all deleted lock in this thread (accessible only from this thread...)
-        for (size_t i = 0; i < perLockId.size();) {
-            if (perLockContext[i].stateArraySptr->at(perLockContext[i].threadIndex).state < Uninit) {
-                perLockContext[i] = std::move(perLockContext.back());
-                perLockContext.pop_back();
-                perLockId[i] = perLockId.back();
-                perLockId.pop_back();
-            } else {
-                ++i;
+    void reaperThreadEntry()
+    {
+        while (true) {
+            uint32_t head = *_cqHead;  // Only this thread modifies the head
+            if (head == __atomic_load_n(_cqTail, __ATOMIC_ACQUIRE)) {
+                if (_isReaperExit.load()) { break; }  // Set once all reads are completed
+                struct __kernel_timespec     timeout{0, ReaperWaitTimeoutNs};
+                struct io_uring_getevents_arg arg;
+                memset(&arg, 0, sizeof(arg));
+                arg.ts = (uint64_t)(uintptr_t)&timeout;
+                syscall(__NR_io_uring_enter, _ringFd, 0, 1, IORING_ENTER_GETEVENTS | IORING_ENTER_EXT_ARG, &arg, sizeof(arg));
+                continue;
             }
+            struct io_uring_cqe cqe = _cqes[head & _cqMask];
+            __atomic_store_n(_cqHead, head + 1, __ATOMIC_RELEASE);
+            if (cqe.user_data == 0) { continue; }  // Wake-up no-op of the stop
+
+            // The handler is moved out of the request, as the request may be released inside the call
+            Request* r             = (Request*)(uintptr_t)cqe.user_data;
+            size_t   expectedBytes = 0;
+            for (uint32_t i = 0; i < r->iovQty; ++i) { expectedBytes += r->iov[i].iov_len; }
+            std::function<void(bool)> onCompletion = std::move(r->onCompletion);
+            onCompletion(cqe.res >= 0 && (size_t)cqe.res == expectedBytes);
+            --_inFlightQty;
+            notifyCompletionWaiters();
         }
-        return registrationIndex;
     }
 
-    // Fields
-    std::atomic<bool>    excLockReq;
-    const StateArraySptr stateArraySptr;          // Shared with thread local contexts
-    uint8_t              reserved[CpuCacheLine];  // Prevent false sharing between threads
-    StateArray&          stateArray;              // Intra-object local access, protected by the internal shared ptr
-    uint32_t             uniqueLockId;
+    void releaseRings()
+    {
+        if (_sqes && _sqes != MAP_FAILED) { munmap(_sqes, _sqesBytes); }
+        if (_cqRing && _cqRing != MAP_FAILED && _cqRing != _sqRing) { munmap(_cqRing, _cqRingBytes); }
+        if (_sqRing && _sqRing != MAP_FAILED) { munmap(_sqRing, _sqRingBytes); }
+        if (_ringFd >= 0) { ::close(_ringFd); }
+        _sqes   = nullptr;
+        _cqRing = nullptr;
+        _sqRing = nullptr;
+        _ringFd = -1;
+    }
+
+    static constexpr long ReaperWaitTimeoutNs = 100'000'000;
+
+    int                   _ringFd         = -1;
+    void*                 _sqRing         = nullptr;
+    void*                 _cqRing         = nullptr;
+    void*                 _sqes           = nullptr;
+    size_t                _sqRingBytes    = 0;
+    size_t                _cqRingBytes    = 0;
+    size_t                _sqesBytes      = 0;
+    uint32_t*             _sqHead         = nullptr;
+    uint32_t*             _sqTail         = nullptr;
+    uint32_t*             _sqArray        = nullptr;
+    uint32_t              _sqMask         = 0;
+    uint32_t              _sqEntries      = 0;
+    uint32_t              _pendingSqeQty  = 0;
+    uint32_t*             _cqHead         = nullptr;
+    uint32_t*             _cqTail         = nullptr;
+    uint32_t              _cqMask         = 0;
+    struct io_uring_cqe*  _cqes           = nullptr;
+    uint32_t              _maxInFlightQty = 0;
+    bool                  _isBroken       = false;  // Protected by the submission lock
+    std::atomic<bool>       _isReaperExit{false};
+    std::atomic<uint32_t>   _inFlightQty{0};
+    std::atomic<uint32_t>   _completionWaiterQty{0};
+    std::atomic<bool>       _isStarted{false};
+    std::mutex              _submitMutex;
+    std::mutex              _completionMutex;
+    std::condition_variable _completionCv;
+    std::thread             _reaperThread;
 };
 
-#endif
+#endif  // LITECASK_IO_URING_ENABLED
 
 // ==========================================================================================
-// TLSF allocator
+// Wyhash https://github.com/wangyi-fudan/wyhash/tree/master (18a25157b modified)
+// This is free and unencumbered software released into the public domain under The Unlicense
+// (http://unlicense.org/)
 // ==========================================================================================
 
-// This allocator possesses interesting properties for our usage: fast, code is small, response time is bounded, internal fragmentation
-// is bounded and external fragmentation is low in practice (good coalescing).
-// See http://www.gii.upv.es/tlsf/ for details. The code is inspired from https://github.com/jserv/tlsf-bsd .
-// It is not optimized for threading (as tcmalloc or jemalloc) and less efficient than ptmalloc (derived from dlmalloc described here
-// https://gee.cs.oswego.edu/dl/html/malloc.html. As TLSF, it is a "heap" allocator) which has specific handling of small and big sizes.
-// This implementation does not rely on "userland managed pages" but on virtual memory, which simplifies the code.
-// Such single-heap allocator enables the use of "compressed pointers" (32 bits instead of 64 bits), hence reducing overhead.
-
-constexpr uint32_t TlsfAlignShift = 3;  // 3 LSB cleared = 8 bytes alignment
-constexpr uint32_t TlsfSlShift    = 4;  // 4 bits for the second layer, so 16 sub lists
-constexpr uint32_t TlsfFlShift    = TlsfSlShift + TlsfAlignShift;
-constexpr uint64_t TlsfSmallSize  = (1 << TlsfFlShift);  // Sizes less than 128 bytes go into the first layer
-constexpr uint32_t TlsfSlQty      = (1 << TlsfSlShift);
-constexpr uint32_t TlsfFlQty      = 32;  // Allows a theoritical max allocation of 1 << (32 + 3(align) + 4(sl) - (margin) 2)
+static inline void
+_wymum(uint64_t* A, uint64_t* B)
+{
+#if defined(_MSC_VER)
+    *A = _umul128(*A, *B, B);
+#else
+    __uint128_t r = *A;
+    r *= *B;
+    *A = (uint64_t)r;
+    *B = (uint64_t)(r >> 64);
+#endif
+}
 
-constexpr uint64_t TlsfBlockOverhead = sizeof(uint64_t);  // Size of 'dataSizeAndFlags' placed just before payloads
-constexpr uint64_t TlsfFlagFree      = 0x1;
-constexpr uint64_t TlsfFlagPrevFree  = 0x2;
+static inline uint64_t
+_wymix(uint64_t A, uint64_t B)
+{
+    _wymum(&A, &B);
+    return A ^ B;
+}
+static inline uint64_t
+_wyr8(const uint8_t* p)
+{
+    uint64_t v;  // NOLINT(cppcoreguidelines-init-variables)
+    memcpy(&v, p, 8);
+    return v;
+}
+static inline uint64_t
+_wyr4(const uint8_t* p)
+{
+    uint32_t v;  // NOLINT(cppcoreguidelines-init-variables)
+    memcpy(&v, p, 4);
+    return v;
+}
+static inline uint64_t
+_wyr3(const uint8_t* p, size_t k)
+{
+    return (((uint64_t)p[0]) << 16) | (((uint64_t)p[k >> 1]) << 8) | p[k - 1];
+}
 
-struct tlsfBlock {
-    // The structure of a free block is:
-    //   [offset -  8]  pointer to previous block in memory. Valid only if the previous block is free
-    //   [offset +  0]  [bit 31 <- bit 2] block size    [bit 1] flag prev block is free   [bit 0] flag block is free
-    //   [offset +  8]  Next free block in free list
-    //   [offset + 16]  Previous free block in free list
-    //
-    // The structure of a used block is:
-    //   [offset -  8]  pointer to previous block in memory. Valid only if the previous block is free
-    //   [offset +  0]  [bit 31 <- bit 2] block size    [bit 1] flag prev block is free   [bit 0] flag block is free
-    //   [offset +  8]  payload (seen by user)
+// The optional 'fingerprint' is a second 64-bit hash of the key, derived from the same internal state with other secrets.
+// Together with the hash, they identify a key without storing it (see 'keyDirFingerprintMode')
+static inline uint64_t
+wyhash(const void* key, size_t len, uint64_t* fingerprint = nullptr)
+{
+    constexpr uint64_t secret0 = 0x2d358dccaa6c78a5ull;
+    constexpr uint64_t secret1 = 0x8bb84b93962eacc9ull;
+    constexpr uint64_t secret2 = 0x4b33a62ed433d4a3ull;
+    constexpr uint64_t secret3 = 0x4d5a2da51de1aa47ull;
+    const uint8_t*     p       = (const uint8_t*)key;
+    uint64_t           seed    = 0xca813bf4c7abf0a9ull;  // seed ^= _wymix(seed ^ secret0, secret1);  with fixed seed = 0
+    uint64_t           a = 0, b = 0;
 
-    tlsfBlock* prevBlockIfFree;   // Valid only if previous block is free. That is why we need the 'PrevBlockIsFree' flag
-    uint64_t   dataSizeAndFlags;  // Real block info = overhead
-    tlsfBlock* nextFreeBlock;     // Valid only if block is free. Else it is the start of the payload
-    tlsfBlock* prevFreeBlock;     // Valid only if block is free. Else it is part the payload
-
-    char* header() { return (char*)this + offsetof(tlsfBlock, dataSizeAndFlags); }
-
-    char* payload() { return header() + sizeof(dataSizeAndFlags); }
+    if (LITECASK_LIKELY(len <= 16)) {
+        if (LITECASK_LIKELY(len >= 4)) {
+            a = (_wyr4(p) << 32) | _wyr4(p + ((len >> 3) << 2));
+            b = (_wyr4(p + len - 4) << 32) | _wyr4(p + len - 4 - ((len >> 3) << 2));
+        } else if (LITECASK_LIKELY(len > 0)) {
+            a = _wyr3(p, len);
+            b = 0;
+        } else {
+            a = b = 0;
+        }
+    } else {
+        size_t i = len;
+        if (LITECASK_UNLIKELY(i >= 48)) {
+            uint64_t see1 = seed, see2 = seed;
+            do {
+                seed = _wymix(_wyr8(p) ^ secret1, _wyr8(p + 8) ^ seed);
+                see1 = _wymix(_wyr8(p + 16) ^ secret2, _wyr8(p + 24) ^ see1);
+                see2 = _wymix(_wyr8(p + 32) ^ secret3, _wyr8(p + 40) ^ see2);
+                p += 48;
+                i -= 48;
+            } while (LITECASK_LIKELY(i >= 48));
+            seed ^= see1 ^ see2;
+        }
+        while (LITECASK_UNLIKELY(i > 16)) {
+            seed = _wymix(_wyr8(p) ^ secret1, _wyr8(p + 8) ^ seed);
+            i -= 16;
+            p += 16;
+        }
+        a = _wyr8(p + i - 16);
+        b = _wyr8(p + i - 8);
+    }
+    a ^= secret1;
+    b ^= seed;
+    _wymum(&a, &b);
+    if (fingerprint) { *fingerprint = _wymix(a ^ secret2 ^ len, b ^ secret3); }
+    return _wymix(a ^ secret0 ^ len, b ^ secret1);
+}
 
-    static tlsfBlock* fromPayload(void* mem) { return (tlsfBlock*)((char*)mem - offsetof(tlsfBlock, nextFreeBlock)); }
+static inline uint64_t
+wyhashFingerprint(const void* key, size_t len)
+{
+    uint64_t fingerprint = 0;
+    wyhash(key, len, &fingerprint);
+    return fingerprint;
+}
 
-    tlsfBlock* getNext() { return (tlsfBlock*)(header() + getPayloadSize()); }
+#define LITECASK_HASH_FUNC(key, keySize)        wyhash(key, keySize)
+#define LITECASK_FINGERPRINT_FUNC(key, keySize) wyhashFingerprint(key, keySize)
 
-    void setPayloadSize(uint64_t size) { dataSizeAndFlags = size | (dataSizeAndFlags & (TlsfFlagFree | TlsfFlagPrevFree)); }
+// ==========================================================================================
+// NUMA topology
+// ==========================================================================================
 
-    uint64_t getPayloadSize() const { return (dataSizeAndFlags & ~(TlsfFlagFree | TlsfFlagPrevFree)); }
+// Quantity of NUMA nodes of the machine, 1 if unknown. Sparse node numbers are accounted up to the highest one.
+inline int
+getNumaNodeQty()
+{
+    static const int nodeQty = []() {
+        int qty = 1;
+#if defined(_MSC_VER)
+        ULONG highestNode = 0;
+        if (GetNumaHighestNodeNumber(&highestNode)) { qty = (int)highestNode + 1; }
+#else
+        std::error_code ec;
+        for (const auto& entry : std::filesystem::directory_iterator("/sys/devices/system/node", ec)) {
+            const std::string name = entry.path().filename().string();
+            if (name.size() <= 4 || name.compare(0, 4, "node") != 0 || name.find_first_not_of("0123456789", 4) != std::string::npos) {
+                continue;
+            }
+            qty = std::max(qty, atoi(name.c_str() + 4) + 1);
+        }
+#endif
+        return std::min(qty, 64);
+    }();
+    return nodeQty;
+}
 
-    bool isFree() const { return (dataSizeAndFlags & TlsfFlagFree); }
+// NUMA node of the CPU currently running the calling thread, 0 if unknown. The thread may migrate afterwards.
+inline int
+getCurrentNumaNode()
+{
+#if defined(_MSC_VER)
+    PROCESSOR_NUMBER processor;
+    USHORT           node = 0;
+    GetCurrentProcessorNumberEx(&processor);
+    if (!GetNumaProcessorNodeEx(&processor, &node)) { return 0; }
+    return (int)node;
+#else
+    unsigned int cpu = 0, node = 0;
+    if (syscall(SYS_getcpu, &cpu, &node, nullptr) != 0) { return 0; }
+    return (int)node;
+#endif
+}
 
-    bool isPrevFree() const { return (dataSizeAndFlags & TlsfFlagPrevFree); }
+// Huge page and NUMA policies of the large in-memory structures
+struct MemoryPolicy {
+    bool       useHugePages = false;
+    NumaPolicy numaPolicy   = NumaPolicy::Default;
+};
 
-    void setFree(bool state)
-    {
-        assert(isFree() != state && "block free bit unchanged");
-        dataSizeAndFlags      = state ? (dataSizeAndFlags | TlsfFlagFree) : (dataSizeAndFlags & ~TlsfFlagFree);
-        tlsfBlock* next       = getNext();
-        next->prevBlockIfFree = this;
-        next->setPrevFree(state);
+// Applies the memory policy on a range of virtual memory, for its pages touched afterwards. It is a best effort: the returned value
+// is false if the OS refused a part of it. The previous policy of the range is required to revert the huge page request.
+inline bool
+osApplyMemoryPolicy(void* ptr, uint64_t bytes, const MemoryPolicy& policy, const MemoryPolicy& previousPolicy)
+{
+#if defined(_MSC_VER)
+    // The arenas are committed by chunks, which is not compatible with large pages. No placement control either
+    (void)ptr;
+    (void)bytes;
+    (void)previousPolicy;
+    return !policy.useHugePages && policy.numaPolicy == NumaPolicy::Default;
+#else
+    bool isApplied = true;
+#ifdef MADV_HUGEPAGE
+    if (policy.useHugePages) {
+        isApplied = (madvise(ptr, (size_t)bytes, MADV_HUGEPAGE) == 0);
+    } else if (previousPolicy.useHugePages) {
+        isApplied = (madvise(ptr, (size_t)bytes, MADV_NOHUGEPAGE) == 0);
     }
+#else
+    isApplied = !policy.useHugePages;
+#endif
 
-    void setPrevFree(bool state)
-    {
-        dataSizeAndFlags = state ? (dataSizeAndFlags | TlsfFlagPrevFree) : (dataSizeAndFlags & ~TlsfFlagPrevFree);
+    if (policy.numaPolicy != previousPolicy.numaPolicy) {
+        // A preferred node policy with an empty node mask is the local allocation
+        unsigned long nodeMask = 0;
+        int           mode     = (policy.numaPolicy == NumaPolicy::Local) ? MPOL_PREFERRED : MPOL_DEFAULT;
+        if (policy.numaPolicy == NumaPolicy::Interleave) {
+            mode = MPOL_INTERLEAVE;
+            for (int node = 0; node < getNumaNodeQty(); ++node) { nodeMask |= (1UL << node); }
+        }
+        unsigned long maxNode = nodeMask ? 8 * sizeof(nodeMask) : 0;
+        if (syscall(SYS_mbind, ptr, (unsigned long)bytes, mode, nodeMask ? &nodeMask : nullptr, maxNode, 0) != 0) { isApplied = false; }
     }
-};
+    return isApplied;
+#endif
+}
 
-class TlsfAllocator
+// Allocates a zeroed and page aligned hash table with the memory policy
+inline uint8_t*
+osAllocateTable(uint64_t bytes, const MemoryPolicy& policy)
 {
-   public:
-    TlsfAllocator(uint64_t maxAllocatableBytes)
-    {
-        if (maxAllocatableBytes) {
 #if defined(_MSC_VER)
-            // On Windows, virtual allocation is better done in two phases: first reserve the total, then commit by chunks
-            SYSTEM_INFO sSysInfo;
-            GetSystemInfo(&sSysInfo);
-            _allocGranularity         = sSysInfo.dwAllocationGranularity;  // Preferred to page size, which is very small for our usage
-            _arenaMaxAllocatableBytes = ((maxAllocatableBytes + _allocGranularity - 1) / _allocGranularity) * _allocGranularity;
-            _arenaBasePtr             = (uint8_t*)VirtualAlloc(NULL, _arenaMaxAllocatableBytes, MEM_RESERVE, PAGE_NOACCESS);
-            assert(_arenaBasePtr);
+    if (policy.useHugePages) {
+        // Requires the 'SeLockMemoryPrivilege', else the standard pages are used
+        uint64_t largePageBytes = GetLargePageMinimum();
+        if (largePageBytes > 0) {
+            void* ptr = VirtualAlloc(NULL, ((bytes + largePageBytes - 1) / largePageBytes) * largePageBytes,
+                                     MEM_RESERVE | MEM_COMMIT | MEM_LARGE_PAGES, PAGE_READWRITE);
+            if (ptr) { return (uint8_t*)ptr; }
+        }
+    }
+    uint8_t* ptr = (uint8_t*)VirtualAlloc(NULL, bytes, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE);
+    assert(ptr);
+    return ptr;
 #else
-            _arenaMaxAllocatableBytes = maxAllocatableBytes;
-            _arenaBasePtr             = (uint8_t*)mmap(nullptr, _arenaMaxAllocatableBytes, PROT_READ | PROT_WRITE,
-                                                       MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
-            assert(_arenaBasePtr != MAP_FAILED);  // NOLINT
+    void* ptr = mmap(nullptr, (size_t)bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    assert(ptr != MAP_FAILED);  // NOLINT
+    osApplyMemoryPolicy(ptr, bytes, policy, MemoryPolicy{});
+    return (uint8_t*)ptr;
 #endif
-            assert((((uintptr_t)_arenaBasePtr) % (1 << TlsfAlignShift)) == 0);
-        }
-    }
+}
 
-    ~TlsfAllocator()
-    {
-        if (_arenaMaxAllocatableBytes) {
+inline void
+osFreeTable(uint8_t* ptr, [[maybe_unused]] uint64_t bytes)
+{
+    if (!ptr) { return; }
 #if defined(_MSC_VER)
-            [[maybe_unused]] bool status = VirtualFree(_arenaBasePtr, 0, MEM_RELEASE);
-            assert(status);
+    [[maybe_unused]] bool status = VirtualFree(ptr, 0, MEM_RELEASE);
+    assert(status);
 #else
-            [[maybe_unused]] int status = munmap(_arenaBasePtr, _arenaMaxAllocatableBytes);
-            assert(status == 0);
+    [[maybe_unused]] int status = munmap(ptr, (size_t)bytes);
+    assert(status == 0);
 #endif
-        }
+}
+
+// Empties a hash table while keeping its address range valid, so that late lock-free readers see only empty slots.
+// On Linux, the physical memory is also released. On Windows, MEM_RESET would leave the old content readable, and a decommit would
+// make the late readers fault, so the table is simply zeroed. In both cases, the table is freed after the grace period of the readers
+inline void
+osReleaseTableMemory(uint8_t* ptr, uint64_t bytes)
+{
+    if (!ptr) { return; }
+#if defined(_MSC_VER)
+    memset(ptr, 0, (size_t)bytes);
+#else
+    madvise(ptr, (size_t)bytes, MADV_DONTNEED);  // Private anonymous pages are zero-filled on the next access
+#endif
+}
+
+// ==========================================================================================
+// Latency instrumentation
+// ==========================================================================================
+
+// The histograms are log-linear (similar to HDR histograms): the values below 16 ns have their own bucket, and each power of 2 above
+// is split into 8 buckets. The values are saturated at 2^40 ns (~18 minutes)
+constexpr int LatencySubBucketBits = 3;
+constexpr int LatencySubBucketQty  = 1 << LatencySubBucketBits;
+constexpr int LatencyMaxMsb        = 40;
+constexpr int LatencyBucketQty     = (LatencyMaxMsb - LatencySubBucketBits + 2) * LatencySubBucketQty;
+
+inline int
+getLatencyBucketIndex(uint64_t valueNs)
+{
+    if (valueNs < 2 * LatencySubBucketQty) { return (int)valueNs; }
+#if defined(_MSC_VER)
+    int msb = 63 - (int)_lzcnt_u64(valueNs);
+#else
+    int msb = 63 - __builtin_clzll(valueNs);
+#endif
+    if (msb > LatencyMaxMsb) { return LatencyBucketQty - 1; }
+    int shift = msb - LatencySubBucketBits;
+    return (shift + 1) * LatencySubBucketQty + (int)((valueNs >> shift) & (LatencySubBucketQty - 1));
+}
+
+// Highest value of a bucket
+inline uint64_t
+getLatencyBucketValue(int bucketIdx)
+{
+    if (bucketIdx < 2 * LatencySubBucketQty) { return (uint64_t)bucketIdx; }
+    int shift = bucketIdx / LatencySubBucketQty - 1;
+    int sub   = bucketIdx % LatencySubBucketQty;
+    return (((uint64_t)(LatencySubBucketQty + sub + 1)) << shift) - 1;
+}
+
+// Written by a single thread. The atomics only make the concurrent reading and resetting safe
+struct LatencyHistogram {
+    std::array<std::atomic<uint64_t>, LatencyBucketQty> buckets{};
+    std::atomic<uint64_t>                               sumNs{0};
+    std::atomic<uint64_t>                               minNs{UINT64_MAX};
+    std::atomic<uint64_t>                               maxNs{0};
+
+    void add(uint64_t valueNs)
+    {
+        buckets[getLatencyBucketIndex(valueNs)].fetch_add(1, std::memory_order_relaxed);
+        sumNs.fetch_add(valueNs, std::memory_order_relaxed);
+        if (valueNs < minNs.load(std::memory_order_relaxed)) { minNs.store(valueNs, std::memory_order_relaxed); }
+        if (valueNs > maxNs.load(std::memory_order_relaxed)) { maxNs.store(valueNs, std::memory_order_relaxed); }
     }
 
     void reset()
     {
-        // Reset the allocator. This invalidates all previous allocations
-        _arenaAllocatedBytes = 0;
-        _flBitmap            = 0;
-        memset(_slBitmaps, 0, sizeof(_slBitmaps));
-        memset(_freeBlocks, 0, sizeof(_freeBlocks));
-        _statAllocatedBytes = 0;
+        for (auto& b : buckets) { b.store(0, std::memory_order_relaxed); }
+        sumNs.store(0, std::memory_order_relaxed);
+        minNs.store(UINT64_MAX, std::memory_order_relaxed);
+        maxNs.store(0, std::memory_order_relaxed);
     }
+};
 
-    void* malloc(uint64_t size)
+struct LatencyRecorder {
+    std::array<LatencyHistogram, (int)LatencyKind::Qty> histograms;
+};
+
+// Per-thread latency histograms, merged when they are read.
+// A thread gets its recorder through a thread local lookup, the first time it records a latency for this instrumentation instance
+class LatencyInstrumentation
+{
+   public:
+    LatencyInstrumentation()
     {
-        uint64_t adjustedSize = getAdjustedSize(size);
-        if (LITECASK_UNLIKELY(adjustedSize == 0)) return nullptr;
+        static std::atomic<uint32_t> uniqueIdGenerator = 1;  // Global for all instrumentation objects
+        _uniqueId                                      = uniqueIdGenerator++;
+    }
 
-        // Compute the initial layer indexes
-        uint32_t firstLayerIdx = 0, secondLayerIdx = 0;
-        findSizeFittingList(adjustedSize, &firstLayerIdx, &secondLayerIdx);
+    void setEnabled(bool isEnabled) { _isEnabled.store(isEnabled, std::memory_order_relaxed); }
 
-        tlsfBlock* block = nullptr;
-        for (int pass = 0; !block && pass < 2; ++pass) {
-            // Second chance is after growing the arena
-            if (LITECASK_UNLIKELY(pass == 1 && !extendArena(adjustedSize))) { return nullptr; }
+    bool isEnabled() const { return _isEnabled.load(std::memory_order_relaxed); }
 
-            // Is the second layer of the targeted first layer populated for this size?
-            uint32_t slBitmap = _slBitmaps[firstLayerIdx] & ~((1U << secondLayerIdx) - 1);  // Clear the too small sizes
-            if (!slBitmap) {
-                // Need to look up larger first level lists
-                uint32_t flBitmap = _flBitmap & (~((1U << (firstLayerIdx + 1)) - 1));
-                if (LITECASK_UNLIKELY(!flBitmap)) { continue; }  // No such free blocks available, go to next pass
+    // Returns the start time of a measure, or zero if the instrumentation is disabled
+    uint64_t start() const { return isEnabled() ? getTimeNs() : 0; }
 
-                // Update the first layer to this larger one
-                firstLayerIdx = countTrailingZeros(flBitmap);  // Take the lowest bit available, as the bitmap has been masked accordingly
-                slBitmap      = _slBitmaps[firstLayerIdx];     // Update the second layer bitmap, any of these list would fit
-                assert(slBitmap && "second level bitmap is null in spite of the first level bitmap");
-            }
+    void record(LatencyKind kind, uint64_t startNs)
+    {
+        if (startNs == 0) { return; }
+        getThreadRecorder().histograms[(int)kind].add(getTimeNs() - startNs);
+    }
 
-            secondLayerIdx = countTrailingZeros(slBitmap);  // Take the lowest bit available, as the bitmap has been masked accordingly
-            assert(secondLayerIdx < TlsfSlQty && "wrong second level");
-            block = _freeBlocks[firstLayerIdx][secondLayerIdx];
+    LatencyStats getStats(LatencyKind kind) const
+    {
+        std::array<uint64_t, LatencyBucketQty> buckets{};
+        LatencyStats                           stats;
+        uint64_t                               sumNs = 0;
+        stats.minNs                                  = UINT64_MAX;
+        {
+            std::lock_guard<std::mutex> lk(_mx);
+            for (const auto& recorder : _recorders) {
+                const LatencyHistogram& h = recorder->histograms[(int)kind];
+                for (int i = 0; i < LatencyBucketQty; ++i) {
+                    uint64_t qty = h.buckets[i].load(std::memory_order_relaxed);
+                    buckets[i] += qty;
+                    stats.count += qty;
+                }
+                sumNs += h.sumNs.load(std::memory_order_relaxed);
+                stats.minNs = std::min(stats.minNs, h.minNs.load(std::memory_order_relaxed));
+                stats.maxNs = std::max(stats.maxNs, h.maxNs.load(std::memory_order_relaxed));
+            }
         }
-        assert(block);
-        assert(block && block->getPayloadSize() >= size && "insufficient block size");
-
-        detachFreeBlockFromFreeList(block, firstLayerIdx, secondLayerIdx);
+        if (stats.count == 0) { return LatencyStats{}; }
+        stats.meanNs = sumNs / stats.count;
+
+        // The percentiles are the highest value of their bucket, bounded by the maximum
+        uint64_t* percentiles[4]     = {&stats.p50Ns, &stats.p90Ns, &stats.p99Ns, &stats.p999Ns};
+        double    percentileRanks[4] = {0.50, 0.90, 0.99, 0.999};
+        uint64_t  cumulatedQty       = 0;
+        int       percentileIdx      = 0;
+        for (int i = 0; i < LatencyBucketQty && percentileIdx < 4; ++i) {
+            cumulatedQty += buckets[i];
+            while (percentileIdx < 4 && (double)cumulatedQty >= percentileRanks[percentileIdx] * (double)stats.count) {
+                *percentiles[percentileIdx++] = std::max(std::min(getLatencyBucketValue(i), stats.maxNs), stats.minNs);
+            }
+        }
+        return stats;
+    }
 
-        // Split this free block to isolate the (left) part that will be used
-        if (block->getPayloadSize() >= sizeof(tlsfBlock) + size) {
-            // Split a block into two, the second of which is free
-            tlsfBlock* rightBlock        = (tlsfBlock*)(block->header() + size);
-            uint64_t   rightBlockSize    = block->getPayloadSize() - (size + TlsfBlockOverhead);
-            rightBlock->dataSizeAndFlags = rightBlockSize | 0;  // Initialize without flags
-            rightBlock->setFree(true);
+    void reset()
+    {
+        std::lock_guard<std::mutex> lk(_mx);
+        for (auto& recorder : _recorders) {
+            for (LatencyHistogram& h : recorder->histograms) { h.reset(); }
+        }
+    }
 
-            // Deduce the removed size from the block
-            block->setPayloadSize(size);
+   private:
+    static uint64_t getTimeNs()
+    {
+        return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
 
-            // Link the two blocks as "consecutive"
-            block->getNext()->prevBlockIfFree = block;
-            rightBlock->setPrevFree(true);  // 'block' is not yet in use
+    LatencyRecorder& getThreadRecorder()
+    {
+        // This per-thread lookup is shared by all instances. A recorder is owned by its instance and by the threads which use it
+        thread_local static lcVector<std::pair<uint32_t, std::shared_ptr<LatencyRecorder>>> perThreadRecorders;
+        for (auto& entry : perThreadRecorders) {
+            if (entry.first == _uniqueId) { return *entry.second; }
+        }
 
-            // Insert the remaining free part of the block in the free list
-            insertBlockInFreeList(rightBlock);
+        // Take the opportunity to clean the recorders of the deleted instances (only this thread owns them)
+        for (size_t i = 0; i < perThreadRecorders.size();) {
+            if (perThreadRecorders[i].second.use_count() == 1) {
+                perThreadRecorders[i] = std::move(perThreadRecorders.back());
+                perThreadRecorders.pop_back();
+            } else {
+                ++i;
+            }
         }
 
-        // Mark the block as used
-        block->setFree(false);
-        _statAllocatedBytes += TlsfBlockOverhead + block->getPayloadSize();
-        return block->payload();
+        auto recorder = std::make_shared<LatencyRecorder>();
+        {
+            std::lock_guard<std::mutex> lk(_mx);
+            _recorders.push_back(recorder);
+        }
+        perThreadRecorders.emplace_back(_uniqueId, recorder);
+        return *recorder;
     }
 
-    void free(void* mem)
-    {
-        if (LITECASK_UNLIKELY(!mem)) { return; }
+    mutable std::mutex                        _mx;  // Protects the list of recorders
+    lcVector<std::shared_ptr<LatencyRecorder>> _recorders;
+    std::atomic<bool>                         _isEnabled{false};
+    uint32_t                                  _uniqueId = 0;
+};
 
-        // Back to the block structure
-        tlsfBlock* block = tlsfBlock::fromPayload(mem);
+// Measures the latency of a scope
+class LatencyScope
+{
+   public:
+    LatencyScope(LatencyInstrumentation& instrumentation, LatencyKind kind)
+        : _instrumentation(instrumentation), _kind(kind), _startNs(instrumentation.start())
+    {
+    }
+    ~LatencyScope() { _instrumentation.record(_kind, _startNs); }
 
-        assert(!block->isFree() && "block already marked as free");
-        block->setFree(true);
-        assert(_statAllocatedBytes >= TlsfBlockOverhead + block->getPayloadSize());
-        _statAllocatedBytes -= TlsfBlockOverhead + block->getPayloadSize();
+   private:
+    LatencyInstrumentation& _instrumentation;
+    LatencyKind             _kind;
+    uint64_t                _startNs;
+};
 
-        // Merge this free block with previous one if it is free
-        block = mergeBlockWithPreviousIfFree(block);
+// ==========================================================================================
+// Readers-writer lock
+// ==========================================================================================
 
-        // Merge this free block with next one if it is free
-        tlsfBlock* next = block->getNext();
-        assert(next && "next block can't be null");
-        if (next->isFree()) {
-            // Remove the next block from the free list
-            uint32_t firstLayerIdx = 0, secondLayerIdx = 0;
-            findSizeFittingList(next->getPayloadSize(), &firstLayerIdx, &secondLayerIdx);
-            detachFreeBlockFromFreeList(next, firstLayerIdx, secondLayerIdx);
+#ifdef LITECASK_STANDARD_SHARED_MUTEX
 
-            // Absorb the next block inside the current one
-            block->dataSizeAndFlags += next->getPayloadSize() + TlsfBlockOverhead;  // Flags untouched
-            block->getNext()->prevBlockIfFree = block;
-        }
-
-        // Back in one of the free lists
-        insertBlockInFreeList(block);
-    }
-
-    uint32_t compress(uint8_t* ptr) const { return (uint32_t)((uint64_t)(ptr - _arenaBasePtr) >> 3); }
-
-    uint8_t* uncompress(uint32_t compressedPtr) const { return _arenaBasePtr + (((uint64_t)compressedPtr) << 3); }
-
-    uint64_t getRealAllocatedSize(void* mem) { return tlsfBlock::fromPayload(mem)->getPayloadSize(); }
+// The standard shared mutex is a risk-less implementation but its performance does not scale well with increasing thread quantity (on Linux
+// at least) probably due to its generic implementation not focussed enough on false sharing across cores and avoiding going to kernel.
+// Measurements show that 100% reading scales poorly and that ~5% write collapses the overall performance.
+// This RWLock is an encapsulation of the standard library and its presence just serves validation and comparison purposes.
+class RWLock
+{
+   public:
+    RWLock() {}
+    ~RWLock() {}
 
-    // Returns the in-used quantity (free + overhead), not the mmap-ed one
-    uint64_t getAllocatedBytes() const { return _statAllocatedBytes; }
+    void lockRead() { _mx.lock_shared(); }
+    void unlockRead() { _mx.unlock_shared(); }
+    void lockWrite() { _mx.lock(); }
+    void unlockWrite() { _mx.unlock(); }
 
-    uint64_t getMaxAllocatableBytes() const { return _arenaMaxAllocatableBytes; }
+   private:
+    std::shared_mutex _mx;
+};
+#else
 
-    struct CheckContext {
-        uint32_t firstLayerIdx;
-        uint32_t secondLayerIdx;
-        uint32_t firstLayerMask;
-        uint32_t secondLayerMask;
-    };
+// This custom implementation of shared mutex avoids costly false sharing by having a dedicated cache line per thread to mark its lock
+// request ( more memory is used compared to the standard shared mutex). The cost of the per-reader check is moved on the exclusive lock
+// side, which is fully in agreement with our system where writing operations are serialized and more expensive. Also, lock requests spin
+// before going to the kernel, improving the reactivity in most cases.
+// The thread slots are grouped per NUMA node: a thread registers in the group of its node (or in another one if full), so that its slot
+// cache line stays on its socket. The writer checks the readers group by group, and only up to the highest slot used in each of them.
+class RWLock
+{
+    // Soft limit on the thread quantity before switching to exclusive lock as a fallback
+    static constexpr int MaxThreads = LITECASK_RWLOCK_MAX_THREADS;
+    // Minimum slot quantity per NUMA node group, which limits the group quantity for small thread capacities
+    static constexpr int MinSlotPerGroup = 8;
+    static_assert(MaxThreads >= MinSlotPerGroup, "The RWLock thread capacity is too small");
 
-    static CheckContext getSizeCheckContext(uint64_t size)
+   public:
+    RWLock()
+        : excLockReq(false),
+          stateArraySptr(std::make_shared<StateArray>(std::min(std::max(getNumaNodeQty(), 1), MaxThreads / MinSlotPerGroup))),
+          stateArray(*stateArraySptr)
     {
-        CheckContext cc{};
-        uint64_t     adjustedSize = getAdjustedSize(size);
-        findSizeFittingList(adjustedSize, &cc.firstLayerIdx, &cc.secondLayerIdx);
-        cc.firstLayerMask  = ~((1U << (cc.firstLayerIdx + 1)) - 1);  // Any bit set in this FL mask is ok
-        cc.secondLayerMask = ~((1U << cc.secondLayerIdx) - 1);       // Any bit set in this SL mask from FL firstLayerIdx is ok
-        return cc;
+        static std::atomic<uint32_t> uniqueIdGenerator = 1;  // Global for all RWLock objects
+        uniqueLockId                                   = uniqueIdGenerator++;
+        (void)reserved;  // For nitty compilers
     }
 
-    bool isAllocatable(const CheckContext& cc) const
+    ~RWLock()
     {
-        return (_slBitmaps[cc.firstLayerIdx] & cc.secondLayerMask) || (_flBitmap & cc.firstLayerMask);
+        for (auto& lock : stateArray.slots) { lock.state = Invalid; }
     }
 
-#ifndef LITECASK_BUILD_FOR_TEST  // Allows looking inside the allocator internal, for testing purposes
-   private:
-#endif
-    // Fix the provided size (minimum size + alignment) and return the corresponding size in the free list
-    static uint64_t getAdjustedSize(uint64_t& size)
+    void lockWrite()
     {
-        // Adjust the allocated size (ceil-aligned with a minimum value)
-        constexpr uint64_t TlsfMaxSize = ((uint64_t)1) << (TlsfFlQty + TlsfFlShift - 2);  // 64 GB should be enough for everyone
-        // Min size is 24 bytes in this implementation. It could be halved with compressed pointers and reduced max allocatable size.
-        // However, no benefit would be provided in the context of Litecask, as minimum key and value chunks are above this size.
-        constexpr uint64_t MinAllocatedSize = sizeof(tlsfBlock) - sizeof(tlsfBlock*);
-        constexpr uint64_t AlignmentMask    = (1 << TlsfAlignShift) - 1;  // 0x7 when decrypted, 8 bytes alignment
-        size                                = std::max((size + AlignmentMask) & (~AlignmentMask), MinAllocatedSize);
-        if (LITECASK_UNLIKELY(size > TlsfMaxSize)) { return 0; }
+        // Mostly Spin until the writer flag is acquired
+        uint64_t counter  = 0;
+        bool     oldValue = false;
+        while (!excLockReq.compare_exchange_weak(oldValue, true, std::memory_order_seq_cst)) {
+            oldValue = false;
+            if (((++counter) & 0x0FFFFF) == 0) { std::this_thread::yield(); }  // Back to OS scheduler if too long spinning
+        }
 
-        // Find the list of free blocks with big enough size
-        uint64_t adjustedSize = size;
-        if (size >= TlsfSmallSize) {
-            uint32_t firstLayerBitIdx = (uint32_t)(63 - countLeadingZeros(size));
-            uint64_t layersBitMask    = (((uint64_t)1) << (firstLayerBitIdx - TlsfSlShift)) - 1;
-            // Keep only bits from first and second layers, with a ceiling
-            adjustedSize = (size + layersBitMask) & ~layersBitMask;
+        // Wait for readers to stop using the shared lock, node group by node group
+        for (int groupIdx = 0; groupIdx < stateArray.groupQty; ++groupIdx) {
+            State* groupSlots = &stateArray.slots[groupIdx * stateArray.slotPerGroupQty];
+            int    usedQty    = stateArray.groups[groupIdx].usedQty.load(std::memory_order_seq_cst);
+            for (int i = 0; i < usedQty; ++i) {
+                while (groupSlots[i].state.load(std::memory_order_seq_cst) >= Busy) {}
+            }
         }
-        return adjustedSize;
     }
 
-    static void findSizeFittingList(uint64_t size, uint32_t* firstLayerIdx, uint32_t* secondLayerIdx)
+    void unlockWrite()
     {
-        // Due to the 8-bytes alignment constraint multiplied by the 16 second layers, the initial first layers
-        // are not fully populated.
-        // We choose to populate only the layer 0 for "small" block size (128=2^7) then the natural first layers
-        if (size < TlsfSmallSize) {
-            *firstLayerIdx  = 0;
-            *secondLayerIdx = (uint32_t)(size / (TlsfSmallSize / TlsfSlQty));  // Step is 128/16 = 8 bytes
-        } else {
-            uint32_t firstLayerBitIdx = (uint32_t)(63 - countLeadingZeros(size));
-            *firstLayerIdx            = 1 + firstLayerBitIdx - TlsfFlShift;
-            // Shift to keep the second layer bits starting at bit0, and clear the top bit (set to 1, first layer)
-            *secondLayerIdx = (uint32_t)(size >> (firstLayerBitIdx - TlsfSlShift)) & (TlsfSlQty - 1);
-        }
-        assert(*firstLayerIdx < TlsfFlQty && "wrong first level");
-        assert(*secondLayerIdx < TlsfSlQty && "wrong second level");
+        excLockReq.store(false, std::memory_order_release);  // Simply release the writer flag
     }
 
-    void detachFreeBlockFromFreeList(tlsfBlock* block, uint32_t firstLayerIdx, uint32_t secondLayerIdx)
+    void lockRead()
     {
-        // Detach the block from list neighbors
-        tlsfBlock* prev = block->prevFreeBlock;
-        tlsfBlock* next = block->nextFreeBlock;
-        if (next) { next->prevFreeBlock = prev; }
-        if (prev) { prev->nextFreeBlock = next; }
+        // Get the index of this thread in this lock
+        int threadIndex = accessIndex();
 
-        // Update list head if needed
-        if (_freeBlocks[firstLayerIdx][secondLayerIdx] == block) {
-            _freeBlocks[firstLayerIdx][secondLayerIdx] = next;
-            if (!next) {                                                              // Update bitmaps if the list is empty
-                _slBitmaps[firstLayerIdx] &= ~(1U << secondLayerIdx);                 // Second layer bitmap
-                if (!_slBitmaps[firstLayerIdx]) _flBitmap &= ~(1U << firstLayerIdx);  // First layer bitmap if second layer is empty
+        // Check if the thread has no index yet and there are some potential free index
+        if (threadIndex < 0 && stateArraySptr.use_count() <= (int)stateArray.slots.size()) { threadIndex = registerThread(); }
+
+        if (threadIndex >= 0) {
+            // Notify the reader's access
+            stateArray.slots[threadIndex].state.store(Busy, std::memory_order_seq_cst);
+
+            // If a writer has the exclusive lock, then rollback and wait that it finishes
+            while (excLockReq.load(std::memory_order_seq_cst)) {
+                // Rollback the reader's access
+                stateArray.slots[threadIndex].state.store(Free, std::memory_order_seq_cst);
+                // Wait that the writer releases the lock
+                uint64_t counter = 0;
+                while (excLockReq.load(std::memory_order_seq_cst)) {
+                    if (((++counter) & 0x0FFFFF) == 0) { std::this_thread::yield(); }  // Back to OS scheduler if too long spinning
+                }
+                // Notify again the reader's access. If no writer has the lock, it will prevent them to take it.
+                stateArray.slots[threadIndex].state.store(Busy, std::memory_order_seq_cst);
+            }
+        } else {
+            // Case more threads than array size: fallback to exclusive lock but without waiting for other readers
+            uint64_t counter  = 0;
+            bool     oldValue = false;
+            while (!excLockReq.compare_exchange_weak(oldValue, true, std::memory_order_seq_cst)) {
+                oldValue = false;
+                if (((++counter) & 0x0FFFFF) == 0) { std::this_thread::yield(); }  // Back to OS scheduler if too long spinning
             }
         }
     }
 
-    void insertBlockInFreeList(tlsfBlock* block)
+    void unlockRead()
     {
-        // Find the fitting list
-        uint32_t firstLayerIdx = 0, secondLayerIdx = 0;
-        findSizeFittingList(block->getPayloadSize(), &firstLayerIdx, &secondLayerIdx);
-
-        // Insert in the list
-        tlsfBlock* current   = _freeBlocks[firstLayerIdx][secondLayerIdx];
-        block->nextFreeBlock = current;
-        block->prevFreeBlock = nullptr;
-        if (current) current->prevFreeBlock = block;
-        _freeBlocks[firstLayerIdx][secondLayerIdx] = block;
-
-        // Mark the bitmaps
-        _flBitmap |= 1U << firstLayerIdx;
-        _slBitmaps[firstLayerIdx] |= 1U << secondLayerIdx;
+        int threadIndex = accessIndex();
+        if (threadIndex >= 0) {
+            stateArray.slots[threadIndex].state.store(Free, std::memory_order_release);
+        } else {
+            excLockReq.store(false, std::memory_order_release);  // Case more thread than array size: fallback to exclusive lock
+        }
     }
 
-    tlsfBlock* mergeBlockWithPreviousIfFree(tlsfBlock* block)
-    {
-        if (!block->isPrevFree()) { return block; }
-
-        // Remove the previous block from the free list
-        tlsfBlock* prev = block->prevBlockIfFree;
-        assert(prev && "prev block can't be null");
-        assert(prev->isFree() && "prev block is not free though marked as such");
-        uint32_t firstLayerIdx = 0, secondLayerIdx = 0;
-        findSizeFittingList(prev->getPayloadSize(), &firstLayerIdx, &secondLayerIdx);
-        detachFreeBlockFromFreeList(prev, firstLayerIdx, secondLayerIdx);
+   private:
+    // Constants
+    static constexpr int Invalid = -1;
+    static constexpr int Uninit  = 0;
+    static constexpr int Free    = 1;
+    static constexpr int Busy    = 2;
 
-        // Absorb the block inside the previous one
-        prev->dataSizeAndFlags += block->getPayloadSize() + TlsfBlockOverhead;  // Flags untouched
-        prev->getNext()->prevBlockIfFree = prev;
-        return prev;
-    }
+    // Definitions
+    struct State {
+        alignas(CpuCacheLine) std::atomic<int> state{Uninit};
+    };
+    struct NodeGroup {
+        alignas(CpuCacheLine) std::atomic<int> usedQty{0};  // Highest used slot index in the group plus one
+    };
+    struct StateArray {
+        explicit StateArray(int nodeGroupQty)
+            : groupQty(nodeGroupQty), slotPerGroupQty(MaxThreads / nodeGroupQty), slots(groupQty * slotPerGroupQty), groups(groupQty)
+        {
+        }
+        const int           groupQty;
+        const int           slotPerGroupQty;
+        lcVector<State>     slots;  // Contiguous groups of 'slotPerGroupQty' slots, one group per NUMA node
+        lcVector<NodeGroup> groups;
+    };
+    using StateArraySptr = std::shared_ptr<StateArray>;
 
-    bool extendArena(uint64_t size)
-    {
-        // Note: first allocation is shifted by the field prevBlockIfFree
-        uint64_t firstAllocOverhead = (_arenaAllocatedBytes == 0) ? TlsfBlockOverhead : 0;
+    // Thread local structure bridging between the current thread and all lock instances
+    struct LockContext {
+        LockContext(int index, const StateArraySptr& ptr) : threadIndex(index), stateArraySptr(ptr) {}
+        LockContext(LockContext&& src) noexcept : threadIndex(src.threadIndex), stateArraySptr(std::move(src.stateArraySptr)) {}
+        LockContext& operator=(LockContext&& src) noexcept
+        {
+            if (this == &src) return *this;
+            threadIndex    = src.threadIndex;
+            stateArraySptr = std::move(src.stateArraySptr);
+            return *this;
+        }
+        ~LockContext()
+        {
+            if (stateArraySptr.use_count() > 0) { stateArraySptr->slots[threadIndex].state--; }
+        }
 
-        // Compute the size to match the allocation granularity
-        // Mandatory on Windows, but generalized because we do not need fine grained allocation and can avoid its individual cost
-        assert((size & 0x7) == 0);
-        uint64_t requiredNewAllocatedSize = _arenaAllocatedBytes + size + TlsfBlockOverhead + firstAllocOverhead;
-        uint64_t granularNewAllocatedSize = ((requiredNewAllocatedSize + _allocGranularity - 1) / _allocGranularity) * _allocGranularity;
-        uint64_t granularSize             = granularNewAllocatedSize - _arenaAllocatedBytes - TlsfBlockOverhead - firstAllocOverhead;
-        if (granularNewAllocatedSize > _arenaMaxAllocatableBytes) { return false; }
+        int            threadIndex;
+        StateArraySptr stateArraySptr;
+    };
 
-#if defined(_MSC_VER)
-        // Windows: Memory shall be committed before use
-        [[maybe_unused]] void* committedPtr =
-            VirtualAlloc(_arenaBasePtr + _arenaAllocatedBytes, granularNewAllocatedSize - _arenaAllocatedBytes, MEM_COMMIT, PAGE_READWRITE);
-        assert(committedPtr);
-#endif
-        tlsfBlock* addedBlock = (tlsfBlock*)((char*)_arenaBasePtr + _arenaAllocatedBytes - 2 * TlsfBlockOverhead + firstAllocOverhead);
+    int accessIndex(int registrationIndex = -1)
+    {
+        // These per-thread lookups are shared by all RWlock instances
+        thread_local static std::vector<LockContext> perLockContext;
+        thread_local static std::vector<uint32_t>    perLockId;  // Cache-friendly to find the associated context
 
-        // 1st alloc requires the creation of the sentinel (null size & not free). Previous is not free either because below the base
-        // pointer
-        if (_arenaAllocatedBytes == 0) {
-            addedBlock->dataSizeAndFlags = /* Null size */ 0 | /* Not free and previous not free either because first block ever */ 0;
+        // Getter case: return the value from the lookup
+        if (LITECASK_LIKELY(registrationIndex < 0)) {
+            for (size_t i = 0; i < perLockId.size(); ++i) {
+                if (perLockId[i] == uniqueLockId) { return perLockContext[i].threadIndex; }
+            }
+            return -1;
         }
 
-        // Transform the sentinel into a valid free block with the newly added size
-        assert(addedBlock->getPayloadSize() == 0 && !addedBlock->isFree() && "the old sentinel is corrupted");
-        addedBlock->dataSizeAndFlags |= granularSize | /* Free to recent allocation, previous block flag is untouched */ TlsfFlagFree;
-        addedBlock = mergeBlockWithPreviousIfFree(addedBlock);
-        insertBlockInFreeList(addedBlock);
+        // Setter case: create a new context in this thread local lookup
+        perLockContext.emplace_back(registrationIndex, stateArraySptr);
+        perLockId.push_back(uniqueLockId);
 
-        // Add a new sentinel (dummy last block of null size)
-        tlsfBlock* sentinel       = addedBlock->getNext();
-        sentinel->prevBlockIfFree = addedBlock;
-        sentinel->dataSizeAndFlags =
-            /* Null size */ 0 | /* Not free (sentinel) and previous block free due to recent allocation */ TlsfFlagPrevFree;
-        assert(sentinel->getPayloadSize() == 0 && !sentinel->isFree() && "the new sentinel is corrupted");
-
-        // Commit the allocation
-        _arenaAllocatedBytes = granularNewAllocatedSize;
-        return true;
+        // Take the opportunity to clean all deleted lock in this thread (accessible only from this thread...)
+        for (size_t i = 0; i < perLockId.size();) {
+            if (perLockContext[i].stateArraySptr->slots[perLockContext[i].threadIndex].state < Uninit) {
+                perLockContext[i] = std::move(perLockContext.back());
+                perLockContext.pop_back();
+                perLockId[i] = perLockId.back();
+                perLockId.pop_back();
+            } else {
+                ++i;
+            }
+        }
+        return registrationIndex;
     }
 
-#if defined(_MSC_VER)
-    static uint32_t countTrailingZeros(uint32_t v) { return _tzcnt_u32(v); }
-    static uint32_t countLeadingZeros(uint64_t v) { return (uint32_t)_lzcnt_u64(v); }
-#else
-    static uint32_t countTrailingZeros(uint32_t v) { return __builtin_ctz(v); }
-    static uint32_t countLeadingZeros(uint64_t v) { return __builtin_clzll(v); }
-#endif
-
-    // Bitmaps of the first and second layers
-    uint32_t _flBitmap             = 0;
-    uint32_t _slBitmaps[TlsfFlQty] = {};
-
-    // Free lists for each (first, second) layer
-    tlsfBlock* _freeBlocks[TlsfFlQty][TlsfSlQty] = {};
-    uint64_t   _statAllocatedBytes               = 0;
+    // Claims a slot for the calling thread, first in the group of its NUMA node. Returns -1 if all slots are taken.
+    int registerThread()
+    {
+        int nodeGroupIdx = getCurrentNumaNode() % stateArray.groupQty;
+        for (int groupOffset = 0; groupOffset < stateArray.groupQty; ++groupOffset) {
+            int groupIdx = (nodeGroupIdx + groupOffset) % stateArray.groupQty;
+            for (int i = 0; i < stateArray.slotPerGroupQty; ++i) {
+                int idx      = groupIdx * stateArray.slotPerGroupQty + i;
+                int oldValue = Uninit;
+                if (stateArray.slots[idx].state == Uninit && stateArray.slots[idx].state.compare_exchange_strong(oldValue, Free)) {
+                    // Make the slot visible to the writers before its first use
+                    std::atomic<int>& usedQty    = stateArray.groups[groupIdx].usedQty;
+                    int               oldUsedQty = usedQty.load();
+                    while (oldUsedQty < i + 1 && !usedQty.compare_exchange_weak(oldUsedQty, i + 1)) {}
+                    return accessIndex(idx);
+                }
+            }
+        }
+        return -1;
+    }
 
-    // Internal arena allocator
-    uint8_t* _arenaBasePtr             = nullptr;
-    uint64_t _arenaAllocatedBytes      = 0;
-    uint64_t _arenaMaxAllocatableBytes = 0;
-    uint64_t _allocGranularity         = 65536;  // Only really required on Windows, but generalized
+    // Fields
+    std::atomic<bool>    excLockReq;
+    const StateArraySptr stateArraySptr;          // Shared with thread local contexts
+    uint8_t              reserved[CpuCacheLine];  // Prevent false sharing between threads
+    StateArray&          stateArray;              // Intra-object local access, protected by the internal shared ptr
+    uint32_t             uniqueLockId;
 };
 
+#endif
+
 // ==========================================================================================
-// Value cache
+// Value compression
 // ==========================================================================================
 
-inline uint32_t
-getValueLockIndex(ValueLoc loc)
-{
-    uint32_t x = ((uint32_t)loc) ^ 2463534242;
-    x ^= x << 13;
-    x ^= x >> 17;
-    x ^= x << 5;
-    return x & (ValueMutexQty - 1);  // Kind of xorshift output
-}
+// Small LZ77 codec with a byte oriented format (similar to LZ4), favoring speed over ratio.
+// A sequence is a token (high nibble: literal length, low nibble: match length minus 4), the literal length extension, the
+// literals, the 16-bit match offset and the match length extension. A nibble equal to 15 is extended with the following bytes,
+// until one is below 255. The last sequence may have only literals.
+constexpr uint32_t LzHashBits  = 12;
+constexpr uint32_t LzMinMatch  = 4;
+constexpr uint32_t LzMaxOffset = 0xFFFF;
 
-inline void
-lockValueLocation(ValueLoc loc, std::array<std::mutex, ValueMutexQty>& valueMutexes)
+inline size_t
+lzCompress(const uint8_t* src, size_t srcSize, uint8_t* dst, size_t dstCapacity)
 {
-    valueMutexes[getValueLockIndex(loc)].lock();
-}
+    size_t op          = 0;
+    auto   writeLength = [&](size_t length) -> bool {
+        for (; length >= 255; length -= 255) {
+            if (op >= dstCapacity) { return false; }
+            dst[op++] = 255;
+        }
+        if (op >= dstCapacity) { return false; }
+        dst[op++] = (uint8_t)length;
+        return true;
+    };
+    auto writeSequence = [&](const uint8_t* literals, size_t literalLength, size_t matchLength, size_t offset) -> bool {
+        size_t matchCode = (matchLength > 0) ? matchLength - LzMinMatch : 0;
+        if (op >= dstCapacity) { return false; }
+        dst[op++] = (uint8_t)((std::min(literalLength, (size_t)15) << 4) | std::min(matchCode, (size_t)15));
+        if (literalLength >= 15 && !writeLength(literalLength - 15)) { return false; }
+        if (literalLength > dstCapacity - op) { return false; }
+        if (literalLength > 0) { memcpy(&dst[op], literals, literalLength); }
+        op += literalLength;
+        if (matchLength == 0) { return true; }  // Last sequence
+        if (op + 2 > dstCapacity) { return false; }
+        dst[op++] = (uint8_t)(offset & 0xFF);
+        dst[op++] = (uint8_t)(offset >> 8);
+        return (matchCode < 15 || writeLength(matchCode - 15));
+    };
 
-inline void
-unlockValueLocation(ValueLoc loc, std::array<std::mutex, ValueMutexQty>& valueMutexes)
-{
-    valueMutexes[getValueLockIndex(loc)].unlock();
+    // The hash table of the last positions of 4-byte sequences is sized with the input, so that small values stay cheap
+    uint32_t hashBits = 8;
+    while (hashBits < LzHashBits && ((size_t)1 << hashBits) < srcSize) { ++hashBits; }
+    uint32_t hashTable[1 << LzHashBits];
+    memset(hashTable, 0, sizeof(uint32_t) << hashBits);
+
+    size_t anchor = 0;
+    size_t ip     = 0;
+    while (ip + LzMinMatch <= srcSize) {
+        uint32_t sequence, candidateSequence;
+        memcpy(&sequence, &src[ip], sizeof(uint32_t));
+        uint32_t hash      = (sequence * 2654435761U) >> (32 - hashBits);
+        size_t   candidate = hashTable[hash];
+        hashTable[hash]    = (uint32_t)ip;
+        memcpy(&candidateSequence, &src[candidate], sizeof(uint32_t));
+        if (candidate >= ip || ip - candidate > LzMaxOffset || candidateSequence != sequence) {
+            ++ip;
+            continue;
+        }
+        size_t matchLength = LzMinMatch;
+        while (ip + matchLength < srcSize && src[candidate + matchLength] == src[ip + matchLength]) { ++matchLength; }
+        if (!writeSequence(&src[anchor], ip - anchor, matchLength, ip - candidate)) { return 0; }
+        ip += matchLength;
+        anchor = ip;
+    }
+    if ((anchor < srcSize || op == 0) && !writeSequence(&src[anchor], srcSize - anchor, 0, 0)) { return 0; }
+    return op;
 }
 
-class ValueCache
+inline bool
+lzDecompress(const uint8_t* src, size_t srcSize, uint8_t* dst, size_t dstSize)
 {
-    // Definitions
-    enum class LruType { None = 0, Hot = 1, Warm = 2, Cold = 3, Qty = 4 };
-
-    static constexpr int SmallBatchSize = 10;
-
-   public:
-    ValueCache(uint64_t valueMaxAllocBytes) : _tlsfAlloc(valueMaxAllocBytes) {}
-
-    ~ValueCache() {}
-
-    bool setTargetMemoryLoad(double load)
-    {
-        if (load < 0. || load > 1.0) { return false; }
-        _targetMemoryLoad = load;
+    size_t ip         = 0;
+    size_t op         = 0;
+    auto   readLength = [&](size_t& length) -> bool {
+        uint8_t b = 0;
+        do {
+            if (ip >= srcSize) { return false; }
+            b = src[ip++];
+            length += b;
+        } while (b == 255);
         return true;
-    }
+    };
 
-    // To call when all references to this memory is no more used
-    void reset() { _tlsfAlloc.reset(); }
+    while (ip < srcSize) {
+        uint8_t token         = src[ip++];
+        size_t  literalLength = (size_t)(token >> 4);
+        if (literalLength == 15 && !readLength(literalLength)) { return false; }
+        if (literalLength > srcSize - ip || literalLength > dstSize - op) { return false; }
+        if (literalLength > 0) { memcpy(&dst[op], &src[ip], literalLength); }
+        ip += literalLength;
+        op += literalLength;
+        if (ip == srcSize) { break; }  // Last sequence
+
+        if (srcSize - ip < 2) { return false; }
+        size_t offset = (size_t)src[ip] | ((size_t)src[ip + 1] << 8);
+        ip += 2;
+        size_t matchLength = (size_t)(token & 0xF);
+        if (matchLength == 15 && !readLength(matchLength)) { return false; }
+        matchLength += LzMinMatch;
+        if (offset == 0 || offset > op || matchLength > dstSize - op) { return false; }
+        if (offset >= matchLength) {
+            memcpy(&dst[op], &dst[op - offset], matchLength);
+            op += matchLength;
+        } else {
+            for (size_t i = 0; i < matchLength; ++i, ++op) { dst[op] = dst[op - offset]; }  // Overlapping copy
+        }
+    }
+    return (op == dstSize);
+}
 
-    bool isEnabled() const { return (getMaxAllocatableBytes() > 0); }
+// ==========================================================================================
+// Write lane
+// ==========================================================================================
 
-    uint64_t getAllocatedBytes() const { return _tlsfAlloc.getAllocatedBytes(); }
+// A write lane owns an active data file and its write buffer. Writers of different lanes do not serialize.
+// A write position is the active data file sequence number of the lane (32 MSB) and the offset in this data file (32 LSB)
+struct WriteLane {
+    alignas(CpuCacheLine) std::mutex mxActiveFile;  // lock for using the active file (write entry)
+    alignas(CpuCacheLine) RWLock mxWriteBuffer;     // lock for using the write buffer
+    lcVector<uint8_t>     writeBuffer;
+    uint32_t              activeDataOffset        = 0;
+    uint32_t              activeFlushedDataOffset = 0;  // Last "write buffer" write on disk
+    uint16_t              activeDataFileId        = 0xFFFF;
+    uint32_t              activeDataFileSeq       = 0;
+    std::atomic<uint64_t> flushedWritePosition    = 0;
+    std::atomic<uint64_t> syncedWritePosition     = 0;  // Synced at OS level
+
+    // Group commit of synced writes: the first waiting writer flushes the write buffer for all the others
+    std::mutex              groupCommitMutex;
+    std::condition_variable groupCommitCv;
+    bool                    isGroupCommitFlushOngoing = false;
+
+    // Last flush state seen by the upkeep thread
+    uint32_t upkeepLastActiveFlushedDataOffset = NotStored;
+    uint16_t upkeepLastActiveDataFileId        = 0xFFFF;
+
+    // Hint file of the active data file, written incrementally and finalized when the active data file is switched or closed
+    lcVector<uint8_t> hintBuffer;
+    FILE*             hintFh          = nullptr;
+    uint32_t          hintEntryQty    = 0;
+    uint32_t          hintKeyIndexQty = 0;
+};
 
-    uint64_t getMaxAllocatableBytes() const { return _tlsfAlloc.getMaxAllocatableBytes(); }
+// ==========================================================================================
+// TLSF allocator
+// ==========================================================================================
 
-    ValueLoc insertValue(const void* data, uint32_t size, uint64_t ownerId, uint32_t expTimeSec)
-    {
-        ++_stats.insertCallQty;
-        ValueLoc loc        = NotStored;
-        uint32_t targetSize = size + sizeof(ValueChunk);
+// This allocator possesses interesting properties for our usage: fast, code is small, response time is bounded, internal fragmentation
+// is bounded and external fragmentation is low in practice (good coalescing).
+// See http://www.gii.upv.es/tlsf/ for details. The code is inspired from https://github.com/jserv/tlsf-bsd .
+// It is not optimized for threading (as tcmalloc or jemalloc) and less efficient than ptmalloc (derived from dlmalloc described here
+// https://gee.cs.oswego.edu/dl/html/malloc.html. As TLSF, it is a "heap" allocator) which has specific handling of small and big sizes.
+// This implementation does not rely on "userland managed pages" but on virtual memory, which simplifies the code.
+// Such single-heap allocator enables the use of "compressed pointers" (32 bits instead of 64 bits), hence reducing overhead.
 
-        _mxMalloc.lock();
-        uint8_t* ptr = (uint8_t*)_tlsfAlloc.malloc(targetSize);
-        _mxMalloc.unlock();
+constexpr uint32_t TlsfAlignShift = 3;  // 3 LSB cleared = 8 bytes alignment
+constexpr uint32_t TlsfSlShift    = 4;  // 4 bits for the second layer, so 16 sub lists
+constexpr uint32_t TlsfFlShift    = TlsfSlShift + TlsfAlignShift;
+constexpr uint64_t TlsfSmallSize  = (1 << TlsfFlShift);  // Sizes less than 128 bytes go into the first layer
+constexpr uint32_t TlsfSlQty      = (1 << TlsfSlShift);
+constexpr uint32_t TlsfFlQty      = 32;  // Allows a theoritical max allocation of 1 << (32 + 3(align) + 4(sl) - (margin) 2)
 
-        // If allocation failed, some forced evictions are needed
-        if (!ptr) {
-            TlsfAllocator::CheckContext cc = _tlsfAlloc.getSizeCheckContext(targetSize);  // For optimized check of "allocatability"
+constexpr uint64_t TlsfBlockOverhead = sizeof(uint64_t);  // Size of 'dataSizeAndFlags' placed just before payloads
+constexpr uint64_t TlsfFlagFree      = 0x1;
+constexpr uint64_t TlsfFlagPrevFree  = 0x2;
 
-            int  remainingTries = SmallBatchSize;
-            bool isAllocatable  = false;
+struct tlsfBlock {
+    // The structure of a free block is:
+    //   [offset -  8]  pointer to previous block in memory. Valid only if the previous block is free
+    //   [offset +  0]  [bit 31 <- bit 2] block size    [bit 1] flag prev block is free   [bit 0] flag block is free
+    //   [offset +  8]  Next free block in free list
+    //   [offset + 16]  Previous free block in free list
+    //
+    // The structure of a used block is:
+    //   [offset -  8]  pointer to previous block in memory. Valid only if the previous block is free
+    //   [offset +  0]  [bit 31 <- bit 2] block size    [bit 1] flag prev block is free   [bit 0] flag block is free
+    //   [offset +  8]  payload (seen by user)
 
-            do {
-                _mxLrus.lock();
-                if (_queues[(uint32_t)LruType::Cold].tail == NotStored) {
-                    updateLruHotAndWarm(SmallBatchSize);
-                    if (_queues[(uint32_t)LruType::Cold].tail == NotStored) {
-                        _mxLrus.unlock();
-                        break;
-                    }
-                }
+    tlsfBlock* prevBlockIfFree;   // Valid only if previous block is free. That is why we need the 'PrevBlockIsFree' flag
+    uint64_t   dataSizeAndFlags;  // Real block info = overhead
+    tlsfBlock* nextFreeBlock;     // Valid only if block is free. Else it is the start of the payload
+    tlsfBlock* prevFreeBlock;     // Valid only if block is free. Else it is part the payload
 
-                ValueLoc locEvict = _queues[(uint32_t)LruType::Cold].tail;
+    char* header() { return (char*)this + offsetof(tlsfBlock, dataSizeAndFlags); }
 
-                if (locEvict != NotStored) {
-                    lockValueLocation(locEvict, _valueMutexes);
-                    ValueChunk* c = getValueChunk(locEvict);
-                    // If entry is active, move it to warm
-                    if (c->flags & ValueFlagActive) {
-                        lruRemove(c);
-                        lruInsertFront(LruType::Warm, locEvict, c);
-                    }
-                    // Else we found our eviction
-                    else {
-                        lruRemove(c);
-                        c->ownerId = 0;
-                        _mxMalloc.lock();
-                        _tlsfAlloc.free(c);
-                        _mxMalloc.unlock();
-                        ++_stats.evictedQty;
-                        --_stats.currentInCacheValueQty;
-                        isAllocatable = _tlsfAlloc.isAllocatable(cc);  // Cheap check
-                    }
-                    unlockValueLocation(locEvict, _valueMutexes);
-                }
-                _mxLrus.unlock();
+    char* payload() { return header() + sizeof(dataSizeAndFlags); }
 
-            } while (remainingTries-- && !isAllocatable);
+    static tlsfBlock* fromPayload(void* mem) { return (tlsfBlock*)((char*)mem - offsetof(tlsfBlock, nextFreeBlock)); }
 
-            if (isAllocatable) {
-                _mxMalloc.lock();
-                ptr = (uint8_t*)_tlsfAlloc.malloc(targetSize);
-                _mxMalloc.unlock();
-            }
-        }
+    tlsfBlock* getNext() { return (tlsfBlock*)(header() + getPayloadSize()); }
 
-        if (!ptr) { return NotStored; }
+    void setPayloadSize(uint64_t size) { dataSizeAndFlags = size | (dataSizeAndFlags & (TlsfFlagFree | TlsfFlagPrevFree)); }
 
-        // Install meta data before the data
-        ValueChunk* c = (ValueChunk*)ptr;
-        c->ownerId    = ownerId;
-        c->expTimeSec = expTimeSec;
-        c->size       = size;
-        c->flags      = 0;
-        memcpy(((uint8_t*)c) + sizeof(ValueChunk), data, size);
+    uint64_t getPayloadSize() const { return (dataSizeAndFlags & ~(TlsfFlagFree | TlsfFlagPrevFree)); }
 
-        ++_stats.currentInCacheValueQty;
+    bool isFree() const { return (dataSizeAndFlags & TlsfFlagFree); }
 
-        // Insert this new entry inside the Hot queue
-        loc = _tlsfAlloc.compress(ptr);
-        _mxLrus.lock();
-        lruInsertFront(LruType::Hot, loc, c);
-        _mxLrus.unlock();
+    bool isPrevFree() const { return (dataSizeAndFlags & TlsfFlagPrevFree); }
 
-        return loc;
+    void setFree(bool state)
+    {
+        assert(isFree() != state && "block free bit unchanged");
+        dataSizeAndFlags      = state ? (dataSizeAndFlags | TlsfFlagFree) : (dataSizeAndFlags & ~TlsfFlagFree);
+        tlsfBlock* next       = getNext();
+        next->prevBlockIfFree = this;
+        next->setPrevFree(state);
     }
 
-    bool removeValue(ValueLoc loc, uint64_t ownerId)
+    void setPrevFree(bool state)
     {
-        ++_stats.removeCallQty;
-        if (loc == NotStored) { return false; }
-
-        _mxLrus.lock();
-        lockValueLocation(loc, _valueMutexes);
-        ValueChunk* c = getValueChunk(loc);
-
-        // Check the ownerId and some sanity fields
-        // By calling this function, the reference to `loc` is already removed in the above layers
-        if (c->ownerId != ownerId || c->size == NotStored) {
-            unlockValueLocation(loc, _valueMutexes);
-            _mxLrus.unlock();
-            return false;
-        }
-
-        // Invalidate
-        lruRemove(c);
-        c->ownerId = 0;
-
-        unlockValueLocation(loc, _valueMutexes);
-        _mxLrus.unlock();
-
-        // Free
-        _mxMalloc.lock();
-        _tlsfAlloc.free(c);
-        _mxMalloc.unlock();
-        --_stats.currentInCacheValueQty;
-
-        return true;
+        dataSizeAndFlags = state ? (dataSizeAndFlags | TlsfFlagPrevFree) : (dataSizeAndFlags & ~TlsfFlagPrevFree);
     }
+};
 
-    bool getValue(ValueLoc loc, uint64_t checKOwnerId, uint32_t checkValueSize, lcVector<uint8_t>& data)
+class TlsfAllocator
+{
+   public:
+    TlsfAllocator(uint64_t maxAllocatableBytes)
     {
-        ++_stats.getCallQty;
-        if (loc == NotStored) { return false; }
-
-        lockValueLocation(loc, _valueMutexes);
-        ValueChunk* c = getValueChunk(loc);
-
-        // Check the ownerId and size, as this 'loc' could have been meanwhile evicted
-        if (c->ownerId != checKOwnerId || c->size != checkValueSize) {
-            unlockValueLocation(loc, _valueMutexes);
-            ++_stats.missQty;
-            return false;
+        if (maxAllocatableBytes) {
+#if defined(_MSC_VER)
+            // On Windows, virtual allocation is better done in two phases: first reserve the total, then commit by chunks
+            SYSTEM_INFO sSysInfo;
+            GetSystemInfo(&sSysInfo);
+            _allocGranularity         = sSysInfo.dwAllocationGranularity;  // Preferred to page size, which is very small for our usage
+            _arenaMaxAllocatableBytes = ((maxAllocatableBytes + _allocGranularity - 1) / _allocGranularity) * _allocGranularity;
+            _arenaBasePtr             = (uint8_t*)VirtualAlloc(NULL, _arenaMaxAllocatableBytes, MEM_RESERVE, PAGE_NOACCESS);
+            assert(_arenaBasePtr);
+#else
+            _arenaMaxAllocatableBytes = maxAllocatableBytes;
+            _arenaBasePtr             = (uint8_t*)mmap(nullptr, _arenaMaxAllocatableBytes, PROT_READ | PROT_WRITE,
+                                                       MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+            assert(_arenaBasePtr != MAP_FAILED);  // NOLINT
+#endif
+            assert((((uintptr_t)_arenaBasePtr) % (1 << TlsfAlignShift)) == 0);
         }
+    }
 
-        // Update the LRU
-        c->flags |= ValueFlagActive;
-        ++_stats.hitQty;
-
-        // Copy data to the output
-        data.resize(c->size);
-        memcpy(data.data(), ((uint8_t*)c) + sizeof(ValueChunk), c->size);
+    ~TlsfAllocator()
+    {
+        if (_arenaMaxAllocatableBytes) {
+#if defined(_MSC_VER)
+            [[maybe_unused]] bool status = VirtualFree(_arenaBasePtr, 0, MEM_RELEASE);
+            assert(status);
+#else
+            [[maybe_unused]] int status = munmap(_arenaBasePtr, _arenaMaxAllocatableBytes);
+            assert(status == 0);
+#endif
+        }
+    }
 
-        unlockValueLocation(loc, _valueMutexes);
-        return true;
+    bool setMemoryPolicy(const MemoryPolicy& policy)
+    {
+        bool isApplied = true;
+        if (_arenaMaxAllocatableBytes) { isApplied = osApplyMemoryPolicy(_arenaBasePtr, _arenaMaxAllocatableBytes, policy, _memoryPolicy); }
+        _memoryPolicy = policy;
+        return isApplied;
     }
 
-    // Upkeeping background task
-    void backgroundUpdateLru(uint32_t batchSize)
+    void reset()
     {
-        // Loop until no more work to do or batch exhausted
-        while (batchSize > 0) {
-            _mxLrus.lock();
-            uint32_t consumed = updateLruHotAndWarm(batchSize);
-            _mxLrus.unlock();
-            batchSize = (consumed == 0 || consumed > batchSize) ? 0 : batchSize - consumed;
-        }
+        // Reset the allocator. This invalidates all previous allocations
+        _arenaAllocatedBytes = 0;
+        _flBitmap            = 0;
+        memset(_slBitmaps, 0, sizeof(_slBitmaps));
+        memset(_freeBlocks, 0, sizeof(_freeBlocks));
+        _statAllocatedBytes = 0;
     }
 
-    // Upkeeping background task
-    void backgroundPreventiveEviction(uint32_t batchSize)
+    void* malloc(uint64_t size)
     {
-        if (!isEnabled()) { return; }
+        uint64_t adjustedSize = getAdjustedSize(size);
+        if (LITECASK_UNLIKELY(adjustedSize == 0)) return nullptr;
 
-        uint64_t targetAllocatedBytes = (uint64_t)(_targetMemoryLoad * (double)_tlsfAlloc.getMaxAllocatableBytes());
+        // Compute the initial layer indexes
+        uint32_t firstLayerIdx = 0, secondLayerIdx = 0;
+        findSizeFittingList(adjustedSize, &firstLayerIdx, &secondLayerIdx);
 
-        // Loop until no more work to do or batch exhausted
-        while ((batchSize--) > 0 && _tlsfAlloc.getAllocatedBytes() > targetAllocatedBytes) {
-            _mxLrus.lock();
-            if (_queues[(uint32_t)LruType::Cold].tail == NotStored) {
-                updateLruHotAndWarm(SmallBatchSize);
-                if (_queues[(uint32_t)LruType::Cold].tail == NotStored) {
-                    _mxLrus.unlock();
-                    break;
-                }
-            }
+        tlsfBlock* block = nullptr;
+        for (int pass = 0; !block && pass < 2; ++pass) {
+            // Second chance is after growing the arena
+            if (LITECASK_UNLIKELY(pass == 1 && !extendArena(adjustedSize))) { return nullptr; }
 
-            ValueLoc loc = _queues[(uint32_t)LruType::Cold].tail;
+            // Is the second layer of the targeted first layer populated for this size?
+            uint32_t slBitmap = _slBitmaps[firstLayerIdx] & ~((1U << secondLayerIdx) - 1);  // Clear the too small sizes
+            if (!slBitmap) {
+                // Need to look up larger first level lists
+                uint32_t flBitmap = _flBitmap & (~((1U << (firstLayerIdx + 1)) - 1));
+                if (LITECASK_UNLIKELY(!flBitmap)) { continue; }  // No such free blocks available, go to next pass
 
-            if (loc != NotStored) {
-                lockValueLocation(loc, _valueMutexes);
-                ValueChunk* c = getValueChunk(loc);
-                // If entry is active, move it to warm
-                if (c->flags & ValueFlagActive) {
-                    lruRemove(c);
-                    lruInsertFront(LruType::Warm, loc, c);
-                }
-                // Else we found our eviction
-                else {
-                    lruRemove(c);
-                    c->ownerId = 0;
-                    _mxMalloc.lock();
-                    _tlsfAlloc.free(c);
-                    _mxMalloc.unlock();
-                    ++_stats.evictedQty;
-                    --_stats.currentInCacheValueQty;
-                }
-                unlockValueLocation(loc, _valueMutexes);
+                // Update the first layer to this larger one
+                firstLayerIdx = countTrailingZeros(flBitmap);  // Take the lowest bit available, as the bitmap has been masked accordingly
+                slBitmap      = _slBitmaps[firstLayerIdx];     // Update the second layer bitmap, any of these list would fit
+                assert(slBitmap && "second level bitmap is null in spite of the first level bitmap");
             }
-            _mxLrus.unlock();
 
-        }  // End of batch processing
-    }
+            secondLayerIdx = countTrailingZeros(slBitmap);  // Take the lowest bit available, as the bitmap has been masked accordingly
+            assert(secondLayerIdx < TlsfSlQty && "wrong second level");
+            block = _freeBlocks[firstLayerIdx][secondLayerIdx];
+        }
+        assert(block);
+        assert(block && block->getPayloadSize() >= size && "insufficient block size");
 
-    const ValueCacheCounters& getCounters() const { return _stats; }
+        detachFreeBlockFromFreeList(block, firstLayerIdx, secondLayerIdx);
 
-    void dump() const
-    {
-        printf("Cache:\n");
-        printf("  insert call: %" PRId64 "\n", _stats.insertCallQty.load());
-        printf("  get    call: %" PRId64 "\n", _stats.getCallQty.load());
-        printf("  remove call: %" PRId64 "\n", _stats.removeCallQty.load());
-        printf("  hit     qty: %" PRId64 "\n", _stats.hitQty.load());
-        printf("  miss    qty: %" PRId64 "\n", _stats.missQty.load());
-        printf("  evicted qty: %" PRId64 "\n", _stats.evictedQty.load());
-        printf("  hit   ratio: %.3f\n", (double)_stats.hitQty / (double)std::max((uint64_t)1, _stats.hitQty + _stats.missQty));
-    }
+        // Split this free block to isolate the (left) part that will be used
+        if (block->getPayloadSize() >= sizeof(tlsfBlock) + size) {
+            // Split a block into two, the second of which is free
+            tlsfBlock* rightBlock        = (tlsfBlock*)(block->header() + size);
+            uint64_t   rightBlockSize    = block->getPayloadSize() - (size + TlsfBlockOverhead);
+            rightBlock->dataSizeAndFlags = rightBlockSize | 0;  // Initialize without flags
+            rightBlock->setFree(true);
 
-   private:
-    ValueChunk* getValueChunk(KeyLoc loc) const { return (ValueChunk*)_tlsfAlloc.uncompress(loc); }
+            // Deduce the removed size from the block
+            block->setPayloadSize(size);
 
-    // Lock shall be taken beforehand
-    void lruRemove(ValueChunk* c)
-    {
-        assert((c->flags & ValueFlagQueueTypeMask) != (uint32_t)LruType::None);
-        LruQueue& queue = _queues[c->flags & ValueFlagQueueTypeMask];
-        c->flags        = (uint32_t)LruType::None;  // No more present in any LRU
+            // Link the two blocks as "consecutive"
+            block->getNext()->prevBlockIfFree = block;
+            rightBlock->setPrevFree(true);  // 'block' is not yet in use
 
-        if (c->prev != NotStored) {
-            getValueChunk(c->prev)->next = c->next;
-        } else {
-            queue.head = c->next;
-        }
-        if (c->next != NotStored) {
-            getValueChunk(c->next)->prev = c->prev;
-        } else {
-            queue.tail = c->prev;
+            // Insert the remaining free part of the block in the free list
+            insertBlockInFreeList(rightBlock);
         }
-        assert(queue.bytes >= c->size);
-        queue.bytes -= c->size;
+
+        // Mark the block as used
+        block->setFree(false);
+        _statAllocatedBytes += TlsfBlockOverhead + block->getPayloadSize();
+        return block->payload();
     }
 
-    // Lock shall be taken beforehand
-    void lruInsertFront(LruType lruType, ValueLoc loc, ValueChunk* c)
+    void free(void* mem)
     {
-        assert(lruType != LruType::None);
-        assert((c->flags & ValueFlagQueueTypeMask) == (uint32_t)LruType::None);
-        LruQueue& queue = _queues[(uint32_t)lruType];
+        if (LITECASK_UNLIKELY(!mem)) { return; }
 
-        c->flags = (uint16_t)lruType;  // Active flag is cleared when bumped
-        c->prev  = NotStored;
-        if (queue.head != NotStored) {
-            getValueChunk(queue.head)->prev = loc;
-            c->next                         = queue.head;
-        } else {
-            queue.tail = loc;
-            c->next    = NotStored;
-        }
-        queue.head = loc;
-        queue.bytes += c->size;
-    }
+        // Back to the block structure
+        tlsfBlock* block = tlsfBlock::fromPayload(mem);
 
-    uint32_t updateLruHotAndWarm(uint32_t batchSize)
-    {
-        int64_t allBytes = (int64_t)_queues[(uint32_t)LruType::Hot].bytes + (int64_t)_queues[(uint32_t)LruType::Warm].bytes +
-                           (int64_t)_queues[(uint32_t)LruType::Cold].bytes;
-        ValueLoc loc      = NotStored;
-        uint32_t consumed = 0;
+        assert(!block->isFree() && "block already marked as free");
+        block->setFree(true);
+        assert(_statAllocatedBytes >= TlsfBlockOverhead + block->getPayloadSize());
+        _statAllocatedBytes -= TlsfBlockOverhead + block->getPayloadSize();
 
-        // Move from Hot to Warm or Cold
-        int64_t moveQty   = batchSize;
-        int64_t moveBytes = std::max((int64_t)0, (int64_t)_queues[(uint32_t)LruType::Hot].bytes - (allBytes * 20 / 100));
-        while (moveQty-- && moveBytes > 0 && (loc = _queues[(uint32_t)LruType::Hot].tail) != NotStored) {
-            lockValueLocation(loc, _valueMutexes);
-            ValueChunk* c        = getValueChunk(loc);
-            bool        isActive = (c->flags & ValueFlagActive);
-            lruRemove(c);
-            // Move it to the Warm or Cold LRU, depending on its active state
-            lruInsertFront(isActive ? LruType::Warm : LruType::Cold, loc, c);
-            moveBytes -= c->size;
-            ++consumed;
-            unlockValueLocation(loc, _valueMutexes);
-        }
+        // Merge this free block with previous one if it is free
+        block = mergeBlockWithPreviousIfFree(block);
 
-        // Move from Warm to Warm (bumped) or Cold
-        moveQty   = batchSize;
-        moveBytes = std::max((int64_t)0, (int64_t)_queues[(uint32_t)LruType::Warm].bytes - (allBytes * 40 / 100));
-        while (moveQty-- && moveBytes > 0 && (loc = _queues[(uint32_t)LruType::Warm].tail) != NotStored) {
-            lockValueLocation(loc, _valueMutexes);
-            ValueChunk* c        = getValueChunk(loc);
-            bool        isActive = (c->flags & ValueFlagActive);
-            lruRemove(c);
-            // Move it to the Warm or Cold LRU, depending on its access state
-            lruInsertFront(isActive ? LruType::Warm : LruType::Cold, loc, c);
-            moveBytes -= c->size;
-            ++consumed;
-            unlockValueLocation(loc, _valueMutexes);
-        }
+        // Merge this free block with next one if it is free
+        tlsfBlock* next = block->getNext();
+        assert(next && "next block can't be null");
+        if (next->isFree()) {
+            // Remove the next block from the free list
+            uint32_t firstLayerIdx = 0, secondLayerIdx = 0;
+            findSizeFittingList(next->getPayloadSize(), &firstLayerIdx, &secondLayerIdx);
+            detachFreeBlockFromFreeList(next, firstLayerIdx, secondLayerIdx);
 
-        // Note: Move from Cold to Warm is performed independently. It depends on the cache filled ratio.
+            // Absorb the next block inside the current one
+            block->dataSizeAndFlags += next->getPayloadSize() + TlsfBlockOverhead;  // Flags untouched
+            block->getNext()->prevBlockIfFree = block;
+        }
 
-        return consumed;
+        // Back in one of the free lists
+        insertBlockInFreeList(block);
     }
 
-    struct LruQueue {
-        ValueLoc head  = NotStored;
-        ValueLoc tail  = NotStored;
-        uint32_t bytes = 0;
-    };
-    std::mutex _mxLrus;
-    std::mutex _mxMalloc;
-    LruQueue   _queues[(uint32_t)LruType::Qty];
-    double     _targetMemoryLoad = 0.90;
+    uint32_t compress(uint8_t* ptr) const { return (uint32_t)((uint64_t)(ptr - _arenaBasePtr) >> 3); }
 
-    TlsfAllocator                         _tlsfAlloc;
-    ValueCacheCounters                    _stats;
-    std::array<std::mutex, ValueMutexQty> _valueMutexes;
-};
+    uint8_t* uncompress(uint32_t compressedPtr) const { return _arenaBasePtr + (((uint64_t)compressedPtr) << 3); }
 
-// ==========================================================================================
-// Index Hashmap
-// ==========================================================================================
+    uint64_t getRealAllocatedSize(void* mem) { return tlsfBlock::fromPayload(mem)->getPayloadSize(); }
 
-struct IndexChunk {
-    uint32_t keyPartSize;  // Length in bytes of the tag (=part of the key)
-    uint32_t entries;      // Quantity of used entries
-    // uint8_t keyPart[0] the part of the key is stored here (padded to 4 bytes), followed by the list of hash32 of related entries
-    uint32_t* getHashArrayStart() const
-    {
-        constexpr uint32_t AlignMask = (uint32_t)(sizeof(uint32_t) - 1);
-        return (uint32_t*)((uint8_t*)this + sizeof(IndexChunk) + ((keyPartSize + AlignMask) & (~AlignMask)));
-    }
-};
+    // Returns the in-used quantity (free + overhead), not the mmap-ed one
+    uint64_t getAllocatedBytes() const { return _statAllocatedBytes; }
 
-class IndexMap
-{
-   public:
-    IndexMap(uint64_t indexMaxAllocBytes, uint32_t initMapSize) : _tlsfAlloc(indexMaxAllocBytes)
-    {
-        // Sanity: Check that the initial size is a power of 2
-        uint32_t checkSize = initMapSize;
-        while ((checkSize & 1) == 0) checkSize >>= 1;
-        assert(checkSize == 1);
+    uint64_t getMaxAllocatableBytes() const { return _arenaMaxAllocatableBytes; }
 
-        // Allocate the initial map and key storage
-        resize(initMapSize);
-    }
+    struct CheckContext {
+        uint32_t firstLayerIdx;
+        uint32_t secondLayerIdx;
+        uint32_t firstLayerMask;
+        uint32_t secondLayerMask;
+    };
 
-    ~IndexMap()
+    static CheckContext getSizeCheckContext(uint64_t size)
     {
-        delete[] _table0.allocPtr;
-        delete[] _table1.allocPtr;
+        CheckContext cc{};
+        uint64_t     adjustedSize = getAdjustedSize(size);
+        findSizeFittingList(adjustedSize, &cc.firstLayerIdx, &cc.secondLayerIdx);
+        cc.firstLayerMask  = ~((1U << (cc.firstLayerIdx + 1)) - 1);  // Any bit set in this FL mask is ok
+        cc.secondLayerMask = ~((1U << cc.secondLayerIdx) - 1);       // Any bit set in this SL mask from FL firstLayerIdx is ok
+        return cc;
     }
 
-    void clear()
+    bool isAllocatable(const CheckContext& cc) const
     {
-        for (uint32_t i = 0; i < _table0.maxSize; ++i) { _table0.nodes[i].hash = Empty; }
-        _table0.size = 0;
-        for (uint32_t i = 0; i < _table1.maxSize; ++i) { _table1.nodes[i].hash = Empty; }
-        _table1.size = 0;
+        return (_slBitmaps[cc.firstLayerIdx] & cc.secondLayerMask) || (_flBitmap & cc.firstLayerMask);
     }
 
-    uint32_t size() const { return _table0.size + _table1.size; }
-
-    uint32_t capacity() const { return std::max(_table0.maxSize, _table1.maxSize); }
-
-    bool empty() const { return (size() == 0); }
-
-    static constexpr uint64_t Empty      = 0;
-    static constexpr uint64_t FirstValid = 1;
-
-    // An external writer RW-lock shall ensure 1 writer at a time
-    Status insertIndex(const void* keyPart, uint32_t keyPartSize, uint32_t entryKeyHash)
+#ifndef LITECASK_BUILD_FOR_TEST  // Allows looking inside the allocator internal, for testing purposes
+   private:
+#endif
+    // Fix the provided size (minimum size + alignment) and return the corresponding size in the free list
+    static uint64_t getAdjustedSize(uint64_t& size)
     {
-        uint32_t keyHash = (uint32_t)LITECASK_HASH_FUNC(keyPart, keyPartSize);
-        if (keyHash < FirstValid) keyHash += FirstValid;
-        if (entryKeyHash < FirstValid) entryKeyHash += FirstValid;
-
-        Table*   currentTable = _currentTable.load();
-        uint32_t mask         = (currentTable->maxSize - 1) & (~(KeyDirAssocQty - 1));
-        int      idx          = keyHash & mask;
-        uint32_t probeIncr    = 1;
-        uint32_t cellId       = 0;
-
-        while (true) {
-            cellId = 0;
-            while (cellId < KeyDirAssocQty && currentTable->nodes[idx + cellId].hash >= FirstValid) {
-                if (currentTable->nodes[idx + cellId].hash == keyHash) {
-                    IndexChunk* indexChunk = (IndexChunk*)_tlsfAlloc.uncompress(currentTable->nodes[idx + cellId].loc);
-                    if (indexChunk->keyPartSize == keyPartSize &&
-                        !memcmp(((uint8_t*)indexChunk) + sizeof(IndexChunk), keyPart, keyPartSize)) {
-                        // Match found, entry update case
-                        _optimisticsCounters[keyHash & OptCounterMask]++;
-
-                        const uint32_t arrayStartOffset    = (uint32_t)((uint8_t*)indexChunk->getHashArrayStart() - (uint8_t*)indexChunk);
-                        const uint32_t accessibleEntrySize = (uint32_t)(_tlsfAlloc.getRealAllocatedSize(indexChunk) - arrayStartOffset);
-                        if ((indexChunk->entries + 1) * sizeof(uint32_t) > accessibleEntrySize) {
-                            // New allocation required because the current one is too small
-                            const uint32_t newMaxEntries = 2 * indexChunk->entries;
-                            uint32_t       targetSize    = arrayStartOffset + newMaxEntries * (uint32_t)sizeof(uint32_t);
-                            uint8_t*       ptr           = (uint8_t*)_tlsfAlloc.malloc(targetSize);
-                            if (ptr == nullptr) { return Status::OutOfMemory; }
-                            memcpy(ptr, indexChunk, arrayStartOffset + indexChunk->entries * sizeof(uint32_t));
-                            currentTable->nodes[idx + cellId].loc = _tlsfAlloc.compress(ptr);
-                            _tlsfAlloc.free(indexChunk);
-                            indexChunk = (IndexChunk*)ptr;
-                        }
-
-                        // Store the new entry
-                        assert((indexChunk->entries + 1) * sizeof(uint32_t) <=
-                               (uint32_t)(_tlsfAlloc.getRealAllocatedSize(indexChunk) - arrayStartOffset));
-                        indexChunk->getHashArrayStart()[indexChunk->entries++] = entryKeyHash;
-
-                        _optimisticsCounters[keyHash & OptCounterMask]++;
-                        return Status::Ok;
-                    }
-                }
-                ++cellId;
-            }
-
-            if (cellId < KeyDirAssocQty) { break; }  // Empty space spotted on this cache line, so key has not been found
-            idx = (idx + (probeIncr * KeyDirAssocQty)) & mask;
-            ++probeIncr;  // Between linear and quadratic probing
-        }
-
-        const uint32_t     newMaxEntries = 2;  // Starts with 2 elements max
-        constexpr uint32_t AlignMask     = (uint32_t)(sizeof(uint32_t) - 1);
-        uint32_t           targetSize = sizeof(IndexChunk) + ((keyPartSize + AlignMask) & (~AlignMask)) + newMaxEntries * sizeof(uint32_t);
-        uint8_t*           ptr        = (uint8_t*)_tlsfAlloc.malloc(targetSize);
-        if (ptr == nullptr) { return Status::OutOfMemory; }
-        IndexChunk* indexChunk = (IndexChunk*)ptr;
-        *indexChunk            = {keyPartSize, 0};
-        memcpy(ptr + sizeof(IndexChunk), keyPart, keyPartSize);
-        indexChunk->getHashArrayStart()[indexChunk->entries++] = entryKeyHash;
-        currentTable->nodes[idx + cellId]                      = {keyHash, _tlsfAlloc.compress(ptr)};
+        // Adjust the allocated size (ceil-aligned with a minimum value)
+        constexpr uint64_t TlsfMaxSize = ((uint64_t)1) << (TlsfFlQty + TlsfFlShift - 2);  // 64 GB should be enough for everyone
+        // Min size is 24 bytes in this implementation. It could be halved with compressed pointers and reduced max allocatable size.
+        // However, no benefit would be provided in the context of Litecask, as minimum key and value chunks are above this size.
+        constexpr uint64_t MinAllocatedSize = sizeof(tlsfBlock) - sizeof(tlsfBlock*);
+        constexpr uint64_t AlignmentMask    = (1 << TlsfAlignShift) - 1;  // 0x7 when decrypted, 8 bytes alignment
+        size                                = std::max((size + AlignmentMask) & (~AlignmentMask), MinAllocatedSize);
+        if (LITECASK_UNLIKELY(size > TlsfMaxSize)) { return 0; }
 
-        currentTable->size += 1;
-        if ((uint64_t)128 * (_table0.size + _table1.size) > _maxLoadFactor128th * currentTable->maxSize) {
-            resize(2 * currentTable->maxSize);
+        // Find the list of free blocks with big enough size
+        uint64_t adjustedSize = size;
+        if (size >= TlsfSmallSize) {
+            uint32_t firstLayerBitIdx = (uint32_t)(63 - countLeadingZeros(size));
+            uint64_t layersBitMask    = (((uint64_t)1) << (firstLayerBitIdx - TlsfSlShift)) - 1;
+            // Keep only bits from first and second layers, with a ceiling
+            adjustedSize = (size + layersBitMask) & ~layersBitMask;
         }
-        return Status::Ok;
+        return adjustedSize;
     }
 
-    // An external reader RW-lock shall ensure that there is no edit at the same time
-    uint32_t getEntryHashes(const void* keyPart, uint16_t keyPartSize, lcVector<uint32_t>* entryHashes = nullptr)
+    static void findSizeFittingList(uint64_t size, uint32_t* firstLayerIdx, uint32_t* secondLayerIdx)
     {
-        uint32_t keyHash = (uint32_t)LITECASK_HASH_FUNC(keyPart, keyPartSize);
-        if (keyHash < FirstValid) keyHash += FirstValid;
-
-        Table*   currentTable = _currentTable.load();
-        uint32_t mask         = (currentTable->maxSize - 1) & (~(KeyDirAssocQty - 1));
-        int      idx          = keyHash & mask;
-        uint32_t probeIncr    = 1;
-
-        while (true) {
-            uint32_t cellId = 0;
-            for (; cellId < KeyDirAssocQty && currentTable->nodes[idx + cellId].hash >= FirstValid; ++cellId) {
-                if (currentTable->nodes[idx + cellId].hash == keyHash) {
-                    IndexChunk* indexChunk = (IndexChunk*)_tlsfAlloc.uncompress(currentTable->nodes[idx + cellId].loc);
-                    if (indexChunk->keyPartSize == keyPartSize &&
-                        !memcmp(((uint8_t*)indexChunk) + sizeof(IndexChunk), keyPart, keyPartSize)) {
-                        if (entryHashes) {
-                            entryHashes->resize(indexChunk->entries);
-                            memcpy(entryHashes->data(), indexChunk->getHashArrayStart(), indexChunk->entries * sizeof(uint32_t));
-                        }
-                        return indexChunk->entries;
-                    }
-                }
-            }
-
-            if (cellId < KeyDirAssocQty) { break; }  // Empty space spotted on this cache line, so key has not been found
-            idx = (idx + (probeIncr * KeyDirAssocQty)) & mask;
-            ++probeIncr;  // Between linear and quadratic probing
+        // Due to the 8-bytes alignment constraint multiplied by the 16 second layers, the initial first layers
+        // are not fully populated.
+        // We choose to populate only the layer 0 for "small" block size (128=2^7) then the natural first layers
+        if (size < TlsfSmallSize) {
+            *firstLayerIdx  = 0;
+            *secondLayerIdx = (uint32_t)(size / (TlsfSmallSize / TlsfSlQty));  // Step is 128/16 = 8 bytes
+        } else {
+            uint32_t firstLayerBitIdx = (uint32_t)(63 - countLeadingZeros(size));
+            *firstLayerIdx            = 1 + firstLayerBitIdx - TlsfFlShift;
+            // Shift to keep the second layer bits starting at bit0, and clear the top bit (set to 1, first layer)
+            *secondLayerIdx = (uint32_t)(size >> (firstLayerBitIdx - TlsfSlShift)) & (TlsfSlQty - 1);
         }
-
-        // Not found
-        return 0;
+        assert(*firstLayerIdx < TlsfFlQty && "wrong first level");
+        assert(*secondLayerIdx < TlsfSlQty && "wrong second level");
     }
 
-    // An external writer RW-lock shall ensure 1 writer at a time and keep the lock as long as the returned array is used
-    bool getEntryHashesForUpdate(const void* keyPart, uint32_t keyPartSize, uint32_t** entryHashes, uint32_t** entries)
+    void detachFreeBlockFromFreeList(tlsfBlock* block, uint32_t firstLayerIdx, uint32_t secondLayerIdx)
     {
-        uint32_t keyHash = (uint32_t)LITECASK_HASH_FUNC(keyPart, keyPartSize);
-        if (keyHash < FirstValid) keyHash += FirstValid;
-
-        Table*   currentTable = _currentTable.load();
-        uint32_t mask         = (currentTable->maxSize - 1) & (~(KeyDirAssocQty - 1));
-        int      idx          = keyHash & mask;
-        uint32_t probeIncr    = 1;
+        // Detach the block from list neighbors
+        tlsfBlock* prev = block->prevFreeBlock;
+        tlsfBlock* next = block->nextFreeBlock;
+        if (next) { next->prevFreeBlock = prev; }
+        if (prev) { prev->nextFreeBlock = next; }
 
-        while (true) {
-            uint32_t cellId = 0;
-            for (; cellId < KeyDirAssocQty && currentTable->nodes[idx + cellId].hash >= FirstValid; ++cellId) {
-                if (currentTable->nodes[idx + cellId].hash == keyHash) {
-                    IndexChunk* indexChunk = (IndexChunk*)_tlsfAlloc.uncompress(currentTable->nodes[idx + cellId].loc);
-                    if (indexChunk->keyPartSize == keyPartSize &&
-                        !memcmp(((uint8_t*)indexChunk) + sizeof(IndexChunk), keyPart, keyPartSize)) {
-                        *entryHashes = indexChunk->getHashArrayStart();
-                        *entries     = &(indexChunk->entries);
-                        return true;
-                    }
-                }
+        // Update list head if needed
+        if (_freeBlocks[firstLayerIdx][secondLayerIdx] == block) {
+            _freeBlocks[firstLayerIdx][secondLayerIdx] = next;
+            if (!next) {                                                              // Update bitmaps if the list is empty
+                _slBitmaps[firstLayerIdx] &= ~(1U << secondLayerIdx);                 // Second layer bitmap
+                if (!_slBitmaps[firstLayerIdx]) _flBitmap &= ~(1U << firstLayerIdx);  // First layer bitmap if second layer is empty
             }
-
-            if (cellId < KeyDirAssocQty) { break; }  // Empty space spotted on this cache line, so key has not been found
-            idx = (idx + (probeIncr * KeyDirAssocQty)) & mask;
-            ++probeIncr;  // Between linear and quadratic probing
         }
-
-        // Not found, which is not supposed to happen unless the index is removed in-between
-        return false;
     }
 
-    // Above this load factor, the KeyDir will get resized
-    bool setMaxLoadFactor(double f)
+    void insertBlockInFreeList(tlsfBlock* block)
     {
-        if (f <= 0. || f > 1.) return false;
-        _maxLoadFactor128th = (uint64_t)(128. * f);
-        return true;
-    }
+        // Find the fitting list
+        uint32_t firstLayerIdx = 0, secondLayerIdx = 0;
+        findSizeFittingList(block->getPayloadSize(), &firstLayerIdx, &secondLayerIdx);
 
-    double getLoadFactor() const
-    {
-        return (double)(_table0.size + _table1.size) / (double)std::max(std::max(_table0.maxSize, _table1.maxSize), 1U);
-    }
+        // Insert in the list
+        tlsfBlock* current   = _freeBlocks[firstLayerIdx][secondLayerIdx];
+        block->nextFreeBlock = current;
+        block->prevFreeBlock = nullptr;
+        if (current) current->prevFreeBlock = block;
+        _freeBlocks[firstLayerIdx][secondLayerIdx] = block;
 
-    uint64_t getEstimatedUsedMemoryBytes() const
-    {
-        return sizeof(MapEntry) * (_table0.maxSize + _table1.maxSize) + _tlsfAlloc.getAllocatedBytes();
+        // Mark the bitmaps
+        _flBitmap |= 1U << firstLayerIdx;
+        _slBitmaps[firstLayerIdx] |= 1U << secondLayerIdx;
     }
 
-    void resize(uint32_t newMaxSize)
+    tlsfBlock* mergeBlockWithPreviousIfFree(tlsfBlock* block)
     {
-        // Allocate the new table
-        Table* newTable = (_currentTable.load() == &_table0) ? &_table1 : &_table0;
-        delete[] newTable->allocPtr;
-        newTable->allocPtr = new uint8_t[newMaxSize * sizeof(MapEntry) + detail::CpuCacheLine];       // For cache-line aligned base pointer
-        newTable->nodes = (MapEntry*)((((uintptr_t)newTable->allocPtr) + detail::CpuCacheLine - 1) &  // NOLINT(performance-no-int-to-ptr)
-                                      (~(detail::CpuCacheLine - 1)));
-        memset(newTable->nodes, 0, sizeof(MapEntry) * newMaxSize);
-        newTable->maxSize = newMaxSize;
-        newTable->size    = 0;
-
-        Table*   oldTable = (newTable == &_table0) ? &_table1 : &_table0;
-        uint32_t newMask  = (newTable->maxSize - 1) & (~(KeyDirAssocQty - 1));
+        if (!block->isPrevFree()) { return block; }
 
-        // Transfer the data
-        for (uint32_t oldIdx = 0; oldIdx < oldTable->maxSize; ++oldIdx) {
-            if (oldTable->nodes[oldIdx].hash < FirstValid) continue;
+        // Remove the previous block from the free list
+        tlsfBlock* prev = block->prevBlockIfFree;
+        assert(prev && "prev block can't be null");
+        assert(prev->isFree() && "prev block is not free though marked as such");
+        uint32_t firstLayerIdx = 0, secondLayerIdx = 0;
+        findSizeFittingList(prev->getPayloadSize(), &firstLayerIdx, &secondLayerIdx);
+        detachFreeBlockFromFreeList(prev, firstLayerIdx, secondLayerIdx);
 
-            uint32_t newIdx    = oldTable->nodes[oldIdx].hash & newMask;
-            uint32_t probeIncr = 1;
-            uint32_t cellId    = 0;
+        // Absorb the block inside the previous one
+        prev->dataSizeAndFlags += block->getPayloadSize() + TlsfBlockOverhead;  // Flags untouched
+        prev->getNext()->prevBlockIfFree = prev;
+        return prev;
+    }
 
-            while (true) {
-                cellId = 0;
-                while (cellId < KeyDirAssocQty && newTable->nodes[newIdx + cellId].hash >= FirstValid) ++cellId;
-                if (cellId < KeyDirAssocQty) { break; }  // Empty space spotted on this cache line
-                newIdx = (newIdx + (probeIncr * KeyDirAssocQty)) & newMask;
-                ++probeIncr;
-            }
+    bool extendArena(uint64_t size)
+    {
+        // Note: first allocation is shifted by the field prevBlockIfFree
+        uint64_t firstAllocOverhead = (_arenaAllocatedBytes == 0) ? TlsfBlockOverhead : 0;
 
-            assert(cellId < KeyDirAssocQty && newTable->nodes[newIdx + cellId].hash < FirstValid);
-            newTable->nodes[newIdx + cellId] = oldTable->nodes[oldIdx];
-            newTable->size += 1;
-            oldTable->size -= 1;  // So that the sum of the sizes is accurate
+        // Compute the size to match the allocation granularity
+        // Mandatory on Windows, but generalized because we do not need fine grained allocation and can avoid its individual cost
+        assert((size & 0x7) == 0);
+        uint64_t requiredNewAllocatedSize = _arenaAllocatedBytes + size + TlsfBlockOverhead + firstAllocOverhead;
+        uint64_t granularNewAllocatedSize = ((requiredNewAllocatedSize + _allocGranularity - 1) / _allocGranularity) * _allocGranularity;
+        uint64_t granularSize             = granularNewAllocatedSize - _arenaAllocatedBytes - TlsfBlockOverhead - firstAllocOverhead;
+        if (granularNewAllocatedSize > _arenaMaxAllocatableBytes) { return false; }
+
+#if defined(_MSC_VER)
+        // Windows: Memory shall be committed before use
+        [[maybe_unused]] void* committedPtr =
+            VirtualAlloc(_arenaBasePtr + _arenaAllocatedBytes, granularNewAllocatedSize - _arenaAllocatedBytes, MEM_COMMIT, PAGE_READWRITE);
+        assert(committedPtr);
+#endif
+        tlsfBlock* addedBlock = (tlsfBlock*)((char*)_arenaBasePtr + _arenaAllocatedBytes - 2 * TlsfBlockOverhead + firstAllocOverhead);
+
+        // 1st alloc requires the creation of the sentinel (null size & not free). Previous is not free either because below the base
+        // pointer
+        if (_arenaAllocatedBytes == 0) {
+            addedBlock->dataSizeAndFlags = /* Null size */ 0 | /* Not free and previous not free either because first block ever */ 0;
         }
 
-        oldTable->size = 0;  // Cleared table
+        // Transform the sentinel into a valid free block with the newly added size
+        assert(addedBlock->getPayloadSize() == 0 && !addedBlock->isFree() && "the old sentinel is corrupted");
+        addedBlock->dataSizeAndFlags |= granularSize | /* Free to recent allocation, previous block flag is untouched */ TlsfFlagFree;
+        addedBlock = mergeBlockWithPreviousIfFree(addedBlock);
+        insertBlockInFreeList(addedBlock);
 
-        // Swap
-        _currentTable.store(newTable);
+        // Add a new sentinel (dummy last block of null size)
+        tlsfBlock* sentinel       = addedBlock->getNext();
+        sentinel->prevBlockIfFree = addedBlock;
+        sentinel->dataSizeAndFlags =
+            /* Null size */ 0 | /* Not free (sentinel) and previous block free due to recent allocation */ TlsfFlagPrevFree;
+        assert(sentinel->getPayloadSize() == 0 && !sentinel->isFree() && "the new sentinel is corrupted");
+
+        // Commit the allocation
+        _arenaAllocatedBytes = granularNewAllocatedSize;
+        return true;
     }
 
-   private:
-    // Definitions
-    struct Table {
-        MapEntry* nodes    = nullptr;  // Cache line aligned
-        uint32_t  size     = 0;
-        uint32_t  maxSize  = 0;
-        uint8_t*  allocPtr = nullptr;  // May not be aligned on a cache line///
-    };
+#if defined(_MSC_VER)
+    static uint32_t countTrailingZeros(uint32_t v) { return _tzcnt_u32(v); }
+    static uint32_t countLeadingZeros(uint64_t v) { return (uint32_t)_lzcnt_u64(v); }
+#else
+    static uint32_t countTrailingZeros(uint32_t v) { return __builtin_ctz(v); }
+    static uint32_t countLeadingZeros(uint64_t v) { return __builtin_clzll(v); }
+#endif
 
-    // Constants
-    static constexpr int OptCounterQty   = 8192;
-    static constexpr int OptCounterMask  = OptCounterQty - 1;
-    static constexpr int CurrentTableNbr = (1 << 0);
+    // Bitmaps of the first and second layers
+    uint32_t _flBitmap             = 0;
+    uint32_t _slBitmaps[TlsfFlQty] = {};
 
-    // Fields
-    Table               _table0;
-    Table               _table1;
-    std::atomic<Table*> _currentTable       = &_table1;
-    uint64_t            _maxLoadFactor128th = (uint64_t)(0.90 * 128);  // 90% load factor with 8-associativity is ok
-    TlsfAllocator       _tlsfAlloc;
-    std::array<std::atomic<uint32_t>, OptCounterQty> _optimisticsCounters = {0};
+    // Free lists for each (first, second) layer
+    tlsfBlock* _freeBlocks[TlsfFlQty][TlsfSlQty] = {};
+    uint64_t   _statAllocatedBytes               = 0;
+
+    // Internal arena allocator
+    uint8_t*     _arenaBasePtr             = nullptr;
+    uint64_t     _arenaAllocatedBytes      = 0;
+    uint64_t     _arenaMaxAllocatableBytes = 0;
+    uint64_t     _allocGranularity         = 65536;  // Only really required on Windows, but generalized
+    MemoryPolicy _memoryPolicy;
 };
 
 // ==========================================================================================
-// KeyDir Hashmap
+// Value cache
 // ==========================================================================================
 
-struct OldKeyChunk {
-    bool     isValid       = false;
-    uint32_t valueSize     = 0;
-    ValueLoc cacheLocation = NotStored;
-    uint16_t fileId        = 0;
-    uint16_t keyIndexQty   = 0;  // Index qty, and not bytes
-    KeyIndex keyIndexes[MaxKeyIndexQty];
-};
+inline uint32_t
+getValueLockIndex(ValueLoc loc)
+{
+    uint32_t x = ((uint32_t)loc) ^ 2463534242;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    return x & (ValueMutexQty - 1);  // Kind of xorshift output
+}
 
-class KeyDirMap
+inline void
+lockValueLocation(ValueLoc loc, std::array<std::mutex, ValueMutexQty>& valueMutexes)
+{
+    valueMutexes[getValueLockIndex(loc)].lock();
+}
+
+inline void
+unlockValueLocation(ValueLoc loc, std::array<std::mutex, ValueMutexQty>& valueMutexes)
+{
+    valueMutexes[getValueLockIndex(loc)].unlock();
+}
+
+// Count-min sketch of the access frequencies for the cache admission (TinyLFU). Each of the 4 rows holds 4-bit saturating counters,
+// and all counters are halved after a sample of 10 times the row size, so that the estimations follow the recent popularity.
+// Counters are updated without lock. A lost increment under contention is harmless for an estimation.
+class FrequencySketch
 {
    public:
-    KeyDirMap(uint64_t keyMaxAllocBytes, uint32_t initMapSize, const std::function<void(uint32_t, bool, bool)>& notifyResizing)
-        : _notifyResizing(notifyResizing), _tlsfAlloc(keyMaxAllocBytes)
+    // The counter quantity per row shall be a power of 2, at least 16
+    void init(uint32_t counterQtyPerRow)
     {
-        assert(notifyResizing);
+        assert(counterQtyPerRow >= 16 && (counterQtyPerRow & (counterQtyPerRow - 1)) == 0);
+        _counterMask   = counterQtyPerRow - 1;
+        _wordQtyPerRow = counterQtyPerRow / 16;
+        _sampleSize    = 10 * (uint64_t)counterQtyPerRow;
+        _words.reset(new std::atomic<uint64_t>[RowQty * _wordQtyPerRow]);
+        for (uint32_t i = 0; i < RowQty * _wordQtyPerRow; ++i) { _words[i].store(0, std::memory_order_relaxed); }
+    }
 
-        // Sanity: Check that the initial size is a power of 2
-        uint32_t checkSize = initMapSize;
-        while ((checkSize & 1) == 0) checkSize >>= 1;
-        assert(checkSize == 1);
+    bool isInitialized() const { return (_words != nullptr); }
 
-        // Allocate the initial map and key storage
-        resize(initMapSize);
+    uint64_t getAllocatedBytes() const { return RowQty * _wordQtyPerRow * sizeof(uint64_t); }
+
+    void increment(uint64_t hash)
+    {
+        for (uint32_t row = 0; row < RowQty; ++row) {
+            uint32_t               counterIdx = getCounterIndex(hash, row);
+            std::atomic<uint64_t>& word       = _words[row * _wordQtyPerRow + (counterIdx >> 4)];
+            uint32_t               shift      = (counterIdx & 0xF) * 4;
+            uint64_t               w          = word.load(std::memory_order_relaxed);
+            while (((w >> shift) & 0xF) < 0xF && !word.compare_exchange_weak(w, w + (1ULL << shift), std::memory_order_relaxed)) {}
+        }
+        if ((_additionQty.fetch_add(1, std::memory_order_relaxed) + 1) % _sampleSize == 0) { age(); }
     }
 
-    ~KeyDirMap()
+    uint32_t estimate(uint64_t hash) const
     {
-        delete[] _table0.allocPtr;
-        delete[] _table1.allocPtr;
+        uint32_t frequency = 0xF;
+        for (uint32_t row = 0; row < RowQty; ++row) {
+            uint32_t counterIdx = getCounterIndex(hash, row);
+            uint64_t w          = _words[row * _wordQtyPerRow + (counterIdx >> 4)].load(std::memory_order_relaxed);
+            frequency           = std::min(frequency, (uint32_t)(w >> ((counterIdx & 0xF) * 4)) & 0xF);
+        }
+        return frequency;
     }
 
-    void reset()
+   private:
+    static constexpr uint32_t RowQty = 4;
+
+    uint32_t getCounterIndex(uint64_t hash, uint32_t row) const
     {
-        for (uint32_t i = 0; i < _table0.maxSize; ++i) { _table0.nodes[i].hash = Empty; }
-        _table0.size = 0;
-        for (uint32_t i = 0; i < _table1.maxSize; ++i) { _table1.nodes[i].hash = Empty; }
-        _table1.size = 0;
+        constexpr uint64_t Seeds[RowQty] = {0x9E3779B97F4A7C15ULL, 0xC2B2AE3D27D4EB4FULL, 0x165667B19E3779F9ULL, 0xD6E8FEB86659FD93ULL};
+        return (uint32_t)(((hash ^ (hash >> 29)) * Seeds[row]) >> 40) & _counterMask;
     }
 
-    uint32_t size() const { return _table0.size + _table1.size; }
+    // Halves all the counters
+    void age()
+    {
+        for (uint32_t i = 0; i < RowQty * _wordQtyPerRow; ++i) {
+            _words[i].store((_words[i].load(std::memory_order_relaxed) >> 1) & 0x7777777777777777ULL, std::memory_order_relaxed);
+        }
+    }
 
-    uint32_t capacity() const { return std::max(_table0.maxSize, _table1.maxSize); }
+    std::unique_ptr<std::atomic<uint64_t>[]> _words;
+    uint32_t                                 _counterMask   = 0;
+    uint32_t                                 _wordQtyPerRow = 0;
+    uint64_t                                 _sampleSize    = 1;
+    std::atomic<uint64_t>                    _additionQty   = 0;
+};
 
-    bool empty() const { return (size() == 0); }
+class ValueCache
+{
+    // Definitions
+    enum class LruType { None = 0, Hot = 1, Warm = 2, Cold = 3, Qty = 4 };
 
-    static constexpr uint64_t Empty      = 0;
-    static constexpr uint64_t FirstValid = 1;
+    static constexpr int SmallBatchSize = 10;
 
-#define LITECASK_FIND_KEY_LOOP(parameterActionCode)                                                                     \
-    mask      = (currentTable->maxSize - 1) & (~(KeyDirAssocQty - 1));                                                  \
-    idx       = keyHash & mask;                                                                                         \
-    probeIncr = 1;                                                                                                      \
-                                                                                                                        \
-    while (true) {                                                                                                      \
-        uint32_t cellId = 0;                                                                                            \
-        for (; cellId < KeyDirAssocQty && currentTable->nodes[idx + cellId].hash >= FirstValid; ++cellId) {             \
-            if (currentTable->nodes[idx + cellId].hash == keyHash) {                                                    \
-                KeyChunk* keyChunk = getKey(currentTable->nodes[idx + cellId].loc);                                     \
-                if (keyChunk->keySize == keySize && !memcmp(((uint8_t*)keyChunk) + sizeof(KeyChunk), key, keySize)) {   \
-                    if (keyChunk->expTimeSec > 0 && keyChunk->expTimeSec <= _nowTimeSec) { break; }                     \
-                    parameterActionCode;                                                                                \
-                }                                                                                                       \
-            }                                                                                                           \
-        }                                                                                                               \
-        if (cellId < KeyDirAssocQty) { break; } /* Empty space spotted on this cache line, so key has not been found */ \
-        idx = (idx + (probeIncr * KeyDirAssocQty)) & mask;                                                              \
-        ++probeIncr; /* Between linear and quadratic probing */                                                         \
-    }
+   public:
+    ValueCache(uint64_t valueMaxAllocBytes) : _tlsfAlloc(valueMaxAllocBytes) {}
 
-#define LITECASK_FIND_KEY_AND_DO_ACTION(parameterActionCode)                                     \
-    uint32_t mask;                                                                               \
-    int      idx;                                                                                \
-    uint32_t probeIncr;                                                                          \
-    if (keyHash < FirstValid) keyHash += FirstValid;                                             \
-    Table* currentTable = ((_signalBitmap.load() & CurrentTableNbr) == 0) ? &_table0 : &_table1; \
-    LITECASK_FIND_KEY_LOOP(parameterActionCode);                                                 \
-    if (_signalBitmap.load() & UnderResizing) { /* Try the other table */                        \
-        currentTable = (currentTable == &_table0) ? &_table1 : &_table0;                         \
-        LITECASK_FIND_KEY_LOOP(parameterActionCode);                                             \
-    }
+    ~ValueCache() {}
 
-#define LITECASK_FIND_HASH_LOOP(parameterActionCode)                                                                    \
-    mask      = (currentTable->maxSize - 1) & (~(KeyDirAssocQty - 1));                                                  \
-    idx       = keyHash & mask;                                                                                         \
-    probeIncr = 1;                                                                                                      \
-                                                                                                                        \
-    while (true) {                                                                                                      \
-        uint32_t cellId = 0;                                                                                            \
-        for (; cellId < KeyDirAssocQty && currentTable->nodes[idx + cellId].hash >= FirstValid; ++cellId) {             \
-            if (currentTable->nodes[idx + cellId].hash == keyHash) {                                                    \
-                KeyChunk* keyChunk = getKey(currentTable->nodes[idx + cellId].loc);                                     \
-                parameterActionCode;                                                                                    \
-            }                                                                                                           \
-        }                                                                                                               \
-        if (cellId < KeyDirAssocQty) { break; } /* Empty space spotted on this cache line, so key has not been found */ \
-        idx = (idx + (probeIncr * KeyDirAssocQty)) & mask;                                                              \
-        ++probeIncr; /* Between linear and quadratic probing */                                                         \
+    bool setTargetMemoryLoad(double load)
+    {
+        if (load < 0. || load > 1.0) { return false; }
+        _targetMemoryLoad = load;
+        return true;
     }
 
-#define LITECASK_FIND_HASH_AND_DO_ACTION(parameterActionCode)                                    \
-    uint32_t mask;                                                                               \
-    int      idx;                                                                                \
-    uint32_t probeIncr;                                                                          \
-    if (keyHash < FirstValid) keyHash += FirstValid;                                             \
-    Table* currentTable = ((_signalBitmap.load() & CurrentTableNbr) == 0) ? &_table0 : &_table1; \
-    LITECASK_FIND_HASH_LOOP(parameterActionCode);                                                \
-    if (_signalBitmap.load() & UnderResizing) { /* Try the other table */                        \
-        currentTable = (currentTable == &_table0) ? &_table1 : &_table0;                         \
-        LITECASK_FIND_HASH_LOOP(parameterActionCode);                                            \
+    // The frequency sketch is allocated at first activation and kept until destruction, so that concurrent calls can still use it
+    void setAdmissionFilter(bool doEnable)
+    {
+        if (doEnable && !_sketch.isInitialized() && isEnabled()) {
+            uint64_t counterQty =
+                std::max(getMaxAllocatableBytes() / AdmissionSketchBytesPerCounter, (uint64_t)AdmissionSketchMinCounterQty);
+            uint32_t counterQtyPow2 = AdmissionSketchMinCounterQty;
+            while (counterQtyPow2 < counterQty && counterQtyPow2 < AdmissionSketchMaxCounterQty) { counterQtyPow2 *= 2; }
+            _sketch.init(counterQtyPow2);
+        }
+        _isAdmissionFilterEnabled.store(doEnable && _sketch.isInitialized(), std::memory_order_release);
     }
 
-    void updateMergedValueLocation(uint32_t keyHash, uint16_t oldFileId, uint32_t oldFileOffset, uint16_t newFileId, uint32_t newFileOffset)
+    uint64_t getAdmissionFilterAllocatedBytes() const
     {
-        LITECASK_FIND_HASH_AND_DO_ACTION({
-            if (keyChunk->fileId == oldFileId && keyChunk->fileOffset == oldFileOffset) {
-                keyChunk->fileId     = newFileId;
-                keyChunk->fileOffset = newFileOffset;
-                return;
-            }
-            // Continue looking for another entry with the same hash in the keydir
-        });
+        return _isAdmissionFilterEnabled.load(std::memory_order_acquire) ? _sketch.getAllocatedBytes() : 0;
     }
 
-    void updateCachedValueLocation(uint32_t keyHash, const void* key, uint16_t keySize, uint32_t checkValueSize, uint8_t checkChangeCounter,
-                                   ValueLoc newCacheLocation)
+    // To call when all references to this memory is no more used
+    void reset()
     {
-        LITECASK_FIND_KEY_AND_DO_ACTION({
-            if (keyChunk->valueSize == checkValueSize && keyChunk->changeCounter == checkChangeCounter) {
-                keyChunk->cacheLocation = newCacheLocation;
-            }
-            return;
-        });
+        _tlsfAlloc.reset();
+        _slabFreeHead = nullptr;
+        _slabFreeBytes.store(0);
     }
 
-    LITECASK_ATTRIBUTE_NO_SANITIZE_THREAD
-    bool getKeyAndIndexes(uint32_t keyHash, lcVector<uint8_t>& key, lcVector<KeyIndex>& keyIndexes)
+    // Values of exactly this size are recycled in a free list of fixed-size chunks (slab), which is cheaper than the general-purpose
+    // allocator. A zero size disables it. To call when the cache is empty
+    void setSlabValueSize(uint32_t valueSize) { _slabChunkBytes = (valueSize == 0) ? 0 : valueSize + (uint32_t)sizeof(ValueChunk); }
+
+    // Collects the owners of the values in the Hot then Warm queues, from the most recently inserted or bumped
+    void getHotAndWarmOwnerIds(lcVector<uint64_t>& ownerIds)
     {
-        LITECASK_FIND_HASH_AND_DO_ACTION({
-            bool     wasNotTheRightHash = false;
-            uint32_t lockCounterBefore;
-            do {
-                lockCounterBefore     = _optimisticsCounters[keyHash & OptCounterMask];  // Optimistic locking
-                uint32_t valueSize    = keyChunk->valueSize;
-                uint16_t keySize      = keyChunk->keySize;
-                uint8_t  keyIndexSize = keyChunk->keyIndexSize;
-
-                // Ensure non corrupted sizes
-                if ((lockCounterBefore & 0x1) == 0 && (_optimisticsCounters[keyHash & OptCounterMask]) == lockCounterBefore) {
-                    if (valueSize == DeletedEntry || (keyChunk->expTimeSec > 0 && keyChunk->expTimeSec <= _nowTimeSec)) {
-                        wasNotTheRightHash = true;  // The entry with matching hash is invalid. We continue looking for another entry.
-                        continue;
-                    }
-                    key.resize(keySize);
-                    memcpy(key.data(), ((uint8_t*)keyChunk) + sizeof(KeyChunk), keySize);
-                    keyIndexes.resize(keyIndexSize);
-                    if (keyIndexSize) { memcpy(keyIndexes.data(), ((uint8_t*)keyChunk) + sizeof(KeyChunk) + keySize, keyIndexSize); }
-                }
-            } while ((lockCounterBefore & 0x1) ||
-                     (_optimisticsCounters[keyHash & OptCounterMask]) != lockCounterBefore);  // Odd means under write
-            if (wasNotTheRightHash) { continue; }  // Continue looking for another entry in the keydir
-            return true;
-        });
-        return false;
+        ownerIds.clear();
+        std::lock_guard<std::mutex> lk(_mxLrus);
+        for (LruType lruType : {LruType::Hot, LruType::Warm}) {
+            ValueLoc loc = _queues[(uint32_t)lruType].head;
+            while (loc != NotStored) {
+                lockValueLocation(loc, _valueMutexes);
+                ValueChunk* c = getValueChunk(loc);
+                ownerIds.push_back(c->ownerId);
+                ValueLoc next = c->next;
+                unlockValueLocation(loc, _valueMutexes);
+                loc = next;
+            }
+        }
     }
 
-    LITECASK_ATTRIBUTE_NO_SANITIZE_THREAD
-    bool cleanIndex(uint32_t keyHash, const void* keyPart, uint16_t keyPartSize)
-    {
-        LITECASK_FIND_HASH_AND_DO_ACTION({
-            if (keyChunk->valueSize != DeletedEntry && (keyChunk->expTimeSec == 0 || keyChunk->expTimeSec > _nowTimeSec)) {
-                continue;  // The entry is valid, so no cleaning needed. We continue looking for an entry to clean.
-            }
+    bool isEnabled() const { return (getMaxAllocatableBytes() > 0); }
 
-            // If entry is not deleted and the key part is found, then it shall be kept (also in the index)
-            // Else, it shall be removed (if needed) and index updated.
-            uint8_t* key     = (uint8_t*)keyChunk + sizeof(KeyChunk);
-            uint8_t* kiArray = key + keyChunk->keySize;
-            for (int kIdx = 0; kIdx < (int)keyChunk->keyIndexSize; kIdx += sizeof(KeyIndex)) {
-                KeyIndex& ki = *(KeyIndex*)(kiArray + kIdx);
-                if (ki.size != keyPartSize || memcmp(&key[ki.startIdx], keyPart, keyPartSize)) { continue; }
-                // Key part is present
-                // Case obsolete entry: the key part is removed (keeping the order)
-                if (kIdx + sizeof(KeyIndex) < (int)keyChunk->keyIndexSize) {
-                    memmove(&ki, (&ki) + sizeof(KeyIndex), ((int)keyChunk->keyIndexSize - (kIdx + sizeof(KeyIndex))));
-                }
-                assert(keyChunk->keyIndexSize >= (uint8_t)sizeof(KeyIndex));
-                keyChunk->keyIndexSize -= (uint8_t)sizeof(KeyIndex);
-                return true;  // Key part found and removed from the entry. The index definitely needs cleaning
-            }
+    bool setMemoryPolicy(const MemoryPolicy& policy) { return _tlsfAlloc.setMemoryPolicy(policy); }
 
-            continue;  // Key part is not found in this entry. We continue looking for an entry to clean
-        });
-        return true;  // No hash matching entry with such key part found. The index definitely needs cleaning
-    }
+    // The chunks in the slab free list are not counted as allocated
+    uint64_t getAllocatedBytes() const { return _tlsfAlloc.getAllocatedBytes() - _slabFreeBytes.load(std::memory_order_relaxed); }
 
-    LITECASK_ATTRIBUTE_NO_SANITIZE_THREAD
-    bool find(uint32_t keyHash, const void* key, uint16_t keySize, KeyChunk& entry)
-    {
-        LITECASK_FIND_KEY_AND_DO_ACTION({
-            if (_isInstrumentationEnable) {
-                if (probeIncr > _instrumentedProbeMax) { _instrumentedProbeMax = probeIncr; }
-                _instrumentedProbeSum += probeIncr;
-                ++_instrumentedFindCount;
-            }
-            uint32_t lockCounterBefore;
-            do {
-                lockCounterBefore = _optimisticsCounters[keyHash & OptCounterMask];  // Optimistic locking
-                entry             = *keyChunk;
-            } while ((lockCounterBefore & 0x1) ||
-                     (_optimisticsCounters[keyHash & OptCounterMask]) != lockCounterBefore);  // Odd means under write
-            return true;
-        });
-        return false;
-    }
+    uint64_t getMaxAllocatableBytes() const { return _tlsfAlloc.getMaxAllocatableBytes(); }
 
-    bool invalidateExpiredTtl(uint32_t keyDirIndex, uint32_t& keyHash, uint32_t& keySize, uint32_t& oldValueSize, uint16_t& oldFileId,
-                              ValueLoc& oldCacheLoc)
+    ValueLoc insertValue(const void* data, uint32_t size, uint64_t ownerId, uint32_t expTimeSec)
     {
-        // Checks only in current table. An external lock shall ensure 1 writer at a time
-        Table* currentTable = ((_signalBitmap.load() & CurrentTableNbr) == 0) ? &_table0 : &_table1;
-
-        // Ensure that the entry is expired (whatever the entry), as indicated by the previous probing
-        MapEntry& kde = currentTable->nodes[keyDirIndex];
-        if (kde.hash < FirstValid) { return false; }
-        KeyChunk* keyChunk = getKey(kde.loc);
-        if (keyChunk->valueSize == DeletedEntry) { return false; }
-
-        _optimisticsCounters[keyHash & OptCounterMask]++;
+        ++_stats.insertCallQty;
 
-        // Copy some old values
-        keyHash      = kde.hash;
-        keySize      = keyChunk->keySize;
-        oldValueSize = keyChunk->valueSize;
-        oldFileId    = keyChunk->fileId;
-        oldCacheLoc  = keyChunk->cacheLocation;
+        // Scan-resistant admission: once the cache is full, the value shall be more popular than the next evicted one
+        if (_isAdmissionFilterEnabled.load(std::memory_order_acquire)) {
+            _sketch.increment(ownerId);
+            if (!isAdmitted(ownerId)) {
+                ++_stats.admissionRejectedQty;
+                return NotStored;
+            }
+        }
 
-        // Invalidate the meta data chunk
-        keyChunk->expTimeSec    = 0;
-        keyChunk->valueSize     = DeletedEntry;
-        keyChunk->cacheLocation = NotStored;
+        ValueLoc loc        = NotStored;
+        uint32_t targetSize = size + sizeof(ValueChunk);
 
-        _optimisticsCounters[keyHash & OptCounterMask]++;
-        return true;
-    }
+        _mxMalloc.lock();
+        uint8_t* ptr = allocateChunk(targetSize);
+        _mxMalloc.unlock();
 
-    // Returns true when the entry is successfully stored. May fail if OOM
-    LITECASK_ATTRIBUTE_NO_SANITIZE_THREAD
-    Status insertEntry(uint32_t keyHash, const void* key, const void* keyIndexes, const KeyChunk& entry, OldKeyChunk& oldEntry)
-    {
-        if (keyHash < FirstValid) keyHash += FirstValid;
-        oldEntry.isValid = false;
+        // If allocation failed, some forced evictions are needed
+        if (!ptr) {
+            TlsfAllocator::CheckContext cc = _tlsfAlloc.getSizeCheckContext(targetSize);  // For optimized check of "allocatability"
 
-        // Insert only in current table. An external lock shall ensure 1 writer at a time
-        Table*   currentTable = ((_signalBitmap.load() & CurrentTableNbr) == 0) ? &_table0 : &_table1;
-        uint32_t mask         = (currentTable->maxSize - 1) & (~(KeyDirAssocQty - 1));
-        int      idx          = keyHash & mask;
-        uint32_t probeIncr    = 1;
-        uint32_t cellId       = 0;
+            int  remainingTries = SmallBatchSize;
+            bool isAllocatable  = false;
 
-        while (true) {
-            cellId = 0;
-            while (cellId < KeyDirAssocQty && currentTable->nodes[idx + cellId].hash >= FirstValid) {
-                if (currentTable->nodes[idx + cellId].hash == keyHash) {
-                    KeyChunk* keyChunk = getKey(currentTable->nodes[idx + cellId].loc);
-                    if (keyChunk->keySize == entry.keySize && !memcmp(((uint8_t*)keyChunk) + sizeof(KeyChunk), key, entry.keySize)) {
-                        // Match found, entry update case
-                        _optimisticsCounters[keyHash & OptCounterMask]++;
+            do {
+                _mxLrus.lock();
+                if (_queues[(uint32_t)LruType::Cold].tail == NotStored) {
+                    updateLruHotAndWarm(SmallBatchSize);
+                    if (_queues[(uint32_t)LruType::Cold].tail == NotStored) {
+                        _mxLrus.unlock();
+                        break;
+                    }
+                }
 
-                        oldEntry.isValid       = true;
-                        oldEntry.valueSize     = keyChunk->valueSize;
-                        oldEntry.cacheLocation = keyChunk->cacheLocation;
-                        oldEntry.fileId        = keyChunk->fileId;
-                        oldEntry.keyIndexQty   = (uint16_t)((int)keyChunk->keyIndexSize / sizeof(KeyIndex));
-                        if (oldEntry.keyIndexQty) {
-                            memcpy(&oldEntry.keyIndexes, ((uint8_t*)keyChunk) + sizeof(KeyChunk) + keyChunk->keySize,
-                                   keyChunk->keyIndexSize);
-                        }
-                        Status storageStatus = updateKey(key, keyIndexes, entry, currentTable->nodes[idx + cellId].loc);
+                ValueLoc locEvict = _queues[(uint32_t)LruType::Cold].tail;
 
-                        _optimisticsCounters[keyHash & OptCounterMask]++;
-                        return storageStatus;
+                if (locEvict != NotStored) {
+                    lockValueLocation(locEvict, _valueMutexes);
+                    ValueChunk* c = getValueChunk(locEvict);
+                    // If entry is active, move it to warm
+                    if (c->flags & ValueFlagActive) {
+                        lruRemove(c);
+                        lruInsertFront(LruType::Warm, locEvict, c);
+                    }
+                    // Else we found our eviction
+                    else {
+                        lruRemove(c);
+                        c->ownerId = 0;
+                        _mxMalloc.lock();
+                        freeChunk(c);
+                        isAllocatable = (_slabFreeHead != nullptr) || _tlsfAlloc.isAllocatable(cc);  // Cheap check
+                        _mxMalloc.unlock();
+                        ++_stats.evictedQty;
+                        --_stats.currentInCacheValueQty;
                     }
+                    unlockValueLocation(locEvict, _valueMutexes);
                 }
-                ++cellId;
+                _mxLrus.unlock();
+
+            } while (remainingTries-- && !isAllocatable);
+
+            if (isAllocatable) {
+                _mxMalloc.lock();
+                ptr = allocateChunk(targetSize);
+                _mxMalloc.unlock();
             }
-            if (cellId < KeyDirAssocQty) { break; } /* Empty space spotted on this cache line, so key has not been found */
-            idx = (idx + (probeIncr * KeyDirAssocQty)) & mask;
-            ++probeIncr;  // Between linear and quadratic probing
         }
 
-        KeyLoc keyLoc        = NotStored;
-        Status storageStatus = insertKey(key, keyIndexes, entry, keyLoc);
-        if (storageStatus != Status::Ok) { return storageStatus; }  // Failure to store the key due to OOM or too big key
-        // No need for protection vs "get" as there is no key removal API (tombstone instead)
-        assert(cellId < KeyDirAssocQty && currentTable->nodes[idx + cellId].hash < FirstValid);
-        currentTable->nodes[idx + cellId] = {keyHash, keyLoc};
+        if (!ptr) { return NotStored; }
 
-        currentTable->size += 1;
-        if ((uint64_t)128 * (_table0.size + _table1.size) > _maxLoadFactor128th * currentTable->maxSize) {
-            resize(2 * currentTable->maxSize);
-        }
-        return Status::Ok;
-    }
+        // Install meta data before the data
+        ValueChunk* c = (ValueChunk*)ptr;
+        c->ownerId    = ownerId;
+        c->expTimeSec = expTimeSec;
+        c->size       = size;
+        c->flags      = 0;
+        memcpy(((uint8_t*)c) + sizeof(ValueChunk), data, size);
 
-    void resize(uint32_t newMaxSize)
-    {
-        // Emergency case: if the next resize arrives and the previous is not finished, just force-finish it
-        constexpr uint32_t EmergencyBatchSize = 1'000'000;
-        if (isResizingOngoing()) {
-            while (isResizingOngoing()) { backgroundResizeWork(EmergencyBatchSize, true); }
-        }
+        ++_stats.currentInCacheValueQty;
 
-        // Allocate the new table
-        Table* newTable = ((_signalBitmap.load() & CurrentTableNbr) == 0) ? &_table1 : &_table0;
-        delete[] newTable->allocPtr;
-        newTable->allocPtr = new uint8_t[newMaxSize * sizeof(MapEntry) + detail::CpuCacheLine];       // For cache-line aligned base pointer
-        newTable->nodes = (MapEntry*)((((uintptr_t)newTable->allocPtr) + detail::CpuCacheLine - 1) &  // NOLINT(performance-no-int-to-ptr)
-                                      (~(detail::CpuCacheLine - 1)));
-        memset(newTable->nodes, 0, sizeof(MapEntry) * newMaxSize);
-        newTable->maxSize = newMaxSize;
-        newTable->size    = 0;
+        // Insert this new entry inside the Hot queue
+        loc = _tlsfAlloc.compress(ptr);
+        _mxLrus.lock();
+        lruInsertFront(LruType::Hot, loc, c);
+        _mxLrus.unlock();
 
-        // Start the background resizing process
-        _resizeNextIdx = 0;
-        if (_table0.size != 0 || _table1.size != 0) {
-            _signalBitmap.store(UnderResizing | (_signalBitmap.load() ^ CurrentTableNbr));
-            _notifyResizing(newMaxSize, true, false);  // Notify the start of the resizing job
-        } else {
-            // Construction time (empty tables)
-            _signalBitmap.store(_signalBitmap.load() ^ CurrentTableNbr);
-        }
+        return loc;
     }
 
-    // Note: writer lock is expected to be taken
-    void backgroundResizeWork(uint32_t batchSize, bool wasForced = false)
+    bool removeValue(ValueLoc loc, uint64_t ownerId)
     {
-        assert(batchSize > 0);
-        if (!isResizingOngoing()) { return; }
+        ++_stats.removeCallQty;
+        if (loc == NotStored) { return false; }
 
-        Table*   oldTable   = ((_signalBitmap.load() & CurrentTableNbr) == 0) ? &_table1 : &_table0;
-        Table*   newTable   = (oldTable == &_table0) ? &_table1 : &_table0;
-        uint32_t newMask    = (newTable->maxSize - 1) & (~(KeyDirAssocQty - 1));
-        uint32_t lastOldIdx = std::min(_resizeNextIdx + batchSize, oldTable->maxSize);
+        _mxLrus.lock();
+        lockValueLocation(loc, _valueMutexes);
+        ValueChunk* c = getValueChunk(loc);
 
-        // Transfer a batch of data
-        for (uint32_t oldIdx = _resizeNextIdx; oldIdx < lastOldIdx; ++oldIdx) {
-            if (oldTable->nodes[oldIdx].hash < FirstValid) continue;
+        // Check the ownerId and some sanity fields
+        // By calling this function, the reference to `loc` is already removed in the above layers
+        if (c->ownerId != ownerId || c->size == NotStored) {
+            unlockValueLocation(loc, _valueMutexes);
+            _mxLrus.unlock();
+            return false;
+        }
 
-            uint32_t newIdx    = oldTable->nodes[oldIdx].hash & newMask;
-            uint32_t probeIncr = 1;
-            uint32_t cellId    = 0;
+        // Invalidate
+        lruRemove(c);
+        c->ownerId = 0;
 
-            while (true) {
-                cellId = 0;
-                while (cellId < KeyDirAssocQty && newTable->nodes[newIdx + cellId].hash >= FirstValid) ++cellId;
-                if (cellId < KeyDirAssocQty) { break; }  // Empty space spotted on this cache line
-                newIdx = (newIdx + (probeIncr * KeyDirAssocQty)) & newMask;
-                ++probeIncr;
-            }
+        unlockValueLocation(loc, _valueMutexes);
+        _mxLrus.unlock();
 
-            assert(cellId < KeyDirAssocQty && newTable->nodes[newIdx + cellId].hash < FirstValid);
-            newTable->nodes[newIdx + cellId] = oldTable->nodes[oldIdx];
-            newTable->size += 1;
-            oldTable->size -= 1;  // So that the sum of the sizes is accurate
-        }
+        // Free
+        _mxMalloc.lock();
+        freeChunk(c);
+        _mxMalloc.unlock();
+        --_stats.currentInCacheValueQty;
 
-        _resizeNextIdx = lastOldIdx;
-        if (lastOldIdx == oldTable->maxSize) {
-            oldTable->size = 0;                                    // Cleared table
-            _notifyResizing(newTable->maxSize, false, wasForced);  // Notify the end of the resizing job
-            _signalBitmap.store((~UnderResizing) & _signalBitmap.load());
-        }
+        return true;
     }
 
-    uint32_t backgroundExpiredKeyCleaning(uint32_t& batchSize)
+    bool getValue(ValueLoc loc, uint64_t checKOwnerId, uint32_t checkValueSize, lcVector<uint8_t>& data)
     {
-        assert(batchSize > 0);
+        return visitValue(loc, checKOwnerId, checkValueSize, [&data](const uint8_t* value, uint32_t valueSize) {
+            data.resize(valueSize);
+            memcpy(data.data(), value, valueSize);
+        });
+    }
 
-        Table*   table   = ((_signalBitmap.load() & CurrentTableNbr) == 0) ? &_table0 : &_table1;
-        uint32_t lastIdx = std::min(_ttlNextIdx + batchSize, table->maxSize);
+    // The visitor is called with the value location locked, so the cached value is accessed without copy
+    template<typename ValueVisitor>
+    bool visitValue(ValueLoc loc, uint64_t checKOwnerId, uint32_t checkValueSize, const ValueVisitor& visitor)
+    {
+        ++_stats.getCallQty;
+        if (loc == NotStored) { return false; }
 
-        // Analyze a batch of data
-        for (uint32_t idx = _ttlNextIdx; idx < lastIdx; ++idx, --batchSize) {
-            // Skip entries which are empty, without TTL, or not expired TTL
-            if (table->nodes[idx].hash < FirstValid) { continue; }
-            KeyChunk* keyChunk = getKey(table->nodes[idx].loc);
-            if (keyChunk->valueSize == DeletedEntry || keyChunk->expTimeSec == 0 || keyChunk->expTimeSec > _nowTimeSec) { continue; }
+        lockValueLocation(loc, _valueMutexes);
+        ValueChunk* c = getValueChunk(loc);
 
-            // Return the entry to remove, after checking again (under lock) that the TTL is indeed expired
-            // The data race condition is harmless, just a little waste of CPU if this probing is defeated later
-            _ttlNextIdx = (idx + 1 >= table->maxSize) ? 0 : idx + 1;
-            return idx;
+        // Check the ownerId and size, as this 'loc' could have been meanwhile evicted
+        if (c->ownerId != checKOwnerId || c->size != checkValueSize) {
+            unlockValueLocation(loc, _valueMutexes);
+            ++_stats.missQty;
+            return false;
         }
 
-        _ttlNextIdx = (lastIdx >= table->maxSize) ? 0 : lastIdx;
-        batchSize   = 0;
-        return NotStored;
-    }
+        // Update the LRU
+        c->flags |= ValueFlagActive;
+        ++_stats.hitQty;
+        if (_isAdmissionFilterEnabled.load(std::memory_order_acquire)) { _sketch.increment(checKOwnerId); }
 
-    bool isResizingOngoing() const { return (_signalBitmap.load() & UnderResizing); }
+        visitor(((const uint8_t*)c) + sizeof(ValueChunk), c->size);
 
-    // Above this load factor, the KeyDir will get resized
-    bool setMaxLoadFactor(double f)
-    {
-        if (f <= 0. || f > 1.) return false;
-        _maxLoadFactor128th = (uint64_t)(128. * f);
+        unlockValueLocation(loc, _valueMutexes);
         return true;
     }
 
-    double getLoadFactor() const
+    // Upkeeping background task
+    void backgroundUpdateLru(uint32_t batchSize)
     {
-        return (double)(_table0.size + _table1.size) / (double)std::max(std::max(_table0.maxSize, _table1.maxSize), 1U);
+        // Loop until no more work to do or batch exhausted
+        while (batchSize > 0) {
+            _mxLrus.lock();
+            uint32_t consumed = updateLruHotAndWarm(batchSize);
+            _mxLrus.unlock();
+            batchSize = (consumed == 0 || consumed > batchSize) ? 0 : batchSize - consumed;
+        }
     }
 
-    uint64_t getEstimatedUsedMemoryBytes() const
+    // Upkeeping background task
+    void backgroundPreventiveEviction(uint32_t batchSize)
     {
-        return sizeof(MapEntry) * (_table0.maxSize + _table1.maxSize) + _tlsfAlloc.getAllocatedBytes();
+        if (!isEnabled()) { return; }
+
+        uint64_t targetAllocatedBytes = (uint64_t)(_targetMemoryLoad * (double)_tlsfAlloc.getMaxAllocatableBytes());
+
+        // Loop until no more work to do or batch exhausted
+        while ((batchSize--) > 0 && getAllocatedBytes() > targetAllocatedBytes) {
+            _mxLrus.lock();
+            if (_queues[(uint32_t)LruType::Cold].tail == NotStored) {
+                updateLruHotAndWarm(SmallBatchSize);
+                if (_queues[(uint32_t)LruType::Cold].tail == NotStored) {
+                    _mxLrus.unlock();
+                    break;
+                }
+            }
+
+            ValueLoc loc = _queues[(uint32_t)LruType::Cold].tail;
+
+            if (loc != NotStored) {
+                lockValueLocation(loc, _valueMutexes);
+                ValueChunk* c = getValueChunk(loc);
+                // If entry is active, move it to warm
+                if (c->flags & ValueFlagActive) {
+                    lruRemove(c);
+                    lruInsertFront(LruType::Warm, loc, c);
+                }
+                // Else we found our eviction
+                else {
+                    lruRemove(c);
+                    c->ownerId = 0;
+                    _mxMalloc.lock();
+                    freeChunk(c);
+                    _mxMalloc.unlock();
+                    ++_stats.evictedQty;
+                    --_stats.currentInCacheValueQty;
+                }
+                unlockValueLocation(loc, _valueMutexes);
+            }
+            _mxLrus.unlock();
+
+        }  // End of batch processing
     }
 
-    // Only enabled in tests, to analyse the probing of the hash table when reading some entries
-    void setInstrumentationEnable(bool isEnable) { _isInstrumentationEnable = isEnable; }
+    const ValueCacheCounters& getCounters() const { return _stats; }
 
-    // It returns the monotonic counters of probe count and find API call count, and the max probe count per call since the last
-    // getProbeCount call
-    void getProbeCount(uint64_t& probeMax, uint64_t& probeSum, uint64_t& findCount)
+    void dump() const
     {
-        probeMax              = _instrumentedProbeMax;
-        _instrumentedProbeMax = 0;
-        probeSum              = _instrumentedProbeSum;
-        findCount             = _instrumentedFindCount;
+        printf("Cache:\n");
+        printf("  insert call: %" PRId64 "\n", _stats.insertCallQty.load());
+        printf("  get    call: %" PRId64 "\n", _stats.getCallQty.load());
+        printf("  remove call: %" PRId64 "\n", _stats.removeCallQty.load());
+        printf("  hit     qty: %" PRId64 "\n", _stats.hitQty.load());
+        printf("  miss    qty: %" PRId64 "\n", _stats.missQty.load());
+        printf("  evicted qty: %" PRId64 "\n", _stats.evictedQty.load());
+        printf("  hit   ratio: %.3f\n", (double)_stats.hitQty / (double)std::max((uint64_t)1, _stats.hitQty + _stats.missQty));
     }
 
-    void setNow(uint32_t nowTimeSec) { _nowTimeSec = nowTimeSec; }
-
    private:
-    KeyChunk* getKey(KeyLoc loc) const { return (KeyChunk*)_tlsfAlloc.uncompress(loc); }
+    ValueChunk* getValueChunk(KeyLoc loc) const { return (ValueChunk*)_tlsfAlloc.uncompress(loc); }
 
-    Status insertKey(const void* key, const void* keyIndexes, const KeyChunk& entry, KeyLoc& loc)
+    // Malloc lock shall be taken beforehand. Slab-sized chunks are taken from the free list first. Other sizes get back the free
+    // chunks to the general-purpose allocator if it is short of memory
+    uint8_t* allocateChunk(uint32_t targetSize)
     {
-        uint32_t targetSize = (uint32_t)(sizeof(KeyChunk) + entry.keySize + entry.keyIndexSize);
-        uint8_t* ptr        = (uint8_t*)_tlsfAlloc.malloc(targetSize);
-        if (ptr == nullptr) { return Status::OutOfMemory; }
-        loc         = _tlsfAlloc.compress(ptr);
-        KeyChunk* c = (KeyChunk*)ptr;
-        *c          = entry;
-        c->changeCounter += 1;
-        memcpy(ptr + sizeof(KeyChunk), key, entry.keySize);
-        if (entry.keyIndexSize) { memcpy(ptr + sizeof(KeyChunk) + entry.keySize, keyIndexes, entry.keyIndexSize); }
-        return Status::Ok;
+        if (targetSize == _slabChunkBytes && _slabFreeHead != nullptr) {
+            uint8_t* ptr  = (uint8_t*)_slabFreeHead;
+            _slabFreeHead = _slabFreeHead->nextFree;
+            _slabFreeBytes.fetch_sub(_slabChunkBytes, std::memory_order_relaxed);
+            return ptr;
+        }
+        uint8_t* ptr = (uint8_t*)_tlsfAlloc.malloc(targetSize);
+        if (!ptr && _slabFreeHead != nullptr) {
+            while (_slabFreeHead != nullptr) {
+                SlabFreeChunk* next = _slabFreeHead->nextFree;
+                _tlsfAlloc.free(_slabFreeHead);
+                _slabFreeHead = next;
+            }
+            _slabFreeBytes.store(0, std::memory_order_relaxed);
+            ptr = (uint8_t*)_tlsfAlloc.malloc(targetSize);
+        }
+        return ptr;
     }
 
-    Status updateKey(const void* key, const void* keyIndexes, const KeyChunk& entry, KeyLoc& locToUpdate)
+    // Malloc lock shall be taken beforehand. The owner identifier shall be already cleared, so that the chunk is seen as free
+    void freeChunk(ValueChunk* c)
     {
-        KeyChunk* keyChunk = getKey(locToUpdate);
-
-        uint32_t accessibleKeyIndexSize = (uint32_t)(_tlsfAlloc.getRealAllocatedSize(keyChunk) - sizeof(KeyChunk) - entry.keySize);
-        if (entry.keyIndexSize > accessibleKeyIndexSize) {
-            // New allocation required because the current one is too small
-            KeyLoc newKeyLoc     = NotStored;
-            Status storageStatus = insertKey(key, keyIndexes, entry, newKeyLoc);
-            if (storageStatus != Status::Ok) { return storageStatus; }  // Failure to store the key due to OOM
-            KeyLoc oldKeyLoc = locToUpdate;
-            locToUpdate      = newKeyLoc;
-
-            // Invalidate and free the old chunk
-            memset(keyChunk, 0, sizeof(KeyChunk));
-            keyChunk->cacheLocation = NotStored;
-            keyChunk->fileOffset    = NotStored;
-            keyChunk->fileId        = 0xFFFF;
-            _tlsfAlloc.free(_tlsfAlloc.uncompress(oldKeyLoc));
-        } else if (entry.valueSize == DeletedEntry) {
-            // For deletion, we keep the previous key index. Setting back the size is enough.
-            // This is needed to avoid multiple entries in the index lookups if this entry is added back later
-            // with some matching key indexes.
-            uint8_t oldKeyIndexSize = keyChunk->keyIndexSize;
-            *keyChunk               = entry;
-            keyChunk->keyIndexSize  = oldKeyIndexSize;
-            keyChunk->changeCounter += 1;
-        } else {
-            *keyChunk = entry;
-            keyChunk->changeCounter += 1;
-            if (entry.keyIndexSize) { memcpy(((uint8_t*)keyChunk) + sizeof(KeyChunk) + entry.keySize, keyIndexes, entry.keyIndexSize); }
+        if (_slabChunkBytes != 0 && c->size + sizeof(ValueChunk) == _slabChunkBytes) {
+            // The link is stored after the owner identifier, which stays null
+            SlabFreeChunk* fc = (SlabFreeChunk*)c;
+            fc->nextFree      = _slabFreeHead;
+            _slabFreeHead     = fc;
+            _slabFreeBytes.fetch_add(_slabChunkBytes, std::memory_order_relaxed);
+            return;
         }
-        return Status::Ok;
+        _tlsfAlloc.free(c);
     }
 
-    // Definitions
-    struct Table {
-        MapEntry* nodes    = nullptr;  // Cache line aligned
-        uint32_t  size     = 0;
-        uint32_t  maxSize  = 0;
-        uint8_t*  allocPtr = nullptr;  // May not be aligned on a cache line
-    };
-
-    // Constants
-    static constexpr int OptCounterQty   = 8192;
-    static constexpr int OptCounterMask  = OptCounterQty - 1;
-    static constexpr int CurrentTableNbr = (1 << 0);
-    static constexpr int UnderResizing   = (1 << 1);
-
-    // Fields
-    alignas(CpuCacheLine) Table _table0;
-    Table                 _table1;
-    uint64_t              _maxLoadFactor128th = (uint64_t)(0.90 * 128);  // 90% load factor with 8-associativity is ok
-    std::atomic<uint64_t> _signalBitmap       = 0;                       // Table 0 and not resizing
-    uint32_t              _resizeNextIdx      = 0;
-    uint32_t              _ttlNextIdx         = 0;
-    uint32_t              _nowTimeSec         = 0;
-
-    alignas(CpuCacheLine) std::array<std::atomic<uint32_t>, OptCounterQty> _optimisticsCounters = {0};
-    std::function<void(uint32_t, bool, bool)> _notifyResizing;
-
-    TlsfAllocator _tlsfAlloc;
-    bool          _isInstrumentationEnable = false;
-    uint64_t      _instrumentedProbeMax    = 0;
-    uint64_t      _instrumentedProbeSum    = 0;
-    uint64_t      _instrumentedFindCount   = 0;
-};
-
-}  // namespace detail
-
-// ==========================================================================================
-// Datastore
-// ==========================================================================================
-
-class Datastore  // NOLINT(clang-analyzer-optin.performance.Padding)  Padding is not optimal due to the alignas directives
-{
-   public:
-    Datastore(size_t cacheBytes = 256 * 1024 * 1024)
+    // The admission is free while the cache is below its target load
+    bool isAdmitted(uint64_t ownerId)
     {
-        _upkeepLastActiveFlushedTimeMs =
-            std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
-        setLogHandler({});  // Install the default handler
+        if ((double)getAllocatedBytes() < _targetMemoryLoad * (double)_tlsfAlloc.getMaxAllocatableBytes()) { return true; }
 
-        constexpr uint32_t initialMapSize = 16 * 1024;
-        _writeBuffer.resize(detail::DefaultWriteBufferBytes);
-        _keyDir = new detail::KeyDirMap(detail::KeyStorageAllocBytes, initialMapSize, [&](uint32_t newSize, bool isStart, bool wasForced) {
-            notifyKeyDirResizing(newSize, isStart, wasForced);
-        });
-        _valueCache = new detail::ValueCache((uint64_t)cacheBytes);
-        _indexMap   = new detail::IndexMap(detail::KeyStorageAllocBytes, initialMapSize);
+        _mxLrus.lock();
+        ValueLoc victimLoc = _queues[(uint32_t)LruType::Cold].tail;
+        if (victimLoc == NotStored) {
+            _mxLrus.unlock();
+            return true;
+        }
+        lockValueLocation(victimLoc, _valueMutexes);
+        uint64_t victimOwnerId = getValueChunk(victimLoc)->ownerId;
+        unlockValueLocation(victimLoc, _valueMutexes);
+        _mxLrus.unlock();
 
-        updateNow();
+        return (_sketch.estimate(ownerId) > _sketch.estimate(victimOwnerId));
     }
 
-    ~Datastore()
+    // Lock shall be taken beforehand
+    void lruRemove(ValueChunk* c)
     {
-        if (_isInitialized) { close(); }
-        delete _keyDir;
-        delete _valueCache;
-        delete _indexMap;
-    }
-
-    // Observability
-    // ==========================================================================================
+        assert((c->flags & ValueFlagQueueTypeMask) != (uint32_t)LruType::None);
+        LruQueue& queue = _queues[c->flags & ValueFlagQueueTypeMask];
+        c->flags        = (uint32_t)LruType::None;  // No more present in any LRU
 
-    void dumpFd(bool withIndex = false)
-    {
-        using namespace litecask::detail;
-        _mxDataFiles.lockRead();
-        for (uint32_t fileId = 0; fileId < _dataFiles.size(); ++fileId) {
-            DataFile* dfd = _dataFiles[fileId];
-            dfd->dump(withIndex ? fileId : -1, fileId == _activeDataFileId);
+        if (c->prev != NotStored) {
+            getValueChunk(c->prev)->next = c->next;
+        } else {
+            queue.head = c->next;
         }
-        _mxDataFiles.unlockRead();
+        if (c->next != NotStored) {
+            getValueChunk(c->next)->prev = c->prev;
+        } else {
+            queue.tail = c->prev;
+        }
+        assert(queue.bytes >= c->size);
+        queue.bytes -= c->size;
     }
 
-    DataFileStats getFileStats() const
+    // Lock shall be taken beforehand
+    void lruInsertFront(LruType lruType, ValueLoc loc, ValueChunk* c)
     {
-        using namespace litecask::detail;
-        DataFileStats stats;
-        _mxDataFiles.lockRead();
-
-        for (uint32_t fileId = 0; fileId < _dataFiles.size(); ++fileId) {
-            DataFile* dfd = _dataFiles[fileId];
-            if (!osIsValidHandle(dfd->handle)) continue;
+        assert(lruType != LruType::None);
+        assert((c->flags & ValueFlagQueueTypeMask) == (uint32_t)LruType::None);
+        LruQueue& queue = _queues[(uint32_t)lruType];
 
-            stats.fileQty += 1;
-            stats.entries += dfd->entries;
-            stats.entryBytes += dfd->bytes;
-            stats.tombBytes += dfd->tombBytes;
-            stats.tombEntries += dfd->tombEntries;
-            stats.deadBytes += dfd->deadBytes;
-            stats.deadEntries += dfd->deadEntries;
+        c->flags = (uint16_t)lruType;  // Active flag is cleared when bumped
+        c->prev  = NotStored;
+        if (queue.head != NotStored) {
+            getValueChunk(queue.head)->prev = loc;
+            c->next                         = queue.head;
+        } else {
+            queue.tail = loc;
+            c->next    = NotStored;
         }
+        queue.head = loc;
+        queue.bytes += c->size;
+    }
 
-        _mxDataFiles.unlockRead();
+    uint32_t updateLruHotAndWarm(uint32_t batchSize)
+    {
+        int64_t allBytes = (int64_t)_queues[(uint32_t)LruType::Hot].bytes + (int64_t)_queues[(uint32_t)LruType::Warm].bytes +
+                           (int64_t)_queues[(uint32_t)LruType::Cold].bytes;
+        ValueLoc loc      = NotStored;
+        uint32_t consumed = 0;
+
+        // Move from Hot to Warm or Cold
+        int64_t moveQty   = batchSize;
+        int64_t moveBytes = std::max((int64_t)0, (int64_t)_queues[(uint32_t)LruType::Hot].bytes - (allBytes * 20 / 100));
+        while (moveQty-- && moveBytes > 0 && (loc = _queues[(uint32_t)LruType::Hot].tail) != NotStored) {
+            lockValueLocation(loc, _valueMutexes);
+            ValueChunk* c        = getValueChunk(loc);
+            bool        isActive = (c->flags & ValueFlagActive);
+            lruRemove(c);
+            // Move it to the Warm or Cold LRU, depending on its active state
+            lruInsertFront(isActive ? LruType::Warm : LruType::Cold, loc, c);
+            moveBytes -= c->size;
+            ++consumed;
+            unlockValueLocation(loc, _valueMutexes);
+        }
+
+        // Move from Warm to Warm (bumped) or Cold
+        moveQty   = batchSize;
+        moveBytes = std::max((int64_t)0, (int64_t)_queues[(uint32_t)LruType::Warm].bytes - (allBytes * 40 / 100));
+        while (moveQty-- && moveBytes > 0 && (loc = _queues[(uint32_t)LruType::Warm].tail) != NotStored) {
+            lockValueLocation(loc, _valueMutexes);
+            ValueChunk* c        = getValueChunk(loc);
+            bool        isActive = (c->flags & ValueFlagActive);
+            lruRemove(c);
+            // Move it to the Warm or Cold LRU, depending on its access state
+            lruInsertFront(isActive ? LruType::Warm : LruType::Cold, loc, c);
+            moveBytes -= c->size;
+            ++consumed;
+            unlockValueLocation(loc, _valueMutexes);
+        }
+
+        // Note: Move from Cold to Warm is performed independently. It depends on the cache filled ratio.
+
+        return consumed;
+    }
+
+    struct LruQueue {
+        ValueLoc head  = NotStored;
+        ValueLoc tail  = NotStored;
+        uint32_t bytes = 0;
+    };
+    struct SlabFreeChunk {
+        uint64_t       ownerId;  // Null, as for any freed chunk
+        SlabFreeChunk* nextFree;
+    };
+    std::mutex _mxLrus;
+    std::mutex _mxMalloc;
+    LruQueue   _queues[(uint32_t)LruType::Qty];
+    double     _targetMemoryLoad = 0.90;
+
+    uint32_t              _slabChunkBytes = 0;
+    SlabFreeChunk*        _slabFreeHead   = nullptr;
+    std::atomic<uint64_t> _slabFreeBytes  = 0;
+
+    TlsfAllocator                         _tlsfAlloc;
+    ValueCacheCounters                    _stats;
+    std::array<std::mutex, ValueMutexQty> _valueMutexes;
+    FrequencySketch                       _sketch;
+    std::atomic<bool>                     _isAdmissionFilterEnabled = false;
+};
+
+// ==========================================================================================
+// Index Hashmap
+// ==========================================================================================
+
+struct IndexChunk {
+    uint32_t keyPartSize;    // Length in bytes of the tag (=part of the key)
+    uint32_t entries;        // Quantity of used entries
+    uint32_t sortedEntries;  // Quantity of leading entries sorted in increasing order without duplicate. The rest is appended unsorted
+    // uint8_t keyPart[0] the part of the key is stored here (padded to 4 bytes), followed by the list of hash32 of related entries
+    uint32_t* getHashArrayStart() const
+    {
+        constexpr uint32_t AlignMask = (uint32_t)(sizeof(uint32_t) - 1);
+        return (uint32_t*)((uint8_t*)this + sizeof(IndexChunk) + ((keyPartSize + AlignMask) & (~AlignMask)));
+    }
+};
+
+// Intersects two sorted lists of unique hashes, and returns the quantity of common hashes stored in 'out', in increasing order.
+// The output buffer shall hold the smallest list and shall not overlap the inputs.
+// Lists of close sizes are merged by blocks of 4x4 hashes compared in SIMD, while a list much smaller than the other one
+// is rather searched with galloping (exponential then binary search) so that the cost is driven by the smallest list.
+inline size_t
+intersectSortedHashes(const uint32_t* a, size_t aSize, const uint32_t* b, size_t bSize, uint32_t* out)
+{
+    constexpr size_t GallopingSizeRatio = 32;
+    if (aSize > bSize) {
+        std::swap(a, b);
+        std::swap(aSize, bSize);
+    }
+    if (aSize * GallopingSizeRatio < bSize) {
+        size_t outQty = 0, j = 0;
+        for (size_t i = 0; i < aSize && j < bSize; ++i) {
+            uint32_t target = a[i];
+            size_t   step   = 1;
+            while (j + step < bSize && b[j + step] < target) { step *= 2; }
+            j = (size_t)(std::lower_bound(b + j, b + std::min(j + step + 1, bSize), target) - b);
+            if (j < bSize && b[j] == target) { out[outQty++] = target; }
+        }
+        return outQty;
+    }
+
+    size_t outQty = 0, i = 0, j = 0;
+#if LITECASK_SSE2_ENABLED
+    while (i + 4 <= aSize && j + 4 <= bSize) {
+        __m128i va = _mm_loadu_si128((const __m128i*)(a + i));
+        __m128i vb = _mm_loadu_si128((const __m128i*)(b + j));
+        // Compare each hash of the 'a' block with the 4 rotations of the 'b' block
+        __m128i eq = _mm_cmpeq_epi32(va, vb);
+        eq         = _mm_or_si128(eq, _mm_cmpeq_epi32(va, _mm_shuffle_epi32(vb, _MM_SHUFFLE(0, 3, 2, 1))));
+        eq         = _mm_or_si128(eq, _mm_cmpeq_epi32(va, _mm_shuffle_epi32(vb, _MM_SHUFFLE(1, 0, 3, 2))));
+        eq         = _mm_or_si128(eq, _mm_cmpeq_epi32(va, _mm_shuffle_epi32(vb, _MM_SHUFFLE(2, 1, 0, 3))));
+        int mask   = _mm_movemask_ps(_mm_castsi128_ps(eq));
+        for (int k = 0; k < 4; ++k) {
+            if (mask & (1 << k)) { out[outQty++] = a[i + k]; }
+        }
+        uint32_t aLast = a[i + 3], bLast = b[j + 3];
+        if (aLast <= bLast) { i += 4; }
+        if (bLast <= aLast) { j += 4; }
+    }
+#endif
+    while (i < aSize && j < bSize) {
+        if (a[i] < b[j]) {
+            ++i;
+        } else if (b[j] < a[i]) {
+            ++j;
+        } else {
+            out[outQty++] = a[i];
+            ++i;
+            ++j;
+        }
+    }
+    return outQty;
+}
+
+class IndexMap
+{
+   public:
+    IndexMap(uint64_t indexMaxAllocBytes, uint32_t initMapSize) : _tlsfAlloc(indexMaxAllocBytes)
+    {
+        // Sanity: Check that the initial size is a power of 2
+        uint32_t checkSize = initMapSize;
+        while ((checkSize & 1) == 0) checkSize >>= 1;
+        assert(checkSize == 1);
+
+        // Allocate the initial map and key storage
+        resize(initMapSize);
+    }
+
+    ~IndexMap()
+    {
+        osFreeTable((uint8_t*)_table0.nodes, sizeof(MapEntry) * _table0.maxSize);
+        osFreeTable((uint8_t*)_table1.nodes, sizeof(MapEntry) * _table1.maxSize);
+    }
+
+    // Applies to the key storage and to the current tables, and to the tables allocated afterwards
+    bool setMemoryPolicy(const MemoryPolicy& policy)
+    {
+        bool isApplied = _tlsfAlloc.setMemoryPolicy(policy);
+        for (Table* table : {&_table0, &_table1}) {
+            if (table->nodes) {
+                isApplied = osApplyMemoryPolicy(table->nodes, sizeof(MapEntry) * table->maxSize, policy, _memoryPolicy) && isApplied;
+            }
+        }
+        _memoryPolicy = policy;
+        return isApplied;
+    }
+
+    void clear()
+    {
+        for (uint32_t i = 0; i < _table0.maxSize; ++i) { _table0.nodes[i].hash = Empty; }
+        _table0.size = 0;
+        for (uint32_t i = 0; i < _table1.maxSize; ++i) { _table1.nodes[i].hash = Empty; }
+        _table1.size = 0;
+    }
+
+    uint32_t size() const { return _table0.size + _table1.size; }
+
+    uint32_t capacity() const { return std::max(_table0.maxSize, _table1.maxSize); }
+
+    bool empty() const { return (size() == 0); }
+
+    static constexpr uint64_t Empty      = 0;
+    static constexpr uint64_t FirstValid = 1;
+
+    // An external writer RW-lock shall ensure 1 writer at a time
+    Status insertIndex(const void* keyPart, uint32_t keyPartSize, uint32_t entryKeyHash)
+    {
+        uint32_t keyHash = (uint32_t)LITECASK_HASH_FUNC(keyPart, keyPartSize);
+        if (keyHash < FirstValid) keyHash += FirstValid;
+        if (entryKeyHash < FirstValid) entryKeyHash += FirstValid;
+
+        Table*   currentTable = _currentTable.load();
+        uint32_t mask         = (currentTable->maxSize - 1) & (~(KeyDirAssocQty - 1));
+        int      idx          = keyHash & mask;
+        uint32_t probeIncr    = 1;
+        uint32_t cellId       = 0;
+
+        while (true) {
+            cellId = 0;
+            while (cellId < KeyDirAssocQty && currentTable->nodes[idx + cellId].hash >= FirstValid) {
+                if (currentTable->nodes[idx + cellId].hash == keyHash) {
+                    IndexChunk* indexChunk = (IndexChunk*)_tlsfAlloc.uncompress(currentTable->nodes[idx + cellId].loc);
+                    if (indexChunk->keyPartSize == keyPartSize &&
+                        !memcmp(((uint8_t*)indexChunk) + sizeof(IndexChunk), keyPart, keyPartSize)) {
+                        // Match found, entry update case
+                        _optimisticsCounters[keyHash & OptCounterMask]++;
+
+                        const uint32_t arrayStartOffset    = (uint32_t)((uint8_t*)indexChunk->getHashArrayStart() - (uint8_t*)indexChunk);
+                        const uint32_t accessibleEntrySize = (uint32_t)(_tlsfAlloc.getRealAllocatedSize(indexChunk) - arrayStartOffset);
+                        if ((indexChunk->entries + 1) * sizeof(uint32_t) > accessibleEntrySize) {
+                            // New allocation required because the current one is too small
+                            const uint32_t newMaxEntries = 2 * indexChunk->entries;
+                            uint32_t       targetSize    = arrayStartOffset + newMaxEntries * (uint32_t)sizeof(uint32_t);
+                            uint8_t*       ptr           = (uint8_t*)_tlsfAlloc.malloc(targetSize);
+                            if (ptr == nullptr) { return Status::OutOfMemory; }
+                            memcpy(ptr, indexChunk, arrayStartOffset + indexChunk->entries * sizeof(uint32_t));
+                            currentTable->nodes[idx + cellId].loc = _tlsfAlloc.compress(ptr);
+                            _tlsfAlloc.free(indexChunk);
+                            indexChunk = (IndexChunk*)ptr;
+                        }
+
+                        // Store the new entry
+                        assert((indexChunk->entries + 1) * sizeof(uint32_t) <=
+                               (uint32_t)(_tlsfAlloc.getRealAllocatedSize(indexChunk) - arrayStartOffset));
+                        uint32_t* hashArray = indexChunk->getHashArrayStart();
+                        if (indexChunk->sortedEntries == indexChunk->entries &&
+                            (indexChunk->entries == 0 || hashArray[indexChunk->entries - 1] < entryKeyHash)) {
+                            ++indexChunk->sortedEntries;  // Still sorted
+                        }
+                        hashArray[indexChunk->entries++] = entryKeyHash;
+
+                        _optimisticsCounters[keyHash & OptCounterMask]++;
+                        return Status::Ok;
+                    }
+                }
+                ++cellId;
+            }
+
+            if (cellId < KeyDirAssocQty) { break; }  // Empty space spotted on this cache line, so key has not been found
+            idx = (idx + (probeIncr * KeyDirAssocQty)) & mask;
+            ++probeIncr;  // Between linear and quadratic probing
+        }
+
+        const uint32_t     newMaxEntries = 2;  // Starts with 2 elements max
+        constexpr uint32_t AlignMask     = (uint32_t)(sizeof(uint32_t) - 1);
+        uint32_t           targetSize = sizeof(IndexChunk) + ((keyPartSize + AlignMask) & (~AlignMask)) + newMaxEntries * sizeof(uint32_t);
+        uint8_t*           ptr        = (uint8_t*)_tlsfAlloc.malloc(targetSize);
+        if (ptr == nullptr) { return Status::OutOfMemory; }
+        IndexChunk* indexChunk = (IndexChunk*)ptr;
+        *indexChunk            = {keyPartSize, 1, 1};
+        memcpy(ptr + sizeof(IndexChunk), keyPart, keyPartSize);
+        indexChunk->getHashArrayStart()[0] = entryKeyHash;
+        currentTable->nodes[idx + cellId]                      = {keyHash, _tlsfAlloc.compress(ptr)};
+
+        currentTable->size += 1;
+        if ((uint64_t)128 * (_table0.size + _table1.size) > _maxLoadFactor128th * currentTable->maxSize) {
+            resize(2 * currentTable->maxSize);
+        }
+        return Status::Ok;
+    }
+
+    // An external reader RW-lock shall ensure that there is no edit at the same time, and be kept as long as the array is used.
+    // Returns the quantity of entries, the first 'sortedQty' ones being sorted (see sortEntryHashes)
+    uint32_t getEntryHashes(const void* keyPart, uint16_t keyPartSize, const uint32_t** entryHashes, uint32_t* sortedQty)
+    {
+        IndexChunk* indexChunk = findIndexChunk(keyPart, keyPartSize);
+        if (indexChunk == nullptr) { return 0; }  // Not found
+        *entryHashes = indexChunk->getHashArrayStart();
+        *sortedQty   = indexChunk->sortedEntries;
+        return indexChunk->entries;
+    }
+
+    // Sorts the entries appended since the last call and merges them with the sorted ones, removing the duplicates.
+    // Returns the quantity of entries. An external writer RW-lock shall ensure 1 writer at a time, and be kept as long as the array is used
+    uint32_t sortEntryHashes(const void* keyPart, uint16_t keyPartSize, const uint32_t** entryHashes)
+    {
+        IndexChunk* indexChunk = findIndexChunk(keyPart, keyPartSize);
+        if (indexChunk == nullptr) { return 0; }  // Not found
+        uint32_t* hashArray = indexChunk->getHashArrayStart();
+        if (indexChunk->sortedEntries < indexChunk->entries) {
+            std::sort(hashArray + indexChunk->sortedEntries, hashArray + indexChunk->entries);
+            std::inplace_merge(hashArray, hashArray + indexChunk->sortedEntries, hashArray + indexChunk->entries);
+            indexChunk->entries       = (uint32_t)(std::unique(hashArray, hashArray + indexChunk->entries) - hashArray);
+            indexChunk->sortedEntries = indexChunk->entries;
+        }
+        *entryHashes = hashArray;
+        return indexChunk->entries;
+    }
+
+    // An external writer RW-lock shall ensure 1 writer at a time and keep the lock as long as the returned array is used
+    bool getEntryHashesForUpdate(const void* keyPart, uint32_t keyPartSize, uint32_t** entryHashes, uint32_t** entries,
+                                 uint32_t** sortedEntries)
+    {
+        IndexChunk* indexChunk = findIndexChunk(keyPart, keyPartSize);
+        if (indexChunk == nullptr) { return false; }  // Not found, which is not supposed to happen unless the index is removed in-between
+        *entryHashes   = indexChunk->getHashArrayStart();
+        *entries       = &(indexChunk->entries);
+        *sortedEntries = &(indexChunk->sortedEntries);
+        return true;
+    }
+
+    // Above this load factor, the KeyDir will get resized
+    bool setMaxLoadFactor(double f)
+    {
+        if (f <= 0. || f > 1.) return false;
+        _maxLoadFactor128th = (uint64_t)(128. * f);
+        return true;
+    }
+
+    // Resizes once, so that the provided quantity of entries can be inserted without further resizing
+    void reserve(uint32_t entryQty)
+    {
+        uint64_t requiredSize = ((uint64_t)128 * entryQty) / std::max(_maxLoadFactor128th, (uint64_t)1) + 1;
+        uint32_t newMaxSize   = capacity();
+        while (newMaxSize < requiredSize && newMaxSize < 0x80000000) { newMaxSize *= 2; }
+        if (newMaxSize > capacity()) { resize(newMaxSize); }
+    }
+
+    double getLoadFactor() const
+    {
+        return (double)(_table0.size + _table1.size) / (double)std::max(std::max(_table0.maxSize, _table1.maxSize), 1U);
+    }
+
+    uint64_t getEstimatedUsedMemoryBytes() const
+    {
+        return sizeof(MapEntry) * (_table0.maxSize + _table1.maxSize) + _tlsfAlloc.getAllocatedBytes();
+    }
+
+    void resize(uint32_t newMaxSize)
+    {
+        // Allocate the new table
+        Table* newTable = (_currentTable.load() == &_table0) ? &_table1 : &_table0;
+        osFreeTable((uint8_t*)newTable->nodes, sizeof(MapEntry) * newTable->maxSize);
+        newTable->nodes   = (MapEntry*)osAllocateTable(sizeof(MapEntry) * newMaxSize, _memoryPolicy);  // Zeroed by the OS
+        newTable->maxSize = newMaxSize;
+        newTable->size    = 0;
+
+        Table*   oldTable = (newTable == &_table0) ? &_table1 : &_table0;
+        uint32_t newMask  = (newTable->maxSize - 1) & (~(KeyDirAssocQty - 1));
+
+        // Transfer the data
+        for (uint32_t oldIdx = 0; oldIdx < oldTable->maxSize; ++oldIdx) {
+            if (oldTable->nodes[oldIdx].hash < FirstValid) continue;
+
+            uint32_t newIdx    = oldTable->nodes[oldIdx].hash & newMask;
+            uint32_t probeIncr = 1;
+            uint32_t cellId    = 0;
+
+            while (true) {
+                cellId = 0;
+                while (cellId < KeyDirAssocQty && newTable->nodes[newIdx + cellId].hash >= FirstValid) ++cellId;
+                if (cellId < KeyDirAssocQty) { break; }  // Empty space spotted on this cache line
+                newIdx = (newIdx + (probeIncr * KeyDirAssocQty)) & newMask;
+                ++probeIncr;
+            }
+
+            assert(cellId < KeyDirAssocQty && newTable->nodes[newIdx + cellId].hash < FirstValid);
+            newTable->nodes[newIdx + cellId] = oldTable->nodes[oldIdx];
+            newTable->size += 1;
+            oldTable->size -= 1;  // So that the sum of the sizes is accurate
+        }
+
+        oldTable->size = 0;  // Cleared table
+
+        // Swap
+        _currentTable.store(newTable);
+    }
+
+   private:
+    // Definitions
+    struct Table {
+        MapEntry* nodes   = nullptr;  // Page aligned
+        uint32_t  size    = 0;
+        uint32_t  maxSize = 0;
+    };
+
+    // Constants
+    static constexpr int OptCounterQty   = 8192;
+    static constexpr int OptCounterMask  = OptCounterQty - 1;
+    static constexpr int CurrentTableNbr = (1 << 0);
+
+    IndexChunk* findIndexChunk(const void* keyPart, uint32_t keyPartSize) const
+    {
+        uint32_t keyHash = (uint32_t)LITECASK_HASH_FUNC(keyPart, keyPartSize);
+        if (keyHash < FirstValid) keyHash += FirstValid;
+
+        Table*   currentTable = _currentTable.load();
+        uint32_t mask         = (currentTable->maxSize - 1) & (~(KeyDirAssocQty - 1));
+        int      idx          = keyHash & mask;
+        uint32_t probeIncr    = 1;
+
+        while (true) {
+            uint32_t cellId = 0;
+            for (; cellId < KeyDirAssocQty && currentTable->nodes[idx + cellId].hash >= FirstValid; ++cellId) {
+                if (currentTable->nodes[idx + cellId].hash == keyHash) {
+                    IndexChunk* indexChunk = (IndexChunk*)_tlsfAlloc.uncompress(currentTable->nodes[idx + cellId].loc);
+                    if (indexChunk->keyPartSize == keyPartSize &&
+                        !memcmp(((uint8_t*)indexChunk) + sizeof(IndexChunk), keyPart, keyPartSize)) {
+                        return indexChunk;
+                    }
+                }
+            }
+
+            if (cellId < KeyDirAssocQty) { break; }  // Empty space spotted on this cache line, so key has not been found
+            idx = (idx + (probeIncr * KeyDirAssocQty)) & mask;
+            ++probeIncr;  // Between linear and quadratic probing
+        }
+        return nullptr;
+    }
+
+    // Fields
+    Table               _table0;
+    Table               _table1;
+    std::atomic<Table*> _currentTable       = &_table1;
+    uint64_t            _maxLoadFactor128th = (uint64_t)(0.90 * 128);  // 90% load factor with 8-associativity is ok
+    TlsfAllocator       _tlsfAlloc;
+    MemoryPolicy        _memoryPolicy;
+    std::array<std::atomic<uint32_t>, OptCounterQty> _optimisticsCounters = {0};
+};
+
+// ==========================================================================================
+// KeyDir Hashmap
+// ==========================================================================================
+
+struct OldKeyChunk {
+    bool     isValid       = false;
+    uint32_t valueSize     = 0;
+    ValueLoc cacheLocation = NotStored;
+    uint16_t fileId        = 0;
+    uint16_t keyIndexQty   = 0;  // Index qty, and not bytes
+    KeyIndex keyIndexes[MaxKeyIndexQty];
+};
+
+// Scheduled expiry of a KeyDir entry with a TTL. It becomes obsolete if the entry is updated, and is then dropped either when due or
+// when the obsolete records make up half of its bucket
+struct ExpiryRecord {
+    uint32_t keyHash;
+    uint32_t expTimeSec;
+};
+
+struct ExpiryBucket {
+    lcVector<ExpiryRecord> records;
+    uint32_t               obsoleteQty = 0;  // Upper bound of the quantity of obsolete records
+};
+
+// KeyDir entry invalidated at its TTL expiry, with the information required to update the cache and the data file statistics
+struct ExpiredEntry {
+    uint32_t keyHash;
+    uint32_t keySize;
+    uint32_t valueSize;
+    uint16_t fileId;
+    ValueLoc cacheLocation;
+};
+
+// Entry copied by a scan of the key directory. The key and its key indexes are stored in a separate byte array
+struct KeyDirScanEntry {
+    KeyChunk metadata;
+    uint32_t keyHash;
+    uint32_t keyOffset;  // Offset of the key in the byte array (absent in fingerprint mode), followed by the key indexes
+};
+
+class KeyDirMap
+{
+   public:
+    KeyDirMap(uint64_t keyMaxAllocBytes, uint32_t initMapSize, const std::function<void(uint32_t, bool, bool)>& notifyResizing)
+        : _notifyResizing(notifyResizing), _tlsfAlloc(keyMaxAllocBytes)
+    {
+        assert(notifyResizing);
+
+        // Sanity: Check that the initial size is a power of 2
+        uint32_t checkSize = initMapSize;
+        while ((checkSize & 1) == 0) checkSize >>= 1;
+        assert(checkSize == 1);
+
+        // Allocate the initial map and key storage
+        resize(initMapSize);
+        _expiryWheel.resize(ExpiryWheelBucketQty);
+        _expiryRoundWheel.resize(ExpiryWheelBucketQty);
+    }
+
+    ~KeyDirMap()
+    {
+        osFreeTable((uint8_t*)_table0.nodes, sizeof(MapEntry) * _table0.maxSize);
+        osFreeTable((uint8_t*)_table1.nodes, sizeof(MapEntry) * _table1.maxSize);
+        for (const RetiredTable& rt : _retiredTables) { osFreeTable((uint8_t*)rt.table.nodes, sizeof(MapEntry) * rt.table.maxSize); }
+    }
+
+    void reset()
+    {
+        for (uint32_t i = 0; i < _table0.maxSize; ++i) { _table0.nodes[i].hash = Empty; }
+        _table0.size = 0;
+        for (uint32_t i = 0; i < _table1.maxSize; ++i) { _table1.nodes[i].hash = Empty; }
+        _table1.size = 0;
+        for (ExpiryBucket& bucket : _expiryWheel) { bucket = {}; }
+        for (ExpiryBucket& bucket : _expiryRoundWheel) { bucket = {}; }
+        _expiryRecordQty = 0;
+        _expiryBucketPos = 0;
+    }
+
+    uint32_t size() const { return _table0.size + _table1.size; }
+
+    uint32_t capacity() const { return std::max(_table0.maxSize, _table1.maxSize); }
+
+    bool empty() const { return (size() == 0); }
+
+    static constexpr uint64_t Empty      = 0;
+    static constexpr uint64_t FirstValid = 1;
+
+#define LITECASK_FIND_KEY_LOOP(parameterActionCode)                                                                     \
+    mask      = (currentTable->maxSize - 1) & (~(KeyDirAssocQty - 1));                                                  \
+    idx       = keyHash & mask;                                                                                         \
+    probeIncr = 1;                                                                                                      \
+                                                                                                                        \
+    while (true) {                                                                                                      \
+        uint32_t cellId = 0;                                                                                            \
+        for (; cellId < KeyDirAssocQty && currentTable->nodes[idx + cellId].hash >= FirstValid; ++cellId) {             \
+            if (currentTable->nodes[idx + cellId].hash == keyHash) {                                                    \
+                KeyChunk* keyChunk = getKey(currentTable->nodes[idx + cellId].loc);                                     \
+                if (isStoredKey(keyChunk, keySize, storedKey)) {                                                        \
+                    if (keyChunk->expTimeSec > 0 && keyChunk->expTimeSec <= _nowTimeSec) { break; }                     \
+                    parameterActionCode;                                                                                \
+                }                                                                                                       \
+            }                                                                                                           \
+        }                                                                                                               \
+        if (cellId < KeyDirAssocQty) { break; } /* Empty space spotted on this cache line, so key has not been found */ \
+        idx = (idx + (probeIncr * KeyDirAssocQty)) & mask;                                                              \
+        ++probeIncr; /* Between linear and quadratic probing */                                                         \
+    }
+
+#define LITECASK_FIND_KEY_AND_DO_ACTION(parameterActionCode)                                     \
+    uint32_t    mask;                                                                            \
+    int         idx;                                                                             \
+    uint32_t    probeIncr;                                                                       \
+    uint64_t    fingerprint = 0;                                                                 \
+    const void* storedKey   = getStoredKey(key, keySize, fingerprint);                           \
+    if (keyHash < FirstValid) keyHash += FirstValid;                                             \
+    Table* currentTable = ((_signalBitmap.load() & CurrentTableNbr) == 0) ? &_table0 : &_table1; \
+    LITECASK_FIND_KEY_LOOP(parameterActionCode);                                                 \
+    if (_signalBitmap.load() & UnderResizing) { /* Try the other table */                        \
+        currentTable = (currentTable == &_table0) ? &_table1 : &_table0;                         \
+        LITECASK_FIND_KEY_LOOP(parameterActionCode);                                             \
+    }
+
+#define LITECASK_FIND_HASH_LOOP(parameterActionCode)                                                                    \
+    mask      = (currentTable->maxSize - 1) & (~(KeyDirAssocQty - 1));                                                  \
+    idx       = keyHash & mask;                                                                                         \
+    probeIncr = 1;                                                                                                      \
+                                                                                                                        \
+    while (true) {                                                                                                      \
+        uint32_t cellId = 0;                                                                                            \
+        for (; cellId < KeyDirAssocQty && currentTable->nodes[idx + cellId].hash >= FirstValid; ++cellId) {             \
+            if (currentTable->nodes[idx + cellId].hash == keyHash) {                                                    \
+                KeyChunk* keyChunk = getKey(currentTable->nodes[idx + cellId].loc);                                     \
+                parameterActionCode;                                                                                    \
+            }                                                                                                           \
+        }                                                                                                               \
+        if (cellId < KeyDirAssocQty) { break; } /* Empty space spotted on this cache line, so key has not been found */ \
+        idx = (idx + (probeIncr * KeyDirAssocQty)) & mask;                                                              \
+        ++probeIncr; /* Between linear and quadratic probing */                                                         \
+    }
+
+#define LITECASK_FIND_HASH_AND_DO_ACTION(parameterActionCode)                                    \
+    uint32_t mask;                                                                               \
+    int      idx;                                                                                \
+    uint32_t probeIncr;                                                                          \
+    if (keyHash < FirstValid) keyHash += FirstValid;                                             \
+    Table* currentTable = ((_signalBitmap.load() & CurrentTableNbr) == 0) ? &_table0 : &_table1; \
+    LITECASK_FIND_HASH_LOOP(parameterActionCode);                                                \
+    if (_signalBitmap.load() & UnderResizing) { /* Try the other table */                        \
+        currentTable = (currentTable == &_table0) ? &_table1 : &_table0;                         \
+        LITECASK_FIND_HASH_LOOP(parameterActionCode);                                            \
+    }
+
+    void updateMergedValueLocation(uint32_t keyHash, uint16_t oldFileId, uint32_t oldFileOffset, uint16_t newFileId, uint32_t newFileOffset)
+    {
+        LITECASK_FIND_HASH_AND_DO_ACTION({
+            if (keyChunk->fileId == oldFileId && keyChunk->fileOffset == oldFileOffset) {
+                keyChunk->fileId     = newFileId;
+                keyChunk->fileOffset = newFileOffset;
+                return;
+            }
+            // Continue looking for another entry with the same hash in the keydir
+        });
+    }
+
+    void updateCachedValueLocation(uint32_t keyHash, const void* key, uint16_t keySize, uint32_t checkValueSize, uint8_t checkChangeCounter,
+                                   ValueLoc newCacheLocation)
+    {
+        LITECASK_FIND_KEY_AND_DO_ACTION({
+            if (keyChunk->valueSize == checkValueSize && keyChunk->changeCounter == checkChangeCounter) {
+                keyChunk->cacheLocation = newCacheLocation;
+            }
+            return;
+        });
+    }
+
+    // In fingerprint mode, the key is not stored and the returned one is empty. The optional 'metadata' then provides its location
+    LITECASK_ATTRIBUTE_NO_SANITIZE_THREAD
+    bool getKeyAndIndexes(uint32_t keyHash, lcVector<uint8_t>& key, lcVector<KeyIndex>& keyIndexes, KeyChunk* metadata = nullptr)
+    {
+        ReaderScope readerScope(*this);
+        LITECASK_FIND_HASH_AND_DO_ACTION({
+            bool     wasNotTheRightHash = false;
+            uint32_t lockCounterBefore;
+            do {
+                lockCounterBefore     = _optimisticsCounters[keyHash & OptCounterMask];  // Optimistic locking
+                uint32_t valueSize    = keyChunk->valueSize;
+                uint16_t keySize      = keyChunk->keySize;
+                uint8_t  keyIndexSize = keyChunk->keyIndexSize;
+
+                // Ensure non corrupted sizes
+                if ((lockCounterBefore & 0x1) == 0 && (_optimisticsCounters[keyHash & OptCounterMask]) == lockCounterBefore) {
+                    if (valueSize == DeletedEntry || (keyChunk->expTimeSec > 0 && keyChunk->expTimeSec <= _nowTimeSec)) {
+                        wasNotTheRightHash = true;  // The entry with matching hash is invalid. We continue looking for another entry.
+                        continue;
+                    }
+                    uint16_t inMemoryKeySize = _isFingerprintMode ? 0 : keySize;
+                    key.resize(inMemoryKeySize);
+                    memcpy(key.data(), ((uint8_t*)keyChunk) + sizeof(KeyChunk), inMemoryKeySize);
+                    keyIndexes.resize(keyIndexSize);
+                    if (keyIndexSize) {
+                        memcpy(keyIndexes.data(), ((uint8_t*)keyChunk) + sizeof(KeyChunk) + getStoredKeySize(keySize), keyIndexSize);
+                    }
+                    if (metadata) { *metadata = *keyChunk; }
+                }
+            } while ((lockCounterBefore & 0x1) ||
+                     (_optimisticsCounters[keyHash & OptCounterMask]) != lockCounterBefore);  // Odd means under write
+            if (wasNotTheRightHash) { continue; }  // Continue looking for another entry in the keydir
+            return true;
+        });
+        return false;
+    }
+
+    LITECASK_ATTRIBUTE_NO_SANITIZE_THREAD
+    bool cleanIndex(uint32_t keyHash, const void* keyPart, uint16_t keyPartSize)
+    {
+        LITECASK_FIND_HASH_AND_DO_ACTION({
+            if (keyChunk->valueSize != DeletedEntry && (keyChunk->expTimeSec == 0 || keyChunk->expTimeSec > _nowTimeSec)) {
+                continue;  // The entry is valid, so no cleaning needed. We continue looking for an entry to clean.
+            }
+
+            // In fingerprint mode, the key part cannot be checked as the key is not stored: all the key indexes of the obsolete
+            // entry are dropped. An index list may then get a duplicated hash if the entry is written again, which the query ignores
+            if (_isFingerprintMode) {
+                keyChunk->keyIndexSize = 0;
+                return true;
+            }
+
+            // If entry is not deleted and the key part is found, then it shall be kept (also in the index)
+            // Else, it shall be removed (if needed) and index updated.
+            uint8_t* key     = (uint8_t*)keyChunk + sizeof(KeyChunk);
+            uint8_t* kiArray = key + keyChunk->keySize;
+            for (int kIdx = 0; kIdx < (int)keyChunk->keyIndexSize; kIdx += sizeof(KeyIndex)) {
+                KeyIndex& ki = *(KeyIndex*)(kiArray + kIdx);
+                if (ki.size != keyPartSize || memcmp(&key[ki.startIdx], keyPart, keyPartSize)) { continue; }
+                // Key part is present
+                // Case obsolete entry: the key part is removed (keeping the order)
+                if (kIdx + sizeof(KeyIndex) < (int)keyChunk->keyIndexSize) {
+                    memmove(&ki, (&ki) + sizeof(KeyIndex), ((int)keyChunk->keyIndexSize - (kIdx + sizeof(KeyIndex))));
+                }
+                assert(keyChunk->keyIndexSize >= (uint8_t)sizeof(KeyIndex));
+                keyChunk->keyIndexSize -= (uint8_t)sizeof(KeyIndex);
+                return true;  // Key part found and removed from the entry. The index definitely needs cleaning
+            }
+
+            continue;  // Key part is not found in this entry. We continue looking for an entry to clean
+        });
+        return true;  // No hash matching entry with such key part found. The index definitely needs cleaning
+    }
+
+    LITECASK_ATTRIBUTE_NO_SANITIZE_THREAD
+    bool find(uint32_t keyHash, const void* key, uint16_t keySize, KeyChunk& entry)
+    {
+        ReaderScope readerScope(*this);
+        LITECASK_FIND_KEY_AND_DO_ACTION({
+            if (_isInstrumentationEnable) {
+                if (probeIncr > _instrumentedProbeMax) { _instrumentedProbeMax = probeIncr; }
+                _instrumentedProbeSum += probeIncr;
+                ++_instrumentedFindCount;
+            }
+            uint32_t lockCounterBefore;
+            do {
+                lockCounterBefore = _optimisticsCounters[keyHash & OptCounterMask];  // Optimistic locking
+                entry             = *keyChunk;
+            } while ((lockCounterBefore & 0x1) ||
+                     (_optimisticsCounters[keyHash & OptCounterMask]) != lockCounterBefore);  // Odd means under write
+            return true;
+        });
+        return false;
+    }
+
+    // Returns true when the entry is successfully stored. May fail if OOM
+    LITECASK_ATTRIBUTE_NO_SANITIZE_THREAD
+    Status insertEntry(uint32_t keyHash, const void* key, const void* keyIndexes, const KeyChunk& entry, OldKeyChunk& oldEntry)
+    {
+        if (keyHash < FirstValid) keyHash += FirstValid;
+        oldEntry.isValid = false;
+        uint64_t    fingerprint = 0;
+        const void* storedKey   = getStoredKey(key, entry.keySize, fingerprint);
+
+        // Insert only in current table. An external lock shall ensure 1 writer at a time
+        Table*   currentTable = ((_signalBitmap.load() & CurrentTableNbr) == 0) ? &_table0 : &_table1;
+        uint32_t mask         = (currentTable->maxSize - 1) & (~(KeyDirAssocQty - 1));
+        int      idx          = keyHash & mask;
+        uint32_t probeIncr    = 1;
+        uint32_t cellId       = 0;
+
+        while (true) {
+            cellId = 0;
+            while (cellId < KeyDirAssocQty && currentTable->nodes[idx + cellId].hash >= FirstValid) {
+                if (currentTable->nodes[idx + cellId].hash == keyHash) {
+                    KeyChunk* keyChunk = getKey(currentTable->nodes[idx + cellId].loc);
+                    if (isStoredKey(keyChunk, entry.keySize, storedKey)) {
+                        // Match found, entry update case
+                        _optimisticsCounters[keyHash & OptCounterMask]++;
+
+                        oldEntry.isValid       = true;
+                        oldEntry.valueSize     = keyChunk->valueSize;
+                        oldEntry.cacheLocation = keyChunk->cacheLocation;
+                        oldEntry.fileId        = keyChunk->fileId;
+                        oldEntry.keyIndexQty   = (uint16_t)((int)keyChunk->keyIndexSize / sizeof(KeyIndex));
+                        if (oldEntry.keyIndexQty) {
+                            memcpy(&oldEntry.keyIndexes, ((uint8_t*)keyChunk) + sizeof(KeyChunk) + getStoredKeySize(keyChunk->keySize),
+                                   keyChunk->keyIndexSize);
+                        }
+                        uint32_t oldExpTimeSec = (keyChunk->valueSize != DeletedEntry) ? keyChunk->expTimeSec : 0;
+                        Status   storageStatus = updateKey(storedKey, keyIndexes, entry, currentTable->nodes[idx + cellId].loc);
+
+                        _optimisticsCounters[keyHash & OptCounterMask]++;
+                        if (storageStatus == Status::Ok) { updateExpirySchedule(keyHash, oldExpTimeSec, entry); }
+                        return storageStatus;
+                    }
+                }
+                ++cellId;
+            }
+            if (cellId < KeyDirAssocQty) { break; } /* Empty space spotted on this cache line, so key has not been found */
+            idx = (idx + (probeIncr * KeyDirAssocQty)) & mask;
+            ++probeIncr;  // Between linear and quadratic probing
+        }
+
+        KeyLoc keyLoc        = NotStored;
+        Status storageStatus = insertKey(storedKey, keyIndexes, entry, keyLoc);
+        if (storageStatus != Status::Ok) { return storageStatus; }  // Failure to store the key due to OOM or too big key
+        // No need for protection vs "get" as there is no key removal API (tombstone instead)
+        assert(cellId < KeyDirAssocQty && currentTable->nodes[idx + cellId].hash < FirstValid);
+        currentTable->nodes[idx + cellId] = {keyHash, keyLoc};
+        updateExpirySchedule(keyHash, 0, entry);
+
+        currentTable->size += 1;
+        if ((uint64_t)128 * (_table0.size + _table1.size) > _maxLoadFactor128th * currentTable->maxSize) {
+            resize(2 * currentTable->maxSize);
+        }
+        return Status::Ok;
+    }
+
+    void resize(uint32_t newMaxSize)
+    {
+        // Emergency case: if the next resize arrives and the previous is not finished, just force-finish it
+        constexpr uint32_t EmergencyBatchSize = 1'000'000;
+        if (isResizingOngoing()) {
+            while (isResizingOngoing()) { backgroundResizeWork(EmergencyBatchSize, true); }
+        }
+
+        // Allocate the new table
+        // Lock-free readers may still be probing the previous table, so it is not unmapped yet: it is emptied (and its physical memory
+        // released on Linux) and retired. It is freed once the readers which may have seen it are gone
+        Table* newTable = ((_signalBitmap.load() & CurrentTableNbr) == 0) ? &_table1 : &_table0;
+        if (newTable->nodes) {
+            osReleaseTableMemory((uint8_t*)newTable->nodes, sizeof(MapEntry) * newTable->maxSize);
+            _retiredTables.push_back({*newTable, 0});
+        }
+        newTable->nodes   = (MapEntry*)osAllocateTable(sizeof(MapEntry) * newMaxSize, _memoryPolicy);  // Zeroed by the OS
+        newTable->maxSize = newMaxSize;
+        newTable->size    = 0;
+        reclaimRetiredTables();
+
+        // Start the background resizing process
+        _resizeNextIdx = 0;
+        if (_table0.size != 0 || _table1.size != 0) {
+            _signalBitmap.store(UnderResizing | (_signalBitmap.load() ^ CurrentTableNbr));
+            _notifyResizing(newMaxSize, true, false);  // Notify the start of the resizing job
+        } else {
+            // Construction time (empty tables)
+            _signalBitmap.store(_signalBitmap.load() ^ CurrentTableNbr);
+        }
+    }
+
+    // Note: writer lock is expected to be taken
+    void backgroundResizeWork(uint32_t batchSize, bool wasForced = false)
+    {
+        assert(batchSize > 0);
+        if (!isResizingOngoing()) { return; }
+
+        Table*   oldTable   = ((_signalBitmap.load() & CurrentTableNbr) == 0) ? &_table1 : &_table0;
+        Table*   newTable   = (oldTable == &_table0) ? &_table1 : &_table0;
+        uint32_t newMask    = (newTable->maxSize - 1) & (~(KeyDirAssocQty - 1));
+        uint32_t lastOldIdx = std::min(_resizeNextIdx + batchSize, oldTable->maxSize);
+
+        // Transfer a batch of data
+        for (uint32_t oldIdx = _resizeNextIdx; oldIdx < lastOldIdx; ++oldIdx) {
+            if (oldTable->nodes[oldIdx].hash < FirstValid) continue;
+
+            uint32_t newIdx    = oldTable->nodes[oldIdx].hash & newMask;
+            uint32_t probeIncr = 1;
+            uint32_t cellId    = 0;
+
+            while (true) {
+                cellId = 0;
+                while (cellId < KeyDirAssocQty && newTable->nodes[newIdx + cellId].hash >= FirstValid) ++cellId;
+                if (cellId < KeyDirAssocQty) { break; }  // Empty space spotted on this cache line
+                newIdx = (newIdx + (probeIncr * KeyDirAssocQty)) & newMask;
+                ++probeIncr;
+            }
+
+            assert(cellId < KeyDirAssocQty && newTable->nodes[newIdx + cellId].hash < FirstValid);
+            newTable->nodes[newIdx + cellId] = oldTable->nodes[oldIdx];
+            newTable->size += 1;
+            oldTable->size -= 1;  // So that the sum of the sizes is accurate
+        }
+
+        _resizeNextIdx = lastOldIdx;
+        if (lastOldIdx == oldTable->maxSize) {
+            oldTable->size = 0;                                    // Cleared table
+            _notifyResizing(newTable->maxSize, false, wasForced);  // Notify the end of the resizing job
+            _signalBitmap.store((~UnderResizing) & _signalBitmap.load());
+        }
+        reclaimRetiredTables();
+    }
+
+    // Frees the retired tables whose grace period is over: each reader slot has been seen without reader since their retirement,
+    // so that no lock-free reader may still probe them.
+    // Note: writer lock is expected to be taken
+    void reclaimRetiredTables()
+    {
+        if (_retiredTables.empty()) { return; }
+        std::atomic_thread_fence(std::memory_order_seq_cst);  // The readers registered after this point see only the current tables
+        uint32_t idleSlotMask = 0;
+        for (uint32_t slotIdx = 0; slotIdx < ReaderSlotQty; ++slotIdx) {
+            if (_readerSlots[slotIdx].qty.load() == 0) { idleSlotMask |= (1U << slotIdx); }
+        }
+        size_t keptQty = 0;
+        for (RetiredTable& rt : _retiredTables) {
+            rt.idleSlotMask |= idleSlotMask;
+            if (rt.idleSlotMask == AllReaderSlotMask) {
+                osFreeTable((uint8_t*)rt.table.nodes, sizeof(MapEntry) * rt.table.maxSize);
+                continue;
+            }
+            _retiredTables[keptQty++] = rt;
+        }
+        _retiredTables.resize(keptQty);
+        _retiredTableQty.store((uint32_t)keptQty);
+    }
+
+    // Quantity of retired tables not yet freed. It can be read without the writer lock
+    uint32_t getRetiredTableQty() const { return _retiredTableQty.load(); }
+
+    // Registers a lock-free reader of the tables for its lifetime, so that the tables it may probe are not freed.
+    // The threads are spread on several counters, each on its own cache line
+    class ReaderScope
+    {
+       public:
+        explicit ReaderScope(KeyDirMap& map) : _qty(map._readerSlots[getReaderSlotIdx()].qty) { _qty.fetch_add(1); }
+        ~ReaderScope() { _qty.fetch_sub(1, std::memory_order_release); }
+        ReaderScope(const ReaderScope&)            = delete;
+        ReaderScope& operator=(const ReaderScope&) = delete;
+
+       private:
+        static uint32_t getReaderSlotIdx()
+        {
+            static std::atomic<uint32_t> nextSlotIdx{0};
+            thread_local uint32_t        slotIdx = (nextSlotIdx++) % ReaderSlotQty;
+            return slotIdx;
+        }
+        std::atomic<uint32_t>& _qty;
+    };
+
+    // Invalidates the entries whose TTL expired, by visiting only the expiry wheel buckets of the elapsed seconds.
+    // At most 'batchSize' expiry records are processed, and the invalidated entries are appended to 'expiredEntries'.
+    // It returns the quantity of processed records. The records of a round are moved from the second level of the wheel to the
+    // first one when this round starts, which is not bounded by 'batchSize'.
+    // Note: writer lock is expected to be taken
+    uint32_t backgroundExpiredKeyCleaning(uint32_t batchSize, lcVector<ExpiredEntry>& expiredEntries)
+    {
+        assert(batchSize > 0);
+
+        // After a long pause (or at start), all the buckets of the first level are due: one wheel round is enough to visit them.
+        // The skipped rounds of the second level are moved to the first level
+        if (_expiryNextSec + ExpiryWheelBucketQty <= _nowTimeSec) {
+            uint32_t oldRound = _expiryNextSec / ExpiryWheelBucketQty;
+            _expiryNextSec    = _nowTimeSec - ExpiryWheelBucketQty + 1;
+            _expiryBucketPos  = 0;
+            uint32_t newRound = _expiryNextSec / ExpiryWheelBucketQty;
+            for (uint32_t round = oldRound + 1; round <= newRound && round <= oldRound + ExpiryWheelBucketQty; ++round) {
+                cascadeExpiryRound(round % ExpiryWheelBucketQty, newRound);
+            }
+        }
+
+        uint32_t processedQty = 0;
+        while (_expiryNextSec <= _nowTimeSec) {
+            lcVector<ExpiryRecord>& bucket = _expiryWheel[_expiryNextSec % ExpiryWheelBucketQty].records;
+            while (_expiryBucketPos < bucket.size() && processedQty < batchSize) {
+                ExpiryRecord record = bucket[_expiryBucketPos];
+                ++processedQty;
+                if (record.expTimeSec > _nowTimeSec) {
+                    ++_expiryBucketPos;  // Only if the clock went backward
+                    continue;
+                }
+                bucket[_expiryBucketPos] = bucket.back();
+                bucket.pop_back();
+                --_expiryRecordQty;
+                invalidateExpiredEntries(record.keyHash, expiredEntries);
+            }
+            if (_expiryBucketPos < bucket.size()) { break; }  // Batch exhausted, the bucket will be resumed
+            if (bucket.empty()) { _expiryWheel[_expiryNextSec % ExpiryWheelBucketQty].obsoleteQty = 0; }
+            _expiryBucketPos = 0;
+            ++_expiryNextSec;
+            if ((_expiryNextSec % ExpiryWheelBucketQty) == 0) {  // Start of a new round
+                uint32_t round = _expiryNextSec / ExpiryWheelBucketQty;
+                cascadeExpiryRound(round % ExpiryWheelBucketQty, round);
+            }
+        }
+        return processedQty;
+    }
+
+    // Quantity of scheduled expiries, some of them possibly obsolete
+    uint32_t getExpiryRecordQty() const { return _expiryRecordQty; }
+
+    bool isResizingOngoing() const { return (_signalBitmap.load() & UnderResizing); }
+
+    // Copies the valid entries of the slots [startSlot, startSlot + slotQty[ of the table, whose hash is in [minHash, maxHash].
+    // No resizing shall be ongoing, so that all entries are in a single table whose size is returned.
+    // Note: writer lock is expected to be taken
+    uint32_t getScanEntries(uint32_t startSlot, uint32_t slotQty, uint32_t minHash, uint32_t maxHash, lcVector<KeyDirScanEntry>& entries,
+                            lcVector<uint8_t>& keyBytes)
+    {
+        assert(!isResizingOngoing());
+        entries.clear();
+        keyBytes.clear();
+
+        Table*   table   = ((_signalBitmap.load() & CurrentTableNbr) == 0) ? &_table0 : &_table1;
+        uint32_t lastIdx = std::min(startSlot + slotQty, table->maxSize);
+        for (uint32_t idx = startSlot; idx < lastIdx; ++idx) {
+            uint32_t hash = table->nodes[idx].hash;
+            if (hash < FirstValid || hash < minHash || hash > maxHash) { continue; }
+            KeyChunk* keyChunk = getKey(table->nodes[idx].loc);
+            if (keyChunk->valueSize == DeletedEntry || (keyChunk->expTimeSec > 0 && keyChunk->expTimeSec <= _nowTimeSec)) { continue; }
+            entries.push_back({*keyChunk, hash, (uint32_t)keyBytes.size()});
+            uint16_t       inMemoryKeySize = _isFingerprintMode ? 0 : keyChunk->keySize;  // Only the key indexes in fingerprint mode
+            const uint8_t* key = ((uint8_t*)keyChunk) + sizeof(KeyChunk) + getStoredKeySize(keyChunk->keySize) - inMemoryKeySize;
+            keyBytes.insert(keyBytes.end(), key, key + inMemoryKeySize + keyChunk->keyIndexSize);
+        }
+        return table->maxSize;
+    }
+
+    // Above this load factor, the KeyDir will get resized
+    bool setMaxLoadFactor(double f)
+    {
+        if (f <= 0. || f > 1.) return false;
+        _maxLoadFactor128th = (uint64_t)(128. * f);
+        return true;
+    }
+
+    // Resizes once, so that the provided quantity of entries can be inserted without further resizing
+    void reserve(uint32_t entryQty)
+    {
+        uint64_t requiredSize = ((uint64_t)128 * entryQty) / std::max(_maxLoadFactor128th, (uint64_t)1) + 1;
+        uint32_t newMaxSize   = capacity();
+        while (newMaxSize < requiredSize && newMaxSize < 0x80000000) { newMaxSize *= 2; }
+        if (newMaxSize > capacity()) { resize(newMaxSize); }
+    }
+
+    double getLoadFactor() const
+    {
+        return (double)(_table0.size + _table1.size) / (double)std::max(std::max(_table0.maxSize, _table1.maxSize), 1U);
+    }
+
+    uint64_t getEstimatedUsedMemoryBytes() const
+    {
+        return sizeof(MapEntry) * (_table0.maxSize + _table1.maxSize) + _tlsfAlloc.getAllocatedBytes();
+    }
+
+    // Only enabled in tests, to analyse the probing of the hash table when reading some entries
+    void setInstrumentationEnable(bool isEnable) { _isInstrumentationEnable = isEnable; }
+
+    // It returns the monotonic counters of probe count and find API call count, and the max probe count per call since the last
+    // getProbeCount call
+    void getProbeCount(uint64_t& probeMax, uint64_t& probeSum, uint64_t& findCount)
+    {
+        probeMax              = _instrumentedProbeMax;
+        _instrumentedProbeMax = 0;
+        probeSum              = _instrumentedProbeSum;
+        findCount             = _instrumentedFindCount;
+    }
+
+    void setNow(uint32_t nowTimeSec) { _nowTimeSec = nowTimeSec; }
+
+    // In fingerprint mode, only a 64-bit fingerprint of the key is stored instead of the key itself. It shall be set on an empty map
+    void setFingerprintMode(bool isEnabled)
+    {
+        assert(empty());
+        _isFingerprintMode = isEnabled;
+    }
+
+    bool isFingerprintMode() const { return _isFingerprintMode; }
+
+    // Applies to the key storage and to the current tables, and to the tables allocated afterwards
+    bool setMemoryPolicy(const MemoryPolicy& policy)
+    {
+        bool isApplied = _tlsfAlloc.setMemoryPolicy(policy);
+        for (Table* table : {&_table0, &_table1}) {
+            if (table->nodes) {
+                isApplied = osApplyMemoryPolicy(table->nodes, sizeof(MapEntry) * table->maxSize, policy, _memoryPolicy) && isApplied;
+            }
+        }
+        _memoryPolicy = policy;
+        return isApplied;
+    }
+
+   private:
+    KeyChunk* getKey(KeyLoc loc) const { return (KeyChunk*)_tlsfAlloc.uncompress(loc); }
+
+    // The first level of the wheel holds the expiries of the current round, the second one the expiries of the later rounds.
+    // An already due expiry goes in the next bucket to visit, instead of waiting a full wheel round
+    ExpiryBucket& getExpiryBucket(uint32_t expTimeSec)
+    {
+        uint32_t bucketSec = std::max(expTimeSec, _expiryNextSec);
+        if (bucketSec / ExpiryWheelBucketQty == _expiryNextSec / ExpiryWheelBucketQty) {
+            return _expiryWheel[bucketSec % ExpiryWheelBucketQty];
+        }
+        return _expiryRoundWheel[(bucketSec / ExpiryWheelBucketQty) % ExpiryWheelBucketQty];
+    }
+
+    // Keeps a single expiry record per entry with a TTL. The record of the previous expiry time is obsolete after an update, and
+    // the obsolete records of a bucket are dropped once they are the half of it, so that frequently updated TTLs do not pile up
+    void updateExpirySchedule(uint32_t keyHash, uint32_t oldExpTimeSec, const KeyChunk& entry)
+    {
+        uint32_t newExpTimeSec = (entry.valueSize != DeletedEntry) ? entry.expTimeSec : 0;
+        if (newExpTimeSec == oldExpTimeSec) { return; }  // The scheduled expiry, if any, is still the right one
+        if (newExpTimeSec != 0) {
+            getExpiryBucket(newExpTimeSec).records.push_back({keyHash, newExpTimeSec});
+            ++_expiryRecordQty;
+        }
+        if (oldExpTimeSec != 0) {
+            ExpiryBucket& bucket = getExpiryBucket(oldExpTimeSec);
+            if (2 * (++bucket.obsoleteQty) >= bucket.records.size()) {
+                dropObsoleteExpiryRecords(bucket);
+                if (&bucket == &_expiryWheel[_expiryNextSec % ExpiryWheelBucketQty]) { _expiryBucketPos = 0; }
+            }
+        }
+    }
+
+    // A record is obsolete if no valid entry with its hash has its expiry time
+    bool isExpiryRecordObsolete(const ExpiryRecord& record)
+    {
+        uint32_t keyHash = record.keyHash;
+        LITECASK_FIND_HASH_AND_DO_ACTION({
+            if (keyChunk->valueSize != DeletedEntry && keyChunk->expTimeSec == record.expTimeSec) { return false; }
+        });
+        return true;
+    }
+
+    void dropObsoleteExpiryRecords(ExpiryBucket& bucket)
+    {
+        uint32_t keptQty = 0;
+        for (const ExpiryRecord& record : bucket.records) {
+            if (!isExpiryRecordObsolete(record)) { bucket.records[keptQty++] = record; }
+        }
+        _expiryRecordQty -= (uint32_t)bucket.records.size() - keptQty;
+        bucket.records.resize(keptQty);
+        bucket.obsoleteQty = 0;
+    }
+
+    // Moves the records of the second level bucket whose round is not after 'lastRound' to the first level, which shall then cover
+    // the round 'lastRound'. The records of the farther rounds sharing this bucket stay in place
+    void cascadeExpiryRound(uint32_t roundBucketIdx, uint32_t lastRound)
+    {
+        ExpiryBucket& roundBucket = _expiryRoundWheel[roundBucketIdx];
+        if (roundBucket.obsoleteQty != 0) { dropObsoleteExpiryRecords(roundBucket); }
+        uint32_t keptQty = 0;
+        for (const ExpiryRecord& record : roundBucket.records) {
+            if (record.expTimeSec / ExpiryWheelBucketQty > lastRound) {
+                roundBucket.records[keptQty++] = record;
+                continue;
+            }
+            _expiryWheel[std::max(record.expTimeSec, _expiryNextSec) % ExpiryWheelBucketQty].records.push_back(record);
+        }
+        roundBucket.records.resize(keptQty);
+    }
+
+    // Invalidates the valid entries with this hash and an expired TTL
+    void invalidateExpiredEntries(uint32_t keyHash, lcVector<ExpiredEntry>& expiredEntries)
+    {
+        LITECASK_FIND_HASH_AND_DO_ACTION({
+            if (keyChunk->valueSize == DeletedEntry || keyChunk->expTimeSec == 0 || keyChunk->expTimeSec > _nowTimeSec) { continue; }
+            expiredEntries.push_back({keyHash, keyChunk->keySize, keyChunk->valueSize, keyChunk->fileId, keyChunk->cacheLocation});
+
+            _optimisticsCounters[keyHash & OptCounterMask]++;
+            keyChunk->expTimeSec    = 0;
+            keyChunk->valueSize     = DeletedEntry;
+            keyChunk->cacheLocation = NotStored;
+            _optimisticsCounters[keyHash & OptCounterMask]++;
+        });
+    }
+
+    // In fingerprint mode, the stored key is its 64-bit fingerprint
+    uint16_t getStoredKeySize(uint16_t keySize) const { return _isFingerprintMode ? (uint16_t)sizeof(uint64_t) : keySize; }
+
+    const void* getStoredKey(const void* key, uint16_t keySize, uint64_t& fingerprint) const
+    {
+        if (!_isFingerprintMode) { return key; }
+        fingerprint = LITECASK_FINGERPRINT_FUNC(key, keySize);
+        return &fingerprint;
+    }
+
+    bool isStoredKey(const KeyChunk* keyChunk, uint16_t keySize, const void* storedKey) const
+    {
+        return keyChunk->keySize == keySize && !memcmp(((const uint8_t*)keyChunk) + sizeof(KeyChunk), storedKey, getStoredKeySize(keySize));
+    }
+
+    Status insertKey(const void* storedKey, const void* keyIndexes, const KeyChunk& entry, KeyLoc& loc)
+    {
+        uint16_t storedKeySize = getStoredKeySize(entry.keySize);
+        uint32_t targetSize    = (uint32_t)(sizeof(KeyChunk) + storedKeySize + entry.keyIndexSize);
+        uint8_t* ptr        = (uint8_t*)_tlsfAlloc.malloc(targetSize);
+        if (ptr == nullptr) { return Status::OutOfMemory; }
+        loc         = _tlsfAlloc.compress(ptr);
+        KeyChunk* c = (KeyChunk*)ptr;
+        *c          = entry;
+        c->changeCounter += 1;
+        memcpy(ptr + sizeof(KeyChunk), storedKey, storedKeySize);
+        if (entry.keyIndexSize) { memcpy(ptr + sizeof(KeyChunk) + storedKeySize, keyIndexes, entry.keyIndexSize); }
+        return Status::Ok;
+    }
+
+    Status updateKey(const void* storedKey, const void* keyIndexes, const KeyChunk& entry, KeyLoc& locToUpdate)
+    {
+        KeyChunk* keyChunk      = getKey(locToUpdate);
+        uint16_t  storedKeySize = getStoredKeySize(entry.keySize);
+
+        uint32_t accessibleKeyIndexSize = (uint32_t)(_tlsfAlloc.getRealAllocatedSize(keyChunk) - sizeof(KeyChunk) - storedKeySize);
+        if (entry.keyIndexSize > accessibleKeyIndexSize) {
+            // New allocation required because the current one is too small
+            KeyLoc newKeyLoc     = NotStored;
+            Status storageStatus = insertKey(storedKey, keyIndexes, entry, newKeyLoc);
+            if (storageStatus != Status::Ok) { return storageStatus; }  // Failure to store the key due to OOM
+            KeyLoc oldKeyLoc = locToUpdate;
+            locToUpdate      = newKeyLoc;
+
+            // Invalidate and free the old chunk
+            memset(keyChunk, 0, sizeof(KeyChunk));
+            keyChunk->cacheLocation = NotStored;
+            keyChunk->fileOffset    = NotStored;
+            keyChunk->fileId        = 0xFFFF;
+            _tlsfAlloc.free(_tlsfAlloc.uncompress(oldKeyLoc));
+        } else if (entry.valueSize == DeletedEntry) {
+            // For deletion, we keep the previous key index. Setting back the size is enough.
+            // This is needed to avoid multiple entries in the index lookups if this entry is added back later
+            // with some matching key indexes.
+            uint8_t oldKeyIndexSize = keyChunk->keyIndexSize;
+            *keyChunk               = entry;
+            keyChunk->keyIndexSize  = oldKeyIndexSize;
+            keyChunk->changeCounter += 1;
+        } else {
+            *keyChunk = entry;
+            keyChunk->changeCounter += 1;
+            if (entry.keyIndexSize) { memcpy(((uint8_t*)keyChunk) + sizeof(KeyChunk) + storedKeySize, keyIndexes, entry.keyIndexSize); }
+        }
+        return Status::Ok;
+    }
+
+    // Definitions
+    struct Table {
+        MapEntry* nodes   = nullptr;  // Page aligned
+        uint32_t  size    = 0;
+        uint32_t  maxSize = 0;
+    };
+
+    struct RetiredTable {
+        Table    table;
+        uint32_t idleSlotMask;  // Reader slots seen without reader since the retirement
+    };
+
+    struct alignas(CpuCacheLine) ReaderSlot {
+        std::atomic<uint32_t> qty{0};
+    };
+
+    // Constants
+    static constexpr int      OptCounterQty     = 8192;
+    static constexpr int      OptCounterMask    = OptCounterQty - 1;
+    static constexpr int      CurrentTableNbr   = (1 << 0);
+    static constexpr int      UnderResizing     = (1 << 1);
+    static constexpr uint32_t ReaderSlotQty     = 32;
+    static constexpr uint32_t AllReaderSlotMask = 0xFFFFFFFF;
+
+    // Fields
+    alignas(CpuCacheLine) Table _table0;
+    Table                  _table1;
+    lcVector<RetiredTable> _retiredTables;
+    std::atomic<uint32_t>  _retiredTableQty = 0;
+    uint64_t              _maxLoadFactor128th = (uint64_t)(0.90 * 128);  // 90% load factor with 8-associativity is ok
+    std::atomic<uint64_t> _signalBitmap       = 0;                       // Table 0 and not resizing
+    uint32_t              _resizeNextIdx      = 0;
+    uint32_t              _expiryNextSec      = 0;  // Next second of the expiry wheel to visit
+    uint32_t              _expiryBucketPos    = 0;  // Position in the bucket being visited
+    uint32_t              _expiryRecordQty    = 0;
+    uint32_t              _nowTimeSec         = 0;
+    bool                  _isFingerprintMode  = false;
+    MemoryPolicy          _memoryPolicy;
+
+    alignas(CpuCacheLine) std::array<std::atomic<uint32_t>, OptCounterQty> _optimisticsCounters = {0};
+    std::array<ReaderSlot, ReaderSlotQty>     _readerSlots;
+    std::function<void(uint32_t, bool, bool)> _notifyResizing;
+
+    TlsfAllocator                    _tlsfAlloc;
+    lcVector<ExpiryBucket> _expiryWheel;       // First level, one bucket per second of the current round
+    lcVector<ExpiryBucket> _expiryRoundWheel;  // Second level, one bucket per later round
+    bool                   _isInstrumentationEnable = false;
+    uint64_t               _instrumentedProbeMax    = 0;
+    uint64_t               _instrumentedProbeSum    = 0;
+    uint64_t               _instrumentedFindCount   = 0;
+};
+
+// KeyDir split in shards, each of them with its own table, key storage, incremental resizing and writer lock.
+// Readers are lock-free as with a single KeyDirMap. Writers lock only the shard of the modified key, using getMutex(keyHash).
+struct KeyDirShard {
+    KeyDirShard(uint64_t keyMaxAllocBytes, uint32_t initMapSize, const std::function<void(uint32_t, bool, bool)>& notifyResizing)
+        : map(keyMaxAllocBytes, initMapSize, notifyResizing)
+    {
+    }
+    alignas(CpuCacheLine) std::mutex mx;  // lock for writing this shard
+    KeyDirMap map;
+};
+
+class ShardedKeyDir
+{
+   public:
+    ShardedKeyDir(uint64_t keyMaxAllocBytes, uint32_t initMapSize, const std::function<void(uint32_t, bool, bool)>& notifyResizing)
+    {
+        // Each shard owns an even part of the key storage budget, so that the key allocations need only the shard lock
+        uint32_t shardMapSize = std::max(initMapSize / KeyDirShardQty, 8 * KeyDirAssocQty);
+        for (uint32_t shardIdx = 0; shardIdx < KeyDirShardQty; ++shardIdx) {
+            _shards[shardIdx] = new KeyDirShard(keyMaxAllocBytes / KeyDirShardQty, shardMapSize, notifyResizing);
+        }
+    }
+
+    ~ShardedKeyDir()
+    {
+        for (KeyDirShard* shard : _shards) { delete shard; }
+    }
+
+    static uint32_t getShardIndex(uint32_t keyHash) { return keyHash >> (32 - KeyDirShardBits); }
+
+    KeyDirShard& getShard(uint32_t shardIdx) { return *_shards[shardIdx]; }
+
+    // Writer lock of the shard owning this key hash
+    std::mutex& getMutex(uint32_t keyHash) { return _shards[getShardIndex(keyHash)]->mx; }
+
+    // Locks of all shards, always taken in the same order
+    void lockAll()
+    {
+        for (KeyDirShard* shard : _shards) { shard->mx.lock(); }
+    }
+
+    void unlockAll()
+    {
+        for (uint32_t shardIdx = KeyDirShardQty; shardIdx > 0; --shardIdx) { _shards[shardIdx - 1]->mx.unlock(); }
+    }
+
+    void reset()
+    {
+        for (KeyDirShard* shard : _shards) { shard->map.reset(); }
+    }
+
+    void setFingerprintMode(bool isEnabled)
+    {
+        for (KeyDirShard* shard : _shards) { shard->map.setFingerprintMode(isEnabled); }
+    }
+
+    bool isFingerprintMode() const { return _shards[0]->map.isFingerprintMode(); }
+
+    bool setMemoryPolicy(const MemoryPolicy& policy)
+    {
+        bool isApplied = true;
+        for (KeyDirShard* shard : _shards) { isApplied = shard->map.setMemoryPolicy(policy) && isApplied; }
+        return isApplied;
+    }
+
+    uint32_t size() const
+    {
+        uint32_t total = 0;
+        for (const KeyDirShard* shard : _shards) { total += shard->map.size(); }
+        return total;
+    }
+
+    uint32_t capacity() const
+    {
+        uint32_t total = 0;
+        for (const KeyDirShard* shard : _shards) { total += shard->map.capacity(); }
+        return total;
+    }
+
+    bool empty() const { return (size() == 0); }
+
+    // Key hash based accesses, forwarded to the owning shard. Modifications require the shard writer lock
+    bool find(uint32_t keyHash, const void* key, uint16_t keySize, KeyChunk& entry)
+    {
+        return _shards[getShardIndex(keyHash)]->map.find(keyHash, key, keySize, entry);
+    }
+
+    bool getKeyAndIndexes(uint32_t keyHash, lcVector<uint8_t>& key, lcVector<KeyIndex>& keyIndexes, KeyChunk* metadata = nullptr)
+    {
+        return _shards[getShardIndex(keyHash)]->map.getKeyAndIndexes(keyHash, key, keyIndexes, metadata);
+    }
+
+    Status insertEntry(uint32_t keyHash, const void* key, const void* keyIndexes, const KeyChunk& entry, OldKeyChunk& oldEntry)
+    {
+        return _shards[getShardIndex(keyHash)]->map.insertEntry(keyHash, key, keyIndexes, entry, oldEntry);
+    }
+
+    void updateMergedValueLocation(uint32_t keyHash, uint16_t oldFileId, uint32_t oldFileOffset, uint16_t newFileId, uint32_t newFileOffset)
+    {
+        _shards[getShardIndex(keyHash)]->map.updateMergedValueLocation(keyHash, oldFileId, oldFileOffset, newFileId, newFileOffset);
+    }
+
+    void updateCachedValueLocation(uint32_t keyHash, const void* key, uint16_t keySize, uint32_t checkValueSize, uint8_t checkChangeCounter,
+                                   ValueLoc newCacheLocation)
+    {
+        _shards[getShardIndex(keyHash)]->map.updateCachedValueLocation(keyHash, key, keySize, checkValueSize, checkChangeCounter,
+                                                                       newCacheLocation);
+    }
+
+    bool cleanIndex(uint32_t keyHash, const void* keyPart, uint16_t keyPartSize)
+    {
+        return _shards[getShardIndex(keyHash)]->map.cleanIndex(keyHash, keyPart, keyPartSize);
+    }
+
+    bool isResizingOngoing() const
+    {
+        for (const KeyDirShard* shard : _shards) {
+            if (shard->map.isResizingOngoing()) { return true; }
+        }
+        return false;
+    }
+
+    bool setMaxLoadFactor(double f)
+    {
+        for (KeyDirShard* shard : _shards) {
+            if (!shard->map.setMaxLoadFactor(f)) { return false; }
+        }
+        return true;
+    }
+
+    // The hash distribution among the shards is not perfectly even, hence the margin
+    void reserve(uint32_t entryQty)
+    {
+        uint32_t shardEntryQty = (uint32_t)(((uint64_t)entryQty + entryQty / 8) / KeyDirShardQty + KeyDirAssocQty);
+        for (KeyDirShard* shard : _shards) { shard->map.reserve(shardEntryQty); }
+    }
+
+    double getLoadFactor() const { return (double)size() / (double)std::max(capacity(), 1U); }
+
+    uint64_t getEstimatedUsedMemoryBytes() const
+    {
+        uint64_t total = 0;
+        for (const KeyDirShard* shard : _shards) { total += shard->map.getEstimatedUsedMemoryBytes(); }
+        return total;
+    }
+
+    void setNow(uint32_t nowTimeSec)
+    {
+        for (KeyDirShard* shard : _shards) { shard->map.setNow(nowTimeSec); }
+    }
+
+   private:
+    std::array<KeyDirShard*, KeyDirShardQty> _shards;
+};
+
+}  // namespace detail
+
+// ==========================================================================================
+// Write batch
+// ==========================================================================================
+
+// This class collects put and remove operations so that they are committed together with Datastore::write().
+// Entries are validated, hashed and serialized in their on-disk format when they are added to the batch, so that
+// committing the batch is only a buffer copy, with one pass through each of the datastore internal locks.
+// The batch owns a copy of the keys, indexes and values, so caller buffers can be reused immediately.
+// Operations are applied in order: a put followed by a remove of the same key in a batch results in a removed entry.
+// Thread safety shall be enforced externally
+class WriteBatch
+{
+   public:
+    WriteBatch() = default;
+
+    // Same semantic and checks as Datastore::put(). The entry is stored only when the batch is written.
+    Status put(const void* key, size_t keySize, const void* value, size_t valueSize, const lcVector<KeyIndex>& keyIndexes = {},
+               uint32_t ttlSec = 0)
+    {
+        using namespace litecask::detail;
+
+        if (keySize == 0 || keySize >= USHRT_MAX) { return Status::BadKeySize; }
+        if (keyIndexes.size() > MaxKeyIndexQty) { return Status::InconsistentKeyIndex; }
+        KeyIndex lastIdx{0, 0};
+        for (const KeyIndex& ki : keyIndexes) {
+            if (ki.size == 0 || ki.startIdx + ki.size > keySize) { return Status::InconsistentKeyIndex; }
+            if (ki.startIdx < lastIdx.startIdx || (ki.startIdx == lastIdx.startIdx && ki.size <= lastIdx.size)) {
+                return Status::UnorderedKeyIndex;
+            }
+            lastIdx = ki;
+        }
+        if (valueSize >= detail::MaxValueSize) { return Status::BadValueSize; }
+
+        uint64_t keyHash      = LITECASK_HASH_FUNC(key, keySize);
+        uint32_t checksum     = (uint32_t)(keyHash ^ LITECASK_HASH_FUNC(value, valueSize));
+        size_t   keyIndexSize = keyIndexes.size() * sizeof(KeyIndex);
+
+        // The TTL is stored temporarily in the 'expTimeSec' field, and converted at commit time
+        DataFileEntry dfe{checksum, ttlSec, (uint32_t)valueSize, (uint16_t)keySize, (uint8_t)keyIndexSize, 0};
+        size_t        recordOffset = appendRecord(dfe, key, keySize, keyIndexes.data(), keyIndexSize);
+        if (valueSize > 0) { memcpy(&_data[recordOffset + sizeof(DataFileEntry) + keySize + keyIndexSize], value, valueSize); }
+        _ops.push_back({keyHash, recordOffset});
+        return Status::Ok;
+    }
+
+    // Variant 1: key as vector
+    Status put(const lcVector<uint8_t>& key, const void* value, size_t valueSize, const lcVector<KeyIndex>& keyIndexes = {},
+               uint32_t ttlSec = 0)
+    {
+        return put(key.data(), key.size(), value, valueSize, keyIndexes, ttlSec);
+    }
+
+    // Variant 2: key as string
+    Status put(const lcString& key, const void* value, size_t valueSize, const lcVector<KeyIndex>& keyIndexes = {}, uint32_t ttlSec = 0)
+    {
+        return put(key.data(), key.size(), value, valueSize, keyIndexes, ttlSec);
+    }
+
+    // Variant 3: key as vector and value as vector
+    Status put(const lcVector<uint8_t>& key, const lcVector<uint8_t>& value, const lcVector<KeyIndex>& keyIndexes = {}, uint32_t ttlSec = 0)
+    {
+        return put(key.data(), key.size(), value.data(), value.size(), keyIndexes, ttlSec);
+    }
+
+    // Variant 4: key as string and value as vector
+    Status put(const lcString& key, const lcVector<uint8_t>& value, const lcVector<KeyIndex>& keyIndexes = {}, uint32_t ttlSec = 0)
+    {
+        return put(key.data(), key.size(), value.data(), value.size(), keyIndexes, ttlSec);
+    }
+
+    // Same semantic and checks as Datastore::remove(). Removing a non-existing key is silently ignored at commit time.
+    Status remove(const void* key, size_t keySize)
+    {
+        using namespace litecask::detail;
+        if (keySize == 0 || keySize >= USHRT_MAX) { return Status::BadKeySize; }
+
+        uint64_t      keyHash = LITECASK_HASH_FUNC(key, keySize);
+        DataFileEntry dfe{(uint32_t)keyHash, 0, DeletedEntry, (uint16_t)keySize, 0, 0};
+        _ops.push_back({keyHash, appendRecord(dfe, key, keySize, &NoKeyIndex, 0)});
+        return Status::Ok;
+    }
+
+    // Variant 1: key as vector
+    Status remove(const lcVector<uint8_t>& key) { return remove(key.data(), key.size()); }
+
+    // Variant 2: key as string
+    Status remove(const lcString& key) { return remove(key.data(), key.size()); }
+
+    void reserve(size_t opQty, size_t dataBytes)
+    {
+        _ops.reserve(opQty);
+        _data.reserve(dataBytes);
+    }
+
+    void clear()
+    {
+        _ops.clear();
+        _data.clear();
+    }
+
+    size_t size() const { return _ops.size(); }
+
+    bool empty() const { return _ops.empty(); }
+
+    // Returns the byte size of the serialized entries, as they will be written in the data file
+    size_t getDataBytes() const { return _data.size(); }
+
+   private:
+    friend class Datastore;
+
+    struct Op {
+        uint64_t keyHash;
+        size_t   recordOffset;  // Location of the serialized DataFileEntry inside _data
+    };
+
+    size_t appendRecord(const detail::DataFileEntry& dfe, const void* key, size_t keySize, const KeyIndex* keyIndexes, size_t keyIndexSize)
+    {
+        using namespace litecask::detail;
+        size_t recordOffset = _data.size();
+        _data.resize(recordOffset + sizeof(DataFileEntry) + keySize + keyIndexSize +
+                     ((dfe.valueSize == DeletedEntry) ? 0 : (size_t)dfe.valueSize));
+        memcpy(&_data[recordOffset], &dfe, sizeof(DataFileEntry));
+        memcpy(&_data[recordOffset + sizeof(DataFileEntry)], key, keySize);
+        if (keyIndexSize > 0) { memcpy(&_data[recordOffset + sizeof(DataFileEntry) + keySize], (const uint8_t*)keyIndexes, keyIndexSize); }
+        return recordOffset;
+    }
+
+    // Records are packed, so the header is copied out to avoid unaligned accesses
+    detail::DataFileEntry getHeader(const Op& op) const
+    {
+        detail::DataFileEntry dfe;
+        memcpy(&dfe, &_data[op.recordOffset], sizeof(detail::DataFileEntry));
+        return dfe;
+    }
+
+    const uint8_t* getRecord(const Op& op) const { return &_data[op.recordOffset]; }
+
+    const uint8_t* getKey(const Op& op) const { return &_data[op.recordOffset + sizeof(detail::DataFileEntry)]; }
+
+    static size_t getRecordBytes(const detail::DataFileEntry& dfe)
+    {
+        return sizeof(detail::DataFileEntry) + dfe.keySize + dfe.keyIndexSize +
+               ((dfe.valueSize == detail::DeletedEntry) ? 0 : (size_t)dfe.valueSize);
+    }
+
+    lcVector<Op>      _ops;
+    lcVector<uint8_t> _data;
+};
+
+// ==========================================================================================
+// Datastore
+// ==========================================================================================
+
+class Datastore  // NOLINT(clang-analyzer-optin.performance.Padding)  Padding is not optimal due to the alignas directives
+{
+   public:
+    Datastore(size_t cacheBytes = 256 * 1024 * 1024)
+    {
+        _upkeepLastActiveFlushedTimeMs =
+            std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+        setLogHandler({});  // Install the default handler
+        setValueCodec({});  // Install the built-in codec
+
+        constexpr uint32_t initialMapSize       = 16 * 1024;
+        constexpr uint32_t initialKeyDirMapSize = detail::KeyDirShardQty * 4 * 1024;  // So that small stores do not resize the shards
+        _writeLanes.push_back(new detail::WriteLane());
+        _writeLanes.back()->writeBuffer.resize(_writeBufferBytes);
+        _writeLanes.back()->hintBuffer.reserve(detail::ActiveHintBufferBytes);
+        _keyDir = new detail::ShardedKeyDir(detail::KeyStorageAllocBytes, initialKeyDirMapSize,
+                                            [&](uint32_t newSize, bool isStart, bool wasForced) {
+                                                notifyKeyDirResizing(newSize, isStart, wasForced);
+                                            });
+        _valueCache = new detail::ValueCache((uint64_t)cacheBytes);
+        _indexMap   = new detail::IndexMap(detail::KeyStorageAllocBytes, initialMapSize);
+
+        updateNow();
+    }
+
+    ~Datastore()
+    {
+        if (_isInitialized) { close(); }
+        delete _keyDir;
+        delete _valueCache;
+        delete _indexMap;
+        for (detail::WriteLane* lane : _writeLanes) { delete lane; }
+    }
+
+    // Observability
+    // ==========================================================================================
+
+    void dumpFd(bool withIndex = false)
+    {
+        using namespace litecask::detail;
+        _mxDataFiles.lockRead();
+        for (uint32_t fileId = 0; fileId < _dataFiles.size(); ++fileId) {
+            DataFile* dfd = _dataFiles[fileId];
+            dfd->dump(withIndex ? fileId : -1, isActiveDataFileUnlocked((uint16_t)fileId));
+        }
+        _mxDataFiles.unlockRead();
+    }
+
+    DataFileStats getFileStats() const
+    {
+        using namespace litecask::detail;
+        DataFileStats stats;
+        _mxDataFiles.lockRead();
+
+        for (uint32_t fileId = 0; fileId < _dataFiles.size(); ++fileId) {
+            DataFile* dfd = _dataFiles[fileId];
+            if (!osIsValidHandle(dfd->handle)) continue;
+
+            stats.fileQty += 1;
+            stats.entries += dfd->entries;
+            stats.entryBytes += dfd->bytes;
+            stats.tombBytes += dfd->tombBytes;
+            stats.tombEntries += dfd->tombEntries;
+            stats.deadBytes += dfd->deadBytes;
+            stats.deadEntries += dfd->deadEntries;
+        }
+
+        _mxDataFiles.unlockRead();
         return stats;
     }
 
-    Config getConfig() const { return _config; }
+    Config getConfig() const { return _config; }
+
+    const DatastoreCounters& getCounters() const { return _stats; }
+
+    const ValueCacheCounters& getValueCacheCounters() const { return _valueCache->getCounters(); }
+
+    // Returns the latency statistics of a kind of operation, merged over all threads (see 'Config::latencyInstrumentation')
+    LatencyStats getLatencyStats(LatencyKind kind) const { return _latency.getStats(kind); }
+
+    void resetLatencyStats() { _latency.reset(); }
+
+    uint64_t getValueCacheAllocatedBytes() const { return _valueCache->getAllocatedBytes(); }
+
+    uint64_t getValueCacheMaxAllocatableBytes() const { return _valueCache->getMaxAllocatableBytes(); }
+
+    // Returns an estimate of the memory usage
+    uint64_t getEstimatedUsedMemoryBytes(bool withCache = false) const
+    {
+        uint64_t usedMem = 0;
+        _mxDataFiles.lockRead();
+        usedMem += sizeof(detail::DataFile) * _dataFiles.size();  // Data files storage (small)
+        _mxDataFiles.unlockRead();
+        usedMem += _keyDir->getEstimatedUsedMemoryBytes();    // KeyDirMap (big)
+        usedMem += _indexMap->getEstimatedUsedMemoryBytes();  // Index Map (may be big, depends on index usage)
+        for (const detail::WriteLane* lane : _writeLanes) {
+            usedMem += lane->writeBuffer.size() * sizeof(uint8_t);  // Write buffers (small)
+            usedMem += detail::ActiveHintBufferBytes;                // Hint buffers (small)
+        }
+        if (withCache) {
+            usedMem += _valueCache->getAllocatedBytes();  // Value cache storage (depends on config)
+            usedMem += _valueCache->getAdmissionFilterAllocatedBytes();
+        }
+        return usedMem;
+    }
+
+    bool setLogLevel(LogLevel level)
+    {
+        if (level >= LogLevel::Debug && level <= LogLevel::None) {
+            _logLevel = level;
+            return true;
+        }
+        return false;
+    }
+
+    void setLogHandler(const std::function<void(LogLevel, const char*, bool)>& logHandler)
+    {
+        if (logHandler) {
+            _logHandler = logHandler;
+        } else {
+            _logHandler = [&](LogLevel level, const char* message, bool closeDbNotification) {
+                defaultLogHandler(level, message, closeDbNotification);
+            };
+        }
+    }
+
+    static const char* toString(LatencyKind kind)
+    {
+        switch (kind) {
+            case LatencyKind::Put:
+                return "put";
+            case LatencyKind::Remove:
+                return "remove";
+            case LatencyKind::WriteBatch:
+                return "write batch";
+            case LatencyKind::Get:
+                return "get";
+            case LatencyKind::GetBatch:
+                return "multi-get";
+            case LatencyKind::Query:
+                return "query";
+            case LatencyKind::Scan:
+                return "scan";
+            case LatencyKind::ActiveFileLockWait:
+                return "active file lock wait";
+            case LatencyKind::DataFilesLockWait:
+                return "data files lock wait";
+            case LatencyKind::WriteBufferLockWait:
+                return "write buffer lock wait";
+            case LatencyKind::KeyDirShardLockWait:
+                return "KeyDir shard lock wait";
+            case LatencyKind::IndexMapLockWait:
+                return "index map lock wait";
+            case LatencyKind::GetDiskRead:
+                return "get disk read";
+            case LatencyKind::WriteBufferFlush:
+                return "write buffer flush";
+            case LatencyKind::OsSync:
+                return "OS sync";
+            case LatencyKind::MergePause:
+                return "merge pause";
+            default:
+                return "UNKNOWN";
+        }
+    }
+
+    static const char* toString(Status status)
+    {
+        switch (status) {
+            case Status::Ok:
+                return "Ok";
+            case Status::StoreNotOpen:
+                return "datastore is not open";
+            case Status::StoreAlreadyOpen:
+                return "datastore is already open";
+            case Status::BadDiskAccess:
+                return "bad disk access";
+            case Status::CannotOpenStore:
+                return "cannot access the datastore directory path";
+            case Status::StoreAlreadyInUse:
+                return "datastore already open and locked by another process";
+            case Status::BadKeySize:
+                return "key size is out of bounds";
+            case Status::InconsistentKeyIndex:
+                return "key indexes are inconsistent";
+            case Status::UnorderedKeyIndex:
+                return "key indexes are not ordered";
+            case Status::BadValueSize:
+                return "value size is out of bounds";
+            case Status::EntryNotFound:
+                return "entry has not be found";
+            case Status::EntryCorrupted:
+                return "entry is corrupted";
+            case Status::BadParameterValue:
+                return "bad parameter value";
+            case Status::InconsistentParameterValues:
+                return "inconsistent parameter values";
+            case Status::OutOfMemory:
+                return "operation failed due to out of memory";
+            case Status::BufferTooSmall:
+                return "provided buffer is too small";
+            default:
+                return "UNKNOWN";
+        }
+    }
+
+    // Configuration
+    // ==========================================================================================
+
+    // Defines the buffer size to write entries and batch the costly disk access.
+    // This optimization is effective as each disk write system call has a fixed base cost.
+    // Too big a size may create spikes of latency when flushing the buffer, too small a size reduces write throughput performance.
+    // In practice small values are enough to amortize the system calls
+    Status setWriteBufferBytes(uint32_t writeBufferBytes)
+    {
+        _mxDataFiles.lockRead();
+        for (detail::WriteLane* lane : _writeLanes) {
+            lane->mxWriteBuffer.lockWrite();
+            flushWriteBufferUnlocked(*lane);
+            lane->writeBuffer.resize(writeBufferBytes);
+            lane->mxWriteBuffer.unlockWrite();
+        }
+        _writeBufferBytes = writeBufferBytes;
+        _mxDataFiles.unlockRead();
+        return Status::Ok;
+    }
+
+    // Replaces the codec used by the value compression (see 'Config::valueCompression'). An empty codec restores the built-in one.
+    // It shall be called while the datastore is closed.
+    Status setValueCodec(const ValueCodec& codec)
+    {
+        if (_isInitialized) { return Status::StoreAlreadyOpen; }
+        if (codec.compress && codec.decompress) {
+            _valueCodec = codec;
+        } else {
+            _valueCodec = {detail::lzCompress, detail::lzDecompress};
+        }
+        return Status::Ok;
+    }
+
+    Status setConfig(const Config& config)
+    {
+        if (config.dataFileMaxBytes < detail::MinDataFileMaxBytes) {
+            log(LogLevel::Warn, "setConfig: too small 'dataFileMaxBytes' parameter value. Shall be above %d", detail::MinDataFileMaxBytes);
+            return Status::BadParameterValue;
+        }
+        if (config.mergeCyclePeriodMs == 0) {
+            log(LogLevel::Warn, "setConfig: 'mergeCyclePeriodMs' shall be a positive integer.");
+            return Status::BadParameterValue;
+        }
+        if (config.upkeepCyclePeriodMs == 0) {
+            log(LogLevel::Warn, "setConfig: 'upkeepCyclePeriodMs' shall be a positive integer.");
+            return Status::BadParameterValue;
+        }
+        if (config.upkeepKeyDirBatchSize == 0) {
+            log(LogLevel::Warn, "setConfig: 'upkeepKeyDirBatchSize' shall be a positive integer.");
+            return Status::BadParameterValue;
+        }
+        if (config.upkeepValueCacheBatchSize == 0) {
+            log(LogLevel::Warn, "setConfig: 'upkeepValueCacheBatchSize' shall be a positive integer.");
+            return Status::BadParameterValue;
+        }
+        if (config.valueCacheTargetMemoryLoadPercentage > 100) {
+            log(LogLevel::Warn, "setConfig: 'valueCacheTargetMemoryLoadPercentage' shall be in the range [0; 100]");
+            return Status::BadParameterValue;
+        }
+        if (config.writeLaneQty < 1 || config.writeLaneQty > detail::MaxWriteLaneQty) {
+            log(LogLevel::Warn, "setConfig: 'writeLaneQty' shall be in the range [1; %u]", detail::MaxWriteLaneQty);
+            return Status::BadParameterValue;
+        }
+        if (config.syncPolicy < SyncPolicy::None || config.syncPolicy > SyncPolicy::ByteThreshold) {
+            log(LogLevel::Warn, "setConfig: unknown 'syncPolicy' value.");
+            return Status::BadParameterValue;
+        }
+        if (config.memoryNumaPolicy < NumaPolicy::Default || config.memoryNumaPolicy > NumaPolicy::Interleave) {
+            log(LogLevel::Warn, "setConfig: unknown 'memoryNumaPolicy' value.");
+            return Status::BadParameterValue;
+        }
+        if (config.syncPeriodMs == 0) {
+            log(LogLevel::Warn, "setConfig: 'syncPeriodMs' shall be a positive integer.");
+            return Status::BadParameterValue;
+        }
+        if (config.syncBytes == 0) {
+            log(LogLevel::Warn, "setConfig: 'syncBytes' shall be a positive integer.");
+            return Status::BadParameterValue;
+        }
+        if (config.mergeTriggerDataFileFragmentationPercentage < 1 || config.mergeTriggerDataFileFragmentationPercentage > 100) {
+            log(LogLevel::Warn, "setConfig: 'mergeTriggerDataFileFragmentationPercentage' shall be in the range ]0; 100].");
+            return Status::BadParameterValue;
+        }
+        if (config.mergeTriggerDataFileDeadByteThreshold > config.dataFileMaxBytes) {
+            log(LogLevel::Warn,
+                "setConfig: too big 'mergeTriggerDataFileDeadByteThreshold' parameter value. Shall be below dataFileMaxBytes=%d",
+                config.dataFileMaxBytes);
+            return Status::InconsistentParameterValues;
+        }
+        if (config.mergeSelectDataFileFragmentationPercentage < 1 || config.mergeSelectDataFileFragmentationPercentage > 100) {
+            log(LogLevel::Warn, "setConfig: 'mergeSelectDataFileFragmentationPercentage' shall be in the range ]0; 100].");
+            return Status::BadParameterValue;
+        }
+        if (config.mergeSelectDataFileFragmentationPercentage > config.mergeTriggerDataFileFragmentationPercentage) {
+            log(LogLevel::Warn,
+                "setConfig: too big 'mergeSelectDataFileFragmentationPercentage' parameter value. Shall be below "
+                "mergeTriggerDataFileFragmentationPercentage=%d",
+                config.mergeTriggerDataFileFragmentationPercentage);
+            return Status::InconsistentParameterValues;
+        }
+        if (config.mergeSelectDataFileDeadByteThreshold > config.mergeTriggerDataFileDeadByteThreshold) {
+            log(LogLevel::Warn,
+                "setConfig: too big 'mergeSelectDataFileDeadByteThreshold' parameter value. Shall be below "
+                "mergeTriggerDataFileDeadByteThreshold=%d",
+                config.mergeTriggerDataFileDeadByteThreshold);
+            return Status::InconsistentParameterValues;
+        }
+        if (config.mergeSelectDataFileSmallSizeTheshold < detail::MinDataFileMaxBytes) {
+            log(LogLevel::Warn, "setConfig: too small 'mergeSelectDataFileSmallSizeTheshold' parameter value. Shall be above %d",
+                detail::MinDataFileMaxBytes);
+            return Status::BadParameterValue;
+        }
+        if (config.valueCompressionMinBytes < 8) {
+            log(LogLevel::Warn, "setConfig: 'valueCompressionMinBytes' shall be at least 8.");
+            return Status::BadParameterValue;
+        }
+        if (config.blobMinBytes != 0 && config.blobMinBytes < detail::BlobIoAlignment) {
+            log(LogLevel::Warn, "setConfig: 'blobMinBytes' shall be zero or at least %u.", (uint32_t)detail::BlobIoAlignment);
+            return Status::BadParameterValue;
+        }
+        if (config.mergeWorkerQty < 1 || config.mergeWorkerQty > detail::MaxMergeWorkerQty) {
+            log(LogLevel::Warn, "setConfig: 'mergeWorkerQty' shall be in the range [1; %u]", detail::MaxMergeWorkerQty);
+            return Status::BadParameterValue;
+        }
+
+        // Accepted config
+        _mxConfig.lock();
+        _config                   = config;
+        _dataFileMaxBytes         = (uint64_t)config.dataFileMaxBytes;  // Harmless data race (integrity is ensured)
+        _syncPolicy               = config.syncPolicy;                  // Harmless data race (integrity is ensured)
+        _syncBytes                = config.syncBytes;                   // Harmless data race (integrity is ensured)
+        _valueCompressionMinBytes = config.valueCompression ? config.valueCompressionMinBytes : UINT32_MAX;  // Harmless data race
+        _blobMinBytes             = (config.blobMinBytes != 0) ? config.blobMinBytes : UINT32_MAX;            // Harmless data race
+        _valueCache->setTargetMemoryLoad(0.01 * config.valueCacheTargetMemoryLoadPercentage);
+        _valueCache->setAdmissionFilter(config.valueCacheAdmissionFilter);
+        _latency.setEnabled(config.latencyInstrumentation);
+        _mxConfig.unlock();
+
+        // Wake up the sync thread so that the new policy is applied
+        {
+            std::unique_lock<std::mutex> lk(_syncMutex);
+            _syncCv.notify_one();
+        }
+        return Status::Ok;
+    }
+
+    // Open and close
+    // ==========================================================================================
+
+    Status open(fs::path dbDirectoryPath, bool doCreateIfNotExist = true)
+    {
+        using namespace litecask::detail;
+        if (_isInitialized) {
+            ++_stats.openCallFailedQty;
+            log(LogLevel::Error, "'open' failed: %s", toString(Status::StoreAlreadyOpen));
+            return Status::StoreAlreadyOpen;
+        }
+
+        // Input directory massaging
+        std::error_code ec;
+        dbDirectoryPath /= "";
+        if (!fs::exists(dbDirectoryPath) && doCreateIfNotExist) { fs::create_directories(dbDirectoryPath, ec); }
+        if (!fs::exists(dbDirectoryPath) || !fs::is_directory(dbDirectoryPath, ec)) {
+            ++_stats.openCallFailedQty;
+            log(LogLevel::Error, "'open' failed: %s", toString(Status::CannotOpenStore));
+            return Status::CannotOpenStore;
+        }
+
+        // Lock the database via a lock file
+        Status s = lockDatabase(dbDirectoryPath);
+        if (s != Status::Ok) {
+            ++_stats.openCallFailedQty;
+            log(LogLevel::Error, "'open' failed: unable to lock the datastore, %s.", toString(s));
+            return s;
+        }
+
+        lcVector<lcString> baseDataFilenames;
+        uint64_t           maxBlobId = 0;
+        s = sanitizeAndCollectDataFiles(dbDirectoryPath, _maxDataFileIndex, maxBlobId, baseDataFilenames);
+        if (s != Status::Ok) {
+            ++_stats.openCallFailedQty;
+            log(LogLevel::Error, "'open' failed: unable to clean the datastore, %s.", toString(s));
+            return s;
+        }
+
+        if (!doCreateIfNotExist && baseDataFilenames.empty()) {
+            ++_stats.openCallFailedQty;
+            log(LogLevel::Error, "'open' failed because there is no datastore at the provided path.");
+            unlockDatabase(dbDirectoryPath);
+            return Status::CannotOpenStore;
+        }
+
+        // Reset all fields
+        _directory  = dbDirectoryPath;
+        _nextBlobId = maxBlobId + 1;
+        _keyDir->reset();
+        _keyDir->setFingerprintMode(_config.keyDirFingerprintMode);
+        _indexMap->clear();
+        _valueCache->reset();
+        _valueCache->setSlabValueSize(_config.valueCacheSlabValueSize);
+        detail::MemoryPolicy memoryPolicy{_config.memoryHugePages, _config.memoryNumaPolicy};
+        bool                 isMemoryPolicyApplied = _keyDir->setMemoryPolicy(memoryPolicy);
+        isMemoryPolicyApplied                      = _indexMap->setMemoryPolicy(memoryPolicy) && isMemoryPolicyApplied;
+        isMemoryPolicyApplied                      = _valueCache->setMemoryPolicy(memoryPolicy) && isMemoryPolicyApplied;
+        if (!isMemoryPolicyApplied) { log(LogLevel::Warn, "The huge page or NUMA memory policy is not fully supported by the OS."); }
+        for (detail::DataFile* dfd : _dataFiles) delete dfd;
+        _dataFiles.clear();
+        _freeDataFileIds.clear();
+        resetWriteLanes(_config.writeLaneQty);
+        _mergeWork.store(false);
+        _mergeExit.store(false);
+        _upkeepWork.store(false);
+        _upkeepExit.store(false);
+        _syncWork.store(false);
+        _syncExit.store(false);
+        _warmUpExit.store(false);
+        _prefetchExit.store(false);
+        _prefetchKeys.clear();
+        _unsyncedBytes.store(0);
+        _someHintFilesAreMissing = false;
+        updateNow();
+
+        // The data files are parsed by worker threads (file reading and key hashing) and their results are applied in order to the
+        // KeyDir by this thread, so that the newest entries win exactly as with a sequential load.
+        // Parsed results are stored in a ring of slots, which bounds the memory used by the files parsed in advance
+        enum class LoadState { Pending, Loaded, Failed };
+        struct LoadSlot {
+            MappedFile               hintMapping;
+            ArenaAllocator           arena;
+            lcVector<LoadedKeyChunk> entries;
+            LoadState                state          = LoadState::Pending;
+            bool                     isFromDataFile = false;
+        };
+        lcVector<uint16_t> fileIds;
+        for (size_t i = 0; i < baseDataFilenames.size(); ++i) { fileIds.push_back(getFreeDataFileIdUnlocked()); }
+
+        // The KeyDir and the index map are sized once with the totals of the hint file headers.
+        // These are upper bounds, as some entries may be superseded, and data files without hint file are not accounted
+        uint64_t expectedEntryQty    = 0;
+        uint64_t expectedKeyIndexQty = 0;
+        for (const auto& baseDataFilename : baseDataFilenames) {
+            HintFileHeader hintHeader;
+            if (readHintFileHeader(baseDataFilename + HintFileSuffix, hintHeader)) {
+                expectedEntryQty += hintHeader.entryQty;
+                expectedKeyIndexQty += hintHeader.keyIndexQty;
+            }
+        }
+        _keyDir->reserve((uint32_t)std::min(expectedEntryQty, (uint64_t)0x7FFFFFFF));
+        _indexMap->reserve((uint32_t)std::min(expectedKeyIndexQty, (uint64_t)0x7FFFFFFF));
+        uint32_t workerQty =
+            std::max(1U, std::min({std::thread::hardware_concurrency(), MaxLoadWorkerQty, (uint32_t)baseDataFilenames.size()}));
+        uint32_t slotQty = 2 * workerQty;
+        lcVector<LoadSlot>      loadSlots(slotQty);
+        std::mutex              loadMutex;
+        std::condition_variable loadCv;
+        uint32_t                appliedFileQty = 0;
+        bool                    isLoadAborted  = false;
+        std::atomic<uint32_t>   nextFileIdx{0};
+
+        auto loadWorker = [&]() {
+            for (uint32_t fileIdx = nextFileIdx++; fileIdx < baseDataFilenames.size(); fileIdx = nextFileIdx++) {
+                LoadSlot& slot = loadSlots[fileIdx % slotQty];
+                {
+                    std::unique_lock<std::mutex> lk(loadMutex);
+                    loadCv.wait(lk, [&] { return isLoadAborted || fileIdx < appliedFileQty + slotQty; });
+                    if (isLoadAborted) { return; }
+                }
+
+                // Check for hint file
+                slot.arena.reset();
+                slot.isFromDataFile = false;
+                bool isOk = loadHintFile(baseDataFilenames[fileIdx] + HintFileSuffix, fileIds[fileIdx], slot.hintMapping, slot.entries);
+                if (!isOk) {
+                    // Hint file failed or does not exist, let's load directly the data file
+                    slot.isFromDataFile = true;
+                    isOk = loadDataFile(baseDataFilenames[fileIdx] + DataFileSuffix, fileIds[fileIdx], slot.arena, slot.entries);
+                }
+                {
+                    std::lock_guard<std::mutex> lk(loadMutex);
+                    slot.state = isOk ? LoadState::Loaded : LoadState::Failed;
+                }
+                loadCv.notify_all();
+            }
+        };
+        lcVector<std::thread> loadThreads;
+        for (uint32_t i = 0; i < workerQty; ++i) { loadThreads.emplace_back(loadWorker); }
+        auto stopLoadThreads = [&]() {
+            {
+                std::lock_guard<std::mutex> lk(loadMutex);
+                isLoadAborted = true;
+            }
+            loadCv.notify_all();
+            for (std::thread& t : loadThreads) { t.join(); }
+            for (LoadSlot& slot : loadSlots) { osUnmapFile(slot.hintMapping); }
+        };
+
+        // Loop on data files to apply, in order
+        for (uint32_t fileIdx = 0; fileIdx < baseDataFilenames.size(); ++fileIdx) {
+            const lcString& baseDataFilename = baseDataFilenames[fileIdx];
+            uint16_t        fileId           = fileIds[fileIdx];
+            LoadSlot&       slot             = loadSlots[fileIdx % slotQty];
+            {
+                std::unique_lock<std::mutex> lk(loadMutex);
+                loadCv.wait(lk, [&] { return slot.state != LoadState::Pending; });
+            }
+            if (slot.state == LoadState::Failed) {
+                stopLoadThreads();
+                ++_stats.openCallFailedQty;
+                log(LogLevel::Error, "'open' failed: unable to read the datastore.");
+                return Status::CannotOpenStore;
+            }
+            if (slot.isFromDataFile) { _someHintFilesAreMissing = true; }
+            const lcVector<LoadedKeyChunk>& keyDirEntries = slot.entries;
+
+            // Create the data file descriptor
+            DataFile* newFd = _dataFiles[fileId];
+            newFd->filename = baseDataFilename + DataFileSuffix;
+            newFd->handle   = osOsOpen(newFd->filename, OsOpenMode::READ);
+            assert(osIsValidHandle(newFd->handle));
+            KeyChunk    entryToErase;
+            OldKeyChunk oldEntry;
+
+            // Populate the key directory
+            for (uint32_t entryIdx = 0; entryIdx < keyDirEntries.size(); ++entryIdx) {
+                const LoadedKeyChunk& entry   = keyDirEntries[entryIdx];
+                uint16_t              keySize = entry.metadata.keySize;
+
+                if (entry.metadata.valueSize == DeletedEntry) {
+                    // Deletion case
+                    if (_keyDir->find(entry.keyHash, entry.key, entry.metadata.keySize, entryToErase)) {
+                        // As there is an entry in the KeyDir, a tombstone is required instead
+                        _dataFiles[entryToErase.fileId]->deadBytes +=
+                            sizeof(DataFileEntry) +
+                            ((entryToErase.valueSize == DeletedEntry) ? keySize : (keySize + entryToErase.valueSize));
+                        _dataFiles[entryToErase.fileId]->deadEntries += 1;
+                        _keyDir->insertEntry(entry.keyHash, entry.key, entry.keyIndexes, entry.metadata, oldEntry);
+                    } else {
+                        // No entry present in KeyDir, so no tombstone added there
+                        newFd->deadBytes += sizeof(DataFileEntry) + keySize;
+                        newFd->deadEntries += 1;
+                    }
+                    newFd->tombBytes += (uint32_t)sizeof(DataFileEntry) + keySize;
+                    newFd->tombEntries += 1;
+                    newFd->bytes += (uint32_t)sizeof(DataFileEntry) + keySize;
+                    newFd->entries += 1;
+                }
+
+                else if (entry.metadata.expTimeSec == 0 || entry.metadata.expTimeSec > _nowTimeSec) {
+                    // Value case
+                    if (_keyDir->insertEntry(entry.keyHash, entry.key, entry.keyIndexes, entry.metadata, oldEntry) == Status::Ok) {
+                        if (oldEntry.isValid) {
+                            // Replace an entry: update file descriptors
+                            _dataFiles[oldEntry.fileId]->deadBytes +=
+                                sizeof(DataFileEntry) + ((oldEntry.valueSize == DeletedEntry) ? keySize : (keySize + oldEntry.valueSize));
+                            _dataFiles[oldEntry.fileId]->deadEntries += 1;
+                        }
+                        if (entry.metadata.keyIndexSize > 0) {
+                            insertNewKeyIndexesUnlocked(entry.key, (const KeyIndex*)entry.keyIndexes,
+                                                        entry.metadata.keyIndexSize / sizeof(KeyIndex), entry.keyHash, oldEntry);
+                        }
+                    }
+                    newFd->bytes += (uint32_t)sizeof(DataFileEntry) + keySize + entry.metadata.valueSize;
+                    newFd->entries += 1;
+                }
+
+                else {
+                    // Expired TTL case
+                    newFd->deadBytes += (uint32_t)sizeof(DataFileEntry) + keySize + entry.metadata.valueSize;
+                    newFd->deadEntries += 1;
+                    newFd->bytes += (uint32_t)sizeof(DataFileEntry) + keySize + entry.metadata.valueSize;
+                    newFd->entries += 1;
+                }
+            }
+
+            // Release the slot for the next files to parse
+            osUnmapFile(slot.hintMapping);
+            {
+                std::lock_guard<std::mutex> lk(loadMutex);
+                slot.state = LoadState::Pending;
+                ++appliedFileQty;
+            }
+            loadCv.notify_all();
+        }
+        stopLoadThreads();
+
+        // The keys saved at the last closing are loaded now, and their values are read in background
+        lcVector<lcVector<uint8_t>> warmUpKeys;
+        loadCacheWarmUpFile(warmUpKeys);
+
+        // Finalize
+        for (WriteLane* lane : _writeLanes) { createNewActiveDataFileUnlocked(*lane); }
+        _mergeThread    = std::thread(&Datastore::mergeThreadEntry, this);
+        _upkeepThread   = std::thread(&Datastore::upkeepThreadEntry, this);
+        _syncThread     = std::thread(&Datastore::syncThreadEntry, this);
+        _prefetchThread = std::thread(&Datastore::prefetchThreadEntry, this);
+        if (!warmUpKeys.empty()) { _warmUpThread = std::thread(&Datastore::warmUpThreadEntry, this, std::move(warmUpKeys)); }
+        _getBatchReadPool.start(GetBatchMaxReadThreads - 1);  // The calling thread is the last reader
+#if LITECASK_IO_URING_ENABLED
+        if (!_asyncReader.start(AsyncReadQueueDepth)) { log(LogLevel::Warn, "io_uring is not available, asynchronous reads are synchronous"); }
+#endif
+        _isInitialized = true;
+        ++_stats.openCallQty;
+        log(LogLevel::Info, "Datastore successfully opened");
+        return Status::Ok;
+    }
+
+    Status close()
+    {
+        using namespace litecask::detail;
+
+        if (!_isInitialized) {
+            ++_stats.closeCallFailedQty;
+            log(LogLevel::Error, "'close' failed: %s", toString(Status::StoreNotOpen));
+            return Status::StoreNotOpen;
+        }
+        log(LogLevel::Info, "Closing datastore");
+
+        // Stop the maintenance threads
+        {
+            std::unique_lock<std::mutex> lk(_mergeMutex);
+            _mergeExit.store(true);
+            _mergeCv.notify_one();
+        }
+        {
+            std::unique_lock<std::mutex> lk(_upkeepMutex);
+            _upkeepExit.store(true);
+            _upkeepCv.notify_one();
+        }
+        {
+            std::unique_lock<std::mutex> lk(_syncMutex);
+            _syncExit.store(true);
+            _syncCv.notify_one();
+        }
+        {
+            std::unique_lock<std::mutex> lk(_prefetchMutex);
+            _prefetchExit.store(true);
+            _prefetchCv.notify_one();
+        }
+        _warmUpExit.store(true);
+        _mergeThread.join();
+        _upkeepThread.join();
+        _syncThread.join();
+        _prefetchThread.join();
+        if (_warmUpThread.joinable()) { _warmUpThread.join(); }
+        _mergeExit.store(false);
+        _getBatchReadPool.stop();  // Ongoing batches complete their reads on their calling thread
+#if LITECASK_IO_URING_ENABLED
+        _asyncReader.stop();  // All in-flight asynchronous reads are completed
+#endif
+        _upkeepExit.store(false);
+        _syncExit.store(false);
+
+        // Lock the database and make it uninitialized
+        for (WriteLane* lane : _writeLanes) { lane->mxActiveFile.lock(); }
+        _mxDataFiles.lockWrite();
+        _keyDir->lockAll();
+        _isInitialized = false;
+
+        // Clean the data files
+        for (WriteLane* lane : _writeLanes) {
+            lane->mxWriteBuffer.lockWrite();
+            flushWriteBufferUnlocked(*lane);
+            if (lane->activeDataFileId < _dataFiles.size()) {
+                closeActiveHintFileUnlocked(*lane, _dataFiles[lane->activeDataFileId]->filename);
+            }
+            if (_syncPolicy != SyncPolicy::None && lane->activeDataFileId < _dataFiles.size()) {
+                uint64_t syncStartNs = _latency.start();
+                if (!osOsSync(_dataFiles[lane->activeDataFileId]->handle)) {
+                    log(LogLevel::Error, "Unable to sync the active data file on disk");
+                }
+                _latency.record(LatencyKind::OsSync, syncStartNs);
+                ++_stats.osSyncQty;
+                updateSyncedWritePosition(*lane, getActiveWritePositionUnlocked(*lane));
+            }
+            lane->mxWriteBuffer.unlockWrite();
+        }
+        if (_syncPolicy != SyncPolicy::None) { syncDirectory(); }  // Finalized hint files
+        if (_config.valueCacheWarmUp && _valueCache->isEnabled()) { saveCacheWarmUpFile(); }
+        for (auto* dfd : _dataFiles) {
+            waitForUnpinnedUnlocked(dfd);
+            if (osIsValidHandle(dfd->handle)) {
+                osOsClose(dfd->handle);
+                dfd->handle = InvalidFileHandle;
+            }
+            delete dfd;
+        }
+        _dataFiles.clear();
+        _logHandler(LogLevel::Info, "closing", true);
+
+        // Resetting all fields
+        for (WriteLane* lane : _writeLanes) {
+            lane->activeDataOffset        = 0;
+            lane->activeDataFileId        = 0xFFFF;
+            lane->activeFlushedDataOffset = 0;
+        }
+
+        unlockDatabase(_directory);
+
+        // Reset the state
+        _directory.clear();
+
+        _keyDir->unlockAll();
+        _mxDataFiles.unlockWrite();
+        for (uint32_t laneIdx = (uint32_t)_writeLanes.size(); laneIdx > 0; --laneIdx) { _writeLanes[laneIdx - 1]->mxActiveFile.unlock(); }
+        ++_stats.closeCallQty;
+        return Status::Ok;
+    }
+
+    // Access API: put, remove, get
+    // ==========================================================================================
+
+    Status put(const void* key, size_t keySize, const void* value, size_t valueSize, const lcVector<KeyIndex>& keyIndexes = {},
+               uint32_t ttlSec = 0, bool forceDiskSync = false, CacheHint cacheHint = CacheHint::Default)
+    {
+        using namespace litecask::detail;
+        return privatePut(LITECASK_HASH_FUNC(key, keySize), key, keySize, value, valueSize, keyIndexes, ttlSec, forceDiskSync, cacheHint);
+    }
+
+    // Variant 1: key as vector
+    Status put(const lcVector<uint8_t>& key, const void* value, size_t valueSize, const lcVector<KeyIndex>& keyIndexes = {},
+               uint32_t ttlSec = 0, bool forceDiskSync = false, CacheHint cacheHint = CacheHint::Default)
+    {
+        return put(key.data(), key.size(), value, valueSize, keyIndexes, ttlSec, forceDiskSync, cacheHint);
+    }
+
+    // Variant 2: key as string
+    Status put(const lcString& key, const void* value, size_t valueSize, const lcVector<KeyIndex>& keyIndexes = {}, uint32_t ttlSec = 0,
+               bool forceDiskSync = false, CacheHint cacheHint = CacheHint::Default)
+    {
+        return put(key.data(), key.size(), value, valueSize, keyIndexes, ttlSec, forceDiskSync, cacheHint);
+    }
+
+    // Variant 3: key as vector and value as vector
+    Status put(const lcVector<uint8_t>& key, const lcVector<uint8_t>& value, const lcVector<KeyIndex>& keyIndexes = {}, uint32_t ttlSec = 0,
+               bool forceDiskSync = false, CacheHint cacheHint = CacheHint::Default)
+    {
+        return put(key.data(), key.size(), value.data(), value.size(), keyIndexes, ttlSec, forceDiskSync, cacheHint);
+    }
+
+    // Variant 4: key as string and value as vector
+    Status put(const lcString& key, const lcVector<uint8_t>& value, const lcVector<KeyIndex>& keyIndexes = {}, uint32_t ttlSec = 0,
+               bool forceDiskSync = false, CacheHint cacheHint = CacheHint::Default)
+    {
+        return put(key.data(), key.size(), value.data(), value.size(), keyIndexes, ttlSec, forceDiskSync, cacheHint);
+    }
+
+    Status remove(const void* key, size_t keySize, bool forceDiskSync = false)
+    {
+        using namespace litecask::detail;
+        return privateRemove(LITECASK_HASH_FUNC(key, keySize), key, keySize, forceDiskSync);
+    }
+
+    // Variant 1: key as vector
+    Status remove(const lcVector<uint8_t>& key, bool forceDiskSync = false) { return remove(key.data(), key.size(), forceDiskSync); }
+
+    // Variant 2: key as string
+    Status remove(const lcString& key, bool forceDiskSync = false) { return remove(key.data(), key.size(), forceDiskSync); }
+
+    // Commits all the operations of the batch in order, taking each internal lock only once for the whole batch.
+    // The entries are already serialized in the batch, so they are just copied in the write buffer.
+    // If 'forceDiskSync' is true, the write buffer is flushed once after the last entry of the batch.
+    Status write(const WriteBatch& inputBatch, bool forceDiskSync = false)
+    {
+        using namespace litecask::detail;
+        LatencyScope latencyScope(_latency, LatencyKind::WriteBatch);
+        WriteBatch   compressedBatch;
+        return privateWrite(getStoredBatch(inputBatch, compressedBatch), forceDiskSync, false);
+    }
+
+    Status get(const void* key, size_t keySize, lcVector<uint8_t>& value, CacheHint cacheHint = CacheHint::Default)
+    {
+        VectorValueSink sink{value};
+        using namespace litecask::detail;
+        return privateGet(LITECASK_HASH_FUNC(key, keySize), key, keySize, sink, cacheHint);
+    }
+
+    // Get variant 1: key as vector
+    Status get(const lcVector<uint8_t>& key, lcVector<uint8_t>& value, CacheHint cacheHint = CacheHint::Default)
+    {
+        return get(key.data(), key.size(), value, cacheHint);
+    }
+
+    // Get variant 2: key as string
+    Status get(const lcString& key, lcVector<uint8_t>& value, CacheHint cacheHint = CacheHint::Default)
+    {
+        return get(key.data(), key.size(), value, cacheHint);
+    }
+
+    // Get variant 3: the value is written in the provided buffer, without intermediate copy.
+    // The effective value size is always set in 'valueSize' when the entry is found. The call returns Status::BufferTooSmall
+    // if the buffer cannot hold the value, so that a bigger buffer can be provided.
+    Status get(const void* key, size_t keySize, void* buffer, size_t bufferSize, size_t& valueSize,
+               CacheHint cacheHint = CacheHint::Default)
+    {
+        BufferValueSink sink{(uint8_t*)buffer, bufferSize, valueSize};
+        using namespace litecask::detail;
+        return privateGet(LITECASK_HASH_FUNC(key, keySize), key, keySize, sink, cacheHint);
+    }
+
+    // Get variant 4: key as vector and value written in the provided buffer
+    Status get(const lcVector<uint8_t>& key, void* buffer, size_t bufferSize, size_t& valueSize, CacheHint cacheHint = CacheHint::Default)
+    {
+        return get(key.data(), key.size(), buffer, bufferSize, valueSize, cacheHint);
+    }
+
+    // Get variant 5: key as string and value written in the provided buffer
+    Status get(const lcString& key, void* buffer, size_t bufferSize, size_t& valueSize, CacheHint cacheHint = CacheHint::Default)
+    {
+        return get(key.data(), key.size(), buffer, bufferSize, valueSize, cacheHint);
+    }
+
+    // Get variant 6: zero-copy access. The visitor is called with a pointer on the value and its size, directly inside the write
+    // buffer or the value cache, or inside a per-thread buffer if the value is read from the disk.
+    // The visitor is called with some internal locks taken: it shall be short and shall not call the datastore API.
+    // The pointed data are valid only inside the visitor call.
+    Status get(const void* key, size_t keySize, const std::function<void(const uint8_t* value, size_t valueSize)>& valueVisitor,
+               CacheHint cacheHint = CacheHint::Default)
+    {
+        VisitorValueSink sink{valueVisitor};
+        using namespace litecask::detail;
+        return privateGet(LITECASK_HASH_FUNC(key, keySize), key, keySize, sink, cacheHint);
+    }
+
+    // Get variant 7: zero-copy access with key as vector
+    Status get(const lcVector<uint8_t>& key, const std::function<void(const uint8_t* value, size_t valueSize)>& valueVisitor,
+               CacheHint cacheHint = CacheHint::Default)
+    {
+        return get(key.data(), key.size(), valueVisitor, cacheHint);
+    }
+
+    // Get variant 8: zero-copy access with key as string
+    Status get(const lcString& key, const std::function<void(const uint8_t* value, size_t valueSize)>& valueVisitor,
+               CacheHint cacheHint = CacheHint::Default)
+    {
+        return get(key.data(), key.size(), valueVisitor, cacheHint);
+    }
+
+    // Asynchronous get. If the returned status is Ok, the callback is called exactly once with the status of the retrieval (same as
+    // 'get') and the value. Values in the write buffer or in the cache are provided from the calling thread before returning.
+    // With the io_uring backend (LITECASK_WITH_IO_URING), disk reads do not block the caller and the callback is called from the
+    // completion thread: it shall be short and shall not call the datastore API. Without this backend, the disk read is synchronous.
+    Status getAsync(const void* key, size_t keySize, const std::function<void(Status status, const lcVector<uint8_t>& value)>& callback)
+    {
+        AsyncValueSink sink{this, callback, {}};
+        using namespace litecask::detail;
+        Status         status = privateGet(LITECASK_HASH_FUNC(key, keySize), key, keySize, sink);
+        if (status == Status::BadKeySize || status == Status::StoreNotOpen) { return status; }
+        if (!sink.isDelegated) { callback(status, sink.value); }
+        return Status::Ok;
+    }
+
+    // Asynchronous get variant 1: key as vector
+    Status getAsync(const lcVector<uint8_t>& key, const std::function<void(Status status, const lcVector<uint8_t>& value)>& callback)
+    {
+        return getAsync(key.data(), key.size(), callback);
+    }
+
+    // Asynchronous get variant 2: key as string
+    Status getAsync(const lcString& key, const std::function<void(Status status, const lcVector<uint8_t>& value)>& callback)
+    {
+        return getAsync(key.data(), key.size(), callback);
+    }
+
+    // Multi-get: the keys are first all resolved, then the values not in the write buffer nor in the cache are read from disk, sorted by
+    // location so that close entries are loaded with a single read, and with concurrent reads if they are numerous.
+    // The returned status is the global one. Each key has its own status in 'statuses' (same as for 'get'), and its value in 'values'
+    Status getBatch(const lcVector<lcVector<uint8_t>>& keys, lcVector<lcVector<uint8_t>>& values, lcVector<Status>& statuses)
+    {
+        return privateGetBatch(keys, values, statuses);
+    }
+
+    // Multi-get variant 1: keys as strings
+    Status getBatch(const lcVector<lcString>& keys, lcVector<lcVector<uint8_t>>& values, lcVector<Status>& statuses)
+    {
+        return privateGetBatch(keys, values, statuses);
+    }
+
+    // Asynchronous prefetch: the values of the keys are read in background and inserted in the value cache, so that the next 'get'
+    // on these keys are served from the cache. The call does not wait for the reads. As for 'getBatch', the locations are sorted and
+    // the close entries are loaded with a single read. The keys beyond 'PrefetchMaxPendingKeyQty' pending ones are dropped.
+    Status prefetch(const lcVector<lcVector<uint8_t>>& keys) { return privatePrefetch(keys); }
+
+    // Prefetch variant 1: keys as strings
+    Status prefetch(const lcVector<lcString>& keys) { return privatePrefetch(keys); }
+
+    // Query variant 1: single key part as vector
+    Status query(const lcVector<uint8_t>& keyPart, lcVector<lcVector<uint8_t>>& matchingKeys)
+    {
+        return privateQuery<lcVector<uint8_t>, lcVector<uint8_t>>({keyPart}, matchingKeys);
+    }
+
+    // Query variant 2: single key part as string
+    Status query(const lcString& keyPart, lcVector<lcVector<uint8_t>>& matchingKeys)
+    {
+        return privateQuery<lcString, lcVector<uint8_t>>({keyPart}, matchingKeys);
+    }
+
+    // Query variant 3: multiple key part as vector of vector
+    Status query(const lcVector<lcVector<uint8_t>>& keyParts, lcVector<lcVector<uint8_t>>& matchingKeys)
+    {
+        return privateQuery<lcVector<uint8_t>, lcVector<uint8_t>>(keyParts, matchingKeys);
+    }
+
+    // Query variant 4: key part as vector of string
+    Status query(const lcVector<lcString>& keyParts, lcVector<lcVector<uint8_t>>& matchingKeys)
+    {
+        return privateQuery<lcString, lcVector<uint8_t>>(keyParts, matchingKeys);
+    }
+
+    // Query variant 5: single key part as vector, with arena allocator for output array of keys
+    Status query(const lcVector<uint8_t>& keyPart, lcVector<QueryResult>& arenaMatchingKeys, ArenaAllocator& allocator)
+    {
+        return privateQuery<lcVector<uint8_t>, QueryResult>({keyPart}, arenaMatchingKeys, &allocator);
+    }
+
+    // Query variant 6: single key part as string, with arena allocator for output array of keys
+    Status query(const lcString& keyPart, lcVector<QueryResult>& arenaMatchingKeys, ArenaAllocator& allocator)
+    {
+        return privateQuery<lcString, QueryResult>({keyPart}, arenaMatchingKeys, &allocator);
+    }
+
+    // Query variant 7: multiple key parts as vector, with arena allocator for output array of keys
+    Status query(const lcVector<lcVector<uint8_t>>& keyParts, lcVector<QueryResult>& arenaMatchingKeys, ArenaAllocator& allocator)
+    {
+        return privateQuery<lcVector<uint8_t>, QueryResult>(keyParts, arenaMatchingKeys, &allocator);
+    }
+
+    // Query variant 8: multiple key parts as string, with arena allocator for output array of keys
+    Status query(const lcVector<lcString>& keyParts, lcVector<QueryResult>& arenaMatchingKeys, ArenaAllocator& allocator)
+    {
+        return privateQuery<lcString, QueryResult>(keyParts, arenaMatchingKeys, &allocator);
+    }
+
+    // Streaming query: 'onMatch' is called for each key containing all the key parts, resuming from 'cursor' which is updated.
+    // It stops after 'maxMatchQty' matches or when 'onMatch' returns false. 'cursor.isEnd()' is then true if all matches were provided.
+    // The matches are processed by blocks, without holding any lock during the callback. If 'withValues' is true, the values of a
+    // block are read together (see getBatch) and the matches removed in-between are skipped. Else the provided value is empty.
+    Status forEachMatch(const lcVector<lcVector<uint8_t>>& keyParts, QueryCursor& cursor, uint32_t maxMatchQty,
+                        const std::function<bool(const lcVector<uint8_t>& key, const lcVector<uint8_t>& value)>& onMatch,
+                        bool withValues = false)
+    {
+        return privateForEachMatch(keyParts, cursor, maxMatchQty, onMatch, withValues);
+    }
+
+    // Streaming query variant 1: key parts as strings
+    Status forEachMatch(const lcVector<lcString>& keyParts, QueryCursor& cursor, uint32_t maxMatchQty,
+                        const std::function<bool(const lcVector<uint8_t>& key, const lcVector<uint8_t>& value)>& onMatch,
+                        bool withValues = false)
+    {
+        return privateForEachMatch(keyParts, cursor, maxMatchQty, onMatch, withValues);
+    }
+
+    // Full-keyspace scan: 'onEntry' is called for each valid entry, until it returns false.
+    // The key directory is copied by small batches under the lock of its shards, so writers are never blocked for long, and no lock
+    // is held during the callback. If 'withValues' is true, the values of a batch are read together, sorted by disk location.
+    // The scan can be split in 'rangeQty' disjoint ranges of key hashes processed in parallel, 'rangeIdx' being the one to scan.
+    // Each entry present during the whole scan is provided once. Entries written or removed during the scan may be provided or not.
+    Status scan(const std::function<bool(const ScanEntry& entry)>& onEntry, bool withValues = false, uint32_t rangeIdx = 0,
+                uint32_t rangeQty = 1)
+    {
+        return privateScan(onEntry, withValues, rangeIdx, rangeQty);
+    }
+
+    // Paginated query: at most 'maxKeyQty' matching keys are provided, resuming from 'cursor' which is updated (see forEachMatch)
+    Status query(const lcVector<lcVector<uint8_t>>& keyParts, QueryCursor& cursor, uint32_t maxKeyQty,
+                 lcVector<lcVector<uint8_t>>& matchingKeys)
+    {
+        matchingKeys.clear();
+        return privateForEachMatch(keyParts, cursor, maxKeyQty, getQueryPageCollector(matchingKeys), false);
+    }
+
+    // Paginated query variant 1: key parts as strings
+    Status query(const lcVector<lcString>& keyParts, QueryCursor& cursor, uint32_t maxKeyQty, lcVector<lcVector<uint8_t>>& matchingKeys)
+    {
+        matchingKeys.clear();
+        return privateForEachMatch(keyParts, cursor, maxKeyQty, getQueryPageCollector(matchingKeys), false);
+    }
+
+    void sync()
+    {
+        if (_syncPolicy != SyncPolicy::None) {
+            syncActiveDataFiles();
+            return;
+        }
+        _mxDataFiles.lockRead();
+        for (detail::WriteLane* lane : _writeLanes) {
+            lane->mxWriteBuffer.lockWrite();
+            if (lane->activeDataFileId < _dataFiles.size()) { flushWriteBufferUnlocked(*lane); }
+            lane->mxWriteBuffer.unlockWrite();
+        }
+        _mxDataFiles.unlockRead();
+    }
+
+    bool requestMerge()
+    {
+        std::unique_lock<std::mutex> lk(_mergeMutex);
+        if (_isInitialized && _mergeWork.load() == false) {
+            _mergeWork.store(true);
+            _mergeCv.notify_one();
+            return true;
+        }
+        return false;
+    }
+
+    bool isMergeOnGoing() const { return _mergeWork.load(); }
+
+    // Online checkpoint: the sealed data files, their hint files and the blob files are hard linked (or copied when not possible) in
+    // 'targetDirectory', which can then be opened as a datastore. The active data files are switched first, so the checkpoint
+    // contains all the entries written before the call. Writers are blocked only during the switch, and the file removals by the
+    // merge until the end of the linking. With hard links, the duration does not depend on the datastore size.
+    // If provided, 'changeLogCursor' is set to the change log position just after the checkpoint content, to follow it on a replica.
+    Status checkpoint(const fs::path& targetDirectory, ChangeLogCursor* changeLogCursor = nullptr)
+    {
+        ++_stats.checkpointCallQty;
+        Status status = privateCheckpoint(targetDirectory, changeLogCursor);
+        if (status != Status::Ok) { ++_stats.checkpointCallFailedQty; }
+        return status;
+    }
+
+    // Change log tailing: up to 'maxRecordQty' committed puts and removals are provided after the 'cursor' position, which is updated.
+    // The records are the data file entries written by the writers and flushed on disk (see 'sync'), in write order for a given key.
+    // The values in blob files are read and provided inline. The merged data files are not part of the change log: a reader shall
+    // not lag by more than 'changeLogRetainedDataFileQty' data files. Status::EntryNotFound means that its position was merged,
+    // and that the replica shall be rebuilt from a checkpoint.
+    Status readChangeLog(ChangeLogCursor& cursor, uint32_t maxRecordQty, lcVector<ChangeRecord>& records)
+    {
+        ++_stats.changeLogReadCallQty;
+        Status status = privateReadChangeLog(cursor, maxRecordQty, records);
+        if (status != Status::Ok) { ++_stats.changeLogReadFailedQty; }
+        _stats.changeLogRecordQty += records.size();
+        return status;
+    }
+
+    // Applies the change log records of another datastore, as a write batch. The key hashes, checksums and the stored (possibly
+    // compressed) values of the records are reused as is, without validation. The expiration times are kept absolute.
+    // The value codec shall be the same as the one of the source datastore.
+    Status applyReplicated(const lcVector<ChangeRecord>& records, bool forceDiskSync = false)
+    {
+        ++_stats.applyReplicatedCallQty;
+        Status status = privateApplyReplicated(records, forceDiskSync);
+        if (status != Status::Ok) { ++_stats.applyReplicatedFailedQty; }
+        return status;
+    }
+
+    // Offline maintenance
+    // ==========================================================================================
+
+    // Offline verification of a datastore which is not open: the structure and checksum of all the data file entries, the size and
+    // checksum of the referenced blob files, and the consistency of the hint files are checked. The crash leftovers are cleaned as
+    // at opening. The data files are read sequentially by 'workerQty' threads, and 'progress' is called from the calling thread.
+    // The quantity of problems is provided in 'report': the Status only reflects the ability to perform the verification.
+    Status verifyOffline(const fs::path& dbDirectory, uint32_t workerQty, OfflineReport& report, const OfflineProgress& progress = {})
+    {
+        using namespace litecask::detail;
+        report = {};
+        lcVector<lcString> baseDataFilenames;
+        Status             status = startOfflineOperation(dbDirectory, baseDataFilenames);
+        if (status != Status::Ok) { return status; }
+
+        lcVector<OfflineFile> files;
+        verifyDataFilesOffline(baseDataFilenames, workerQty, false, files, report, progress);
+        log(LogLevel::Info, "Offline verification of %" PRIu64 " data files: %s", report.dataFileQty,
+            report.isCorrupted() ? "corruption detected" : "no corruption");
+        stopOfflineOperation();
+        return Status::Ok;
+    }
+
+    // Offline compaction of a datastore which is not open: the live entries are verified, then rewritten ordered by key hash in new
+    // data files of 'dataFileMaxBytes' (see Config) with their hint files, by 'workerQty' threads. The overwritten, removed and
+    // expired entries are dropped, as well as the blob files which are no more referenced.
+    // Nothing is modified if a corruption is detected (Status::EntryCorrupted): the report then gives the details.
+    Status compactOffline(const fs::path& dbDirectory, uint32_t workerQty, OfflineReport& report, const OfflineProgress& progress = {})
+    {
+        report = {};
+        return privateCompactOffline(dbDirectory, workerQty, report, progress);
+    }
+
+    // Use carefully...
+    static void erasePermanentlyAllContent_UseWithCaution(fs::path dbDirectoryPath)
+    {
+        using namespace litecask::detail;
+        dbDirectoryPath /= "";
+        lcVector<DirEntry> entries;
+        if (!osGetDirContent(dbDirectoryPath, entries)) return;
+
+        for (const auto& e : entries) {
+            if (e.isDir || e.name.empty()) continue;
+            fs::path filename(e.name);
+
+            if (filename.extension() == DataFileSuffix) {
+                osRemoveFile(dbDirectoryPath / e.name);
+                continue;
+            }
+            if (filename.extension() == HintFileSuffix) {
+                osRemoveFile(dbDirectoryPath / e.name);
+                continue;
+            }
+            if (filename.extension() == TmpFileSuffix) {
+                osRemoveFile(dbDirectoryPath / e.name);
+                continue;
+            }
+            if (filename.extension() == ToRemoveFileSuffix) {
+                osRemoveFile(dbDirectoryPath / e.name);
+                continue;
+            }
+            if (filename.extension() == BlobFileSuffix) {
+                osRemoveFile(dbDirectoryPath / e.name);
+                continue;
+            }
+            if (filename.extension() == LogFileSuffix) {
+                osRemoveFile(dbDirectoryPath / e.name);
+                continue;
+            }
+        }
+    }
+
+#ifndef LITECASK_BUILD_FOR_TEST  // Allows looking inside the datastore internal, for testing purposes
+   private:
+#endif
+    // Internal data file management
+    // ==========================================================================================
+
+    // A key is always written in the same lane, so that its entries stay ordered in the data files of this lane.
+    // The upper bits of the hash are used, as the lower ones select the KeyDir shard and cell
+    uint32_t getWriteLaneIndex(uint64_t keyHash) const { return (uint32_t)(keyHash >> 32) % (uint32_t)_writeLanes.size(); }
+
+    detail::WriteLane& getWriteLane(uint64_t keyHash) const { return *_writeLanes[getWriteLaneIndex(keyHash)]; }
+
+    // Locks the "active file" of the lanes in the mask, always in increasing lane order
+    void lockWriteLanes(uint32_t laneMask)
+    {
+        for (uint32_t laneIdx = 0; laneIdx < _writeLanes.size(); ++laneIdx) {
+            if (laneMask & (1U << laneIdx)) { _writeLanes[laneIdx]->mxActiveFile.lock(); }
+        }
+    }
+
+    void unlockWriteLanes(uint32_t laneMask)
+    {
+        for (uint32_t laneIdx = (uint32_t)_writeLanes.size(); laneIdx > 0; --laneIdx) {
+            if (laneMask & (1U << (laneIdx - 1))) { _writeLanes[laneIdx - 1]->mxActiveFile.unlock(); }
+        }
+    }
+
+    // Reads the key of a KeyDir entry from the write buffer or the data file, and checks it against the KeyDir hash.
+    // It is required in fingerprint mode, as the keys are not stored in the KeyDir. The data file lock shall be taken by the caller
+    bool readEntryKeyUnlocked(uint32_t keyHash, const detail::KeyChunk& entry, lcVector<uint8_t>& key)
+    {
+        using namespace litecask::detail;
+        key.resize(entry.keySize);
+
+        // The lane of the key is not known from the KeyDir hash, so the lanes with this active file are checked
+        bool isInWriteBuffer = false;
+        for (WriteLane* lane : _writeLanes) {
+            if (entry.fileId != lane->activeDataFileId) { continue; }
+            lane->mxWriteBuffer.lockRead();
+            if (entry.fileId == lane->activeDataFileId && entry.fileOffset >= lane->activeFlushedDataOffset &&
+                entry.fileOffset - lane->activeFlushedDataOffset < lane->writeBuffer.size()) {
+                memcpy(key.data(), &lane->writeBuffer[entry.fileOffset - lane->activeFlushedDataOffset + sizeof(DataFileEntry)],
+                       entry.keySize);
+                isInWriteBuffer = true;
+            }
+            lane->mxWriteBuffer.unlockRead();
+        }
+
+        if (!isInWriteBuffer) {
+            if (entry.fileId >= _dataFiles.size()) { return false; }
+            lcOsFileHandle fh = _dataFiles[entry.fileId]->handle;
+            if (!osIsValidHandle(fh) || !osOsRead(fh, key.data(), entry.keySize, entry.fileOffset + (uint32_t)sizeof(DataFileEntry))) {
+                return false;
+            }
+            ++_stats.keyDiskReadQty;
+        }
+        // The hashes are compared as stored in the KeyDir, where the reserved zero value is shifted
+        uint32_t readKeyHash = (uint32_t)LITECASK_HASH_FUNC(key.data(), key.size());
+        return std::max(readKeyHash, (uint32_t)KeyDirMap::FirstValid) == std::max(keyHash, (uint32_t)KeyDirMap::FirstValid);
+    }
+
+    // Gets the key and the key indexes of a valid entry with the provided KeyDir hash
+    bool getEntryKeyAndIndexes(uint32_t keyHash, lcVector<uint8_t>& key, lcVector<KeyIndex>& keyIndexes)
+    {
+        if (!_keyDir->isFingerprintMode()) { return _keyDir->getKeyAndIndexes(keyHash, key, keyIndexes); }
+
+        detail::KeyChunk entry{0, 0, 0, 0, 0, 0, 0, 0, 0};
+        _mxDataFiles.lockRead();
+        bool isFound = _keyDir->getKeyAndIndexes(keyHash, key, keyIndexes, &entry) && readEntryKeyUnlocked(keyHash, entry, key);
+        _mxDataFiles.unlockRead();
+        return isFound;
+    }
+
+    // In fingerprint mode, two keys with the same fingerprint would share the same KeyDir entry. So the key stored in the data file
+    // is checked against the requested one, wherever it is available
+    bool isStoredKeyMismatch(const uint8_t* storedKey, const void* key, size_t keySize) const
+    {
+        return _keyDir->isFingerprintMode() && memcmp(storedKey, key, keySize) != 0;
+    }
+
+    // Sets the quantity of write lanes and resets their state. The datastore shall be closed
+    void resetWriteLanes(uint32_t laneQty)
+    {
+        while (_writeLanes.size() > laneQty) {
+            delete _writeLanes.back();
+            _writeLanes.pop_back();
+        }
+        while (_writeLanes.size() < laneQty) {
+            _writeLanes.push_back(new detail::WriteLane());
+            _writeLanes.back()->writeBuffer.resize(_writeBufferBytes);
+            _writeLanes.back()->hintBuffer.reserve(detail::ActiveHintBufferBytes);
+        }
+        for (detail::WriteLane* lane : _writeLanes) {
+            lane->activeDataOffset                  = 0;
+            lane->activeFlushedDataOffset           = 0;
+            lane->activeDataFileId                  = 0xFFFF;
+            lane->upkeepLastActiveFlushedDataOffset = detail::NotStored;
+            lane->upkeepLastActiveDataFileId        = 0xFFFF;
+        }
+    }
+
+    // The "data file" lock must be taken before the call
+    bool isActiveDataFileUnlocked(uint16_t fileId) const
+    {
+        for (const detail::WriteLane* lane : _writeLanes) {
+            if (lane->activeDataFileId == fileId) { return true; }
+        }
+        return false;
+    }
+
+    // The hint file is written with a temporary suffix, so that it is discarded at next opening if the datastore is not closed properly.
+    // In case of failure, the data file is simply left without hint file, which is regenerated after the next opening
+    void openActiveHintFileUnlocked(detail::WriteLane& lane, const lcString& dataFilename)
+    {
+        using namespace litecask::detail;
+        assert(lane.hintFh == nullptr);
+        fs::path hintFilename = fs::path(dataFilename).replace_extension(HintFileSuffix);
+        lane.hintFh           = osFopen(hintFilename.string() + TmpFileSuffix, "wb");
+        if (lane.hintFh) { setvbuf(lane.hintFh, nullptr, _IONBF, 0); }  // The hint buffer of the lane is the only buffering
+        if (!lane.hintFh || !writeHintFileHeader(lane.hintFh, 0, 0)) {
+            log(LogLevel::Warn, "Unable to create the hint file of the data file %s", dataFilename.c_str());
+            if (lane.hintFh) { fclose(lane.hintFh); }
+            lane.hintFh = nullptr;
+        }
+        lane.hintBuffer.clear();
+        lane.hintEntryQty    = 0;
+        lane.hintKeyIndexQty = 0;
+    }
+
+    // The "write buffer" write lock of the lane must be taken before the call
+    void appendActiveHintEntryUnlocked(detail::WriteLane& lane, uint32_t fileOffset, const detail::DataFileEntry& dfe, const void* key,
+                                       const void* keyIndexes)
+    {
+        using namespace litecask::detail;
+        if (!lane.hintFh) { return; }
+        HintFileEntry hfe{fileOffset, dfe.expTimeSec, dfe.valueSize, dfe.keySize, dfe.keyIndexSize, dfe.flags};
+        size_t        offset = lane.hintBuffer.size();
+        lane.hintBuffer.resize(offset + sizeof(HintFileEntry) + dfe.keySize + dfe.keyIndexSize);
+        memcpy(&lane.hintBuffer[offset], &hfe, sizeof(HintFileEntry));
+        memcpy(&lane.hintBuffer[offset + sizeof(HintFileEntry)], key, dfe.keySize);
+        if (dfe.keyIndexSize > 0) { memcpy(&lane.hintBuffer[offset + sizeof(HintFileEntry) + dfe.keySize], keyIndexes, dfe.keyIndexSize); }
+        lane.hintEntryQty += 1;
+        lane.hintKeyIndexQty += dfe.keyIndexSize / (uint32_t)sizeof(KeyIndex);
+        if (lane.hintBuffer.size() >= ActiveHintBufferBytes) { flushActiveHintBufferUnlocked(lane); }
+    }
+
+    void flushActiveHintBufferUnlocked(detail::WriteLane& lane)
+    {
+        if (lane.hintFh && !lane.hintBuffer.empty() &&
+            fwrite(lane.hintBuffer.data(), 1, lane.hintBuffer.size(), lane.hintFh) != lane.hintBuffer.size()) {
+            log(LogLevel::Warn, "Unable to write in the hint file of the active data file. It will be regenerated after the next opening");
+            fclose(lane.hintFh);
+            lane.hintFh = nullptr;
+        }
+        lane.hintBuffer.clear();
+    }
+
+    // The "active file" lock of the lane must be taken before the call, and the write buffer flushed. The hint state of the lane is
+    // modified only by the appends of entries, which require this lock, so the data file lock is not needed
+    void closeActiveHintFileUnlocked(detail::WriteLane& lane, const lcString& dataFilename)
+    {
+        using namespace litecask::detail;
+        flushActiveHintBufferUnlocked(lane);
+        if (!lane.hintFh) { return; }
+        bool isOk = writeHintFileHeader(lane.hintFh, lane.hintEntryQty, lane.hintKeyIndexQty) && syncHintFile(lane.hintFh);
+        fclose(lane.hintFh);
+        lane.hintFh           = nullptr;
+        fs::path hintFilename = fs::path(dataFilename).replace_extension(HintFileSuffix);
+        if (!isOk || !osRenameFile(hintFilename.string() + TmpFileSuffix, hintFilename)) {
+            log(LogLevel::Warn, "Unable to finalize the hint file %s. It will be regenerated after the next opening", hintFilename.c_str());
+        }
+    }
+
+    // With a sync policy, a hint file is synced before its renaming, else a power loss may leave a truncated hint file under its final
+    // name. Returns false on a sync failure
+    bool syncHintFile(FILE* fh)
+    {
+        using namespace litecask::detail;
+        if (_syncPolicy == SyncPolicy::None) { return true; }
+        uint64_t syncStartNs = _latency.start();
+        bool     isOk        = osFileSync(fh);
+        _latency.record(LatencyKind::OsSync, syncStartNs);
+        ++_stats.osSyncQty;
+        return isOk;
+    }
+
+    // With a sync policy, the directory entries of the created and renamed files are synced too. Otherwise a power loss may remove a
+    // whole file, including its synced content
+    void syncDirectory()
+    {
+        using namespace litecask::detail;
+        uint64_t syncStartNs = _latency.start();
+        if (!osSyncDirectory(_directory)) { log(LogLevel::Error, "Unable to sync the datastore directory %s on disk", _directory.c_str()); }
+        _latency.record(LatencyKind::OsSync, syncStartNs);
+        ++_stats.directorySyncQty;
+    }
+
+    // Returns the basename of the last created data file (the just closed active one, when there is a single write lane)
+    // The "active file" lock of the lane must be taken before the call
+    lcString createNewActiveDataFileUnlocked(detail::WriteLane& lane)
+    {
+        using namespace litecask::detail;
+
+        // Seal the previous active file: flush it, finalize its hint file and, with a sync policy, sync it on disk.
+        // The syncs are performed outside the data file lock, so that the readers are not blocked meanwhile, and the "active file" lock
+        // of the lane held by the caller ensures that nothing is appended in the meantime
+        _mxDataFiles.lockRead();
+        DataFile* sealedFd = (lane.activeDataFileId < _dataFiles.size()) ? _dataFiles[lane.activeDataFileId] : nullptr;
+        if (sealedFd) {
+            lane.mxWriteBuffer.lockWrite();
+            flushWriteBufferUnlocked(lane);
+            lane.mxWriteBuffer.unlockWrite();
+            pinDataFileUnlocked(sealedFd);
+        }
+        _mxDataFiles.unlockRead();
+        if (sealedFd) {
+            closeActiveHintFileUnlocked(lane, sealedFd->filename);
+            if (_syncPolicy != SyncPolicy::None) {
+                uint64_t syncStartNs = _latency.start();
+                if (!osOsSync(sealedFd->handle)) {
+                    log(LogLevel::Error, "Unable to sync the data file %s on disk", sealedFd->filename.c_str());
+                }
+                _latency.record(LatencyKind::OsSync, syncStartNs);
+                ++_stats.osSyncQty;
+            }
+            unpinDataFile(sealedFd);
+        }
+
+        // The data file structure is modified
+        _mxDataFiles.lockWrite();
+        lane.mxWriteBuffer.lockWrite();
+
+        // Set the name of the last created data file (used as an in-order basename for merged data files)
+        char tmpFilename[256];
+        snprintf(tmpFilename, 256, "%s%" PRId64 "", _directory.string().c_str(), _maxDataFileIndex);
+        lcString lastActiveBaseDataFilename = tmpFilename;
+
+        if (sealedFd) {
+            // Close previous active file, which was writable and is already flushed
+            DataFile* dfd = sealedFd;
+            assert(osIsValidHandle(dfd->handle) && lane.activeDataOffset == lane.activeFlushedDataOffset);
+            waitForUnpinnedUnlocked(dfd);
+            osOsClose(dfd->handle);
+
+            // Reopen it in read-only mode
+            dfd->handle = osOsOpen(dfd->filename, OsOpenMode::READ);
+            assert(osIsValidHandle(dfd->handle));
+        }
+
+        // Open a new data file in append + read mode
+        lane.activeDataOffset        = 0;
+        lane.activeFlushedDataOffset = 0;
+        lane.activeDataFileId        = getFreeDataFileIdUnlocked();
+        ++lane.activeDataFileSeq;  // All previous write positions are now flushed
+        updateFlushedWritePositionUnlocked(lane);
+        if (_syncPolicy != SyncPolicy::None) { updateSyncedWritePosition(lane, getActiveWritePositionUnlocked(lane)); }
+        lane.mxWriteBuffer.unlockWrite();
+
+        DataFile* newFd = _dataFiles[lane.activeDataFileId];
+        snprintf(tmpFilename, 256, "%s%" PRId64 "%s", _directory.string().c_str(), ++_maxDataFileIndex, DataFileSuffix);
+        newFd->filename = tmpFilename;
+        newFd->handle   = osOsOpen(newFd->filename, OsOpenMode::APPEND);
+        assert(osIsValidHandle(newFd->handle));
+        openActiveHintFileUnlocked(lane, newFd->filename);
+
+        _mxDataFiles.unlockWrite();
+
+        // The directory entries of the new data file and of the finalized hint file shall be durable before any synced write in it.
+        // The caller still holds the "active file" lock of the lane, so no write is acknowledged in the new data file before
+        if (_syncPolicy != SyncPolicy::None) { syncDirectory(); }
+
+        log(LogLevel::Debug, "Creating new active data file %s", tmpFilename);
+        ++_stats.activeDataFileSwitchQty;
+        return lastActiveBaseDataFilename;
+    }
+
+    bool isItWorthMerging(int fragmentationPercentage, uint32_t deadByteThreshold)
+    {
+        using namespace litecask::detail;
+        assert(fragmentationPercentage >= 1 && fragmentationPercentage <= 100);
+
+        _mxDataFiles.lockRead();
+        for (const DataFile* dfd : _dataFiles) {
+            if (!osIsValidHandle(dfd->handle)) continue;  // Descriptor not in use
+
+            if ((uint64_t)dfd->deadBytes * 100L > (uint64_t)dfd->bytes * (uint64_t)fragmentationPercentage) {
+                _mxDataFiles.unlockRead();
+                log(LogLevel::Debug, "Merge needed due to some data file having too high ratio of dead bytes");
+                return true;
+            }
+
+            if (dfd->deadBytes > deadByteThreshold) {
+                _mxDataFiles.unlockRead();
+                log(LogLevel::Debug, "Merge needed due to some data file having more than %d dead bytes", deadByteThreshold);
+                return true;
+            }
+        }
+        _mxDataFiles.unlockRead();
+        return false;
+    }
+
+    Status selectDataFilesToMerge(int fragmentationPercentage, uint32_t deadByteThreshold, uint32_t smallFileSizeTheshold,
+                                  uint32_t changeLogRetainedDataFileQty, lcVector<detail::MergeFileInfo>& mergeInfos)
+    {
+        using namespace litecask::detail;
+        assert(fragmentationPercentage >= 1 && fragmentationPercentage <= 100);
+        assert(smallFileSizeTheshold >= MinDataFileMaxBytes);
+        mergeInfos.clear();
+
+        // Check each data file
+        _mxDataFiles.lockRead();
+        for (uint32_t fileId = 0; fileId < _dataFiles.size(); ++fileId) {
+            const DataFile* dfd = _dataFiles[fileId];
+            if (!osIsValidHandle(dfd->handle)) continue;  // Descriptor not in use
+            uint64_t changeLogNumber = getChangeLogDataFileNumber(dfd->filename);
+            if (changeLogNumber > 0 && changeLogNumber + changeLogRetainedDataFileQty > _maxDataFileIndex) continue;  // Change log
+            bool doIncludeFileInMerge = false;
+
+            if ((uint64_t)dfd->deadBytes * 100L > (uint64_t)dfd->bytes * (uint64_t)fragmentationPercentage) doIncludeFileInMerge = true;
+            if (dfd->deadBytes > deadByteThreshold) doIncludeFileInMerge = true;
+            if (dfd->bytes < smallFileSizeTheshold) doIncludeFileInMerge = true;
+
+            if (doIncludeFileInMerge) { mergeInfos.push_back({(uint16_t)fileId, {}, {}, false}); }
+            log(LogLevel::Debug, "selectDataFilesToMerge: %s %s", dfd->filename.c_str(),
+                doIncludeFileInMerge ? "will be merged" : "is skipped");
+        }
+        _mxDataFiles.unlockRead();
+        return Status::Ok;
+    }
+
+    // 'Merging' is a data file "cleaning" process which:
+    //  - remove obsolete entries whose value has been overridden or deleted in newer data files
+    //  - compact the entries together in the new data files up to the allowed maximum size
+    // The selected data files are shared among the merge workers, each of them writing its own compacted data files
+    bool createMergedDataFiles(lcVector<detail::MergeFileInfo>& mergeInfos, const lcString& mergeBasename, const uint32_t dataFileMaxBytes,
+                               uint32_t workerQty)
+    {
+        using namespace litecask::detail;
+        std::atomic<uint32_t> nextMergeInfoIdx = 0;
+        std::atomic<uint32_t> mergeFileCount   = 0;
+
+        workerQty = std::max(std::min(workerQty, (uint32_t)mergeInfos.size()), 1U);
+        lcVector<std::thread> workers;
+        for (uint32_t workerIdx = 1; workerIdx < workerQty; ++workerIdx) {
+            workers.push_back(
+                std::thread([&]() { mergeWorker(mergeInfos, nextMergeInfoIdx, mergeFileCount, mergeBasename, dataFileMaxBytes); }));
+        }
+        mergeWorker(mergeInfos, nextMergeInfoIdx, mergeFileCount, mergeBasename, dataFileMaxBytes);
+        for (std::thread& t : workers) { t.join(); }
+
+        // No problem so far: create the tag files to remove old data files. The data files which could not be read are kept
+        // If a crash occurs before/while creating the "to_remove" tag files, next merge will clean the old-and-now-duplicate entries
+        _mxDataFiles.lockRead();
+        size_t mergedFileQty = 0;
+        for (MergeFileInfo& mergeInfo : mergeInfos) {
+            if (mergeInfo.isFailed) { continue; }
+            ++mergedFileQty;
+            const DataFile* dfd = _dataFiles[mergeInfo.fileId];
+            log(LogLevel::Debug, "Creating tag file to request removal of old data file %s.", dfd->filename.c_str());
+            FILE* tagFile = osFopen(fs::path(dfd->filename).replace_extension(ToRemoveFileSuffix), "wb");
+            fclose(tagFile);  // No content, just the file existence. Not really a problem if the tag file creation failed
+        }
+        _mxDataFiles.unlockRead();
+
+        // No problem so far.
+        // Next step is to apply patch on KeyDir, close the old data files, open the new ones, and remove the tagged data files
+        _stats.mergeGainedDataFileQty += mergedFileQty - mergeFileCount.load();
+        return true;
+    }
+
+    // Compacts the selected data files not yet taken by another worker
+    // The source data file is memory mapped and scanned sequentially. Consecutive live entries are copied as a single run, with
+    // the kernel copy offload when available, so that the values do not transit through the userland
+    void mergeWorker(lcVector<detail::MergeFileInfo>& mergeInfos, std::atomic<uint32_t>& nextMergeInfoIdx,
+                     std::atomic<uint32_t>& mergeFileCount, const lcString& mergeBasename, const uint32_t dataFileMaxBytes)
+    {
+        using namespace litecask::detail;
+        MergeOutput out;
 
-    const DatastoreCounters& getCounters() const { return _stats; }
+        // Loop on files to merge, the order does not matter
+        uint32_t mergeInfoIdx;
+        while ((mergeInfoIdx = nextMergeInfoIdx++) < mergeInfos.size()) {
+            MergeFileInfo& mergeInfo = mergeInfos[mergeInfoIdx];
 
-    const ValueCacheCounters& getValueCacheCounters() const { return _valueCache->getCounters(); }
+            // Get the data file descriptor
+            _mxDataFiles.lockRead();
+            const DataFile* dfd = _dataFiles[mergeInfo.fileId];
+            assert(osIsValidHandle(dfd->handle) && "This data file should have been in use");
+            _mxDataFiles.unlockRead();
 
-    uint64_t getValueCacheAllocatedBytes() const { return _valueCache->getAllocatedBytes(); }
+            // An empty data file (switched out active file without write) has no entry to copy and is simply removed
+            if (osGetFileSize(dfd->filename) == 0) { continue; }
 
-    uint64_t getValueCacheMaxAllocatableBytes() const { return _valueCache->getMaxAllocatableBytes(); }
+            // By design, we never merge the active file
+            // A data file which cannot be read is kept untouched, as the KeyDir still refers to its entries
+            MappedFile     mapping;
+            lcOsFileHandle srcHandle = osOsOpen(dfd->filename, OsOpenMode::READ);
+            if (!osIsValidHandle(srcHandle) || !osMapFile(dfd->filename, mapping)) {
+                if (osIsValidHandle(srcHandle)) { osOsClose(srcHandle); }
+                log(LogLevel::Error, "Cannot read the data file %s for merging, it is kept", dfd->filename.c_str());
+                mergeInfo.isFailed = true;
+                continue;
+            }
+            uint32_t readFileOffset = 0;
+            uint32_t runFileOffset  = 0;  // Run of live entries to copy, in the source data file
+            uint32_t runBytes       = 0;
+            uint32_t keptBytes      = 0;
 
-    // Returns an estimate of the memory usage
-    uint64_t getEstimatedUsedMemoryBytes(bool withCache = false) const
+            // Loop on entries
+            while (readFileOffset + sizeof(DataFileEntry) <= mapping.size) {
+                DataFileEntry header;
+                memcpy(&header, mapping.data + readFileOffset, sizeof(DataFileEntry));
+                uint32_t valueSize    = header.valueSize;
+                uint32_t keyIndexSize = header.keyIndexSize;
+                uint32_t keySize      = header.keySize;
+                if (keySize == 0) {
+                    log(LogLevel::Error,
+                        "Cannot read the data file %s for merging: a key has a null (=corrupted) size (value size is said to be %u) at "
+                        "file offset %u",
+                        dfd->filename.c_str(), valueSize, readFileOffset);
+                    break;
+                }
+
+                if (keyIndexSize > MaxKeyIndexQty * sizeof(KeyIndex)) {
+                    log(LogLevel::Error,
+                        "Cannot read the data file %s for merging: a key has too big index (byte size=%d > %" PRId64 ") at file offset %u",
+                        dfd->filename.c_str(), keyIndexSize, MaxKeyIndexQty * sizeof(KeyIndex), readFileOffset);
+                    break;
+                }
+
+                uint64_t allSize = (uint64_t)keySize + keyIndexSize + ((valueSize != DeletedEntry) ? valueSize : 0);
+                if (readFileOffset + sizeof(DataFileEntry) + allSize > mapping.size) {
+                    log(LogLevel::Warn,
+                        "Cannot read the data file %s for merging: unable to read all the bytes (%" PRIu64 ") of the entry at file "
+                        "offset %u",
+                        dfd->filename.c_str(), allSize, readFileOffset);
+                    break;
+                }
+                uint32_t fileIncrement = (uint32_t)(sizeof(DataFileEntry) + allSize);
+                if (valueSize == DeletedEntry) { keyIndexSize = 0; }  // Tombstone case
+
+                // An entry with an expired TTL is dropped directly, as it is ignored anyway at loading time
+                if (valueSize != DeletedEntry && header.expTimeSec != 0 && header.expTimeSec <= _nowTimeSec) {
+                    collectObsoleteBlob(mergeInfo, header, mapping.data + readFileOffset, nullptr);
+                    readFileOffset += fileIncrement;
+                    continue;
+                }
+
+                const uint8_t* keyAndIndexes = mapping.data + readFileOffset + sizeof(DataFileEntry);
+                uint64_t       keyHash       = LITECASK_HASH_FUNC(keyAndIndexes, keySize);
+                KeyChunk       entry;
+                bool           isFound = _keyDir->find((uint32_t)keyHash, keyAndIndexes, (uint16_t)keySize, entry);
+                if (!isFound || entry.fileId != mergeInfo.fileId || entry.fileOffset != readFileOffset) {
+                    collectObsoleteBlob(mergeInfo, header, mapping.data + readFileOffset, isFound ? &entry : nullptr);
+                    readFileOffset += fileIncrement;
+                    continue;  // This entry is not the latest or expired
+                }
+
+                // Change the write file if the size exceeds the threshold
+                if (out.dataFile == nullptr || (out.writeFileOffset > 0 && out.writeFileOffset + fileIncrement > dataFileMaxBytes)) {
+                    copyMergeRun(srcHandle, mapping, runFileOffset, runBytes, out);
+                    if (out.dataFile != nullptr) { finishMergedDataFile(out); }
+                    startMergedDataFile(out, mergeBasename, ++mergeFileCount);
+                }
+
+                // Append the entry to the current run of entries to copy, which is interrupted by obsolete entries
+                if (runBytes > 0 && runFileOffset + runBytes != readFileOffset) {
+                    copyMergeRun(srcHandle, mapping, runFileOffset, runBytes, out);
+                }
+                if (runBytes == 0) { runFileOffset = readFileOffset; }
+                runBytes += fileIncrement;
+
+                // Write the entry in the hint file
+                HintFileEntry hfe{out.writeFileOffset, header.expTimeSec, valueSize, (uint16_t)keySize, (uint8_t)keyIndexSize,
+                                  header.flags};
+                bool          isMergeOk = (fwrite(&hfe, sizeof(HintFileEntry), 1, out.hintFh) == 1);
+                isMergeOk = isMergeOk && (fwrite(keyAndIndexes, 1, keySize + keyIndexSize, out.hintFh) == keySize + keyIndexSize);
+                if (!isMergeOk) {
+                    fatalHandler("Write error for for file %s during merge file creation.", out.dataFile->filename.c_str());
+                }
+                out.hintEntryQty += 1;
+                out.hintKeyIndexQty += keyIndexSize / (uint32_t)sizeof(KeyIndex);
+
+                mergeInfo.patches.push_back({(uint32_t)keyHash, entry.fileOffset, out.writeFileOffset, mergeInfo.fileId, out.dataFileId});
+                out.dataFile->bytes += fileIncrement;
+                out.dataFile->entries += 1;
+                if (valueSize == DeletedEntry) {
+                    out.dataFile->tombBytes += fileIncrement;
+                    out.dataFile->tombEntries += 1;
+                }
+                out.writeFileOffset += fileIncrement;
+                keptBytes += fileIncrement;
+                readFileOffset += fileIncrement;
+            }  // End of loop on entries
+
+            copyMergeRun(srcHandle, mapping, runFileOffset, runBytes, out);
+            _stats.mergeGainedBytes += readFileOffset - keptBytes;
+            osUnmapFile(mapping);
+            osOsClose(srcHandle);
+        }  // End of loop on data files to merge
+
+        // Close the last merged data file
+        if (out.dataFile != nullptr) { finishMergedDataFile(out); }
+    }
+
+    // Records the blob file referenced by an entry dropped by the merge, for its removal after the merge.
+    // After a crash during a previous merge, the same entry may be present in two data files: the blob file is then kept if the latest
+    // entry of the key, provided in 'latestEntry', references it too (or if this cannot be checked)
+    void collectObsoleteBlob(detail::MergeFileInfo& mergeInfo, const detail::DataFileEntry& header, const uint8_t* entryData,
+                             const detail::KeyChunk* latestEntry)
     {
-        uint64_t usedMem = 0;
+        using namespace litecask::detail;
+        if ((header.flags & EntryFlagBlob) == 0 || header.valueSize != sizeof(BlobRef)) { return; }
+        BlobRef blobRef;
+        memcpy(&blobRef, entryData + sizeof(DataFileEntry) + header.keySize + header.keyIndexSize, sizeof(BlobRef));
+
+        if (latestEntry && latestEntry->valueSize != DeletedEntry && (latestEntry->flags & EntryFlagBlob)) {
+            // The entries of the active data files are new ones, with a new blob file
+            _mxDataFiles.lockRead();
+            BlobRef  latestBlobRef{0, 0, 0};
+            uint32_t latestRefOffset =
+                latestEntry->fileOffset + (uint32_t)sizeof(DataFileEntry) + latestEntry->keySize + latestEntry->keyIndexSize;
+            bool     isSameBlob      = false;
+            if (!isActiveDataFileUnlocked(latestEntry->fileId)) {
+                isSameBlob = !osOsRead(_dataFiles[latestEntry->fileId]->handle, &latestBlobRef, sizeof(BlobRef), latestRefOffset) ||
+                             latestBlobRef.blobId == blobRef.blobId;
+            }
+            _mxDataFiles.unlockRead();
+            if (isSameBlob) { return; }
+        }
+        mergeInfo.obsoleteBlobIds.push_back(blobRef.blobId);
+    }
+
+    // Removes the blob files referenced only by the entries dropped by the merge. The write buffers are flushed first (and synced
+    // depending on the sync policy), so that the newer entries which made these blob files obsolete are not lost in case of crash
+    void removeObsoleteBlobFiles(const lcVector<detail::MergeFileInfo>& mergeInfos)
+    {
+        using namespace litecask::detail;
+        bool hasObsoleteBlobs = false;
+        for (const MergeFileInfo& mergeInfo : mergeInfos) { hasObsoleteBlobs = hasObsoleteBlobs || !mergeInfo.obsoleteBlobIds.empty(); }
+        if (!hasObsoleteBlobs) { return; }
+
+        for (WriteLane* lane : _writeLanes) {
+            lane->mxWriteBuffer.lockRead();
+            uint64_t writePosition = getActiveWritePositionUnlocked(*lane);
+            lane->mxWriteBuffer.unlockRead();
+            waitForFlushedWritePosition(*lane, writePosition, _syncPolicy != SyncPolicy::None);
+        }
+
+        std::lock_guard<std::mutex> removalLock(_mxFileRemoval);  // The checkpointed data files may still reference them
         _mxDataFiles.lockRead();
-        usedMem += sizeof(detail::DataFile) * _dataFiles.size();  // Data files storage (small)
+        for (const MergeFileInfo& mergeInfo : mergeInfos) {
+            for (uint64_t blobId : mergeInfo.obsoleteBlobIds) {
+                if (osRemoveFile(getBlobFilenameUnlocked(blobId))) { ++_stats.blobRemovedQty; }
+            }
+        }
         _mxDataFiles.unlockRead();
-        usedMem += _keyDir->getEstimatedUsedMemoryBytes();    // KeyDirMap (big)
-        usedMem += _indexMap->getEstimatedUsedMemoryBytes();  // Index Map (may be big, depends on index usage)
-        usedMem += _writeBuffer.size() * sizeof(uint8_t);     // Write buffers (small)
-        if (withCache) {
-            usedMem += _valueCache->getAllocatedBytes();  // Value cache storage (depends on config)
+    }
+
+    // Copies a run of consecutive entries from the source data file to the merged data file, by chunks so that the throttling and
+    // the copy both work at a reasonable granularity
+    void copyMergeRun(lcOsFileHandle srcHandle, const MappedFile& mapping, uint32_t runFileOffset, uint32_t& runBytes,
+                      detail::MergeOutput& out)
+    {
+        using namespace litecask::detail;
+        while (runBytes > 0) {
+            uint32_t chunkBytes = std::min(runBytes, MergeCopyChunkBytes);
+            if (!_mergeExit.load() &&
+                _mergeThrottle.consume(chunkBytes, _stats.getCallDiskReadQty + _stats.getBatchDiskReadQty + _stats.getAsyncDiskReadQty)) {
+                ++_stats.mergeThrottledQty;
+            }
+
+            // The copy offload may be partial or unsupported (different file systems...). The remaining part is written from the mapping
+            size_t copiedBytes = osCopyFileRange(srcHandle, runFileOffset, out.dataHandle, chunkBytes);
+            _stats.mergeOffloadedBytes += copiedBytes;
+            if (copiedBytes < chunkBytes &&
+                !osOsWrite(out.dataHandle, mapping.data + runFileOffset + copiedBytes, chunkBytes - copiedBytes)) {
+                fatalHandler("Write error for for file %s during merge file creation.", out.dataFile->filename.c_str());
+            }
+            runFileOffset += chunkBytes;
+            runBytes -= chunkBytes;
         }
-        return usedMem;
     }
 
-    bool setLogLevel(LogLevel level)
+    void startMergedDataFile(detail::MergeOutput& out, const lcString& mergeBasename, uint32_t mergeFileNumber)
     {
-        if (level >= LogLevel::Debug && level <= LogLevel::None) {
-            _logLevel = level;
-            return true;
+        using namespace litecask::detail;
+
+        // Create the next compacted file to write in
+        char dataFilename[512];  // Note: the fractional number shall not be zero
+        snprintf(dataFilename, sizeof(dataFilename), "%s.%05u%s", mergeBasename.c_str(), mergeFileNumber, DataFileSuffix);
+
+        // The data file structure is modified
+        _mxDataFiles.lockWrite();
+        out.dataFileId = getFreeDataFileIdUnlocked();
+        out.dataFile   = _dataFiles[out.dataFileId];
+        _mxDataFiles.unlockWrite();
+
+        out.dataFile->filename = dataFilename;
+        out.dataFile->handle   = InvalidFileHandle;  // Will be opened for read only when the temporary file is complete and renamed
+        out.dataHandle         = osOsOpen(lcString(dataFilename) + TmpFileSuffix, OsOpenMode::WRITE);
+        if (!osIsValidHandle(out.dataHandle)) {
+            fatalHandler("Unable to open temp data file for %s during merge file creation.", out.dataFile->filename.c_str());
         }
-        return false;
+        out.writeFileOffset   = 0;
+        fs::path hintFilename = fs::path(out.dataFile->filename).replace_extension(HintFileSuffix);
+        out.hintFh            = osFopen(hintFilename.string() + TmpFileSuffix, "wb");
+        if (out.hintFh) { setvbuf(out.hintFh, nullptr, _IOFBF, MergeHintBufferBytes); }
+        if (!out.hintFh || !writeHintFileHeader(out.hintFh, 0, 0)) {
+            fatalHandler("Unable to open temp hint file for %s during merge file creation.", out.dataFile->filename.c_str());
+        }
+        out.hintEntryQty    = 0;
+        out.hintKeyIndexQty = 0;
     }
 
-    void setLogHandler(const std::function<void(LogLevel, const char*, bool)>& logHandler)
+    void finishMergedDataFile(detail::MergeOutput& out)
     {
-        if (logHandler) {
-            _logHandler = logHandler;
-        } else {
-            _logHandler = [&](LogLevel level, const char* message, bool closeDbNotification) {
-                defaultLogHandler(level, message, closeDbNotification);
-            };
+        using namespace litecask::detail;
+
+        // Close finished data and hint written files
+        if (!writeHintFileHeader(out.hintFh, out.hintEntryQty, out.hintKeyIndexQty) || !syncHintFile(out.hintFh)) {
+            fatalHandler("Write error for hint file of %s during merge file creation.", out.dataFile->filename.c_str());
+        }
+        // With a sync policy, the merged entries shall be on the disk before the old data files are removed
+        if (_syncPolicy != SyncPolicy::None) {
+            uint64_t syncStartNs = _latency.start();
+            if (!osOsSync(out.dataHandle)) {
+                log(LogLevel::Error, "Unable to sync the merged data file %s on disk", out.dataFile->filename.c_str());
+            }
+            _latency.record(LatencyKind::OsSync, syncStartNs);
+            ++_stats.osSyncQty;
+        }
+        osOsClose(out.dataHandle);
+        fclose(out.hintFh);
+
+        // If a crash occurs before the move then the .tmp is simply removed at next launch. If a crash
+        // occurs after this (atomic) renaming, then the data will be taken into account and the old
+        // duplicate entries will be cleaned by next merge
+        log(LogLevel::Debug, "Finished compacted file %s. Removing the '%s' suffix.", out.dataFile->filename.c_str(), TmpFileSuffix);
+        if (!osRenameFile(out.dataFile->filename + TmpFileSuffix, out.dataFile->filename)) {
+            fatalHandler("Unable to rename temp data file for %s during merge file creation.", out.dataFile->filename.c_str());
+        }
+        out.dataFile->handle = osOsOpen(out.dataFile->filename, OsOpenMode::READ);
+        assert(osIsValidHandle(out.dataFile->handle));
+        fs::path hintFilename = fs::path(out.dataFile->filename).replace_extension(HintFileSuffix);
+        if (!osRenameFile(hintFilename.string() + TmpFileSuffix, hintFilename)) {
+            fatalHandler("Unable to rename temp hint file for %s during merge file creation.", out.dataFile->filename.c_str());
         }
+        if (_syncPolicy != SyncPolicy::None) { syncDirectory(); }
+        out = MergeOutput();
     }
 
-    static const char* toString(Status status)
+    bool replaceDataFiles(const lcVector<detail::MergeFileInfo>& mergeInfos)
     {
-        switch (status) {
-            case Status::Ok:
-                return "Ok";
-            case Status::StoreNotOpen:
-                return "datastore is not open";
-            case Status::StoreAlreadyOpen:
-                return "datastore is already open";
-            case Status::BadDiskAccess:
-                return "bad disk access";
-            case Status::CannotOpenStore:
-                return "cannot access the datastore directory path";
-            case Status::StoreAlreadyInUse:
-                return "datastore already open and locked by another process";
-            case Status::BadKeySize:
-                return "key size is out of bounds";
-            case Status::InconsistentKeyIndex:
-                return "key indexes are inconsistent";
-            case Status::UnorderedKeyIndex:
-                return "key indexes are not ordered";
-            case Status::BadValueSize:
-                return "value size is out of bounds";
-            case Status::EntryNotFound:
-                return "entry has not be found";
-            case Status::EntryCorrupted:
-                return "entry is corrupted";
-            case Status::BadParameterValue:
-                return "bad parameter value";
-            case Status::InconsistentParameterValues:
-                return "inconsistent parameter values";
-            case Status::OutOfMemory:
-                return "operation failed due to out of memory";
-            default:
-                return "UNKNOWN";
+        using namespace litecask::detail;
+        std::lock_guard<std::mutex> removalLock(_mxFileRemoval);  // The old data files shall not vanish during a checkpoint
+
+        // Next step is to apply patch on KeyDir, close the old data files, open the new ones, and remove the tagged data files
+        for (const MergeFileInfo& mergeInfo : mergeInfos) {
+            if (mergeInfo.isFailed) { continue; }  // Not read, so not tagged and without patch
+
+            // The data file structure is modified
+            uint64_t pauseStartNs = _latency.start();
+            _mxDataFiles.lockWrite();
+            DataFile* dfd = _dataFiles[mergeInfo.fileId];
+
+            // Live-patch of the KeyDir, one shard at a time
+            for (uint32_t shardIdx = 0; shardIdx < detail::KeyDirShardQty; ++shardIdx) {
+                detail::KeyDirShard& shard = _keyDir->getShard(shardIdx);
+                shard.mx.lock();
+                for (const KeyDirPatch& kdPatch : mergeInfo.patches) {
+                    if (detail::ShardedKeyDir::getShardIndex(kdPatch.keyHash) != shardIdx) { continue; }
+                    shard.map.updateMergedValueLocation(kdPatch.keyHash, kdPatch.oldFileId, kdPatch.oldFileOffset, kdPatch.newFileId,
+                                                        kdPatch.fileOffset);
+                }
+                shard.mx.unlock();
+            }
+
+            if (osIsValidHandle(dfd->handle)) {
+                waitForUnpinnedUnlocked(dfd);
+                osOsClose(dfd->handle);
+                dfd->handle = InvalidFileHandle;
+
+                // Remove the files associated with this old data file. The order below matters in case of hard interruption.
+                // First remove the old data file
+                osRemoveFile(dfd->filename);
+                // Then the hint file (if it exists)
+                osRemoveFile(fs::path(dfd->filename).replace_extension(HintFileSuffix));
+                // Then, the removal tag
+                osRemoveFile(fs::path(dfd->filename).replace_extension(ToRemoveFileSuffix));
+
+                // Free the fileId for reuse
+                _freeDataFileIds.push_back(mergeInfo.fileId);
+            }
+
+            _mxDataFiles.unlockWrite();
+            _latency.record(LatencyKind::MergePause, pauseStartNs);
+        }
+
+        return true;
+    }
+
+    Status privateCheckpoint(const fs::path& targetDirectory, ChangeLogCursor* changeLogCursor)
+    {
+        using namespace litecask::detail;
+
+        _mxDataFiles.lockRead();
+        bool isInitialized = _isInitialized;
+        _mxDataFiles.unlockRead();
+        if (!isInitialized) { return Status::StoreNotOpen; }
+
+        // The target directory is created if needed, and shall not already contain a datastore
+        fs::path        targetPath = targetDirectory;
+        std::error_code ec;
+        targetPath /= "";
+        if (!fs::exists(targetPath)) { fs::create_directories(targetPath, ec); }
+        lcVector<DirEntry> entries;
+        if (ec || !osGetDirContent(targetPath, entries)) {
+            log(LogLevel::Error, "Checkpoint: unable to access the target directory %s", targetPath.string().c_str());
+            return Status::BadDiskAccess;
+        }
+        if (fs::equivalent(targetPath, _directory, ec)) { return Status::BadParameterValue; }
+        for (const DirEntry& e : entries) {
+            fs::path extension = fs::path(e.name).extension();
+            if (!e.isDir && (extension == DataFileSuffix || extension == BlobFileSuffix)) {
+                log(LogLevel::Error, "Checkpoint: the target directory %s already contains a datastore", targetPath.string().c_str());
+                return Status::BadParameterValue;
+            }
+        }
+
+        // The merge shall not remove files until the end of the linking, as the checkpoint may still reference them
+        std::lock_guard<std::mutex> removalLock(_mxFileRemoval);
+
+        // Switch all the active data files, then list the store files while no new data file can be created
+        uint32_t allLaneMask = (1U << _writeLanes.size()) - 1;
+        lockWriteLanes(allLaneMask);
+        for (WriteLane* lane : _writeLanes) { createNewActiveDataFileUnlocked(*lane); }
+        _mxDataFiles.lockRead();
+        lcVector<lcString> activeDataFilenames;
+        uint64_t           firstActiveDataFileNumber = UINT64_MAX;
+        for (WriteLane* lane : _writeLanes) {
+            const lcString& filename = _dataFiles[lane->activeDataFileId]->filename;
+            activeDataFilenames.push_back(fs::path(filename).filename().string());
+            firstActiveDataFileNumber = std::min(firstActiveDataFileNumber, getChangeLogDataFileNumber(filename));
+        }
+        bool isListed = osGetDirContent(_directory, entries);
+        _mxDataFiles.unlockRead();
+        unlockWriteLanes(allLaneMask);
+        if (!isListed) { return Status::BadDiskAccess; }
+
+        // Link the sealed files. The temporary files (unfinished merge or blob, active hint files) and the removal tags are skipped:
+        // the checkpoint is then equivalent to a store interrupted before the end of the on-going merge
+        uint32_t fileQty = 0;
+        for (const DirEntry& e : entries) {
+            if (e.isDir) { continue; }
+            fs::path extension = fs::path(e.name).extension();
+            if (extension != DataFileSuffix && extension != HintFileSuffix && extension != BlobFileSuffix) { continue; }
+            if (std::find(activeDataFilenames.begin(), activeDataFilenames.end(), e.name) != activeDataFilenames.end()) { continue; }
+
+            bool wasCopied = false;
+            if (!osLinkOrCopyFile(_directory / e.name, targetPath / e.name, wasCopied)) {
+                log(LogLevel::Error, "Checkpoint: unable to link or copy the file %s in %s", e.name.c_str(), targetPath.string().c_str());
+                return Status::BadDiskAccess;
+            }
+            ++(wasCopied ? _stats.checkpointCopiedFileQty : _stats.checkpointLinkedFileQty);
+            ++fileQty;
+        }
+
+        if (changeLogCursor) { *changeLogCursor = ChangeLogCursor{firstActiveDataFileNumber, {}}; }
+        log(LogLevel::Info, "Checkpoint of %u files created in %s", fileQty, targetPath.string().c_str());
+        return Status::Ok;
+    }
+
+    // Returns the number of a data file written by the writers, or 0 for a merged data file (which has a fractional number)
+    static uint64_t getChangeLogDataFileNumber(const lcString& dataFilename)
+    {
+        lcString stem   = fs::path(dataFilename).stem().string();
+        char*    endPtr = nullptr;
+        uint64_t number = strtoull(stem.c_str(), &endPtr, 10);
+        return (endPtr && *endPtr == 0) ? number : 0;
+    }
+
+    Status privateReadChangeLog(ChangeLogCursor& cursor, uint32_t maxRecordQty, lcVector<ChangeRecord>& records)
+    {
+        using namespace litecask::detail;
+        records.clear();
+
+        _mxDataFiles.lockRead();
+        if (!_isInitialized) {
+            _mxDataFiles.unlockRead();
+            return Status::StoreNotOpen;
+        }
+
+        // Collect the data files of the change log, in write order. They are read without the data file lock
+        struct LogFile {
+            uint64_t number;
+            uint16_t fileId;
+            lcString filename;
+        };
+        lcVector<LogFile> logFiles;
+        for (uint32_t fileId = 0; fileId < _dataFiles.size(); ++fileId) {
+            const DataFile* dfd = _dataFiles[fileId];
+            if (!osIsValidHandle(dfd->handle)) { continue; }
+            uint64_t number = getChangeLogDataFileNumber(dfd->filename);
+            if (number > 0) { logFiles.push_back({number, (uint16_t)fileId, dfd->filename}); }
+        }
+        _mxDataFiles.unlockRead();
+        std::sort(logFiles.begin(), logFiles.end(), [](const LogFile& a, const LogFile& b) { return a.number < b.number; });
+
+        // The partially read data files are continued first. As a key is always written in the same write lane, and the data files of
+        // a lane are numbered in write order, the order of the records of a given key is preserved
+        ChangeLogCursor    nextCursor{cursor.nextDataFileNumber, {}};
+        lcVector<uint64_t> sequences = cursor.partialSequences;
+        std::sort(sequences.begin(), sequences.end());
+        size_t partialQty = sequences.size();
+        for (const LogFile& lf : logFiles) {
+            if (lf.number >= cursor.nextDataFileNumber) { sequences.push_back(lf.number << 32); }
+        }
+
+        Status status = Status::Ok;
+        for (size_t seqIdx = 0; seqIdx < sequences.size(); ++seqIdx) {
+            uint64_t sequence = sequences[seqIdx];
+            uint64_t number   = sequence >> 32;
+            auto     it       = std::lower_bound(logFiles.begin(), logFiles.end(), number,
+                                                 [](const LogFile& lf, uint64_t n) { return lf.number < n; });
+            if (it == logFiles.end() || it->number != number) {
+                status = Status::EntryNotFound;  // The position was merged
+                break;
+            }
+            if (records.size() >= maxRecordQty) {
+                if (seqIdx >= partialQty) { break; }  // The next data files are not started
+                nextCursor.partialSequences.push_back(sequence);
+                continue;
+            }
+
+            uint32_t fileOffset = (uint32_t)sequence;
+            bool     isActive   = false;
+            status              = readChangeLogFile(it->fileId, it->filename, number, fileOffset, maxRecordQty, records, isActive);
+            if (status != Status::Ok) { break; }
+            if (isActive || records.size() >= maxRecordQty) { nextCursor.partialSequences.push_back((number << 32) | fileOffset); }
+            nextCursor.nextDataFileNumber = std::max(nextCursor.nextDataFileNumber, number + 1);
+        }
+
+        if (status != Status::Ok) {
+            records.clear();
+            return status;
+        }
+        cursor = nextCursor;
+        return Status::Ok;
+    }
+
+    // Pins the data file 'fileId' if it is still the data file 'filename', so that its handle can be used outside of the data file lock.
+    // It returns nullptr if the data file was merged or the store closed. If 'isActive' is provided, it tells if the data file is an
+    // active one, and 'endOffset' is then its flushed size
+    detail::DataFile* pinChangeLogFile(uint16_t fileId, const lcString& filename, bool* isActive = nullptr, int64_t* endOffset = nullptr)
+    {
+        using namespace litecask::detail;
+        _mxDataFiles.lockRead();
+        DataFile* dfd = (_isInitialized && fileId < _dataFiles.size()) ? _dataFiles[fileId] : nullptr;
+        if (dfd && (!osIsValidHandle(dfd->handle) || dfd->filename != filename)) { dfd = nullptr; }
+        if (dfd) { pinDataFileUnlocked(dfd); }
+        if (dfd && isActive) {
+            *isActive = false;
+            for (WriteLane* lane : _writeLanes) {
+                if (lane->activeDataFileId != fileId) { continue; }
+                lane->mxWriteBuffer.lockRead();
+                *endOffset = lane->activeFlushedDataOffset;
+                lane->mxWriteBuffer.unlockRead();
+                *isActive = true;
+            }
         }
+        _mxDataFiles.unlockRead();
+        return dfd;
     }
 
-    // Configuration
-    // ==========================================================================================
+    // Reads the records of a data file from 'fileOffset', which is updated, up to its end or its flushed part if it is active.
+    // The data file lock is taken only to pin the data file for each record, so that the writers and the merge are not delayed by
+    // the reads
+    Status readChangeLogFile(uint16_t fileId, const lcString& filename, uint64_t number, uint32_t& fileOffset, uint32_t maxRecordQty,
+                             lcVector<ChangeRecord>& records, bool& isActive)
+    {
+        using namespace litecask::detail;
 
-    // Defines the buffer size to write entries and batch the costly disk access.
-    // This optimization is effective as each disk write system call has a fixed base cost.
-    // Too big a size may create spikes of latency when flushing the buffer, too small a size reduces write throughput performance.
-    // In practice small values are enough to amortize the system calls
-    Status setWriteBufferBytes(uint32_t writeBufferBytes)
+        // Only the flushed part of an active data file is readable
+        int64_t   endOffset = -1;
+        DataFile* dfd       = pinChangeLogFile(fileId, filename, &isActive, &endOffset);
+        if (!dfd) { return Status::EntryNotFound; }  // The position was merged
+        if (!isActive) { endOffset = osGetFileSize(filename); }
+        unpinDataFile(dfd);
+        if (endOffset < 0) { return Status::BadDiskAccess; }
+
+        while (records.size() < maxRecordQty && (int64_t)fileOffset + (int64_t)sizeof(DataFileEntry) <= endOffset) {
+            dfd = pinChangeLogFile(fileId, filename);
+            if (!dfd) { return Status::EntryNotFound; }
+            Status status = readChangeLogRecord(dfd, number, fileOffset, endOffset, records);
+            unpinDataFile(dfd);
+            if (status == Status::Ok && !records.back().isRemoval && (records.back().flags & EntryFlagBlob)) {
+                status = readChangeLogBlobValue(records.back());
+            }
+            if (status != Status::Ok) { return status; }
+        }
+        return Status::Ok;
+    }
+
+    // Reads the record at 'fileOffset' of a pinned data file, and updates 'fileOffset' to the next record
+    Status readChangeLogRecord(const detail::DataFile* dfd, uint64_t number, uint32_t& fileOffset, int64_t endOffset,
+                               lcVector<ChangeRecord>& records)
     {
-        _mxWriteBuffer.lockWrite();
-        flushWriteBufferUnlocked();
-        _writeBuffer.resize(writeBufferBytes);
-        _mxWriteBuffer.unlockWrite();
+        using namespace litecask::detail;
+        DataFileEntry header;
+        if (!osOsRead(dfd->handle, &header, sizeof(DataFileEntry), fileOffset)) { return Status::BadDiskAccess; }
+        bool     isRemoval   = (header.valueSize == DeletedEntry);
+        uint32_t valueSize   = isRemoval ? 0 : header.valueSize;
+        uint32_t recordBytes = (uint32_t)sizeof(DataFileEntry) + header.keySize + header.keyIndexSize + valueSize;
+        if ((int64_t)fileOffset + recordBytes > endOffset) { return Status::EntryCorrupted; }
+
+        records.push_back({});
+        ChangeRecord& r = records.back();
+        r.key.resize(header.keySize);
+        r.keyIndexes.resize(header.keyIndexSize / sizeof(KeyIndex));
+        r.value.resize(valueSize);
+        uint32_t keyOffset   = fileOffset + (uint32_t)sizeof(DataFileEntry);
+        uint32_t indexOffset = keyOffset + header.keySize;
+        uint32_t valueOffset = indexOffset + header.keyIndexSize;
+        if (!osOsRead(dfd->handle, r.key.data(), header.keySize, keyOffset) ||
+            (header.keyIndexSize > 0 && !osOsRead(dfd->handle, r.keyIndexes.data(), header.keyIndexSize, indexOffset)) ||
+            (valueSize > 0 && !osOsRead(dfd->handle, r.value.data(), valueSize, valueOffset))) {
+            return Status::BadDiskAccess;
+        }
+
+        r.sequence   = (number << 32) | fileOffset;
+        r.keyHash    = LITECASK_HASH_FUNC(r.key.data(), r.key.size());
+        r.expTimeSec = header.expTimeSec;
+        r.checksum   = header.checksum;
+        r.flags      = header.flags;
+        r.isRemoval  = isRemoval;
+        if (header.checksum != (uint32_t)(isRemoval ? r.keyHash : (r.keyHash ^ LITECASK_HASH_FUNC(r.value.data(), valueSize)))) {
+            return Status::EntryCorrupted;
+        }
+        fileOffset += recordBytes;
         return Status::Ok;
     }
 
-    Status setConfig(const Config& config)
+    // The value of a blob file is provided inline, as the blob files are not replicated. As for a get, the data file lock is taken
+    // only to build the blob filename
+    Status readChangeLogBlobValue(ChangeRecord& r)
     {
-        if (config.dataFileMaxBytes < detail::MinDataFileMaxBytes) {
-            log(LogLevel::Warn, "setConfig: too small 'dataFileMaxBytes' parameter value. Shall be above %d", detail::MinDataFileMaxBytes);
-            return Status::BadParameterValue;
+        using namespace litecask::detail;
+        BlobRef blobRef;
+        if (r.value.size() != sizeof(BlobRef)) { return Status::EntryCorrupted; }
+        memcpy(&blobRef, r.value.data(), sizeof(BlobRef));
+        r.value.resize(blobRef.valueSize);
+        _mxDataFiles.lockRead();
+        lcString blobFilename = getBlobFilenameUnlocked(blobRef.blobId);
+        _mxDataFiles.unlockRead();
+        Status blobStatus = readBlobFile(blobFilename, r.value.data(), blobRef.valueSize);
+        if (blobStatus == Status::Ok && (uint32_t)LITECASK_HASH_FUNC(r.value.data(), r.value.size()) != blobRef.checksum) {
+            blobStatus = Status::EntryCorrupted;
         }
-        if (config.mergeCyclePeriodMs == 0) {
-            log(LogLevel::Warn, "setConfig: 'mergeCyclePeriodMs' shall be a positive integer.");
-            return Status::BadParameterValue;
+        if (blobStatus != Status::Ok) { return Status::EntryCorrupted; }
+        r.flags &= (uint8_t)~EntryFlagBlob;
+        r.checksum = (uint32_t)(r.keyHash ^ LITECASK_HASH_FUNC(r.value.data(), r.value.size()));
+        return Status::Ok;
+    }
+
+    Status privateApplyReplicated(const lcVector<ChangeRecord>& records, bool forceDiskSync)
+    {
+        using namespace litecask::detail;
+        LatencyScope latencyScope(_latency, LatencyKind::WriteBatch);
+
+        // The records are serialized as is in a write batch. Only the new blob files, if any, require a value hash
+        WriteBatch batch;
+        for (const ChangeRecord& r : records) {
+            const void*   value = r.value.data();
+            DataFileEntry dfe{r.checksum, r.isRemoval ? 0 : r.expTimeSec, r.isRemoval ? DeletedEntry : (uint32_t)r.value.size(),
+                              (uint16_t)r.key.size(), (uint8_t)(r.keyIndexes.size() * sizeof(KeyIndex)), r.flags};
+            BlobRef       blobRef;
+            if (!r.isRemoval && r.value.size() >= _blobMinBytes && (r.flags & EntryFlagCompressed) == 0) {
+                bool   withOsSync = forceDiskSync || _syncPolicy != SyncPolicy::None;
+                Status blobStatus = writeBlobValue(r.value.data(), r.value.size(), withOsSync, blobRef);
+                if (blobStatus != Status::Ok) { return blobStatus; }
+                value         = &blobRef;
+                dfe.valueSize = sizeof(BlobRef);
+                dfe.checksum  = (uint32_t)(r.keyHash ^ LITECASK_HASH_FUNC(&blobRef, sizeof(BlobRef)));
+                dfe.flags |= EntryFlagBlob;
+            }
+            size_t recordOffset = batch.appendRecord(dfe, r.key.data(), r.key.size(), r.keyIndexes.data(), dfe.keyIndexSize);
+            if (!r.isRemoval && dfe.valueSize > 0) {
+                memcpy(&batch._data[recordOffset + sizeof(DataFileEntry) + dfe.keySize + dfe.keyIndexSize], value, dfe.valueSize);
+            }
+            batch._ops.push_back({r.keyHash, recordOffset});
         }
-        if (config.upkeepCyclePeriodMs == 0) {
-            log(LogLevel::Warn, "setConfig: 'upkeepCyclePeriodMs' shall be a positive integer.");
+        return privateWrite(batch, forceDiskSync, true);
+    }
+
+    Status privateScan(const std::function<bool(const ScanEntry& entry)>& onEntry, bool withValues, uint32_t rangeIdx, uint32_t rangeQty)
+    {
+        using namespace litecask::detail;
+        LatencyScope latencyScope(_latency, LatencyKind::Scan);
+        ++_stats.scanCallQty;
+
+        if (rangeQty == 0 || rangeIdx >= rangeQty) {
+            ++_stats.scanCallFailedQty;
             return Status::BadParameterValue;
         }
-        if (config.upkeepKeyDirBatchSize == 0) {
-            log(LogLevel::Warn, "setConfig: 'upkeepKeyDirBatchSize' shall be a positive integer.");
-            return Status::BadParameterValue;
+        _mxDataFiles.lockRead();
+        bool isInitialized = _isInitialized;
+        _mxDataFiles.unlockRead();
+        if (!isInitialized) {
+            ++_stats.scanCallFailedQty;
+            return Status::StoreNotOpen;
         }
-        if (config.upkeepValueCacheBatchSize == 0) {
-            log(LogLevel::Warn, "setConfig: 'upkeepValueCacheBatchSize' shall be a positive integer.");
-            return Status::BadParameterValue;
+
+        // Range of key hashes to scan, and the relevant shards of the key directory
+        constexpr uint32_t ScanBatchSlotQty = 16384;
+        uint32_t           minHash          = (uint32_t)(((uint64_t)rangeIdx << 32) / rangeQty);
+        uint32_t           maxHash          = (uint32_t)((((uint64_t)rangeIdx + 1) << 32) / rangeQty - 1);
+
+        lcVector<KeyDirScanEntry>   batchEntries;
+        lcVector<uint8_t>           keyBytes;
+        lcVector<lcVector<uint8_t>> batchKeys;
+        lcVector<lcVector<uint8_t>> batchValues;
+        lcVector<Status>            batchStatuses;
+        lcVector<uint64_t>          providedKeyHashes;
+        lcVector<uint64_t>          previousKeyHashes;
+        ScanEntry                   scanEntry;
+        bool                        isFingerprintMode = _keyDir->isFingerprintMode();
+
+        for (uint32_t shardIdx = ShardedKeyDir::getShardIndex(minHash); shardIdx <= ShardedKeyDir::getShardIndex(maxHash); ++shardIdx) {
+            KeyDirShard& shard = _keyDir->getShard(shardIdx);
+            providedKeyHashes.clear();
+            previousKeyHashes.clear();
+            uint32_t tableSize = 0;
+
+            for (uint32_t startSlot = 0; startSlot < tableSize || tableSize == 0; startSlot += ScanBatchSlotQty) {
+                while (true) {
+                    // An ongoing resizing of the shard is finished first, one batch at a time as in the upkeep, so that the writers
+                    // are not blocked by the whole resizing
+                    while (shard.map.isResizingOngoing()) {
+                        shard.mx.lock();
+                        shard.map.backgroundResizeWork(ScanBatchSlotQty);
+                        shard.mx.unlock();
+                        std::this_thread::yield();
+                    }
+                    // In fingerprint mode, the data file lock keeps the copied entry locations valid until their keys are read
+                    if (isFingerprintMode) { _mxDataFiles.lockRead(); }
+                    shard.mx.lock();
+                    if (!shard.map.isResizingOngoing()) { break; }
+                    shard.mx.unlock();  // A new resizing started in-between
+                    if (isFingerprintMode) { _mxDataFiles.unlockRead(); }
+                }
+                uint32_t newTableSize = shard.map.getScanEntries(startSlot, ScanBatchSlotQty, minHash, maxHash, batchEntries, keyBytes);
+                if (tableSize != 0 && newTableSize != tableSize) {
+                    // The shard was resized in-between, so the entries moved: the scan of this shard restarts, skipping the
+                    // already provided entries
+                    previousKeyHashes.insert(previousKeyHashes.end(), providedKeyHashes.begin(), providedKeyHashes.end());
+                    std::sort(previousKeyHashes.begin(), previousKeyHashes.end());
+                    providedKeyHashes.clear();
+                    startSlot = 0;
+                    shard.map.getScanEntries(startSlot, ScanBatchSlotQty, minHash, maxHash, batchEntries, keyBytes);
+                }
+                shard.mx.unlock();
+                tableSize = newTableSize;
+
+                // Keys and values are read by increasing disk location
+                if (withValues || isFingerprintMode) {
+                    std::sort(batchEntries.begin(), batchEntries.end(), [](const KeyDirScanEntry& a, const KeyDirScanEntry& b) {
+                        return (a.metadata.fileId < b.metadata.fileId) ||
+                               (a.metadata.fileId == b.metadata.fileId && a.metadata.fileOffset < b.metadata.fileOffset);
+                    });
+                }
+
+                // An entry whose key cannot be read from the data file is skipped
+                size_t keyQty = 0;
+                batchKeys.resize(batchEntries.size());
+                for (size_t i = 0; i < batchEntries.size(); ++i) {
+                    const KeyDirScanEntry& e = batchEntries[i];
+                    if (isFingerprintMode) {
+                        if (!readEntryKeyUnlocked(e.keyHash, e.metadata, batchKeys[keyQty])) { continue; }
+                    } else {
+                        const uint8_t* key = &keyBytes[e.keyOffset];
+                        batchKeys[keyQty].assign(key, key + e.metadata.keySize);
+                    }
+                    batchEntries[keyQty++] = e;
+                }
+                if (isFingerprintMode) { _mxDataFiles.unlockRead(); }
+                batchEntries.resize(keyQty);
+                batchKeys.resize(keyQty);
+                if (withValues && !batchKeys.empty()) { privateGetBatch(batchKeys, batchValues, batchStatuses); }
+
+                for (size_t i = 0; i < batchEntries.size(); ++i) {
+                    const KeyDirScanEntry& e       = batchEntries[i];
+                    uint64_t               keyHash = LITECASK_HASH_FUNC(batchKeys[i].data(), batchKeys[i].size());
+                    if (!previousKeyHashes.empty() && std::binary_search(previousKeyHashes.begin(), previousKeyHashes.end(), keyHash)) {
+                        continue;
+                    }
+                    if (withValues && batchStatuses[i] != Status::Ok) { continue; }  // Removed in-between
+                    providedKeyHashes.push_back(keyHash);
+
+                    scanEntry.key.swap(batchKeys[i]);
+                    const uint8_t* keyIndexes = &keyBytes[e.keyOffset + (isFingerprintMode ? 0 : e.metadata.keySize)];
+                    scanEntry.keyIndexes.resize(e.metadata.keyIndexSize / sizeof(KeyIndex));
+                    if (e.metadata.keyIndexSize) { memcpy(scanEntry.keyIndexes.data(), keyIndexes, e.metadata.keyIndexSize); }
+                    scanEntry.expTimeSec = e.metadata.expTimeSec;
+                    if (withValues) {
+                        scanEntry.value.swap(batchValues[i]);
+                    } else {
+                        scanEntry.value.clear();
+                    }
+                    ++_stats.scanEntryQty;
+                    if (!onEntry(scanEntry)) { return Status::Ok; }
+                }
+            }
         }
-        if (config.valueCacheTargetMemoryLoadPercentage > 100) {
-            log(LogLevel::Warn, "setConfig: 'valueCacheTargetMemoryLoadPercentage' shall be in the range [0; 100]");
-            return Status::BadParameterValue;
+        return Status::Ok;
+    }
+
+    // Helper function for the paginated query
+    static std::function<bool(const lcVector<uint8_t>&, const lcVector<uint8_t>&)> getQueryPageCollector(
+        lcVector<lcVector<uint8_t>>& matchingKeys)
+    {
+        return [&matchingKeys](const lcVector<uint8_t>& key, const lcVector<uint8_t>& /*value*/) {
+            matchingKeys.push_back(key);
+            return true;
+        };
+    }
+
+    // Templatized helper function for template<class KP, class K> privateQuery(...) below
+    void addQueryResult(lcVector<lcVector<uint8_t>>& matchingKeys, const lcVector<uint8_t>& key, ArenaAllocator* /*allocator*/)
+    {
+        matchingKeys.push_back(key);
+    }
+
+    // Templatized helper function for template<class KP, class K> privateQuery(...) below
+    void addQueryResult(lcVector<QueryResult>& matchingKeys, const lcVector<uint8_t>& key, ArenaAllocator* allocator)
+    {
+        uint8_t* ptr = allocator->allocate(key.size());
+        assert(ptr);
+        memcpy(ptr, key.data(), key.size());
+        matchingKeys.push_back({ptr, (uint16_t)key.size()});
+    }
+
+    // Collects the hashes present in the lists of all the key parts, starting at 'startHash' and by blocks of at most 'maxSourceHashQty'
+    // hashes of the smallest list. 'startHash' is updated to the next hash to process, above UINT32_MAX if the lists are exhausted.
+    // Returns the index of the key part with the smallest list, or -1 if the intersection is empty
+    template<class KP>
+    int getQueryCandidates(const lcVector<KP>& keyParts, uint64_t& startHash, uint32_t maxSourceHashQty, lcVector<uint32_t>& candidates)
+    {
+        candidates.clear();
+
+        // Get the entry lists of all the key parts. The "and" between the key parts is an intersection of these sorted lists,
+        // starting with the smallest one to minimize the work. The key directory is accessed only for the final candidates
+        struct EntryList {
+            const uint32_t* hashes;
+            uint32_t        size;
+            int             keyPartIdx;
+        };
+        lcVector<EntryList> entryLists;
+        bool                isIndexMapWriteLocked = false;
+        _mxIndexMap.lockRead();
+        for (int keyPartIdx = 0; keyPartIdx < (int)keyParts.size(); ++keyPartIdx) {
+            const KP&       kp        = keyParts[keyPartIdx];
+            const uint32_t* hashes    = nullptr;
+            uint32_t        sortedQty = 0;
+            uint32_t        entries   = _indexMap->getEntryHashes(kp.data(), (uint16_t)kp.size(), &hashes, &sortedQty);
+            if (entries > sortedQty) {
+                if (!isIndexMapWriteLocked) {
+                    // The hashes appended by the insertions since the last query shall be sorted, which requires the write lock.
+                    // The lists are collected again as they may have been modified while the lock was released
+                    _mxIndexMap.unlockRead();
+                    _mxIndexMap.lockWrite();
+                    isIndexMapWriteLocked = true;
+                    entryLists.clear();
+                    keyPartIdx = -1;
+                    continue;
+                }
+                entries = _indexMap->sortEntryHashes(kp.data(), (uint16_t)kp.size(), &hashes);
+            }
+            if (entries == 0) {  // Empty match, so empty output ("and" between key parts)
+                entryLists.clear();
+                break;
+            }
+            entryLists.push_back({hashes, entries, keyPartIdx});
         }
-        if (config.mergeTriggerDataFileFragmentationPercentage < 1 || config.mergeTriggerDataFileFragmentationPercentage > 100) {
-            log(LogLevel::Warn, "setConfig: 'mergeTriggerDataFileFragmentationPercentage' shall be in the range ]0; 100].");
-            return Status::BadParameterValue;
+
+        // Intersect the lists, from the smallest to the largest, in the hash range of the processed block of the smallest list
+        int sourceKeyPartIdx = -1;
+        if (entryLists.empty()) {
+            startHash = (uint64_t)UINT32_MAX + 1;
+        } else {
+            std::sort(entryLists.begin(), entryLists.end(), [](const EntryList& a, const EntryList& b) { return a.size < b.size; });
+            sourceKeyPartIdx          = entryLists[0].keyPartIdx;
+            const uint32_t* sourceEnd = entryLists[0].hashes + entryLists[0].size;
+            const uint32_t* first     = (startHash > UINT32_MAX) ? sourceEnd
+                                                                 : std::lower_bound(entryLists[0].hashes, sourceEnd, (uint32_t)startHash);
+            const uint32_t* last      = first + std::min((size_t)maxSourceHashQty, (size_t)(sourceEnd - first));
+            startHash                 = (last == sourceEnd) ? (uint64_t)UINT32_MAX + 1 : (uint64_t)*last;
+            candidates.assign(first, last);
+
+            lcVector<uint32_t> intersection(candidates.size());
+            for (size_t listIdx = 1; listIdx < entryLists.size() && !candidates.empty(); ++listIdx) {
+                const EntryList& el         = entryLists[listIdx];
+                const uint32_t*  rangeStart = std::lower_bound(el.hashes, el.hashes + el.size, candidates.front());
+                const uint32_t*  rangeEnd   = std::upper_bound(rangeStart, el.hashes + el.size, candidates.back());
+                size_t           intersectionSize = detail::intersectSortedHashes(candidates.data(), candidates.size(), rangeStart,
+                                                                                  (size_t)(rangeEnd - rangeStart), intersection.data());
+                intersection.resize(intersectionSize);
+                candidates.swap(intersection);
+                intersection.resize(candidates.size());
+            }
         }
-        if (config.mergeTriggerDataFileDeadByteThreshold > config.dataFileMaxBytes) {
-            log(LogLevel::Warn,
-                "setConfig: too big 'mergeTriggerDataFileDeadByteThreshold' parameter value. Shall be below dataFileMaxBytes=%d",
-                config.dataFileMaxBytes);
-            return Status::InconsistentParameterValues;
+        if (isIndexMapWriteLocked) {
+            _mxIndexMap.unlockWrite();
+        } else {
+            _mxIndexMap.unlockRead();
         }
-        if (config.mergeSelectDataFileFragmentationPercentage < 1 || config.mergeSelectDataFileFragmentationPercentage > 100) {
-            log(LogLevel::Warn, "setConfig: 'mergeSelectDataFileFragmentationPercentage' shall be in the range ]0; 100].");
-            return Status::BadParameterValue;
+        return sourceKeyPartIdx;
+    }
+
+    // Checks that the entry with the provided hash exists and contains all the key parts, and gets its key.
+    // 'isSourceKeyPartMissing' is set if the entry does not exist or does not contain the key part of the smallest list
+    template<class KP>
+    bool isQueryMatch(const lcVector<KP>& keyParts, int sourceKeyPartIdx, uint32_t keyHash, lcVector<uint8_t>& key,
+                      lcVector<KeyIndex>& keyIndexes, bool& isSourceKeyPartMissing)
+    {
+        if (!getEntryKeyAndIndexes(keyHash, key, keyIndexes)) {
+            isSourceKeyPartMissing = true;
+            return false;
         }
-        if (config.mergeSelectDataFileFragmentationPercentage > config.mergeTriggerDataFileFragmentationPercentage) {
-            log(LogLevel::Warn,
-                "setConfig: too big 'mergeSelectDataFileFragmentationPercentage' parameter value. Shall be below "
-                "mergeTriggerDataFileFragmentationPercentage=%d",
-                config.mergeTriggerDataFileFragmentationPercentage);
-            return Status::InconsistentParameterValues;
+
+        // Filter on the key parts (which implements the "and" behavior if multiple key parts are provided)
+        for (int i = 0; i < (int)keyParts.size(); ++i) {
+            // Swap sourceKeyPart and index 0. Indeed, we want to check that the "main" key part is present in the key
+            int       keyPartIdx = (i == 0) ? sourceKeyPartIdx : ((i == sourceKeyPartIdx) ? 0 : i);
+            const KP& kp         = keyParts[keyPartIdx];
+
+            bool keyPartFound = false;
+            for (const auto& ki : keyIndexes) {
+                if (ki.size == kp.size() && !memcmp(&key[ki.startIdx], kp.data(), ki.size)) {
+                    keyPartFound = true;
+                    break;
+                }
+            }
+            if (!keyPartFound) {
+                // The key part is unexpecingly not in the entry
+                isSourceKeyPartMissing = (keyPartIdx == sourceKeyPartIdx);
+                return false;
+            }
         }
-        if (config.mergeSelectDataFileDeadByteThreshold > config.mergeTriggerDataFileDeadByteThreshold) {
-            log(LogLevel::Warn,
-                "setConfig: too big 'mergeSelectDataFileDeadByteThreshold' parameter value. Shall be below "
-                "mergeTriggerDataFileDeadByteThreshold=%d",
-                config.mergeTriggerDataFileDeadByteThreshold);
-            return Status::InconsistentParameterValues;
+        return true;
+    }
+
+    template<class KP>
+    Status privateForEachMatch(const lcVector<KP>& keyParts, QueryCursor& cursor, uint32_t maxMatchQty,
+                               const std::function<bool(const lcVector<uint8_t>& key, const lcVector<uint8_t>& value)>& onMatch,
+                               bool withValues)
+    {
+        detail::LatencyScope latencyScope(_latency, LatencyKind::Query);
+        ++_stats.queryCallQty;
+
+        // Check key parts validity
+        if (keyParts.empty()) {
+            cursor.nextHash = (uint64_t)UINT32_MAX + 1;
+            return Status::Ok;
         }
-        if (config.mergeSelectDataFileSmallSizeTheshold < detail::MinDataFileMaxBytes) {
-            log(LogLevel::Warn, "setConfig: too small 'mergeSelectDataFileSmallSizeTheshold' parameter value. Shall be above %d",
-                detail::MinDataFileMaxBytes);
-            return Status::BadParameterValue;
+        for (const KP& kp : keyParts) {
+            if (kp.size() >= USHRT_MAX) {
+                ++_stats.queryCallFailedQty;
+                return Status::BadKeySize;
+            }
         }
 
-        // Accepted config
-        _mxConfig.lock();
-        _config           = config;
-        _dataFileMaxBytes = (uint64_t)config.dataFileMaxBytes;  // Harmless data race (integrity is ensured)
-        _valueCache->setTargetMemoryLoad(0.01 * config.valueCacheTargetMemoryLoadPercentage);
-        _mxConfig.unlock();
+        // The candidates are processed by blocks, so that the index lock is held for a short time only and the
+        // memory usage is bounded. The matching keys of a block are provided together, after fetching their values if required
+        constexpr uint32_t          QueryBlockHashQty = 1024;
+        lcVector<uint32_t>          candidates;
+        lcVector<uint8_t>           key;
+        lcVector<KeyIndex>          keyIndexes;
+        lcVector<lcVector<uint8_t>> blockKeys;
+        lcVector<uint32_t>          blockKeyHashes;
+        lcVector<lcVector<uint8_t>> blockValues;
+        lcVector<Status>            blockStatuses;
+        const lcVector<uint8_t>     noValue;
+        uint32_t                    matchQty = 0;
+
+        while (!cursor.isEnd() && matchQty < maxMatchQty) {
+            int sourceKeyPartIdx = getQueryCandidates(keyParts, cursor.nextHash, QueryBlockHashQty, candidates);
+            if (sourceKeyPartIdx < 0) { break; }
+
+            blockKeys.clear();
+            blockKeyHashes.clear();
+            for (uint32_t keyHash : candidates) {
+                bool isSourceKeyPartMissing = false;
+                if (!isQueryMatch(keyParts, sourceKeyPartIdx, keyHash, key, keyIndexes, isSourceKeyPartMissing)) { continue; }
+                if (matchQty + blockKeys.size() == maxMatchQty) {
+                    cursor.nextHash = keyHash;  // Limit reached: the next call restarts from this match
+                    break;
+                }
+                blockKeys.push_back(key);
+                blockKeyHashes.push_back(keyHash);
+            }
+            if (withValues && !blockKeys.empty()) { privateGetBatch(blockKeys, blockValues, blockStatuses); }
+
+            for (size_t i = 0; i < blockKeys.size(); ++i) {
+                if (withValues && blockStatuses[i] != Status::Ok) { continue; }  // Removed in-between
+                ++matchQty;
+                if (!onMatch(blockKeys[i], withValues ? blockValues[i] : noValue)) {
+                    cursor.nextHash = (uint64_t)blockKeyHashes[i] + 1;  // Stopped by the caller: the next call restarts after this match
+                    return Status::Ok;
+                }
+            }
+        }
         return Status::Ok;
     }
 
-    // Open and close
-    // ==========================================================================================
-
-    Status open(fs::path dbDirectoryPath, bool doCreateIfNotExist = true)
+    template<class KP, class K>
+    Status privateQuery(const lcVector<KP>& keyParts, lcVector<K>& matchingKeys, ArenaAllocator* allocator = nullptr)
     {
-        using namespace litecask::detail;
-        if (_isInitialized) {
-            ++_stats.openCallFailedQty;
-            log(LogLevel::Error, "'open' failed: %s", toString(Status::StoreAlreadyOpen));
-            return Status::StoreAlreadyOpen;
+        detail::LatencyScope latencyScope(_latency, LatencyKind::Query);
+        matchingKeys.clear();
+        ++_stats.queryCallQty;
+
+        // Check key parts validity
+        for (const KP& kp : keyParts) {
+            if (kp.size() >= USHRT_MAX) {
+                ++_stats.queryCallFailedQty;
+                return Status::BadKeySize;
+            }
         }
 
-        // Input directory massaging
-        std::error_code ec;
-        dbDirectoryPath /= "";
-        if (!fs::exists(dbDirectoryPath) && doCreateIfNotExist) { fs::create_directories(dbDirectoryPath, ec); }
-        if (!fs::exists(dbDirectoryPath) || !fs::is_directory(dbDirectoryPath, ec)) {
-            ++_stats.openCallFailedQty;
-            log(LogLevel::Error, "'open' failed: %s", toString(Status::CannotOpenStore));
-            return Status::CannotOpenStore;
+        // Get the candidate hashes, present in all the key part lists
+        lcVector<uint32_t> entryHashes;
+        uint64_t           startHash        = 0;
+        int                sourceKeyPartIdx = getQueryCandidates(keyParts, startHash, UINT32_MAX, entryHashes);
+
+        // Empty answer
+        if (sourceKeyPartIdx < 0 || entryHashes.empty()) { return Status::Ok; }
+        const KP& sourceKeyPart = keyParts[sourceKeyPartIdx];
+
+        // Loop on the hashes
+        //   - check if the entry exists and really contain the keyPart
+        //   - if yes, check that other keyparts are also present (hash collisions are possible)
+        //   - if all are present, store the key in the result list
+        lcVector<uint8_t>  key;
+        lcVector<KeyIndex> keyIndexes;
+        uint32_t           hashNotPresentQty = 0;
+        for (uint32_t entryHashIdx = 0; entryHashIdx < (uint32_t)entryHashes.size(); ++entryHashIdx) {
+            uint32_t keyHash                = entryHashes[entryHashIdx];
+            bool     isSourceKeyPartMissing = false;
+            if (isQueryMatch(keyParts, sourceKeyPartIdx, keyHash, key, keyIndexes, isSourceKeyPartMissing)) {
+                addQueryResult(matchingKeys, key, allocator);
+            } else if (isSourceKeyPartMissing) {
+                // The entry hash array is reused to store the absent hash (or without the key part).
+                // Collected data is used later if a "cleaning" is triggered
+                entryHashes[hashNotPresentQty++] = keyHash;
+            }
         }
 
-        // Lock the database via a lock file
-        Status s = lockDatabase(dbDirectoryPath);
-        if (s != Status::Ok) {
-            ++_stats.openCallFailedQty;
-            log(LogLevel::Error, "'open' failed: unable to lock the datastore, %s.", toString(s));
-            return s;
+        // A cleaning phase to remove the no-more-matching keys from the database is done at query time.
+        // The mismatch is due to database entry key index modification or entry removal, as no index array update is performed
+        // at that time for performance reasons.
+        // The cleaning implies both an update of the index lookup array and an update of the key part list inside the entries.
+        // It is trigged based on a minimum quantity and array ratio of entries to clean.
+        // Note: in case of multiple "AND" index provided, only the one with smallest array will be processed
+        constexpr uint32_t MinimumMismatchEntries      = 10;
+        constexpr uint64_t MinimumMismatchArrayPercent = 10;
+        if (hashNotPresentQty > MinimumMismatchEntries &&
+            (uint64_t)hashNotPresentQty * 100 > MinimumMismatchArrayPercent * entryHashes.size()) {
+            ++_stats.indexArrayCleaningQty;
+
+            // Get the writable array of entry hashes
+            uint32_t* storedEntryHashes        = nullptr;
+            uint32_t* storedEntryHashQty       = nullptr;
+            uint32_t* storedSortedEntryHashQty = nullptr;
+            _mxIndexMap.lockWrite();
+            if (_indexMap->getEntryHashesForUpdate(sourceKeyPart.data(), (uint16_t)sourceKeyPart.size(), &storedEntryHashes,
+                                                   &storedEntryHashQty, &storedSortedEntryHashQty)) {
+                // Collected invalid hashes are sorted, so they are searched in the sorted part of the array in one pass, which
+                // is compacted in place to keep the order. The hashes appended in-between are in the unsorted part and are kept
+                uint32_t writeIndex            = 0;
+                uint32_t invalidEntryHashIndex = 0;
+                uint32_t removedSortedQty      = 0;
+                for (uint32_t readIndex = 0; readIndex < *storedEntryHashQty; ++readIndex) {
+                    uint32_t storedHash = storedEntryHashes[readIndex];
+                    if (readIndex < *storedSortedEntryHashQty) {
+                        while (invalidEntryHashIndex < hashNotPresentQty && entryHashes[invalidEntryHashIndex] < storedHash) {
+                            ++invalidEntryHashIndex;
+                        }
+                        if (invalidEntryHashIndex < hashNotPresentQty && entryHashes[invalidEntryHashIndex] == storedHash) {
+                            ++invalidEntryHashIndex;
+
+                            // Clean the index in the entry
+                            std::mutex& mxKeyDirShard = _keyDir->getMutex(storedHash);
+                            mxKeyDirShard.lock();
+                            bool isCleaned = _keyDir->cleanIndex(storedHash, sourceKeyPart.data(), (uint16_t)sourceKeyPart.size());
+                            mxKeyDirShard.unlock();
+                            if (isCleaned) {
+                                // The index was removed or not found in this entry, so it shall also be removed from current hash array
+                                ++removedSortedQty;
+                                ++_stats.indexArrayCleanedEntries;
+                                continue;
+                            }
+                        }
+                    }
+                    storedEntryHashes[writeIndex++] = storedHash;
+                }
+                *storedSortedEntryHashQty -= removedSortedQty;
+                *storedEntryHashQty = writeIndex;
+
+            } else {
+                log(LogLevel::Warn,
+                    "The key part to clean was not found in the index map in spite of the absence of removal of such item...");
+            }
+
+            _mxIndexMap.unlockWrite();
         }
 
-        lcVector<lcString> baseDataFilenames;
-        s = sanitizeAndCollectDataFiles(dbDirectoryPath, _maxDataFileIndex, baseDataFilenames);
-        if (s != Status::Ok) {
-            ++_stats.openCallFailedQty;
-            log(LogLevel::Error, "'open' failed: unable to clean the datastore, %s.", toString(s));
-            return s;
+        return Status::Ok;
+    }
+
+    void notifyKeyDirResizing(uint32_t newSize, bool isStart, bool wasForced)
+    {
+        if (isStart) {
+            log(LogLevel::Debug, "KeyDir resizing to %u entries started", newSize);
+            std::unique_lock<std::mutex> lk(_upkeepMutex);
+            _upkeepWork.store(true);
+            _upkeepCv.notify_one();
+        } else {
+            log(LogLevel::Debug, "KeyDir resizing to %u entries finished%s", newSize, wasForced ? " (forced)" : "");
         }
+    }
 
-        if (!doCreateIfNotExist && baseDataFilenames.empty()) {
-            ++_stats.openCallFailedQty;
-            log(LogLevel::Error, "'open' failed because there is no datastore at the provided path.");
-            unlockDatabase(dbDirectoryPath);
-            return Status::CannotOpenStore;
+    bool requestUpKeeping()
+    {
+        std::unique_lock<std::mutex> lk(_upkeepMutex);
+        if (_isInitialized && _upkeepWork.load() == false) {
+            _upkeepWork.store(true);
+            _upkeepCv.notify_one();
+            return true;
         }
+        return false;
+    }
 
-        // Reset all fields
-        _directory = dbDirectoryPath;
-        _keyDir->reset();
-        _valueCache->reset();
-        for (detail::DataFile* dfd : _dataFiles) delete dfd;
-        _dataFiles.clear();
-        _freeDataFileIds.clear();
-        _activeDataOffset        = 0;
-        _activeFlushedDataOffset = 0;
-        _activeDataFileId        = 0xFFFF;
-        _mergeWork.store(false);
-        _mergeExit.store(false);
-        _upkeepWork.store(false);
-        _upkeepExit.store(false);
-        _someHintFilesAreMissing           = false;
-        _upkeepLastActiveFlushedDataOffset = NotStored;
-        _upkeepLastActiveDataFileId        = 0xFFFF;
-        updateNow();
+    bool isUpkeepingOnGoing() const { return _upkeepWork.load(); }
 
-        lcVector<LoadedKeyChunk> keyDirEntries;
-        keyDirEntries.reserve(16384);
-        ArenaAllocator loadArena;
+    void upkeepThreadEntry()
+    {
+        using namespace litecask::detail;
 
-        // Loop on data files to load
-        for (const auto& baseDataFilename : baseDataFilenames) {
-            uint16_t fileId = getFreeDataFileIdUnlocked();
-            loadArena.reset();
-
-            // Check for hint file
-            if (!loadHintFile(baseDataFilename + HintFileSuffix, fileId, loadArena, keyDirEntries)) {
-                // Hint file failed or does not exist, let's load directly the data file
-                _someHintFilesAreMissing = true;
-                if (!loadDataFile(baseDataFilename + DataFileSuffix, fileId, loadArena, keyDirEntries)) {
-                    ++_stats.openCallFailedQty;
-                    log(LogLevel::Error, "'open' failed: unable to read the datastore.");
-                    return Status::CannotOpenStore;
-                }
+        // Upkeep service loop
+        while (!_upkeepExit.load()) {
+            // Wait for a upkeep period or explicit request
+            {
+                std::unique_lock<std::mutex> lk(_upkeepMutex);
+                _upkeepCv.wait_for(lk, std::chrono::milliseconds(_config.upkeepCyclePeriodMs),
+                                   [this] { return _upkeepExit.load() || _upkeepWork.load(); });
+                if (_upkeepExit.load()) continue;
+                _upkeepWork.store(false);
             }
 
-            // Create the data file descriptor
-            DataFile* newFd = _dataFiles[fileId];
-            newFd->filename = baseDataFilename + DataFileSuffix;
-            newFd->handle   = osOsOpen(newFd->filename, OsOpenMode::READ);
-            assert(osIsValidHandle(newFd->handle));
-            KeyChunk    entryToErase;
-            OldKeyChunk oldEntry;
-
-            // Populate the key directory
-            for (uint32_t entryIdx = 0; entryIdx < keyDirEntries.size(); ++entryIdx) {
-                const LoadedKeyChunk& entry   = keyDirEntries[entryIdx];
-                uint16_t              keySize = entry.metadata.keySize;
+            // Update the current date
+            updateNow();
 
-                if (entry.metadata.valueSize == DeletedEntry) {
-                    // Deletion case
-                    if (_keyDir->find(entry.keyHash, entry.key, entry.metadata.keySize, entryToErase)) {
-                        // As there is an entry in the KeyDir, a tombstone is required instead
-                        _dataFiles[entryToErase.fileId]->deadBytes +=
-                            sizeof(DataFileEntry) +
-                            ((entryToErase.valueSize == DeletedEntry) ? keySize : (keySize + entryToErase.valueSize));
-                        _dataFiles[entryToErase.fileId]->deadEntries += 1;
-                        _keyDir->insertEntry(entry.keyHash, entry.key, entry.keyIndexes, entry.metadata, oldEntry);
-                    } else {
-                        // No entry present in KeyDir, so no tombstone added there
-                        newFd->deadBytes += sizeof(DataFileEntry) + keySize;
-                        newFd->deadEntries += 1;
+            // Write buffer flushing
+            uint64_t timeMs =
+                std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+            if (timeMs - _upkeepLastActiveFlushedTimeMs > _config.writeBufferFlushPeriodMs) {
+                for (WriteLane* lane : _writeLanes) {
+                    lane->mxActiveFile.lock();
+                    _mxDataFiles.lockRead();
+                    lane->mxWriteBuffer.lockWrite();
+
+                    // Flush only if no flush was performed since last check, and if there is something to flush
+                    if (lane->activeFlushedDataOffset == lane->upkeepLastActiveFlushedDataOffset &&
+                        lane->activeDataFileId == lane->upkeepLastActiveDataFileId &&
+                        lane->activeDataOffset - lane->activeFlushedDataOffset > 0) {
+                        flushWriteBufferUnlocked(*lane);
                     }
-                    newFd->tombBytes += (uint32_t)sizeof(DataFileEntry) + keySize;
-                    newFd->tombEntries += 1;
-                    newFd->bytes += (uint32_t)sizeof(DataFileEntry) + keySize;
-                    newFd->entries += 1;
+                    lane->upkeepLastActiveDataFileId        = lane->activeDataFileId;
+                    lane->upkeepLastActiveFlushedDataOffset = lane->activeFlushedDataOffset;
+                    lane->mxWriteBuffer.unlockWrite();
+                    _mxDataFiles.unlockRead();
+                    lane->mxActiveFile.unlock();
                 }
+                _upkeepLastActiveFlushedTimeMs = timeMs;
+            }
 
-                else if (entry.metadata.expTimeSec == 0 || entry.metadata.expTimeSec > _nowTimeSec) {
-                    // Value case
-                    if (_keyDir->insertEntry(entry.keyHash, entry.key, entry.keyIndexes, entry.metadata, oldEntry) == Status::Ok &&
-                        oldEntry.isValid) {
-                        // Replace an entry: update file descriptors
-                        _dataFiles[oldEntry.fileId]->deadBytes +=
-                            sizeof(DataFileEntry) + ((oldEntry.valueSize == DeletedEntry) ? keySize : (keySize + oldEntry.valueSize));
-                        _dataFiles[oldEntry.fileId]->deadEntries += 1;
+            // First priority: resize the key directory
+            if (_keyDir->isResizingOngoing()) {
+                log(LogLevel::Debug, "Resizing KeyDir in upkeep thread under work");
+                for (uint32_t shardIdx = 0; shardIdx < detail::KeyDirShardQty; ++shardIdx) {
+                    detail::KeyDirShard& shard = _keyDir->getShard(shardIdx);
+                    while (shard.map.isResizingOngoing()) {
+                        // Transfer one batch of entries at a time
+                        shard.mx.lock();
+                        shard.map.backgroundResizeWork(_config.upkeepKeyDirBatchSize);
+                        shard.mx.unlock();
+                        // Give air to writer threads
+                        std::this_thread::yield();
                     }
-                    newFd->bytes += (uint32_t)sizeof(DataFileEntry) + keySize + entry.metadata.valueSize;
-                    newFd->entries += 1;
                 }
+                log(LogLevel::Debug, "Resizing KeyDir in upkeep thread finished");
+            }
 
-                else {
-                    // Expired TTL case
-                    newFd->deadBytes += (uint32_t)sizeof(DataFileEntry) + keySize + entry.metadata.valueSize;
-                    newFd->deadEntries += 1;
-                    newFd->bytes += (uint32_t)sizeof(DataFileEntry) + keySize + entry.metadata.valueSize;
-                    newFd->entries += 1;
-                }
+            // Free the retired tables of the key directory whose lock-free readers are gone
+            for (uint32_t shardIdx = 0; shardIdx < detail::KeyDirShardQty; ++shardIdx) {
+                detail::KeyDirShard& shard = _keyDir->getShard(shardIdx);
+                if (shard.map.getRetiredTableQty() == 0) { continue; }
+                shard.mx.lock();
+                shard.map.reclaimRetiredTables();
+                shard.mx.unlock();
             }
-        }
 
-        // Finalize
-        createNewActiveDataFileUnlocked();
-        _mergeThread   = std::thread(&Datastore::mergeThreadEntry, this);
-        _upkeepThread  = std::thread(&Datastore::upkeepThreadEntry, this);
-        _isInitialized = true;
-        ++_stats.openCallQty;
-        log(LogLevel::Info, "Datastore successfully opened");
-        return Status::Ok;
+            // Second priority: Value cache upkeeping
+            _valueCache->backgroundUpdateLru(_config.upkeepValueCacheBatchSize);
+            _valueCache->backgroundPreventiveEviction(_config.upkeepValueCacheBatchSize);  // Ensures a free margin
+
+            // Third priority: cleaning of entries with expired TTL
+            cleanExpiredEntries(_config.upkeepValueCacheBatchSize);
+
+        }  // End of service loop
     }
 
-    Status close()
+    // Invalidates the entries whose TTL expired, as scheduled in the expiry wheels. The batch is shared among the KeyDir shards
+    void cleanExpiredEntries(uint32_t batchSize)
     {
         using namespace litecask::detail;
+        lcVector<ExpiredEntry> expiredEntries;
 
-        if (!_isInitialized) {
-            ++_stats.closeCallFailedQty;
-            log(LogLevel::Error, "'close' failed: %s", toString(Status::StoreNotOpen));
-            return Status::StoreNotOpen;
+        for (uint32_t shardIdx = 0; shardIdx < KeyDirShardQty; ++shardIdx) {
+            KeyDirShard& shard          = _keyDir->getShard(shardIdx);
+            uint32_t     shardBatchSize = std::max(batchSize / KeyDirShardQty, 1U);
+            uint32_t     processedQty   = 0;
+            do {
+                expiredEntries.clear();
+                shard.mx.lock();
+                processedQty = shard.map.backgroundExpiredKeyCleaning(shardBatchSize, expiredEntries);
+                shard.mx.unlock();
+
+                for (const ExpiredEntry& e : expiredEntries) {
+                    // Remove the (potential) old value from the value cache
+                    if (e.cacheLocation != NotStored && _valueCache->isEnabled()) { _valueCache->removeValue(e.cacheLocation, e.keyHash); }
+                }
+                if (!expiredEntries.empty()) {
+                    // Update the data file statistics
+                    _mxDataFiles.lockRead();
+                    for (const ExpiredEntry& e : expiredEntries) {
+                        _dataFiles[e.fileId]->deadBytes += (uint32_t)sizeof(DataFileEntry) + e.valueSize + e.keySize;
+                        _dataFiles[e.fileId]->deadEntries += 1;
+                    }
+                    _mxDataFiles.unlockRead();
+                    _stats.ttlExpiredEntryQty += expiredEntries.size();
+                }
+                // Give air to writer threads
+                std::this_thread::yield();
+            } while (processedQty == shardBatchSize && !_upkeepExit.load());
         }
-        log(LogLevel::Info, "Closing datastore");
+    }
 
-        // Stop the maintenance threads
-        {
-            std::unique_lock<std::mutex> lk(_mergeMutex);
-            _mergeExit.store(true);
-            _mergeCv.notify_one();
-        }
-        {
-            std::unique_lock<std::mutex> lk(_upkeepMutex);
-            _upkeepExit.store(true);
-            _upkeepCv.notify_one();
-        }
-        _mergeThread.join();
-        _upkeepThread.join();
-        _mergeExit.store(false);
-        _upkeepExit.store(false);
+    void mergeThreadEntry()
+    {
+        using namespace litecask::detail;
+        log(LogLevel::Debug, "Merge thread started");
 
-        // Lock the database and make it uninitialized
-        _mxActiveFile.lock();
-        _mxDataFiles.lockWrite();
-        _mxKeyDir.lock();
-        _isInitialized = false;
+        // Merge service loop
+        while (!_mergeExit.load()) {
+            {
+                // Wait for a merge period or explicit request
+                std::unique_lock<std::mutex> lk(_mergeMutex);
+                _mergeCv.wait_for(lk, std::chrono::milliseconds(_config.mergeCyclePeriodMs),
+                                  [this] { return _mergeExit.load() || _mergeWork.load(); });
+                if (_mergeExit.load()) continue;
+            }
 
-        // Clean the data file
-        _mxWriteBuffer.lockWrite();
-        flushWriteBufferUnlocked();
-        _mxWriteBuffer.unlockWrite();
-        for (auto* dfd : _dataFiles) {
-            if (osIsValidHandle(dfd->handle)) {
-                osOsClose(dfd->handle);
-                dfd->handle = InvalidFileHandle;
+            log(LogLevel::Debug, "Merge process started");
+
+            // Snapshot the protected configuration
+            _mxConfig.lock();
+            Config c = _config;
+            _mxConfig.unlock();
+            ++_stats.mergeCycleQty;
+
+            // Analyze the data files to select which ones to merge, if any
+            lcVector<MergeFileInfo> mergeInfos;
+            if (isItWorthMerging(c.mergeTriggerDataFileFragmentationPercentage, c.mergeTriggerDataFileDeadByteThreshold)) {
+                selectDataFilesToMerge(c.mergeSelectDataFileFragmentationPercentage, c.mergeSelectDataFileDeadByteThreshold,
+                                       c.mergeSelectDataFileSmallSizeTheshold, c.changeLogRetainedDataFileQty, mergeInfos);
             }
-            delete dfd;
-        }
-        _dataFiles.clear();
-        _logHandler(LogLevel::Info, "closing", true);
 
-        // Resetting all fields
-        _activeDataOffset        = 0;
-        _activeDataFileId        = 0;
-        _activeFlushedDataOffset = 0;
+            if (!mergeInfos.empty()) {
+                // Mandatory switch of the active file for the following reasons:
+                //  - it ensures that the previous active file can be merged, as it was potentially selected
+                //  - it ensures that the naming of the new compacted data files is unique
+                // With several write lanes, all active files are switched and the merged files are named after the oldest of them
+                lcString mergeBasename;
+                for (WriteLane* lane : _writeLanes) {
+                    lane->mxActiveFile.lock();
+                    lcString lastBasename = createNewActiveDataFileUnlocked(*lane);
+                    lane->mxActiveFile.unlock();
+                    if (mergeBasename.empty()) { mergeBasename = lastBasename; }
+                }
 
-        unlockDatabase(_directory);
+                // Create the new compacted data files from the selected files
+                _mergeThrottle.reset(c.mergeMaxBytesPerSec);
+                createMergedDataFiles(mergeInfos, mergeBasename, c.dataFileMaxBytes, c.mergeWorkerQty);
 
-        // Reset the state
-        _directory.clear();
+                // Add the new data files, remove the old ones, and update the memory KeyDir
+                replaceDataFiles(mergeInfos);
+                removeObsoleteBlobFiles(mergeInfos);
 
-        _mxKeyDir.unlock();
-        _mxDataFiles.unlockWrite();
-        _mxActiveFile.unlock();
-        ++_stats.closeCallQty;
-        return Status::Ok;
+                ++_stats.mergeCycleWithMergeQty;
+            }
+
+            if (_someHintFilesAreMissing) {
+                // This flag is set once at database opening, so this section will be run once too
+                _someHintFilesAreMissing = false;
+                for (uint32_t fileId = 0; fileId < _dataFiles.size(); ++fileId) {
+                    if (isActiveDataFileUnlocked((uint16_t)fileId)) continue;
+                    const DataFile* dfd          = _dataFiles[fileId];
+                    fs::path        hintFilename = fs::path(dfd->filename).replace_extension(HintFileSuffix);
+                    if (osIsValidHandle(dfd->handle) && !fs::exists(hintFilename)) {
+                        log(LogLevel::Debug, "Merge thread started");
+                        createHintFile(dfd->filename, hintFilename);
+                    }
+                    ++_stats.hintFileCreatedQty;
+                }
+            }
+
+            _mergeWork.store(false);  // Work finished
+        }                             // End of service loop
+
+        log(LogLevel::Debug, "Merge thread stopped");
     }
 
-    // Access API: put, remove, get
+    // Offline maintenance
     // ==========================================================================================
 
-    Status put(const void* key, size_t keySize, const void* value, size_t valueSize, const lcVector<KeyIndex>& keyIndexes = {},
-               uint32_t ttlSec = 0, bool forceDiskSync = false)
+    // Locks and cleans the datastore as at opening, and provides its ordered data files
+    Status startOfflineOperation(fs::path dbDirectoryPath, lcVector<lcString>& baseDataFilenames)
     {
         using namespace litecask::detail;
+        if (_isInitialized) { return Status::StoreAlreadyOpen; }
 
-        if (keySize == 0 || keySize >= USHRT_MAX) {
-            ++_stats.putCallFailedQty;
-            return Status::BadKeySize;
+        std::error_code ec;
+        dbDirectoryPath /= "";
+        if (!fs::exists(dbDirectoryPath) || !fs::is_directory(dbDirectoryPath, ec)) { return Status::CannotOpenStore; }
+        Status s = lockDatabase(dbDirectoryPath);
+        if (s != Status::Ok) { return s; }
+
+        _directory         = dbDirectoryPath;
+        uint64_t maxBlobId = 0;
+        s                  = sanitizeAndCollectDataFiles(dbDirectoryPath, _maxDataFileIndex, maxBlobId, baseDataFilenames);
+        if (s == Status::Ok && baseDataFilenames.empty()) { s = Status::CannotOpenStore; }
+        if (s != Status::Ok) {
+            log(LogLevel::Error, "Offline operation failed: unable to collect the data files, %s.", toString(s));
+            stopOfflineOperation();
+            return s;
         }
-        if (keyIndexes.size() > MaxKeyIndexQty) {
-            ++_stats.putCallFailedQty;
-            return Status::InconsistentKeyIndex;
+        updateNow();
+        return Status::Ok;
+    }
+
+    void stopOfflineOperation()
+    {
+        unlockDatabase(_directory);
+        _logHandler(LogLevel::Info, "closing", true);
+        _directory.clear();
+    }
+
+    // The jobs are distributed on the worker threads, while the calling thread notifies the progress
+    void runOfflineWorkers(uint32_t workerQty, uint32_t jobQty, const std::function<void(uint32_t)>& job, const char* step,
+                           const std::atomic<uint64_t>& processedBytes, uint64_t totalBytes, const OfflineProgress& progress)
+    {
+        using namespace litecask::detail;
+        workerQty = std::max(1U, std::min(workerQty, jobQty));
+        std::atomic<uint32_t>   nextJobIdx{0};
+        std::mutex              doneMutex;
+        std::condition_variable doneCv;
+        uint32_t                doneWorkerQty = 0;
+
+        lcVector<std::thread> threads;
+        for (uint32_t i = 0; i < workerQty; ++i) {
+            threads.emplace_back([&]() {
+                for (uint32_t jobIdx = nextJobIdx++; jobIdx < jobQty; jobIdx = nextJobIdx++) { job(jobIdx); }
+                std::lock_guard<std::mutex> lk(doneMutex);
+                ++doneWorkerQty;
+                doneCv.notify_one();
+            });
         }
-        KeyIndex lastIdx{0, 0};
-        for (const KeyIndex& ki : keyIndexes) {
-            if (ki.size == 0 || ki.startIdx + ki.size > keySize) {
-                ++_stats.putCallFailedQty;
-                return Status::InconsistentKeyIndex;
+        {
+            std::unique_lock<std::mutex> lk(doneMutex);
+            while (!doneCv.wait_for(lk, std::chrono::milliseconds(OfflineProgressPeriodMs), [&] { return doneWorkerQty == workerQty; })) {
+                if (progress) { progress(step, processedBytes.load(), totalBytes); }
+            }
+        }
+        for (std::thread& t : threads) { t.join(); }
+        if (progress) { progress(step, processedBytes.load(), totalBytes); }
+    }
+
+    // All the data files are verified in parallel. With 'withEntries', the mappings are kept and the valid entries are collected
+    void verifyDataFilesOffline(const lcVector<lcString>& baseDataFilenames, uint32_t workerQty, bool withEntries,
+                                lcVector<detail::OfflineFile>& files, OfflineReport& report, const OfflineProgress& progress)
+    {
+        using namespace litecask::detail;
+        files.clear();
+        files.resize(baseDataFilenames.size());
+        uint64_t totalBytes = 0;
+        for (const lcString& baseDataFilename : baseDataFilenames) {
+            totalBytes += (uint64_t)std::max(osGetFileSize(baseDataFilename + DataFileSuffix), (int64_t)0);
+        }
+
+        std::atomic<uint64_t> processedBytes{0};
+        runOfflineWorkers(
+            workerQty, (uint32_t)baseDataFilenames.size(),
+            [&](uint32_t fileIdx) {
+                verifyDataFileOffline(baseDataFilenames[fileIdx], fileIdx, withEntries, files[fileIdx], processedBytes);
+                if (!withEntries) { osUnmapFile(files[fileIdx].mapping); }
+            },
+            "Verifying", processedBytes, totalBytes, progress);
+
+        for (const OfflineFile& file : files) {
+            report.dataFileQty += file.report.dataFileQty;
+            report.dataBytes += file.report.dataBytes;
+            report.entryQty += file.report.entryQty;
+            report.tombEntryQty += file.report.tombEntryQty;
+            report.blobEntryQty += file.report.blobEntryQty;
+            report.unreadableFileQty += file.report.unreadableFileQty;
+            report.corruptedEntryQty += file.report.corruptedEntryQty;
+            report.truncatedFileQty += file.report.truncatedFileQty;
+            report.missingBlobQty += file.report.missingBlobQty;
+            report.corruptedBlobQty += file.report.corruptedBlobQty;
+            report.missingHintFileQty += file.report.missingHintFileQty;
+            report.badHintFileQty += file.report.badHintFileQty;
+        }
+    }
+
+    // The mapped data file is parsed sequentially, and a corrupted entry is skipped only if its sizes are consistent
+    void verifyDataFileOffline(const lcString& baseDataFilename, uint32_t fileIdx, bool withEntries, detail::OfflineFile& file,
+                               std::atomic<uint64_t>& processedBytes)
+    {
+        using namespace litecask::detail;
+        lcString       dataFilename = baseDataFilename + DataFileSuffix;
+        OfflineReport& report       = file.report;
+        report.dataFileQty          = 1;
+        if (!osMapFile(dataFilename, file.mapping)) {
+            log(LogLevel::Error, "Offline verification: unable to read the data file %s", dataFilename.c_str());
+            ++report.unreadableFileQty;
+            return;
+        }
+
+        const uint8_t*          data           = file.mapping.data;
+        const uint64_t          fileSize       = file.mapping.size;
+        uint64_t                fileOffset     = 0;
+        uint64_t                reportedOffset = 0;
+        lcVector<HintFileEntry> expectedHints;
+        report.dataBytes = fileSize;
+
+        while (fileOffset < fileSize) {
+            if (fileSize - fileOffset < sizeof(DataFileEntry)) {
+                ++report.truncatedFileQty;
+                break;
+            }
+            DataFileEntry header;
+            memcpy(&header, data + fileOffset, sizeof(DataFileEntry));
+            bool     isRemoval    = (header.valueSize == DeletedEntry);
+            uint32_t keySize      = header.keySize;
+            uint32_t keyIndexSize = isRemoval ? 0 : header.keyIndexSize;  // No key index shall be stored for tombstones
+            uint32_t valueSize    = isRemoval ? 0 : header.valueSize;
+            if (keySize == 0 || keyIndexSize > MaxKeyIndexQty * sizeof(KeyIndex) || (keyIndexSize & 0x1)) {
+                log(LogLevel::Error, "Offline verification: the data file %s has an entry with bad sizes at file offset %" PRIu64,
+                    dataFilename.c_str(), fileOffset);
+                ++report.corruptedEntryQty;
+                break;  // The next entries cannot be located
             }
-            if (ki.startIdx < lastIdx.startIdx || (ki.startIdx == lastIdx.startIdx && ki.size <= lastIdx.size)) {
-                ++_stats.putCallFailedQty;
-                return Status::UnorderedKeyIndex;
+            uint64_t entryBytes = sizeof(DataFileEntry) + keySize + keyIndexSize + valueSize;
+            if (entryBytes > fileSize - fileOffset) {
+                ++report.truncatedFileQty;
+                break;
             }
-            lastIdx = ki;
-        }
-        if (valueSize >= detail::MaxValueSize) {
-            ++_stats.putCallFailedQty;
-            return Status::BadValueSize;
-        }
 
-        uint64_t keyHash  = LITECASK_HASH_FUNC(key, keySize);
-        uint32_t checksum = (uint32_t)(keyHash ^ LITECASK_HASH_FUNC(value, valueSize));
+            const uint8_t* key       = data + fileOffset + sizeof(DataFileEntry);
+            const uint8_t* value     = key + keySize + keyIndexSize;
+            uint64_t       keyHash   = LITECASK_HASH_FUNC(key, keySize);
+            uint64_t       valueHash = isRemoval ? 0 : LITECASK_HASH_FUNC(value, valueSize);
+            ++report.entryQty;
+            if (header.checksum != (uint32_t)(keyHash ^ valueHash)) {
+                log(LogLevel::Error, "Offline verification: the data file %s has a corrupted entry (bad checksum) at file offset %" PRIu64,
+                    dataFilename.c_str(), fileOffset);
+                ++report.corruptedEntryQty;
+            } else {
+                if (isRemoval) {
+                    ++report.tombEntryQty;
+                } else if (header.flags & EntryFlagBlob) {
+                    ++report.blobEntryQty;
+                    verifyBlobFileOffline(value, valueSize, report);
+                }
+                if (withEntries) {
+                    file.entries.push_back({data + fileOffset, keyHash, fileIdx, (uint32_t)entryBytes, header.expTimeSec, (uint16_t)keySize,
+                                            header.flags, isRemoval});
+                }
+            }
+            expectedHints.push_back(
+                {(uint32_t)fileOffset, header.expTimeSec, header.valueSize, (uint16_t)keySize, (uint8_t)keyIndexSize, header.flags});
 
-        _mxActiveFile.lock();
-        if (!_isInitialized) {
-            _mxActiveFile.unlock();
-            ++_stats.putCallFailedQty;
-            return Status::StoreNotOpen;
+            fileOffset += entryBytes;
+            if (fileOffset - reportedOffset >= MergeCopyChunkBytes) {
+                processedBytes += fileOffset - reportedOffset;
+                reportedOffset = fileOffset;
+            }
         }
+        processedBytes += fileSize - reportedOffset;
 
-        // Check that the limit of the data file size is not exceeded (taking into account the 64 overflow)
-        // The only exception is if we are at the beginning of a new file, so that any entry size can fit the data file
-        if (_activeDataOffset > 0 &&
-            (uint64_t)_activeDataOffset + sizeof(DataFileEntry) + (uint64_t)keySize + (uint64_t)valueSize >= _dataFileMaxBytes) {
-            createNewActiveDataFileUnlocked();  // Now the entry can be written whatever its size (new file)
+        lcString hintFilename = baseDataFilename + HintFileSuffix;
+        if (osGetFileSize(hintFilename) <= 0) {
+            ++report.missingHintFileQty;
+        } else if (!isHintFileConsistentOffline(hintFilename, expectedHints)) {
+            log(LogLevel::Warn, "Offline verification: the hint file %s does not match its data file", hintFilename.c_str());
+            ++report.badHintFileQty;
         }
+    }
 
-        _mxDataFiles.lockRead();
-        lcOsFileHandle fh = _dataFiles[_activeDataFileId]->handle;
-        assert(osIsValidHandle(fh));
+    void verifyBlobFileOffline(const uint8_t* value, uint32_t valueSize, OfflineReport& report)
+    {
+        using namespace litecask::detail;
+        BlobRef blobRef;
+        if (valueSize != sizeof(BlobRef)) {
+            ++report.corruptedEntryQty;
+            return;
+        }
+        memcpy(&blobRef, value, sizeof(BlobRef));
+        lcString blobFilename = getBlobFilenameUnlocked(blobRef.blobId);
+        int64_t  fileSize     = osGetFileSize(blobFilename);
+        if (fileSize < 0) {
+            log(LogLevel::Error, "Offline verification: the blob file %s is missing", blobFilename.c_str());
+            ++report.missingBlobQty;
+            return;
+        }
 
-        // Write entry in the memory write buffer
-        _mxWriteBuffer.lockWrite();
-        size_t keyIndexSize = keyIndexes.size() * sizeof(KeyIndex);
-        if ((_activeDataOffset - _activeFlushedDataOffset) + (sizeof(DataFileEntry) + keySize + keyIndexSize + valueSize) >
-            _writeBuffer.size()) {
-            flushWriteBufferUnlocked();
+        // The blob file is read through the OS cache, as its content is accessed only once
+        MappedFile mapping;
+        bool       isOk = (fileSize == (int64_t)blobRef.valueSize && osMapFile(blobFilename, mapping) &&
+                     (uint32_t)LITECASK_HASH_FUNC(mapping.data, mapping.size) == blobRef.checksum);
+        osUnmapFile(mapping);
+        if (!isOk) {
+            log(LogLevel::Error, "Offline verification: the blob file %s is corrupted", blobFilename.c_str());
+            ++report.corruptedBlobQty;
         }
+    }
 
-        uint32_t      expTimeSec = (ttlSec == 0) ? 0 : ttlSec + _nowTimeSec;
-        DataFileEntry dfe{checksum, expTimeSec, (uint32_t)valueSize, (uint16_t)keySize, (uint8_t)keyIndexSize, 0};
-        uint32_t      entryActiveDataOffset = _activeDataOffset;
-        uint16_t      entryActiveDataFileId = _activeDataFileId;
-        assert(_activeDataOffset >= _activeFlushedDataOffset);
+    // A hint file shall describe exactly the entries of its data file, in the same order
+    static bool isHintFileConsistentOffline(const lcString& hintFilename, const lcVector<detail::HintFileEntry>& expectedHints)
+    {
+        using namespace litecask::detail;
+        MappedFile mapping;
+        if (!osMapFile(hintFilename, mapping)) { return false; }
+
+        size_t         offset = 0;
+        HintFileHeader fileHeader{};
+        if (mapping.size >= sizeof(HintFileHeader)) { memcpy(&fileHeader, mapping.data, sizeof(HintFileHeader)); }
+        if (fileHeader.magic == HintFileMagic) { offset = sizeof(HintFileHeader); }
+        bool isOk = (fileHeader.magic != HintFileMagic || fileHeader.entryQty == expectedHints.size());
+
+        for (size_t i = 0; isOk && i < expectedHints.size(); ++i) {
+            HintFileEntry hfe;
+            isOk = (mapping.size - offset >= sizeof(HintFileEntry));
+            if (!isOk) { break; }
+            memcpy(&hfe, mapping.data + offset, sizeof(HintFileEntry));
+            const HintFileEntry& e = expectedHints[i];
+            isOk = (hfe.fileOffset == e.fileOffset && hfe.expTimeSec == e.expTimeSec && hfe.valueSize == e.valueSize &&
+                    hfe.keySize == e.keySize && (e.valueSize == DeletedEntry || hfe.keyIndexSize == e.keyIndexSize) &&
+                    hfe.flags == e.flags);
+            offset += sizeof(HintFileEntry) + hfe.keySize + hfe.keyIndexSize;
+        }
+        isOk = isOk && (offset == mapping.size);
+        osUnmapFile(mapping);
+        return isOk;
+    }
 
-        if ((_activeDataOffset - _activeFlushedDataOffset) + (sizeof(DataFileEntry) + keySize + keyIndexSize + valueSize) <=
-            _writeBuffer.size()) {
-            // Store in the write buffer
-            uint32_t dataOffset = _activeDataOffset - _activeFlushedDataOffset;
-            memcpy(&_writeBuffer[dataOffset], &dfe, sizeof(DataFileEntry));
-            memcpy(&_writeBuffer[dataOffset + sizeof(DataFileEntry)], key, keySize);
-            if (keyIndexSize > 0) {
-                memcpy(&_writeBuffer[dataOffset + sizeof(DataFileEntry) + keySize], (uint8_t*)keyIndexes.data(), keyIndexSize);
-            }
-            if (valueSize > 0) { memcpy(&_writeBuffer[dataOffset + sizeof(DataFileEntry) + keySize + keyIndexSize], value, valueSize); }
+    Status privateCompactOffline(const fs::path& dbDirectory, uint32_t workerQty, OfflineReport& report, const OfflineProgress& progress)
+    {
+        using namespace litecask::detail;
+        lcVector<lcString> baseDataFilenames;
+        Status             status = startOfflineOperation(dbDirectory, baseDataFilenames);
+        if (status != Status::Ok) { return status; }
+
+        // Verification of all the entries. The data files stay mapped for the copy
+        lcVector<OfflineFile> files;
+        verifyDataFilesOffline(baseDataFilenames, workerQty, true, files, report, progress);
+        auto unmapFiles = [&files]() {
+            for (OfflineFile& file : files) { osUnmapFile(file.mapping); }
+        };
+        if (report.isCorrupted()) {
+            log(LogLevel::Error, "Offline compaction aborted: corruption detected, the datastore is unchanged.");
+            unmapFiles();
+            stopOfflineOperation();
+            return Status::EntryCorrupted;
+        }
 
-            // Update the active offset
-            _activeDataOffset += (uint32_t)(sizeof(DataFileEntry) + keySize + keyIndexSize + valueSize);
-            if (forceDiskSync) { flushWriteBufferUnlocked(); }
+        // Only the newest entry of each key is kept, in key hash order. Sorting also groups the entries of the same key
+        lcVector<OfflineEntry> entries;
+        entries.reserve(report.entryQty);
+        for (OfflineFile& file : files) {
+            entries.insert(entries.end(), file.entries.begin(), file.entries.end());
+            file.entries = {};
         }
+        auto compareKeys = [](const OfflineEntry& a, const OfflineEntry& b) {
+            if (a.keyHash != b.keyHash) { return (a.keyHash < b.keyHash) ? -1 : 1; }
+            if (a.keySize != b.keySize) { return (a.keySize < b.keySize) ? -1 : 1; }
+            return memcmp(a.entry + sizeof(DataFileEntry), b.entry + sizeof(DataFileEntry), a.keySize);
+        };
+        std::sort(entries.begin(), entries.end(), [&compareKeys](const OfflineEntry& a, const OfflineEntry& b) {
+            int keyOrder = compareKeys(a, b);
+            if (keyOrder != 0) { return keyOrder < 0; }
+            return (a.fileIdx != b.fileIdx) ? (a.fileIdx < b.fileIdx) : (a.entry < b.entry);  // Same file: same mapping
+        });
 
-        else {
-            // Too big entry: the write buffer has already been synced-flushed, so the entry is directly written in the file
-            assert(_activeDataOffset == _activeFlushedDataOffset);
-            if (!osOsWrite(fh, &dfe, sizeof(DataFileEntry)) || !osOsWrite(fh, key, keySize)) {
-                fatalHandler("Put: Unable to write the header and key (size=%" PRId64 ") in the datafile", keySize);
+        size_t             liveEntryQty = 0;
+        lcVector<uint64_t> liveBlobIds;
+        for (size_t i = 0; i < entries.size(); ++i) {
+            const OfflineEntry& e = entries[i];
+            if (i + 1 < entries.size() && compareKeys(e, entries[i + 1]) == 0) { continue; }  // Not the newest entry of this key
+            if (e.isRemoval || (e.expTimeSec != 0 && e.expTimeSec <= _nowTimeSec)) { continue; }
+            if (e.flags & EntryFlagBlob) {
+                BlobRef blobRef;
+                memcpy(&blobRef, e.entry + e.entryBytes - sizeof(BlobRef), sizeof(BlobRef));
+                liveBlobIds.push_back(blobRef.blobId);
             }
-            if (keyIndexSize > 0 && !osOsWrite(fh, (uint8_t*)keyIndexes.data(), keyIndexSize)) {
-                fatalHandler("Put: Unable to write the key indexes (size=%" PRId64 ") in the datafile", keyIndexSize);
+            entries[liveEntryQty++] = e;
+        }
+        entries.resize(liveEntryQty);
+        report.liveEntryQty    = liveEntryQty;
+        report.droppedEntryQty = report.entryQty - liveEntryQty;
+
+        // The live entries are split in output files, which are written in parallel. Their number is higher than the one of all
+        // existing data files, so that they win over the old entries after an interruption
+        struct OutputFile {
+            lcString basename;
+            size_t   firstEntryIdx = 0;
+            size_t   entryQty      = 0;
+            uint64_t bytes         = 0;
+            bool     isOk          = false;
+        };
+        lcVector<OutputFile> outputs;
+        uint64_t             outputBytes = 0;
+        for (size_t i = 0; i < entries.size(); ++i) {
+            if (outputs.empty() || (outputs.back().bytes + entries[i].entryBytes > _config.dataFileMaxBytes)) {
+                char basename[512];  // Note: the fractional number shall not be zero
+                snprintf(basename, sizeof(basename), "%s%" PRIu64 ".%05u", _directory.string().c_str(), _maxDataFileIndex + 1,
+                         (uint32_t)outputs.size() + 1);
+                outputs.push_back({basename, i, 0, 0, false});
             }
-            if (valueSize > 0 && !osOsWrite(fh, value, valueSize)) {
-                fatalHandler("Put: Unable to write the value (size=%" PRId64 ") in the datafile", valueSize);
+            outputs.back().entryQty += 1;
+            outputs.back().bytes += entries[i].entryBytes;
+            outputBytes += entries[i].entryBytes;
+        }
+
+        std::atomic<uint64_t> writtenBytes{0};
+        runOfflineWorkers(
+            workerQty, (uint32_t)outputs.size(),
+            [&](uint32_t outputIdx) {
+                OutputFile& out = outputs[outputIdx];
+                out.isOk        = writeCompactedDataFileOffline(out.basename, &entries[out.firstEntryIdx], out.entryQty, writtenBytes);
+            },
+            "Compacting", writtenBytes, outputBytes, progress);
+
+        bool isWriteOk = true;
+        for (const OutputFile& out : outputs) { isWriteOk = isWriteOk && out.isOk; }
+        if (!isWriteOk) {
+            log(LogLevel::Error, "Offline compaction aborted: unable to write the compacted files, the datastore is unchanged.");
+            for (const OutputFile& out : outputs) {
+                osRemoveFile(out.basename + DataFileSuffix + TmpFileSuffix);
+                osRemoveFile(out.basename + HintFileSuffix + TmpFileSuffix);
             }
+            unmapFiles();
+            stopOfflineOperation();
+            return Status::BadDiskAccess;
+        }
+        unmapFiles();
 
-            // Update the offsets (flush also) after this unoptimized write
-            _activeDataOffset += (uint32_t)(sizeof(DataFileEntry) + keySize + keyIndexSize + valueSize);
-            _activeFlushedDataOffset = _activeDataOffset;
+        // The compacted files are installed, then the old data files are removed from the oldest one. If interrupted, the remaining
+        // old data files are the newest ones, which are consistent with the compacted files
+        for (const OutputFile& out : outputs) {
+            if (!osRenameFile(out.basename + DataFileSuffix + TmpFileSuffix, out.basename + DataFileSuffix) ||
+                !osRenameFile(out.basename + HintFileSuffix + TmpFileSuffix, out.basename + HintFileSuffix)) {
+                log(LogLevel::Error, "Offline compaction failed: unable to rename the compacted file %s", out.basename.c_str());
+                stopOfflineOperation();
+                return Status::BadDiskAccess;
+            }
+        }
+        if (!osSyncDirectory(_directory)) {
+            log(LogLevel::Error, "Offline compaction failed: unable to sync the datastore directory, the old data files are kept");
+            stopOfflineOperation();
+            return Status::BadDiskAccess;
+        }
+        for (const lcString& baseDataFilename : baseDataFilenames) {
+            osRemoveFile(baseDataFilename + DataFileSuffix);
+            osRemoveFile(baseDataFilename + HintFileSuffix);
+        }
+
+        // The blob files which are not referenced by a live entry are removed
+        std::sort(liveBlobIds.begin(), liveBlobIds.end());
+        lcVector<DirEntry> dirEntries;
+        if (osGetDirContent(_directory, dirEntries)) {
+            for (const DirEntry& e : dirEntries) {
+                fs::path filename(e.name);
+                if (e.isDir || filename.extension() != BlobFileSuffix) { continue; }
+                uint64_t blobId = strtoull(filename.stem().string().c_str(), nullptr, 16);
+                if (!std::binary_search(liveBlobIds.begin(), liveBlobIds.end(), blobId) && osRemoveFile(_directory / e.name)) {
+                    ++report.removedBlobQty;
+                }
+            }
         }
 
-        _mxWriteBuffer.unlockWrite();
+        report.outputDataFileQty = outputs.size();
+        report.outputBytes       = outputBytes;
+        log(LogLevel::Info, "Offline compaction: %" PRIu64 " live entries written in %" PRIu64 " data files, %" PRIu64 " entries dropped",
+            report.liveEntryQty, report.outputDataFileQty, report.droppedEntryQty);
+        stopOfflineOperation();
+        return Status::Ok;
+    }
 
-        // Update active data file stats
-        _dataFiles[entryActiveDataFileId]->bytes += (uint32_t)(sizeof(DataFileEntry) + keySize + keyIndexSize + valueSize);
-        _dataFiles[entryActiveDataFileId]->entries += 1;
+    // The entries are copied as is, so that their checksum stays valid. The data and hint files are temporary until renamed
+    bool writeCompactedDataFileOffline(const lcString& basename, const detail::OfflineEntry* entries, size_t entryQty,
+                                       std::atomic<uint64_t>& writtenBytes)
+    {
+        using namespace litecask::detail;
+        lcOsFileHandle dataHandle = osOsOpen(basename + DataFileSuffix + TmpFileSuffix, OsOpenMode::WRITE);
+        FILE*          hintFh     = osFopen(basename + HintFileSuffix + TmpFileSuffix, "wb");
+        if (hintFh) { setvbuf(hintFh, nullptr, _IOFBF, MergeHintBufferBytes); }
+        bool isOk = (osIsValidHandle(dataHandle) && hintFh && writeHintFileHeader(hintFh, 0, 0));
+
+        lcVector<uint8_t> writeBuffer;
+        writeBuffer.reserve(MergeCopyChunkBytes);
+        auto flushWriteBuffer = [&]() {
+            isOk = isOk && osOsWrite(dataHandle, writeBuffer.data(), writeBuffer.size());
+            writtenBytes += writeBuffer.size();
+            writeBuffer.clear();
+        };
 
-        _mxDataFiles.unlockRead();
-        _mxActiveFile.unlock();
+        uint32_t fileOffset  = 0;
+        uint32_t keyIndexQty = 0;
+        for (size_t i = 0; isOk && i < entryQty; ++i) {
+            const OfflineEntry& e = entries[i];
+            DataFileEntry       header;
+            memcpy(&header, e.entry, sizeof(DataFileEntry));
+            HintFileEntry hfe{fileOffset, header.expTimeSec, header.valueSize, header.keySize, header.keyIndexSize, header.flags};
+            isOk = (fwrite(&hfe, sizeof(HintFileEntry), 1, hintFh) == 1 &&
+                    fwrite(e.entry + sizeof(DataFileEntry), 1, header.keySize + header.keyIndexSize, hintFh) ==
+                        (size_t)(header.keySize + header.keyIndexSize));
+
+            if (writeBuffer.size() + e.entryBytes > MergeCopyChunkBytes) { flushWriteBuffer(); }
+            if (e.entryBytes >= MergeCopyChunkBytes) {
+                isOk = isOk && osOsWrite(dataHandle, e.entry, e.entryBytes);
+                writtenBytes += e.entryBytes;
+            } else {
+                writeBuffer.insert(writeBuffer.end(), e.entry, e.entry + e.entryBytes);
+            }
+            fileOffset += e.entryBytes;
+            keyIndexQty += header.keyIndexSize / (uint32_t)sizeof(KeyIndex);
+        }
+        flushWriteBuffer();
 
-        // Push in cache
-        ValueLoc cacheLoc = NotStored;
-        if (_valueCache->isEnabled()) { cacheLoc = _valueCache->insertValue(value, (uint32_t)valueSize, keyHash, expTimeSec); }
+        // The old data files are removed afterwards, so the compacted data shall be on the disk
+        isOk = isOk && writeHintFileHeader(hintFh, (uint32_t)entryQty, keyIndexQty) && osFileSync(hintFh) && osOsSync(dataHandle);
+        if (hintFh && fclose(hintFh) != 0) { isOk = false; }
+        if (osIsValidHandle(dataHandle)) { osOsClose(dataHandle); }
+        return isOk;
+    }
 
-        // Update the KeyDir
-        OldKeyChunk oldEntry;
-        _mxKeyDir.lock();
-        Status storageStatus = _keyDir->insertEntry((uint32_t)keyHash, key, keyIndexes.data(),
-                                                    {expTimeSec, (uint32_t)valueSize, cacheLoc, entryActiveDataOffset,
-                                                     entryActiveDataFileId, (uint16_t)keySize, (uint8_t)keyIndexSize, (uint8_t)checksum},
-                                                    oldEntry);
-        _mxKeyDir.unlock();
+    // File cleaning before opening the data store. The cleaning instructions comes from the file extension.
+    // Robustness comes from the atomic nature of some file operations (creation and renaming)
+    Status sanitizeAndCollectDataFiles(const fs::path& dbDirectory, uint64_t& maxDataFileIndex, uint64_t& maxBlobId,
+                                       lcVector<lcString>& baseDataFilenames)
+    {
+        using namespace litecask::detail;
+        fs::path dbDirectoryPath = dbDirectory / "";
 
-        if (storageStatus != Status::Ok) {  // Can be too big a key (precise check done here) or out of memory
-            if (storageStatus == Status::OutOfMemory) {
-                // This error deserves a dedicated log message
-                // In this case, the run-time behavior of the database is compromised.
-                // The data files are however still correct and consistent, only the in-memory information is incomplete.
-                log(LogLevel::Error,
-                    "Unable to store the new key due to out of memory, the run-time integrity of the datastore is compromised (data files "
-                    "are ok). You should stop and relaunch the application to recover it. If not enough, using tools to perform a full "
-                    "merge on the data to make it more compact could help.");
+        baseDataFilenames.clear();
+        maxDataFileIndex = 1;
+        maxBlobId        = 0;
+        lcVector<DirEntry> entries;
+        if (!osGetDirContent(dbDirectoryPath, entries)) { return Status::CannotOpenStore; }
+
+        struct OrderedDataFiles {
+            lcString name;
+            double   index;
+        };
+        lcVector<OrderedDataFiles> orderedDataFiles;
+
+        for (const auto& e : entries) {
+            if (e.isDir) continue;
+            fs::path entryFilename = dbDirectoryPath / e.name;
+
+            // Remove ".tmp" files which correspond to an unfinished merge due to a crash
+            if (entryFilename.extension() == TmpFileSuffix) {
+                log(LogLevel::Info, "Removing unfinished merge file %s", entryFilename.c_str());
+                osRemoveFile(entryFilename);
             }
-            return storageStatus;
-        }
 
-        // Update the index map
-        int lastOldIdx = 0;
-        for (const KeyIndex& ki : keyIndexes) {
-            // Insert in the index map only if it is not present in the old list. Run time is O(N) as lists are sorted.
-            bool doAdd = !oldEntry.isValid;
-            if (!doAdd) {
-                while (lastOldIdx < oldEntry.keyIndexQty &&
-                       (oldEntry.keyIndexes[lastOldIdx].startIdx < ki.startIdx ||
-                        (oldEntry.keyIndexes[lastOldIdx].startIdx == ki.startIdx && oldEntry.keyIndexes[lastOldIdx].size < ki.size))) {
-                    ++lastOldIdx;
-                }
-                doAdd = (lastOldIdx >= oldEntry.keyIndexQty || oldEntry.keyIndexes[lastOldIdx].startIdx != ki.startIdx ||
-                         oldEntry.keyIndexes[lastOldIdx].size != ki.size);
+            // Remove ".to_remove" tag files and associated data files, which is a cleanup of redundant file not removed due to a crash
+            else if (entryFilename.extension() == ToRemoveFileSuffix) {
+                log(LogLevel::Info, "Removing old data file %s", entryFilename.replace_extension(DataFileSuffix).string().c_str());
+                // First the data file (if exists)
+                osRemoveFile(entryFilename.replace_extension(DataFileSuffix));
+                // then the hint file (if exists)
+                osRemoveFile(entryFilename.replace_extension(HintFileSuffix));
+                // and last the removal instruction
+                osRemoveFile(entryFilename.replace_extension(ToRemoveFileSuffix));
             }
-            if (doAdd) {
-                _mxIndexMap.lockWrite();
-                _indexMap->insertIndex((uint8_t*)key + ki.startIdx, ki.size, (uint32_t)keyHash);
-                _mxIndexMap.unlockWrite();
+
+            // Remove standalone hint files
+            else if (entryFilename.extension() == HintFileSuffix &&
+                     osGetFileSize(fs::path(entryFilename).replace_extension(DataFileSuffix)) <= 0) {
+                osRemoveFile(entryFilename);
             }
-        }
 
-        // Update case?
-        if (oldEntry.isValid) {
-            // Remove the old entry from the cache
-            if (oldEntry.cacheLocation != NotStored && _valueCache->isEnabled()) {
-                _valueCache->removeValue(oldEntry.cacheLocation, keyHash);
+            // Remove zero sized data files
+            else if (entryFilename.extension() == DataFileSuffix && osGetFileSize(entryFilename) == 0) {
+                log(LogLevel::Info, "Removing zero size data file %s", entryFilename.c_str());
+                osRemoveFile(entryFilename);
             }
 
-            // Update "old" file descriptor statistics for proper maintenance
-            _mxDataFiles.lockRead();
-            _dataFiles[oldEntry.fileId]->deadBytes += (uint32_t)(sizeof(DataFileEntry) + keySize + keyIndexSize +
-                                                                 ((oldEntry.valueSize == DeletedEntry) ? 0 : oldEntry.valueSize));
-            _dataFiles[oldEntry.fileId]->deadEntries += 1;
-            _mxDataFiles.unlockRead();
+            // List the data files
+            else if (entryFilename.extension() == DataFileSuffix) {
+                // Get the data file number as "double" (decimals created by merge process), as their order matters
+                double fileNumber = strtod(entryFilename.stem().string().c_str(), nullptr);
+                if (fileNumber > 0.) {
+                    // Store the data file basename in the list
+                    orderedDataFiles.push_back({entryFilename.replace_extension("").string(), fileNumber});
+                    // Get the highest file number
+                    if ((uint64_t)fileNumber > maxDataFileIndex) { maxDataFileIndex = (uint64_t)fileNumber; }
+                }
+            }
+
+            // Get the highest blob identifier, so that the new blob files never overwrite an existing one
+            else if (entryFilename.extension() == BlobFileSuffix) {
+                uint64_t blobId = strtoull(entryFilename.stem().string().c_str(), nullptr, 16);
+                if (blobId > maxBlobId) { maxBlobId = blobId; }
+            }
         }
 
-        ++_stats.putCallQty;
+        // Fill the output list of ordered data files (oldest data files first)
+        std::sort(orderedDataFiles.begin(), orderedDataFiles.end(),
+                  [](const OrderedDataFiles& a, const OrderedDataFiles& b) { return a.index < b.index; });
+        baseDataFilenames.reserve(orderedDataFiles.size());
+        for (const auto& e : orderedDataFiles) baseDataFilenames.push_back(e.name);
+
         return Status::Ok;
     }
 
-    // Variant 1: key as vector
-    Status put(const lcVector<uint8_t>& key, const void* value, size_t valueSize, const lcVector<KeyIndex>& keyIndexes = {},
-               uint32_t ttlSec = 0, bool forceDiskSync = false)
+    // Per-thread buffer for the direct I/O of the blob files, aligned as required
+    static uint8_t* getBlobIoBuffer()
     {
-        return put(key.data(), key.size(), value, valueSize, keyIndexes, ttlSec, forceDiskSync);
+        using namespace litecask::detail;
+        thread_local static lcVector<uint8_t> blobIoBuffer(BlobIoChunkBytes + BlobIoAlignment);
+        return (uint8_t*)(((uintptr_t)blobIoBuffer.data() + BlobIoAlignment - 1) & ~(uintptr_t)(BlobIoAlignment - 1));
     }
 
-    // Variant 2: key as string
-    Status put(const lcString& key, const void* value, size_t valueSize, const lcVector<KeyIndex>& keyIndexes = {}, uint32_t ttlSec = 0,
-               bool forceDiskSync = false)
+    // The value is written by aligned chunks, the last one padded with zeros, then the file is truncated to the exact value size
+    static bool writeBlobFile(const lcString& blobFilename, const uint8_t* value, size_t valueSize, bool withOsSync)
     {
-        return put(key.data(), key.size(), value, valueSize, keyIndexes, ttlSec, forceDiskSync);
+        using namespace litecask::detail;
+        lcOsFileHandle fh = osBlobOpen(blobFilename, OsOpenMode::WRITE);
+        if (!osIsValidHandle(fh)) { return false; }
+
+        uint8_t* buffer = getBlobIoBuffer();
+        bool     isOk   = true;
+        for (size_t offset = 0; isOk && offset < valueSize; offset += BlobIoChunkBytes) {
+            size_t chunkBytes  = std::min(valueSize - offset, BlobIoChunkBytes);
+            size_t paddedBytes = (chunkBytes + BlobIoAlignment - 1) & ~(BlobIoAlignment - 1);
+            memcpy(buffer, value + offset, chunkBytes);
+            memset(buffer + chunkBytes, 0, paddedBytes - chunkBytes);
+            isOk = osBlobWrite(fh, buffer, paddedBytes, offset);
+        }
+        isOk = isOk && osBlobTruncate(fh, valueSize) && (!withOsSync || osOsSync(fh));
+        osOsClose(fh);
+        return isOk;
     }
 
-    // Variant 3: key as vector and value as vector
-    Status put(const lcVector<uint8_t>& key, const lcVector<uint8_t>& value, const lcVector<KeyIndex>& keyIndexes = {}, uint32_t ttlSec = 0,
-               bool forceDiskSync = false)
+    // Returns Status::EntryNotFound if the blob file does not exist, and Status::EntryCorrupted if it is too short
+    static Status readBlobFile(const lcString& blobFilename, uint8_t* value, size_t valueSize)
     {
-        return put(key.data(), key.size(), value.data(), value.size(), keyIndexes, ttlSec, forceDiskSync);
+        using namespace litecask::detail;
+        lcOsFileHandle fh = osBlobOpen(blobFilename, OsOpenMode::READ);
+        if (!osIsValidHandle(fh)) { return Status::EntryNotFound; }
+
+        uint8_t* buffer = getBlobIoBuffer();
+        bool     isOk   = true;
+        for (size_t offset = 0; isOk && offset < valueSize; offset += BlobIoChunkBytes) {
+            size_t chunkBytes  = std::min(valueSize - offset, BlobIoChunkBytes);
+            size_t paddedBytes = (chunkBytes + BlobIoAlignment - 1) & ~(BlobIoAlignment - 1);
+            isOk               = (osBlobRead(fh, buffer, paddedBytes, offset) >= (int64_t)chunkBytes);
+            if (isOk) { memcpy(value + offset, buffer, chunkBytes); }
+        }
+        osOsClose(fh);
+        return isOk ? Status::Ok : Status::EntryCorrupted;
     }
 
-    // Variant 4: key as string and value as vector
-    Status put(const lcString& key, const lcVector<uint8_t>& value, const lcVector<KeyIndex>& keyIndexes = {}, uint32_t ttlSec = 0,
-               bool forceDiskSync = false)
+    // The header is written first with null totals, then rewritten with the final totals before closing the file
+    static bool writeHintFileHeader(FILE* fh, uint32_t entryQty, uint32_t keyIndexQty)
     {
-        return put(key.data(), key.size(), value.data(), value.size(), keyIndexes, ttlSec, forceDiskSync);
+        detail::HintFileHeader header{detail::HintFileMagic, entryQty, keyIndexQty, 0};
+        return (fseek(fh, 0, SEEK_SET) == 0 && fwrite(&header, sizeof(detail::HintFileHeader), 1, fh) == 1);
     }
 
-    Status remove(const void* key, size_t keySize, bool forceDiskSync = false)
+    static bool readHintFileHeader(const lcString& hintFilename, detail::HintFileHeader& header)
     {
-        using namespace litecask::detail;
-        if (keySize == 0 || keySize >= USHRT_MAX) {
-            ++_stats.removeCallFailedQty;
-            return Status::BadKeySize;
-        }
-
-        uint64_t keyHash  = LITECASK_HASH_FUNC(key, keySize);
-        uint32_t checksum = (uint32_t)keyHash;
-
-        _mxActiveFile.lock();
-        if (!_isInitialized) {
-            _mxActiveFile.unlock();
-            ++_stats.removeCallFailedQty;
-            return Status::StoreNotOpen;
-        }
-
-        // Optional, but keeps the database cleaner in case of false removal
-        KeyChunk entry;
-        bool     isFound = _keyDir->find((uint32_t)keyHash, key, (uint16_t)keySize, entry);
-        if (!isFound || entry.valueSize == DeletedEntry) {
-            _mxActiveFile.unlock();
-            ++_stats.removeCallNotFoundQty;
-            return Status::EntryNotFound;
-        }
-
-        // Check that the limit of the data file size is not exceeded (taking into account the 64 overflow)
-        // The only exception is if we are at the beginning of a new file, so that any entry size can fit the data file
-        if (_activeDataOffset > 0 && (uint64_t)_activeDataOffset + sizeof(DataFileEntry) + (uint64_t)keySize >= _dataFileMaxBytes) {
-            createNewActiveDataFileUnlocked();  // Now the "removal" entry can be written
-        }
-
-        _mxDataFiles.lockRead();
-        lcOsFileHandle fh = _dataFiles[_activeDataFileId]->handle;
-        assert(osIsValidHandle(fh));
-
-        // Write entry in the memory write buffer
-        _mxWriteBuffer.lockWrite();
-        if ((_activeDataOffset - _activeFlushedDataOffset) + (sizeof(DataFileEntry) + keySize) > _writeBuffer.size()) {
-            flushWriteBufferUnlocked();  // After that, the write must succeed by design (write buffer big enough for 1 entry)
-        }
-
-        // Note: tombstone's keyIndexes are not stored on disk, but we need to keep the previous indexes in memory for the
-        //  following use case: remove an entry with indexes, then add it again with some identical indexes: we do not want doubles inside
-        //  index arrays
-        DataFileEntry dfe{checksum, 0, DeletedEntry, (uint16_t)keySize, 0, 0};
-        uint32_t      entryActiveDataOffset = _activeDataOffset;
-        uint16_t      entryActiveDataFileId = _activeDataFileId;
-        assert(_activeDataOffset >= _activeFlushedDataOffset);
-
-        if ((_activeDataOffset - _activeFlushedDataOffset) + (sizeof(DataFileEntry) + keySize) <= _writeBuffer.size()) {
-            // Store in the write buffer
-            uint32_t dataOffset = _activeDataOffset - _activeFlushedDataOffset;
-            memcpy(&_writeBuffer[dataOffset], &dfe, sizeof(DataFileEntry));
-            memcpy(&_writeBuffer[dataOffset + sizeof(DataFileEntry)], key, keySize);
+        FILE* fh = osFopen(hintFilename, "rb");
+        if (!fh) { return false; }
+        bool isOk = (fread(&header, sizeof(detail::HintFileHeader), 1, fh) == 1 && header.magic == detail::HintFileMagic);
+        fclose(fh);
+        return isOk;
+    }
 
-            // Update the active offset
-            _activeDataOffset += (uint32_t)(sizeof(DataFileEntry) + keySize);
-            if (forceDiskSync) { flushWriteBufferUnlocked(); }
-        }
+    bool createHintFile(const lcString& readDataFilename, const fs::path& writeHintFilename)
+    {
+        using namespace litecask::detail;
+        log(LogLevel::Info, "Creating hint file for %s", readDataFilename.c_str());
 
-        else {
-            // Too big entry: the write buffer has already been synced-flushed, and we directly write in the file
-            if (!osOsWrite(fh, &dfe, sizeof(DataFileEntry)) || !osOsWrite(fh, key, keySize)) {
-                fatalHandler("Remove: Unable to write the header and key (size=%" PRId64 ") in the datafile", keySize);
-            }
+        // We use fopen/fread/fwrite here because of standard usage and the provided buffering
+        FILE* fhr = osFopen(readDataFilename, "rb");
+        assert(fhr);
+        FILE* fhw = osFopen(writeHintFilename.string() + TmpFileSuffix, "wb");
+        assert(fhw);
 
-            // Update the offsets (flush also) after this unoptimized write
-            _activeDataOffset += (uint32_t)(sizeof(DataFileEntry) + keySize);
-            _activeFlushedDataOffset = _activeDataOffset;
+        DataFileEntry     header;
+        lcVector<uint8_t> buf(1024);
+        bool              isOk          = true;
+        uint32_t          fileOffset    = 0;
+        uint32_t          fileIncrement = 0;
+        uint32_t          entryQty      = 0;
+        uint32_t          keyIndexQty   = 0;
+        if (!writeHintFileHeader(fhw, 0, 0)) {
+            log(LogLevel::Error, "Cannot create the hint file for %s: unable to write the header", readDataFilename.c_str());
+            isOk = false;
         }
 
-        _mxWriteBuffer.unlockWrite();
+        while (isOk && fread(&header, sizeof(DataFileEntry), 1, fhr) == 1) {
+            uint32_t keySize      = header.keySize;
+            uint32_t keyIndexSize = header.keyIndexSize;
+            uint32_t valueSize    = header.valueSize;
 
-        _dataFiles[entryActiveDataFileId]->tombBytes += (uint32_t)(sizeof(DataFileEntry) + keySize);
-        _dataFiles[entryActiveDataFileId]->tombEntries += 1;
-        _dataFiles[entryActiveDataFileId]->bytes += (uint32_t)(sizeof(DataFileEntry) + keySize);
-        _dataFiles[entryActiveDataFileId]->entries += 1;
+            if (keySize == 0) {
+                log(LogLevel::Error, "Cannot create the hint file for %s: a key in the data file has a null (=corrupted) size",
+                    readDataFilename.c_str());
+                isOk = false;
+                break;
+            }
 
-        _mxDataFiles.unlockRead();
-        _mxActiveFile.unlock();
+            if (keyIndexSize > MaxKeyIndexQty * sizeof(KeyIndex)) {
+                log(LogLevel::Error, "Cannot create the hint file for %s: a key has too big index (byte size=%d > %" PRId64 ")",
+                    readDataFilename.c_str(), keyIndexSize, MaxKeyIndexQty * sizeof(KeyIndex));
+                break;
+            }
 
-        // Update the KeyDir with a tombstone
-        _mxKeyDir.lock();
-        OldKeyChunk oldEntry;
-        Status      storageStatus = _keyDir->insertEntry(
-                 (uint32_t)keyHash, key, nullptr,
-                 {0, DeletedEntry, NotStored, entryActiveDataOffset, entryActiveDataFileId, (uint16_t)keySize, 0, 0}, oldEntry);
-        _mxKeyDir.unlock();
+            if (valueSize == DeletedEntry) {
+                // Tombstone case (no key index stored)
+                if (buf.size() < keySize) buf.resize(keySize);
+                if (fread(buf.data(), 1, keySize, fhr) != keySize) {
+                    log(LogLevel::Error,
+                        "Cannot create the hint file for %s: unable to read all the bytes (%d) of the deleted key at file offset %u",
+                        readDataFilename.c_str(), keySize, fileOffset);
+                    isOk = false;
+                    break;
+                }
+                keyIndexSize  = 0;
+                fileIncrement = sizeof(DataFileEntry) + keySize;
+            }
 
-        if (storageStatus != Status::Ok) {
-            if (storageStatus == Status::OutOfMemory) {
-                // This error deserves a dedicated log message
-                // In this case, the run-time behavior of the database is compromised.
-                // The data files are however still correct and consistent, only the in-memory information is incomplete.
-                log(LogLevel::Error,
-                    "Unable to store the new key due to out of memory, the run-time integrity of the datastore is compromised (data files "
-                    "are  ok). You should stop and relaunch the application to recover it. If not enough, using tools to perform a full "
-                    "merge on the data to make it more compact could help.");
+            else {
+                uint32_t allSize = keySize + keyIndexSize + valueSize;
+                if (buf.size() < allSize) buf.resize(allSize);
+                if (fread(buf.data(), 1, allSize, fhr) != allSize) {
+                    log(LogLevel::Error,
+                        "Cannot create the hint file for %s: unable to read all the bytes (%d) of the key and value at file offset %u",
+                        readDataFilename.c_str(), allSize, fileOffset);
+                    isOk = false;
+                    break;
+                }
+                fileIncrement = (uint32_t)sizeof(DataFileEntry) + allSize;
             }
-            return storageStatus;
-        }
 
-        // Remove the (potential) old value from the value cache
-        if (oldEntry.isValid && oldEntry.cacheLocation != NotStored && _valueCache->isEnabled()) {
-            _valueCache->removeValue(oldEntry.cacheLocation, keyHash);
+            HintFileEntry hfe{fileOffset, header.expTimeSec, valueSize, (uint16_t)keySize, (uint8_t)keyIndexSize, header.flags};
+            if (fwrite(&hfe, sizeof(HintFileEntry), 1, fhw) != 1 ||
+                fwrite(buf.data(), 1, keySize + keyIndexSize, fhw) != keySize + keyIndexSize) {
+                log(LogLevel::Error, "Cannot create the hint file for %s: unable to write the hint entry (size=%" PRId64 ")",
+                    readDataFilename.c_str(), sizeof(HintFileEntry) + keySize + keyIndexSize);
+                isOk = false;
+                break;
+            }
+
+            fileOffset += fileIncrement;
+            entryQty += 1;
+            keyIndexQty += keyIndexSize / (uint32_t)sizeof(KeyIndex);
         }
 
-        if (oldEntry.isValid) {
-            _mxDataFiles.lockRead();
-            _dataFiles[oldEntry.fileId]->deadBytes += (uint32_t)(sizeof(DataFileEntry) + oldEntry.valueSize + keySize);
-            _dataFiles[oldEntry.fileId]->deadEntries += 1;
-            _mxDataFiles.unlockRead();
+        if (isOk && (!writeHintFileHeader(fhw, entryQty, keyIndexQty) || !syncHintFile(fhw))) {
+            log(LogLevel::Error, "Cannot create the hint file for %s: unable to write the header", readDataFilename.c_str());
+            isOk = false;
         }
+        fclose(fhw);
+        fclose(fhr);
 
-        ++_stats.removeCallQty;
-        return Status::Ok;
+        if (isOk) {
+            [[maybe_unused]] bool isRenamingOk = osRenameFile(writeHintFilename.string() + TmpFileSuffix, writeHintFilename);
+            assert(isRenamingOk);
+            if (_syncPolicy != SyncPolicy::None) { syncDirectory(); }
+        }
+        return isOk;
     }
 
-    // Variant 1: key as vector
-    Status remove(const lcVector<uint8_t>& key, bool forceDiskSync = false) { return remove(key.data(), key.size(), forceDiskSync); }
-
-    // Variant 2: key as string
-    Status remove(const lcString& key, bool forceDiskSync = false) { return remove(key.data(), key.size(), forceDiskSync); }
-
-    Status get(const void* key, size_t keySize, lcVector<uint8_t>& value)
+    // The hint file is memory mapped and parsed in place: the loaded key and index pointers refer to this mapping, which shall be kept
+    // until the entries are inserted in the KeyDir
+    bool loadHintFile(const lcString& hintFilename, uint16_t fileId, MappedFile& hintMapping, lcVector<detail::LoadedKeyChunk>& keyEntries)
     {
         using namespace litecask::detail;
+        log(LogLevel::Debug, "Loading hint file %s", hintFilename.c_str());
 
-        if (keySize == 0 || keySize >= USHRT_MAX) {  // Key size is anyway limited by 16 bits minus some meta data overhead
-            ++_stats.getCallFailedQty;
-            return Status::BadKeySize;
-        }
+        keyEntries.clear();
+        osUnmapFile(hintMapping);
+        if (!osMapFile(hintFilename, hintMapping)) { return false; }
+        uint8_t* buf      = (uint8_t*)hintMapping.data;  // Read-only, the non-const pointer is required by the loaded structure
+        size_t   readSize = hintMapping.size;
 
-        // Look in the KeyDir
-        uint64_t keyHash = LITECASK_HASH_FUNC(key, keySize);
+        HintFileEntry header;
+        bool          isOk       = true;
+        size_t        readOffset = 0;
 
-        _mxDataFiles.lockRead();
-        if (!_isInitialized) {
-            _mxDataFiles.unlockRead();
-            ++_stats.getCallFailedQty;
-            return Status::StoreNotOpen;
+        // Header (absent in hint files from previous versions)
+        HintFileHeader fileHeader;
+        bool           hasHeader = false;
+        if (readSize >= sizeof(HintFileHeader)) {
+            memcpy(&fileHeader, buf, sizeof(HintFileHeader));
+            if (fileHeader.magic == HintFileMagic) {
+                hasHeader  = true;
+                readOffset = sizeof(HintFileHeader);
+                keyEntries.reserve(fileHeader.entryQty);
+            }
         }
 
-        KeyChunk entry{0, 0, 0, 0, 0, 0, 0, 0};
-        bool     isFound = _keyDir->find((uint32_t)keyHash, key, (uint16_t)keySize, entry);
-
-        if (!isFound || entry.valueSize == DeletedEntry) {
-            _mxDataFiles.unlockRead();
-            ++_stats.getCallNotFoundQty;
-            return Status::EntryNotFound;
-        }
-        assert(entry.fileId < _dataFiles.size());
+        while (isOk && readOffset + sizeof(HintFileEntry) < readSize) {
+            // Copy due to uncontrolled alignment
+            memcpy(&header, &buf[readOffset], sizeof(HintFileEntry));
 
-        // Check the write buffer
-        if (entry.fileId == _activeDataFileId) {  // If it is different, it cannot be equal afterwards. And we avoid a lock on main path
-            _mxWriteBuffer.lockRead();
-            if (entry.fileId == _activeDataFileId && entry.fileOffset >= _activeFlushedDataOffset &&
-                entry.fileOffset - _activeFlushedDataOffset < _writeBuffer.size()) {
-                value.resize(entry.valueSize);
-                memcpy(value.data(),
-                       &_writeBuffer[entry.fileOffset - _activeFlushedDataOffset + sizeof(DataFileEntry) + keySize + entry.keyIndexSize],
-                       entry.valueSize);
-                _mxWriteBuffer.unlockRead();
-                _mxDataFiles.unlockRead();
-                ++_stats.getCallQty;
-                ++_stats.getWriteBufferHitQty;
-                return Status::Ok;
+            // Parse the header
+            if (header.keySize == 0) {
+                log(LogLevel::Error, "Cannot load the hint file %s: a key has a null (=corrupted) size", hintFilename.c_str());
+                isOk = false;
+                break;
             }
-            _mxWriteBuffer.unlockRead();
-        }
 
-        // Check the cache
-        if (_valueCache->isEnabled()) {
-            bool isInTheCache = _valueCache->getValue(entry.cacheLocation, keyHash, entry.valueSize, value);
-            if (isInTheCache) {
-                _mxDataFiles.unlockRead();
-                ++_stats.getCallQty;
-                ++_stats.getCacheHitQty;
-                return Status::Ok;
+            if (header.keyIndexSize > MaxKeyIndexQty * sizeof(KeyIndex)) {
+                log(LogLevel::Error, "Cannot read the hint file %s: an index has a too big value (byte size=%d > %" PRId64 ")",
+                    hintFilename.c_str(), header.keyIndexSize, MaxKeyIndexQty * sizeof(KeyIndex));
+                isOk = false;
+                break;
             }
-        }
 
-        // Load the value
-        value.resize(sizeof(DataFileEntry) + keySize + entry.keyIndexSize + entry.valueSize);
-
-        DataFile*      dfd = _dataFiles[entry.fileId];
-        lcOsFileHandle fh  = dfd->handle;
-        assert(osIsValidHandle(fh));
-        bool isReadOk =
-            osOsRead(fh, value.data(), sizeof(DataFileEntry) + keySize + entry.keyIndexSize + entry.valueSize, entry.fileOffset);
-        _mxDataFiles.unlockRead();
+            if (header.keyIndexSize & 0x1) {
+                log(LogLevel::Error, "Cannot read the hint file %s: an index has an odd size (byte size=%d)", hintFilename.c_str(),
+                    header.keyIndexSize);
+                break;
+            }
 
-        size_t valueStartOffset = (uint32_t)sizeof(DataFileEntry) + keySize + entry.keyIndexSize;
+            size_t entrySize = sizeof(HintFileEntry) + (int)header.keySize + (int)header.keyIndexSize;
+            if (readOffset + entrySize > readSize) {
+                log(LogLevel::Warn, "The hint file %s is corrupted", hintFilename.c_str());
+                break;  // End of file reached (and corrupted last entry)
+            }
+            uint8_t* key        = &buf[readOffset + sizeof(HintFileEntry)];
+            uint64_t keyHash    = LITECASK_HASH_FUNC(key, header.keySize);
+            uint8_t* keyIndexes = key + header.keySize;
 
-        // Check the value consistency. Read errors are caught here too
-        uint32_t checksum = (uint32_t)(keyHash ^ LITECASK_HASH_FUNC(&value[valueStartOffset], entry.valueSize));
-        if (!isReadOk || checksum != ((DataFileEntry*)value.data())->checksum) {
-            ++_stats.getCallCorruptedQty;
-            return Status::EntryCorrupted;
+            // Note: the key and keyIndexes pointers are persistent in the mapping (until it is unmapped)
+            // The changeCounter initialized with the readOffset is to provide some spreading for the initial value
+            keyEntries.push_back({{header.expTimeSec, header.valueSize, NotStored, header.fileOffset, fileId, header.keySize,
+                                   header.keyIndexSize, (uint8_t)readOffset, header.flags},
+                                  (uint32_t)keyHash,
+                                  key,
+                                  keyIndexes});
+            readOffset += entrySize;
         }
 
-        // Remove the offset due to the metadata (cannot avoid memmove with a generic container as output...)
-        memmove(value.data(), &value[valueStartOffset], entry.valueSize);
-        value.resize(entry.valueSize);
+        // A truncated hint file would silently lose the last entries of the data file, which is then loaded instead
+        if (isOk && hasHeader && keyEntries.size() != fileHeader.entryQty) {
+            log(LogLevel::Warn, "The hint file %s is incomplete (%" PRId64 " entries instead of %u), the data file is loaded instead",
+                hintFilename.c_str(), keyEntries.size(), fileHeader.entryQty);
+            keyEntries.clear();
+            isOk = false;
+        }
+        return isOk;
+    }
 
-        if (_valueCache->isEnabled()) {
-            // Store the value in the cache
-            ValueLoc cacheLoc = _valueCache->insertValue(value.data(), entry.valueSize, keyHash, entry.expTimeSec);
+    // Output adapters for the 'get' variants:
+    //   'accept' is called first with the value size and returns false if the value cannot be output
+    //   'copyFrom' outputs a value located in the write buffer or in the value cache
+    //   'getReadBuffer' provides the buffer where the value is read from the disk, and 'commitRead' outputs it after checking
+    struct VectorValueSink {
+        lcVector<uint8_t>& value;
+        bool               accept(uint32_t /*valueSize*/) { return true; }
+        void               copyFrom(const uint8_t* src, uint32_t valueSize)
+        {
+            value.resize(valueSize);
+            if (valueSize > 0) { memcpy(value.data(), src, valueSize); }
+        }
+        uint8_t* getReadBuffer(uint32_t valueSize)
+        {
+            value.resize(valueSize);
+            return value.data();
+        }
+        void commitRead(const uint8_t* /*buffer*/, uint32_t /*valueSize*/) {}
+        bool delegateDiskRead(const void* /*key*/, size_t /*keySize*/, uint64_t /*keyHash*/, const detail::KeyChunk& /*entry*/)
+        {
+            return false;
+        }
+    };
 
-            // The change counter avoids the ABA problem between the entry insertion above and the cache update here
-            // If valueSize or changeCounter do not match, the cache entry is wasted but it will be later evicted anyway
-            _mxKeyDir.lock();
-            _keyDir->updateCachedValueLocation((uint32_t)keyHash, key, (uint16_t)keySize, entry.valueSize, entry.changeCounter, cacheLoc);
-            _mxKeyDir.unlock();
+    struct BufferValueSink {
+        uint8_t* buffer;
+        size_t   bufferSize;
+        size_t&  outValueSize;
+        bool     accept(uint32_t valueSize)
+        {
+            outValueSize = valueSize;
+            return valueSize <= bufferSize;
+        }
+        void copyFrom(const uint8_t* src, uint32_t valueSize)
+        {
+            if (valueSize > 0) { memcpy(buffer, src, valueSize); }
+        }
+        uint8_t* getReadBuffer(uint32_t /*valueSize*/) { return buffer; }
+        void     commitRead(const uint8_t* /*buffer*/, uint32_t /*valueSize*/) {}
+        bool     delegateDiskRead(const void* /*key*/, size_t /*keySize*/, uint64_t /*keyHash*/, const detail::KeyChunk& /*entry*/)
+        {
+            return false;
         }
+    };
 
-        ++_stats.getCallQty;
-        return Status::Ok;
-    }
+    struct VisitorValueSink {
+        const std::function<void(const uint8_t*, size_t)>& visitor;
+        bool                                               accept(uint32_t /*valueSize*/) { return true; }
+        void                                               copyFrom(const uint8_t* src, uint32_t valueSize) { visitor(src, valueSize); }
+        uint8_t*                                           getReadBuffer(uint32_t valueSize)
+        {
+            thread_local static lcVector<uint8_t> readBuffer;
+            if (readBuffer.size() < valueSize) { readBuffer.resize(valueSize); }
+            return readBuffer.data();
+        }
+        void commitRead(const uint8_t* buffer, uint32_t valueSize) { visitor(buffer, valueSize); }
+        bool delegateDiskRead(const void* /*key*/, size_t /*keySize*/, uint64_t /*keyHash*/, const detail::KeyChunk& /*entry*/)
+        {
+            return false;
+        }
+    };
 
-    // Get variant 1: key as vector
-    Status get(const lcVector<uint8_t>& key, lcVector<uint8_t>& value) { return get(key.data(), key.size(), value); }
+    // Receives the reference of a value stored in a blob file
+    struct BlobRefSink {
+        detail::BlobRef blobRef{0, 0, 0};
+        bool            accept(uint32_t valueSize) { return valueSize == sizeof(detail::BlobRef); }
+        void            copyFrom(const uint8_t* src, uint32_t valueSize) { memcpy(&blobRef, src, valueSize); }
+        uint8_t*        getReadBuffer(uint32_t /*valueSize*/) { return (uint8_t*)&blobRef; }
+        void            commitRead(const uint8_t* /*buffer*/, uint32_t /*valueSize*/) {}
+        bool            delegateDiskRead(const void* /*key*/, size_t /*keySize*/, uint64_t /*keyHash*/, const detail::KeyChunk& /*entry*/)
+        {
+            return false;
+        }
+    };
 
-    // Get variant 2: key as string
-    Status get(const lcString& key, lcVector<uint8_t>& value) { return get(key.data(), key.size(), value); }
+    // The disk reads are delegated to the asynchronous reader, if available. Other values are output after the 'get' call
+    struct AsyncValueSink {
+        Datastore*                                                 store;
+        const std::function<void(Status, const lcVector<uint8_t>&)>& callback;
+        lcVector<uint8_t>                                          value;
+        bool                                                       isDelegated = false;
+        bool                                                       accept(uint32_t /*valueSize*/) { return true; }
+        void copyFrom(const uint8_t* src, uint32_t valueSize) { value.assign(src, src + valueSize); }
+        uint8_t* getReadBuffer(uint32_t valueSize)
+        {
+            value.resize(valueSize);
+            return value.data();
+        }
+        void commitRead(const uint8_t* /*buffer*/, uint32_t /*valueSize*/) {}
+        bool delegateDiskRead([[maybe_unused]] const void* key, [[maybe_unused]] size_t keySize, [[maybe_unused]] uint64_t keyHash,
+                              [[maybe_unused]] const detail::KeyChunk& entry)
+        {
+#if LITECASK_IO_URING_ENABLED
+            isDelegated = store->submitAsyncGet(key, keySize, keyHash, entry, callback);
+#endif
+            return isDelegated;
+        }
+    };
 
-    // Query variant 1: single key part as vector
-    Status query(const lcVector<uint8_t>& keyPart, lcVector<lcVector<uint8_t>>& matchingKeys)
-    {
-        return privateQuery<lcVector<uint8_t>, lcVector<uint8_t>>({keyPart}, matchingKeys);
-    }
+#if LITECASK_IO_URING_ENABLED
+    struct AsyncGetRequest {
+        detail::AsyncReader::Request                          read;
+        lcVector<uint8_t>                                     key;
+        uint64_t                                              keyHash;
+        detail::KeyChunk                                      entry;
+        detail::DataFile*                                     dataFile;
+        lcVector<uint8_t>                                     header;
+        lcVector<uint8_t>                                     value;
+        std::function<void(Status, const lcVector<uint8_t>&)> callback;
+    };
 
-    // Query variant 2: single key part as string
-    Status query(const lcString& keyPart, lcVector<lcVector<uint8_t>>& matchingKeys)
+    // The data file lock shall be taken by the caller, as the file handle is used
+    bool submitAsyncGet(const void* key, size_t keySize, uint64_t keyHash, const detail::KeyChunk& entry,
+                        const std::function<void(Status, const lcVector<uint8_t>&)>& callback)
     {
-        return privateQuery<lcString, lcVector<uint8_t>>({keyPart}, matchingKeys);
-    }
+        using namespace litecask::detail;
+        if (!_asyncReader.isStarted()) { return false; }
+
+        AsyncGetRequest* req = new AsyncGetRequest;
+        req->key.assign((const uint8_t*)key, (const uint8_t*)key + keySize);
+        req->keyHash  = keyHash;
+        req->entry    = entry;
+        req->dataFile = _dataFiles[entry.fileId];
+        req->callback = callback;
+        req->header.resize(sizeof(DataFileEntry) + keySize + entry.keyIndexSize);
+        req->value.resize(entry.valueSize);
+        req->read.handle       = req->dataFile->handle;
+        req->read.fileOffset   = entry.fileOffset;
+        req->read.iov[0]       = {req->header.data(), req->header.size()};
+        req->read.iov[1]       = {req->value.data(), req->value.size()};
+        req->read.iovQty       = 2;
+        req->read.onCompletion = [this, req](bool isReadOk) {
+            if (!req->read.isSubmitFailed) { completeAsyncGet(req, isReadOk); }  // Else the caller reads synchronously
+        };
 
-    // Query variant 3: multiple key part as vector of vector
-    Status query(const lcVector<lcVector<uint8_t>>& keyParts, lcVector<lcVector<uint8_t>>& matchingKeys)
-    {
-        return privateQuery<lcVector<uint8_t>, lcVector<uint8_t>>(keyParts, matchingKeys);
+        pinDataFileUnlocked(req->dataFile);
+        AsyncReader::Request* readReq = &req->read;
+        if (!_asyncReader.submit(&readReq, 1)) {
+            unpinDataFile(req->dataFile);
+            delete req;
+            return false;
+        }
+        return true;
     }
 
-    // Query variant 4: key part as vector of string
-    Status query(const lcVector<lcString>& keyParts, lcVector<lcVector<uint8_t>>& matchingKeys)
+    // Called from the asynchronous reader thread
+    void completeAsyncGet(AsyncGetRequest* req, bool isReadOk)
     {
-        return privateQuery<lcString, lcVector<uint8_t>>(keyParts, matchingKeys);
-    }
+        using namespace litecask::detail;
+        unpinDataFile(req->dataFile);  // The file handle is no more used
 
-    // Query variant 5: single key part as vector, with arena allocator for output array of keys
-    Status query(const lcVector<uint8_t>& keyPart, lcVector<QueryResult>& arenaMatchingKeys, ArenaAllocator& allocator)
-    {
-        return privateQuery<lcVector<uint8_t>, QueryResult>({keyPart}, arenaMatchingKeys, &allocator);
-    }
+        // Check the value consistency. Read errors are caught here too
+        DataFileEntry header;
+        memcpy(&header, req->header.data(), sizeof(DataFileEntry));
+        uint32_t checksum = (uint32_t)(req->keyHash ^ LITECASK_HASH_FUNC(req->value.data(), req->entry.valueSize));
+        if (!isReadOk || checksum != header.checksum) {
+            ++_stats.getCallCorruptedQty;
+            req->callback(Status::EntryCorrupted, lcVector<uint8_t>{});
+            delete req;
+            return;
+        }
+        if (isStoredKeyMismatch(req->header.data() + sizeof(DataFileEntry), req->key.data(), req->key.size())) {
+            ++_stats.getCallNotFoundQty;
+            req->callback(Status::EntryNotFound, lcVector<uint8_t>{});
+            delete req;
+            return;
+        }
 
-    // Query variant 6: single key part as string, with arena allocator for output array of keys
-    Status query(const lcString& keyPart, lcVector<QueryResult>& arenaMatchingKeys, ArenaAllocator& allocator)
-    {
-        return privateQuery<lcString, QueryResult>({keyPart}, arenaMatchingKeys, &allocator);
-    }
+        if (_valueCache->isEnabled()) {
+            ValueLoc cacheLoc = _valueCache->insertValue(req->value.data(), req->entry.valueSize, req->keyHash, req->entry.expTimeSec);
+            std::mutex& mxKeyDirShard = _keyDir->getMutex((uint32_t)req->keyHash);
+            mxKeyDirShard.lock();
+            _keyDir->updateCachedValueLocation((uint32_t)req->keyHash, req->key.data(), (uint16_t)req->key.size(), req->entry.valueSize,
+                                               req->entry.changeCounter, cacheLoc);
+            mxKeyDirShard.unlock();
+        }
 
-    // Query variant 7: multiple key parts as vector, with arena allocator for output array of keys
-    Status query(const lcVector<lcVector<uint8_t>>& keyParts, lcVector<QueryResult>& arenaMatchingKeys, ArenaAllocator& allocator)
-    {
-        return privateQuery<lcVector<uint8_t>, QueryResult>(keyParts, arenaMatchingKeys, &allocator);
+        ++_stats.getCallQty;
+        ++_stats.getAsyncDiskReadQty;
+        req->callback(Status::Ok, req->value);
+        delete req;
     }
+#endif
 
-    // Query variant 8: multiple key parts as string, with arena allocator for output array of keys
-    Status query(const lcVector<lcString>& keyParts, lcVector<QueryResult>& arenaMatchingKeys, ArenaAllocator& allocator)
+    // A data file is pinned while its handle is used outside of the data file lock, for instance to sync it or to read it
+    // asynchronously. The pin shall be taken under the data file lock, and closing the handle waits until the file is unpinned
+    static void pinDataFileUnlocked(detail::DataFile* dfd) { ++dfd->pinQty; }
+
+    // Waits until a data file is unpinned, before closing its handle. The data file lock shall be taken
+    void waitForUnpinnedUnlocked(const detail::DataFile* dfd) const
     {
-        return privateQuery<lcString, QueryResult>(keyParts, arenaMatchingKeys, &allocator);
+        if (dfd->pinQty.load() == 0) { return; }
+        std::unique_lock<std::mutex> lk(_pinMutex);
+        _pinCv.wait(lk, [dfd] { return dfd->pinQty.load() == 0; });
     }
 
-    void sync()
+    // Ends a use of the handle of a data file, and wakes up the thread waiting to close it, if any
+    void unpinDataFile(detail::DataFile* dfd)
     {
-        _mxWriteBuffer.lockWrite();
-        flushWriteBufferUnlocked();
-        _mxWriteBuffer.unlockWrite();
+        if (--dfd->pinQty == 0) {
+            std::lock_guard<std::mutex> lk(_pinMutex);
+            _pinCv.notify_all();
+        }
     }
 
-    bool requestMerge()
+    // Outputs a value from its stored form, which is decompressed if needed. The output size of a compressed value is checked here
+    template<typename ValueSink>
+    Status outputStoredValue(ValueSink& sink, const uint8_t* storedValue, uint32_t storedSize, uint8_t entryFlags)
     {
-        std::unique_lock<std::mutex> lk(_mergeMutex);
-        if (_isInitialized && _mergeWork.load() == false) {
-            _mergeWork.store(true);
-            _mergeCv.notify_one();
-            return true;
+        if ((entryFlags & detail::EntryFlagCompressed) == 0) {
+            sink.copyFrom(storedValue, storedSize);
+            return Status::Ok;
         }
-        return false;
+        uint32_t rawSize = 0;
+        if (storedSize < sizeof(uint32_t)) { return Status::EntryCorrupted; }
+        memcpy(&rawSize, storedValue, sizeof(uint32_t));
+        if (!sink.accept(rawSize)) { return Status::BufferTooSmall; }
+        uint8_t* rawValue = sink.getReadBuffer(rawSize);
+        if (!_valueCodec.decompress(storedValue + sizeof(uint32_t), storedSize - sizeof(uint32_t), rawValue, rawSize)) {
+            return Status::EntryCorrupted;
+        }
+        sink.commitRead(rawValue, rawSize);
+        return Status::Ok;
     }
 
-    bool isMergeOnGoing() const { return _mergeWork.load(); }
+    // The data file lock shall be taken by the caller, as the directory is used
+    lcString getBlobFilenameUnlocked(uint64_t blobId) const
+    {
+        char blobFilename[512];
+        snprintf(blobFilename, sizeof(blobFilename), "%s%016" PRIx64 "%s", _directory.string().c_str(), blobId, detail::BlobFileSuffix);
+        return blobFilename;
+    }
 
-    // Use carefully...
-    static void erasePermanentlyAllContent_UseWithCaution(fs::path dbDirectoryPath)
+    // Writes a value in a new blob file and provides its reference. The blob file is written under a temporary name, so that a
+    // partially written blob file is removed at the next opening in case of crash
+    Status writeBlobValue(const void* value, size_t valueSize, bool withOsSync, detail::BlobRef& blobRef)
     {
         using namespace litecask::detail;
-        dbDirectoryPath /= "";
-        lcVector<DirEntry> entries;
-        if (!osGetDirContent(dbDirectoryPath, entries)) return;
-
-        for (const auto& e : entries) {
-            if (e.isDir || e.name.empty()) continue;
-            fs::path filename(e.name);
+        _mxDataFiles.lockRead();
+        if (!_isInitialized) {
+            _mxDataFiles.unlockRead();
+            return Status::StoreNotOpen;
+        }
+        blobRef.blobId        = _nextBlobId++;
+        lcString blobFilename = getBlobFilenameUnlocked(blobRef.blobId);
+        _mxDataFiles.unlockRead();
 
-            if (filename.extension() == DataFileSuffix) {
-                osRemoveFile(dbDirectoryPath / e.name);
-                continue;
-            }
-            if (filename.extension() == HintFileSuffix) {
-                osRemoveFile(dbDirectoryPath / e.name);
-                continue;
-            }
-            if (filename.extension() == TmpFileSuffix) {
-                osRemoveFile(dbDirectoryPath / e.name);
-                continue;
-            }
-            if (filename.extension() == ToRemoveFileSuffix) {
-                osRemoveFile(dbDirectoryPath / e.name);
-                continue;
-            }
-            if (filename.extension() == LogFileSuffix) {
-                osRemoveFile(dbDirectoryPath / e.name);
-                continue;
-            }
+        blobRef.valueSize = (uint32_t)valueSize;
+        blobRef.checksum  = (uint32_t)LITECASK_HASH_FUNC(value, valueSize);
+        if (!writeBlobFile(blobFilename + TmpFileSuffix, (const uint8_t*)value, valueSize, withOsSync) ||
+            !osRenameFile(blobFilename + TmpFileSuffix, blobFilename)) {
+            log(LogLevel::Error, "Unable to write the blob file %s", blobFilename.c_str());
+            osRemoveFile(blobFilename + TmpFileSuffix);
+            return Status::BadDiskAccess;
         }
+        if (withOsSync) { syncDirectory(); }  // The synced blob file shall not vanish with its directory entry
+        ++_stats.blobWriteQty;
+        return Status::Ok;
     }
 
-#ifndef LITECASK_BUILD_FOR_TEST  // Allows looking inside the datastore internal, for testing purposes
-   private:
-#endif
-
-    // Internal data file management
-    // ==========================================================================================
-
-    // Returns the basename of the last active data file (not the new one but the just closed one)
-    // The "active file" lock must be taken before the call
-    lcString createNewActiveDataFileUnlocked()
+    // Outputs a value from its blob file. No lock shall be taken by the caller, as the value may be big.
+    // Status::EntryNotFound is returned if the blob file has been removed, which means that the entry has been replaced meanwhile
+    template<typename ValueSink>
+    Status readBlobValue(ValueSink& sink, const detail::BlobRef& blobRef)
     {
         using namespace litecask::detail;
+        if (!sink.accept(blobRef.valueSize)) { return Status::BufferTooSmall; }
+        uint8_t* value = sink.getReadBuffer(blobRef.valueSize);
 
-        // Set the name of the previous active data file (used as an in-order basename for merged data files)
-        char tmpFilename[256];
-        snprintf(tmpFilename, 256, "%s%" PRId64 "", _directory.string().c_str(), _maxDataFileIndex);
-        lcString lastActiveBaseDataFilename = tmpFilename;
-
-        // The data file structure is modified
-        _mxDataFiles.lockWrite();
-        _mxWriteBuffer.lockWrite();
+        _mxDataFiles.lockRead();
+        lcString blobFilename = getBlobFilenameUnlocked(blobRef.blobId);
+        _mxDataFiles.unlockRead();
 
-        if (_activeDataFileId < _dataFiles.size()) {
-            // Close previous active file, which was writable
-            flushWriteBufferUnlocked();
-            DataFile* dfd = _dataFiles[_activeDataFileId];
-            assert(osIsValidHandle(dfd->handle));
-            osOsClose(dfd->handle);
+        uint64_t readStartNs = _latency.start();
+        Status   status      = readBlobFile(blobFilename, value, blobRef.valueSize);
+        _latency.record(LatencyKind::GetDiskRead, readStartNs);
+        if (status != Status::Ok) { return status; }
+        ++_stats.blobReadQty;
+        if ((uint32_t)LITECASK_HASH_FUNC(value, blobRef.valueSize) != blobRef.checksum) { return Status::EntryCorrupted; }
+        sink.commitRead(value, blobRef.valueSize);
+        return Status::Ok;
+    }
 
-            // Reopen it in read-only mode
-            dfd->handle = osOsOpen(dfd->filename, OsOpenMode::READ);
-            assert(osIsValidHandle(dfd->handle));
+    Status countFailedGet(Status status)
+    {
+        if (status == Status::EntryCorrupted) {
+            ++_stats.getCallCorruptedQty;
+        } else {
+            ++_stats.getCallFailedQty;
         }
+        return status;
+    }
 
-        // Open a new data file in append + read mode
-        _activeDataOffset        = 0;
-        _activeFlushedDataOffset = 0;
-        _activeDataFileId        = getFreeDataFileIdUnlocked();
-        _mxWriteBuffer.unlockWrite();
-
-        DataFile* newFd = _dataFiles[_activeDataFileId];
-        snprintf(tmpFilename, 256, "%s%" PRId64 "%s", _directory.string().c_str(), ++_maxDataFileIndex, DataFileSuffix);
-        newFd->filename = tmpFilename;
-        newFd->handle   = osOsOpen(newFd->filename, OsOpenMode::APPEND);
-        assert(osIsValidHandle(newFd->handle));
-
-        _mxDataFiles.unlockWrite();
-
-        log(LogLevel::Debug, "Creating new active data file %s", tmpFilename);
-        ++_stats.activeDataFileSwitchQty;
-        return lastActiveBaseDataFilename;
+    // Compresses the value if the compression is enabled and effective. The stored value is the raw 32-bit size then the compressed
+    // bytes, and it is strictly smaller than the raw value
+    bool compressValue(const void* value, size_t valueSize, lcVector<uint8_t>& storedValue)
+    {
+        if (valueSize < _valueCompressionMinBytes || valueSize <= sizeof(uint32_t) + 1) { return false; }
+        storedValue.resize(valueSize);
+        size_t compressedSize =
+            _valueCodec.compress((const uint8_t*)value, valueSize, storedValue.data() + sizeof(uint32_t), valueSize - sizeof(uint32_t) - 1);
+        if (compressedSize == 0 || compressedSize > valueSize - sizeof(uint32_t) - 1) { return false; }
+        uint32_t rawSize = (uint32_t)valueSize;
+        memcpy(storedValue.data(), &rawSize, sizeof(uint32_t));
+        storedValue.resize(sizeof(uint32_t) + compressedSize);
+        return true;
     }
 
-    bool isItWorthMerging(int fragmentationPercentage, uint32_t deadByteThreshold)
+    // Returns the batch to write: the input one, or a copy with the compressed values if the compression is enabled
+    const WriteBatch& getStoredBatch(const WriteBatch& batch, WriteBatch& compressedBatch)
     {
         using namespace litecask::detail;
-        assert(fragmentationPercentage >= 1 && fragmentationPercentage <= 100);
-
-        _mxDataFiles.lockRead();
-        for (const DataFile* dfd : _dataFiles) {
-            if (!osIsValidHandle(dfd->handle)) continue;  // Descriptor not in use
-
-            if ((uint64_t)dfd->deadBytes * 100L > (uint64_t)dfd->bytes * (uint64_t)fragmentationPercentage) {
-                _mxDataFiles.unlockRead();
-                log(LogLevel::Debug, "Merge needed due to some data file having too high ratio of dead bytes");
-                return true;
+        if (_valueCompressionMinBytes == UINT32_MAX) { return batch; }
+
+        thread_local static lcVector<uint8_t> compressedValue;
+        compressedBatch.reserve(batch.size(), batch.getDataBytes());
+        for (const WriteBatch::Op& op : batch._ops) {
+            DataFileEntry  dfe        = batch.getHeader(op);
+            const uint8_t* key        = batch.getKey(op);
+            const uint8_t* keyIndexes = key + dfe.keySize;
+            const uint8_t* value      = keyIndexes + dfe.keyIndexSize;
+            if (dfe.valueSize != DeletedEntry && compressValue(value, dfe.valueSize, compressedValue)) {
+                dfe.valueSize = (uint32_t)compressedValue.size();
+                dfe.checksum  = (uint32_t)(op.keyHash ^ LITECASK_HASH_FUNC(compressedValue.data(), compressedValue.size()));
+                dfe.flags |= EntryFlagCompressed;
+                value = compressedValue.data();
             }
-
-            if (dfd->deadBytes > deadByteThreshold) {
-                _mxDataFiles.unlockRead();
-                log(LogLevel::Debug, "Merge needed due to some data file having more than %d dead bytes", deadByteThreshold);
-                return true;
+            size_t recordOffset = compressedBatch.appendRecord(dfe, key, dfe.keySize, (const KeyIndex*)keyIndexes, dfe.keyIndexSize);
+            if (dfe.valueSize != DeletedEntry && dfe.valueSize > 0) {
+                memcpy(&compressedBatch._data[recordOffset + sizeof(DataFileEntry) + dfe.keySize + dfe.keyIndexSize], value, dfe.valueSize);
             }
+            compressedBatch._ops.push_back({op.keyHash, recordOffset});
         }
-        _mxDataFiles.unlockRead();
-        return false;
+        return compressedBatch;
     }
 
-    Status selectDataFilesToMerge(int fragmentationPercentage, uint32_t deadByteThreshold, uint32_t smallFileSizeTheshold,
-                                  lcVector<detail::MergeFileInfo>& mergeInfos)
+    // Commits the stored form of the batch entries. The expiration times are either TTLs (user batch) or absolute (replicated entries)
+    Status privateWrite(const WriteBatch& batch, bool forceDiskSync, bool isExpTimeAbsolute)
     {
         using namespace litecask::detail;
-        assert(fragmentationPercentage >= 1 && fragmentationPercentage <= 100);
-        assert(smallFileSizeTheshold >= MinDataFileMaxBytes);
-        mergeInfos.clear();
 
-        // Check each data file
-        _mxDataFiles.lockRead();
-        for (uint32_t fileId = 0; fileId < _dataFiles.size(); ++fileId) {
-            const DataFile* dfd = _dataFiles[fileId];
-            if (!osIsValidHandle(dfd->handle)) continue;  // Descriptor not in use
-            bool doIncludeFileInMerge = false;
-
-            if ((uint64_t)dfd->deadBytes * 100L > (uint64_t)dfd->bytes * (uint64_t)fragmentationPercentage) doIncludeFileInMerge = true;
-            if (dfd->deadBytes > deadByteThreshold) doIncludeFileInMerge = true;
-            if (dfd->bytes < smallFileSizeTheshold) doIncludeFileInMerge = true;
+        struct BatchEntryState {
+            uint32_t fileOffset       = 0;
+            uint32_t expTimeSec       = 0;
+            ValueLoc cacheLocation    = NotStored;
+            ValueLoc oldCacheLocation = NotStored;
+            uint32_t oldDeadBytes     = 0;
+            uint16_t fileId           = 0;
+            uint16_t oldFileId        = 0;
+            bool     isSkipped        = false;
+            bool     isFailed         = false;
+            bool     hasOldEntry      = false;
+        };
+        const size_t              opQty = batch._ops.size();
+        lcVector<BatchEntryState> states(opQty);
 
-            if (doIncludeFileInMerge) { mergeInfos.push_back({(uint16_t)fileId, {}}); }
-            log(LogLevel::Debug, "selectDataFilesToMerge: %s %s", dfd->filename.c_str(),
-                doIncludeFileInMerge ? "will be merged" : "is skipped");
+        // The write lanes of the batch keys are all locked, always in the same order
+        uint32_t laneMask = 0;
+        for (const WriteBatch::Op& op : batch._ops) { laneMask |= (1U << getWriteLaneIndex(op.keyHash)); }
+        lockWriteLanes(laneMask);
+        if (!_isInitialized) {
+            unlockWriteLanes(laneMask);
+            ++_stats.writeBatchCallFailedQty;
+            return Status::StoreNotOpen;
         }
-        _mxDataFiles.unlockRead();
-        return Status::Ok;
-    }
-
-    // 'Merging' is a data file "cleaning" process which:
-    //  - remove obsolete entries whose value has been overridden or deleted in newer data files
-    //  - compact the entries together in the new data files up to the allowed maximum size
-    bool createMergedDataFiles(lcVector<detail::MergeFileInfo>& mergeInfos, const lcString& mergeBasename, const uint32_t dataFileMaxBytes)
-    {
-        using namespace litecask::detail;
-        DataFileEntry     header;
-        lcVector<uint8_t> buf(1024);
-        uint16_t          mergeFileCount    = 0;
-        uint32_t          readFileOffset    = 0;
-        uint32_t          writeFileOffset   = 0;
-        uint32_t          fileIncrement     = 0;
-        uint16_t          currentDataFileId = 0xFFFF;
-        DataFile*         currentDataFile   = nullptr;
-        FILE*             fhw               = nullptr;
-        FILE*             fhhw              = nullptr;
-
-        // Loop on files to merge, the order does not matter
-        for (MergeFileInfo& mergeInfo : mergeInfos) {
-            // Get the data file descriptor
-            _mxDataFiles.lockRead();
-            const DataFile* dfd = _dataFiles[mergeInfo.fileId];
-            assert(osIsValidHandle(dfd->handle) && "This data file should have been in use");
-            _mxDataFiles.unlockRead();
 
-            // We use fopen/fread/fwrite here because of standard usage and the provided buffering
-            // By design, we never merge the active file
-            FILE* fhr = osFopen(dfd->filename, "rb");
-            assert(fhr);
-            readFileOffset = 0;
+        // Removals of non-existing keys are skipped, as 'remove' does, so that no useless tombstone is written.
+        // The key state is provided by the last previous operation on this key in the batch, else by the KeyDir
+        lcVector<std::pair<uint64_t, size_t>> sortedHashes;
+        for (size_t opIdx = 0; opIdx < opQty; ++opIdx) {
+            const WriteBatch::Op& op  = batch._ops[opIdx];
+            DataFileEntry         dfe = batch.getHeader(op);
+            if (dfe.valueSize != DeletedEntry) { continue; }
 
-            // Loop on entries
-            while (fread(&header, sizeof(DataFileEntry), 1, fhr) == 1) {
-                uint32_t valueSize    = header.valueSize;
-                uint32_t keyIndexSize = header.keyIndexSize;
-                uint32_t keySize      = header.keySize;
-                if (keySize == 0) {
-                    log(LogLevel::Error,
-                        "Cannot read the data file %s for merging: a key has a null (=corrupted) size (value size is said to be %u) at "
-                        "file offset %u",
-                        dfd->filename.c_str(), valueSize, readFileOffset);
-                    break;
-                }
+            if (sortedHashes.empty()) {
+                sortedHashes.reserve(opQty);
+                for (size_t i = 0; i < opQty; ++i) { sortedHashes.push_back({batch._ops[i].keyHash, i}); }
+                std::sort(sortedHashes.begin(), sortedHashes.end());
+            }
 
-                if (keyIndexSize > MaxKeyIndexQty * sizeof(KeyIndex)) {
-                    log(LogLevel::Error,
-                        "Cannot read the data file %s for merging: a key has too big index (byte size=%d > %" PRId64 ") at file offset %u",
-                        dfd->filename.c_str(), keyIndexSize, MaxKeyIndexQty * sizeof(KeyIndex), readFileOffset);
-                    break;
+            int  previousOpIdx = -1;
+            auto it            = std::lower_bound(sortedHashes.begin(), sortedHashes.end(), std::pair<uint64_t, size_t>{op.keyHash, 0});
+            for (; it != sortedHashes.end() && it->first == op.keyHash && it->second < opIdx; ++it) {
+                const WriteBatch::Op& previousOp = batch._ops[it->second];
+                if (batch.getHeader(previousOp).keySize == dfe.keySize &&
+                    memcmp(batch.getKey(previousOp), batch.getKey(op), dfe.keySize) == 0) {
+                    previousOpIdx = (int)it->second;
                 }
+            }
 
-                if (valueSize != DeletedEntry) {
-                    uint32_t allSize = keySize + keyIndexSize + valueSize;
-                    if (buf.size() < allSize) buf.resize(allSize);
-                    if (fread(buf.data(), 1, allSize, fhr) != allSize) {
-                        log(LogLevel::Warn,
-                            "Cannot read the data file %s for merging: unable to read all the bytes (%u) of the entry at file offset %u",
-                            dfd->filename.c_str(), allSize, readFileOffset);
-                        break;
+            bool isAlive = false;
+            if (previousOpIdx >= 0) {
+                isAlive = !states[previousOpIdx].isSkipped && batch.getHeader(batch._ops[previousOpIdx]).valueSize != DeletedEntry;
+            } else {
+                KeyChunk entry;
+                isAlive = _keyDir->find((uint32_t)op.keyHash, batch.getKey(op), dfe.keySize, entry) && entry.valueSize != DeletedEntry;
+            }
+            states[opIdx].isSkipped = !isAlive;
+        }
+
+        // Gather the entries in the write buffers, lane by lane
+        bool     hasWrittenEntries                   = false;
+        uint64_t syncWritePositions[MaxWriteLaneQty] = {0};
+        bool     isLaneWritten[MaxWriteLaneQty]      = {false};
+        for (uint32_t laneIdx = 0; laneIdx < _writeLanes.size(); ++laneIdx) {
+            if ((laneMask & (1U << laneIdx)) == 0) { continue; }
+            WriteLane& lane                = *_writeLanes[laneIdx];
+            bool       areBufferLocksTaken = false;
+            for (size_t opIdx = 0; opIdx < opQty; ++opIdx) {
+                const WriteBatch::Op& op    = batch._ops[opIdx];
+                BatchEntryState&      state = states[opIdx];
+                if (state.isSkipped || getWriteLaneIndex(op.keyHash) != laneIdx) { continue; }
+
+                DataFileEntry dfe         = batch.getHeader(op);
+                size_t        recordBytes = WriteBatch::getRecordBytes(dfe);
+                bool          isRemoval   = (dfe.valueSize == DeletedEntry);
+                if (!isRemoval && !isExpTimeAbsolute) { dfe.expTimeSec = (dfe.expTimeSec == 0) ? 0 : dfe.expTimeSec + _nowTimeSec; }
+
+                // Check that the limit of the data file size is not exceeded, as for a single put
+                if (lane.activeDataOffset > 0 && (uint64_t)lane.activeDataOffset + (uint64_t)recordBytes >= _dataFileMaxBytes) {
+                    if (areBufferLocksTaken) {
+                        lane.mxWriteBuffer.unlockWrite();
+                        _mxDataFiles.unlockRead();
+                        areBufferLocksTaken = false;
                     }
-                    fileIncrement = (uint32_t)sizeof(DataFileEntry) + allSize;
+                    createNewActiveDataFileUnlocked(lane);
                 }
-
-                else {
-                    // Tombstone case
-                    uint32_t allSize = keySize + keyIndexSize;
-                    if (buf.size() < allSize) buf.resize(allSize);
-                    if (fread(buf.data(), 1, allSize, fhr) != allSize) {
-                        log(LogLevel::Warn,
-                            "Cannot read the data file %s for merging: unable to read all the bytes (%u) of the deleted entry at file "
-                            "offset %u",
-                            dfd->filename.c_str(), allSize, readFileOffset);
-                        break;
-                    }
-                    keyIndexSize  = 0;
-                    fileIncrement = sizeof(DataFileEntry) + allSize;
+                if (!areBufferLocksTaken) {
+                    _mxDataFiles.lockRead();
+                    lane.mxWriteBuffer.lockWrite();
+                    areBufferLocksTaken = true;
                 }
 
-                uint64_t keyHash = LITECASK_HASH_FUNC(buf.data(), keySize);
-                KeyChunk entry;
-                bool     isFound = _keyDir->find((uint32_t)keyHash, buf.data(), (uint16_t)keySize, entry);
-                if (!isFound || entry.fileId != mergeInfo.fileId || entry.fileOffset != readFileOffset) {
-                    readFileOffset += fileIncrement;
-                    continue;  // This entry is not the latest or expired
+                if ((lane.activeDataOffset - lane.activeFlushedDataOffset) + recordBytes > lane.writeBuffer.size()) {
+                    flushWriteBufferUnlocked(lane);
                 }
-                readFileOffset += fileIncrement;
-
-                // Change the write file if the size exceeds the threshold
-                if (fhw == nullptr || (writeFileOffset > 0 && writeFileOffset + fileIncrement > dataFileMaxBytes)) {
-                    // Move the complete compacted file as official data file
-                    if (fhw != nullptr) {
-                        // Close finished data and hint written files
-                        fclose(fhw);
-                        fclose(fhhw);
-
-                        // If a crash occurs before the move then the .tmp is simply removed at next launch. If a crash
-                        // occurs after this (atomic) renaming, then the data will be taken into account and the old
-                        // duplicate entries will be cleaned by next merge
-                        assert(currentDataFile);
-                        log(LogLevel::Debug, "Finished compacted file %s. Removing the '%s' suffix.", currentDataFile->filename.c_str(),
-                            TmpFileSuffix);
-                        [[maybe_unused]] bool isOk = osRenameFile(currentDataFile->filename + TmpFileSuffix, currentDataFile->filename);
-                        assert(isOk);
-                        currentDataFile->handle = osOsOpen(currentDataFile->filename, OsOpenMode::READ);
-                        assert(osIsValidHandle(currentDataFile->handle));
-                        fs::path hintFilename = fs::path(currentDataFile->filename).replace_extension(HintFileSuffix);
-                        isOk                  = osRenameFile(hintFilename.string() + TmpFileSuffix, hintFilename);
-                        assert(isOk);
-                    }
 
-                    // Create the next compacted file to write in
-                    char dataFilename[512];  // Note: the fractional number shall not be zero
-                    snprintf(dataFilename, sizeof(dataFilename), "%s.%05d%s", mergeBasename.c_str(), ++mergeFileCount, DataFileSuffix);
-
-                    // The data file structure is modified
-                    _mxDataFiles.lockWrite();
-                    currentDataFileId = getFreeDataFileIdUnlocked();
-                    currentDataFile   = _dataFiles[currentDataFileId];
-                    _mxDataFiles.unlockWrite();
-
-                    currentDataFile->filename = dataFilename;
-                    currentDataFile->handle =
-                        InvalidFileHandle;  // Will be opened for read only when the temporary file is complete and renamed
-                    fhw = osFopen(lcString(dataFilename) + TmpFileSuffix, "wb");
-                    if (!fhw) {
-                        fatalHandler("Unable to open temp data file for %s during merge file creation.", currentDataFile->filename.c_str());
-                    }
-                    writeFileOffset       = 0;
-                    fs::path hintFilename = fs::path(currentDataFile->filename).replace_extension(HintFileSuffix);
-                    fhhw                  = osFopen(hintFilename.string() + TmpFileSuffix, "wb");
-                    if (!fhhw) {
-                        fatalHandler("Unable to open temp hint file for %s during merge file creation.", currentDataFile->filename.c_str());
+                state.fileOffset = lane.activeDataOffset;
+                state.fileId     = lane.activeDataFileId;
+                state.expTimeSec = dfe.expTimeSec;
+                assert(lane.activeDataOffset >= lane.activeFlushedDataOffset);
+
+                const uint8_t* record = batch.getRecord(op);
+                if ((lane.activeDataOffset - lane.activeFlushedDataOffset) + recordBytes <= lane.writeBuffer.size()) {
+                    // Store in the write buffer, with the header containing the absolute expiration time
+                    uint32_t dataOffset = lane.activeDataOffset - lane.activeFlushedDataOffset;
+                    memcpy(&lane.writeBuffer[dataOffset], &dfe, sizeof(DataFileEntry));
+                    memcpy(&lane.writeBuffer[dataOffset + sizeof(DataFileEntry)], record + sizeof(DataFileEntry),
+                           recordBytes - sizeof(DataFileEntry));
+                    lane.activeDataOffset += (uint32_t)recordBytes;
+                } else {
+                    // Too big entry: the write buffer has already been synced-flushed, so the entry is directly written in the file
+                    assert(lane.activeDataOffset == lane.activeFlushedDataOffset);
+                    lcOsFileHandle fh = _dataFiles[lane.activeDataFileId]->handle;
+                    if (!osOsWrite(fh, &dfe, sizeof(DataFileEntry)) ||
+                        !osOsWrite(fh, record + sizeof(DataFileEntry), recordBytes - sizeof(DataFileEntry))) {
+                        fatalHandler("Write: Unable to write the entry (size=%" PRId64 ") in the datafile", (int64_t)recordBytes);
                     }
+                    lane.activeDataOffset += (uint32_t)recordBytes;
+                    lane.activeFlushedDataOffset = lane.activeDataOffset;
+                    updateFlushedWritePositionUnlocked(lane);
                 }
-
-                // Write the entry both in the data file and its hint file
-                uint8_t*      keyAndIndexes = buf.data();
-                DataFileEntry dfe{header.checksum, header.expTimeSec, valueSize, (uint16_t)keySize, (uint8_t)keyIndexSize, 0};
-                bool          isMergeOk = (fwrite(&dfe, sizeof(DataFileEntry), 1, fhw) == 1);
-                isMergeOk               = isMergeOk &&
-                            (fwrite(keyAndIndexes, 1, fileIncrement - sizeof(DataFileEntry), fhw) == fileIncrement - sizeof(DataFileEntry));
-
-                HintFileEntry hfe{writeFileOffset, header.expTimeSec, valueSize, (uint16_t)keySize, (uint8_t)keyIndexSize, 0};
-                isMergeOk = isMergeOk && (fwrite(&hfe, sizeof(HintFileEntry), 1, fhhw) == 1);
-                isMergeOk = isMergeOk && (fwrite(keyAndIndexes, 1, keySize + keyIndexSize, fhhw) == keySize + keyIndexSize);
-                if (!isMergeOk) {
-                    fatalHandler("Write error for for file %s during merge file creation.", currentDataFile->filename.c_str());
-                }
-
-                mergeInfo.patches.push_back({(uint32_t)keyHash, entry.fileOffset, writeFileOffset, mergeInfo.fileId, currentDataFileId});
-                currentDataFile->bytes += fileIncrement;
-                currentDataFile->entries += 1;
-                if (valueSize == DeletedEntry) {
-                    currentDataFile->tombBytes += fileIncrement;
-                    currentDataFile->tombEntries += 1;
+                appendActiveHintEntryUnlocked(lane, state.fileOffset, dfe, record + sizeof(DataFileEntry),
+                                              record + sizeof(DataFileEntry) + dfe.keySize);
+
+                // Update active data file stats
+                DataFile* dfd = _dataFiles[state.fileId];
+                dfd->bytes += (uint32_t)recordBytes;
+                dfd->entries += 1;
+                if (isRemoval) {
+                    dfd->tombBytes += (uint32_t)recordBytes;
+                    dfd->tombEntries += 1;
                 }
-                writeFileOffset += fileIncrement;
-            }  // End of loop on entries
-
-            _stats.mergeGainedBytes += readFileOffset - writeFileOffset;
-            fclose(fhr);
-        }  // End of loop on data files to merge
-
-        // Close the last merged data file
-        if (fhw != nullptr) {
-            // Close finished data and hint written files
-            fclose(fhw);
-            fclose(fhhw);
-
-            assert(currentDataFile);
-            log(LogLevel::Debug, "Finished compacted file %s. Removing the '%s' suffix.", currentDataFile->filename.c_str(), TmpFileSuffix);
-            if (!osRenameFile(currentDataFile->filename + TmpFileSuffix, currentDataFile->filename)) {
-                fatalHandler("Unable to rename temp data file for %s during merge file creation.", currentDataFile->filename.c_str());
             }
-            currentDataFile->handle = osOsOpen(currentDataFile->filename, OsOpenMode::READ);
-            assert(osIsValidHandle(currentDataFile->handle));
-            fs::path hintFilename = fs::path(currentDataFile->filename).replace_extension(HintFileSuffix);
-            if (!osRenameFile(hintFilename.string() + TmpFileSuffix, hintFilename)) {
-                fatalHandler("Unable to rename temp hint file for %s during merge file creation.", currentDataFile->filename.c_str());
+
+            if (areBufferLocksTaken) {
+                syncWritePositions[laneIdx] = getActiveWritePositionUnlocked(lane);
+                isLaneWritten[laneIdx]      = true;
+                hasWrittenEntries           = true;
+                lane.mxWriteBuffer.unlockWrite();
+                _mxDataFiles.unlockRead();
             }
         }
+        unlockWriteLanes(laneMask);
 
-        // No problem so far: create the tag files to remove old data files
-        // If a crash occurs before/while creating the "to_remove" tag files, next merge will clean the old-and-now-duplicate entries
-        _mxDataFiles.lockRead();
-        for (MergeFileInfo& mergeInfo : mergeInfos) {
-            const DataFile* dfd = _dataFiles[mergeInfo.fileId];
-            log(LogLevel::Debug, "Creating tag file to request removal of old data file %s.", dfd->filename.c_str());
-            FILE* tagFile = osFopen(fs::path(dfd->filename).replace_extension(ToRemoveFileSuffix), "wb");
-            fclose(tagFile);  // No content, just the file existence. Not really a problem if the tag file creation failed
+        if (hasWrittenEntries) {
+            notifyWrittenBytes(batch.getDataBytes());
+            if (forceDiskSync || _syncPolicy == SyncPolicy::PerWrite) {
+                for (uint32_t laneIdx = 0; laneIdx < _writeLanes.size(); ++laneIdx) {
+                    if (!isLaneWritten[laneIdx]) { continue; }
+                    waitForFlushedWritePosition(*_writeLanes[laneIdx], syncWritePositions[laneIdx], _syncPolicy != SyncPolicy::None);
+                }
+            }
         }
-        _mxDataFiles.unlockRead();
-
-        // No problem so far.
-        // Next step is to apply patch on KeyDir, close the old data files, open the new ones, and remove the tagged data files
-        _stats.mergeGainedDataFileQty += mergeInfos.size() - mergeFileCount;
-        return true;
-    }
-
-    bool replaceDataFiles(const lcVector<detail::MergeFileInfo>& mergeInfos)
-    {
-        using namespace litecask::detail;
-
-        // Next step is to apply patch on KeyDir, close the old data files, open the new ones, and remove the tagged data files
-        for (const MergeFileInfo& mergeInfo : mergeInfos) {
-            // The data file structure is modified
-            _mxDataFiles.lockWrite();
-            DataFile* dfd = _dataFiles[mergeInfo.fileId];
 
-            // Live-patch of the KeyDir
-            _mxKeyDir.lock();
-            for (const KeyDirPatch& kdPatch : mergeInfo.patches) {
-                _keyDir->updateMergedValueLocation(kdPatch.keyHash, kdPatch.oldFileId, kdPatch.oldFileOffset, kdPatch.newFileId,
-                                                   kdPatch.fileOffset);
+        // Push in cache
+        if (_valueCache->isEnabled()) {
+            for (size_t opIdx = 0; opIdx < opQty; ++opIdx) {
+                const WriteBatch::Op& op  = batch._ops[opIdx];
+                DataFileEntry         dfe = batch.getHeader(op);
+                if (states[opIdx].isSkipped || dfe.valueSize == DeletedEntry) { continue; }
+                states[opIdx].cacheLocation = _valueCache->insertValue(batch.getKey(op) + dfe.keySize + dfe.keyIndexSize, dfe.valueSize,
+                                                                       op.keyHash, states[opIdx].expTimeSec);
             }
-            _mxKeyDir.unlock();
+        }
 
-            if (osIsValidHandle(dfd->handle)) {
-                osOsClose(dfd->handle);
-                dfd->handle = InvalidFileHandle;
+        // Update the KeyDir and the index map. The index map lock is taken first, consistently with the index cleaning
+        bool hasKeyIndexes = false;
+        for (const WriteBatch::Op& op : batch._ops) { hasKeyIndexes = hasKeyIndexes || (batch.getHeader(op).keyIndexSize > 0); }
+        if (hasKeyIndexes) { _mxIndexMap.lockWrite(); }
 
-                // Remove the files associated with this old data file. The order below matters in case of hard interruption.
-                // First remove the old data file
-                osRemoveFile(dfd->filename);
-                // Then the hint file (if it exists)
-                osRemoveFile(fs::path(dfd->filename).replace_extension(HintFileSuffix));
-                // Then, the removal tag
-                osRemoveFile(fs::path(dfd->filename).replace_extension(ToRemoveFileSuffix));
+        Status      batchStatus = Status::Ok;
+        OldKeyChunk oldEntry;
+        for (size_t opIdx = 0; opIdx < opQty; ++opIdx) {
+            const WriteBatch::Op& op    = batch._ops[opIdx];
+            BatchEntryState&      state = states[opIdx];
+            if (state.isSkipped) { continue; }
+
+            DataFileEntry   dfe           = batch.getHeader(op);
+            bool            isRemoval     = (dfe.valueSize == DeletedEntry);
+            const uint8_t*  key           = batch.getKey(op);
+            const KeyIndex* keyIndexes    = (const KeyIndex*)(key + dfe.keySize);
+            std::mutex&     mxKeyDirShard = _keyDir->getMutex((uint32_t)op.keyHash);
+            mxKeyDirShard.lock();
+            Status storageStatus =
+                _keyDir->insertEntry((uint32_t)op.keyHash, key, isRemoval ? &NoKeyIndex : keyIndexes,
+                                     {state.expTimeSec, dfe.valueSize, state.cacheLocation, state.fileOffset, state.fileId, dfe.keySize,
+                                      isRemoval ? (uint8_t)0 : dfe.keyIndexSize, isRemoval ? (uint8_t)0 : (uint8_t)dfe.checksum, dfe.flags},
+                                     oldEntry);
+            mxKeyDirShard.unlock();
+            if (storageStatus != Status::Ok) {
+                // Can be too big a key (precise check done here) or out of memory
+                if (batchStatus == Status::Ok) { batchStatus = storageStatus; }
+                state.isFailed = true;
+                continue;
+            }
 
-                // Free the fileId for reuse
-                _freeDataFileIds.push_back(mergeInfo.fileId);
+            if (dfe.keyIndexSize > 0) {
+                insertNewKeyIndexesUnlocked(key, keyIndexes, dfe.keyIndexSize / sizeof(KeyIndex), (uint32_t)op.keyHash, oldEntry);
+            }
+
+            if (oldEntry.isValid) {
+                state.hasOldEntry      = true;
+                state.oldCacheLocation = oldEntry.cacheLocation;
+                state.oldFileId        = oldEntry.fileId;
+                state.oldDeadBytes =
+                    (uint32_t)(sizeof(DataFileEntry) + dfe.keySize +
+                               ((oldEntry.valueSize == DeletedEntry) ? 0 : oldEntry.keyIndexQty * sizeof(KeyIndex) + oldEntry.valueSize));
             }
+        }
 
-            _mxDataFiles.unlockWrite();
+        if (hasKeyIndexes) { _mxIndexMap.unlockWrite(); }
+
+        // Remove the old values from the cache and update "old" file descriptor statistics for proper maintenance
+        _mxDataFiles.lockRead();
+        for (size_t opIdx = 0; opIdx < opQty; ++opIdx) {
+            const BatchEntryState& state = states[opIdx];
+            if (state.isSkipped) {
+                ++_stats.removeCallNotFoundQty;
+                continue;
+            }
+            if (state.isFailed) { continue; }
+            if (state.hasOldEntry) {
+                if (state.oldCacheLocation != NotStored && _valueCache->isEnabled()) {
+                    _valueCache->removeValue(state.oldCacheLocation, batch._ops[opIdx].keyHash);
+                }
+                _dataFiles[state.oldFileId]->deadBytes += state.oldDeadBytes;
+                _dataFiles[state.oldFileId]->deadEntries += 1;
+            }
+            if (batch.getHeader(batch._ops[opIdx]).valueSize == DeletedEntry) {
+                ++_stats.removeCallQty;
+            } else {
+                ++_stats.putCallQty;
+            }
         }
+        _mxDataFiles.unlockRead();
 
-        return true;
-    }
+        if (batchStatus != Status::Ok) {
+            if (batchStatus == Status::OutOfMemory) {
+                log(LogLevel::Error,
+                    "Unable to store the new keys due to out of memory, the run-time integrity of the datastore is compromised (data files "
+                    "are ok). You should stop and relaunch the application to recover it. If not enough, using tools to perform a full "
+                    "merge on the data to make it more compact could help.");
+            }
+            ++_stats.writeBatchCallFailedQty;
+            return batchStatus;
+        }
 
-    // Templatized helper function for template<class KP, class K> privateQuery(...) below
-    void addQueryResult(lcVector<lcVector<uint8_t>>& matchingKeys, const lcVector<uint8_t>& key, ArenaAllocator* /*allocator*/)
-    {
-        matchingKeys.push_back(key);
+        ++_stats.writeBatchCallQty;
+        return Status::Ok;
     }
 
-    // Templatized helper function for template<class KP, class K> privateQuery(...) below
-    void addQueryResult(lcVector<QueryResult>& matchingKeys, const lcVector<uint8_t>& key, ArenaAllocator* allocator)
+    // The key hash is provided by the caller
+    Status privatePut(uint64_t keyHash, const void* key, size_t keySize, const void* value, size_t valueSize,
+                      const lcVector<KeyIndex>& keyIndexes, uint32_t ttlSec, bool forceDiskSync, CacheHint cacheHint)
     {
-        uint8_t* ptr = allocator->allocate(key.size());
-        assert(ptr);
-        memcpy(ptr, key.data(), key.size());
-        matchingKeys.push_back({ptr, (uint16_t)key.size()});
-    }
+        using namespace litecask::detail;
+        LatencyScope latencyScope(_latency, LatencyKind::Put);
 
-    template<class KP, class K>
-    Status privateQuery(const lcVector<KP>& keyParts, lcVector<K>& matchingKeys, ArenaAllocator* allocator = nullptr)
-    {
-        matchingKeys.clear();
-        ++_stats.queryCallQty;
+        if (keySize == 0 || keySize >= USHRT_MAX) {
+            ++_stats.putCallFailedQty;
+            return Status::BadKeySize;
+        }
+        if (keyIndexes.size() > MaxKeyIndexQty) {
+            ++_stats.putCallFailedQty;
+            return Status::InconsistentKeyIndex;
+        }
+        KeyIndex lastIdx{0, 0};
+        for (const KeyIndex& ki : keyIndexes) {
+            if (ki.size == 0 || ki.startIdx + ki.size > keySize) {
+                ++_stats.putCallFailedQty;
+                return Status::InconsistentKeyIndex;
+            }
+            if (ki.startIdx < lastIdx.startIdx || (ki.startIdx == lastIdx.startIdx && ki.size <= lastIdx.size)) {
+                ++_stats.putCallFailedQty;
+                return Status::UnorderedKeyIndex;
+            }
+            lastIdx = ki;
+        }
+        if (valueSize >= detail::MaxValueSize) {
+            ++_stats.putCallFailedQty;
+            return Status::BadValueSize;
+        }
 
-        // Check key parts validity
-        for (const KP& kp : keyParts) {
-            if (kp.size() >= USHRT_MAX) {
-                ++_stats.queryCallFailedQty;
-                return Status::BadKeySize;
+        // From here, the value is the stored one (compressed, raw, or the reference of its blob file).
+        // The blob file is written before taking any lock, so that the other writers are not delayed
+        thread_local static lcVector<uint8_t> compressedValue;
+        uint8_t                               entryFlags = 0;
+        BlobRef                               blobRef;
+        if (valueSize >= _blobMinBytes) {
+            Status blobStatus = writeBlobValue(value, valueSize, forceDiskSync || _syncPolicy != SyncPolicy::None, blobRef);
+            if (blobStatus != Status::Ok) {
+                ++_stats.putCallFailedQty;
+                return blobStatus;
             }
+            value      = &blobRef;
+            valueSize  = sizeof(BlobRef);
+            entryFlags = EntryFlagBlob;
+        } else if (compressValue(value, valueSize, compressedValue)) {
+            value      = compressedValue.data();
+            valueSize  = compressedValue.size();
+            entryFlags = EntryFlagCompressed;
         }
 
-        _mxIndexMap.lockRead();
+        uint32_t   checksum = (uint32_t)(keyHash ^ LITECASK_HASH_FUNC(value, valueSize));
+        WriteLane& lane     = getWriteLane(keyHash);
 
-        // Get the smallest entry list among the "key parts", to minimize the work
-        int sourceKeyPartIdx = -1;
-        if (keyParts.size() == 1) {
-            sourceKeyPartIdx = 0;
-        } else if (keyParts.size() > 1) {
-            uint32_t bestValue = 0;
-            for (int keyPartIdx = 0; keyPartIdx < (int)keyParts.size(); ++keyPartIdx) {
-                const KP& kp      = keyParts[keyPartIdx];
-                uint32_t  entries = _indexMap->getEntryHashes(kp.data(), (uint16_t)kp.size(), nullptr);
-                if (sourceKeyPartIdx == -1 || entries < bestValue) {
-                    sourceKeyPartIdx = keyPartIdx;
-                    bestValue        = entries;
-                    if (bestValue == 0) {  // Empty match, so empty output ("and" between key parts)
-                        sourceKeyPartIdx = -1;
-                        break;
-                    }
-                }
-            }
+        uint64_t lockStartNs = _latency.start();
+        lane.mxActiveFile.lock();
+        _latency.record(LatencyKind::ActiveFileLockWait, lockStartNs);
+        if (!_isInitialized) {
+            lane.mxActiveFile.unlock();
+            ++_stats.putCallFailedQty;
+            return Status::StoreNotOpen;
         }
 
-        // Empty answer
-        if (sourceKeyPartIdx < 0) {
-            _mxIndexMap.unlockRead();
-            return Status::Ok;
+        // Check that the limit of the data file size is not exceeded (taking into account the 64 overflow)
+        // The only exception is if we are at the beginning of a new file, so that any entry size can fit the data file
+        if (lane.activeDataOffset > 0 &&
+            (uint64_t)lane.activeDataOffset + sizeof(DataFileEntry) + (uint64_t)keySize + (uint64_t)valueSize >= _dataFileMaxBytes) {
+            createNewActiveDataFileUnlocked(lane);  // Now the entry can be written whatever its size (new file)
         }
 
-        // Snapshot the smaller list of keyHash
-        lcVector<uint32_t> entryHashes;
-        const KP&          sourceKeyPart = keyParts[sourceKeyPartIdx];
-        _indexMap->getEntryHashes(sourceKeyPart.data(), (uint16_t)sourceKeyPart.size(), &entryHashes);
-        _mxIndexMap.unlockRead();
+        lockStartNs = _latency.start();
+        _mxDataFiles.lockRead();
+        _latency.record(LatencyKind::DataFilesLockWait, lockStartNs);
+        lcOsFileHandle fh = _dataFiles[lane.activeDataFileId]->handle;
+        assert(osIsValidHandle(fh));
 
-        // Loop on the hashes
-        //   - check if the entry exists and really contain the keyPart
-        //   - if yes, check that other keyparts are also present
-        //   - if all are present, store the key in the result list
-        lcVector<uint8_t>  key;
-        lcVector<KeyIndex> keyIndexes;
-        uint32_t           hashNotPresentQty = 0;
-        for (uint32_t entryHashIdx = 0; entryHashIdx < (uint32_t)entryHashes.size(); ++entryHashIdx) {
-            uint32_t keyHash = entryHashes[entryHashIdx];
+        // Write entry in the memory write buffer
+        lockStartNs = _latency.start();
+        lane.mxWriteBuffer.lockWrite();
+        _latency.record(LatencyKind::WriteBufferLockWait, lockStartNs);
+        size_t keyIndexSize = keyIndexes.size() * sizeof(KeyIndex);
+        if ((lane.activeDataOffset - lane.activeFlushedDataOffset) + (sizeof(DataFileEntry) + keySize + keyIndexSize + valueSize) >
+            lane.writeBuffer.size()) {
+            flushWriteBufferUnlocked(lane);
+        }
 
-            if (!_keyDir->getKeyAndIndexes(keyHash, key, keyIndexes)) {
-                // The entry hash array is reused to store the absent hash.
-                // Collected data is used later if a "cleaning" is triggered
-                entryHashes[hashNotPresentQty++] = keyHash;
-                continue;
-            }
+        uint32_t      expTimeSec = (ttlSec == 0) ? 0 : ttlSec + _nowTimeSec;
+        DataFileEntry dfe{checksum, expTimeSec, (uint32_t)valueSize, (uint16_t)keySize, (uint8_t)keyIndexSize, entryFlags};
+        uint32_t      entryActiveDataOffset = lane.activeDataOffset;
+        uint16_t      entryActiveDataFileId = lane.activeDataFileId;
+        assert(lane.activeDataOffset >= lane.activeFlushedDataOffset);
 
-            // Filter on other key parts (which implements the "and" behavior if multiple key parts are provided)
-            bool allKeyPartsFound = true;
-            for (int i = 0; i < (int)keyParts.size(); ++i) {
-                // Swap sourceKeyPart and index 0. Indeed, we want to check that the "main" key part is present in the key
-                int       keyPartIdx = (i == 0) ? sourceKeyPartIdx : ((i == sourceKeyPartIdx) ? 0 : i);
-                const KP& kp         = keyParts[keyPartIdx];
+        if ((lane.activeDataOffset - lane.activeFlushedDataOffset) + (sizeof(DataFileEntry) + keySize + keyIndexSize + valueSize) <=
+            lane.writeBuffer.size()) {
+            // Store in the write buffer
+            uint32_t dataOffset = lane.activeDataOffset - lane.activeFlushedDataOffset;
+            memcpy(&lane.writeBuffer[dataOffset], &dfe, sizeof(DataFileEntry));
+            memcpy(&lane.writeBuffer[dataOffset + sizeof(DataFileEntry)], key, keySize);
+            if (keyIndexSize > 0) {
+                memcpy(&lane.writeBuffer[dataOffset + sizeof(DataFileEntry) + keySize], (uint8_t*)keyIndexes.data(), keyIndexSize);
+            }
+            if (valueSize > 0) { memcpy(&lane.writeBuffer[dataOffset + sizeof(DataFileEntry) + keySize + keyIndexSize], value, valueSize); }
 
-                bool keyPartFound = false;
-                for (const auto& ki : keyIndexes) {
-                    if (ki.size == kp.size() && !memcmp(&key[ki.startIdx], kp.data(), ki.size)) {
-                        keyPartFound = true;
-                        break;
-                    }
-                }
-                if (!keyPartFound) {
-                    if (keyPartIdx == sourceKeyPartIdx) {
-                        // Collected data is used later if a "cleaning" is triggered, as the key part is unexpecingly not in the entry
-                        entryHashes[hashNotPresentQty++] = keyHash;
-                    }
+            // Update the active offset
+            lane.activeDataOffset += (uint32_t)(sizeof(DataFileEntry) + keySize + keyIndexSize + valueSize);
+        }
 
-                    allKeyPartsFound = false;
-                    break;
-                }
+        else {
+            // Too big entry: the write buffer has already been synced-flushed, so the entry is directly written in the file
+            assert(lane.activeDataOffset == lane.activeFlushedDataOffset);
+            if (!osOsWrite(fh, &dfe, sizeof(DataFileEntry)) || !osOsWrite(fh, key, keySize)) {
+                fatalHandler("Put: Unable to write the header and key (size=%" PRId64 ") in the datafile", keySize);
+            }
+            if (keyIndexSize > 0 && !osOsWrite(fh, (uint8_t*)keyIndexes.data(), keyIndexSize)) {
+                fatalHandler("Put: Unable to write the key indexes (size=%" PRId64 ") in the datafile", keyIndexSize);
+            }
+            if (valueSize > 0 && !osOsWrite(fh, value, valueSize)) {
+                fatalHandler("Put: Unable to write the value (size=%" PRId64 ") in the datafile", valueSize);
             }
 
-            // Store only if all key parts are present in this key
-            if (allKeyPartsFound) { addQueryResult(matchingKeys, key, allocator); }
+            // Update the offsets (flush also) after this unoptimized write
+            lane.activeDataOffset += (uint32_t)(sizeof(DataFileEntry) + keySize + keyIndexSize + valueSize);
+            lane.activeFlushedDataOffset = lane.activeDataOffset;
+            updateFlushedWritePositionUnlocked(lane);
         }
+        appendActiveHintEntryUnlocked(lane, entryActiveDataOffset, dfe, key, keyIndexes.data());
 
-        // A cleaning phase to remove the no-more-matching keys from the database is done at query time.
-        // The mismatch is due to database entry key index modification or entry removal, as no index array update is performed
-        // at that time for performance reasons.
-        // The cleaning implies both an update of the index lookup array and an update of the key part list inside the entries.
-        // It is trigged based on a minimum quantity and array ratio of entries to clean.
-        // Note: in case of multiple "AND" index provided, only the one with smallest array will be processed
-        constexpr uint32_t MinimumMismatchEntries      = 10;
-        constexpr uint64_t MinimumMismatchArrayPercent = 10;
-        if (hashNotPresentQty > MinimumMismatchEntries &&
-            (uint64_t)hashNotPresentQty * 100 > MinimumMismatchArrayPercent * entryHashes.size()) {
-            ++_stats.indexArrayCleaningQty;
+        uint64_t syncWritePosition = getActiveWritePositionUnlocked(lane);
+        lane.mxWriteBuffer.unlockWrite();
 
-            // Get the writable array of entry hashes
-            uint32_t* storedEntryHashes  = nullptr;
-            uint32_t* storedEntryHashQty = nullptr;
-            _mxIndexMap.lockWrite();
-            if (_indexMap->getEntryHashesForUpdate(sourceKeyPart.data(), (uint16_t)sourceKeyPart.size(), &storedEntryHashes,
-                                                   &storedEntryHashQty)) {
-                // Collected invalid hashes to clean are processed in order.
-                // This ordering assumption is valid if no cleaning was done in-between. Otherwise, the array is already clean
-                // and the current cleaning process will be ineffective and harmless.
-                // In-between insertions in the array do not affect the cleaning as they are added at the end
-                uint32_t storedEntryHashIndex  = 0;
-                uint32_t invalidEntryHashIndex = 0;
-                while (storedEntryHashIndex < *storedEntryHashQty && invalidEntryHashIndex < hashNotPresentQty) {
-                    uint32_t keyHashToClean = entryHashes[invalidEntryHashIndex++];
+        // Update active data file stats
+        _dataFiles[entryActiveDataFileId]->bytes += (uint32_t)(sizeof(DataFileEntry) + keySize + keyIndexSize + valueSize);
+        _dataFiles[entryActiveDataFileId]->entries += 1;
 
-                    // Find the hash in the invalid hash list
-                    while (storedEntryHashIndex < *storedEntryHashQty && storedEntryHashes[storedEntryHashIndex] != keyHashToClean) {
-                        ++storedEntryHashIndex;
-                    }
-                    if (storedEntryHashIndex >= *storedEntryHashQty) {
-                        break;
-                    }  // Means that the invalid hash was not found inside the array
-
-                    // Clean the index in the entry
-                    _mxKeyDir.lock();
-                    if (_keyDir->cleanIndex(keyHashToClean, sourceKeyPart.data(), (uint16_t)sourceKeyPart.size())) {
-                        // The index was removed or not found in this entry, so it shall also be removed from current hash array
-                        storedEntryHashes[storedEntryHashIndex] = storedEntryHashes[--(*storedEntryHashQty)];
-                        ++_stats.indexArrayCleanedEntries;
-                    }
-                    _mxKeyDir.unlock();
+        _mxDataFiles.unlockRead();
+        lane.mxActiveFile.unlock();
+
+        notifyWrittenBytes(sizeof(DataFileEntry) + keySize + keyIndexSize + valueSize);
+        if (forceDiskSync || _syncPolicy == SyncPolicy::PerWrite) {
+            waitForFlushedWritePosition(lane, syncWritePosition, _syncPolicy != SyncPolicy::None);
+        }
 
-                }  // End of loop on current hashes
+        // Push in cache
+        ValueLoc cacheLoc = NotStored;
+        if (_valueCache->isEnabled() && cacheHint != CacheHint::NoCache) {
+            cacheLoc = _valueCache->insertValue(value, (uint32_t)valueSize, keyHash, expTimeSec);
+        }
 
-            } else {
-                log(LogLevel::Warn,
-                    "The key part to clean was not found in the index map in spite of the absence of removal of such item...");
+        // Update the KeyDir
+        OldKeyChunk oldEntry;
+        std::mutex& mxKeyDirShard = _keyDir->getMutex((uint32_t)keyHash);
+        lockStartNs = _latency.start();
+        mxKeyDirShard.lock();
+        _latency.record(LatencyKind::KeyDirShardLockWait, lockStartNs);
+        Status storageStatus = _keyDir->insertEntry((uint32_t)keyHash, key, keyIndexes.data(),
+                                                    {expTimeSec, (uint32_t)valueSize, cacheLoc, entryActiveDataOffset, entryActiveDataFileId,
+                                                     (uint16_t)keySize, (uint8_t)keyIndexSize, (uint8_t)checksum, entryFlags},
+                                                    oldEntry);
+        mxKeyDirShard.unlock();
+
+        if (storageStatus != Status::Ok) {  // Can be too big a key (precise check done here) or out of memory
+            if (storageStatus == Status::OutOfMemory) {
+                // This error deserves a dedicated log message
+                // In this case, the run-time behavior of the database is compromised.
+                // The data files are however still correct and consistent, only the in-memory information is incomplete.
+                log(LogLevel::Error,
+                    "Unable to store the new key due to out of memory, the run-time integrity of the datastore is compromised (data files "
+                    "are ok). You should stop and relaunch the application to recover it. If not enough, using tools to perform a full "
+                    "merge on the data to make it more compact could help.");
             }
+            return storageStatus;
+        }
 
+        // Update the index map
+        if (!keyIndexes.empty()) {
+            lockStartNs = _latency.start();
+            _mxIndexMap.lockWrite();
+            _latency.record(LatencyKind::IndexMapLockWait, lockStartNs);
+            insertNewKeyIndexesUnlocked((const uint8_t*)key, keyIndexes.data(), keyIndexes.size(), (uint32_t)keyHash, oldEntry);
             _mxIndexMap.unlockWrite();
         }
 
-        return Status::Ok;
-    }
+        // Update case?
+        if (oldEntry.isValid) {
+            // Remove the old entry from the cache
+            if (oldEntry.cacheLocation != NotStored && _valueCache->isEnabled()) {
+                _valueCache->removeValue(oldEntry.cacheLocation, keyHash);
+            }
 
-    void notifyKeyDirResizing(uint32_t newSize, bool isStart, bool wasForced)
-    {
-        if (isStart) {
-            log(LogLevel::Debug, "KeyDir resizing to %u entries started", newSize);
-            std::unique_lock<std::mutex> lk(_upkeepMutex);
-            _upkeepWork.store(true);
-            _upkeepCv.notify_one();
-        } else {
-            log(LogLevel::Debug, "KeyDir resizing to %u entries finished%s", newSize, wasForced ? " (forced)" : "");
+            // Update "old" file descriptor statistics for proper maintenance
+            _mxDataFiles.lockRead();
+            _dataFiles[oldEntry.fileId]->deadBytes += (uint32_t)(sizeof(DataFileEntry) + keySize + keyIndexSize +
+                                                                 ((oldEntry.valueSize == DeletedEntry) ? 0 : oldEntry.valueSize));
+            _dataFiles[oldEntry.fileId]->deadEntries += 1;
+            _mxDataFiles.unlockRead();
         }
-    }
 
-    bool requestUpKeeping()
-    {
-        std::unique_lock<std::mutex> lk(_upkeepMutex);
-        if (_isInitialized && _upkeepWork.load() == false) {
-            _upkeepWork.store(true);
-            _upkeepCv.notify_one();
-            return true;
-        }
-        return false;
+        ++_stats.putCallQty;
+        return Status::Ok;
     }
 
-    bool isUpkeepingOnGoing() const { return _upkeepWork.load(); }
-
-    void upkeepThreadEntry()
+    Status privateRemove(uint64_t keyHash, const void* key, size_t keySize, bool forceDiskSync)
     {
         using namespace litecask::detail;
+        LatencyScope latencyScope(_latency, LatencyKind::Remove);
+        if (keySize == 0 || keySize >= USHRT_MAX) {
+            ++_stats.removeCallFailedQty;
+            return Status::BadKeySize;
+        }
 
-        // Upkeep service loop
-        while (!_upkeepExit.load()) {
-            // Wait for a upkeep period or explicit request
-            {
-                std::unique_lock<std::mutex> lk(_upkeepMutex);
-                _upkeepCv.wait_for(lk, std::chrono::milliseconds(_config.upkeepCyclePeriodMs),
-                                   [this] { return _upkeepExit.load() || _upkeepWork.load(); });
-                if (_upkeepExit.load()) continue;
-                _upkeepWork.store(false);
-            }
-
-            // Update the current date
-            updateNow();
-
-            // Write buffer flushing
-            uint64_t timeMs =
-                std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
-            if (timeMs - _upkeepLastActiveFlushedTimeMs > _config.writeBufferFlushPeriodMs) {
-                _mxActiveFile.lock();
-                _mxWriteBuffer.lockWrite();
-
-                // Flush only if no flush was performed since last check, and if there is something to flush
-                if (_activeFlushedDataOffset == _upkeepLastActiveFlushedDataOffset && _activeDataFileId == _upkeepLastActiveDataFileId &&
-                    _activeDataOffset - _activeFlushedDataOffset > 0) {
-                    flushWriteBufferUnlocked();
-                }
-                _upkeepLastActiveDataFileId        = _activeDataFileId;
-                _upkeepLastActiveFlushedDataOffset = _activeFlushedDataOffset;
-                _upkeepLastActiveFlushedTimeMs     = timeMs;
-                _mxWriteBuffer.unlockWrite();
-                _mxActiveFile.unlock();
-            }
-
-            // First priority: resize the key directory
-            if (_keyDir->isResizingOngoing()) {
-                log(LogLevel::Debug, "Resizing KeyDir in upkeep thread under work");
-                while (_keyDir->isResizingOngoing()) {
-                    // Transfer one batch of entries at a time
-                    _mxKeyDir.lock();
-                    _keyDir->backgroundResizeWork(_config.upkeepKeyDirBatchSize);
-                    _mxKeyDir.unlock();
-                    // Give air to writer threads
-                    std::this_thread::yield();
-                }
-                log(LogLevel::Debug, "Resizing KeyDir in upkeep thread finished");
-            }
-
-            // Second priority: Value cache upkeeping
-            _valueCache->backgroundUpdateLru(_config.upkeepValueCacheBatchSize);
-            _valueCache->backgroundPreventiveEviction(_config.upkeepValueCacheBatchSize);  // Ensures a free margin
+        uint32_t   checksum = (uint32_t)keyHash;
+        WriteLane& lane     = getWriteLane(keyHash);
 
-            uint32_t keyDirIndex  = 0;
-            uint32_t keyHash      = 0;
-            uint32_t keySize      = 0;
-            uint32_t oldValueSize = 0;
-            uint16_t oldFileId    = 0;
-            ValueLoc oldCacheLoc  = NotStored;
+        uint64_t lockStartNs = _latency.start();
+        lane.mxActiveFile.lock();
+        _latency.record(LatencyKind::ActiveFileLockWait, lockStartNs);
+        if (!_isInitialized) {
+            lane.mxActiveFile.unlock();
+            ++_stats.removeCallFailedQty;
+            return Status::StoreNotOpen;
+        }
 
-            // Third priority: cleaning of entries with expired TTL
-            uint32_t batchSize = _config.upkeepValueCacheBatchSize;
-            while (batchSize > 0) {
-                // Probe a KeyDir entry with expired TTL and remove the entry after checking it again under lock
-                if ((keyDirIndex = _keyDir->backgroundExpiredKeyCleaning(batchSize)) == NotStored) { continue; }
+        // Optional, but keeps the database cleaner in case of false removal
+        KeyChunk entry;
+        bool     isFound = _keyDir->find((uint32_t)keyHash, key, (uint16_t)keySize, entry);
+        if (!isFound || entry.valueSize == DeletedEntry) {
+            lane.mxActiveFile.unlock();
+            ++_stats.removeCallNotFoundQty;
+            return Status::EntryNotFound;
+        }
 
-                // Invalidate the entry iff valid and with an expired TTL. This time, under write lock.
-                _mxKeyDir.lock();
-                bool isReplacing = _keyDir->invalidateExpiredTtl(keyDirIndex, keyHash, keySize, oldValueSize, oldFileId, oldCacheLoc);
-                _mxKeyDir.unlock();
+        // Check that the limit of the data file size is not exceeded (taking into account the 64 overflow)
+        // The only exception is if we are at the beginning of a new file, so that any entry size can fit the data file
+        if (lane.activeDataOffset > 0 && (uint64_t)lane.activeDataOffset + sizeof(DataFileEntry) + (uint64_t)keySize >= _dataFileMaxBytes) {
+            createNewActiveDataFileUnlocked(lane);  // Now the "removal" entry can be written
+        }
 
-                if (!isReplacing) { continue; }
+        lockStartNs = _latency.start();
+        _mxDataFiles.lockRead();
+        _latency.record(LatencyKind::DataFilesLockWait, lockStartNs);
+        lcOsFileHandle fh = _dataFiles[lane.activeDataFileId]->handle;
+        assert(osIsValidHandle(fh));
 
-                // Remove the (potential) old value from the value cache
-                if (oldCacheLoc != NotStored && _valueCache->isEnabled()) { _valueCache->removeValue(oldCacheLoc, keyHash); }
+        // Write entry in the memory write buffer
+        lockStartNs = _latency.start();
+        lane.mxWriteBuffer.lockWrite();
+        _latency.record(LatencyKind::WriteBufferLockWait, lockStartNs);
+        if ((lane.activeDataOffset - lane.activeFlushedDataOffset) + (sizeof(DataFileEntry) + keySize) > lane.writeBuffer.size()) {
+            flushWriteBufferUnlocked(lane);  // After that, the write must succeed by design (write buffer big enough for 1 entry)
+        }
 
-                // Update the data file statistics
-                _mxDataFiles.lockRead();
-                _dataFiles[oldFileId]->deadBytes += (uint32_t)sizeof(DataFileEntry) + oldValueSize + keySize;
-                _dataFiles[oldFileId]->deadEntries += 1;
-                _mxDataFiles.unlockRead();
-            }
+        // Note: tombstone's keyIndexes are not stored on disk, but we need to keep the previous indexes in memory for the
+        //  following use case: remove an entry with indexes, then add it again with some identical indexes: we do not want doubles inside
+        //  index arrays
+        DataFileEntry dfe{checksum, 0, DeletedEntry, (uint16_t)keySize, 0, 0};
+        uint32_t      entryActiveDataOffset = lane.activeDataOffset;
+        uint16_t      entryActiveDataFileId = lane.activeDataFileId;
+        assert(lane.activeDataOffset >= lane.activeFlushedDataOffset);
 
-        }  // End of service loop
-    }
+        if ((lane.activeDataOffset - lane.activeFlushedDataOffset) + (sizeof(DataFileEntry) + keySize) <= lane.writeBuffer.size()) {
+            // Store in the write buffer
+            uint32_t dataOffset = lane.activeDataOffset - lane.activeFlushedDataOffset;
+            memcpy(&lane.writeBuffer[dataOffset], &dfe, sizeof(DataFileEntry));
+            memcpy(&lane.writeBuffer[dataOffset + sizeof(DataFileEntry)], key, keySize);
 
-    void mergeThreadEntry()
-    {
-        using namespace litecask::detail;
-        log(LogLevel::Debug, "Merge thread started");
+            // Update the active offset
+            lane.activeDataOffset += (uint32_t)(sizeof(DataFileEntry) + keySize);
+        }
 
-        // Merge service loop
-        while (!_mergeExit.load()) {
-            {
-                // Wait for a merge period or explicit request
-                std::unique_lock<std::mutex> lk(_mergeMutex);
-                _mergeCv.wait_for(lk, std::chrono::milliseconds(_config.mergeCyclePeriodMs),
-                                  [this] { return _mergeExit.load() || _mergeWork.load(); });
-                if (_mergeExit.load()) continue;
+        else {
+            // Too big entry: the write buffer has already been synced-flushed, and we directly write in the file
+            if (!osOsWrite(fh, &dfe, sizeof(DataFileEntry)) || !osOsWrite(fh, key, keySize)) {
+                fatalHandler("Remove: Unable to write the header and key (size=%" PRId64 ") in the datafile", keySize);
             }
 
-            log(LogLevel::Debug, "Merge process started");
+            // Update the offsets (flush also) after this unoptimized write
+            lane.activeDataOffset += (uint32_t)(sizeof(DataFileEntry) + keySize);
+            lane.activeFlushedDataOffset = lane.activeDataOffset;
+            updateFlushedWritePositionUnlocked(lane);
+        }
+        appendActiveHintEntryUnlocked(lane, entryActiveDataOffset, dfe, key, &NoKeyIndex);
 
-            // Snapshot the protected configuration
-            _mxConfig.lock();
-            Config c = _config;
-            _mxConfig.unlock();
-            ++_stats.mergeCycleQty;
+        uint64_t syncWritePosition = getActiveWritePositionUnlocked(lane);
+        lane.mxWriteBuffer.unlockWrite();
 
-            // Analyze the data files to select which ones to merge, if any
-            lcVector<MergeFileInfo> mergeInfos;
-            if (isItWorthMerging(c.mergeTriggerDataFileFragmentationPercentage, c.mergeTriggerDataFileDeadByteThreshold)) {
-                selectDataFilesToMerge(c.mergeSelectDataFileFragmentationPercentage, c.mergeSelectDataFileDeadByteThreshold,
-                                       c.mergeSelectDataFileSmallSizeTheshold, mergeInfos);
-            }
+        _dataFiles[entryActiveDataFileId]->tombBytes += (uint32_t)(sizeof(DataFileEntry) + keySize);
+        _dataFiles[entryActiveDataFileId]->tombEntries += 1;
+        _dataFiles[entryActiveDataFileId]->bytes += (uint32_t)(sizeof(DataFileEntry) + keySize);
+        _dataFiles[entryActiveDataFileId]->entries += 1;
 
-            if (!mergeInfos.empty()) {
-                // Mandatory switch of the active file for the following reasons:
-                //  - it ensures that the previous active file can be merged, as it was potentially selected
-                //  - it ensures that the naming of the new compacted data files is unique
-                _mxActiveFile.lock();
-                lcString mergeBasename = createNewActiveDataFileUnlocked();
-                _mxActiveFile.unlock();
+        _mxDataFiles.unlockRead();
+        lane.mxActiveFile.unlock();
 
-                // Create the new compacted data files from the selected files
-                createMergedDataFiles(mergeInfos, mergeBasename, c.dataFileMaxBytes);
+        notifyWrittenBytes(sizeof(DataFileEntry) + keySize);
+        if (forceDiskSync || _syncPolicy == SyncPolicy::PerWrite) {
+            waitForFlushedWritePosition(lane, syncWritePosition, _syncPolicy != SyncPolicy::None);
+        }
 
-                // Add the new data files, remove the old ones, and update the memory KeyDir
-                replaceDataFiles(mergeInfos);
+        // Update the KeyDir with a tombstone
+        std::mutex& mxKeyDirShard = _keyDir->getMutex((uint32_t)keyHash);
+        lockStartNs = _latency.start();
+        mxKeyDirShard.lock();
+        _latency.record(LatencyKind::KeyDirShardLockWait, lockStartNs);
+        OldKeyChunk oldEntry;
+        Status      storageStatus = _keyDir->insertEntry(
+                 (uint32_t)keyHash, key, &NoKeyIndex,
+                 {0, DeletedEntry, NotStored, entryActiveDataOffset, entryActiveDataFileId, (uint16_t)keySize, 0, 0, 0}, oldEntry);
+        mxKeyDirShard.unlock();
 
-                ++_stats.mergeCycleWithMergeQty;
+        if (storageStatus != Status::Ok) {
+            if (storageStatus == Status::OutOfMemory) {
+                // This error deserves a dedicated log message
+                // In this case, the run-time behavior of the database is compromised.
+                // The data files are however still correct and consistent, only the in-memory information is incomplete.
+                log(LogLevel::Error,
+                    "Unable to store the new key due to out of memory, the run-time integrity of the datastore is compromised (data files "
+                    "are  ok). You should stop and relaunch the application to recover it. If not enough, using tools to perform a full "
+                    "merge on the data to make it more compact could help.");
             }
+            return storageStatus;
+        }
 
-            if (_someHintFilesAreMissing) {
-                // This flag is set once at database opening, so this section will be run once too
-                _someHintFilesAreMissing = false;
-                for (uint32_t fileId = 0; fileId < _dataFiles.size(); ++fileId) {
-                    if (fileId == _activeDataFileId) continue;
-                    const DataFile* dfd          = _dataFiles[fileId];
-                    fs::path        hintFilename = fs::path(dfd->filename).replace_extension(HintFileSuffix);
-                    if (osIsValidHandle(dfd->handle) && !fs::exists(hintFilename)) {
-                        log(LogLevel::Debug, "Merge thread started");
-                        createHintFile(dfd->filename, hintFilename);
-                    }
-                    ++_stats.hintFileCreatedQty;
-                }
-            }
+        // Remove the (potential) old value from the value cache
+        if (oldEntry.isValid && oldEntry.cacheLocation != NotStored && _valueCache->isEnabled()) {
+            _valueCache->removeValue(oldEntry.cacheLocation, keyHash);
+        }
 
-            _mergeWork.store(false);  // Work finished
-        }                             // End of service loop
+        if (oldEntry.isValid) {
+            _mxDataFiles.lockRead();
+            _dataFiles[oldEntry.fileId]->deadBytes += (uint32_t)(sizeof(DataFileEntry) + oldEntry.valueSize + keySize);
+            _dataFiles[oldEntry.fileId]->deadEntries += 1;
+            _mxDataFiles.unlockRead();
+        }
 
-        log(LogLevel::Debug, "Merge thread stopped");
+        ++_stats.removeCallQty;
+        return Status::Ok;
     }
 
-    // File cleaning before opening the data store. The cleaning instructions comes from the file extension.
-    // Robustness comes from the atomic nature of some file operations (creation and renaming)
-    Status sanitizeAndCollectDataFiles(const fs::path& dbDirectory, uint64_t& maxDataFileIndex, lcVector<lcString>& baseDataFilenames)
+    template<typename ValueSink>
+    Status privateGet(uint64_t keyHash, const void* key, size_t keySize, ValueSink& sink, CacheHint cacheHint = CacheHint::Default)
     {
         using namespace litecask::detail;
-        fs::path dbDirectoryPath = dbDirectory / "";
-
-        baseDataFilenames.clear();
-        maxDataFileIndex = 1;
-        lcVector<DirEntry> entries;
-        if (!osGetDirContent(dbDirectoryPath, entries)) { return Status::CannotOpenStore; }
-
-        struct OrderedDataFiles {
-            lcString name;
-            double   index;
-        };
-        lcVector<OrderedDataFiles> orderedDataFiles;
-
-        for (const auto& e : entries) {
-            if (e.isDir) continue;
-            fs::path entryFilename = dbDirectoryPath / e.name;
+        LatencyScope latencyScope(_latency, LatencyKind::Get);
 
-            // Remove ".tmp" files which correspond to an unfinished merge due to a crash
-            if (entryFilename.extension() == TmpFileSuffix) {
-                log(LogLevel::Info, "Removing unfinished merge file %s", entryFilename.c_str());
-                osRemoveFile(entryFilename);
-            }
+        if (keySize == 0 || keySize >= USHRT_MAX) {  // Key size is anyway limited by 16 bits minus some meta data overhead
+            ++_stats.getCallFailedQty;
+            return Status::BadKeySize;
+        }
 
-            // Remove ".to_remove" tag files and associated data files, which is a cleanup of redundant file not removed due to a crash
-            else if (entryFilename.extension() == ToRemoveFileSuffix) {
-                log(LogLevel::Info, "Removing old data file %s", entryFilename.replace_extension(DataFileSuffix).string().c_str());
-                // First the data file (if exists)
-                osRemoveFile(entryFilename.replace_extension(DataFileSuffix));
-                // then the hint file (if exists)
-                osRemoveFile(entryFilename.replace_extension(HintFileSuffix));
-                // and last the removal instruction
-                osRemoveFile(entryFilename.replace_extension(ToRemoveFileSuffix));
-            }
+        uint64_t lockStartNs = _latency.start();
+        _mxDataFiles.lockRead();
+        _latency.record(LatencyKind::DataFilesLockWait, lockStartNs);
+        if (!_isInitialized) {
+            _mxDataFiles.unlockRead();
+            ++_stats.getCallFailedQty;
+            return Status::StoreNotOpen;
+        }
 
-            // Remove standalone hint files
-            else if (entryFilename.extension() == HintFileSuffix &&
-                     osGetFileSize(fs::path(entryFilename).replace_extension(DataFileSuffix)) <= 0) {
-                osRemoveFile(entryFilename);
-            }
+        KeyChunk entry{0, 0, 0, 0, 0, 0, 0, 0, 0};
+        bool     isFound = _keyDir->find((uint32_t)keyHash, key, (uint16_t)keySize, entry);
 
-            // Remove zero sized data files
-            else if (entryFilename.extension() == DataFileSuffix && osGetFileSize(entryFilename) == 0) {
-                log(LogLevel::Info, "Removing zero size data file %s", entryFilename.c_str());
-                osRemoveFile(entryFilename);
-            }
+        if (!isFound || entry.valueSize == DeletedEntry) {
+            _mxDataFiles.unlockRead();
+            ++_stats.getCallNotFoundQty;
+            return Status::EntryNotFound;
+        }
+        assert(entry.fileId < _dataFiles.size());
 
-            // List the data files
-            else if (entryFilename.extension() == DataFileSuffix) {
-                // Get the data file number as "double" (decimals created by merge process), as their order matters
-                double fileNumber = strtod(entryFilename.stem().string().c_str(), nullptr);
-                if (fileNumber > 0.) {
-                    // Store the data file basename in the list
-                    orderedDataFiles.push_back({entryFilename.replace_extension("").string(), fileNumber});
-                    // Get the highest file number
-                    if ((uint64_t)fileNumber > maxDataFileIndex) { maxDataFileIndex = (uint64_t)fileNumber; }
+        // A value in a blob file is read from its reference, which is output as the stored value. The locks are released meanwhile
+        if (entry.flags & EntryFlagBlob) {
+            BlobRefSink refSink;
+            Status      status = getFoundValue(keyHash, key, keySize, entry, refSink, cacheHint);
+            if (status != Status::Ok) { return status; }
+            --_stats.getCallQty;  // Counted once the value is read from the blob file
+
+            status = readBlobValue(sink, refSink.blobRef);
+            if (status == Status::EntryNotFound) {
+                // The blob file is removed by the merge only if the entry is obsolete. Else it has been lost
+                KeyChunk currentEntry;
+                if (!_keyDir->find((uint32_t)keyHash, key, (uint16_t)keySize, currentEntry) || currentEntry.fileId != entry.fileId ||
+                    currentEntry.fileOffset != entry.fileOffset) {
+                    return privateGet(keyHash, key, keySize, sink, cacheHint);
                 }
+                status = Status::EntryCorrupted;
             }
+            if (status != Status::Ok) { return countFailedGet(status); }
+            ++_stats.getCallQty;
+            return Status::Ok;
         }
-
-        // Fill the output list of ordered data files (oldest data files first)
-        std::sort(orderedDataFiles.begin(), orderedDataFiles.end(),
-                  [](const OrderedDataFiles& a, const OrderedDataFiles& b) { return a.index < b.index; });
-        baseDataFilenames.reserve(orderedDataFiles.size());
-        for (const auto& e : orderedDataFiles) baseDataFilenames.push_back(e.name);
-
-        return Status::Ok;
+        return getFoundValue(keyHash, key, keySize, entry, sink, cacheHint);
     }
 
-    bool createHintFile(const lcString& readDataFilename, const fs::path& writeHintFilename)
+    // Outputs the stored value of a found entry. The data file read lock shall be taken by the caller, and it is released here
+    template<typename ValueSink>
+    Status getFoundValue(uint64_t keyHash, const void* key, size_t keySize, const detail::KeyChunk& entry, ValueSink& sink,
+                         CacheHint cacheHint)
     {
         using namespace litecask::detail;
-        log(LogLevel::Info, "Creating hint file for %s", readDataFilename.c_str());
-
-        // We use fopen/fread/fwrite here because of standard usage and the provided buffering
-        FILE* fhr = osFopen(readDataFilename, "rb");
-        assert(fhr);
-        FILE* fhw = osFopen(writeHintFilename.string() + TmpFileSuffix, "wb");
-        assert(fhw);
-
-        DataFileEntry     header;
-        lcVector<uint8_t> buf(1024);
-        bool              isOk          = true;
-        uint32_t          fileOffset    = 0;
-        uint32_t          fileIncrement = 0;
-
-        while (fread(&header, sizeof(DataFileEntry), 1, fhr) == 1) {
-            uint32_t keySize      = header.keySize;
-            uint32_t keyIndexSize = header.keyIndexSize;
-            uint32_t valueSize    = header.valueSize;
 
-            if (keySize == 0) {
-                log(LogLevel::Error, "Cannot create the hint file for %s: a key in the data file has a null (=corrupted) size",
-                    readDataFilename.c_str());
-                isOk = false;
-                break;
+        // The size of a compressed value is known only after its decompression
+        bool isCompressed = (entry.flags & EntryFlagCompressed);
+        if (!isCompressed && !sink.accept(entry.valueSize)) {
+            _mxDataFiles.unlockRead();
+            ++_stats.getCallFailedQty;
+            return Status::BufferTooSmall;
+        }
+
+        // Check the write buffer of the lane of this key
+        detail::WriteLane& lane = getWriteLane(keyHash);
+        if (entry.fileId == lane.activeDataFileId) {  // If it is different, it cannot be equal afterwards. And we avoid a lock on main path
+            uint64_t lockStartNs = _latency.start();
+            lane.mxWriteBuffer.lockRead();
+            _latency.record(LatencyKind::WriteBufferLockWait, lockStartNs);
+            if (entry.fileId == lane.activeDataFileId && entry.fileOffset >= lane.activeFlushedDataOffset &&
+                entry.fileOffset - lane.activeFlushedDataOffset < lane.writeBuffer.size()) {
+                size_t valueOffset  = (entry.fileOffset - lane.activeFlushedDataOffset) + sizeof(DataFileEntry) + keySize +
+                                     entry.keyIndexSize;
+                Status outputStatus = outputStoredValue(sink, &lane.writeBuffer[valueOffset], entry.valueSize, entry.flags);
+                lane.mxWriteBuffer.unlockRead();
+                _mxDataFiles.unlockRead();
+                if (outputStatus != Status::Ok) { return countFailedGet(outputStatus); }
+                ++_stats.getCallQty;
+                ++_stats.getWriteBufferHitQty;
+                return Status::Ok;
             }
+            lane.mxWriteBuffer.unlockRead();
+        }
 
-            if (keyIndexSize > MaxKeyIndexQty * sizeof(KeyIndex)) {
-                log(LogLevel::Error, "Cannot create the hint file for %s: a key has too big index (byte size=%d > %" PRId64 ")",
-                    readDataFilename.c_str(), keyIndexSize, MaxKeyIndexQty * sizeof(KeyIndex));
-                break;
+        // Check the cache
+        if (_valueCache->isEnabled()) {
+            Status outputStatus = Status::Ok;
+            bool   isInTheCache = _valueCache->visitValue(entry.cacheLocation, keyHash, entry.valueSize,
+                                                          [&](const uint8_t* value, uint32_t valueSize) {
+                                                            outputStatus = outputStoredValue(sink, value, valueSize, entry.flags);
+                                                        });
+            if (isInTheCache) {
+                _mxDataFiles.unlockRead();
+                if (outputStatus != Status::Ok) { return countFailedGet(outputStatus); }
+                ++_stats.getCallQty;
+                ++_stats.getCacheHitQty;
+                return Status::Ok;
             }
+        }
 
-            if (valueSize == DeletedEntry) {
-                // Tombstone case (no key index stored)
-                if (buf.size() < keySize) buf.resize(keySize);
-                if (fread(buf.data(), 1, keySize, fhr) != keySize) {
-                    log(LogLevel::Error,
-                        "Cannot create the hint file for %s: unable to read all the bytes (%d) of the deleted key at file offset %u",
-                        readDataFilename.c_str(), keySize, fileOffset);
-                    isOk = false;
-                    break;
-                }
-                keyIndexSize  = 0;
-                fileIncrement = sizeof(DataFileEntry) + keySize;
-            }
+        // Some output adapters perform the disk read by themselves (asynchronous read)
+        if (!isCompressed && sink.delegateDiskRead(key, keySize, keyHash, entry)) {
+            _mxDataFiles.unlockRead();
+            return Status::Ok;
+        }
 
-            else {
-                uint32_t allSize = keySize + keyIndexSize + valueSize;
-                if (buf.size() < allSize) buf.resize(allSize);
-                if (fread(buf.data(), 1, allSize, fhr) != allSize) {
-                    log(LogLevel::Error,
-                        "Cannot create the hint file for %s: unable to read all the bytes (%d) of the key and value at file offset %u",
-                        readDataFilename.c_str(), allSize, fileOffset);
-                    isOk = false;
-                    break;
-                }
-                fileIncrement = (uint32_t)sizeof(DataFileEntry) + allSize;
-            }
+        // Load the value. The header, key and indexes are read in a per-thread buffer and the value directly in the output buffer,
+        // so that no memmove is required afterwards. A compressed value is read in a per-thread buffer and decompressed in the output
+        thread_local static lcVector<uint8_t> headerBuffer;
+        thread_local static lcVector<uint8_t> compressedBuffer;
+        uint32_t                              headerSize = (uint32_t)sizeof(DataFileEntry) + (uint32_t)keySize + entry.keyIndexSize;
+        if (headerBuffer.size() < headerSize) { headerBuffer.resize(headerSize); }
+        if (isCompressed && compressedBuffer.size() < entry.valueSize) { compressedBuffer.resize(entry.valueSize); }
+        uint8_t* value = isCompressed ? compressedBuffer.data() : sink.getReadBuffer(entry.valueSize);
+
+        DataFile*      dfd = _dataFiles[entry.fileId];
+        lcOsFileHandle fh  = dfd->handle;
+        assert(osIsValidHandle(fh));
+        uint64_t readStartNs = _latency.start();
+        bool     isReadOk    = osOsRead2(fh, headerBuffer.data(), headerSize, value, entry.valueSize, entry.fileOffset);
+        _latency.record(LatencyKind::GetDiskRead, readStartNs);
+        _mxDataFiles.unlockRead();
+        ++_stats.getCallDiskReadQty;
 
-            HintFileEntry hfe{fileOffset, header.expTimeSec, valueSize, (uint16_t)keySize, (uint8_t)keyIndexSize, 0};
-            if (fwrite(&hfe, sizeof(HintFileEntry), 1, fhw) != 1 ||
-                fwrite(buf.data(), 1, keySize + keyIndexSize, fhw) != keySize + keyIndexSize) {
-                log(LogLevel::Error, "Cannot create the hint file for %s: unable to write the hint entry (size=%" PRId64 ")",
-                    readDataFilename.c_str(), sizeof(HintFileEntry) + keySize + keyIndexSize);
-                isOk = false;
-                break;
-            }
+        // Check the value consistency. Read errors are caught here too
+        DataFileEntry header;
+        memcpy(&header, headerBuffer.data(), sizeof(DataFileEntry));
+        uint32_t checksum = (uint32_t)(keyHash ^ LITECASK_HASH_FUNC(value, entry.valueSize));
+        if (!isReadOk || checksum != header.checksum) {
+            ++_stats.getCallCorruptedQty;
+            return Status::EntryCorrupted;
+        }
+        if (isStoredKeyMismatch(headerBuffer.data() + sizeof(DataFileEntry), key, keySize)) {
+            ++_stats.getCallNotFoundQty;
+            return Status::EntryNotFound;
+        }
 
-            fileOffset += fileIncrement;
+        if (isCompressed) {
+            Status outputStatus = outputStoredValue(sink, value, entry.valueSize, entry.flags);
+            if (outputStatus != Status::Ok) { return countFailedGet(outputStatus); }
+        } else {
+            sink.commitRead(value, entry.valueSize);
         }
 
-        fclose(fhw);
-        fclose(fhr);
+        if (_valueCache->isEnabled() && cacheHint != CacheHint::NoCache) {
+            // Store the value in the cache
+            ValueLoc cacheLoc = _valueCache->insertValue(value, entry.valueSize, keyHash, entry.expTimeSec);
 
-        if (isOk) {
-            [[maybe_unused]] bool isRenamingOk = osRenameFile(writeHintFilename.string() + TmpFileSuffix, writeHintFilename);
-            assert(isRenamingOk);
+            // The change counter avoids the ABA problem between the entry insertion above and the cache update here
+            // If valueSize or changeCounter do not match, the cache entry is wasted but it will be later evicted anyway
+            std::mutex& mxKeyDirShard = _keyDir->getMutex((uint32_t)keyHash);
+            mxKeyDirShard.lock();
+            _keyDir->updateCachedValueLocation((uint32_t)keyHash, key, (uint16_t)keySize, entry.valueSize, entry.changeCounter, cacheLoc);
+            mxKeyDirShard.unlock();
         }
-        return isOk;
+
+        ++_stats.getCallQty;
+        return Status::Ok;
     }
 
-    bool loadHintFile(const lcString& hintFilename, uint16_t fileId, ArenaAllocator& loadArena,
-                      lcVector<detail::LoadedKeyChunk>& keyEntries)
+    template<typename KeyContainer>
+    Status privateGetBatch(const lcVector<KeyContainer>& keys, lcVector<lcVector<uint8_t>>& values, lcVector<Status>& statuses)
     {
         using namespace litecask::detail;
-        log(LogLevel::Debug, "Loading hint file %s", hintFilename.c_str());
+        LatencyScope latencyScope(_latency, LatencyKind::GetBatch);
 
-        keyEntries.clear();
-        loadArena.reset();
+        struct DiskEntry {
+            uint32_t keyIdx;
+            uint16_t fileId;
+            uint32_t fileOffset;
+            uint32_t entryBytes;
+        };
+        struct DiskRead {
+            uint16_t fileId;
+            uint32_t fileOffset;
+            uint32_t bytes;
+            size_t   bufferOffset;
+            bool     isReadOk;
+        };
 
-        // We use fopen/fread/fwrite here because of standard usage and the provided buffering
-        int64_t fileSize = osGetFileSize(hintFilename);
-        if (fileSize <= 0) { return false; }
-        FILE* fh = osFopen(hintFilename, "rb");
-        if (!fh) { return false; }
+        values.resize(keys.size());
+        statuses.resize(keys.size());
+        lcVector<KeyChunk>  entries(keys.size());
+        lcVector<uint64_t>  keyHashes(keys.size());
+        lcVector<DiskEntry> diskEntries;
 
-        // Loading fully the hint file in one call, as we need anyway the key and keyindexes
-        uint8_t* buf = loadArena.allocate(fileSize);
-        assert(buf && "The hint file is too big");
-        size_t readSize = fread(buf, 1, fileSize, fh);
-        fclose(fh);
+        _mxDataFiles.lockRead();
+        if (!_isInitialized) {
+            _mxDataFiles.unlockRead();
+            ++_stats.getBatchCallFailedQty;
+            return Status::StoreNotOpen;
+        }
 
-        HintFileEntry header;
-        bool          isOk       = true;
-        size_t        readOffset = 0;
+        // Resolve all keys, and serve the write buffer and cache hits
+        for (uint32_t keyIdx = 0; keyIdx < keys.size(); ++keyIdx) {
+            const KeyContainer& key     = keys[keyIdx];
+            lcVector<uint8_t>&  value   = values[keyIdx];
+            size_t              keySize = key.size();
+            value.clear();
 
-        while (isOk && readOffset + sizeof(HintFileEntry) < readSize) {
-            // Copy due to uncontrolled alignment
-            memcpy(&header, &buf[readOffset], sizeof(HintFileEntry));
+            if (keySize == 0 || keySize >= USHRT_MAX) {
+                statuses[keyIdx] = Status::BadKeySize;
+                ++_stats.getCallFailedQty;
+                continue;
+            }
 
-            // Parse the header
-            if (header.keySize == 0) {
-                log(LogLevel::Error, "Cannot load the hint file %s: a key has a null (=corrupted) size", hintFilename.c_str());
-                isOk = false;
-                break;
+            uint64_t  keyHash = LITECASK_HASH_FUNC(key.data(), keySize);
+            KeyChunk& entry   = entries[keyIdx];
+            keyHashes[keyIdx] = keyHash;
+            if (!_keyDir->find((uint32_t)keyHash, key.data(), (uint16_t)keySize, entry) || entry.valueSize == DeletedEntry) {
+                statuses[keyIdx] = Status::EntryNotFound;
+                ++_stats.getCallNotFoundQty;
+                continue;
+            }
+            assert(entry.fileId < _dataFiles.size());
+            statuses[keyIdx] = Status::Ok;
+
+            WriteLane& lane = getWriteLane(keyHash);
+            if (entry.fileId == lane.activeDataFileId) {
+                lane.mxWriteBuffer.lockRead();
+                if (entry.fileId == lane.activeDataFileId && entry.fileOffset >= lane.activeFlushedDataOffset &&
+                    entry.fileOffset - lane.activeFlushedDataOffset < lane.writeBuffer.size()) {
+                    const uint8_t*  src = &lane.writeBuffer[entry.fileOffset - lane.activeFlushedDataOffset + sizeof(DataFileEntry) +
+                                                           keySize + entry.keyIndexSize];
+                    VectorValueSink sink{value};
+                    statuses[keyIdx] = outputStoredValue(sink, src, entry.valueSize, entry.flags);
+                    lane.mxWriteBuffer.unlockRead();
+                    if (statuses[keyIdx] != Status::Ok) {
+                        countFailedGet(statuses[keyIdx]);
+                        continue;
+                    }
+                    ++_stats.getCallQty;
+                    ++_stats.getWriteBufferHitQty;
+                    continue;
+                }
+                lane.mxWriteBuffer.unlockRead();
             }
 
-            if (header.keyIndexSize > MaxKeyIndexQty * sizeof(KeyIndex)) {
-                log(LogLevel::Error, "Cannot read the hint file %s: an index has a too big value (byte size=%d > %" PRId64 ")",
-                    hintFilename.c_str(), header.keyIndexSize, MaxKeyIndexQty * sizeof(KeyIndex));
-                isOk = false;
-                break;
+            if (_valueCache->isEnabled()) {
+                VectorValueSink sink{value};
+                auto            visitor = [&](const uint8_t* cachedValue, uint32_t cachedValueSize) {
+                    statuses[keyIdx] = outputStoredValue(sink, cachedValue, cachedValueSize, entry.flags);
+                };
+                bool isInTheCache = _valueCache->visitValue(entry.cacheLocation, keyHash, entry.valueSize, visitor);
+                if (isInTheCache) {
+                    if (statuses[keyIdx] != Status::Ok) {
+                        countFailedGet(statuses[keyIdx]);
+                        continue;
+                    }
+                    ++_stats.getCallQty;
+                    ++_stats.getCacheHitQty;
+                    continue;
+                }
             }
 
-            if (header.keyIndexSize & 0x1) {
-                log(LogLevel::Error, "Cannot read the hint file %s: an index has an odd size (byte size=%d)", hintFilename.c_str(),
-                    header.keyIndexSize);
-                break;
+            diskEntries.push_back(
+                {keyIdx, entry.fileId, entry.fileOffset, (uint32_t)(sizeof(DataFileEntry) + keySize + entry.keyIndexSize + entry.valueSize)});
+        }
+
+        // Sort the disk accesses by location and coalesce the close ones
+        std::sort(diskEntries.begin(), diskEntries.end(), [](const DiskEntry& a, const DiskEntry& b) {
+            return (a.fileId < b.fileId) || (a.fileId == b.fileId && a.fileOffset < b.fileOffset);
+        });
+        lcVector<DiskRead> diskReads;
+        lcVector<uint32_t> entryReadIdx(diskEntries.size());
+        size_t             readBufferSize = 0;
+        for (uint32_t i = 0; i < diskEntries.size(); ++i) {
+            const DiskEntry& de = diskEntries[i];
+            if (!diskReads.empty()) {
+                DiskRead& dr      = diskReads.back();
+                uint32_t  readEnd = dr.fileOffset + dr.bytes;
+                uint32_t  newEnd  = std::max(readEnd, de.fileOffset + de.entryBytes);
+                if (dr.fileId == de.fileId && de.fileOffset <= readEnd + GetBatchMaxReadGapBytes &&
+                    newEnd - dr.fileOffset <= GetBatchMaxReadBytes) {
+                    readBufferSize += newEnd - readEnd;
+                    dr.bytes        = newEnd - dr.fileOffset;
+                    entryReadIdx[i] = (uint32_t)diskReads.size() - 1;
+                    continue;
+                }
+            }
+            diskReads.push_back({de.fileId, de.fileOffset, de.entryBytes, readBufferSize, false});
+            readBufferSize += de.entryBytes;
+            entryReadIdx[i] = (uint32_t)diskReads.size() - 1;
+        }
+
+        // Perform the disk reads, asynchronously or concurrently if they are numerous
+        lcVector<uint8_t> readBuffer(readBufferSize);
+        bool              isAsyncRead = false;
+#if LITECASK_IO_URING_ENABLED
+        if (diskReads.size() > 1 && _asyncReader.isStarted()) {
+            lcVector<AsyncReader::Request>  requests(diskReads.size());
+            lcVector<AsyncReader::Request*> requestPtrs(diskReads.size());
+            std::mutex                      completionMutex;
+            std::condition_variable         completionCv;
+            uint32_t                        remainingReadQty = (uint32_t)diskReads.size();
+            for (uint32_t readIdx = 0; readIdx < diskReads.size(); ++readIdx) {
+                DiskRead&             dr = diskReads[readIdx];
+                AsyncReader::Request& r  = requests[readIdx];
+                r.handle                 = _dataFiles[dr.fileId]->handle;
+                r.fileOffset             = dr.fileOffset;
+                r.iov[0]                 = {&readBuffer[dr.bufferOffset], dr.bytes};
+                r.onCompletion           = [&, readIdx](bool isReadOk) {
+                    diskReads[readIdx].isReadOk = isReadOk;
+                    std::lock_guard<std::mutex> lk(completionMutex);
+                    if (--remainingReadQty == 0) { completionCv.notify_one(); }
+                };
+                requestPtrs[readIdx] = &r;
+            }
+            // All requests are completed, even the ones which could not be submitted. In this case, all reads are synchronously redone
+            isAsyncRead = _asyncReader.submit(requestPtrs.data(), (uint32_t)requestPtrs.size());
+            std::unique_lock<std::mutex> lk(completionMutex);
+            completionCv.wait(lk, [&] { return remainingReadQty == 0; });
+        }
+#endif
+        if (!isAsyncRead) {
+            std::atomic<uint32_t> nextReadIdx{0};
+            auto                  readWorker = [&]() {
+                for (uint32_t readIdx = nextReadIdx++; readIdx < diskReads.size(); readIdx = nextReadIdx++) {
+                    DiskRead&      dr = diskReads[readIdx];
+                    lcOsFileHandle fh = _dataFiles[dr.fileId]->handle;
+                    assert(osIsValidHandle(fh));
+                    dr.isReadOk = osOsRead(fh, &readBuffer[dr.bufferOffset], dr.bytes, dr.fileOffset);
+                }
+            };
+            uint32_t readerQty = std::min(GetBatchMaxReadThreads, (uint32_t)diskReads.size() / GetBatchReadsPerThread);
+            _getBatchReadPool.run(readWorker, (readerQty > 1) ? readerQty - 1 : 0);
+        }
+        _mxDataFiles.unlockRead();
+        _stats.getBatchDiskReadQty += diskReads.size();
+
+        // Check and output the values read from disk
+        lcVector<ValueLoc> cacheLocs;
+        if (_valueCache->isEnabled()) { cacheLocs.resize(diskEntries.size(), NotStored); }
+        for (uint32_t i = 0; i < diskEntries.size(); ++i) {
+            const DiskEntry& de          = diskEntries[i];
+            const DiskRead&  dr          = diskReads[entryReadIdx[i]];
+            const KeyChunk&  entry       = entries[de.keyIdx];
+            const uint8_t*   entryBuffer = &readBuffer[dr.bufferOffset + (de.fileOffset - dr.fileOffset)];
+            const uint8_t*   valuePtr    = entryBuffer + de.entryBytes - entry.valueSize;
+
+            DataFileEntry header;
+            memcpy(&header, entryBuffer, sizeof(DataFileEntry));
+            uint32_t checksum = (uint32_t)(keyHashes[de.keyIdx] ^ LITECASK_HASH_FUNC(valuePtr, entry.valueSize));
+            if (!dr.isReadOk || checksum != header.checksum) {
+                statuses[de.keyIdx] = Status::EntryCorrupted;
+                ++_stats.getCallCorruptedQty;
+                continue;
+            }
+            if (isStoredKeyMismatch(entryBuffer + sizeof(DataFileEntry), keys[de.keyIdx].data(), keys[de.keyIdx].size())) {
+                statuses[de.keyIdx] = Status::EntryNotFound;
+                ++_stats.getCallNotFoundQty;
+                continue;
             }
+            VectorValueSink sink{values[de.keyIdx]};
+            statuses[de.keyIdx] = outputStoredValue(sink, valuePtr, entry.valueSize, entry.flags);
+            if (statuses[de.keyIdx] != Status::Ok) {
+                countFailedGet(statuses[de.keyIdx]);
+                continue;
+            }
+            ++_stats.getCallQty;
 
-            size_t entrySize = sizeof(HintFileEntry) + (int)header.keySize + (int)header.keyIndexSize;
-            if (readOffset + entrySize > readSize) {
-                log(LogLevel::Warn, "The hint file %s is corrupted", hintFilename.c_str());
-                break;  // End of file reached (and corrupted last entry)
+            if (_valueCache->isEnabled()) {
+                cacheLocs[i] = _valueCache->insertValue(valuePtr, entry.valueSize, keyHashes[de.keyIdx], entry.expTimeSec);
             }
-            uint8_t* key        = &buf[readOffset + sizeof(HintFileEntry)];
-            uint64_t keyHash    = LITECASK_HASH_FUNC(key, header.keySize);
-            uint8_t* keyIndexes = key + header.keySize;
+        }
 
-            // Note: the key and keyIndexes pointers are persistent in the memory arena (until it is reset)
-            // The changeCounter initialized with the readOffset is to provide some spreading for the initial value
-            keyEntries.push_back({{header.expTimeSec, header.valueSize, NotStored, header.fileOffset, fileId, header.keySize,
-                                   header.keyIndexSize, (uint8_t)readOffset},
-                                  (uint32_t)keyHash,
-                                  key,
-                                  keyIndexes});
-            readOffset += entrySize;
+        // Update the cache locations in the KeyDir, with one lock per shard
+        if (_valueCache->isEnabled() && !diskEntries.empty()) {
+            for (uint32_t shardIdx = 0; shardIdx < detail::KeyDirShardQty; ++shardIdx) {
+                detail::KeyDirShard& shard    = _keyDir->getShard(shardIdx);
+                bool                 isLocked = false;
+                for (uint32_t i = 0; i < diskEntries.size(); ++i) {
+                    uint32_t keyHash = (uint32_t)keyHashes[diskEntries[i].keyIdx];
+                    if (cacheLocs[i] == NotStored || detail::ShardedKeyDir::getShardIndex(keyHash) != shardIdx) { continue; }
+                    if (!isLocked) {
+                        shard.mx.lock();
+                        isLocked = true;
+                    }
+                    const KeyContainer& key   = keys[diskEntries[i].keyIdx];
+                    const KeyChunk&     entry = entries[diskEntries[i].keyIdx];
+                    shard.map.updateCachedValueLocation(keyHash, key.data(), (uint16_t)key.size(), entry.valueSize, entry.changeCounter,
+                                                        cacheLocs[i]);
+                }
+                if (isLocked) { shard.mx.unlock(); }
+            }
         }
 
-        return isOk;
+        // The values in blob files are read from their reference, which has been output as the stored value
+        for (uint32_t keyIdx = 0; keyIdx < keys.size(); ++keyIdx) {
+            if (statuses[keyIdx] != Status::Ok || (entries[keyIdx].flags & EntryFlagBlob) == 0) { continue; }
+            BlobRef blobRef{0, 0, 0};
+            if (values[keyIdx].size() == sizeof(BlobRef)) { memcpy(&blobRef, values[keyIdx].data(), sizeof(BlobRef)); }
+            VectorValueSink sink{values[keyIdx]};
+            --_stats.getCallQty;  // Counted by the 'get' below, or once the value is read from the blob file
+            statuses[keyIdx] = readBlobValue(sink, blobRef);
+            if (statuses[keyIdx] == Status::EntryNotFound) {
+                // Removed blob file: the entry has been replaced meanwhile, or the blob file is lost
+                statuses[keyIdx] = privateGet(keyHashes[keyIdx], keys[keyIdx].data(), keys[keyIdx].size(), sink);
+                continue;
+            }
+            if (statuses[keyIdx] != Status::Ok) {
+                countFailedGet(statuses[keyIdx]);
+                continue;
+            }
+            ++_stats.getCallQty;
+        }
+
+        ++_stats.getBatchCallQty;
+        return Status::Ok;
     }
 
     bool loadDataFile(const lcString& dataFilename, uint16_t fileId, ArenaAllocator& loadArena,
@@ -4701,7 +10099,7 @@ class Datastore  // NOLINT(clang-analyzer-optin.performance.Padding)  Padding is
                         dataFilename.c_str(), keySize + keyIndexSize + valueSize, fileOffset);
                     break;
                 }
-                valueHash     = LITECASK_HASH_FUNC(&buf[keySize], valueSize);
+                valueHash     = LITECASK_HASH_FUNC(&buf[keySize + keyIndexSize], valueSize);
                 fileIncrement = (uint32_t)sizeof(DataFileEntry) + keySize + keyIndexSize + valueSize;
             }
 
@@ -4734,7 +10132,8 @@ class Datastore  // NOLINT(clang-analyzer-optin.performance.Padding)  Padding is
             }
             // The changeCounter initialized with the checksum is to provide some spreading for the initial value
             keyEntries.push_back(
-                {{header.expTimeSec, valueSize, NotStored, fileOffset, fileId, (uint16_t)keySize, (uint8_t)keyIndexSize, (uint8_t)checksum},
+                {{header.expTimeSec, valueSize, NotStored, fileOffset, fileId, (uint16_t)keySize, (uint8_t)keyIndexSize, (uint8_t)checksum,
+                  header.flags},
                  (uint32_t)keyHash,
                  key,
                  keyIndexes});
@@ -4746,18 +10145,391 @@ class Datastore  // NOLINT(clang-analyzer-optin.performance.Padding)  Padding is
         return isOk;
     }
 
-    void flushWriteBufferUnlocked()
+    // Inserts in the index map only the key indexes which are not present in the old entry list.
+    // Run time is O(N) as lists are sorted. The "index map" write lock must be taken before the call
+    void insertNewKeyIndexesUnlocked(const uint8_t* key, const KeyIndex* keyIndexes, size_t keyIndexQty, uint32_t keyHash,
+                                     const detail::OldKeyChunk& oldEntry)
+    {
+        int lastOldIdx = 0;
+        for (size_t i = 0; i < keyIndexQty; ++i) {
+            const KeyIndex& ki    = keyIndexes[i];
+            bool            doAdd = !oldEntry.isValid;
+            if (!doAdd) {
+                while (lastOldIdx < oldEntry.keyIndexQty &&
+                       (oldEntry.keyIndexes[lastOldIdx].startIdx < ki.startIdx ||
+                        (oldEntry.keyIndexes[lastOldIdx].startIdx == ki.startIdx && oldEntry.keyIndexes[lastOldIdx].size < ki.size))) {
+                    ++lastOldIdx;
+                }
+                doAdd = (lastOldIdx >= oldEntry.keyIndexQty || oldEntry.keyIndexes[lastOldIdx].startIdx != ki.startIdx ||
+                         oldEntry.keyIndexes[lastOldIdx].size != ki.size);
+            }
+            if (doAdd) { _indexMap->insertIndex(key + ki.startIdx, ki.size, keyHash); }
+        }
+    }
+
+    // The "write buffer" write lock of the lane must be taken before the call
+    void flushWriteBufferUnlocked(detail::WriteLane& lane)
     {
-        assert(_activeDataOffset >= _activeFlushedDataOffset);
-        if (_activeDataOffset - _activeFlushedDataOffset > 0) {
-            lcOsFileHandle fh = _dataFiles[_activeDataFileId]->handle;
+        assert(lane.activeDataOffset >= lane.activeFlushedDataOffset);
+        if (lane.activeDataOffset - lane.activeFlushedDataOffset > 0) {
+            detail::LatencyScope latencyScope(_latency, LatencyKind::WriteBufferFlush);
+            lcOsFileHandle fh = _dataFiles[lane.activeDataFileId]->handle;
             assert(osIsValidHandle(fh));
-            if (!osOsWrite(fh, _writeBuffer.data(), _activeDataOffset - _activeFlushedDataOffset)) {
+            if (!osOsWrite(fh, lane.writeBuffer.data(), lane.activeDataOffset - lane.activeFlushedDataOffset)) {
                 fatalHandler("flushWriteBufferUnlocked: Unable to flush the write buffer (size=%d)",
-                             _activeDataOffset - _activeFlushedDataOffset);
+                             lane.activeDataOffset - lane.activeFlushedDataOffset);
+            }
+            lane.activeFlushedDataOffset = lane.activeDataOffset;
+            updateFlushedWritePositionUnlocked(lane);
+        }
+    }
+
+    // The "write buffer" lock of the lane must be taken before the call
+    static uint64_t getActiveWritePositionUnlocked(const detail::WriteLane& lane)
+    {
+        return ((uint64_t)lane.activeDataFileSeq << 32) | lane.activeDataOffset;
+    }
+
+    // The "write buffer" write lock of the lane must be taken before the call
+    static void updateFlushedWritePositionUnlocked(detail::WriteLane& lane)
+    {
+        lane.flushedWritePosition.store(((uint64_t)lane.activeDataFileSeq << 32) | lane.activeFlushedDataOffset);
+    }
+
+    static void updateSyncedWritePosition(detail::WriteLane& lane, uint64_t writePosition)
+    {
+        uint64_t previousPosition = lane.syncedWritePosition.load();
+        while (previousPosition < writePosition && !lane.syncedWritePosition.compare_exchange_weak(previousPosition, writePosition)) {}
+    }
+
+    // Group commit: waits until the provided write position is flushed on disk (and synced at OS level if 'withOsSync' is true).
+    // The first waiting writer becomes the leader and flushes the write buffer, which contains the entries of all the writers
+    // which wrote in the meantime. The other writers wait for the end of this flush and are released if their position is covered.
+    void waitForFlushedWritePosition(detail::WriteLane& lane, uint64_t writePosition, bool withOsSync)
+    {
+        std::atomic<uint64_t>& durablePosition = withOsSync ? lane.syncedWritePosition : lane.flushedWritePosition;
+        if (durablePosition.load() >= writePosition) { return; }
+
+        std::unique_lock<std::mutex> lk(lane.groupCommitMutex);
+        while (durablePosition.load() < writePosition) {
+            if (lane.isGroupCommitFlushOngoing) {
+                lane.groupCommitCv.wait(lk);
+                continue;
+            }
+
+            // Leader
+            lane.isGroupCommitFlushOngoing = true;
+            lk.unlock();
+            if (withOsSync) {
+                syncActiveDataFile(lane);
+            } else {
+                _mxDataFiles.lockRead();
+                lane.mxWriteBuffer.lockWrite();
+                flushWriteBufferUnlocked(lane);
+                lane.mxWriteBuffer.unlockWrite();
+                _mxDataFiles.unlockRead();
+            }
+            ++_stats.groupCommitFlushQty;
+            lk.lock();
+            lane.isGroupCommitFlushOngoing = false;
+            lane.groupCommitCv.notify_all();
+        }
+    }
+
+    // Flushes the write buffer and makes the OS write its cache of the active data file on the disk.
+    // With 'isSkippingSynced', nothing is done if the lane did not write since its last sync
+    void syncActiveDataFile(detail::WriteLane& lane, bool isSkippingSynced = false)
+    {
+        using namespace litecask::detail;
+
+        _mxDataFiles.lockRead();
+        if (lane.activeDataFileId >= _dataFiles.size()) {
+            _mxDataFiles.unlockRead();  // Datastore is closed
+            return;
+        }
+        lane.mxWriteBuffer.lockWrite();
+        flushWriteBufferUnlocked(lane);
+        uint64_t syncWritePosition = getActiveWritePositionUnlocked(lane);
+        if (isSkippingSynced && syncWritePosition <= lane.syncedWritePosition.load()) {
+            lane.mxWriteBuffer.unlockWrite();
+            _mxDataFiles.unlockRead();
+            return;
+        }
+        DataFile* dfd = _dataFiles[lane.activeDataFileId];
+        _unsyncedBytes.store(0);
+        lane.mxWriteBuffer.unlockWrite();
+        pinDataFileUnlocked(dfd);
+        _mxDataFiles.unlockRead();
+
+        // The OS synchronization is performed outside the write buffer and data file locks, so that neither writers nor readers are
+        // blocked. The pin prevents the handle from being closed by an active data file switch in the meantime
+        uint64_t syncStartNs = _latency.start();
+        if (!osOsSync(dfd->handle)) { log(LogLevel::Error, "Unable to sync the active data file on disk"); }
+        _latency.record(LatencyKind::OsSync, syncStartNs);
+        ++_stats.osSyncQty;
+        updateSyncedWritePosition(lane, syncWritePosition);
+        unpinDataFile(dfd);
+    }
+
+    void syncActiveDataFiles(bool isSkippingSynced = false)
+    {
+        for (detail::WriteLane* lane : _writeLanes) { syncActiveDataFile(*lane, isSkippingSynced); }
+    }
+
+    // Wakes up the sync thread when the amount of written bytes reaches the threshold of the 'ByteThreshold' policy
+    void notifyWrittenBytes(size_t bytes)
+    {
+        if (_syncPolicy != SyncPolicy::ByteThreshold) { return; }
+        if (_unsyncedBytes.fetch_add((uint32_t)bytes) + (uint32_t)bytes >= _syncBytes && !_syncWork.exchange(true)) {
+            std::unique_lock<std::mutex> lk(_syncMutex);
+            _syncCv.notify_one();
+        }
+    }
+
+    // Stores the keys of the values in the Hot and Warm queues of the cache, so that they are reloaded at the next opening
+    void saveCacheWarmUpFile()
+    {
+        using namespace litecask::detail;
+
+        lcVector<uint64_t> ownerIds;
+        _valueCache->getHotAndWarmOwnerIds(ownerIds);
+
+        fs::path warmUpFilename = _directory / CacheWarmUpFilename;
+        FILE*    fh             = osFopen(warmUpFilename.string() + TmpFileSuffix, "wb");
+        if (!fh) {
+            log(LogLevel::Warn, "Unable to create the cache warm-up file %s", warmUpFilename.string().c_str());
+            return;
+        }
+
+        CacheWarmUpFileHeader header{CacheWarmUpMagic, 0};
+        bool                  isOk = (fwrite(&header, sizeof(CacheWarmUpFileHeader), 1, fh) == 1);
+        lcVector<uint8_t>     key;
+        lcVector<KeyIndex>    keyIndexes;
+        KeyChunk              entry{0, 0, 0, 0, 0, 0, 0, 0, 0};
+        for (uint64_t ownerId : ownerIds) {
+            // The owner is the 64-bit key hash. The KeyDir is searched with its low 32 bits only, so the found key is checked.
+            // The data file lock is already taken by the closing
+            if (!_keyDir->getKeyAndIndexes((uint32_t)ownerId, key, keyIndexes, &entry) ||
+                (_keyDir->isFingerprintMode() && !readEntryKeyUnlocked((uint32_t)ownerId, entry, key)) ||
+                LITECASK_HASH_FUNC(key.data(), key.size()) != ownerId) {
+                continue;
+            }
+            uint16_t keySize = (uint16_t)key.size();
+            isOk = isOk && fwrite(&keySize, sizeof(uint16_t), 1, fh) == 1 && fwrite(key.data(), 1, keySize, fh) == keySize;
+            ++header.keyQty;
+        }
+        isOk = isOk && fseek(fh, 0, SEEK_SET) == 0 && fwrite(&header, sizeof(CacheWarmUpFileHeader), 1, fh) == 1;
+        isOk = (fclose(fh) == 0) && isOk;
+
+        if (!isOk || !osRenameFile(warmUpFilename.string() + TmpFileSuffix, warmUpFilename)) {
+            log(LogLevel::Warn, "Unable to write the cache warm-up file %s", warmUpFilename.string().c_str());
+            osRemoveFile(warmUpFilename.string() + TmpFileSuffix);
+            return;
+        }
+        _stats.cacheWarmUpSavedKeyQty += header.keyQty;
+        log(LogLevel::Debug, "Saved %u keys for the cache warm-up", header.keyQty);
+    }
+
+    // Loads the keys saved at the last closing. The file is always removed, as it becomes stale with the next writes
+    void loadCacheWarmUpFile(lcVector<lcVector<uint8_t>>& keys)
+    {
+        using namespace litecask::detail;
+
+        keys.clear();
+        fs::path warmUpFilename = _directory / CacheWarmUpFilename;
+        FILE*    fh             = osFopen(warmUpFilename, "rb");
+        if (!fh) { return; }
+
+        CacheWarmUpFileHeader header;
+        if (_config.valueCacheWarmUp && _valueCache->isEnabled() && fread(&header, sizeof(CacheWarmUpFileHeader), 1, fh) == 1 &&
+            header.magic == CacheWarmUpMagic) {
+            keys.reserve(header.keyQty);
+            uint16_t keySize = 0;
+            for (uint32_t keyIdx = 0; keyIdx < header.keyQty && fread(&keySize, sizeof(uint16_t), 1, fh) == 1; ++keyIdx) {
+                lcVector<uint8_t> key(keySize);
+                if (keySize == 0 || fread(key.data(), 1, keySize, fh) != keySize) { break; }
+                keys.push_back(std::move(key));
             }
-            _activeFlushedDataOffset = _activeDataOffset;
         }
+        fclose(fh);
+        osRemoveFile(warmUpFilename);
+    }
+
+    void warmUpThreadEntry(lcVector<lcVector<uint8_t>> keys)
+    {
+        uint32_t loadedQty = loadValuesInCache(keys, _warmUpExit, _stats.cacheWarmUpLoadedValueQty);
+        log(LogLevel::Debug, "Cache warm-up finished with %u values out of %u saved keys", loadedQty, (uint32_t)keys.size());
+    }
+
+    void prefetchThreadEntry()
+    {
+        lcVector<lcVector<uint8_t>> keys;
+        while (!_prefetchExit.load()) {
+            {
+                std::unique_lock<std::mutex> lk(_prefetchMutex);
+                _prefetchCv.wait(lk, [this] { return _prefetchExit.load() || !_prefetchKeys.empty(); });
+                if (_prefetchExit.load()) continue;
+                keys.swap(_prefetchKeys);
+            }
+            loadValuesInCache(keys, _prefetchExit, _stats.prefetchLoadedValueQty, &_stats.prefetchDiskReadQty);
+            keys.clear();
+        }
+    }
+
+    // Reads the values of the keys in the value cache, in file order and with a single read for the close entries.
+    // The entries already cached or in an active data file are skipped. Returns the quantity of values inserted in the cache
+    uint32_t loadValuesInCache(const lcVector<lcVector<uint8_t>>& keys, const std::atomic<bool>& exitFlag,
+                               std::atomic<uint64_t>& loadedValueCounter, std::atomic<uint64_t>* diskReadCounter = nullptr)
+    {
+        using namespace litecask::detail;
+
+        struct LoadEntry {
+            uint32_t keyIdx;
+            uint64_t keyHash;
+            KeyChunk entry;
+            bool     isValid;
+        };
+        auto getEntryBytes = [](const KeyChunk& e) {
+            return (uint32_t)sizeof(DataFileEntry) + (uint32_t)e.keySize + e.keyIndexSize + e.valueSize;
+        };
+
+        // Resolve the keys and sort their locations, so that the data files are read in order
+        lcVector<LoadEntry> entries;
+        KeyChunk            entry;
+        for (uint32_t keyIdx = 0; keyIdx < keys.size(); ++keyIdx) {
+            const lcVector<uint8_t>& key     = keys[keyIdx];
+            uint64_t                 keyHash = LITECASK_HASH_FUNC(key.data(), key.size());
+            if (_keyDir->find((uint32_t)keyHash, key.data(), (uint16_t)key.size(), entry) && entry.valueSize != DeletedEntry &&
+                entry.cacheLocation == NotStored) {
+                entries.push_back({keyIdx, keyHash, entry, true});
+            }
+        }
+        std::sort(entries.begin(), entries.end(), [](const LoadEntry& a, const LoadEntry& b) {
+            return (a.entry.fileId < b.entry.fileId) || (a.entry.fileId == b.entry.fileId && a.entry.fileOffset < b.entry.fileOffset);
+        });
+
+        lcVector<uint8_t> buffer;
+        uint32_t          loadedQty = 0;
+        size_t            runStart  = 0;
+        while (runStart < entries.size() && !exitFlag.load()) {
+            // Coalesce the close entries of the same data file, as for the multi-get
+            uint16_t fileId     = entries[runStart].entry.fileId;
+            uint32_t readOffset = entries[runStart].entry.fileOffset;
+            uint32_t readEnd    = readOffset + getEntryBytes(entries[runStart].entry);
+            size_t   runEnd     = runStart + 1;
+            for (; runEnd < entries.size(); ++runEnd) {
+                const KeyChunk& e      = entries[runEnd].entry;
+                uint32_t        newEnd = std::max(readEnd, e.fileOffset + getEntryBytes(e));
+                if (e.fileId != fileId || e.fileOffset > readEnd + GetBatchMaxReadGapBytes || newEnd - readOffset > GetBatchMaxReadBytes) {
+                    break;
+                }
+                readEnd = newEnd;
+            }
+
+            // The entries are resolved again, as they may have been updated, removed, merged or cached by the traffic in the meantime
+            _mxDataFiles.lockRead();
+            bool hasValidEntries = false;
+            for (size_t i = runStart; i < runEnd; ++i) {
+                LoadEntry&               le  = entries[i];
+                const lcVector<uint8_t>& key = keys[le.keyIdx];
+                le.isValid = _keyDir->find((uint32_t)le.keyHash, key.data(), (uint16_t)key.size(), entry) &&
+                             entry.valueSize != DeletedEntry && entry.cacheLocation == NotStored && entry.fileId == fileId &&
+                             entry.fileOffset == le.entry.fileOffset && entry.fileId != getWriteLane(le.keyHash).activeDataFileId;
+                le.entry        = entry;
+                hasValidEntries = hasValidEntries || le.isValid;
+            }
+            bool isReadOk = false;
+            if (hasValidEntries) {
+                if (buffer.size() < readEnd - readOffset) { buffer.resize(readEnd - readOffset); }
+                lcOsFileHandle fh = _dataFiles[fileId]->handle;
+                assert(osIsValidHandle(fh));
+                isReadOk = osOsRead(fh, buffer.data(), readEnd - readOffset, readOffset);
+                if (diskReadCounter) { ++(*diskReadCounter); }
+            }
+            _mxDataFiles.unlockRead();
+
+            for (size_t i = runStart; isReadOk && i < runEnd; ++i) {
+                const LoadEntry&         le  = entries[i];
+                const lcVector<uint8_t>& key = keys[le.keyIdx];
+                if (!le.isValid) { continue; }
+                const uint8_t* entryBuffer = buffer.data() + (le.entry.fileOffset - readOffset);
+                const uint8_t* value       = entryBuffer + getEntryBytes(le.entry) - le.entry.valueSize;
+                DataFileEntry  header;
+                memcpy(&header, entryBuffer, sizeof(DataFileEntry));
+                if (header.checksum != (uint32_t)(le.keyHash ^ LITECASK_HASH_FUNC(value, le.entry.valueSize)) ||
+                    isStoredKeyMismatch(entryBuffer + sizeof(DataFileEntry), key.data(), key.size())) {
+                    continue;
+                }
+
+                // Same change counter protection as for a standard read
+                ValueLoc    cacheLoc      = _valueCache->insertValue(value, le.entry.valueSize, le.keyHash, le.entry.expTimeSec);
+                std::mutex& mxKeyDirShard = _keyDir->getMutex((uint32_t)le.keyHash);
+                mxKeyDirShard.lock();
+                _keyDir->updateCachedValueLocation((uint32_t)le.keyHash, key.data(), (uint16_t)key.size(), le.entry.valueSize,
+                                                   le.entry.changeCounter, cacheLoc);
+                mxKeyDirShard.unlock();
+                if (cacheLoc != NotStored) {
+                    ++loadedValueCounter;
+                    ++loadedQty;
+                }
+            }
+            runStart = runEnd;
+        }
+        return loadedQty;
+    }
+
+    template<typename KeyContainer>
+    Status privatePrefetch(const lcVector<KeyContainer>& keys)
+    {
+        ++_stats.prefetchCallQty;
+        _mxDataFiles.lockRead();
+        bool isInitialized = _isInitialized;
+        _mxDataFiles.unlockRead();
+        if (!isInitialized) {
+            ++_stats.prefetchCallFailedQty;
+            return Status::StoreNotOpen;
+        }
+        if (!_valueCache->isEnabled()) { return Status::Ok; }
+
+        {
+            std::lock_guard<std::mutex> lk(_prefetchMutex);
+            for (const KeyContainer& key : keys) {
+                if (key.size() == 0 || key.size() >= USHRT_MAX) { continue; }
+                if (_prefetchKeys.size() >= detail::PrefetchMaxPendingKeyQty) {
+                    ++_stats.prefetchDroppedKeyQty;
+                    continue;
+                }
+                _prefetchKeys.emplace_back((const uint8_t*)key.data(), (const uint8_t*)key.data() + key.size());
+            }
+        }
+        _prefetchCv.notify_one();
+        return Status::Ok;
+    }
+
+    void syncThreadEntry()
+    {
+        // Sync service loop
+        while (!_syncExit.load()) {
+            // Snapshot the protected configuration
+            _mxConfig.lock();
+            uint32_t periodMs = (_syncPolicy == SyncPolicy::Periodic) ? _config.syncPeriodMs : _config.upkeepCyclePeriodMs;
+            _mxConfig.unlock();
+
+            bool isRequested = false;
+            {
+                std::unique_lock<std::mutex> lk(_syncMutex);
+                _syncCv.wait_for(lk, std::chrono::milliseconds(periodMs), [this] { return _syncExit.load() || _syncWork.load(); });
+                if (_syncExit.load()) continue;
+                isRequested = _syncWork.exchange(false);
+            }
+
+            // The periodic sync skips the lanes which are already synced, so that an idle datastore does not sync at all
+            if (_syncPolicy == SyncPolicy::Periodic) {
+                syncActiveDataFiles(true);
+            } else if (_syncPolicy == SyncPolicy::ByteThreshold && isRequested) {
+                syncActiveDataFiles();
+            }
+        }  // End of service loop
     }
 
     // The "data file" *write* lock must be taken before the call
@@ -4873,45 +10645,76 @@ class Datastore  // NOLINT(clang-analyzer-optin.performance.Padding)  Padding is
         _keyDir->setNow(_nowTimeSec);
     }
 
-    bool                        _isInitialized = false;
-    uint32_t                    _nowTimeSec    = 0;  // Unix timestamp in second
-    lcVector<detail::DataFile*> _dataFiles;
-    lcVector<uint16_t>          _freeDataFileIds;
-    detail::KeyDirMap*          _keyDir     = nullptr;
-    detail::ValueCache*         _valueCache = nullptr;
-    detail::IndexMap*           _indexMap   = nullptr;
-    lcVector<uint8_t>           _writeBuffer;
-    uint64_t                    _maxDataFileIndex        = 1;
-    uint32_t                    _activeDataOffset        = 0;
-    uint32_t                    _activeFlushedDataOffset = 0;  // Last "write buffer" write on disk
-    uint16_t                    _activeDataFileId        = 0xFFFF;
-    uint64_t                    _dataFileMaxBytes        = 100'000'000;  // Copied from the config for efficiency in multithread environment
-    int64_t                     _maxLogFileBytes         = 10'000'000;
-
-    alignas(detail::CpuCacheLine) mutable detail::RWLock _mxDataFiles;    // lockRead: using _dataFiles, lockWrite: data files changes
-    alignas(detail::CpuCacheLine) mutable detail::RWLock _mxWriteBuffer;  // lock for using the current write buffer
-    alignas(detail::CpuCacheLine) mutable detail::RWLock _mxIndexMap;     // lock for using the index lookup
-    alignas(detail::CpuCacheLine) mutable std::mutex _mxActiveFile;       // lock for using active file (write entry)
-    alignas(detail::CpuCacheLine) mutable std::mutex _mxKeyDir;           // lock for writing the hashmap
-    alignas(detail::CpuCacheLine) mutable std::mutex _mxConfig;           // lock for reading or writing the config
+    bool                         _isInitialized = false;
+    uint32_t                     _nowTimeSec    = 0;  // Unix timestamp in second
+    lcVector<detail::DataFile*>  _dataFiles;
+    lcVector<uint16_t>           _freeDataFileIds;
+    detail::ShardedKeyDir*       _keyDir     = nullptr;
+    detail::ValueCache*          _valueCache = nullptr;
+    detail::IndexMap*            _indexMap   = nullptr;
+    lcVector<detail::WriteLane*> _writeLanes;  // Modified only when the datastore is closed
+    uint32_t                     _writeBufferBytes = detail::DefaultWriteBufferBytes;
+    uint64_t                     _maxDataFileIndex = 1;
+    uint64_t                     _dataFileMaxBytes = 100'000'000;       // Copied from the config for efficiency in multithread environment
+    SyncPolicy                   _syncPolicy       = SyncPolicy::None;  // Copied from the config
+    uint32_t                     _syncBytes        = 10'000'000;        // Copied from the config
+    int64_t                      _maxLogFileBytes  = 10'000'000;
+
+    uint32_t                     _valueCompressionMinBytes = UINT32_MAX;  // Copied from the config. Maximum value means no compression
+    ValueCodec                   _valueCodec;
+    uint32_t                     _blobMinBytes = UINT32_MAX;  // Copied from the config. Maximum value means no blob file
+    std::atomic<uint64_t>        _nextBlobId   = 1;
+
+    alignas(detail::CpuCacheLine) mutable detail::RWLock _mxDataFiles;  // lockRead: using _dataFiles, lockWrite: data files changes
+    alignas(detail::CpuCacheLine) mutable detail::RWLock _mxIndexMap;   // lock for using the index lookup
+    alignas(detail::CpuCacheLine) mutable std::mutex _mxConfig;         // lock for reading or writing the config
 
     // Control of merge operations thread. May be long operations
+    detail::MergeThrottle   _mergeThrottle;
     std::thread             _mergeThread;
     std::mutex              _mergeMutex;
     std::condition_variable _mergeCv;
+    std::mutex              _mxFileRemoval;  // Taken to remove files, or to block their removal during a checkpoint
     std::atomic<bool>       _mergeWork               = false;
     std::atomic<bool>       _mergeExit               = false;
     bool                    _someHintFilesAreMissing = false;
 
+    // Helper threads for the parallel disk reads of 'getBatch'
+    detail::ReadThreadPool _getBatchReadPool;
+
+#if LITECASK_IO_URING_ENABLED
+    // Asynchronous disk reads
+    detail::AsyncReader _asyncReader;
+#endif
+    mutable std::mutex              _pinMutex;  // Wakes up the closing of a data file, once it is unpinned
+    mutable std::condition_variable _pinCv;
+
+    // Control of the OS level disk synchronization thread
+    std::thread             _syncThread;
+    std::mutex              _syncMutex;
+    std::condition_variable _syncCv;
+    std::atomic<bool>       _syncWork      = false;
+    std::atomic<bool>       _syncExit      = false;
+    std::atomic<uint32_t>   _unsyncedBytes = 0;
+
+    // Background reload of the cache content saved at the last closing
+    std::thread       _warmUpThread;
+    std::atomic<bool> _warmUpExit = false;
+
+    // Background prefetch of values in the cache
+    std::thread                 _prefetchThread;
+    std::mutex                  _prefetchMutex;
+    std::condition_variable     _prefetchCv;
+    lcVector<lcVector<uint8_t>> _prefetchKeys;  // Pending keys
+    std::atomic<bool>           _prefetchExit = false;
+
     // Control of upkeep operations thread (KeyDir resizing, cache queues, ...). Fine granularity
     std::thread             _upkeepThread;
     std::mutex              _upkeepMutex;
     std::condition_variable _upkeepCv;
-    std::atomic<bool>       _upkeepWork                        = false;
-    std::atomic<bool>       _upkeepExit                        = false;
-    uint64_t                _upkeepLastActiveFlushedTimeMs     = 0;
-    uint32_t                _upkeepLastActiveFlushedDataOffset = detail::NotStored;
-    uint16_t                _upkeepLastActiveDataFileId        = 0xFFFF;
+    std::atomic<bool>       _upkeepWork                    = false;
+    std::atomic<bool>       _upkeepExit                    = false;
+    uint64_t                _upkeepLastActiveFlushedTimeMs = 0;
 
     // Logging
     std::mutex _logMx;
@@ -4920,9 +10723,10 @@ class Datastore  // NOLINT(clang-analyzer-optin.performance.Padding)  Padding is
     std::function<void(LogLevel, const char*, bool)> _logHandler;
     std::function<uint32_t()>                        _getTestTime;
 
-    Config            _config;
-    fs::path          _directory;
-    DatastoreCounters _stats;
+    Config                         _config;
+    fs::path                       _directory;
+    DatastoreCounters              _stats;
+    detail::LatencyInstrumentation _latency;
 };
 
 }  // namespace litecask
@@ -50,6 +50,7 @@ TEST_SUITE("Basic")
         // Check packing works
         CHECK_EQ(sizeof(DataFileEntry), 16);
         CHECK_EQ(sizeof(HintFileEntry), 16);
+        CHECK_EQ(sizeof(KeyChunk), 24);
     }
 
     TEST_CASE("1-Sanity   : Config consistency")
@@ -91,6 +92,8 @@ TEST_SUITE("Basic")
         // No constraint on writeBufferFlushPeriodMs
         CHECK_BAD_PARAM_VALUE(upkeepKeyDirBatchSize, 0, BadParameterValue);
         CHECK_BAD_PARAM_VALUE(upkeepValueCacheBatchSize, 0, BadParameterValue);
+        CHECK_BAD_PARAM_VALUE(syncPeriodMs, 0, BadParameterValue);
+        CHECK_BAD_PARAM_VALUE(syncBytes, 0, BadParameterValue);
         CHECK_BAD_PARAM_VALUE(mergeTriggerDataFileFragmentationPercentage, 0, BadParameterValue);
         CHECK_BAD_PARAM_VALUE(mergeTriggerDataFileFragmentationPercentage, 101, BadParameterValue);
         CHECK_BAD_PARAM_VALUE(mergeTriggerDataFileDeadByteThreshold, 11001, InconsistentParameterValues);
@@ -99,6 +102,7 @@ TEST_SUITE("Basic")
         CHECK_BAD_PARAM_VALUE(mergeSelectDataFileFragmentationPercentage, 3, InconsistentParameterValues);
         CHECK_BAD_PARAM_VALUE(mergeSelectDataFileDeadByteThreshold, 10001, InconsistentParameterValues);
         CHECK_BAD_PARAM_VALUE(mergeSelectDataFileSmallSizeTheshold, 1023, BadParameterValue);
+        CHECK_BAD_PARAM_VALUE(memoryNumaPolicy, (NumaPolicy)3, BadParameterValue);
     }
 
     TEST_CASE("1-Sanity   : LockFile DB protection against multiple opening")
@@ -253,6 +257,218 @@ TEST_SUITE("Basic")
         CHECK_EQ(s, Status::Ok);
     }
 
+    TEST_CASE("1-Sanity   : Parallel load keeps the newest entries")
+    {
+        SETUP_DB();
+        constexpr uint32_t KeyQty   = 100;
+        constexpr uint32_t RoundQty = 6;
+
+        // Small data files, so that the entries are spread over numerous files loaded concurrently
+        Config c;
+        c.dataFileMaxBytes                      = 2048;
+        c.mergeCyclePeriodMs                    = 60'000;
+        c.mergeTriggerDataFileDeadByteThreshold = 1024;
+        c.mergeSelectDataFileDeadByteThreshold  = 1024;
+        c.mergeSelectDataFileSmallSizeTheshold  = 1024;
+        s                                       = store.setConfig(c);
+        CHECK_EQ(s, Status::Ok);
+
+        s = store.open(databasePath);
+        CHECK_EQ(s, Status::Ok);
+        for (uint32_t round = 0; round < RoundQty; ++round) {
+            for (uint32_t key = 0; key < KeyQty; ++key) {
+                if ((round == 2 && (key % 5) == 0) || (round == RoundQty - 1 && (key % 7) == 0)) {
+                    s = store.remove(&key, sizeof(key));
+                } else {
+                    value[0] = (uint8_t)round;
+                    s        = store.put(&key, sizeof(key), value.data(), value.size());
+                }
+                CHECK_EQ(s, Status::Ok);
+            }
+        }
+        s = store.close();
+        CHECK_EQ(s, Status::Ok);
+
+        Datastore store2;
+        s = store2.setConfig(c);
+        CHECK_EQ(s, Status::Ok);
+        s = store2.open(databasePath);
+        CHECK_EQ(s, Status::Ok);
+        CHECK_GE(store2.getCounters().dataFileMaxQty.load(), 20);
+        for (uint32_t key = 0; key < KeyQty; ++key) {
+            s = store2.get(&key, sizeof(key), retrievedValue);
+            if ((key % 7) == 0) {
+                CHECK_EQ(s, Status::EntryNotFound);
+            } else {
+                CHECK_EQ(s, Status::Ok);
+                CHECK_EQ(retrievedValue.size(), VALUE_SIZE);
+                CHECK_EQ(retrievedValue[0], (uint8_t)(RoundQty - 1));
+                CHECK_EQ(retrievedValue[1], 1);
+            }
+        }
+        s = store2.close();
+        CHECK_EQ(s, Status::Ok);
+    }
+
+    TEST_CASE("1-Sanity   : Hint file loading")
+    {
+        SETUP_DB();
+        constexpr uint32_t KeyQty = 20000;
+
+        Config c;
+        c.dataFileMaxBytes                      = 64 * 1024;
+        c.mergeTriggerDataFileDeadByteThreshold = 16 * 1024;
+        c.mergeSelectDataFileDeadByteThreshold  = 16 * 1024;
+        s                                       = store.setConfig(c);
+        CHECK_EQ(s, Status::Ok);
+
+        // Indexed entries: the 2 first bytes of the key are indexed
+        s = store.open(databasePath);
+        CHECK_EQ(s, Status::Ok);
+        lcVector<uint8_t> key(4);
+        for (uint32_t i = 0; i < KeyQty; ++i) {
+            key = {(uint8_t)(i % 10), 0x42, (uint8_t)(i >> 8), (uint8_t)i};
+            s   = store.put(key, value, {{0, 2}});
+            CHECK_EQ(s, Status::Ok);
+        }
+        s = store.close();
+        CHECK_EQ(s, Status::Ok);
+
+        // Create the hint files with a merge
+        s = store.open(databasePath);
+        CHECK_EQ(s, Status::Ok);
+        CHECK(store.requestMerge());
+        int round = 0;
+        while (store.isMergeOnGoing() && round < 1000) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+            ++round;
+        }
+        CHECK(round < 1000);
+        s = store.close();
+        CHECK_EQ(s, Status::Ok);
+
+        // The hint files have a header with the totals
+        uint64_t       totalEntryQty    = 0;
+        uint64_t       totalKeyIndexQty = 0;
+        HintFileHeader header;
+        for (const auto& entry : std::filesystem::directory_iterator(databasePath)) {
+            if (entry.path().extension() != HintFileSuffix) { continue; }
+            CHECK(Datastore::readHintFileHeader(entry.path().string(), header));
+            totalEntryQty += header.entryQty;
+            totalKeyIndexQty += header.keyIndexQty;
+        }
+        CHECK_EQ(totalEntryQty, KeyQty);
+        CHECK_EQ(totalKeyIndexQty, KeyQty);
+
+        // A fresh datastore is sized once at load, and the indexes are reloaded
+        Datastore store2;
+        s = store2.open(databasePath);
+        CHECK_EQ(s, Status::Ok);
+        CHECK_GE(store2._keyDir->capacity() * 0.9, KeyQty);
+        CHECK_GE(store2._indexMap->capacity() * 0.9, KeyQty);
+        CHECK_EQ(store2._keyDir->size(), KeyQty);
+        for (uint32_t i = 0; i < KeyQty; i += 997) {
+            key = {(uint8_t)(i % 10), 0x42, (uint8_t)(i >> 8), (uint8_t)i};
+            s   = store2.get(key, retrievedValue);
+            CHECK_EQ(s, Status::Ok);
+            CHECK(retrievedValue == value);
+        }
+        lcVector<lcVector<uint8_t>> matchingKeys;
+        s = store2.query(lcVector<uint8_t>{3, 0x42}, matchingKeys);
+        CHECK_EQ(s, Status::Ok);
+        CHECK_EQ(matchingKeys.size(), KeyQty / 10);
+        s = store2.close();
+        CHECK_EQ(s, Status::Ok);
+
+        // A truncated hint file is detected with its header, and its data file is loaded instead
+        for (const auto& entry : std::filesystem::directory_iterator(databasePath)) {
+            if (entry.path().extension() != HintFileSuffix) { continue; }
+            std::filesystem::resize_file(entry.path(), std::filesystem::file_size(entry.path()) / 2);
+            break;
+        }
+        Datastore store3;
+        s = store3.open(databasePath);
+        CHECK_EQ(s, Status::Ok);
+        CHECK_EQ(store3._keyDir->size(), KeyQty);
+        s = store3.close();
+        CHECK_EQ(s, Status::Ok);
+    }
+
+    TEST_CASE("1-Sanity   : Incremental hint files")
+    {
+        SETUP_DB();
+        constexpr uint32_t KeyQty = 5000;
+
+        Config c;
+        c.dataFileMaxBytes                      = 64 * 1024;
+        c.mergeTriggerDataFileDeadByteThreshold = 16 * 1024;
+        c.mergeSelectDataFileDeadByteThreshold  = 16 * 1024;
+        c.writeLaneQty                          = 2;
+        s                                       = store.setConfig(c);
+        CHECK_EQ(s, Status::Ok);
+
+        // Indexed entries, some of them removed, and a batch
+        s = store.open(databasePath);
+        CHECK_EQ(s, Status::Ok);
+        lcVector<uint8_t> key(4);
+        for (uint32_t i = 0; i < KeyQty; ++i) {
+            key = {(uint8_t)(i % 10), 0x42, (uint8_t)(i >> 8), (uint8_t)i};
+            s   = store.put(key, value, {{0, 2}});
+            CHECK_EQ(s, Status::Ok);
+        }
+        for (uint32_t i = 0; i < KeyQty; i += 5) {
+            key = {(uint8_t)(i % 10), 0x42, (uint8_t)(i >> 8), (uint8_t)i};
+            CHECK_EQ(store.remove(key), Status::Ok);
+        }
+        WriteBatch batch;
+        for (uint32_t i = 1; i < KeyQty; i += 5) {
+            key = {(uint8_t)(i % 10), 0x42, (uint8_t)(i >> 8), (uint8_t)i};
+            CHECK_EQ(batch.put(key.data(), 4, value2.data(), VALUE_SIZE), Status::Ok);
+        }
+        CHECK_EQ(store.write(batch), Status::Ok);
+        s = store.close();
+        CHECK_EQ(s, Status::Ok);
+
+        // Each data file has its hint file, with all the entries, without merge nor data file re-read
+        uint64_t       dataFileQty      = 0;
+        uint64_t       totalEntryQty    = 0;
+        uint64_t       totalKeyIndexQty = 0;
+        HintFileHeader header;
+        for (const auto& entry : std::filesystem::directory_iterator(databasePath)) {
+            CHECK_NE(entry.path().extension(), TmpFileSuffix);
+            if (entry.path().extension() != DataFileSuffix) { continue; }
+            ++dataFileQty;
+            CHECK(Datastore::readHintFileHeader(fs::path(entry.path()).replace_extension(HintFileSuffix).string(), header));
+            totalEntryQty += header.entryQty;
+            totalKeyIndexQty += header.keyIndexQty;
+        }
+        CHECK_GT(dataFileQty, 2);
+        CHECK_EQ(totalEntryQty, KeyQty + 2 * (KeyQty / 5));
+        CHECK_EQ(totalKeyIndexQty, KeyQty);
+        CHECK_EQ(store.getCounters().mergeCycleWithMergeQty, 0);
+
+        // The reload uses only the hint files
+        s = store.open(databasePath);
+        CHECK_EQ(s, Status::Ok);
+        CHECK_FALSE(store._someHintFilesAreMissing);
+        for (uint32_t i = 0; i < KeyQty; ++i) {
+            key = {(uint8_t)(i % 10), 0x42, (uint8_t)(i >> 8), (uint8_t)i};
+            s   = store.get(key, retrievedValue);
+            if ((i % 5) == 0) {
+                CHECK_EQ(s, Status::EntryNotFound);
+            } else {
+                CHECK_EQ(s, Status::Ok);
+                CHECK(retrievedValue == (((i % 5) == 1) ? value2 : value));
+            }
+        }
+        lcVector<lcVector<uint8_t>> matchingKeys;
+        s = store.query(lcVector<uint8_t>{3, 0x42}, matchingKeys);
+        CHECK_EQ(s, Status::Ok);
+        CHECK_EQ(matchingKeys.size(), KeyQty / 10);
+        s = store.close();
+        CHECK_EQ(s, Status::Ok);
+    }
+
     TEST_CASE("1-Sanity   : API basic stimulation")
     {
         // Database cleanup and setup useful variables
@@ -494,7 +710,7 @@ TEST_SUITE("Basic")
         CHECK_EQ(s, Status::Ok);
         CHECK_EQ(retrievedValue[7], 7);
 
-        store.createNewActiveDataFileUnlocked();
+        store.createNewActiveDataFileUnlocked(*store._writeLanes[0]);
         s = store.get(&numberKey, 4, retrievedValue);
         CHECK_EQ(s, Status::Ok);
         CHECK_EQ(retrievedValue.size(), VALUE_SIZE);
@@ -508,7 +724,7 @@ TEST_SUITE("Basic")
         CHECK_EQ(retrievedValue.size(), VALUE_SIZE);
         CHECK_EQ(retrievedValue[0], 1);
 
-        store.createNewActiveDataFileUnlocked();
+        store.createNewActiveDataFileUnlocked(*store._writeLanes[0]);
         s = store.get(&numberKey, 4, retrievedValue);
         CHECK_EQ(s, Status::Ok);
         CHECK_EQ(retrievedValue.size(), VALUE_SIZE);
@@ -521,9 +737,9 @@ TEST_SUITE("Basic")
         CHECK_EQ(s, Status::EntryNotFound);
 
         // Merge with file 1 & 3 selected (not file 2)
-        lcVector<MergeFileInfo> mergeInfos    = {{0, {}}, {2, {}}};
-        lcString                mergeBasename = store.createNewActiveDataFileUnlocked();
-        store.createMergedDataFiles(mergeInfos, mergeBasename, 150 * 1024 * 1024);
+        lcVector<MergeFileInfo> mergeInfos    = {{0, {}, {}}, {2, {}, {}}};
+        lcString                mergeBasename = store.createNewActiveDataFileUnlocked(*store._writeLanes[0]);
+        store.createMergedDataFiles(mergeInfos, mergeBasename, 150 * 1024 * 1024, 1);
         store.replaceDataFiles(mergeInfos);
 
         // Check: the key should not exist after reloading
@@ -540,6 +756,113 @@ TEST_SUITE("Basic")
         // LATER: check that when compacting B, the database becomes empty
     }
 
+    TEST_CASE("1-Sanity   : Merge keeps the unreadable data files")
+    {
+        // Database cleanup and setup useful variables
+        SETUP_DB();
+        s = store.open(databasePath);
+        CHECK_EQ(s, Status::Ok);
+
+        // File 0: one entry. File 1: empty
+        CHECK_EQ(store.put(&numberKey, 4, &value[0], VALUE_SIZE), Status::Ok);
+        store.createNewActiveDataFileUnlocked(*store._writeLanes[0]);
+        lcString mergeBasename = store.createNewActiveDataFileUnlocked(*store._writeLanes[0]);
+        lcString dataFilename  = store._dataFiles[0]->filename;
+        lcString emptyFilename = store._dataFiles[1]->filename;
+        CHECK_EQ(std::filesystem::file_size(emptyFilename), 0);
+
+        // The data file 0 cannot be read anymore by the merge, but its entry is still readable through the open handle
+        std::filesystem::rename(dataFilename, dataFilename + ".hidden");
+        lcVector<MergeFileInfo> mergeInfos = {{0, {}, {}, false}, {1, {}, {}, false}};
+        store.createMergedDataFiles(mergeInfos, mergeBasename, 150 * 1024 * 1024, 1);
+        store.replaceDataFiles(mergeInfos);
+        CHECK(mergeInfos[0].isFailed);
+        CHECK_FALSE(mergeInfos[1].isFailed);
+        CHECK_FALSE(std::filesystem::exists(emptyFilename));
+        CHECK_FALSE(std::filesystem::exists(std::filesystem::path(dataFilename).replace_extension(ToRemoveFileSuffix)));
+        CHECK_EQ(store.get(&numberKey, 4, retrievedValue), Status::Ok);
+        CHECK(retrievedValue == value);
+
+        // The entry is still there after reloading
+        std::filesystem::rename(dataFilename + ".hidden", dataFilename);
+        s = store.close();
+        CHECK_EQ(s, Status::Ok);
+        s = store.open(databasePath);
+        CHECK_EQ(s, Status::Ok);
+        CHECK_EQ(store.get(&numberKey, 4, retrievedValue), Status::Ok);
+        CHECK(retrievedValue == value);
+        s = store.close();
+        CHECK_EQ(s, Status::Ok);
+    }
+
+    TEST_CASE("1-Sanity   : Parallel and throttled merge")
+    {
+        SETUP_DB();
+        constexpr uint32_t KeyQty = 20000;
+
+        Config c;
+        c.dataFileMaxBytes                      = 64 * 1024;
+        c.mergeTriggerDataFileDeadByteThreshold = 16 * 1024;
+        c.mergeSelectDataFileDeadByteThreshold  = 16 * 1024;
+        c.mergeWorkerQty                        = 4;
+        s                                       = store.setConfig(c);
+        CHECK_EQ(s, Status::Ok);
+        c.mergeWorkerQty = 0;
+        CHECK_EQ(store.setConfig(c), Status::BadParameterValue);
+        c.mergeWorkerQty = MaxMergeWorkerQty + 1;
+        CHECK_EQ(store.setConfig(c), Status::BadParameterValue);
+
+        // Interleaved live and dead entries in many data files: odd keys are overwritten and one key out of 3 is removed
+        s = store.open(databasePath);
+        CHECK_EQ(s, Status::Ok);
+        for (uint32_t i = 0; i < KeyQty; ++i) { CHECK_EQ(store.put(&i, 4, value.data(), VALUE_SIZE), Status::Ok); }
+        for (uint32_t i = 1; i < KeyQty; i += 2) { CHECK_EQ(store.put(&i, 4, value2.data(), VALUE_SIZE), Status::Ok); }
+        for (uint32_t i = 0; i < KeyQty; i += 3) { CHECK_EQ(store.remove(&i, 4), Status::Ok); }
+
+        CHECK(store.requestMerge());
+        int round = 0;
+        while (store.isMergeOnGoing() && round < 1000) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+            ++round;
+        }
+        CHECK(round < 1000);
+        CHECK_EQ(store.getCounters().mergeCycleWithMergeQty, 1);
+        CHECK_GT(store.getCounters().mergeGainedBytes, 0);
+
+        auto checkContent = [&](Datastore& ds) {
+            for (uint32_t i = 0; i < KeyQty; ++i) {
+                s = ds.get(&i, 4, retrievedValue);
+                if ((i % 3) == 0) {
+                    CHECK_EQ(s, Status::EntryNotFound);
+                } else {
+                    CHECK_EQ(s, Status::Ok);
+                    CHECK(retrievedValue == (((i % 2) == 1) ? value2 : value));
+                }
+            }
+            CHECK_EQ(ds.getCounters().getCallCorruptedQty, 0);
+        };
+        checkContent(store);
+        s = store.close();
+        CHECK_EQ(s, Status::Ok);
+
+        // The compacted files are valid after reload
+        s = store.open(databasePath);
+        CHECK_EQ(s, Status::Ok);
+        checkContent(store);
+        s = store.close();
+        CHECK_EQ(s, Status::Ok);
+
+        // The throttling applies only while foreground reads access the disk
+        MergeThrottle throttle;
+        throttle.reset(1024 * 1024);
+        CHECK_FALSE(throttle.consume(100 * 1024, 0));  // No foreground read
+        auto startTime = std::chrono::steady_clock::now();
+        CHECK(throttle.consume(100 * 1024, 1));
+        CHECK_GE(std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - startTime).count(), 90);
+        throttle.reset(0);
+        CHECK_FALSE(throttle.consume(100 * 1024, 2));  // No limit
+    }
+
     TEST_CASE("1-Sanity   : Big entries")
     {
         // Database cleanup and setup useful variables
@@ -579,6 +902,1251 @@ TEST_SUITE("Basic")
         CHECK_EQ(s, Status::Ok);
     }
 
+    TEST_CASE("1-Sanity   : Zero-copy get variants")
+    {
+        // Database cleanup and setup useful variables
+        SETUP_DB();
+
+        s = store.open(databasePath);
+        CHECK_EQ(s, Status::Ok);
+
+        lcString          key{"zero-copy key"};
+        lcVector<uint8_t> buffer(2 * VALUE_SIZE);
+        size_t            valueSize = 0;
+        s                           = store.put(key, value);
+        CHECK_EQ(s, Status::Ok);
+
+        // The 3 sources of the value are stimulated: write buffer, disk and cache
+        for (int source = 0; source < 3; ++source) {
+            const DatastoreCounters& stats             = store.getCounters();
+            uint64_t                 getCallQty        = stats.getCallQty;
+            uint64_t                 getCallFailedQty  = stats.getCallFailedQty;
+            uint64_t                 writeBufferHitQty = stats.getWriteBufferHitQty;
+            uint64_t                 cacheHitQty       = stats.getCacheHitQty;
+
+            // Visitor variant
+            int visitQty = 0;
+            s            = store.get(key, [&](const uint8_t* v, size_t vSize) {
+                ++visitQty;
+                CHECK_EQ(vSize, VALUE_SIZE);
+                CHECK(!memcmp(v, value.data(), VALUE_SIZE));
+            });
+            CHECK_EQ(s, Status::Ok);
+            CHECK_EQ(visitQty, 1);
+
+            // Caller buffer variant
+            memset(buffer.data(), 0, buffer.size());
+            s = store.get(key.data(), key.size(), buffer.data(), buffer.size(), valueSize);
+            CHECK_EQ(s, Status::Ok);
+            CHECK_EQ(valueSize, VALUE_SIZE);
+            CHECK(!memcmp(buffer.data(), value.data(), VALUE_SIZE));
+
+            // Too small buffer: the value size is provided anyway
+            valueSize = 0;
+            s         = store.get(key, buffer.data(), VALUE_SIZE - 1, valueSize);
+            CHECK_EQ(s, Status::BufferTooSmall);
+            CHECK_EQ(valueSize, VALUE_SIZE);
+
+            CHECK_EQ(stats.getCallQty - getCallQty, 2);
+            CHECK_EQ(stats.getCallFailedQty - getCallFailedQty, 1);
+            if (source == 0) { CHECK_EQ(stats.getWriteBufferHitQty - writeBufferHitQty, 2); }
+            if (source == 2) { CHECK_EQ(stats.getCacheHitQty - cacheHitQty, 2); }
+
+            // Flush the write buffer so that the next loop reads from the disk (then from the cache)
+            if (source == 0) { store.sync(); }
+        }
+
+        // Unknown key
+        s = store.get("unknown key", [](const uint8_t*, size_t) { CHECK(false); });
+        CHECK_EQ(s, Status::EntryNotFound);
+        s = store.get(lcString("unknown key"), buffer.data(), buffer.size(), valueSize);
+        CHECK_EQ(s, Status::EntryNotFound);
+
+        s = store.close();
+        CHECK_EQ(s, Status::Ok);
+    }
+
+    TEST_CASE("1-Sanity   : Multi-get")
+    {
+        // Database cleanup and setup useful variables
+        SETUP_DB();
+        constexpr uint32_t EntryQty     = 200;
+        constexpr uint32_t BigValueSize = 5000;  // Above the disk read coalescing gap
+
+        s = store.open(databasePath);
+        CHECK_EQ(s, Status::Ok);
+
+        lcVector<lcVector<uint8_t>> keys;
+        lcVector<lcVector<uint8_t>> values;
+        lcVector<Status>            statuses;
+        lcVector<uint8_t>           bigValue(BigValueSize);
+        for (uint32_t i = 0; i < EntryQty; ++i) {
+            keys.push_back({(uint8_t)(i >> 8), (uint8_t)i, 0x42, 0x43});
+            for (uint32_t j = 0; j < BigValueSize; ++j) { bigValue[j] = (uint8_t)(i + j); }
+            s = store.put(keys.back(), bigValue);
+            CHECK_EQ(s, Status::Ok);
+        }
+
+        // Not found, bad key and duplicated keys are handled individually
+        lcVector<lcString> strKeys{lcString("unknown"), lcString(), lcString("\x00\x01\x42\x43", 4), lcString("\x00\x01\x42\x43", 4)};
+        s = store.getBatch(strKeys, values, statuses);
+        CHECK_EQ(s, Status::Ok);
+        CHECK_EQ(values.size(), strKeys.size());
+        CHECK_EQ(statuses.size(), strKeys.size());
+        CHECK_EQ(statuses[0], Status::EntryNotFound);
+        CHECK_EQ(statuses[1], Status::BadKeySize);
+        CHECK_EQ(statuses[2], Status::Ok);
+        CHECK_EQ(statuses[3], Status::Ok);
+        CHECK_EQ(values[2].size(), BigValueSize);
+        CHECK_EQ(values[2][10], (uint8_t)(1 + 10));
+        CHECK(values[2] == values[3]);
+        s = store.close();
+        CHECK_EQ(s, Status::Ok);
+
+        // Reopen without value cache so that all values are read from the disk
+        Datastore                diskStore(0);
+        const DatastoreCounters& stats = diskStore.getCounters();
+        s                              = diskStore.open(databasePath);
+        CHECK_EQ(s, Status::Ok);
+
+        // Sparse keys in reverse order: no coalescing, numerous enough for concurrent reads
+        lcVector<lcVector<uint8_t>> sparseKeys;
+        for (int i = EntryQty - 2; i >= 0; i -= 2) { sparseKeys.push_back(keys[i]); }
+        s = diskStore.getBatch(sparseKeys, values, statuses);
+        CHECK_EQ(s, Status::Ok);
+        CHECK_EQ(stats.getBatchDiskReadQty.load(), sparseKeys.size());
+        for (uint32_t i = 0; i < sparseKeys.size(); ++i) {
+            uint32_t keyNbr = EntryQty - 2 - 2 * i;
+            CHECK_EQ(statuses[i], Status::Ok);
+            CHECK_EQ(values[i].size(), BigValueSize);
+            CHECK_EQ(values[i][BigValueSize - 1], (uint8_t)(keyNbr + BigValueSize - 1));
+        }
+
+        // All keys: the contiguous entries are read with few large disk reads
+        uint64_t diskReadQtyBefore = stats.getBatchDiskReadQty.load();
+        s                          = diskStore.getBatch(keys, values, statuses);
+        CHECK_EQ(s, Status::Ok);
+        CHECK_LE(stats.getBatchDiskReadQty.load() - diskReadQtyBefore, 2);
+        for (uint32_t i = 0; i < EntryQty; ++i) {
+            CHECK_EQ(statuses[i], Status::Ok);
+            CHECK_EQ(values[i].size(), BigValueSize);
+            CHECK_EQ(values[i][0], (uint8_t)i);
+        }
+        CHECK_EQ(stats.getBatchCallQty.load(), 2);
+
+        s = diskStore.close();
+        CHECK_EQ(s, Status::Ok);
+        s = diskStore.getBatch(keys, values, statuses);
+        CHECK_EQ(s, Status::StoreNotOpen);
+    }
+
+    TEST_CASE("1-Sanity   : Full scan")
+    {
+        // Database cleanup and setup useful variables
+        SETUP_DB();
+        constexpr uint32_t EntryQty = 20000;
+
+        CHECK_EQ(store.scan([](const ScanEntry&) { return true; }), Status::StoreNotOpen);
+        s = store.open(databasePath);
+        CHECK_EQ(s, Status::Ok);
+
+        // Entries with their number in the key and in the value, some with a TTL and some removed
+        for (uint32_t keyNbr = 0; keyNbr < EntryQty; ++keyNbr) {
+            memcpy(&value[0], &keyNbr, 4);
+            s = store.put(&keyNbr, 4, value.data(), value.size(), {{1, 2}}, (keyNbr % 10 == 0) ? 1000 : 0);
+            CHECK_EQ(s, Status::Ok);
+        }
+        for (uint32_t keyNbr = 0; keyNbr < EntryQty; keyNbr += 4) { CHECK_EQ(store.remove(&keyNbr, 4), Status::Ok); }
+        const uint32_t ValidQty = EntryQty - EntryQty / 4;
+
+        // Without values
+        lcVector<uint32_t> seenQty(EntryQty, 0);
+        s = store.scan([&](const ScanEntry& entry) {
+            uint32_t keyNbr = 0;
+            CHECK_EQ(entry.key.size(), 4);
+            memcpy(&keyNbr, entry.key.data(), 4);
+            ++seenQty[keyNbr % EntryQty];
+            CHECK(entry.value.empty());
+            CHECK_EQ(entry.keyIndexes.size(), 1);
+            CHECK_EQ((entry.expTimeSec != 0), (keyNbr % 10 == 0));
+            return true;
+        });
+        CHECK_EQ(s, Status::Ok);
+        for (uint32_t keyNbr = 0; keyNbr < EntryQty; ++keyNbr) { CHECK_EQ(seenQty[keyNbr], (keyNbr % 4 == 0) ? 0 : 1); }
+        CHECK_EQ(store.getCounters().scanEntryQty.load(), ValidQty);
+        s = store.close();
+        CHECK_EQ(s, Status::Ok);
+
+        // With values read from the disk, in parallel disjoint ranges
+        Datastore diskStore(0);
+        s = diskStore.open(databasePath);
+        CHECK_EQ(s, Status::Ok);
+        constexpr uint32_t         RangeQty = 5;
+        std::atomic<uint32_t>      checkedValueQty{0};
+        lcVector<std::atomic<int>> rangeSeenQty(EntryQty);
+        lcVector<std::thread>      scanners;
+        for (uint32_t rangeIdx = 0; rangeIdx < RangeQty; ++rangeIdx) {
+            scanners.push_back(std::thread([&, rangeIdx]() {
+                Status scanStatus = diskStore.scan(
+                    [&](const ScanEntry& entry) {
+                        uint32_t keyNbr = 0, valueNbr = 0;
+                        memcpy(&keyNbr, entry.key.data(), 4);
+                        memcpy(&valueNbr, entry.value.data(), 4);
+                        if (keyNbr == valueNbr && entry.value.size() == VALUE_SIZE) { ++checkedValueQty; }
+                        ++rangeSeenQty[keyNbr % EntryQty];
+                        return true;
+                    },
+                    true, rangeIdx, RangeQty);
+                CHECK_EQ(scanStatus, Status::Ok);
+            }));
+        }
+        for (std::thread& t : scanners) { t.join(); }
+        CHECK_EQ(checkedValueQty.load(), ValidQty);
+        for (uint32_t keyNbr = 0; keyNbr < EntryQty; ++keyNbr) { CHECK_EQ(rangeSeenQty[keyNbr].load(), (keyNbr % 4 == 0) ? 0 : 1); }
+
+        // Early stop, and bad ranges
+        uint32_t providedQty = 0;
+        CHECK_EQ(diskStore.scan([&](const ScanEntry&) { return (++providedQty < 10); }), Status::Ok);
+        CHECK_EQ(providedQty, 10);
+        CHECK_EQ(diskStore.scan([](const ScanEntry&) { return true; }, false, 3, 3), Status::BadParameterValue);
+        CHECK_EQ(diskStore.scan([](const ScanEntry&) { return true; }, false, 0, 0), Status::BadParameterValue);
+
+        // Writers are not blocked during the scan, and the entries present during the whole scan are provided once,
+        // even if the key directory is resized in-between
+        std::fill(seenQty.begin(), seenQty.end(), 0);
+        uint32_t newKeyNbr = EntryQty;
+        s                  = diskStore.scan([&](const ScanEntry& entry) {
+            uint32_t keyNbr = 0;
+            memcpy(&keyNbr, entry.key.data(), 4);
+            if (keyNbr >= EntryQty) { return true; }  // New entry
+            ++seenQty[keyNbr];
+            for (int i = 0; i < 20; ++i, ++newKeyNbr) { CHECK_EQ(diskStore.put(&newKeyNbr, 4, value.data(), value.size()), Status::Ok); }
+            return true;
+        });
+        CHECK_EQ(s, Status::Ok);
+        for (uint32_t keyNbr = 0; keyNbr < EntryQty; ++keyNbr) { CHECK_EQ(seenQty[keyNbr], (keyNbr % 4 == 0) ? 0 : 1); }
+        CHECK_GT(newKeyNbr, 10 * EntryQty);
+    }
+
+    TEST_CASE("1-Sanity   : Fingerprint KeyDir")
+    {
+        // Database cleanup and setup useful variables
+        SETUP_DB();
+        constexpr uint32_t EntryQty = 2000;
+
+        // Long keys, indexed on their "group" part
+        auto makeKey = [](uint32_t keyNbr) {
+            char buffer[80];
+            snprintf(buffer, sizeof(buffer), "group%u/item%05u/%s", keyNbr % 4, keyNbr, "with-some-long-enough-suffix-to-be-realistic");
+            return lcString(buffer);
+        };
+        auto fillStore = [&](Datastore& ds) {
+            for (uint32_t keyNbr = 0; keyNbr < EntryQty; ++keyNbr) {
+                lcString key = makeKey(keyNbr);
+                memcpy(&value[0], &keyNbr, 4);
+                CHECK_EQ(ds.put(key, value, {{0, 6}}), Status::Ok);
+            }
+            for (uint32_t keyNbr = 0; keyNbr < EntryQty; keyNbr += 8) { CHECK_EQ(ds.remove(makeKey(keyNbr)), Status::Ok); }
+        };
+
+        // Reference KeyDir memory with the full keys
+        Datastore fullKeyStore;
+        s = fullKeyStore.open(databasePath);
+        CHECK_EQ(s, Status::Ok);
+        fillStore(fullKeyStore);
+        uint64_t fullKeyDirBytes = fullKeyStore._keyDir->getEstimatedUsedMemoryBytes();
+        CHECK_EQ(fullKeyStore.close(), Status::Ok);
+        Datastore::erasePermanentlyAllContent_UseWithCaution(databasePath);
+
+        Config config;
+        config.keyDirFingerprintMode = true;
+        CHECK_EQ(store.setConfig(config), Status::Ok);
+        s = store.open(databasePath);
+        CHECK_EQ(s, Status::Ok);
+        fillStore(store);
+        CHECK_LT(store._keyDir->getEstimatedUsedMemoryBytes(), fullKeyDirBytes);
+
+        auto checkContent = [&](Datastore& ds) {
+            for (uint32_t keyNbr = 0; keyNbr < EntryQty; ++keyNbr) {
+                uint32_t valueNbr = 0;
+                s                 = ds.get(makeKey(keyNbr), retrievedValue);
+                CHECK_EQ(s, (keyNbr % 8 == 0) ? Status::EntryNotFound : Status::Ok);
+                if (s == Status::Ok) { memcpy(&valueNbr, retrievedValue.data(), 4); }
+                if (s == Status::Ok) { CHECK_EQ(valueNbr, keyNbr); }
+            }
+            CHECK_EQ(ds.get(makeKey(EntryQty), retrievedValue), Status::EntryNotFound);
+
+            // The keys of the query and of the scan are read from the data files
+            lcVector<lcVector<uint8_t>> matchingKeys;
+            CHECK_EQ(ds.query(lcString("group1"), matchingKeys), Status::Ok);
+            CHECK_EQ(matchingKeys.size(), EntryQty / 4);
+            for (const auto& key : matchingKeys) { CHECK_EQ(memcmp(key.data(), "group1/", 7), 0); }
+            uint32_t scannedQty = 0;
+            auto     onEntry    = [&](const ScanEntry& entry) {
+                uint32_t valueNbr = 0;
+                memcpy(&valueNbr, entry.value.data(), 4);
+                lcString key = makeKey(valueNbr);
+                CHECK(entry.key == lcVector<uint8_t>(key.begin(), key.end()));
+                CHECK_EQ(entry.keyIndexes.size(), 1);
+                ++scannedQty;
+                return true;
+            };
+            CHECK_EQ(ds.scan(onEntry, true), Status::Ok);
+            CHECK_EQ(scannedQty, EntryQty - EntryQty / 8);
+        };
+        checkContent(store);
+        CHECK_EQ(store.close(), Status::Ok);
+
+        // From the disk, after reopening, and also updated
+        Datastore diskStore(0);
+        CHECK_EQ(diskStore.setConfig(config), Status::Ok);
+        s = diskStore.open(databasePath);
+        CHECK_EQ(s, Status::Ok);
+        checkContent(diskStore);
+        CHECK_GT(diskStore.getCounters().keyDiskReadQty.load(), 0);
+        fillStore(diskStore);
+        checkContent(diskStore);
+        CHECK_EQ(diskStore.close(), Status::Ok);
+
+        // The mode can be changed at the next opening
+        config.keyDirFingerprintMode = false;
+        CHECK_EQ(diskStore.setConfig(config), Status::Ok);
+        s = diskStore.open(databasePath);
+        CHECK_EQ(s, Status::Ok);
+        uint64_t keyDiskReadQty = diskStore.getCounters().keyDiskReadQty.load();
+        checkContent(diskStore);
+        CHECK_EQ(diskStore.getCounters().keyDiskReadQty.load(), keyDiskReadQty);
+    }
+
+    TEST_CASE("1-Sanity   : Value cache slab")
+    {
+        // Database cleanup and setup useful variables
+        SETUP_DB();
+        constexpr uint32_t EntryQty = 2000;
+
+        auto makeValue = [](uint32_t keyNbr, uint32_t version, uint32_t valueSize) {
+            lcVector<uint8_t> v(valueSize);
+            for (uint32_t i = 0; i < valueSize; ++i) { v[i] = (uint8_t)(keyNbr + version + i); }
+            return v;
+        };
+        auto checkContent = [&](Datastore& ds, int passQty) {
+            for (int pass = 0; pass < passQty; ++pass) {
+                for (uint32_t keyNbr = 0; keyNbr < EntryQty; ++keyNbr) {
+                    s = ds.get(&keyNbr, KEY_SIZE, retrievedValue);
+                    CHECK_EQ(s, (keyNbr % 8 == 0) ? Status::EntryNotFound : Status::Ok);
+                    if (s == Status::Ok) {
+                        CHECK(retrievedValue == makeValue(keyNbr, (keyNbr % 2 == 0) ? 1 : 0, (keyNbr % 4 == 3) ? 32 : VALUE_SIZE));
+                    }
+                }
+            }
+        };
+
+        // Small cache, so that the values are evicted and the slab-sized cache chunks recycled. One key over four has a value
+        // size not matching the slab one
+        Datastore slabStore(64 * 1024);
+        slabStore.setLogLevel(LogLevel::Warn);
+        Config config                  = slabStore.getConfig();
+        config.valueCacheSlabValueSize = VALUE_SIZE;
+        CHECK_EQ(slabStore.setConfig(config), Status::Ok);
+        CHECK_EQ(slabStore.open(databasePath), Status::Ok);
+        for (uint32_t keyNbr = 0; keyNbr < EntryQty; ++keyNbr) {
+            lcVector<uint8_t> v = makeValue(keyNbr, 0, (keyNbr % 4 == 3) ? 32 : VALUE_SIZE);
+            CHECK_EQ(slabStore.put(&keyNbr, KEY_SIZE, v.data(), v.size()), Status::Ok);
+        }
+        for (uint32_t keyNbr = 0; keyNbr < EntryQty; keyNbr += 2) {
+            lcVector<uint8_t> v = makeValue(keyNbr, 1, VALUE_SIZE);
+            CHECK_EQ(slabStore.put(&keyNbr, KEY_SIZE, v.data(), v.size()), Status::Ok);
+        }
+        for (uint32_t keyNbr = 0; keyNbr < EntryQty; keyNbr += 8) { CHECK_EQ(slabStore.remove(&keyNbr, KEY_SIZE), Status::Ok); }
+
+        checkContent(slabStore, 2);
+        CHECK_GT(slabStore.getValueCacheCounters().evictedQty.load(), 0);
+        for (int pass = 0; pass < 3; ++pass) {  // Working set fitting in the cache
+            for (uint32_t keyNbr = 1; keyNbr < 200; keyNbr += 2) {
+                CHECK_EQ(slabStore.get(&keyNbr, KEY_SIZE, retrievedValue), Status::Ok);
+                CHECK(retrievedValue == makeValue(keyNbr, 0, (keyNbr % 4 == 3) ? 32 : VALUE_SIZE));
+            }
+        }
+        CHECK_GT(slabStore.getValueCacheCounters().hitQty.load(), 0);
+        CHECK_LE(slabStore.getValueCacheAllocatedBytes(), slabStore.getValueCacheMaxAllocatableBytes());
+        CHECK_EQ(slabStore.close(), Status::Ok);
+
+        // The data files do not depend on the slab option
+        CHECK_EQ(store.open(databasePath), Status::Ok);
+        checkContent(store, 1);
+        CHECK_EQ(store.close(), Status::Ok);
+    }
+
+    TEST_CASE("1-Sanity   : Asynchronous get")
+    {
+        // Database cleanup and setup useful variables
+        SETUP_DB();
+        constexpr uint32_t EntryQty = 100;
+
+        s = store.open(databasePath);
+        CHECK_EQ(s, Status::Ok);
+        for (uint32_t i = 0; i < EntryQty; ++i) {
+            value[0] = (uint8_t)i;
+            s        = store.put(&i, sizeof(i), value.data(), value.size());
+            CHECK_EQ(s, Status::Ok);
+        }
+        s = store.close();
+        CHECK_EQ(s, Status::Ok);
+
+        // Reopen without value cache so that all values are read from the disk
+        Datastore diskStore(0);
+        s = diskStore.open(databasePath);
+        CHECK_EQ(s, Status::Ok);
+
+        std::mutex              mx;
+        std::condition_variable cv;
+        uint32_t                completedQty = 0;
+        uint32_t                okQty        = 0;
+        for (uint32_t i = 0; i < EntryQty; ++i) {
+            s = diskStore.getAsync(&i, sizeof(i), [&, i](Status status, const lcVector<uint8_t>& v) {
+                std::lock_guard<std::mutex> lk(mx);
+                if (status == Status::Ok && v.size() == VALUE_SIZE && v[0] == (uint8_t)i && v[VALUE_SIZE - 1] == VALUE_SIZE - 1) { ++okQty; }
+                if (++completedQty == EntryQty) { cv.notify_one(); }
+            });
+            CHECK_EQ(s, Status::Ok);
+        }
+        {
+            std::unique_lock<std::mutex> lk(mx);
+            cv.wait(lk, [&] { return completedQty == EntryQty; });
+        }
+        CHECK_EQ(okQty, EntryQty);
+#if LITECASK_IO_URING_ENABLED
+        if (diskStore._asyncReader.isStarted()) { CHECK_EQ(diskStore.getCounters().getAsyncDiskReadQty.load(), EntryQty); }
+#else
+        CHECK_EQ(diskStore.getCounters().getAsyncDiskReadQty.load(), 0);  // Synchronous fallback, the callback is called by 'getAsync'
+#endif
+
+        // Not found entry is reported through the callback, bad parameters directly
+        Status asyncStatus = Status::Ok;
+        s                  = diskStore.getAsync("unknown", [&](Status status, const lcVector<uint8_t>&) { asyncStatus = status; });
+        CHECK_EQ(s, Status::Ok);
+        CHECK_EQ(asyncStatus, Status::EntryNotFound);
+        s = diskStore.getAsync(lcString(), [&](Status, const lcVector<uint8_t>&) { CHECK(false); });
+        CHECK_EQ(s, Status::BadKeySize);
+
+        s = diskStore.close();
+        CHECK_EQ(s, Status::Ok);
+        s = diskStore.getAsync("unknown", [&](Status, const lcVector<uint8_t>&) { CHECK(false); });
+        CHECK_EQ(s, Status::StoreNotOpen);
+    }
+
+#if LITECASK_IO_URING_ENABLED
+    TEST_CASE("1-Sanity   : Asynchronous reader submission failure")
+    {
+        constexpr uint32_t RequestQty = 3;
+        AsyncReader        reader;
+        if (!reader.start(64)) { return; }  // io_uring is not available
+
+        // The submission system call fails on a file which is not a ring
+        int ringFd     = reader._ringFd;
+        int badFd      = ::open("/dev/null", O_RDONLY);
+        reader._ringFd = badFd;
+
+        uint8_t               buffer[16];
+        uint32_t              failedQty = 0;
+        AsyncReader::Request  requests[RequestQty];
+        AsyncReader::Request* requestPtrs[RequestQty];
+        auto                  setRequests = [&]() {
+            for (uint32_t i = 0; i < RequestQty; ++i) {
+                requests[i].handle       = badFd;
+                requests[i].iov[0]       = {buffer, sizeof(buffer)};
+                requests[i].onCompletion = [&](bool isReadOk) { failedQty += isReadOk ? 0 : 1; };
+                requestPtrs[i]           = &requests[i];
+            }
+        };
+        setRequests();
+        CHECK_FALSE(reader.submit(requestPtrs, RequestQty));
+        CHECK_EQ(failedQty, RequestQty);
+        for (const AsyncReader::Request& r : requests) { CHECK(r.isSubmitFailed); }
+        CHECK_EQ(reader._inFlightQty.load(), 0);
+
+        // The reader is not used anymore
+        setRequests();
+        CHECK_FALSE(reader.submit(requestPtrs, RequestQty));
+        CHECK_EQ(failedQty, 2 * RequestQty);
+
+        // The stop does not wait for the lost reads
+        reader._ringFd = ringFd;
+        reader.stop();
+        CHECK_FALSE(reader.isStarted());
+        ::close(badFd);
+    }
+#endif
+
+    TEST_CASE("1-Sanity   : Asynchronous prefetch")
+    {
+        // Database cleanup and setup useful variables
+        SETUP_DB();
+        constexpr uint32_t EntryQty = 500;
+
+        s = store.open(databasePath);
+        CHECK_EQ(s, Status::Ok);
+        for (uint32_t i = 0; i < EntryQty; ++i) {
+            value[0] = (uint8_t)i;
+            s        = store.put(&i, sizeof(i), value.data(), value.size());
+            CHECK_EQ(s, Status::Ok);
+        }
+        s = store.close();
+        CHECK_EQ(s, Status::Ok);
+        CHECK_EQ(store.prefetch(lcVector<lcString>{"unknown"}), Status::StoreNotOpen);
+
+        // Reopen with an empty cache, and prefetch half of the keys
+        Datastore cacheStore;
+        s = cacheStore.open(databasePath);
+        CHECK_EQ(s, Status::Ok);
+        const DatastoreCounters&    stats = cacheStore.getCounters();
+        lcVector<lcVector<uint8_t>> keys;
+        for (uint32_t i = 0; i < EntryQty; i += 2) { keys.push_back({(uint8_t)i, (uint8_t)(i >> 8), 0, 0}); }
+        keys.push_back({'u', 'n', 'k', 'n', 'o', 'w', 'n'});
+        CHECK_EQ(cacheStore.prefetch(keys), Status::Ok);
+        int round = 0;
+        while (stats.prefetchLoadedValueQty.load() < EntryQty / 2 && round < 1000) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            ++round;
+        }
+        CHECK_EQ(stats.prefetchLoadedValueQty.load(), EntryQty / 2);
+        CHECK_LT(stats.prefetchDiskReadQty.load(), 5);  // Close entries are coalesced
+
+        // The prefetched values are served from the cache, the others from the disk
+        for (uint32_t i = 0; i < EntryQty; ++i) {
+            CHECK_EQ(cacheStore.get(&i, sizeof(i), retrievedValue), Status::Ok);
+            CHECK_EQ(retrievedValue.size(), VALUE_SIZE);
+            CHECK_EQ(retrievedValue[0], (uint8_t)i);
+        }
+        CHECK_EQ(stats.getCacheHitQty.load(), EntryQty / 2);
+        CHECK_EQ(stats.getCallDiskReadQty.load(), EntryQty / 2);
+
+        // Already cached values are not read again
+        uint64_t diskReadQty = stats.prefetchDiskReadQty.load();
+        CHECK_EQ(cacheStore.prefetch(keys), Status::Ok);
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        CHECK_EQ(stats.prefetchDiskReadQty.load(), diskReadQty);
+        CHECK_EQ(stats.prefetchCallQty.load(), 2);
+
+        s = cacheStore.close();
+        CHECK_EQ(s, Status::Ok);
+    }
+
+    TEST_CASE("1-Sanity   : Write batch")
+    {
+        // Database cleanup and setup useful variables
+        SETUP_DB();
+        WriteBatch batch;
+
+        // Inputs are checked when building the batch
+        CHECK_EQ(batch.put(&numberKey, 0, &value[0], VALUE_SIZE), Status::BadKeySize);
+        CHECK_EQ(batch.put(&numberKey, 4, &value[0], VALUE_SIZE, {{2, 3}}), Status::InconsistentKeyIndex);
+        CHECK_EQ(batch.put(&numberKey, 4, &value[0], VALUE_SIZE, {{1, 1}, {0, 1}}), Status::UnorderedKeyIndex);
+        CHECK_EQ(batch.remove(&numberKey, 0), Status::BadKeySize);
+        CHECK(batch.empty());
+
+        // Calls before initialization
+        CHECK_EQ(batch.put(&numberKey, 4, &value[0], VALUE_SIZE), Status::Ok);
+        CHECK_EQ(store.write(batch), Status::StoreNotOpen);
+        CHECK_EQ(store.getCounters().writeBatchCallFailedQty, 1);
+        batch.clear();
+
+        s = store.open(databasePath);
+        CHECK_EQ(s, Status::Ok);
+
+        // Batch with 100 indexed entries, then removal of the even ones inside the same batch and of an unknown key
+        constexpr uint32_t EntryQty = 100;
+        for (numberKey = 0; numberKey < EntryQty; ++numberKey) {
+            *((uint32_t*)&value[0]) = numberKey;
+            CHECK_EQ(batch.put(&numberKey, 4, &value[0], VALUE_SIZE, {{3, 1}}), Status::Ok);
+        }
+        for (numberKey = 0; numberKey < EntryQty; numberKey += 2) { CHECK_EQ(batch.remove(&numberKey, 4), Status::Ok); }
+        numberKey = 1000;
+        CHECK_EQ(batch.remove(&numberKey, 4), Status::Ok);
+        CHECK_EQ(batch.size(), EntryQty + EntryQty / 2 + 1);
+
+        s = store.write(batch, true);
+        CHECK_EQ(s, Status::Ok);
+        CHECK_EQ(store.getCounters().writeBatchCallQty, 1);
+        CHECK_EQ(store.getCounters().putCallQty, EntryQty);
+        CHECK_EQ(store.getCounters().removeCallQty, EntryQty / 2);
+        CHECK_EQ(store.getCounters().removeCallNotFoundQty, 1);
+
+        // The update of an entry inside a batch replaces the previous value, also inside the same batch
+        batch.clear();
+        numberKey = 1;
+        CHECK_EQ(batch.put(&numberKey, 4, &value[0], VALUE_SIZE, {{3, 1}}), Status::Ok);
+        CHECK_EQ(batch.put(&numberKey, 4, &value2[0], VALUE_SIZE, {{3, 1}}), Status::Ok);
+        s = store.write(batch);
+        CHECK_EQ(s, Status::Ok);
+
+        // Check the content, also after a reopening
+        for (int pass = 0; pass < 2; ++pass) {
+            for (numberKey = 0; numberKey < EntryQty; ++numberKey) {
+                s = store.get(&numberKey, 4, retrievedValue);
+                CHECK_EQ(s, ((numberKey % 2) == 0) ? Status::EntryNotFound : Status::Ok);
+                if (s == Status::Ok) {
+                    CHECK_EQ(retrievedValue.size(), VALUE_SIZE);
+                    if (numberKey == 1) {
+                        CHECK_EQ(retrievedValue[7], value2[7]);
+                    } else {
+                        CHECK_EQ(*((uint32_t*)&retrievedValue[0]), numberKey);
+                    }
+                }
+            }
+            lcVector<lcVector<uint8_t>> matchingKeys;
+            s = store.query(lcVector<uint8_t>{0}, matchingKeys);
+            CHECK_EQ(s, Status::Ok);
+            CHECK_EQ(matchingKeys.size(), EntryQty / 2);
+
+            s = store.close();
+            CHECK_EQ(s, Status::Ok);
+            s = store.open(databasePath);
+            CHECK_EQ(s, Status::Ok);
+        }
+
+        // A batch bigger than the write buffer and the data file size
+        store.setWriteBufferBytes(1000);
+        Config config                                = store.getConfig();
+        config.dataFileMaxBytes                      = 10000;
+        config.mergeTriggerDataFileDeadByteThreshold = 5000;
+        config.mergeSelectDataFileDeadByteThreshold  = 1024;
+        config.mergeSelectDataFileSmallSizeTheshold  = 1024;
+        s                                            = store.setConfig(config);
+        CHECK_EQ(s, Status::Ok);
+        batch.clear();
+        lcVector<uint8_t> bigValue(5000, 42);
+        for (numberKey = 0; numberKey < EntryQty; ++numberKey) {
+            CHECK_EQ(batch.put(&numberKey, 4, (numberKey == 50) ? &bigValue[0] : &value[0], (numberKey == 50) ? bigValue.size() : VALUE_SIZE),
+                     Status::Ok);
+        }
+        uint64_t switchQty = store.getCounters().activeDataFileSwitchQty;
+        s                  = store.write(batch);
+        CHECK_EQ(s, Status::Ok);
+        CHECK(store.getCounters().activeDataFileSwitchQty > switchQty);
+        for (numberKey = 0; numberKey < EntryQty; ++numberKey) {
+            s = store.get(&numberKey, 4, retrievedValue);
+            CHECK_EQ(s, Status::Ok);
+            CHECK_EQ(retrievedValue.size(), (numberKey == 50) ? bigValue.size() : VALUE_SIZE);
+        }
+
+        s = store.close();
+        CHECK_EQ(s, Status::Ok);
+    }
+
+    TEST_CASE("1-Sanity   : Value compression")
+    {
+        // Database cleanup and setup useful variables
+        SETUP_DB();
+        constexpr uint32_t EntryQty = 1000;
+
+        // Built-in codec: round trip on compressible, incompressible and far repetitive data (above the 16-bit offsets)
+        for (size_t size : {0, 1, 7, 100, 1000, 100'000}) {
+            lcVector<uint8_t> raw(size), compressed(size + size / 100 + 16), decompressed(size);
+            for (size_t i = 0; i < size; ++i) { raw[i] = (uint8_t)((i % 3000) < 1500 ? (i % 7) : (i * 2654435761U) >> 24); }
+            size_t compressedSize = lzCompress(raw.data(), size, compressed.data(), compressed.size());
+            CHECK_GT(compressedSize, 0);
+            CHECK(lzDecompress(compressed.data(), compressedSize, decompressed.data(), size));
+            CHECK(decompressed == raw);
+            if (size >= 1000) { CHECK_LT(compressedSize, size * 3 / 4); }
+            if (compressedSize > 1) { CHECK_FALSE(lzDecompress(compressed.data(), compressedSize - 1, decompressed.data(), size)); }
+        }
+        CHECK_EQ(lzCompress(value.data(), VALUE_SIZE, retrievedValue.data(), 0), 0);  // Too small output
+
+        // JSON-like values, highly compressible
+        auto makeValue = [](uint32_t i) {
+            char buffer[64];
+            snprintf(buffer, sizeof(buffer), "{\"id\": %u, \"name\": \"user\", \"active\": true}, ", i);
+            lcString text;
+            for (int j = 0; j < 20; ++j) { text += buffer; }
+            return lcVector<uint8_t>(text.begin(), text.end());
+        };
+
+        Config config;
+        config.valueCompressionMinBytes = 4;
+        CHECK_EQ(store.setConfig(config), Status::BadParameterValue);
+        config.valueCompression         = true;
+        config.valueCompressionMinBytes = 64;
+        CHECK_EQ(store.setConfig(config), Status::Ok);
+        s = store.open(databasePath);
+        CHECK_EQ(s, Status::Ok);
+        CHECK_EQ(store.setValueCodec({}), Status::StoreAlreadyOpen);
+
+        uint64_t rawBytes = 0;
+        for (uint32_t i = 0; i < EntryQty / 2; ++i) {
+            lcVector<uint8_t> v = makeValue(i);
+            rawBytes += v.size();
+            CHECK_EQ(store.put(&i, 4, v.data(), v.size()), Status::Ok);
+        }
+        WriteBatch batch;
+        for (uint32_t i = EntryQty / 2; i < EntryQty; ++i) {
+            lcVector<uint8_t> v = makeValue(i);
+            rawBytes += v.size();
+            CHECK_EQ(batch.put(&i, 4, v.data(), v.size()), Status::Ok);
+        }
+        numberKey = EntryQty;
+        CHECK_EQ(batch.put(&numberKey, 4, value.data(), 8), Status::Ok);  // Too small to be compressed
+        CHECK_EQ(store.write(batch), Status::Ok);
+        CHECK_LT(store.getFileStats().entryBytes, rawBytes / 2);
+
+        // Reading from the write buffer or the cache, with all the output variants
+        auto checkValues = [&](Datastore& st) {
+            for (uint32_t i = 0; i < EntryQty; ++i) {
+                lcVector<uint8_t> expected = makeValue(i);
+                CHECK_EQ(st.get(&i, 4, retrievedValue), Status::Ok);
+                CHECK(retrievedValue == expected);
+            }
+            numberKey = 3;
+            lcVector<uint8_t> expected = makeValue(numberKey);
+            lcVector<uint8_t> buffer(expected.size());
+            size_t            valueSize = 0;
+            CHECK_EQ(st.get(&numberKey, 4, buffer.data(), buffer.size() - 1, valueSize), Status::BufferTooSmall);
+            CHECK_EQ(valueSize, expected.size());
+            CHECK_EQ(st.get(&numberKey, 4, buffer.data(), buffer.size(), valueSize), Status::Ok);
+            CHECK(buffer == expected);
+            CHECK_EQ(st.get(&numberKey, 4, [&](const uint8_t* v, size_t vs) { CHECK(lcVector<uint8_t>(v, v + vs) == expected); }),
+                     Status::Ok);
+            lcVector<lcVector<uint8_t>> keys{{3, 0, 0, 0}, {(uint8_t)(EntryQty - 1), (uint8_t)((EntryQty - 1) >> 8), 0, 0}}, values;
+            lcVector<Status>            statuses;
+            CHECK_EQ(st.getBatch(keys, values, statuses), Status::Ok);
+            CHECK_EQ(statuses[0], Status::Ok);
+            CHECK_EQ(statuses[1], Status::Ok);
+            CHECK(values[0] == expected);
+            CHECK(values[1] == makeValue(EntryQty - 1));
+            numberKey = EntryQty;
+            CHECK_EQ(st.get(&numberKey, 4, retrievedValue), Status::Ok);
+            CHECK(retrievedValue == lcVector<uint8_t>(value.begin(), value.begin() + 8));
+        };
+        checkValues(store);
+        s = store.close();
+        CHECK_EQ(s, Status::Ok);
+
+        // Reading from the disk, after a reload from the hint files
+        Datastore diskStore(0);
+        s = diskStore.open(databasePath);
+        CHECK_EQ(s, Status::Ok);
+        checkValues(diskStore);
+        CHECK_EQ(diskStore.getCounters().getCallCorruptedQty.load(), 0);
+        s = diskStore.close();
+        CHECK_EQ(s, Status::Ok);
+    }
+
+    TEST_CASE("1-Sanity   : Blob files for large values")
+    {
+        // Database cleanup and setup useful variables
+        SETUP_DB();
+        constexpr uint32_t BlobKeyQty = 20;
+        constexpr uint32_t BlobSize   = 20'000;
+
+        auto makeBlob = [](uint32_t i, uint32_t version) {
+            lcVector<uint8_t> v(BlobSize + i * 1000);
+            for (size_t j = 0; j < v.size(); ++j) { v[j] = (uint8_t)(j * 31 + i + version); }
+            return v;
+        };
+        auto getBlobFileQty = [&]() {
+            int count = 0;
+            for (const auto& entry : std::filesystem::directory_iterator(databasePath)) {
+                if (entry.path().extension() == BlobFileSuffix) { ++count; }
+            }
+            return count;
+        };
+
+        Config config;
+        config.blobMinBytes = 100;
+        CHECK_EQ(store.setConfig(config), Status::BadParameterValue);
+        config.blobMinBytes                          = 8192;
+        config.valueCompression                      = true;  // Ignored for the values in blob files
+        config.mergeTriggerDataFileDeadByteThreshold = 16;
+        config.mergeSelectDataFileDeadByteThreshold  = 16;
+        CHECK_EQ(store.setConfig(config), Status::Ok);
+        s = store.open(databasePath);
+        CHECK_EQ(s, Status::Ok);
+
+        // Keys [0; 20[ have a value in a blob file, keys [20; 40[ a small value
+        for (uint32_t i = 0; i < BlobKeyQty; ++i) {
+            lcVector<uint8_t> blob = makeBlob(i, 0);
+            CHECK_EQ(store.put(&i, 4, blob.data(), blob.size()), Status::Ok);
+        }
+        for (uint32_t i = BlobKeyQty; i < 2 * BlobKeyQty; ++i) { CHECK_EQ(store.put(&i, 4, value.data(), VALUE_SIZE), Status::Ok); }
+        CHECK_EQ(store.getCounters().blobWriteQty.load(), BlobKeyQty);
+        CHECK_EQ(getBlobFileQty(), BlobKeyQty);
+        CHECK_LT(store.getFileStats().entryBytes, 2 * BlobKeyQty * (100 + VALUE_SIZE));
+
+        auto checkValues = [&](Datastore& st, uint32_t version) {
+            for (uint32_t i = 0; i < 2 * BlobKeyQty; ++i) {
+                if (version > 0 && i >= BlobKeyQty / 2 && i < 3 * BlobKeyQty / 4) {  // Removed
+                    CHECK_EQ(st.get(&i, 4, retrievedValue), Status::EntryNotFound);
+                    continue;
+                }
+                CHECK_EQ(st.get(&i, 4, retrievedValue), Status::Ok);
+                CHECK(retrievedValue == ((i < BlobKeyQty) ? makeBlob(i, (i < BlobKeyQty / 2) ? version : 0) : value));
+            }
+
+            numberKey                  = 3;
+            lcVector<uint8_t> expected = makeBlob(numberKey, version);
+            lcVector<uint8_t> buffer(expected.size());
+            size_t            valueSize = 0;
+            CHECK_EQ(st.get(&numberKey, 4, buffer.data(), buffer.size() - 1, valueSize), Status::BufferTooSmall);
+            CHECK_EQ(valueSize, expected.size());
+            CHECK_EQ(st.get(&numberKey, 4, buffer.data(), buffer.size(), valueSize), Status::Ok);
+            CHECK(buffer == expected);
+            CHECK_EQ(st.get(&numberKey, 4, [&](const uint8_t* v, size_t vs) { CHECK(lcVector<uint8_t>(v, v + vs) == expected); }),
+                     Status::Ok);
+
+            lcVector<lcVector<uint8_t>> keys{{3, 0, 0, 0}, {BlobKeyQty, 0, 0, 0}, {BlobKeyQty - 1, 0, 0, 0}}, values;
+            lcVector<Status>            statuses;
+            CHECK_EQ(st.getBatch(keys, values, statuses), Status::Ok);
+            CHECK_EQ(statuses[0], Status::Ok);
+            CHECK_EQ(statuses[1], Status::Ok);
+            CHECK_EQ(statuses[2], Status::Ok);
+            CHECK(values[0] == expected);
+            CHECK(values[1] == value);
+            CHECK(values[2] == makeBlob(BlobKeyQty - 1, 0));
+            CHECK_EQ(st.getCounters().getCallCorruptedQty.load(), 0);
+        };
+
+        // The values in blob files are never cached: each get reads the blob file, only the small values are in the cache
+        checkValues(store, 0);
+        uint64_t blobReadQty = store.getCounters().blobReadQty.load();
+        checkValues(store, 0);
+        CHECK_EQ(store.getCounters().blobReadQty.load(), 2 * blobReadQty);
+        CHECK_LT(store._valueCache->getAllocatedBytes(), BlobKeyQty * BlobSize);
+
+        // The merge removes the blob files of the overwritten and removed values
+        for (uint32_t i = 0; i < BlobKeyQty / 2; ++i) {
+            lcVector<uint8_t> blob = makeBlob(i, 1);
+            CHECK_EQ(store.put(&i, 4, blob.data(), blob.size()), Status::Ok);
+        }
+        for (uint32_t i = BlobKeyQty / 2; i < 3 * BlobKeyQty / 4; ++i) { CHECK_EQ(store.remove(&i, 4), Status::Ok); }
+        CHECK_EQ(getBlobFileQty(), BlobKeyQty + BlobKeyQty / 2);
+        CHECK(store.requestMerge());
+        int round = 0;
+        while (store.isMergeOnGoing() && round < 1000) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+            ++round;
+        }
+        CHECK(round < 1000);
+        CHECK_EQ(store.getCounters().blobRemovedQty.load(), 3 * BlobKeyQty / 4);
+        CHECK_EQ(getBlobFileQty(), BlobKeyQty - BlobKeyQty / 4);
+        checkValues(store, 1);
+        s = store.close();
+        CHECK_EQ(s, Status::Ok);
+
+        // Reading from the disk after reload. New blob files do not overwrite the existing ones
+        Datastore diskStore(0);
+        CHECK_EQ(diskStore.setConfig(config), Status::Ok);
+        s = diskStore.open(databasePath);
+        CHECK_EQ(s, Status::Ok);
+        checkValues(diskStore, 1);
+        uint32_t          newKey  = 2 * BlobKeyQty;
+        lcVector<uint8_t> newBlob = makeBlob(newKey, 2);
+        CHECK_EQ(diskStore.put(&newKey, 4, newBlob.data(), newBlob.size()), Status::Ok);
+        CHECK_EQ(getBlobFileQty(), BlobKeyQty - BlobKeyQty / 4 + 1);
+        checkValues(diskStore, 1);
+        CHECK_EQ(diskStore.get(&newKey, 4, retrievedValue), Status::Ok);
+        CHECK(retrievedValue == newBlob);
+        s = diskStore.close();
+        CHECK_EQ(s, Status::Ok);
+    }
+
+    TEST_CASE("1-Sanity   : Online checkpoint")
+    {
+        // Database cleanup and setup useful variables
+        SETUP_DB();
+        constexpr uint32_t KeyQty         = 1000;
+        constexpr uint32_t BlobKeyQty     = 5;
+        const char*        checkpointPath = "/tmp/litecask_test/basic_checkpoint";
+        Datastore::erasePermanentlyAllContent_UseWithCaution(checkpointPath);
+        lcVector<uint8_t> blob(10'000, 0x5A);
+
+        CHECK_EQ(store.checkpoint(checkpointPath), Status::StoreNotOpen);
+        Config config;
+        config.writeLaneQty                          = 2;
+        config.blobMinBytes                          = 8192;
+        config.mergeTriggerDataFileDeadByteThreshold = 16;
+        config.mergeSelectDataFileDeadByteThreshold  = 16;
+        CHECK_EQ(store.setConfig(config), Status::Ok);
+        s = store.open(databasePath);
+        CHECK_EQ(s, Status::Ok);
+        for (uint32_t i = 0; i < KeyQty; ++i) { CHECK_EQ(store.put(&i, 4, value.data(), VALUE_SIZE), Status::Ok); }
+        for (uint32_t i = KeyQty; i < KeyQty + BlobKeyQty; ++i) { CHECK_EQ(store.put(&i, 4, blob.data(), blob.size()), Status::Ok); }
+
+        // The entries are not synced on disk yet: the checkpoint switches the active data files
+        uint64_t switchQty = store.getCounters().activeDataFileSwitchQty.load();
+        CHECK_EQ(store.checkpoint(databasePath), Status::BadParameterValue);
+        CHECK_EQ(store.checkpoint(checkpointPath), Status::Ok);
+        CHECK_EQ(store.getCounters().activeDataFileSwitchQty.load(), switchQty + 2);
+        CHECK_GE(store.getCounters().checkpointLinkedFileQty.load(), 2 + BlobKeyQty);
+        CHECK_EQ(store.checkpoint(checkpointPath), Status::BadParameterValue);  // Already containing a datastore
+        CHECK_EQ(store.getCounters().checkpointCallQty.load(), 4);
+        CHECK_EQ(store.getCounters().checkpointCallFailedQty.load(), 3);
+
+        // Later modifications and merge of the source store do not alter the checkpoint
+        for (uint32_t i = 0; i < KeyQty / 2; ++i) { CHECK_EQ(store.put(&i, 4, value2.data(), VALUE_SIZE), Status::Ok); }
+        for (uint32_t i = KeyQty / 2; i < KeyQty + BlobKeyQty; ++i) { CHECK_EQ(store.remove(&i, 4), Status::Ok); }
+        CHECK(store.requestMerge());
+        int round = 0;
+        while (store.isMergeOnGoing() && round < 1000) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+            ++round;
+        }
+        CHECK(round < 1000);
+        CHECK_EQ(store.getCounters().blobRemovedQty.load(), BlobKeyQty);
+
+        Datastore checkpointStore;
+        CHECK_EQ(checkpointStore.open(checkpointPath), Status::Ok);
+        for (uint32_t i = 0; i < KeyQty + BlobKeyQty; ++i) {
+            CHECK_EQ(checkpointStore.get(&i, 4, retrievedValue), Status::Ok);
+            CHECK(retrievedValue == ((i < KeyQty) ? value : blob));
+        }
+        CHECK_EQ(checkpointStore.close(), Status::Ok);
+
+        numberKey = 0;
+        CHECK_EQ(store.get(&numberKey, 4, retrievedValue), Status::Ok);
+        CHECK(retrievedValue == value2);
+        numberKey = KeyQty;
+        CHECK_EQ(store.get(&numberKey, 4, retrievedValue), Status::EntryNotFound);
+        s = store.close();
+        CHECK_EQ(s, Status::Ok);
+    }
+
+    TEST_CASE("1-Sanity   : Change log replication")
+    {
+        // Database cleanup and setup useful variables
+        SETUP_DB();
+        constexpr uint32_t KeyQty      = 200;
+        const char*        replicaPath = "/tmp/litecask_test/basic_replica";
+        Datastore::erasePermanentlyAllContent_UseWithCaution(replicaPath);
+        lcVector<uint8_t> blob(10'000, 0x3C);
+        lcVector<uint8_t> compressibleValue(1000, 0x11);
+
+        Config config;
+        config.writeLaneQty                          = 2;
+        config.valueCompression                      = true;
+        config.blobMinBytes                          = 8192;
+        config.changeLogRetainedDataFileQty          = 100;
+        config.mergeTriggerDataFileDeadByteThreshold = 16;
+        config.mergeSelectDataFileDeadByteThreshold  = 16;
+        CHECK_EQ(store.setConfig(config), Status::Ok);
+        ChangeLogCursor        cursor;
+        lcVector<ChangeRecord> records;
+        CHECK_EQ(store.readChangeLog(cursor, 10, records), Status::StoreNotOpen);
+        s = store.open(databasePath);
+        CHECK_EQ(s, Status::Ok);
+        for (uint32_t i = 0; i < KeyQty; ++i) { CHECK_EQ(store.put(&i, 4, value.data(), VALUE_SIZE), Status::Ok); }
+
+        // The replica starts from a checkpoint, then follows the change log
+        CHECK_EQ(store.checkpoint(replicaPath, &cursor), Status::Ok);
+        Datastore replica;
+        CHECK_EQ(replica.setConfig(config), Status::Ok);
+        CHECK_EQ(replica.open(replicaPath), Status::Ok);
+
+        for (uint32_t i = 0; i < KeyQty / 2; ++i) { CHECK_EQ(store.put(&i, 4, value2.data(), VALUE_SIZE), Status::Ok); }
+        for (uint32_t i = KeyQty / 2; i < 3 * KeyQty / 4; ++i) { CHECK_EQ(store.remove(&i, 4), Status::Ok); }
+        lcVector<uint8_t> indexedKey{'u', 's', 'e', 'r', '1'};
+        CHECK_EQ(store.put(indexedKey, compressibleValue, {{0, 4}}), Status::Ok);
+        numberKey = KeyQty;
+        CHECK_EQ(store.put(&numberKey, 4, blob.data(), blob.size(), {}, 3600), Status::Ok);
+        store.sync();
+
+        auto followChangeLog = [&]() {
+            uint32_t recordQty = 0;
+            do {
+                CHECK_EQ(store.readChangeLog(cursor, 16, records), Status::Ok);
+                CHECK_EQ(replica.applyReplicated(records), Status::Ok);
+                recordQty += (uint32_t)records.size();
+            } while (!records.empty());
+            return recordQty;
+        };
+        CHECK_EQ(followChangeLog(), KeyQty / 2 + KeyQty / 4 + 2);
+        CHECK_EQ(followChangeLog(), 0);
+        CHECK_EQ(store.getCounters().changeLogRecordQty.load(), KeyQty / 2 + KeyQty / 4 + 2);
+
+        auto checkReplica = [&]() {
+            lcVector<uint8_t> replicaValue;
+            for (uint32_t i = 0; i <= KeyQty; ++i) {
+                Status primaryStatus = store.get(&i, 4, retrievedValue);
+                CHECK_EQ(replica.get(&i, 4, replicaValue), primaryStatus);
+                CHECK(replicaValue == retrievedValue);
+            }
+            CHECK_EQ(replica.get(indexedKey, replicaValue), Status::Ok);
+            CHECK(replicaValue == compressibleValue);
+            lcVector<lcVector<uint8_t>> matchingKeys;
+            CHECK_EQ(replica.query(lcVector<uint8_t>{'u', 's', 'e', 'r'}, matchingKeys), Status::Ok);
+            CHECK_EQ(matchingKeys.size(), 1);
+        };
+        checkReplica();
+        CHECK_EQ(replica.getCounters().blobWriteQty.load(), 1);
+
+        // The position survives the active data file switches and the merges of the primary
+        CHECK(store.requestMerge());
+        int round = 0;
+        while (store.isMergeOnGoing() && round < 1000) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+            ++round;
+        }
+        CHECK(round < 1000);
+        for (uint32_t i = 0; i < KeyQty / 4; ++i) { CHECK_EQ(store.put(&i, 4, value.data(), VALUE_SIZE), Status::Ok); }
+        store.sync();
+        CHECK_EQ(followChangeLog(), KeyQty / 4);
+        checkReplica();
+
+        // A position in a data file which does not exist anymore (merged) is lost
+        ChangeLogCursor lostCursor{cursor.nextDataFileNumber, {(uint64_t)1 << 32}};
+        CHECK_EQ(store.readChangeLog(lostCursor, 16, records), Status::EntryNotFound);
+        CHECK_EQ(store.getCounters().changeLogReadFailedQty.load(), 2);
+
+        CHECK_EQ(replica.close(), Status::Ok);
+        s = store.close();
+        CHECK_EQ(s, Status::Ok);
+    }
+
+    TEST_CASE("1-Sanity   : Offline verification and compaction")
+    {
+        // Database cleanup and setup useful variables
+        SETUP_DB();
+        constexpr uint32_t KeyQty     = 2000;
+        constexpr uint32_t BlobKeyQty = 5;
+        lcVector<uint8_t>  blob(10'000, 0x6B);
+        OfflineReport      report;
+        auto               getBlobFileQty = [databasePath]() {
+            int fileQty = 0;
+            for (const auto& entry : std::filesystem::directory_iterator(databasePath)) {
+                if (entry.path().extension() == BlobFileSuffix) { ++fileQty; }
+            }
+            return fileQty;
+        };
+
+        Config config;
+        config.writeLaneQty                          = 2;
+        config.blobMinBytes                          = 8192;
+        config.dataFileMaxBytes                      = 64 * 1024;
+        config.mergeTriggerDataFileDeadByteThreshold = 60 * 1024;
+        config.mergeSelectDataFileDeadByteThreshold  = 50 * 1024;
+        CHECK_EQ(store.setConfig(config), Status::Ok);
+        s = store.open(databasePath);
+        CHECK_EQ(s, Status::Ok);
+        for (uint32_t i = 0; i < KeyQty; ++i) { CHECK_EQ(store.put(&i, 4, value.data(), VALUE_SIZE), Status::Ok); }
+        for (uint32_t i = 0; i < KeyQty / 2; ++i) { CHECK_EQ(store.put(&i, 4, value2.data(), VALUE_SIZE), Status::Ok); }
+        for (uint32_t i = KeyQty / 2; i < KeyQty / 2 + KeyQty / 4; ++i) { CHECK_EQ(store.remove(&i, 4), Status::Ok); }
+        for (uint32_t i = KeyQty; i < KeyQty + BlobKeyQty; ++i) { CHECK_EQ(store.put(&i, 4, blob.data(), blob.size()), Status::Ok); }
+        numberKey = KeyQty;
+        CHECK_EQ(store.remove(&numberKey, 4), Status::Ok);
+
+        // Offline operations are refused on an open datastore
+        CHECK_EQ(store.verifyOffline(databasePath, 4, report), Status::StoreAlreadyOpen);
+        Datastore otherStore;
+        CHECK_EQ(otherStore.compactOffline(databasePath, 4, report), Status::StoreAlreadyInUse);
+        s = store.close();
+        CHECK_EQ(s, Status::Ok);
+
+        uint64_t progressCallQty = 0;
+        CHECK_EQ(store.verifyOffline(databasePath, 4, report, [&](const char*, uint64_t, uint64_t) { ++progressCallQty; }), Status::Ok);
+        CHECK_FALSE(report.isCorrupted());
+        CHECK_GE(progressCallQty, 1);
+        CHECK_GT(report.dataFileQty, 2);
+        CHECK_EQ(report.badHintFileQty, 0);
+        CHECK_GE(report.blobEntryQty, BlobKeyQty);
+
+        // Only the live entries are kept, in several data files, with their hint files
+        constexpr uint32_t LiveEntryQty = KeyQty - KeyQty / 4 + BlobKeyQty - 1;
+        CHECK_EQ(store.compactOffline(databasePath, 4, report), Status::Ok);
+        CHECK_EQ(report.liveEntryQty, LiveEntryQty);
+        CHECK_GT(report.outputDataFileQty, 1);
+        CHECK_EQ(getBlobFileQty(), BlobKeyQty - 1);
+
+        CHECK_EQ(store.verifyOffline(databasePath, 2, report), Status::Ok);
+        CHECK_FALSE(report.isCorrupted());
+        CHECK_EQ(report.entryQty, LiveEntryQty);
+        CHECK_EQ(report.tombEntryQty, 0);
+        CHECK_EQ(report.missingHintFileQty, 0);
+        CHECK_EQ(report.badHintFileQty, 0);
+
+        s = store.open(databasePath);
+        CHECK_EQ(s, Status::Ok);
+        CHECK_EQ(store.getFileStats().entries, LiveEntryQty);
+        for (uint32_t i = 0; i < KeyQty + BlobKeyQty; ++i) {
+            bool isRemoved = (i >= KeyQty / 2 && i < KeyQty / 2 + KeyQty / 4) || i == KeyQty;
+            CHECK_EQ(store.get(&i, 4, retrievedValue), isRemoved ? Status::EntryNotFound : Status::Ok);
+            if (!isRemoved) { CHECK(retrievedValue == ((i >= KeyQty) ? blob : ((i < KeyQty / 2) ? value2 : value))); }
+        }
+        s = store.close();
+        CHECK_EQ(s, Status::Ok);
+
+        // A corrupted entry is detected, and the compaction does not modify the datastore
+        std::filesystem::path dataFilename;
+        for (const auto& entry : std::filesystem::directory_iterator(databasePath)) {
+            if (entry.path().extension() == DataFileSuffix) { dataFilename = entry.path(); }
+        }
+        FILE* fh = fopen(dataFilename.string().c_str(), "r+b");
+        REQUIRE(fh);
+        fseek(fh, -1, SEEK_END);
+        int lastByte = fgetc(fh);
+        fseek(fh, -1, SEEK_END);
+        fputc(lastByte ^ 0xFF, fh);
+        fclose(fh);
+
+        CHECK_EQ(store.verifyOffline(databasePath, 4, report), Status::Ok);
+        CHECK(report.isCorrupted());
+        CHECK_EQ(report.corruptedEntryQty, 1);
+        CHECK_EQ(store.compactOffline(databasePath, 4, report), Status::EntryCorrupted);
+        CHECK(std::filesystem::exists(dataFilename));
+    }
+
+    TEST_CASE("1-Sanity   : Sync policies")
+    {
+        // Database cleanup and setup useful variables
+        SETUP_DB();
+        s = store.open(databasePath);
+        CHECK_EQ(s, Status::Ok);
+        const DatastoreCounters& stats = store.getCounters();
+
+        // Lambda to wait for the background sync, with a timeout
+        auto waitForOsSync = [&stats](uint64_t minOsSyncQty) {
+            for (int i = 0; i < 1000 && stats.osSyncQty.load() < minOsSyncQty; ++i) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            }
+            return stats.osSyncQty.load() >= minOsSyncQty;
+        };
+
+        // No OS sync by default, even with forced disk sync
+        s = store.put(&numberKey, 4, &value[0], VALUE_SIZE, {}, 0, true);
+        CHECK_EQ(s, Status::Ok);
+        CHECK_EQ(stats.osSyncQty.load(), 0);
+
+        // Each write is synced
+        Config config     = store.getConfig();
+        config.syncPolicy = SyncPolicy::PerWrite;
+        s                 = store.setConfig(config);
+        CHECK_EQ(s, Status::Ok);
+        for (numberKey = 0; numberKey < 10; ++numberKey) {
+            s = store.put(&numberKey, 4, &value[0], VALUE_SIZE);
+            CHECK_EQ(s, Status::Ok);
+            CHECK_EQ(stats.osSyncQty.load(), numberKey + 1);
+            CHECK_EQ(osGetFileSize(store._dataFiles[store._writeLanes[0]->activeDataFileId]->filename),
+                     store._writeLanes[0]->activeDataOffset);
+        }
+
+        // Sync in background when enough bytes are written
+        uint64_t osSyncQty = stats.osSyncQty.load();
+        config.syncPolicy  = SyncPolicy::ByteThreshold;
+        config.syncBytes   = 10 * VALUE_SIZE;
+        s                  = store.setConfig(config);
+        CHECK_EQ(s, Status::Ok);
+        for (numberKey = 0; numberKey < 5; ++numberKey) {
+            s = store.put(&numberKey, 4, &value[0], VALUE_SIZE);
+            CHECK_EQ(s, Status::Ok);
+        }
+        CHECK_EQ(stats.osSyncQty.load(), osSyncQty);
+        for (numberKey = 0; numberKey < 10; ++numberKey) {
+            s = store.put(&numberKey, 4, &value[0], VALUE_SIZE);
+            CHECK_EQ(s, Status::Ok);
+        }
+        CHECK(waitForOsSync(osSyncQty + 1));
+
+        // Sync in background periodically
+        osSyncQty           = stats.osSyncQty.load();
+        config.syncPolicy   = SyncPolicy::Periodic;
+        config.syncPeriodMs = 10;
+        s                   = store.setConfig(config);
+        CHECK_EQ(s, Status::Ok);
+        s = store.put(&numberKey, 4, &value[0], VALUE_SIZE);
+        CHECK_EQ(s, Status::Ok);
+        CHECK(waitForOsSync(osSyncQty + 1));
+        uint64_t writePosition = store.getActiveWritePositionUnlocked(*store._writeLanes[0]);
+        for (int i = 0; i < 1000 && store._writeLanes[0]->syncedWritePosition.load() < writePosition; ++i) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        CHECK_EQ(osGetFileSize(store._dataFiles[store._writeLanes[0]->activeDataFileId]->filename),
+                 store._writeLanes[0]->activeDataOffset);
+
+        // No periodic sync without new writes
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        osSyncQty = stats.osSyncQty.load();
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        CHECK_EQ(stats.osSyncQty.load(), osSyncQty);
+
+        // Explicit sync
+        osSyncQty = stats.osSyncQty.load();
+        store.sync();
+        CHECK(stats.osSyncQty.load() > osSyncQty);
+
+        // The directory is synced with the created files when the policy is not None
+        uint64_t directorySyncQty = stats.directorySyncQty.load();
+        s                         = store.close();
+        CHECK_EQ(s, Status::Ok);
+        CHECK(stats.directorySyncQty.load() > directorySyncQty);
+    }
+
+    TEST_CASE("1-Sanity   : Latency statistics")
+    {
+        SETUP_DB();
+        constexpr uint32_t Qty = 1000;
+
+        // The histogram buckets cover the values without gap, with a relative precision of 1/8
+        for (uint64_t v : {(uint64_t)0, (uint64_t)1, (uint64_t)15, (uint64_t)16, (uint64_t)17, (uint64_t)1000, (uint64_t)123456789}) {
+            int bucketIdx = getLatencyBucketIndex(v);
+            CHECK(getLatencyBucketValue(bucketIdx) >= v);
+            CHECK(getLatencyBucketValue(bucketIdx) <= v + v / 8);
+            CHECK_EQ(getLatencyBucketIndex(getLatencyBucketValue(bucketIdx)), bucketIdx);
+            if (bucketIdx > 0) { CHECK_EQ(getLatencyBucketIndex(getLatencyBucketValue(bucketIdx - 1) + 1), bucketIdx); }
+        }
+        CHECK_EQ(getLatencyBucketIndex(UINT64_MAX), LatencyBucketQty - 1);
+
+        // Disabled by default
+        s = store.open(databasePath);
+        CHECK_EQ(s, Status::Ok);
+        s = store.put(&numberKey, KEY_SIZE, value.data(), value.size());
+        CHECK_EQ(s, Status::Ok);
+        CHECK_EQ(store.getLatencyStats(LatencyKind::Put).count, 0);
+
+        // Enabled, with writes from several threads
+        Config config                 = store.getConfig();
+        config.latencyInstrumentation = true;
+        s                             = store.setConfig(config);
+        CHECK_EQ(s, Status::Ok);
+        auto writer = [&store, &value](uint32_t firstNumber) {
+            for (uint32_t n = firstNumber; n < firstNumber + Qty; ++n) {
+                CHECK_EQ(store.put(&n, KEY_SIZE, value.data(), value.size(), {}, 0, false, CacheHint::NoCache), Status::Ok);
+            }
+        };
+        std::thread writerThread(writer, Qty);
+        writer(0);
+        writerThread.join();
+        for (uint32_t n = 0; n < 2 * Qty; ++n) { CHECK_EQ(store.get(&n, KEY_SIZE, retrievedValue), Status::Ok); }
+
+        LatencyStats putStats = store.getLatencyStats(LatencyKind::Put);
+        CHECK_EQ(putStats.count, 2 * Qty);
+        CHECK(putStats.minNs > 0);
+        CHECK(putStats.minNs <= putStats.p50Ns);
+        CHECK(putStats.p50Ns <= putStats.p90Ns);
+        CHECK(putStats.p90Ns <= putStats.p99Ns);
+        CHECK(putStats.p99Ns <= putStats.p999Ns);
+        CHECK(putStats.p999Ns <= putStats.maxNs);
+        CHECK(putStats.minNs <= putStats.meanNs);
+        CHECK(putStats.meanNs <= putStats.maxNs);
+        CHECK_EQ(store.getLatencyStats(LatencyKind::ActiveFileLockWait).count, 2 * Qty);
+        CHECK_EQ(store.getLatencyStats(LatencyKind::KeyDirShardLockWait).count, 2 * Qty);
+        CHECK_EQ(store.getLatencyStats(LatencyKind::Get).count, 2 * Qty);
+        CHECK(store.getLatencyStats(LatencyKind::WriteBufferFlush).count > 0);
+
+        // The values are read from the disk after a restart (empty cache)
+        s = store.close();
+        CHECK_EQ(s, Status::Ok);
+        s = store.open(databasePath);
+        CHECK_EQ(s, Status::Ok);
+        store.resetLatencyStats();
+        CHECK_EQ(store.getLatencyStats(LatencyKind::Get).count, 0);
+        for (uint32_t n = 0; n < Qty; ++n) { CHECK_EQ(store.get(&n, KEY_SIZE, retrievedValue), Status::Ok); }
+        CHECK_EQ(store.getLatencyStats(LatencyKind::GetDiskRead).count, Qty);
+        CHECK_EQ(store.getLatencyStats(LatencyKind::Get).count, Qty);
+        CHECK_EQ(store.getLatencyStats(LatencyKind::Put).count, 0);
+        CHECK(strcmp(Datastore::toString(LatencyKind::GetDiskRead), "UNKNOWN") != 0);
+
+        s = store.close();
+        CHECK_EQ(s, Status::Ok);
+    }
+
     TEST_CASE("1-Sanity   : Logs")
     {
         SETUP_DB();
@@ -262,4 +262,136 @@ TEST_SUITE("Value cache")
         CHECK_EQ(stats.missQty.load(), missQty + 1);
     }
 
+    TEST_CASE("1-Sanity   : Scan-resistant admission")
+    {
+        SETUP_DB();
+        constexpr int      cacheByteSize = 1024 * 1024;
+        constexpr uint32_t HotQty        = 3000;  // Above the warm queue share
+        Datastore          store(cacheByteSize);
+        store.setWriteBufferBytes(0);  // No write buffer, which masks partially the cache behavior
+        store.setLogLevel(LogLevel::Warn);
+        Config config;
+        config.valueCacheAdmissionFilter = true;
+        s                                = store.setConfig(config);
+        CHECK_EQ(s, Status::Ok);
+        s = store.open(databasePath);
+        CHECK_EQ(s, Status::Ok);
+
+        const ValueCacheCounters& stats = store.getValueCacheCounters();
+
+        // The "no cache" hint bypasses the cache, on writes and on reads from the disk
+        numberKey = 0xFFFFFFFF;
+        s         = store.put(&numberKey, 4, value.data(), VALUE_SIZE, {}, 0, false, CacheHint::NoCache);
+        CHECK_EQ(s, Status::Ok);
+        CHECK_EQ(stats.currentInCacheValueQty.load(), 0);
+        s = store.get(&numberKey, 4, retrievedValue, CacheHint::NoCache);
+        CHECK_EQ(s, Status::Ok);
+        CHECK(retrievedValue == value);
+        CHECK_EQ(stats.currentInCacheValueQty.load(), 0);
+        s = store.get(&numberKey, 4, retrievedValue);
+        CHECK_EQ(s, Status::Ok);
+        CHECK_EQ(stats.currentInCacheValueQty.load(), 1);
+
+        // Hot set, accessed several times
+        for (uint32_t i = 0; i < HotQty; ++i) {
+            numberKey = i;
+            s         = store.put(&numberKey, 4, value.data(), VALUE_SIZE);
+            CHECK_EQ(s, Status::Ok);
+        }
+        for (int round = 0; round < 5; ++round) {
+            for (uint32_t i = 0; i < HotQty; ++i) {
+                numberKey = i;
+                s         = store.get(&numberKey, 4, retrievedValue);
+                CHECK_EQ(s, Status::Ok);
+            }
+        }
+        CHECK_EQ(stats.missQty.load(), 0);
+
+        // Bulk ingest of one-shot entries, much bigger than the cache
+        for (uint32_t i = HotQty; i < HotQty + 4 * cacheByteSize / VALUE_SIZE; ++i) {
+            numberKey = i;
+            s         = store.put(&numberKey, 4, value.data(), VALUE_SIZE);
+            CHECK_EQ(s, Status::Ok);
+        }
+        CHECK_GT(stats.admissionRejectedQty.load(), 0);
+
+        // The hot set is still in the cache (a few values may have been evicted due to the estimation collisions in the sketch)
+        uint64_t hitQty = stats.hitQty.load();
+        for (uint32_t i = 0; i < HotQty; ++i) {
+            numberKey = i;
+            s         = store.get(&numberKey, 4, retrievedValue);
+            CHECK_EQ(s, Status::Ok);
+            CHECK(retrievedValue == value);
+        }
+        CHECK_GE(stats.hitQty.load(), hitQty + HotQty * 99 / 100);
+
+        s = store.close();
+        CHECK_EQ(s, Status::Ok);
+    }
+
+    TEST_CASE("1-Sanity   : Cache warm-up")
+    {
+        SETUP_DB();
+        constexpr uint32_t EntryQty = 1000;
+        Datastore          store(1024 * 1024);
+        store.setWriteBufferBytes(0);  // No write buffer, which masks partially the cache behavior
+        store.setLogLevel(LogLevel::Warn);
+        Config config;
+        config.valueCacheWarmUp = true;
+        s                       = store.setConfig(config);
+        CHECK_EQ(s, Status::Ok);
+        s = store.open(databasePath);
+        CHECK_EQ(s, Status::Ok);
+
+        const DatastoreCounters&  stats      = store.getCounters();
+        const ValueCacheCounters& cacheStats = store.getValueCacheCounters();
+
+        // Populate the cache
+        for (uint32_t i = 0; i < EntryQty; ++i) {
+            numberKey = i;
+            s         = store.put(&numberKey, 4, value.data(), VALUE_SIZE);
+            CHECK_EQ(s, Status::Ok);
+            s = store.get(&numberKey, 4, retrievedValue);
+            CHECK_EQ(s, Status::Ok);
+        }
+        numberKey = 0;
+        s         = store.remove(&numberKey, 4);  // Saved keys which disappeared shall be ignored
+        CHECK_EQ(s, Status::Ok);
+
+        // The hot and warm keys are saved at closing
+        s = store.close();
+        CHECK_EQ(s, Status::Ok);
+        uint64_t savedQty = stats.cacheWarmUpSavedKeyQty.load();
+        CHECK_GT(savedQty, 0);
+        CHECK_LE(savedQty, EntryQty - 1);
+        CHECK(fs::exists(fs::path(databasePath) / CacheWarmUpFilename));
+
+        // And reloaded in background at opening
+        s = store.open(databasePath);
+        CHECK_EQ(s, Status::Ok);
+        CHECK_FALSE(fs::exists(fs::path(databasePath) / CacheWarmUpFilename));
+        for (int i = 0; i < 500 && stats.cacheWarmUpLoadedValueQty.load() < savedQty; ++i) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+        CHECK_EQ(stats.cacheWarmUpLoadedValueQty.load(), savedQty);
+
+        // The reloaded values are cache hits
+        uint64_t hitQty = cacheStats.hitQty.load();
+        for (uint32_t i = 1; i < EntryQty; ++i) {
+            numberKey = i;
+            s         = store.get(&numberKey, 4, retrievedValue);
+            CHECK_EQ(s, Status::Ok);
+            CHECK(retrievedValue == value);
+        }
+        CHECK_EQ(cacheStats.hitQty.load(), hitQty + savedQty);
+
+        // Without the option, no warm-up file is written
+        config.valueCacheWarmUp = false;
+        s                       = store.setConfig(config);
+        CHECK_EQ(s, Status::Ok);
+        s = store.close();
+        CHECK_EQ(s, Status::Ok);
+        CHECK_FALSE(fs::exists(fs::path(databasePath) / CacheWarmUpFilename));
+    }
+
 }  // End of test suite
@@ -287,6 +287,165 @@ TEST_SUITE("Indexes")
         CHECK_EQ(store.getCounters().indexArrayCleanedEntries, 15);
     }
 
+    TEST_CASE("1-Sanity   : Sorted list intersection")
+    {
+        // Random sorted lists of unique hashes, with a common part
+        auto makeSortedList = [](size_t size, uint32_t modulo) {
+            lcVector<uint32_t> list;
+            for (size_t i = 0; i < size; ++i) { list.push_back((uint32_t)(testGetRandom() % modulo)); }
+            std::sort(list.begin(), list.end());
+            list.erase(std::unique(list.begin(), list.end()), list.end());
+            return list;
+        };
+
+        // Close sizes (block merge) and very different sizes (galloping), in both argument orders
+        const size_t sizes[][2] = {{0, 0}, {0, 100}, {3, 5}, {100, 100}, {1000, 3000}, {10, 100000}, {100000, 7}};
+        for (const auto& sizePair : sizes) {
+            lcVector<uint32_t> a = makeSortedList(sizePair[0], 200000);
+            lcVector<uint32_t> b = makeSortedList(sizePair[1], 200000);
+            lcVector<uint32_t> expected;
+            std::set_intersection(a.begin(), a.end(), b.begin(), b.end(), std::back_inserter(expected));
+
+            lcVector<uint32_t> out(std::min(a.size(), b.size()));
+            out.resize(intersectSortedHashes(a.data(), a.size(), b.data(), b.size(), out.data()));
+            CHECK_EQ(out, expected);
+        }
+
+        // Identical lists
+        lcVector<uint32_t> a = makeSortedList(1000, 0xFFFFFFFF);
+        lcVector<uint32_t> out(a.size());
+        CHECK_EQ(intersectSortedHashes(a.data(), a.size(), a.data(), a.size(), out.data()), a.size());
+        CHECK_EQ(out, a);
+    }
+
+    TEST_CASE("1-Sanity   : Multi-part query")
+    {
+        SETUP_DB();
+        Datastore store;
+        s = store.open(databasePath);
+        CHECK_EQ(s, Status::Ok);
+
+        // The key is a number followed by 3 tags depending on its divisibility by 2, 3 and 5
+        constexpr uint32_t KeyQty = 30000;
+        auto               putKey = [&](uint32_t keyNbr) {
+            lcVector<uint8_t> key(7);
+            memcpy(&key[0], &keyNbr, 4);
+            key[4] = (keyNbr % 2 == 0) ? 'a' : 'A';
+            key[5] = (keyNbr % 3 == 0) ? 'b' : 'B';
+            key[6] = (keyNbr % 5 == 0) ? 'c' : 'C';
+            return store.put(&key[0], (uint32_t)key.size(), &value[0], VALUE_SIZE, {{4, 1}, {5, 1}, {6, 1}});
+        };
+        auto removeKey = [&](uint32_t keyNbr) {
+            lcVector<uint8_t> key(7);
+            memcpy(&key[0], &keyNbr, 4);
+            key[4] = (keyNbr % 2 == 0) ? 'a' : 'A';
+            key[5] = (keyNbr % 3 == 0) ? 'b' : 'B';
+            key[6] = (keyNbr % 5 == 0) ? 'c' : 'C';
+            return store.remove(&key[0], (uint32_t)key.size());
+        };
+        lcVector<lcVector<uint8_t>> matchingKeys;
+        auto                        checkQuery = [&](const lcVector<lcString>& keyParts, size_t expectedQty) {
+            CHECK_EQ(store.query(keyParts, matchingKeys), Status::Ok);
+            CHECK_EQ(matchingKeys.size(), expectedQty);
+            std::sort(matchingKeys.begin(), matchingKeys.end());
+            CHECK(std::adjacent_find(matchingKeys.begin(), matchingKeys.end()) == matchingKeys.end());  // No duplicate
+            for (const auto& key : matchingKeys) {
+                for (const lcString& kp : keyParts) { CHECK_NE(std::find(key.begin() + 4, key.end(), (uint8_t)kp[0]), key.end()); }
+            }
+        };
+
+        // Queries in the middle of the insertions, so that the lists are made of a sorted part and appended hashes
+        for (uint32_t keyNbr = 0; keyNbr < KeyQty / 2; ++keyNbr) { CHECK_EQ(putKey(keyNbr), Status::Ok); }
+        checkQuery({"a", "b", "c"}, KeyQty / 2 / 30);
+        for (uint32_t keyNbr = KeyQty / 2; keyNbr < KeyQty; ++keyNbr) { CHECK_EQ(putKey(keyNbr), Status::Ok); }
+        checkQuery({"a", "b", "c"}, KeyQty / 30);
+        checkQuery({"c", "B"}, KeyQty / 5 - KeyQty / 15);
+        checkQuery({"A", "b", "C"}, KeyQty / 3 - KeyQty / 6 - KeyQty / 15 + KeyQty / 30);
+        checkQuery({"a", "A"}, 0);
+        checkQuery({"a", "z"}, 0);
+
+        // Removed entries disappear and entries put again are not duplicated
+        for (uint32_t keyNbr = 0; keyNbr < KeyQty; keyNbr += 60) { CHECK_EQ(removeKey(keyNbr), Status::Ok); }
+        checkQuery({"a", "b", "c"}, KeyQty / 60);
+        for (uint32_t keyNbr = 0; keyNbr < KeyQty; keyNbr += 60) { CHECK_EQ(putKey(keyNbr), Status::Ok); }
+        for (uint32_t keyNbr = 0; keyNbr < KeyQty; keyNbr += 30) { CHECK_EQ(putKey(keyNbr), Status::Ok); }
+        checkQuery({"c", "b", "a"}, KeyQty / 30);
+        checkQuery({"a"}, KeyQty / 2);
+    }
+
+    TEST_CASE("1-Sanity   : Paginated query")
+    {
+        SETUP_DB();
+        Datastore store;
+        s = store.open(databasePath);
+        CHECK_EQ(s, Status::Ok);
+
+        // 5000 keys with the tag "even" or "odd"
+        constexpr uint32_t KeyQty = 5000;
+        for (uint32_t keyNbr = 0; keyNbr < KeyQty; ++keyNbr) {
+            lcString key = ((keyNbr % 2) ? "odd/" : "even/") + std::to_string(keyNbr);
+            value[0]     = (uint8_t)keyNbr;
+            CHECK_EQ(store.put(key, value, {{0, (uint8_t)key.find('/')}}), Status::Ok);
+        }
+        lcVector<lcVector<uint8_t>> allKeys;
+        CHECK_EQ(store.query(lcString("even"), allKeys), Status::Ok);
+        CHECK_EQ(allKeys.size(), KeyQty / 2);
+        std::sort(allKeys.begin(), allKeys.end());
+
+        // Pages of 100 keys provide exactly the same keys
+        QueryCursor                 cursor;
+        lcVector<lcVector<uint8_t>> pageKeys, pagedKeys;
+        uint32_t                    pageQty = 0;
+        while (!cursor.isEnd()) {
+            CHECK_EQ(store.query(lcVector<lcString>{"even"}, cursor, 100, pageKeys), Status::Ok);
+            CHECK_LE(pageKeys.size(), 100);
+            pagedKeys.insert(pagedKeys.end(), pageKeys.begin(), pageKeys.end());
+            ++pageQty;
+        }
+        CHECK_GE(pageQty, KeyQty / 2 / 100);
+        std::sort(pagedKeys.begin(), pagedKeys.end());
+        CHECK_EQ(pagedKeys, allKeys);
+
+        // A finished cursor provides nothing
+        CHECK_EQ(store.query(lcVector<lcString>{"even"}, cursor, 100, pageKeys), Status::Ok);
+        CHECK(pageKeys.empty());
+
+        // Streaming with values and an early stop from the callback, then resumed
+        cursor = QueryCursor{};
+        lcVector<lcVector<uint8_t>> streamedKeys;
+        auto                        onMatch = [&](const lcVector<uint8_t>& key, const lcVector<uint8_t>& matchValue) {
+            lcString keyStr((const char*)key.data(), key.size());
+            CHECK_EQ(matchValue.size(), VALUE_SIZE);
+            CHECK_EQ(matchValue[0], (uint8_t)std::stoi(keyStr.substr(keyStr.find('/') + 1)));
+            streamedKeys.push_back(key);
+            return (streamedKeys.size() % 7) != 0;
+        };
+        CHECK_EQ(store.forEachMatch(lcVector<lcString>{"odd"}, cursor, UINT32_MAX, onMatch, true), Status::Ok);
+        CHECK_EQ(streamedKeys.size(), 7);
+        CHECK_FALSE(cursor.isEnd());
+        while (!cursor.isEnd()) { CHECK_EQ(store.forEachMatch(lcVector<lcString>{"odd"}, cursor, 1000, onMatch, true), Status::Ok); }
+        CHECK_EQ(streamedKeys.size(), KeyQty / 2);
+        std::sort(streamedKeys.begin(), streamedKeys.end());
+        CHECK(std::adjacent_find(streamedKeys.begin(), streamedKeys.end()) == streamedKeys.end());  // No duplicate
+
+        // Without values, the provided value is empty. Removed keys are not provided
+        for (uint32_t keyNbr = 1; keyNbr < KeyQty; keyNbr += 4) { CHECK_EQ(store.remove("odd/" + std::to_string(keyNbr)), Status::Ok); }
+        cursor              = QueryCursor{};
+        uint32_t matchQty   = 0;
+        auto     countMatch = [&](const lcVector<uint8_t>& /*key*/, const lcVector<uint8_t>& matchValue) {
+            CHECK(matchValue.empty());
+            ++matchQty;
+            return true;
+        };
+        CHECK_EQ(store.forEachMatch(lcVector<lcVector<uint8_t>>{{'o', 'd', 'd'}}, cursor, UINT32_MAX, countMatch), Status::Ok);
+        CHECK(cursor.isEnd());
+        CHECK_EQ(matchQty, KeyQty / 4);
+
+        // Bad key part size
+        cursor = QueryCursor{};
+        CHECK_EQ(store.forEachMatch(lcVector<lcString>{lcString(USHRT_MAX, 'x')}, cursor, 10, countMatch), Status::BadKeySize);
+    }
+
     TEST_CASE("1-Sanity   : Query variants")
     {
         SETUP_DB();
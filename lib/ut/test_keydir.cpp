@@ -47,7 +47,7 @@ TEST_SUITE("KeyDir")
             while (isStart && keyDir.isResizingOngoing()) keyDir.backgroundResizeWork(MaintenanceKeyDirBatchSize);
         });
         lcVector<uint8_t> key(KeySize, 0);
-        KeyChunk          entry{128, 0, NotStored, 0, 0, KeySize, 0, 0};
+        KeyChunk          entry{128, 0, NotStored, 0, 0, KeySize, 0, 0, 0};
         OldKeyChunk       oldEntry;
 
         keyDir.setMaxLoadFactor(1.);            // No resizing due to load factor. Our initial dimensioning prevents any locked situation
@@ -62,7 +62,7 @@ TEST_SUITE("KeyDir")
             for (int64_t opNbr = startLoadedKey; opNbr < lastLoadedKey; ++opNbr) {
                 *((uint32_t*)&key[0])  = (uint32_t)opNbr;
                 uint64_t keyHash       = LITECASK_HASH_FUNC(&key[0], KeySize);
-                Status   storageStatus = keyDir.insertEntry((uint32_t)keyHash, &key[0], nullptr, entry, oldEntry);
+                Status   storageStatus = keyDir.insertEntry((uint32_t)keyHash, &key[0], &NoKeyIndex, entry, oldEntry);
                 CHECK_EQ(storageStatus, Status::Ok);
             }
 
@@ -95,6 +95,121 @@ TEST_SUITE("KeyDir")
         }
     }
 
+    TEST_CASE("1-Sanity   : Sharded KeyDir with concurrent writers")
+    {
+        constexpr int      KeySize        = 8;
+        constexpr int      WriterQty      = 4;
+        constexpr uint32_t KeyPerWriter   = 50'000;
+        constexpr uint32_t TotalKeyQty    = WriterQty * KeyPerWriter;
+        std::atomic<bool>  isWriterFailed = false;
+        std::atomic<bool>  isReaderFailed = false;
+        std::atomic<bool>  areWritersDone = false;
+
+        // Small initial shards, so that they are resized while being written. Resizing is finished at the next resizing
+        ShardedKeyDir keyDir(detail::KeyStorageAllocBytes, KeyDirShardQty * 64, [&](uint32_t, bool, bool) {});
+
+        // Each writer locks only the shard of the key it modifies. The value size is used as a payload to check
+        auto writer = [&](uint32_t writerIdx) {
+            lcVector<uint8_t> key(KeySize, 0);
+            OldKeyChunk       oldEntry;
+            for (uint32_t i = 0; i < KeyPerWriter; ++i) {
+                uint32_t keyNbr       = writerIdx * KeyPerWriter + i;
+                *((uint32_t*)&key[0]) = keyNbr;
+                uint32_t    keyHash   = (uint32_t)LITECASK_HASH_FUNC(&key[0], KeySize);
+                std::mutex& mx        = keyDir.getMutex(keyHash);
+                mx.lock();
+                Status storageStatus =
+                    keyDir.insertEntry(keyHash, &key[0], &NoKeyIndex, {0, keyNbr, NotStored, 0, 0, KeySize, 0, 0, 0}, oldEntry);
+                mx.unlock();
+                if (storageStatus != Status::Ok) { isWriterFailed.store(true); }
+            }
+        };
+
+        // The lock-free reader shall never see a corrupted entry
+        auto reader = [&]() {
+            lcVector<uint8_t> key(KeySize, 0);
+            KeyChunk          entry;
+            while (!areWritersDone.load()) {
+                uint32_t keyNbr       = (uint32_t)(testGetRandom() % TotalKeyQty);
+                *((uint32_t*)&key[0]) = keyNbr;
+                uint32_t keyHash      = (uint32_t)LITECASK_HASH_FUNC(&key[0], KeySize);
+                if (keyDir.find(keyHash, &key[0], KeySize, entry) && entry.valueSize != keyNbr) { isReaderFailed.store(true); }
+            }
+        };
+
+        std::thread readerThread(reader);
+        lcVector<std::thread> writerThreads;
+        for (uint32_t writerIdx = 0; writerIdx < WriterQty; ++writerIdx) { writerThreads.push_back(std::thread(writer, writerIdx)); }
+        for (std::thread& t : writerThreads) { t.join(); }
+        areWritersDone.store(true);
+        readerThread.join();
+        CHECK_FALSE(isWriterFailed.load());
+        CHECK_FALSE(isReaderFailed.load());
+
+        // All entries are present, and spread over all shards
+        CHECK_EQ(keyDir.size(), TotalKeyQty);
+        for (uint32_t shardIdx = 0; shardIdx < KeyDirShardQty; ++shardIdx) {
+            CHECK_GT(keyDir.getShard(shardIdx).map.size(), TotalKeyQty / KeyDirShardQty / 2);
+        }
+        lcVector<uint8_t> key(KeySize, 0);
+        KeyChunk          entry;
+        for (uint32_t keyNbr = 0; keyNbr < TotalKeyQty; ++keyNbr) {
+            *((uint32_t*)&key[0]) = keyNbr;
+            uint32_t keyHash      = (uint32_t)LITECASK_HASH_FUNC(&key[0], KeySize);
+            bool     isFound      = keyDir.find(keyHash, &key[0], KeySize, entry);
+            CHECK(isFound);
+            CHECK_EQ(entry.valueSize, keyNbr);
+        }
+    }
+
+    TEST_CASE("1-Sanity   : KeyDir retired tables")
+    {
+        constexpr int KeySize                    = 8;
+        constexpr int MaintenanceKeyDirBatchSize = 100'000;
+        KeyDirMap     keyDir(detail::KeyStorageAllocBytes, 64, [&](uint32_t, bool isStart, bool) {
+            while (isStart && keyDir.isResizingOngoing()) keyDir.backgroundResizeWork(MaintenanceKeyDirBatchSize);
+        });
+        lcVector<uint8_t> key(KeySize, 0);
+        OldKeyChunk       oldEntry;
+        uint32_t          keyQty = 0;
+
+        auto insertKeys = [&](uint32_t qty) {
+            for (uint32_t i = 0; i < qty; ++i, ++keyQty) {
+                *((uint32_t*)&key[0]) = keyQty;
+                uint32_t keyHash      = (uint32_t)LITECASK_HASH_FUNC(&key[0], KeySize);
+                CHECK_EQ(keyDir.insertEntry(keyHash, &key[0], &NoKeyIndex, {0, keyQty, NotStored, 0, 0, KeySize, 0, 0, 0}, oldEntry),
+                         Status::Ok);
+            }
+        };
+        auto checkKeys = [&]() {
+            KeyChunk entry;
+            for (uint32_t keyNbr = 0; keyNbr < keyQty; ++keyNbr) {
+                *((uint32_t*)&key[0]) = keyNbr;
+                uint32_t keyHash      = (uint32_t)LITECASK_HASH_FUNC(&key[0], KeySize);
+                CHECK(keyDir.find(keyHash, &key[0], KeySize, entry));
+                CHECK_EQ(entry.valueSize, keyNbr);
+            }
+        };
+
+        // Without reader, the previous tables are freed as soon as they are retired
+        uint32_t capacity = keyDir.capacity();
+        insertKeys(1000);
+        CHECK_GT(keyDir.capacity(), 4 * capacity);
+        CHECK_EQ(keyDir.getRetiredTableQty(), 0);
+
+        // The tables retired while a lock-free reader may probe them are kept until it is gone
+        {
+            KeyDirMap::ReaderScope readerScope(keyDir);
+            capacity = keyDir.capacity();
+            while (keyDir.capacity() < 4 * capacity) { insertKeys(100); }
+            CHECK_GT(keyDir.getRetiredTableQty(), 0);
+            checkKeys();
+        }
+        keyDir.reclaimRetiredTables();
+        CHECK_EQ(keyDir.getRetiredTableQty(), 0);
+        checkKeys();
+    }
+
     TEST_CASE("2-Benchmark: KeyDir performance")
     {
         constexpr int KeySize                    = 8;
@@ -113,7 +228,7 @@ TEST_SUITE("KeyDir")
                          });
         keyDir.setMaxLoadFactor(0.95);
         lcVector<uint8_t> key(KeySize, 0);
-        KeyChunk          entry{128, 0, NotStored, 0, 0, KeySize, 0, 0};
+        KeyChunk          entry{128, 0, NotStored, 0, 0, KeySize, 0, 0, 0};
         OldKeyChunk       oldEntry;
 
         // Load the table
@@ -122,7 +237,7 @@ TEST_SUITE("KeyDir")
         for (int opNbr = 0; opNbr < lastLoadedKey; ++opNbr) {
             *((uint32_t*)&key[0])  = opNbr;
             uint64_t keyHash       = LITECASK_HASH_FUNC(&key[0], KeySize);
-            Status   storageStatus = keyDir.insertEntry((uint32_t)keyHash, &key[0], nullptr, entry, oldEntry);
+            Status   storageStatus = keyDir.insertEntry((uint32_t)keyHash, &key[0], &NoKeyIndex, entry, oldEntry);
             CHECK_EQ(storageStatus, Status::Ok);
             CHECK_EQ(oldEntry.isValid, false);
         }
@@ -30,6 +30,9 @@
 #include "doctest.h"
 
 #define LITECASK_BUILD_FOR_TEST  // Provides more insight in the library
+#if !defined(LITECASK_TEST_WITHOUT_IO_URING)
+#define LITECASK_WITH_IO_URING  // Asynchronous read backend (Linux only, ignored on Windows)
+#endif
 #include "litecask.h"
 
 // Test duration getter
@@ -270,4 +270,53 @@ TEST_SUITE("Memory allocator")
         }  // End of loop on test sizes
     }
 
+    TEST_CASE("1-Sanity   : Arena memory policy")
+    {
+        TlsfAllocator tlsf(64 * 1024 * 1024);
+
+        // The policies are a best effort depending on the OS, but the allocations shall work in any case
+        bool isHugePageApplied = tlsf.setMemoryPolicy({true, NumaPolicy::Default});
+#if !defined(_MSC_VER)
+        if (isHugePageApplied) {
+            // The huge page request is visible in the flags of the arena mapping ("hg")
+            bool  isArenaFound = false;
+            FILE* fh           = fopen("/proc/self/smaps", "r");
+            REQUIRE(fh);
+            char      line[512];
+            uintptr_t start = 0, end = 0, lineStart = 0, lineEnd = 0;
+            while (fgets(line, sizeof(line), fh)) {
+                if (sscanf(line, "%" SCNxPTR "-%" SCNxPTR " ", &lineStart, &lineEnd) == 2) {
+                    start = lineStart;  // Header line of a mapping
+                    end   = lineEnd;
+                    continue;
+                }
+                uintptr_t arenaAddr = (uintptr_t)tlsf._arenaBasePtr;
+                if (strncmp(line, "VmFlags:", 8) == 0 && start <= arenaAddr && arenaAddr < end) {
+                    isArenaFound = true;
+                    CHECK(strstr(line, " hg") != nullptr);
+                }
+            }
+            fclose(fh);
+            CHECK(isArenaFound);
+        }
+#endif
+
+        for (NumaPolicy numaPolicy : {NumaPolicy::Local, NumaPolicy::Interleave, NumaPolicy::Default}) {
+            tlsf.setMemoryPolicy({isHugePageApplied, numaPolicy});
+            lcVector<uint8_t*> allocatedPointers;
+            for (int i = 0; i < 1000; ++i) {
+                uint8_t* ptr = (uint8_t*)tlsf.malloc(16 * 1024);
+                REQUIRE(ptr);
+                memset(ptr, i & 0xFF, 16 * 1024);
+                allocatedPointers.push_back(ptr);
+            }
+            for (int i = 0; i < 1000; ++i) {
+                CHECK_EQ(allocatedPointers[i][16 * 1024 - 1], (uint8_t)(i & 0xFF));
+                tlsf.free(allocatedPointers[i]);
+            }
+            checkConsistency(&tlsf);
+        }
+        CHECK(tlsf.setMemoryPolicy({}));
+    }
+
 }  // End of test suite
@@ -66,6 +66,19 @@ writeThread(Datastore* store, uint32_t firstNumber, uint32_t qty)
     // printf("WRITE: %u entries\n", qty);
 }
 
+void
+syncedWriteThread(Datastore* store, uint32_t firstNumber, uint32_t qty)
+{
+    constexpr int     VALUE_SIZE = 128;
+    lcVector<uint8_t> value(VALUE_SIZE);
+
+    for (uint32_t numberKey = firstNumber; numberKey < firstNumber + qty; ++numberKey) {
+        for (int i = 0; i < VALUE_SIZE; ++i) { value[i] = ((uint8_t)numberKey) & 0xFF; }
+        Status s = store->put(&numberKey, 4, &value[0], VALUE_SIZE, {}, 0, true);
+        CHECK_EQ(s, Status::Ok);
+    }
+}
+
 // Tests
 // =====
 TEST_SUITE("Multithreading")
@@ -130,4 +143,222 @@ TEST_SUITE("Multithreading")
         CHECK_EQ(s, Status::Ok);
     }
 
+    TEST_CASE("1-Sanity   : Synced writes group commit")
+    {
+        // Database cleanup and setup useful variables
+        const char* databasePath = "/tmp/litecask_test/threading";
+        Datastore::erasePermanentlyAllContent_UseWithCaution(databasePath);
+
+        Datastore store;
+        Status    s = store.open(databasePath);
+        CHECK_EQ(s, Status::Ok);
+
+        // Each synced write is on disk when the call returns
+        uint32_t qty = 1000;
+        syncedWriteThread(&store, 0, 10);
+        CHECK_EQ(osGetFileSize(store._dataFiles[store._writeLanes[0]->activeDataFileId]->filename),
+                 store._writeLanes[0]->activeDataOffset);
+        CHECK_EQ(store.getCounters().groupCommitFlushQty, 10);
+
+        // Concurrent synced writers share the flushes
+        std::thread wt1(syncedWriteThread, &store, 0 * qty, qty);
+        std::thread wt2(syncedWriteThread, &store, 1 * qty, qty);
+        std::thread wt3(syncedWriteThread, &store, 2 * qty, qty);
+        std::thread wt4(syncedWriteThread, &store, 3 * qty, qty);
+        wt1.join();
+        wt2.join();
+        wt3.join();
+        wt4.join();
+        CHECK_EQ(store.getCounters().putCallQty, 4 * qty + 10);
+        CHECK_EQ(osGetFileSize(store._dataFiles[store._writeLanes[0]->activeDataFileId]->filename),
+                 store._writeLanes[0]->activeDataOffset);
+
+        // The synced writers which wait during a flush are all released by a single next flush.
+        // The ongoing flush is simulated, so that all of them are waiting before it ends
+        constexpr uint32_t WaitingWriterQty = 8;
+        constexpr uint32_t EntryBytes       = sizeof(DataFileEntry) + 4 + 128;
+        WriteLane&         lane             = *store._writeLanes[0];
+        uint64_t           flushQty         = store.getCounters().groupCommitFlushQty.load();
+        uint32_t           startOffset      = 0;
+        {
+            std::lock_guard<std::mutex> lk(lane.mxActiveFile);
+            startOffset = lane.activeDataOffset;
+        }
+        {
+            std::lock_guard<std::mutex> lk(lane.groupCommitMutex);
+            lane.isGroupCommitFlushOngoing = true;
+        }
+        lcVector<std::thread> waitingWriters;
+        for (uint32_t i = 0; i < WaitingWriterQty; ++i) { waitingWriters.emplace_back(syncedWriteThread, &store, 4 * qty + i, 1); }
+        bool areAllWritten = false;
+        for (int i = 0; i < 10000 && !areAllWritten; ++i) {
+            {
+                std::lock_guard<std::mutex> lk(lane.mxActiveFile);
+                areAllWritten = (lane.activeDataOffset == startOffset + WaitingWriterQty * EntryBytes);
+            }
+            if (!areAllWritten) { std::this_thread::sleep_for(std::chrono::milliseconds(1)); }
+        }
+        CHECK(areAllWritten);
+        {
+            std::lock_guard<std::mutex> lk(lane.groupCommitMutex);
+            lane.isGroupCommitFlushOngoing = false;
+            lane.groupCommitCv.notify_all();
+        }
+        for (std::thread& t : waitingWriters) { t.join(); }
+        CHECK_EQ(store.getCounters().groupCommitFlushQty.load() - flushQty, 1);
+        CHECK_EQ(osGetFileSize(store._dataFiles[lane.activeDataFileId]->filename), lane.activeDataOffset);
+
+        // Check for corruption
+        s = store.close();
+        CHECK_EQ(s, Status::Ok);
+        s = store.open(databasePath);
+        CHECK_EQ(s, Status::Ok);
+        lcVector<uint8_t> retrievedValue;
+        for (uint32_t numberKey = 0; numberKey < 4 * qty; ++numberKey) {
+            s = store.get(&numberKey, 4, retrievedValue);
+            CHECK_EQ(s, Status::Ok);
+            CHECK_EQ(retrievedValue[7], ((uint8_t)numberKey) & 0xFF);
+        }
+    }
+
+    TEST_CASE("1-Sanity   : Write lanes")
+    {
+        // Database cleanup and setup useful variables
+        const char* databasePath = "/tmp/litecask_test/threading";
+        Datastore::erasePermanentlyAllContent_UseWithCaution(databasePath);
+        constexpr uint32_t LaneQty   = 4;
+        constexpr uint32_t WriterQty = 4;
+        constexpr uint32_t Qty       = 5000;
+
+        Datastore store;
+        Config    config;
+        config.writeLaneQty                          = LaneQty;
+        config.dataFileMaxBytes                      = 256 * 1024;  // Some data files switches
+        config.mergeTriggerDataFileDeadByteThreshold = 64 * 1024;
+        config.mergeSelectDataFileDeadByteThreshold  = 64 * 1024;
+        Status s                                     = store.setConfig(config);
+        CHECK_EQ(s, Status::Ok);
+        s = store.open(databasePath);
+        CHECK_EQ(s, Status::Ok);
+
+        // Each lane has its own active data file
+        CHECK_EQ(store._writeLanes.size(), LaneQty);
+        for (uint32_t i = 0; i < LaneQty; ++i) {
+            for (uint32_t j = i + 1; j < LaneQty; ++j) {
+                CHECK_NE(store._writeLanes[i]->activeDataFileId, store._writeLanes[j]->activeDataFileId);
+            }
+        }
+
+        // Concurrent writers, each of them overwriting its own keys. The last write of each key is with round 1
+        auto laneWriteThread = [&store](uint32_t firstNumber) {
+            lcVector<uint8_t> value(128);
+            for (uint32_t round = 0; round < 2; ++round) {
+                for (uint32_t numberKey = firstNumber; numberKey < firstNumber + Qty; ++numberKey) {
+                    for (uint32_t i = 0; i < value.size(); ++i) { value[i] = (uint8_t)(numberKey + round); }
+                    Status putStatus = store.put(&numberKey, 4, value.data(), value.size());
+                    CHECK_EQ(putStatus, Status::Ok);
+                }
+            }
+        };
+        lcVector<std::thread> writers;
+        for (uint32_t i = 0; i < WriterQty; ++i) { writers.push_back(std::thread(laneWriteThread, i * Qty)); }
+        for (std::thread& t : writers) { t.join(); }
+
+        // A batch spanning several lanes: the first keys are removed, then half of them are written back
+        WriteBatch        batch;
+        lcVector<uint8_t> value(128, 0xAB);
+        for (uint32_t numberKey = 0; numberKey < 100; ++numberKey) { CHECK_EQ(batch.remove(&numberKey, 4), Status::Ok); }
+        for (uint32_t numberKey = 0; numberKey < 100; numberKey += 2) { CHECK_EQ(batch.put(&numberKey, 4, value.data(), 128), Status::Ok); }
+        s = store.write(batch);
+        CHECK_EQ(s, Status::Ok);
+
+        auto checkContent = [&store]() {
+            lcVector<uint8_t> retrievedValue;
+            for (uint32_t numberKey = 0; numberKey < WriterQty * Qty; ++numberKey) {
+                Status getStatus = store.get(&numberKey, 4, retrievedValue);
+                if (numberKey < 100 && (numberKey % 2) == 1) {
+                    CHECK_EQ(getStatus, Status::EntryNotFound);
+                } else if (numberKey < 100) {
+                    CHECK_EQ(getStatus, Status::Ok);
+                    CHECK_EQ(retrievedValue[7], 0xAB);
+                } else {
+                    CHECK_EQ(getStatus, Status::Ok);
+                    CHECK_EQ(retrievedValue[7], (uint8_t)(numberKey + 1));
+                }
+            }
+            CHECK_EQ(store.getCounters().getCallCorruptedQty, 0);
+        };
+        checkContent();
+
+        // The order of the entries is kept on disk
+        s = store.close();
+        CHECK_EQ(s, Status::Ok);
+        s = store.open(databasePath);
+        CHECK_EQ(s, Status::Ok);
+        checkContent();
+
+        // Also after a merge of the data files of all lanes
+        CHECK(store.requestMerge());
+        for (int round = 0; store.isMergeOnGoing() && round < 1000; ++round) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+        CHECK_FALSE(store.isMergeOnGoing());
+        CHECK(store.getCounters().mergeCycleWithMergeQty > 0);
+        checkContent();
+
+        // And with another lane quantity
+        s = store.close();
+        CHECK_EQ(s, Status::Ok);
+        config.writeLaneQty = 1;
+        s                   = store.setConfig(config);
+        CHECK_EQ(s, Status::Ok);
+        s = store.open(databasePath);
+        CHECK_EQ(s, Status::Ok);
+        CHECK_EQ(store._writeLanes.size(), 1);
+        checkContent();
+        s = store.close();
+        CHECK_EQ(s, Status::Ok);
+    }
+
+    TEST_CASE("1-Sanity   : Shared lock with many readers")
+    {
+        // More reader threads than the previous 32 slots, all holding the shared lock at the same time
+        constexpr int ReaderQty = 64;
+        RWLock        lock;
+
+        for (int round = 0; round < 2; ++round) {  // The slots of the exited threads are reused in the second round
+            std::atomic<int>  holderQty{0};
+            std::atomic<bool> isReleased{false};
+            std::atomic<bool> isWriterDone{false};
+
+            auto reader = [&]() {
+                lock.lockRead();
+                ++holderQty;
+                while (!isReleased.load()) { std::this_thread::yield(); }
+                lock.unlockRead();
+            };
+            lcVector<std::thread> readers;
+            for (int i = 0; i < ReaderQty; ++i) { readers.push_back(std::thread(reader)); }
+
+            // A reader falling back on the exclusive lock would block here
+            uint64_t startUs = testGetTimeUs();
+            while (holderQty.load() < ReaderQty && testGetTimeUs() - startUs < 10'000'000) { std::this_thread::yield(); }
+            CHECK_EQ(holderQty.load(), ReaderQty);
+
+            // The writer waits for all readers, whatever their NUMA node group
+            std::thread writer([&]() {
+                lock.lockWrite();
+                isWriterDone = true;
+                lock.unlockWrite();
+            });
+            std::this_thread::sleep_for(std::chrono::milliseconds(50));
+            CHECK_FALSE(isWriterDone.load());
+
+            isReleased = true;
+            for (std::thread& t : readers) { t.join(); }
+            writer.join();
+            CHECK(isWriterDone.load());
+        }
+    }
+
 }  // End of test suite
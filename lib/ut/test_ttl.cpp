@@ -105,4 +105,136 @@ TEST_SUITE("Time to live")
         s = store.close();
         CHECK_EQ(s, Status::Ok);
     }
+
+    TEST_CASE("1-Sanity   : Expiry wheel")
+    {
+        // Database cleanup and setup useful variables
+        SETUP_DB();
+        constexpr uint32_t EntryQty = 3000;
+
+        // The expiry is driven by the test
+        uint32_t officialTimeSec = 1'000'000;
+        store.setTestTimeFunction([&officialTimeSec]() { return officialTimeSec; });
+        Config config;
+        config.upkeepCyclePeriodMs = 3'600'000;
+        CHECK_EQ(store.setConfig(config), Status::Ok);
+        s = store.open(databasePath);
+        CHECK_EQ(s, Status::Ok);
+        store.updateNow();
+        auto getExpiryRecordQty = [&store]() {
+            uint32_t qty = 0;
+            for (uint32_t shardIdx = 0; shardIdx < KeyDirShardQty; ++shardIdx) {
+                qty += store._keyDir->getShard(shardIdx).map.getExpiryRecordQty();
+            }
+            return qty;
+        };
+
+        // Entries without TTL, with TTLs up to 100 s, and with TTLs longer than a round of the wheel.
+        // Some short TTLs are then extended, which makes their first scheduled expiry obsolete
+        auto isShortTtl   = [](uint32_t keyNbr) { return keyNbr % 3 == 1 && keyNbr % 30 != 1; };
+        auto isUpdatedTtl = [](uint32_t keyNbr) { return keyNbr % 30 == 1; };
+        auto isLongTtl    = [](uint32_t keyNbr) { return keyNbr % 3 == 2; };
+        uint32_t shortTtlQty = 0, updatedTtlQty = 0, longTtlQty = 0;
+        for (uint32_t keyNbr = 0; keyNbr < EntryQty; ++keyNbr) {
+            uint32_t ttlSec = (keyNbr % 3 == 0) ? 0 : ((keyNbr % 3 == 1) ? 1 + keyNbr % 100 : ExpiryWheelBucketQty + 500 + keyNbr % 100);
+            CHECK_EQ(store.put(&keyNbr, 4, value.data(), VALUE_SIZE, {}, ttlSec), Status::Ok);
+            shortTtlQty += isShortTtl(keyNbr) ? 1 : 0;
+            updatedTtlQty += isUpdatedTtl(keyNbr) ? 1 : 0;
+            longTtlQty += isLongTtl(keyNbr) ? 1 : 0;
+        }
+        for (uint32_t keyNbr = 1; keyNbr < EntryQty; keyNbr += 30) {
+            CHECK_EQ(store.put(&keyNbr, 4, value2.data(), VALUE_SIZE, {}, 200), Status::Ok);
+        }
+        CHECK_EQ(getExpiryRecordQty(), 2 * EntryQty / 3 + updatedTtlQty);
+
+        auto checkPresence = [&](const std::function<bool(uint32_t)>& isExpired) {
+            for (uint32_t keyNbr = 0; keyNbr < EntryQty; ++keyNbr) {
+                CHECK_EQ(store.get(&keyNbr, 4, retrievedValue), isExpired(keyNbr) ? Status::EntryNotFound : Status::Ok);
+            }
+        };
+
+        // Nothing is due yet
+        store.cleanExpiredEntries(100);
+        CHECK_EQ(store.getCounters().ttlExpiredEntryQty.load(), 0);
+
+        // The short TTLs are due and processed by small batches. The obsolete expiry records of the extended TTLs have no effect
+        officialTimeSec += 100;
+        store.updateNow();
+        store.cleanExpiredEntries(16);
+        CHECK_EQ(store.getCounters().ttlExpiredEntryQty.load(), shortTtlQty);
+        CHECK_EQ(getExpiryRecordQty(), longTtlQty + updatedTtlQty);
+        checkPresence(isShortTtl);
+
+        // The extended TTLs
+        officialTimeSec += 100;
+        store.updateNow();
+        store.cleanExpiredEntries(100);
+        CHECK_EQ(store.getCounters().ttlExpiredEntryQty.load(), shortTtlQty + updatedTtlQty);
+        CHECK_EQ(getExpiryRecordQty(), longTtlQty);
+        checkPresence([&](uint32_t keyNbr) { return isShortTtl(keyNbr) || isUpdatedTtl(keyNbr); });
+
+        // Refreshing the long TTLs, which are in the second level of the wheel, drops their obsolete records once they are half of
+        // their bucket. Updating with the same expiry time does not schedule it twice
+        for (uint32_t keyNbr = 2; keyNbr < EntryQty; keyNbr += 3) {
+            uint32_t ttlSec = ExpiryWheelBucketQty + 350 + keyNbr % 100;
+            CHECK_EQ(store.put(&keyNbr, 4, value2.data(), VALUE_SIZE, {}, ttlSec), Status::Ok);
+            CHECK_EQ(store.put(&keyNbr, 4, value.data(), VALUE_SIZE, {}, ttlSec), Status::Ok);
+        }
+        CHECK_EQ(getExpiryRecordQty(), longTtlQty);
+        store.cleanExpiredEntries(100);
+        CHECK_EQ(store.getCounters().ttlExpiredEntryQty.load(), shortTtlQty + updatedTtlQty);
+
+        // The long TTLs, after more than a round of the wheel
+        officialTimeSec += ExpiryWheelBucketQty + 500;
+        store.updateNow();
+        store.cleanExpiredEntries(100);
+        CHECK_EQ(store.getCounters().ttlExpiredEntryQty.load(), shortTtlQty + updatedTtlQty + longTtlQty);
+        CHECK_EQ(getExpiryRecordQty(), 0);
+        checkPresence([](uint32_t keyNbr) { return keyNbr % 3 != 0; });
+
+        s = store.close();
+        CHECK_EQ(s, Status::Ok);
+    }
+
+    TEST_CASE("1-Sanity   : Merge drops the expired entries")
+    {
+        // Database cleanup and setup useful variables
+        SETUP_DB();
+        constexpr uint32_t EntryQty = 100;
+
+        uint32_t officialTimeSec = 1'000'000;
+        store.setTestTimeFunction([&officialTimeSec]() { return officialTimeSec; });
+        s = store.open(databasePath);
+        CHECK_EQ(s, Status::Ok);
+        store.updateNow();
+
+        // Half of the entries have a TTL
+        for (uint32_t keyNbr = 0; keyNbr < EntryQty; ++keyNbr) {
+            CHECK_EQ(store.put(&keyNbr, 4, value.data(), VALUE_SIZE, {}, (keyNbr % 2) ? 10 : 0), Status::Ok);
+        }
+        store.createNewActiveDataFileUnlocked(*store._writeLanes[0]);
+
+        // Merge after the expiry, with and without invalidation by the upkeep
+        officialTimeSec += 20;
+        store.updateNow();
+        store.cleanExpiredEntries(EntryQty / 4);
+        uint64_t                gainedBytesBefore = store.getCounters().mergeGainedBytes.load();
+        lcVector<MergeFileInfo> mergeInfos        = {{0, {}, {}}};
+        lcString                mergeBasename     = store.createNewActiveDataFileUnlocked(*store._writeLanes[0]);
+        store.createMergedDataFiles(mergeInfos, mergeBasename, 150 * 1024 * 1024, 1);
+        store.replaceDataFiles(mergeInfos);
+        CHECK_EQ(store.getCounters().mergeGainedBytes.load() - gainedBytesBefore,
+                 (EntryQty / 2) * (sizeof(DataFileEntry) + KEY_SIZE + VALUE_SIZE));
+
+        // The entries without TTL are still present after reloading
+        store.close();
+        s = store.open(databasePath);
+        CHECK_EQ(s, Status::Ok);
+        for (uint32_t keyNbr = 0; keyNbr < EntryQty; ++keyNbr) {
+            CHECK_EQ(store.get(&keyNbr, 4, retrievedValue), (keyNbr % 2) ? Status::EntryNotFound : Status::Ok);
+        }
+
+        s = store.close();
+        CHECK_EQ(s, Status::Ok);
+    }
 }